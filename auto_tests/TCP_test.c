@@ -12,6 +12,7 @@
 #include "../toxcore/network.h"
 #include "../toxcore/os_memory.h"
 #include "../toxcore/os_random.h"
+#include "../toxcore/util.h"
 #include "auto_test_support.h"
 
 #define NUM_PORTS 3
@@ -431,9 +432,9 @@ static void test_some(void)
 }
 
 static int response_callback_good;
-static uint8_t response_callback_connection_id;
+static uint32_t response_callback_connection_id;
 static uint8_t response_callback_public_key[CRYPTO_PUBLIC_KEY_SIZE];
-static int response_callback(void *object, uint8_t connection_id, const uint8_t *public_key)
+static int response_callback(void *object, uint32_t connection_id, const uint8_t *public_key)
 {
     if (set_tcp_connection_number((TCP_Client_Connection *)(void *)((char *)object - 2), connection_id, 7) != 0) {
         return 1;
@@ -445,9 +446,9 @@ static int response_callback(void *object, uint8_t connection_id, const uint8_t
     return 0;
 }
 static int status_callback_good;
-static uint8_t status_callback_connection_id;
+static uint32_t status_callback_connection_id;
 static uint8_t status_callback_status;
-static int status_callback(void *object, uint32_t number, uint8_t connection_id, uint8_t status)
+static int status_callback(void *object, uint32_t number, uint32_t connection_id, uint8_t status)
 {
     if (object != (void *)2) {
         return 1;
@@ -463,7 +464,7 @@ static int status_callback(void *object, uint32_t number, uint8_t connection_id,
     return 0;
 }
 static int data_callback_good;
-static int data_callback(void *object, uint32_t number, uint8_t connection_id, const uint8_t *data, uint16_t length,
+static int data_callback(void *object, uint32_t number, uint32_t connection_id, const uint8_t *data, uint16_t length,
                          void *userdata)
 {
     if (object != (void *)3) {
@@ -703,6 +704,284 @@ static void test_client_invalid(void)
     mono_time_free(mem, mono_time);
 }
 
+#define NUM_WIDE_PEERS 10000
+
+/** One client of the relay in test_wide_connection_ids. */
+typedef struct Wide_Client {
+    TCP_Client_Connection *conn;
+    const uint8_t *peer_public_key;
+
+    uint32_t responses;
+    uint32_t max_id;
+    uint8_t *seen_ids;
+    bool duplicate_id;
+
+    uint32_t peer_id;
+    bool peer_online;
+    uint32_t data_received;
+} Wide_Client;
+
+static int wide_response_callback(void *object, uint32_t connection_id, const uint8_t *public_key)
+{
+    Wide_Client *client = (Wide_Client *)object;
+
+    if (client->seen_ids[connection_id] != 0) {
+        client->duplicate_id = true;
+    }
+
+    client->seen_ids[connection_id] = 1;
+    client->max_id = max_u32(client->max_id, connection_id);
+    ++client->responses;
+
+    if (pk_equal(public_key, client->peer_public_key)) {
+        client->peer_id = connection_id;
+        set_tcp_connection_number(client->conn, connection_id, 7);
+    }
+
+    return 0;
+}
+
+static int wide_status_callback(void *object, uint32_t number, uint32_t connection_id, uint8_t status)
+{
+    Wide_Client *client = (Wide_Client *)object;
+
+    if (number == 7 && connection_id == client->peer_id && status == 2) {
+        client->peer_online = true;
+    }
+
+    return 0;
+}
+
+static int wide_data_callback(void *object, uint32_t number, uint32_t connection_id, const uint8_t *data,
+                              uint16_t length, void *userdata)
+{
+    Wide_Client *client = (Wide_Client *)object;
+
+    if (number == 7 && connection_id == client->peer_id && length == 6 && memcmp(data, "Gentoo", 6) == 0) {
+        ++client->data_received;
+    }
+
+    return 0;
+}
+
+static void do_wide_clients(const Logger *logger, TCP_Server *tcp_s, Mono_Time *mono_time,
+                            Wide_Client *a, Wide_Client *b)
+{
+    c_sleep(1);
+    mono_time_update(mono_time);
+    do_tcp_server(tcp_s, mono_time);
+    do_tcp_connection(logger, mono_time, a->conn, nullptr);
+    do_tcp_connection(logger, mono_time, b->conn, nullptr);
+}
+
+// One client routes to NUM_WIDE_PEERS peers over a single relay connection,
+// which needs the wide connection id extension.
+static void test_wide_connection_ids(void)
+{
+    const Random *rng = os_random();
+    ck_assert(rng != nullptr);
+    const Network *ns = os_network();
+    ck_assert(ns != nullptr);
+    const Memory *mem = os_memory();
+    ck_assert(mem != nullptr);
+
+    Mono_Time *mono_time = mono_time_new(mem, nullptr, nullptr);
+    Logger *logger = logger_new(mem);
+
+    uint8_t self_public_key[CRYPTO_PUBLIC_KEY_SIZE];
+    uint8_t self_secret_key[CRYPTO_SECRET_KEY_SIZE];
+    crypto_new_keypair(rng, self_public_key, self_secret_key);
+    TCP_Server *tcp_s = new_tcp_server(logger, mem, rng, ns, USE_IPV6, NUM_PORTS, ports, self_secret_key, nullptr, nullptr);
+    ck_assert_msg(tcp_s != nullptr, "Failed to create a TCP relay server.");
+
+    IP_Port ip_port_tcp_s;
+    ip_port_tcp_s.port = net_htons(ports[random_u32(rng) % NUM_PORTS]);
+    ip_port_tcp_s.ip = get_loopback();
+
+    uint8_t a_public_key[CRYPTO_PUBLIC_KEY_SIZE];
+    uint8_t a_secret_key[CRYPTO_SECRET_KEY_SIZE];
+    crypto_new_keypair(rng, a_public_key, a_secret_key);
+    uint8_t b_public_key[CRYPTO_PUBLIC_KEY_SIZE];
+    uint8_t b_secret_key[CRYPTO_SECRET_KEY_SIZE];
+    crypto_new_keypair(rng, b_public_key, b_secret_key);
+
+    Wide_Client a = {nullptr};
+    a.peer_public_key = b_public_key;
+    a.peer_id = UINT32_MAX;
+    a.seen_ids = (uint8_t *)calloc(NUM_WIDE_CLIENT_CONNECTIONS, 1);
+    ck_assert(a.seen_ids != nullptr);
+    a.conn = new_tcp_connection(logger, mem, mono_time, rng, ns, &ip_port_tcp_s, self_public_key, a_public_key,
+                                a_secret_key, nullptr, nullptr);
+    ck_assert_msg(a.conn != nullptr, "Failed to create a TCP client connection.");
+
+    Wide_Client b = {nullptr};
+    b.peer_public_key = a_public_key;
+    b.peer_id = UINT32_MAX;
+    b.seen_ids = (uint8_t *)calloc(NUM_WIDE_CLIENT_CONNECTIONS, 1);
+    ck_assert(b.seen_ids != nullptr);
+    b.conn = new_tcp_connection(logger, mem, mono_time, rng, ns, &ip_port_tcp_s, self_public_key, b_public_key,
+                                b_secret_key, nullptr, nullptr);
+    ck_assert_msg(b.conn != nullptr, "Failed to create a TCP client connection.");
+
+    Wide_Client *clients[] = {&a, &b};
+
+    for (uint32_t i = 0; i < 2; ++i) {
+        routing_response_handler(clients[i]->conn, wide_response_callback, clients[i]);
+        routing_status_handler(clients[i]->conn, wide_status_callback, clients[i]);
+        routing_data_handler(clients[i]->conn, wide_data_callback, clients[i]);
+    }
+
+    for (uint32_t i = 0; i < 100 && (tcp_con_status(a.conn) != TCP_CLIENT_CONFIRMED
+                                     || tcp_con_status(b.conn) != TCP_CLIENT_CONFIRMED); ++i) {
+        do_wide_clients(logger, tcp_s, mono_time, &a, &b);
+    }
+
+    ck_assert_msg(tcp_con_status(a.conn) == TCP_CLIENT_CONFIRMED && tcp_con_status(b.conn) == TCP_CLIENT_CONFIRMED,
+                  "Clients failed to connect to the relay.");
+
+    // Let the extension negotiation finish before any real routing.
+    for (uint32_t i = 0; i < 10; ++i) {
+        do_wide_clients(logger, tcp_s, mono_time, &a, &b);
+    }
+
+    uint8_t public_key[CRYPTO_PUBLIC_KEY_SIZE];
+
+    for (uint32_t i = 0; i < NUM_WIDE_PEERS - 1; ++i) {
+        random_bytes(rng, public_key, sizeof(public_key));
+        send_routing_request(logger, a.conn, public_key);
+
+        if (i % 100 == 99) {
+            // Let the relay drain its socket, or both sides stall on full windows.
+            do_wide_clients(logger, tcp_s, mono_time, &a, &b);
+        }
+    }
+
+    // The real peer gets an id far beyond NUM_CLIENT_CONNECTIONS.
+    send_routing_request(logger, a.conn, b_public_key);
+    send_routing_request(logger, b.conn, a_public_key);
+
+    for (uint32_t i = 0; i < 10000 && (a.responses < NUM_WIDE_PEERS || !a.peer_online || !b.peer_online); ++i) {
+        do_wide_clients(logger, tcp_s, mono_time, &a, &b);
+    }
+
+    ck_assert_msg(a.responses == NUM_WIDE_PEERS, "Got %u of %u routing responses.", a.responses, NUM_WIDE_PEERS);
+    ck_assert_msg(!a.duplicate_id, "The relay handed out a connection id twice.");
+    ck_assert_msg(a.max_id >= NUM_CLIENT_CONNECTIONS, "Connection ids did not exceed %u: %u.",
+                  NUM_CLIENT_CONNECTIONS, a.max_id);
+    ck_assert_msg(a.peer_id >= NUM_CLIENT_CONNECTIONS, "Wrong connection id for the real peer: %u.", a.peer_id);
+    ck_assert_msg(a.peer_online && b.peer_online, "Peers did not see each other come online.");
+
+    ck_assert_msg(send_data(logger, a.conn, a.peer_id, (const uint8_t *)"Gentoo", 6) == 1, "Failed a send_data() call.");
+    ck_assert_msg(send_data(logger, b.conn, b.peer_id, (const uint8_t *)"Gentoo", 6) == 1, "Failed a send_data() call.");
+
+    for (uint32_t i = 0; i < 1000 && (a.data_received == 0 || b.data_received == 0); ++i) {
+        do_wide_clients(logger, tcp_s, mono_time, &a, &b);
+    }
+
+    ck_assert_msg(a.data_received == 1 && b.data_received == 1, "Data was not relayed over wide connection ids.");
+
+    kill_tcp_server(tcp_s);
+    kill_tcp_connection(a.conn);
+    kill_tcp_connection(b.conn);
+    free(a.seen_ids);
+    free(b.seen_ids);
+
+    logger_kill(logger);
+    mono_time_free(mem, mono_time);
+}
+
+// A client without wide ids routes to one with them. Its ids grow by a byte on
+// the way, so its largest packets can't be relayed, but they mustn't cost it
+// the connection.
+static void test_mixed_connection_ids(void)
+{
+    const Random *rng = os_random();
+    ck_assert(rng != nullptr);
+    const Network *ns = os_network();
+    ck_assert(ns != nullptr);
+    const Memory *mem = os_memory();
+    ck_assert(mem != nullptr);
+
+    Mono_Time *mono_time = mono_time_new(mem, nullptr, nullptr);
+    Logger *logger = logger_new(mem);
+
+    uint8_t self_public_key[CRYPTO_PUBLIC_KEY_SIZE];
+    uint8_t self_secret_key[CRYPTO_SECRET_KEY_SIZE];
+    crypto_new_keypair(rng, self_public_key, self_secret_key);
+    TCP_Server *tcp_s = new_tcp_server(logger, mem, rng, ns, USE_IPV6, NUM_PORTS, ports, self_secret_key, nullptr, nullptr);
+    ck_assert_msg(tcp_s != nullptr, "Failed to create a TCP relay server.");
+
+    IP_Port ip_port_tcp_s;
+    ip_port_tcp_s.port = net_htons(ports[random_u32(rng) % NUM_PORTS]);
+    ip_port_tcp_s.ip = get_loopback();
+
+    uint8_t w_public_key[CRYPTO_PUBLIC_KEY_SIZE];
+    uint8_t w_secret_key[CRYPTO_SECRET_KEY_SIZE];
+    crypto_new_keypair(rng, w_public_key, w_secret_key);
+
+    struct sec_TCP_con *old = new_tcp_con(logger, mem, rng, ns, tcp_s, mono_time);
+
+    Wide_Client w = {nullptr};
+    w.peer_public_key = old->public_key;
+    w.peer_id = UINT32_MAX;
+    w.seen_ids = (uint8_t *)calloc(NUM_WIDE_CLIENT_CONNECTIONS, 1);
+    ck_assert(w.seen_ids != nullptr);
+    w.conn = new_tcp_connection(logger, mem, mono_time, rng, ns, &ip_port_tcp_s, self_public_key, w_public_key,
+                                w_secret_key, nullptr, nullptr);
+    ck_assert_msg(w.conn != nullptr, "Failed to create a TCP client connection.");
+    routing_response_handler(w.conn, wide_response_callback, &w);
+    routing_status_handler(w.conn, wide_status_callback, &w);
+    routing_data_handler(w.conn, wide_data_callback, &w);
+
+    for (uint32_t i = 0; i < 100 && tcp_con_status(w.conn) != TCP_CLIENT_CONFIRMED; ++i) {
+        do_tcp_server_delay(tcp_s, mono_time, 1);
+        do_tcp_connection(logger, mono_time, w.conn, nullptr);
+    }
+
+    ck_assert_msg(tcp_con_status(w.conn) == TCP_CLIENT_CONFIRMED, "Client failed to connect to the relay.");
+
+    uint8_t requ_p[1 + CRYPTO_PUBLIC_KEY_SIZE];
+    requ_p[0] = TCP_PACKET_ROUTING_REQUEST;
+    memcpy(requ_p + 1, w_public_key, CRYPTO_PUBLIC_KEY_SIZE);
+    write_packet_tcp_test_connection(logger, mem, old, requ_p, sizeof(requ_p));
+    send_routing_request(logger, w.conn, old->public_key);
+
+    for (uint32_t i = 0; i < 100 && !w.peer_online; ++i) {
+        do_tcp_server_delay(tcp_s, mono_time, 1);
+        do_tcp_connection(logger, mono_time, w.conn, nullptr);
+    }
+
+    ck_assert_msg(w.peer_online, "The wide client did not see the old one come online.");
+
+    uint8_t data[2 + MAX_PACKET_SIZE];
+    int len = read_packet_sec_tcp(logger, old, data, 2 + 1 + 1 + CRYPTO_PUBLIC_KEY_SIZE + CRYPTO_MAC_SIZE);
+    ck_assert_msg(len == 1 + 1 + CRYPTO_PUBLIC_KEY_SIZE && data[0] == TCP_PACKET_ROUTING_RESPONSE,
+                  "Wrong routing response.");
+    const uint8_t old_id = data[1];
+    ck_assert_msg(old_id >= NUM_RESERVED_PORTS, "The relay refused the routing request.");
+
+    // The largest packet the old client can send, and then one that fits.
+    uint8_t big_packet[MAX_PACKET_SIZE - CRYPTO_MAC_SIZE] = {old_id};
+    write_packet_tcp_test_connection(logger, mem, old, big_packet, sizeof(big_packet));
+    const uint8_t small_packet[] = {old_id, 'G', 'e', 'n', 't', 'o', 'o'};
+    write_packet_tcp_test_connection(logger, mem, old, small_packet, sizeof(small_packet));
+
+    for (uint32_t i = 0; i < 100 && w.data_received == 0; ++i) {
+        do_tcp_server_delay(tcp_s, mono_time, 1);
+        do_tcp_connection(logger, mono_time, w.conn, nullptr);
+    }
+
+    ck_assert_msg(w.data_received == 1, "The relay dropped the old client after an oversized packet.");
+
+    kill_tcp_server(tcp_s);
+    kill_tcp_connection(w.conn);
+    kill_tcp_con(old);
+    free(w.seen_ids);
+
+    logger_kill(logger);
+    mono_time_free(mem, mono_time);
+}
+
 #include "../toxcore/TCP_connection.h"
 
 static bool tcp_data_callback_called;
@@ -948,6 +1227,8 @@ static void tcp_suite(void)
     test_some();
     test_client();
     test_client_invalid();
+    test_wide_connection_ids();
+    test_mixed_connection_ids();
     test_tcp_connection();
     test_tcp_connection2();
 }
@@ -202,11 +202,110 @@ static void test_keys(void)
     tox_pass_key_free(key);
 }
 
+static void test_chunked(void)
+{
+    Tox_Err_Encryption encerr;
+    Tox_Err_Decryption decerr;
+    Tox_Err_Key_Derivation keyerr;
+    Tox_Pass_Key *key = tox_pass_key_derive((const uint8_t *)"123qweasdzxc", 12, &keyerr);
+    ck_assert_msg(key != nullptr, "key derivation failure: %u", keyerr);
+
+    // Two and a half chunks.
+    const size_t plaintext_len = 2 * TOX_PASS_CHUNK_LENGTH + TOX_PASS_CHUNK_LENGTH / 2;
+    uint8_t *plaintext = (uint8_t *)malloc(plaintext_len);
+    ck_assert(plaintext != nullptr);
+    const Random *rng = os_random();
+    ck_assert(rng != nullptr);
+    random_bytes(rng, plaintext, plaintext_len);
+
+    const size_t ciphertext_len = tox_pass_chunked_length(plaintext_len);
+    ck_assert(ciphertext_len == TOX_PASS_CHUNKED_HEADER_LENGTH + plaintext_len + 3 * TOX_PASS_CHUNK_EXTRA_LENGTH);
+    uint8_t *ciphertext = (uint8_t *)malloc(ciphertext_len);
+    ck_assert(ciphertext != nullptr);
+    bool ret = tox_pass_key_encrypt_chunked(key, plaintext, plaintext_len, ciphertext, &encerr);
+    ck_assert_msg(ret, "chunked encryption failure: %u", encerr);
+    ck_assert_msg(tox_is_data_encrypted(ciphertext), "chunked magic number missing");
+    ck_assert(tox_pass_chunked_count(ciphertext, ciphertext_len) == 3);
+    ck_assert(tox_pass_chunked_plaintext_length(ciphertext, ciphertext_len) == plaintext_len);
+
+    uint8_t salt[TOX_PASS_SALT_LENGTH];
+    ck_assert_msg(tox_get_salt(ciphertext, salt, nullptr), "couldn't get salt from chunked data");
+    ck_assert_msg(memcmp(salt, key, TOX_PASS_SALT_LENGTH) == 0, "wrong salt in chunked data");
+
+    uint8_t *out = (uint8_t *)calloc(1, plaintext_len);
+    ck_assert(out != nullptr);
+    ret = tox_pass_key_decrypt_chunked(key, ciphertext, ciphertext_len, out, &decerr);
+    ck_assert_msg(ret, "chunked decryption failure: %u", decerr);
+    ck_assert_msg(memcmp(out, plaintext, plaintext_len) == 0, "chunked decryption differs");
+
+    // Chunks can be decrypted in any order, e.g. by several threads.
+    memset(out, 0, plaintext_len);
+    ck_assert(tox_pass_key_decrypt_chunks(key, ciphertext, ciphertext_len, 2, 1, out, nullptr));
+    ck_assert(tox_pass_key_decrypt_chunks(key, ciphertext, ciphertext_len, 0, 2, out, nullptr));
+    ck_assert_msg(memcmp(out, plaintext, plaintext_len) == 0, "chunk range decryption differs");
+
+    // The stream decryptor reads what the whole-buffer encryption wrote.
+    Tox_Pass_Decryptor *decryptor = tox_pass_decryptor_new(key, ciphertext, &decerr);
+    ck_assert_msg(decryptor != nullptr, "decryptor creation failure: %u", decerr);
+    const uint32_t chunk_length = tox_pass_decryptor_chunk_length(decryptor);
+    ck_assert(chunk_length == TOX_PASS_CHUNK_LENGTH + TOX_PASS_CHUNK_EXTRA_LENGTH);
+
+    for (size_t i = 0; i < 3; ++i) {
+        const size_t offset = TOX_PASS_CHUNKED_HEADER_LENGTH + i * chunk_length;
+        const size_t len = i == 2 ? ciphertext_len - offset : chunk_length;
+        ret = tox_pass_decryptor_read(decryptor, ciphertext + offset, len, i == 2, out + i * TOX_PASS_CHUNK_LENGTH, &decerr);
+        ck_assert_msg(ret, "stream decryption failure at chunk %u: %u", (unsigned)i, decerr);
+    }
+
+    tox_pass_decryptor_free(decryptor);
+    ck_assert_msg(memcmp(out, plaintext, plaintext_len) == 0, "stream decryption differs");
+
+    // The stream encryptor writes what the whole-buffer decryption reads.
+    uint8_t *streamed = (uint8_t *)malloc(ciphertext_len);
+    ck_assert(streamed != nullptr);
+    Tox_Pass_Encryptor *encryptor = tox_pass_encryptor_new(key, streamed, &encerr);
+    ck_assert_msg(encryptor != nullptr, "encryptor creation failure: %u", encerr);
+
+    for (size_t i = 0; i < 3; ++i) {
+        const size_t len = i == 2 ? plaintext_len - 2 * TOX_PASS_CHUNK_LENGTH : TOX_PASS_CHUNK_LENGTH;
+        ret = tox_pass_encryptor_write(encryptor, plaintext + i * TOX_PASS_CHUNK_LENGTH, len, i == 2,
+                                       streamed + TOX_PASS_CHUNKED_HEADER_LENGTH + i * chunk_length, &encerr);
+        ck_assert_msg(ret, "stream encryption failure at chunk %u: %u", (unsigned)i, encerr);
+    }
+
+    ck_assert_msg(!tox_pass_encryptor_write(encryptor, plaintext, 1, true, streamed, &encerr),
+                  "stream encryption continued after the last chunk");
+    tox_pass_encryptor_free(encryptor);
+
+    memset(out, 0, plaintext_len);
+    ret = tox_pass_key_decrypt_chunked(key, streamed, ciphertext_len, out, &decerr);
+    ck_assert_msg(ret, "decryption of stream failure: %u", decerr);
+    ck_assert_msg(memcmp(out, plaintext, plaintext_len) == 0, "decryption of stream differs");
+
+    // Dropping the last chunk makes the new last chunk fail to authenticate.
+    const size_t truncated_len = TOX_PASS_CHUNKED_HEADER_LENGTH + 2 * chunk_length;
+    ck_assert(!tox_pass_key_decrypt_chunked(key, ciphertext, truncated_len, out, &decerr));
+    ck_assert_msg(decerr == TOX_ERR_DECRYPTION_FAILED, "wrong error for truncated data: %u", decerr);
+
+    // Changing one byte only fails the chunk it is in.
+    ciphertext[TOX_PASS_CHUNKED_HEADER_LENGTH + chunk_length] ^= 1;
+    ck_assert(tox_pass_key_decrypt_chunks(key, ciphertext, ciphertext_len, 0, 1, out, nullptr));
+    ck_assert(!tox_pass_key_decrypt_chunks(key, ciphertext, ciphertext_len, 1, 1, out, &decerr));
+    ck_assert_msg(decerr == TOX_ERR_DECRYPTION_FAILED, "wrong error for corrupted chunk: %u", decerr);
+
+    free(streamed);
+    free(out);
+    free(ciphertext);
+    free(plaintext);
+    tox_pass_key_free(key);
+}
+
 int main(void)
 {
     setvbuf(stdout, nullptr, _IONBF, 0);
     test_save_friend();
     test_keys();
+    test_chunked();
 
     return 0;
 }
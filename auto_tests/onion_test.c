@@ -332,6 +332,10 @@ static void test_basic(void)
                     dht_get_self_public_key(onion1->dht),
                     CRYPTO_PUBLIC_KEY_SIZE) != 0);
 
+    // The entry set by hand above and the one just announced.
+    ck_assert_msg(onion_announce_num_entries(onion2_a) == 2, "expected 2 live announce entries, got %u",
+                  onion_announce_num_entries(onion2_a));
+
     c_sleep(1000);
     Logger *log3 = logger_new(mem);
     logger_callback_log(log3, print_debug_logger, nullptr, &index[2]);
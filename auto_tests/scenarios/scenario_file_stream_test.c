@@ -0,0 +1,190 @@
+#include "framework/framework.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../toxcore/tox_private.h"
+
+// Not a multiple of the chunk size, so the last chunk is short.
+#define FILE_SIZE (1024 * 1024 + 123)
+
+// File 0 is sent from a region into a write callback, file 1 from a read
+// callback into a region.
+static uint8_t region_source[FILE_SIZE];
+static uint8_t callback_source[FILE_SIZE];
+static uint8_t region_sink[FILE_SIZE];
+static uint8_t callback_sink[FILE_SIZE];
+
+typedef struct {
+    uint32_t reads;
+    uint32_t finished;
+} SenderState;
+
+static size_t read_source(void *user_data, uint64_t position, uint8_t *data, size_t length)
+{
+    SenderState *state = (SenderState *)user_data;
+    ++state->reads;
+
+    if (position >= FILE_SIZE) {
+        return 0;
+    }
+
+    if (length > FILE_SIZE - position) {
+        length = FILE_SIZE - position;
+    }
+
+    memcpy(data, callback_source + position, length);
+    return length;
+}
+
+static void on_file_chunk_request(const Tox_Event_File_Chunk_Request *event, void *user_data)
+{
+    ToxNode *self = (ToxNode *)user_data;
+    SenderState *state = (SenderState *)tox_node_get_script_ctx(self);
+
+    // With a source, only the end of the transfer is reported.
+    ck_assert(tox_event_file_chunk_request_get_length(event) == 0);
+    ++state->finished;
+}
+
+static void sender_script(ToxNode *self, void *ctx)
+{
+    SenderState *state = (SenderState *)ctx;
+    tox_events_callback_file_chunk_request(tox_node_get_dispatch(self), on_file_chunk_request);
+
+    tox_node_wait_for_self_connected(self);
+    tox_node_wait_for_friend_connected(self, 0);
+
+    Tox *tox = tox_node_get_tox(self);
+    Tox_Err_File_Stream err;
+
+    const uint32_t region_file = tox_file_send(tox, 0, TOX_FILE_KIND_DATA, FILE_SIZE, nullptr, (const uint8_t *)"region", 6, nullptr);
+    ck_assert(region_file != UINT32_MAX);
+    ck_assert(tox_file_set_source_region(tox, 0, region_file, region_source, sizeof(region_source), &err));
+
+    // A transfer has at most one source.
+    ck_assert(!tox_file_set_source_region(tox, 0, region_file, region_source, FILE_SIZE - 1, &err));
+    ck_assert(err == TOX_ERR_FILE_STREAM_BUSY);
+
+    const uint32_t callback_file = tox_file_send(tox, 0, TOX_FILE_KIND_DATA, FILE_SIZE, nullptr, (const uint8_t *)"callback", 8, nullptr);
+    ck_assert(callback_file != UINT32_MAX);
+    ck_assert(!tox_file_set_sink_region(tox, 0, callback_file, region_sink, sizeof(region_sink), &err));
+    ck_assert(err == TOX_ERR_FILE_STREAM_WRONG_DIRECTION);
+    ck_assert(!tox_file_set_source_region(tox, 0, callback_file, region_source, FILE_SIZE - 1, &err));
+    ck_assert(err == TOX_ERR_FILE_STREAM_TOO_SMALL);
+    ck_assert(tox_file_set_source_callback(tox, 0, callback_file, read_source, state, 0, &err));
+
+    WAIT_UNTIL(state->finished == 2);
+    tox_node_log(self, "Sender finished after %u reads", state->reads);
+    // Read-ahead reads many chunks at once.
+    ck_assert(state->reads < FILE_SIZE / (TOX_MAX_CUSTOM_PACKET_SIZE * 16));
+}
+
+typedef struct {
+    uint64_t written;
+    uint32_t finished;
+    uint32_t data_chunks;
+} ReceiverState;
+
+static bool write_sink(void *user_data, uint64_t position, const uint8_t *data, size_t length)
+{
+    ReceiverState *state = (ReceiverState *)user_data;
+
+    if (position != state->written || length > FILE_SIZE - position) {
+        return false;
+    }
+
+    memcpy(callback_sink + position, data, length);
+    state->written += length;
+    return true;
+}
+
+static void on_file_recv(const Tox_Event_File_Recv *event, void *user_data)
+{
+    ToxNode *self = (ToxNode *)user_data;
+    ReceiverState *state = (ReceiverState *)tox_node_get_script_ctx(self);
+    Tox *tox = tox_node_get_tox(self);
+
+    const uint32_t friend_number = tox_event_file_recv_get_friend_number(event);
+    const uint32_t file_number = tox_event_file_recv_get_file_number(event);
+    const uint8_t *filename = tox_event_file_recv_get_filename(event);
+
+    Tox_Err_File_Stream err;
+    bool ok;
+
+    if (tox_event_file_recv_get_filename_length(event) == 6 && memcmp(filename, "region", 6) == 0) {
+        ok = tox_file_set_sink_callback(tox, friend_number, file_number, write_sink, state, 0, &err);
+    } else {
+        ok = tox_file_set_sink_region(tox, friend_number, file_number, region_sink, sizeof(region_sink), &err);
+    }
+
+    if (!ok) {
+        tox_node_log(self, "setting the sink failed: %s", tox_err_file_stream_to_string(err));
+    }
+
+    ck_assert(ok);
+    ck_assert(tox_file_control(tox, friend_number, file_number, TOX_FILE_CONTROL_RESUME, nullptr));
+}
+
+static void on_file_recv_chunk(const Tox_Event_File_Recv_Chunk *event, void *user_data)
+{
+    ToxNode *self = (ToxNode *)user_data;
+    ReceiverState *state = (ReceiverState *)tox_node_get_script_ctx(self);
+
+    if (tox_event_file_recv_chunk_get_data_length(event) == 0) {
+        ++state->finished;
+    } else {
+        ++state->data_chunks;
+    }
+}
+
+static void receiver_script(ToxNode *self, void *ctx)
+{
+    ReceiverState *state = (ReceiverState *)ctx;
+    tox_events_callback_file_recv(tox_node_get_dispatch(self), on_file_recv);
+    tox_events_callback_file_recv_chunk(tox_node_get_dispatch(self), on_file_recv_chunk);
+
+    tox_node_wait_for_self_connected(self);
+    tox_node_wait_for_friend_connected(self, 0);
+
+    WAIT_UNTIL(state->finished == 2);
+
+    ck_assert(state->data_chunks == 0);
+    ck_assert(state->written == FILE_SIZE);
+    ck_assert(memcmp(callback_sink, region_source, FILE_SIZE) == 0);
+    ck_assert(memcmp(region_sink, callback_source, FILE_SIZE) == 0);
+    tox_node_log(self, "Receiver finished!");
+}
+
+int main(int argc, char *argv[])
+{
+    for (uint32_t i = 0; i < FILE_SIZE; ++i) {
+        region_source[i] = (uint8_t)(i * 7);
+        callback_source[i] = (uint8_t)(i * 13 + 1);
+    }
+
+    ToxScenario *s = tox_scenario_new(argc, argv, 60000);
+
+    SenderState sender_state = {0, 0};
+    ReceiverState receiver_state = {0, 0, 0};
+
+    tox_scenario_add_node(s, "Sender", sender_script, &sender_state, sizeof(SenderState));
+    tox_scenario_add_node(s, "Receiver", receiver_script, &receiver_state, sizeof(ReceiverState));
+
+    ToxNode *sender = tox_scenario_get_node(s, 0);
+    ToxNode *receiver = tox_scenario_get_node(s, 1);
+
+    tox_node_bootstrap(sender, receiver);
+    tox_node_friend_add(sender, receiver);
+    tox_node_friend_add(receiver, sender);
+
+    ToxScenarioStatus res = tox_scenario_run(s);
+    if (res != TOX_SCENARIO_DONE) {
+        fprintf(stderr, "Scenario failed with status %u\n", res);
+        return 1;
+    }
+
+    tox_scenario_free(s);
+    return 0;
+}
+
+#undef FILE_SIZE
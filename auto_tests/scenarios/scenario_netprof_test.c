@@ -28,6 +28,24 @@ static void alice_script(ToxNode *self, void *ctx)
 
     ck_assert(udp_sent >= 256);
     ck_assert(udp_recv >= 1);
+
+    Tox_Connection_Stats stats;
+    Tox_Err_Friend_Query err;
+    ck_assert(tox_friend_get_connection_stats(tox, 0, &stats, &err));
+    ck_assert(err == TOX_ERR_FRIEND_QUERY_OK);
+
+    tox_node_log(self, "Bob connection: sent %" PRIu64 " packets (%" PRIu64 " bytes), received %" PRIu64
+                 " packets (%" PRIu64 " bytes), rtt %u ms",
+                 stats.packets_sent, stats.bytes_sent, stats.packets_received, stats.bytes_received, stats.rtt);
+
+    ck_assert(stats.packets_sent >= 256);
+    ck_assert(stats.packets_sent <= udp_sent);
+    ck_assert(stats.bytes_sent > stats.packets_sent);
+    ck_assert(stats.packets_received >= 1);
+    ck_assert(stats.rtt > 0);
+
+    ck_assert(!tox_friend_get_connection_stats(tox, 1, &stats, &err));
+    ck_assert(err == TOX_ERR_FRIEND_QUERY_FRIEND_NOT_FOUND);
 }
 
 static void bob_script(ToxNode *self, void *ctx)
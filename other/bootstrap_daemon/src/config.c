@@ -151,7 +151,8 @@ static int tox_config_lookup_bool(const config_t *config, const char *path, bool
 
 bool get_general_config(const char *cfg_file_path, char **pid_file_path, char **keys_file_path, int *port,
                         bool *enable_ipv6, bool *enable_ipv4_fallback, bool *enable_lan_discovery, bool *enable_tcp_relay,
-                        uint16_t **tcp_relay_ports, int *tcp_relay_port_count, bool *enable_motd, char **motd)
+                        uint16_t **tcp_relay_ports, int *tcp_relay_port_count, bool *enable_motd, char **motd,
+                        int *udp_workers, bool *enable_metrics, int *metrics_port)
 {
     config_t cfg;
 
@@ -164,6 +165,9 @@ bool get_general_config(const char *cfg_file_path, char **pid_file_path, char **
     const char *const NAME_ENABLE_TCP_RELAY     = "enable_tcp_relay";
     const char *const NAME_ENABLE_MOTD          = "enable_motd";
     const char *const NAME_MOTD                 = "motd";
+    const char *const NAME_UDP_WORKERS          = "udp_workers";
+    const char *const NAME_ENABLE_METRICS       = "enable_metrics";
+    const char *const NAME_METRICS_PORT         = "metrics_port";
 
     config_init(&cfg);
 
@@ -278,6 +282,30 @@ bool get_general_config(const char *cfg_file_path, char **pid_file_path, char **
         snprintf(*motd, motd_length, "%s", tmp_motd);
     }
 
+    // Get number of UDP workers
+    if (config_lookup_int(&cfg, NAME_UDP_WORKERS, udp_workers) == CONFIG_FALSE) {
+        LOG_WRITE(LOG_LEVEL_WARNING, "No '%s' setting in configuration file.\n", NAME_UDP_WORKERS);
+        LOG_WRITE(LOG_LEVEL_WARNING, "Using default '%s': %d\n", NAME_UDP_WORKERS, DEFAULT_UDP_WORKERS);
+        *udp_workers = DEFAULT_UDP_WORKERS;
+    }
+
+    // Get metrics option
+    if (tox_config_lookup_bool(&cfg, NAME_ENABLE_METRICS, enable_metrics) == CONFIG_FALSE) {
+        LOG_WRITE(LOG_LEVEL_WARNING, "No '%s' setting in configuration file.\n", NAME_ENABLE_METRICS);
+        LOG_WRITE(LOG_LEVEL_WARNING, "Using default '%s': %s\n", NAME_ENABLE_METRICS,
+                  DEFAULT_ENABLE_METRICS ? "true" : "false");
+        *enable_metrics = DEFAULT_ENABLE_METRICS;
+    }
+
+    if (*enable_metrics) {
+        // Get metrics port
+        if (config_lookup_int(&cfg, NAME_METRICS_PORT, metrics_port) == CONFIG_FALSE) {
+            LOG_WRITE(LOG_LEVEL_WARNING, "No '%s' setting in configuration file.\n", NAME_METRICS_PORT);
+            LOG_WRITE(LOG_LEVEL_WARNING, "Using default '%s': %d\n", NAME_METRICS_PORT, DEFAULT_METRICS_PORT);
+            *metrics_port = DEFAULT_METRICS_PORT;
+        }
+    }
+
     config_destroy(&cfg);
 
     LOG_WRITE(LOG_LEVEL_INFO, "Successfully read:\n");
@@ -309,6 +337,13 @@ bool get_general_config(const char *cfg_file_path, char **pid_file_path, char **
         LOG_WRITE(LOG_LEVEL_INFO, "'%s': %s\n", NAME_MOTD, *motd);
     }
 
+    LOG_WRITE(LOG_LEVEL_INFO, "'%s': %d\n", NAME_UDP_WORKERS,          *udp_workers);
+    LOG_WRITE(LOG_LEVEL_INFO, "'%s': %s\n", NAME_ENABLE_METRICS,       *enable_metrics       ? "true" : "false");
+
+    if (*enable_metrics) {
+        LOG_WRITE(LOG_LEVEL_INFO, "'%s': %d\n", NAME_METRICS_PORT, *metrics_port);
+    }
+
     return true;
 }
 
@@ -19,12 +19,16 @@
  *            also, iff `tcp_relay_ports_count` > 0, then you are responsible for freeing `tcp_relay_ports`
  *            and also `motd` iff `enable_motd` is true.
  *
+ * `udp_workers` is the number of threads reading the UDP port, at least 1.
+ * `metrics_port` is only read iff `enable_metrics` is true.
+ *
  * @return true on success,
  *         false on failure, doesn't modify any data pointed by arguments.
  */
 bool get_general_config(const char *cfg_file_path, char **pid_file_path, char **keys_file_path, int *port,
                         bool *enable_ipv6, bool *enable_ipv4_fallback, bool *enable_lan_discovery, bool *enable_tcp_relay,
-                        uint16_t **tcp_relay_ports, int *tcp_relay_port_count, bool *enable_motd, char **motd);
+                        uint16_t **tcp_relay_ports, int *tcp_relay_port_count, bool *enable_motd, char **motd,
+                        int *udp_workers, bool *enable_metrics, int *metrics_port);
 
 /**
  * Bootstraps off nodes listed in the config file.
@@ -0,0 +1,368 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+/*
+ * Tox DHT bootstrap daemon.
+ * Event-driven main loop, optionally with several UDP worker threads.
+ */
+#include "event_loop.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../../../toxcore/atomics.h"
+#include "../../../toxcore/ccompat.h"
+#include "../../../toxcore/deadlines.h"
+#include "../../../toxcore/ev.h"
+#include "../../../toxcore/os_event.h"
+
+#include "log.h"
+
+/** Longest the main thread sleeps, so that a missed signal is seen eventually. */
+#define EVENT_LOOP_MAX_WAIT 1000
+
+/** How often the workers check whether the loop is stopping. */
+#define WORKER_WAIT 100
+
+/** Packets a worker reads before taking the lock to handle them. */
+#define WORKER_BATCH_SIZE 64
+
+typedef struct Received_Packet {
+    IP_Port source;
+    uint16_t length;
+    uint8_t data[MAX_UDP_PACKET_SIZE];
+} Received_Packet;
+
+typedef struct Udp_Worker {
+    Event_Loop *loop;
+    Socket sock;
+    Ev *ev;
+    Received_Packet *batch;
+    pthread_t thread;
+    bool started;
+} Udp_Worker;
+
+struct Event_Loop {
+    const Memory *mem;
+    const Network *ns;
+    const Logger *logger;
+    Event_Loop_Node node;
+
+    /* Held while anything touches the node. */
+    pthread_mutex_t lock;
+    Tox_Atomic_Bool stopping;
+
+    Ev *ev;
+    /* Tags for the Ev_Result data of the main thread's sockets. */
+    uint8_t udp_tag;
+    uint8_t tcp_tag;
+
+    Udp_Worker *workers;
+    uint32_t num_workers;
+};
+
+static uint64_t current_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void *udp_worker_main(void *arg)
+{
+    Udp_Worker *worker = (Udp_Worker *)arg;
+    Event_Loop *loop = worker->loop;
+    Ev_Result result;
+
+    while (!tox_atomic_bool_load(&loop->stopping)) {
+        if (ev_run(worker->ev, &result, 1, WORKER_WAIT) <= 0) {
+            continue;
+        }
+
+        // Empty the socket in batches, reading without the lock.
+        uint32_t count;
+
+        do {
+            count = 0;
+
+            while (count < WORKER_BATCH_SIZE) {
+                Received_Packet *packet = &worker->batch[count];
+                uint32_t length;
+
+                if (networking_recv(loop->node.net, worker->sock, &packet->source, packet->data, &length) != 0) {
+                    break;
+                }
+
+                packet->length = (uint16_t)length;
+                ++count;
+            }
+
+            if (count == 0) {
+                break;
+            }
+
+            pthread_mutex_lock(&loop->lock);
+            const uint64_t start = current_time_ns();
+            mono_time_update(loop->node.mono_time);
+
+            for (uint32_t i = 0; i < count; ++i) {
+                const Received_Packet *packet = &worker->batch[i];
+                networking_handle_packet(loop->node.net, &packet->source, packet->data, packet->length, nullptr);
+            }
+
+            if (loop->node.metrics != nullptr) {
+                metrics_record_iteration(loop->node.metrics, METRICS_LOOP_UDP_WORKER, current_time_ns() - start);
+            }
+
+            pthread_mutex_unlock(&loop->lock);
+        } while (count == WORKER_BATCH_SIZE);
+    }
+
+    return nullptr;
+}
+
+static void kill_workers(Event_Loop *loop)
+{
+    for (uint32_t i = 0; i < loop->num_workers; ++i) {
+        Udp_Worker *worker = &loop->workers[i];
+
+        ev_kill(worker->ev);
+
+        if (sock_valid(worker->sock)) {
+            kill_sock(loop->ns, worker->sock);
+        }
+
+        free(worker->batch);
+    }
+
+    free(loop->workers);
+    loop->workers = nullptr;
+    loop->num_workers = 0;
+}
+
+static bool init_workers(Event_Loop *loop, uint32_t count)
+{
+    if (count == 0) {
+        return true;
+    }
+
+    loop->workers = (Udp_Worker *)calloc(count, sizeof(Udp_Worker));
+
+    if (loop->workers == nullptr) {
+        return false;
+    }
+
+    loop->num_workers = count;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        loop->workers[i].sock = net_invalid_socket();
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        Udp_Worker *worker = &loop->workers[i];
+        worker->loop = loop;
+        worker->sock = networking_open_reuseport_socket(loop->node.net);
+
+        if (!sock_valid(worker->sock)) {
+            LOG_WRITE(LOG_LEVEL_ERROR, "Couldn't open socket for UDP worker %u.\n", i + 1);
+            return false;
+        }
+
+        worker->ev = os_event_new(loop->mem, loop->logger);
+        worker->batch = (Received_Packet *)calloc(WORKER_BATCH_SIZE, sizeof(Received_Packet));
+
+        if (worker->ev == nullptr || worker->batch == nullptr
+                || !ev_add(worker->ev, worker->sock, EV_READ, worker)) {
+            LOG_WRITE(LOG_LEVEL_ERROR, "Couldn't initialize UDP worker %u.\n", i + 1);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Event_Loop *event_loop_new(const Memory *mem, const Network *ns, const Logger *logger, const Event_Loop_Node *node,
+                           uint32_t udp_workers)
+{
+    if (udp_workers == 0 || udp_workers > MAX_UDP_WORKERS) {
+        LOG_WRITE(LOG_LEVEL_ERROR, "Number of UDP workers must be in [1, %d], got %u.\n", MAX_UDP_WORKERS, udp_workers);
+        return nullptr;
+    }
+
+    Event_Loop *loop = (Event_Loop *)calloc(1, sizeof(Event_Loop));
+
+    if (loop == nullptr) {
+        return nullptr;
+    }
+
+    loop->mem = mem;
+    loop->ns = ns;
+    loop->logger = logger;
+    loop->node = *node;
+    tox_atomic_bool_store(&loop->stopping, false);
+
+    if (pthread_mutex_init(&loop->lock, nullptr) != 0) {
+        free(loop);
+        return nullptr;
+    }
+
+    loop->ev = os_event_new(mem, logger);
+
+    if (loop->ev == nullptr || !ev_add(loop->ev, net_sock(node->net), EV_READ, &loop->udp_tag)) {
+        LOG_WRITE(LOG_LEVEL_ERROR, "Couldn't initialize the event loop.\n");
+        event_loop_kill(loop);
+        return nullptr;
+    }
+
+    if (node->tcp_server != nullptr) {
+        const Socket tcp_sock = tcp_server_event_socket(node->tcp_server);
+
+        // Without one, the TCP relay is polled on its timer only.
+        if (sock_valid(tcp_sock) && !ev_add(loop->ev, tcp_sock, EV_READ, &loop->tcp_tag)) {
+            LOG_WRITE(LOG_LEVEL_WARNING, "Couldn't wait for the TCP relay, polling it instead.\n");
+        }
+    }
+
+    if (!init_workers(loop, udp_workers - 1)) {
+        event_loop_kill(loop);
+        return nullptr;
+    }
+
+    return loop;
+}
+
+static void start_workers(Event_Loop *loop)
+{
+    // Leave signals to the main thread.
+    sigset_t all;
+    sigset_t old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+
+    for (uint32_t i = 0; i < loop->num_workers; ++i) {
+        Udp_Worker *worker = &loop->workers[i];
+        worker->started = pthread_create(&worker->thread, nullptr, udp_worker_main, worker) == 0;
+
+        if (!worker->started) {
+            LOG_WRITE(LOG_LEVEL_WARNING, "Couldn't start UDP worker %u, its share of packets will be lost.\n", i + 1);
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+}
+
+static void join_workers(Event_Loop *loop)
+{
+    tox_atomic_bool_store(&loop->stopping, true);
+
+    for (uint32_t i = 0; i < loop->num_workers; ++i) {
+        Udp_Worker *worker = &loop->workers[i];
+
+        if (worker->started) {
+            pthread_join(worker->thread, nullptr);
+            worker->started = false;
+        }
+    }
+}
+
+void event_loop_run(Event_Loop *loop, const volatile sig_atomic_t *stop)
+{
+    const Event_Loop_Node *node = &loop->node;
+
+    tox_atomic_bool_store(&loop->stopping, false);
+    start_workers(loop);
+
+    uint64_t next_dht = 0;
+    uint64_t next_tcp = 0;
+    uint64_t next_lan_discovery = 0;
+    uint64_t next_metrics = 0;
+    bool tcp_ready = false;
+    bool waiting_for_dht_connection = true;
+
+    Ev_Result results[4];
+
+    while (*stop == 0) {
+        pthread_mutex_lock(&loop->lock);
+
+        const uint64_t start = current_time_ns();
+        mono_time_update(node->mono_time);
+        const uint64_t now = mono_time_get_ms(node->mono_time);
+
+        networking_poll(node->net, nullptr);
+
+        if (node->tcp_server != nullptr && (tcp_ready || now >= next_tcp)) {
+            do_tcp_server(node->tcp_server, node->mono_time);
+            // Pings, timeouts and unsent data have no event to wait for.
+            next_tcp = now + DEADLINE_POLL_INTERVAL;
+        }
+
+        if (now >= next_dht) {
+            do_dht(node->dht);
+            do_gca(node->mono_time, node->group_announce);
+            next_dht = dht_next_deadline(node->dht);
+
+            if (waiting_for_dht_connection && dht_isconnected(node->dht)) {
+                LOG_WRITE(LOG_LEVEL_INFO, "Connected to another bootstrap node successfully.\n");
+                waiting_for_dht_connection = false;
+            }
+        }
+
+        if (node->broadcast != nullptr && now >= next_lan_discovery) {
+            lan_discovery_send(node->net, node->broadcast, dht_get_self_public_key(node->dht), net_port(node->net));
+            next_lan_discovery = now + LAN_DISCOVERY_INTERVAL * 1000;
+        }
+
+        uint64_t deadline = next_dht;
+
+        if (node->tcp_server != nullptr) {
+            deadline = deadline_min(deadline, next_tcp);
+        }
+
+        if (node->broadcast != nullptr) {
+            deadline = deadline_min(deadline, next_lan_discovery);
+        }
+
+        if (node->metrics != nullptr) {
+            metrics_record_iteration(node->metrics, METRICS_LOOP_MAIN, current_time_ns() - start);
+
+            if (now >= next_metrics) {
+                metrics_collect(node->metrics);
+                next_metrics = now + METRICS_COLLECT_INTERVAL;
+            }
+
+            deadline = deadline_min(deadline, next_metrics);
+        }
+
+        pthread_mutex_unlock(&loop->lock);
+
+        const uint64_t wait = deadline > now ? deadline - now : 0;
+        const int32_t n = ev_run(loop->ev, results, sizeof(results) / sizeof(results[0]),
+                                 wait > EVENT_LOOP_MAX_WAIT ? EVENT_LOOP_MAX_WAIT : (int32_t)wait);
+
+        tcp_ready = false;
+
+        for (int32_t i = 0; i < n; ++i) {
+            if (results[i].data == &loop->tcp_tag) {
+                tcp_ready = true;
+            }
+        }
+    }
+
+    join_workers(loop);
+}
+
+void event_loop_kill(Event_Loop *loop)
+{
+    if (loop == nullptr) {
+        return;
+    }
+
+    kill_workers(loop);
+    ev_kill(loop->ev);
+    pthread_mutex_destroy(&loop->lock);
+    free(loop);
+}
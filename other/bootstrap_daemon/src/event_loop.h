@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+/*
+ * Tox DHT bootstrap daemon.
+ * Event-driven main loop, optionally with several UDP worker threads.
+ */
+#ifndef C_TOXCORE_OTHER_BOOTSTRAP_DAEMON_SRC_EVENT_LOOP_H
+#define C_TOXCORE_OTHER_BOOTSTRAP_DAEMON_SRC_EVENT_LOOP_H
+
+#include <signal.h>
+#include <stdint.h>
+
+#include "../../../toxcore/DHT.h"
+#include "../../../toxcore/LAN_discovery.h"
+#include "../../../toxcore/TCP_server.h"
+#include "../../../toxcore/group_announce.h"
+#include "../../../toxcore/logger.h"
+#include "../../../toxcore/mem.h"
+#include "../../../toxcore/mono_time.h"
+#include "../../../toxcore/network.h"
+
+#include "metrics.h"
+
+/** Upper bound on the `udp_workers` config option. */
+#define MAX_UDP_WORKERS 64
+
+/**
+ * The parts of the node that the loop drives.
+ */
+typedef struct Event_Loop_Node {
+    Mono_Time *mono_time;
+    Networking_Core *net;
+    DHT *dht;
+    GC_Announces_List *group_announce;
+    TCP_Server *tcp_server;
+    /** LAN discovery, if enabled. */
+    Broadcast_Info *broadcast;
+    /** Runtime metrics, if enabled. */
+    Metrics *metrics;
+} Event_Loop_Node;
+
+typedef struct Event_Loop Event_Loop;
+
+/**
+ * Creates a loop for `node`.
+ *
+ * The main thread waits for the UDP socket and the TCP relay to become
+ * readable, and wakes up for the DHT, LAN discovery and TCP relay timers, and
+ * to collect metrics.
+ *
+ * With `udp_workers` > 1, `udp_workers - 1` more UDP sockets are bound to the
+ * port of `node->net`, which must have been created with
+ * `new_networking_reuseport`. Each is read by its own thread. The node is
+ * shared by all threads: packets are read without holding a lock, but
+ * handled under one, because toxcore objects aren't thread-safe.
+ *
+ * @return nullptr on failure.
+ */
+Event_Loop *event_loop_new(const Memory *mem, const Network *ns, const Logger *logger, const Event_Loop_Node *node,
+                           uint32_t udp_workers);
+
+/**
+ * Runs the node until `*stop` becomes non-zero.
+ *
+ * Starts the worker threads on entry and joins them before returning. The
+ * workers block all signals, so signals are delivered to the calling thread
+ * and interrupt its wait.
+ */
+void event_loop_run(Event_Loop *loop, const volatile sig_atomic_t *stop);
+
+/** Closes the worker sockets and frees the loop. */
+void event_loop_kill(Event_Loop *loop);
+
+#endif // C_TOXCORE_OTHER_BOOTSTRAP_DAEMON_SRC_EVENT_LOOP_H
@@ -0,0 +1,480 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+/*
+ * Tox DHT bootstrap daemon.
+ * Runtime metrics, served as Prometheus text over HTTP.
+ */
+#include "metrics.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "../../../toxcore/atomics.h"
+#include "../../../toxcore/attributes.h"
+#include "../../../toxcore/ccompat.h"
+#include "../../../toxcore/net_profile.h"
+
+#include "log.h"
+
+/** How often the HTTP thread checks whether it should stop, in milliseconds. */
+#define METRICS_ACCEPT_WAIT 250
+
+/** Longest a scraper may take to send its request or read the reply, in seconds. */
+#define METRICS_CLIENT_TIMEOUT 2
+
+#define METRICS_MAX_REQUEST_SIZE 1024
+
+/* Upper bounds of the iteration time buckets, in nanoseconds and as printed. */
+static const uint64_t bucket_bounds_ns[] = {
+    10000, 50000, 100000, 500000, 1000000, 5000000, 10000000, 50000000, 100000000,
+};
+static const char *const bucket_labels[] = {
+    "1e-05", "5e-05", "0.0001", "0.0005", "0.001", "0.005", "0.01", "0.05", "0.1",
+};
+
+#define NUM_BUCKETS (sizeof(bucket_bounds_ns) / sizeof(bucket_bounds_ns[0]))
+#define NUM_LOOPS 2
+
+static const char *const loop_labels[NUM_LOOPS] = {"main", "udp_worker"};
+
+typedef struct Iteration_Histogram {
+    /* Not cumulative; the last bucket is +Inf. */
+    uint64_t buckets[NUM_BUCKETS + 1];
+    uint64_t count;
+    uint64_t sum_ns;
+} Iteration_Histogram;
+
+typedef struct Profile_Snapshot {
+    /* Indexed by Packet_Direction, then packet id. */
+    uint64_t packets[2][NET_PROF_MAX_PACKET_IDS];
+    uint64_t bytes[2][NET_PROF_MAX_PACKET_IDS];
+} Profile_Snapshot;
+
+typedef struct Metrics_Snapshot {
+    Profile_Snapshot udp;
+    Profile_Snapshot tcp;
+    bool has_tcp;
+
+    uint16_t dht_close_nodes;
+    uint16_t dht_close_announce_capable;
+    uint16_t dht_friends;
+    uint32_t onion_announce_entries;
+    uint32_t tcp_connections;
+    uint64_t tcp_accepted;
+
+    Iteration_Histogram iterations[NUM_LOOPS];
+} Metrics_Snapshot;
+
+struct Metrics {
+    Metrics_Sources sources;
+
+    /* Updated with the node locked. */
+    Iteration_Histogram iterations[NUM_LOOPS];
+
+    /* Written by metrics_collect, read by the HTTP thread. */
+    pthread_mutex_t lock;
+    Metrics_Snapshot snapshot;
+
+    /* The HTTP thread's copy of the snapshot, so it formats without the lock. */
+    Metrics_Snapshot served;
+
+    int listen_fd;
+    pthread_t thread;
+    bool started;
+    Tox_Atomic_Bool stopping;
+};
+
+void metrics_record_iteration(Metrics *metrics, Metrics_Loop loop, uint64_t duration_ns)
+{
+    Iteration_Histogram *histogram = &metrics->iterations[loop];
+    size_t bucket = 0;
+
+    while (bucket < NUM_BUCKETS && duration_ns > bucket_bounds_ns[bucket]) {
+        ++bucket;
+    }
+
+    ++histogram->buckets[bucket];
+    ++histogram->count;
+    histogram->sum_ns += duration_ns;
+}
+
+static void collect_profile(Profile_Snapshot *snapshot, const Net_Profile *profile)
+{
+    const Packet_Direction directions[] = {PACKET_DIRECTION_SEND, PACKET_DIRECTION_RECV};
+
+    for (size_t d = 0; d < 2; ++d) {
+        for (uint32_t id = 0; id < NET_PROF_MAX_PACKET_IDS; ++id) {
+            snapshot->packets[d][id] = netprof_get_packet_count_id(profile, (uint8_t)id, directions[d]);
+            snapshot->bytes[d][id] = netprof_get_bytes_id(profile, (uint8_t)id, directions[d]);
+        }
+    }
+}
+
+void metrics_collect(Metrics *metrics)
+{
+    const Metrics_Sources *sources = &metrics->sources;
+
+    pthread_mutex_lock(&metrics->lock);
+
+    Metrics_Snapshot *snapshot = &metrics->snapshot;
+    collect_profile(&snapshot->udp, net_get_net_profile(sources->net));
+
+    snapshot->has_tcp = sources->tcp_server != nullptr;
+
+    if (snapshot->has_tcp) {
+        collect_profile(&snapshot->tcp, tcp_server_get_net_profile(sources->tcp_server));
+        snapshot->tcp_connections = tcp_server_num_connections(sources->tcp_server);
+        snapshot->tcp_accepted = tcp_server_accepted_count(sources->tcp_server);
+    }
+
+    snapshot->dht_close_nodes = dht_get_num_closelist(sources->dht);
+    snapshot->dht_close_announce_capable = dht_get_num_closelist_announce_capable(sources->dht);
+    snapshot->dht_friends = dht_get_num_friends(sources->dht);
+    snapshot->onion_announce_entries = onion_announce_num_entries(sources->onion_announce);
+
+    memcpy(snapshot->iterations, metrics->iterations, sizeof(snapshot->iterations));
+
+    pthread_mutex_unlock(&metrics->lock);
+}
+
+/**
+ * A growing text buffer. Once an allocation fails, further writes are
+ * dropped and `failed` is set.
+ */
+typedef struct Text {
+    char *data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} Text;
+
+static void text_printf(Text *text, const char *format, ...) GNU_PRINTF(2, 3);
+static void text_printf(Text *text, const char *format, ...)
+{
+    if (text->failed) {
+        return;
+    }
+
+    while (true) {
+        va_list args;
+        va_start(args, format);
+        const int written = vsnprintf(text->data + text->length, text->capacity - text->length, format, args);
+        va_end(args);
+
+        if (written < 0) {
+            text->failed = true;
+            return;
+        }
+
+        if ((size_t)written < text->capacity - text->length) {
+            text->length += (size_t)written;
+            return;
+        }
+
+        const size_t new_capacity = (text->capacity + (size_t)written + 1) * 2;
+        char *new_data = (char *)realloc(text->data, new_capacity);
+
+        if (new_data == nullptr) {
+            text->failed = true;
+            return;
+        }
+
+        text->data = new_data;
+        text->capacity = new_capacity;
+    }
+}
+
+static void format_profile(Text *text, const char *transport, const char *transport_name,
+                           const Profile_Snapshot *profile)
+{
+    const char *const direction_labels[] = {"send", "recv"};
+
+    text_printf(text, "# HELP tox_bootstrapd_%s_packets_total %s packets by packet id.\n", transport, transport_name);
+    text_printf(text, "# TYPE tox_bootstrapd_%s_packets_total counter\n", transport);
+
+    for (size_t d = 0; d < 2; ++d) {
+        for (uint32_t id = 0; id < NET_PROF_MAX_PACKET_IDS; ++id) {
+            if (profile->packets[d][id] != 0) {
+                text_printf(text, "tox_bootstrapd_%s_packets_total{direction=\"%s\",id=\"0x%02x\"} %llu\n",
+                            transport, direction_labels[d], id, (unsigned long long)profile->packets[d][id]);
+            }
+        }
+    }
+
+    text_printf(text, "# HELP tox_bootstrapd_%s_bytes_total %s bytes by packet id.\n", transport, transport_name);
+    text_printf(text, "# TYPE tox_bootstrapd_%s_bytes_total counter\n", transport);
+
+    for (size_t d = 0; d < 2; ++d) {
+        for (uint32_t id = 0; id < NET_PROF_MAX_PACKET_IDS; ++id) {
+            if (profile->packets[d][id] != 0) {
+                text_printf(text, "tox_bootstrapd_%s_bytes_total{direction=\"%s\",id=\"0x%02x\"} %llu\n",
+                            transport, direction_labels[d], id, (unsigned long long)profile->bytes[d][id]);
+            }
+        }
+    }
+}
+
+static void format_gauge(Text *text, const char *name, const char *help, unsigned long long value)
+{
+    text_printf(text, "# HELP tox_bootstrapd_%s %s\n", name, help);
+    text_printf(text, "# TYPE tox_bootstrapd_%s gauge\n", name);
+    text_printf(text, "tox_bootstrapd_%s %llu\n", name, value);
+}
+
+static void format_histograms(Text *text, const Iteration_Histogram *histograms)
+{
+    text_printf(text, "# HELP tox_bootstrapd_loop_iteration_seconds Time a loop iteration spent working.\n");
+    text_printf(text, "# TYPE tox_bootstrapd_loop_iteration_seconds histogram\n");
+
+    for (size_t l = 0; l < NUM_LOOPS; ++l) {
+        const Iteration_Histogram *histogram = &histograms[l];
+        uint64_t cumulative = 0;
+
+        for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+            cumulative += histogram->buckets[b];
+            text_printf(text, "tox_bootstrapd_loop_iteration_seconds_bucket{loop=\"%s\",le=\"%s\"} %llu\n",
+                        loop_labels[l], bucket_labels[b], (unsigned long long)cumulative);
+        }
+
+        text_printf(text, "tox_bootstrapd_loop_iteration_seconds_bucket{loop=\"%s\",le=\"+Inf\"} %llu\n",
+                    loop_labels[l], (unsigned long long)histogram->count);
+        text_printf(text, "tox_bootstrapd_loop_iteration_seconds_sum{loop=\"%s\"} %.9f\n",
+                    loop_labels[l], (double)histogram->sum_ns / 1e9);
+        text_printf(text, "tox_bootstrapd_loop_iteration_seconds_count{loop=\"%s\"} %llu\n",
+                    loop_labels[l], (unsigned long long)histogram->count);
+    }
+}
+
+static void format_metrics(Text *text, const Metrics_Snapshot *snapshot)
+{
+    format_profile(text, "udp", "UDP", &snapshot->udp);
+
+    format_gauge(text, "dht_close_nodes", "Nodes in the DHT close list.", snapshot->dht_close_nodes);
+    format_gauge(text, "dht_close_capacity", "Size of the DHT close list.", LCLIENT_LIST);
+    format_gauge(text, "dht_close_announce_capable_nodes", "Close list nodes that can store announcements.",
+                 snapshot->dht_close_announce_capable);
+    format_gauge(text, "dht_friends", "Public keys the DHT searches for.", snapshot->dht_friends);
+    format_gauge(text, "onion_announce_entries", "Onion announcements that haven't timed out.",
+                 snapshot->onion_announce_entries);
+    format_gauge(text, "onion_announce_capacity", "Size of the onion announce table.", ONION_ANNOUNCE_MAX_ENTRIES);
+
+    if (snapshot->has_tcp) {
+        format_profile(text, "tcp", "TCP relay", &snapshot->tcp);
+        format_gauge(text, "tcp_connections", "Connected TCP relay clients.", snapshot->tcp_connections);
+
+        text_printf(text, "# HELP tox_bootstrapd_tcp_accepted_total TCP relay clients that completed the handshake.\n");
+        text_printf(text, "# TYPE tox_bootstrapd_tcp_accepted_total counter\n");
+        text_printf(text, "tox_bootstrapd_tcp_accepted_total %llu\n", (unsigned long long)snapshot->tcp_accepted);
+    }
+
+    format_histograms(text, snapshot->iterations);
+}
+
+static bool send_all(int fd, const char *data, size_t length)
+{
+    while (length > 0) {
+        const ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+
+        if (sent <= 0) {
+            return false;
+        }
+
+        data += sent;
+        length -= (size_t)sent;
+    }
+
+    return true;
+}
+
+static void send_response(int fd, const char *status, const char *content_type, const char *body, size_t body_length)
+{
+    char header[256];
+    const int header_length = snprintf(header, sizeof(header),
+                                       "HTTP/1.0 %s\r\n"
+                                       "Content-Type: %s\r\n"
+                                       "Content-Length: %zu\r\n"
+                                       "Connection: close\r\n"
+                                       "\r\n",
+                                       status, content_type, body_length);
+
+    if (header_length < 0 || (size_t)header_length >= sizeof(header)) {
+        return;
+    }
+
+    if (send_all(fd, header, (size_t)header_length)) {
+        send_all(fd, body, body_length);
+    }
+}
+
+static void serve_client(Metrics *metrics, int fd)
+{
+    const struct timeval timeout = {METRICS_CLIENT_TIMEOUT, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    char request[METRICS_MAX_REQUEST_SIZE];
+    size_t length = 0;
+
+    // Only the request line matters, but read the headers so the client
+    // doesn't see a reset.
+    while (length < sizeof(request) - 1) {
+        const ssize_t received = recv(fd, request + length, sizeof(request) - 1 - length, 0);
+
+        if (received <= 0) {
+            break;
+        }
+
+        length += (size_t)received;
+        request[length] = '\0';
+
+        if (strstr(request, "\r\n\r\n") != nullptr) {
+            break;
+        }
+    }
+
+    request[length] = '\0';
+
+    const char metrics_request[] = "GET /metrics ";
+
+    if (strncmp(request, metrics_request, sizeof(metrics_request) - 1) != 0) {
+        const char body[] = "Not found; metrics are at /metrics.\n";
+        send_response(fd, "404 Not Found", "text/plain; charset=utf-8", body, sizeof(body) - 1);
+        return;
+    }
+
+    pthread_mutex_lock(&metrics->lock);
+    metrics->served = metrics->snapshot;
+    pthread_mutex_unlock(&metrics->lock);
+
+    Text text = {nullptr, 0, 0, false};
+    format_metrics(&text, &metrics->served);
+
+    if (text.failed) {
+        const char body[] = "Out of memory.\n";
+        send_response(fd, "500 Internal Server Error", "text/plain; charset=utf-8", body, sizeof(body) - 1);
+    } else {
+        send_response(fd, "200 OK", "text/plain; version=0.0.4; charset=utf-8", text.data, text.length);
+    }
+
+    free(text.data);
+}
+
+static void *metrics_main(void *arg)
+{
+    Metrics *metrics = (Metrics *)arg;
+    struct pollfd listener = {metrics->listen_fd, POLLIN, 0};
+
+    while (!tox_atomic_bool_load(&metrics->stopping)) {
+        if (poll(&listener, 1, METRICS_ACCEPT_WAIT) <= 0) {
+            continue;
+        }
+
+        const int fd = accept(metrics->listen_fd, nullptr, nullptr);
+
+        if (fd < 0) {
+            continue;
+        }
+
+        serve_client(metrics, fd);
+        close(fd);
+    }
+
+    return nullptr;
+}
+
+static int open_listener(uint16_t port)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    const int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(fd, (const struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+Metrics *metrics_new(const Metrics_Sources *sources, uint16_t port)
+{
+    Metrics *metrics = (Metrics *)calloc(1, sizeof(Metrics));
+
+    if (metrics == nullptr) {
+        return nullptr;
+    }
+
+    metrics->sources = *sources;
+    tox_atomic_bool_store(&metrics->stopping, false);
+
+    if (pthread_mutex_init(&metrics->lock, nullptr) != 0) {
+        free(metrics);
+        return nullptr;
+    }
+
+    metrics->listen_fd = open_listener(port);
+
+    if (metrics->listen_fd < 0) {
+        LOG_WRITE(LOG_LEVEL_ERROR, "Couldn't listen for metrics requests on 127.0.0.1:%u.\n", port);
+        pthread_mutex_destroy(&metrics->lock);
+        free(metrics);
+        return nullptr;
+    }
+
+    // Leave signals to the main thread.
+    sigset_t all;
+    sigset_t old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    metrics->started = pthread_create(&metrics->thread, nullptr, metrics_main, metrics) == 0;
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+
+    if (!metrics->started) {
+        LOG_WRITE(LOG_LEVEL_ERROR, "Couldn't start the metrics thread.\n");
+        metrics_kill(metrics);
+        return nullptr;
+    }
+
+    return metrics;
+}
+
+void metrics_kill(Metrics *metrics)
+{
+    if (metrics == nullptr) {
+        return;
+    }
+
+    tox_atomic_bool_store(&metrics->stopping, true);
+
+    if (metrics->started) {
+        pthread_join(metrics->thread, nullptr);
+    }
+
+    close(metrics->listen_fd);
+    pthread_mutex_destroy(&metrics->lock);
+    free(metrics);
+}
@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+/*
+ * Tox DHT bootstrap daemon.
+ * Runtime metrics, served as Prometheus text over HTTP.
+ */
+#ifndef C_TOXCORE_OTHER_BOOTSTRAP_DAEMON_SRC_METRICS_H
+#define C_TOXCORE_OTHER_BOOTSTRAP_DAEMON_SRC_METRICS_H
+
+#include <stdint.h>
+
+#include "../../../toxcore/DHT.h"
+#include "../../../toxcore/TCP_server.h"
+#include "../../../toxcore/network.h"
+#include "../../../toxcore/onion_announce.h"
+
+/** How often the event loop copies the node's counters for the HTTP thread, in milliseconds. */
+#define METRICS_COLLECT_INTERVAL 1000
+
+/**
+ * Which loop an iteration time is recorded for.
+ */
+typedef enum Metrics_Loop {
+    METRICS_LOOP_MAIN,
+    METRICS_LOOP_UDP_WORKER,
+} Metrics_Loop;
+
+/**
+ * The parts of the node that metrics are read from.
+ */
+typedef struct Metrics_Sources {
+    const Networking_Core *net;
+    const DHT *dht;
+    const Onion_Announce *onion_announce;
+    /** The TCP relay, if enabled. */
+    const TCP_Server *tcp_server;
+} Metrics_Sources;
+
+typedef struct Metrics Metrics;
+
+/**
+ * Starts serving metrics on `127.0.0.1:port` from a thread of its own.
+ *
+ * `GET /metrics` returns the counters as of the last `metrics_collect`. The
+ * HTTP thread never touches the node, so a slow scraper can't stall the loop.
+ *
+ * @return nullptr on failure.
+ */
+Metrics *metrics_new(const Metrics_Sources *sources, uint16_t port);
+
+/**
+ * Records how long one loop iteration spent working, not waiting.
+ *
+ * Must be called with the node locked.
+ */
+void metrics_record_iteration(Metrics *metrics, Metrics_Loop loop, uint64_t duration_ns);
+
+/**
+ * Copies the node's counters and the iteration times for the HTTP thread.
+ *
+ * Must be called with the node locked.
+ */
+void metrics_collect(Metrics *metrics);
+
+/** Stops the HTTP thread and frees `metrics`. */
+void metrics_kill(Metrics *metrics);
+
+#endif // C_TOXCORE_OTHER_BOOTSTRAP_DAEMON_SRC_METRICS_H
@@ -23,7 +23,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
 // toxcore
 #include "../../../toxcore/DHT.h"
@@ -48,16 +47,10 @@
 
 #include "command_line_arguments.h"
 #include "config.h"
+#include "event_loop.h"
 #include "global.h"
 #include "log.h"
-
-static void sleep_milliseconds(uint32_t ms)
-{
-    struct timespec req;
-    req.tv_sec = ms / 1000;
-    req.tv_nsec = (long)ms % 1000 * 1000 * 1000;
-    nanosleep(&req, nullptr);
-}
+#include "metrics.h"
 
 // Uses the already existing key or creates one if it didn't exist
 //
@@ -213,6 +206,18 @@ static void toxcore_logger_callback(void *context, Logger_Level level, const cha
     log_write(logger_level_to_log_level(level), category, file, line, "%s\n", message);
 }
 
+// Creates the UDP networking, letting worker sockets share its port if there are any.
+
+static Networking_Core *new_daemon_networking(const Logger *logger, const Memory *mem, const Network *ns, const IP *ip,
+        uint16_t port_from, uint16_t port_to, bool reuse_port)
+{
+    if (reuse_port) {
+        return new_networking_reuseport(logger, mem, ns, ip, port_from, port_to, nullptr);
+    }
+
+    return new_networking_ex(logger, mem, ns, ip, port_from, port_to, nullptr);
+}
+
 static volatile sig_atomic_t caught_signal = 0;
 
 static void handle_signal(int signum)
@@ -255,9 +260,13 @@ int main(int argc, char *argv[])
     int tcp_relay_port_count = 0;
     bool enable_motd = false;
     char *motd = nullptr;
+    int udp_workers = 1;
+    bool enable_metrics = false;
+    int metrics_port = 0;
 
     if (get_general_config(cfg_file_path, &pid_file_path, &keys_file_path, &start_port, &enable_ipv6, &enable_ipv4_fallback,
-                           &enable_lan_discovery, &enable_tcp_relay, &tcp_relay_ports, &tcp_relay_port_count, &enable_motd, &motd)) {
+                           &enable_lan_discovery, &enable_tcp_relay, &tcp_relay_ports, &tcp_relay_port_count, &enable_motd, &motd,
+                           &udp_workers, &enable_metrics, &metrics_port)) {
         LOG_WRITE(LOG_LEVEL_INFO, "General config read successfully\n");
     } else {
         LOG_WRITE(LOG_LEVEL_ERROR, "Couldn't read config file: %s. Exiting.\n", cfg_file_path);
@@ -274,6 +283,26 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    if (udp_workers < 1 || udp_workers > MAX_UDP_WORKERS) {
+        LOG_WRITE(LOG_LEVEL_ERROR, "Invalid number of UDP workers: %d, should be in [1, %d]. Exiting.\n", udp_workers,
+                  MAX_UDP_WORKERS);
+        free(motd);
+        free(tcp_relay_ports);
+        free(keys_file_path);
+        free(pid_file_path);
+        return 1;
+    }
+
+    if (enable_metrics && (metrics_port < MIN_ALLOWED_PORT || metrics_port > MAX_ALLOWED_PORT)) {
+        LOG_WRITE(LOG_LEVEL_ERROR, "Invalid metrics port: %d, should be in [%d, %d]. Exiting.\n", metrics_port,
+                  MIN_ALLOWED_PORT, MAX_ALLOWED_PORT);
+        free(motd);
+        free(tcp_relay_ports);
+        free(keys_file_path);
+        free(pid_file_path);
+        return 1;
+    }
+
     if (!run_in_foreground) {
         switch (daemonize(log_backend, pid_file_path)) {
             case CLI_STATUS_OK:
@@ -299,14 +328,14 @@ int main(int argc, char *argv[])
     logger_callback_log(logger, toxcore_logger_callback, nullptr, nullptr);
 
     const uint16_t end_port = start_port + (TOX_PORTRANGE_TO - TOX_PORTRANGE_FROM);
-    Networking_Core *net = new_networking_ex(logger, mem, ns, &ip, start_port, end_port, nullptr);
+    Networking_Core *net = new_daemon_networking(logger, mem, ns, &ip, start_port, end_port, udp_workers > 1);
 
     if (net == nullptr) {
         if (enable_ipv6 && enable_ipv4_fallback) {
             LOG_WRITE(LOG_LEVEL_WARNING, "Couldn't initialize IPv6 networking. Falling back to using IPv4.\n");
             enable_ipv6 = false;
             ip_init(&ip, enable_ipv6);
-            net = new_networking_ex(logger, mem, ns, &ip, start_port, end_port, nullptr);
+            net = new_daemon_networking(logger, mem, ns, &ip, start_port, end_port, udp_workers > 1);
 
             if (net == nullptr) {
                 LOG_WRITE(LOG_LEVEL_ERROR, "Couldn't fallback to IPv4. Exiting.\n");
@@ -560,11 +589,6 @@ int main(int argc, char *argv[])
 
     print_public_key(dht_get_self_public_key(dht));
 
-    uint64_t last_lan_discovery = 0;
-    const uint16_t net_htons_port = net_htons(start_port);
-
-    bool waiting_for_dht_connection = true;
-
     Broadcast_Info *broadcast = nullptr;
 
     if (enable_lan_discovery) {
@@ -572,6 +596,55 @@ int main(int argc, char *argv[])
         LOG_WRITE(LOG_LEVEL_INFO, "Initialized LAN discovery successfully.\n");
     }
 
+    Metrics *metrics = nullptr;
+
+    if (enable_metrics) {
+        const Metrics_Sources sources = {net, dht, onion_a, tcp_server};
+        metrics = metrics_new(&sources, (uint16_t)metrics_port);
+
+        if (metrics == nullptr) {
+            LOG_WRITE(LOG_LEVEL_ERROR, "Couldn't initialize metrics. Exiting.\n");
+            lan_discovery_kill(broadcast);
+            kill_tcp_server(tcp_server);
+            kill_onion_announce(onion_a);
+            kill_gca(group_announce);
+            kill_onion(onion);
+            kill_announcements(announce);
+            kill_forwarding(forwarding);
+            kill_dht(dht);
+            mono_time_free(mem, mono_time);
+            kill_networking(net);
+            logger_kill(logger);
+            return 1;
+        }
+
+        LOG_WRITE(LOG_LEVEL_INFO, "Serving metrics on 127.0.0.1:%d.\n", metrics_port);
+    }
+
+    const Event_Loop_Node node = {
+        mono_time, net, dht, group_announce, tcp_server, broadcast, metrics,
+    };
+    Event_Loop *loop = event_loop_new(mem, ns, logger, &node, (uint32_t)udp_workers);
+
+    if (loop == nullptr) {
+        LOG_WRITE(LOG_LEVEL_ERROR, "Couldn't initialize the event loop. Exiting.\n");
+        metrics_kill(metrics);
+        lan_discovery_kill(broadcast);
+        kill_tcp_server(tcp_server);
+        kill_onion_announce(onion_a);
+        kill_gca(group_announce);
+        kill_onion(onion);
+        kill_announcements(announce);
+        kill_forwarding(forwarding);
+        kill_dht(dht);
+        mono_time_free(mem, mono_time);
+        kill_networking(net);
+        logger_kill(logger);
+        return 1;
+    }
+
+    LOG_WRITE(LOG_LEVEL_INFO, "Running with %d UDP worker(s).\n", udp_workers);
+
     struct sigaction sa;
 
     sa.sa_handler = handle_signal;
@@ -590,31 +663,7 @@ int main(int argc, char *argv[])
         LOG_WRITE(LOG_LEVEL_WARNING, "Couldn't set signal handler for SIGTERM. Continuing without the signal handler set.\n");
     }
 
-    while (caught_signal == 0) {
-        mono_time_update(mono_time);
-
-        do_dht(dht);
-
-        if (enable_lan_discovery && mono_time_is_timeout(mono_time, last_lan_discovery, LAN_DISCOVERY_INTERVAL)) {
-            lan_discovery_send(net, broadcast, dht_get_self_public_key(dht), net_htons_port);
-            last_lan_discovery = mono_time_get(mono_time);
-        }
-
-        do_gca(mono_time, group_announce);
-
-        if (enable_tcp_relay) {
-            do_tcp_server(tcp_server, mono_time);
-        }
-
-        networking_poll(net, nullptr);
-
-        if (waiting_for_dht_connection && dht_isconnected(dht)) {
-            LOG_WRITE(LOG_LEVEL_INFO, "Connected to another bootstrap node successfully.\n");
-            waiting_for_dht_connection = false;
-        }
-
-        sleep_milliseconds(30);
-    }
+    event_loop_run(loop, &caught_signal);
 
     switch (caught_signal) {
         case SIGINT:
@@ -629,6 +678,8 @@ int main(int argc, char *argv[])
             LOG_WRITE(LOG_LEVEL_INFO, "Received (%ld) signal. Exiting.\n", (long)caught_signal);
     }
 
+    event_loop_kill(loop);
+    metrics_kill(metrics);
     lan_discovery_kill(broadcast);
     kill_tcp_server(tcp_server);
     kill_onion_announce(onion_a);
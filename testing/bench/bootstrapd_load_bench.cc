@@ -0,0 +1,276 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// Request latency and throughput of a bootstrap node on loopback, driven by
+// the old fixed-sleep loop of tox-bootstrapd and by its event loop.
+//
+// The clients send bootstrap info requests, which are answered without any
+// DHT crypto, so the numbers are dominated by how quickly the loop notices
+// and reads a packet rather than by packet handling.
+//
+// Arguments:
+// - loop: 0 for the old loop (poll, then sleep 30 ms), 1 for the event loop.
+// - workers: UDP sockets and threads used by the event loop.
+// - clients: requests in flight, one per client socket.
+//
+// Reported counters:
+// - p50_latency_us, p99_latency_us: time from sending a request to reading
+//   its reply.
+// - requests_per_s: replies read per second.
+
+#include <benchmark/benchmark.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "../../toxcore/DHT.h"
+#include "../../toxcore/logger.h"
+#include "../../toxcore/mono_time.h"
+#include "../../toxcore/network.h"
+#include "../../toxcore/os_memory.h"
+#include "../../toxcore/os_network.h"
+#include "../../toxcore/os_random.h"
+
+extern "C" {
+#include "../../other/bootstrap_daemon/src/event_loop.h"
+#include "../../other/bootstrap_node_packets.h"
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::uint8_t kInfoRequestId = 240;
+constexpr std::size_t kInfoRequestSize = 78;
+constexpr auto kWindow = std::chrono::seconds(1);
+constexpr auto kLegacySleep = std::chrono::milliseconds(30);
+constexpr int kReplyTimeoutMs = 1000;
+
+enum class Loop { kLegacy = 0, kEvent = 1 };
+
+/** A bootstrap node answering info requests, run on its own thread. */
+class Node {
+public:
+    Node(Loop loop, std::uint32_t workers)
+        : loop_kind_(loop)
+    {
+        const Memory *mem = os_memory();
+        const Network *ns = os_network();
+        const Random *rng = os_random();
+
+        logger_ = logger_new(mem);
+        mono_time_ = mono_time_new(mem, nullptr, nullptr);
+        if (logger_ == nullptr || mono_time_ == nullptr || ns == nullptr || rng == nullptr) {
+            return;
+        }
+
+        IP ip;
+        ip_init(&ip, false);
+        net_ = workers > 1 ? new_networking_reuseport(logger_, mem, ns, &ip, 0, 0, nullptr)
+                           : new_networking_ex(logger_, mem, ns, &ip, 0, 0, nullptr);
+        if (net_ == nullptr) {
+            return;
+        }
+
+        dht_ = new_dht(logger_, mem, rng, ns, mono_time_, net_, true, false);
+        const std::uint8_t motd[] = "bench";
+        if (dht_ == nullptr || bootstrap_set_callbacks(net_, 1, motd, sizeof(motd)) != 0) {
+            return;
+        }
+
+        if (loop == Loop::kEvent) {
+            const Event_Loop_Node node = {mono_time_, net_, dht_, nullptr, nullptr, nullptr, nullptr};
+            event_loop_ = event_loop_new(mem, ns, logger_, &node, workers);
+            if (event_loop_ == nullptr) {
+                return;
+            }
+        }
+
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~Node()
+    {
+        stop_ = 1;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+
+        event_loop_kill(event_loop_);
+        kill_dht(dht_);
+        kill_networking(net_);
+        mono_time_free(os_memory(), mono_time_);
+        logger_kill(logger_);
+    }
+
+    Node(const Node &) = delete;
+    Node &operator=(const Node &) = delete;
+
+    bool running() const { return thread_.joinable(); }
+
+    /** @brief The port in host byte order. */
+    std::uint16_t port() const { return ntohs(net_port(net_)); }
+
+private:
+    void run()
+    {
+        if (loop_kind_ == Loop::kEvent) {
+            event_loop_run(event_loop_, &stop_);
+            return;
+        }
+
+        while (stop_ == 0) {
+            mono_time_update(mono_time_);
+            do_dht(dht_);
+            networking_poll(net_, nullptr);
+            std::this_thread::sleep_for(kLegacySleep);
+        }
+    }
+
+    Loop loop_kind_;
+    Logger *logger_ = nullptr;
+    Mono_Time *mono_time_ = nullptr;
+    Networking_Core *net_ = nullptr;
+    DHT *dht_ = nullptr;
+    Event_Loop *event_loop_ = nullptr;
+    volatile std::sig_atomic_t stop_ = 0;
+    std::thread thread_;
+};
+
+struct Client {
+    int fd = -1;
+    Clock::time_point sent;
+};
+
+bool send_request(Client &client, const sockaddr_in &addr)
+{
+    std::uint8_t request[kInfoRequestSize] = {kInfoRequestId};
+    client.sent = Clock::now();
+    return sendto(client.fd, request, sizeof(request), 0, reinterpret_cast<const sockaddr *>(&addr),
+               sizeof(addr))
+        == static_cast<ssize_t>(sizeof(request));
+}
+
+void BM_BootstrapdLoad(benchmark::State &state)
+{
+    const auto loop = static_cast<Loop>(state.range(0));
+    const auto workers = static_cast<std::uint32_t>(state.range(1));
+    const auto num_clients = static_cast<std::size_t>(state.range(2));
+
+    Node node{loop, workers};
+    if (!node.running()) {
+        state.SkipWithError("failed to start the bootstrap node");
+        return;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(node.port());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    std::vector<Client> clients(num_clients);
+    std::vector<pollfd> fds(num_clients);
+    for (std::size_t i = 0; i < num_clients; ++i) {
+        clients[i].fd = socket(AF_INET, SOCK_DGRAM, 0);
+        fds[i] = {clients[i].fd, POLLIN, 0};
+    }
+
+    std::vector<double> latencies_us;
+    std::uint64_t replies = 0;
+    Clock::duration elapsed{};
+    bool ok = true;
+
+    for (auto _ : state) {
+        const auto start = Clock::now();
+        for (Client &client : clients) {
+            ok = ok && client.fd >= 0 && send_request(client, addr);
+        }
+
+        while (ok && Clock::now() - start < kWindow) {
+            const int ready = poll(fds.data(), fds.size(), kReplyTimeoutMs);
+            if (ready <= 0) {
+                ok = false;
+                break;
+            }
+
+            for (std::size_t i = 0; i < num_clients; ++i) {
+                if ((fds[i].revents & POLLIN) == 0) {
+                    continue;
+                }
+
+                std::uint8_t reply[MAX_UDP_PACKET_SIZE];
+                if (recv(clients[i].fd, reply, sizeof(reply), 0) <= 0) {
+                    continue;
+                }
+
+                const auto now = Clock::now();
+                latencies_us.push_back(
+                    std::chrono::duration<double, std::micro>(now - clients[i].sent).count());
+                ++replies;
+                ok = send_request(clients[i], addr);
+            }
+        }
+
+        // Drain the replies still in flight, so the next window starts clean.
+        while (ok && poll(fds.data(), fds.size(), 100) > 0) {
+            for (std::size_t i = 0; i < num_clients; ++i) {
+                std::uint8_t reply[MAX_UDP_PACKET_SIZE];
+                if ((fds[i].revents & POLLIN) != 0) {
+                    recv(clients[i].fd, reply, sizeof(reply), 0);
+                }
+            }
+        }
+
+        elapsed += Clock::now() - start;
+    }
+
+    for (const Client &client : clients) {
+        if (client.fd >= 0) {
+            close(client.fd);
+        }
+    }
+
+    if (!ok || latencies_us.empty()) {
+        state.SkipWithError("requests went unanswered");
+        return;
+    }
+
+    std::sort(latencies_us.begin(), latencies_us.end());
+    const auto percentile = [&](double p) {
+        return latencies_us[static_cast<std::size_t>(p * static_cast<double>(latencies_us.size() - 1))];
+    };
+
+    state.counters["p50_latency_us"] = percentile(0.50);
+    state.counters["p99_latency_us"] = percentile(0.99);
+    state.counters["requests_per_s"]
+        = static_cast<double>(replies) / std::chrono::duration<double>(elapsed).count();
+}
+
+// Each iteration measures a fixed window of wall-clock time.
+BENCHMARK(BM_BootstrapdLoad)
+    ->ArgNames({"loop", "workers", "clients"})
+    ->Args({static_cast<int>(Loop::kLegacy), 1, 1})
+    ->Args({static_cast<int>(Loop::kLegacy), 1, 64})
+    ->Args({static_cast<int>(Loop::kEvent), 1, 1})
+    ->Args({static_cast<int>(Loop::kEvent), 1, 64})
+    ->Args({static_cast<int>(Loop::kEvent), 4, 64})
+    ->Args({static_cast<int>(Loop::kEvent), 4, 256})
+    ->Iterations(3)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,242 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// File transfer throughput of each congestion controller over a simulated
+// bottleneck link: packets queue behind each other at the link bandwidth, are
+// dropped when the queue holds more than one RTT worth of data, and are
+// randomly lost on top of that.
+//
+// Arguments:
+// - cc: the Tox_Congestion_Control of the sender.
+// - kib_s: bandwidth of the link in each direction, in KiB/s.
+// - rtt_ms: round trip time of the empty link.
+// - loss_pm: random loss in packets per thousand.
+//
+// Reported counters:
+// - throughput_kib_s: KiB received per second of simulated time.
+// - utilization: throughput as a fraction of the link bandwidth.
+// - drop_rate: fraction of UDP packets dropped by the full queue or lost.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../../testing/support/public/simulation.hh"
+#include "../../testing/support/public/tox_network.hh"
+#include "../../toxcore/tox.h"
+#include "../../toxcore/tox_private.h"
+
+namespace {
+
+using tox::test::Packet;
+using tox::test::SimulatedNode;
+using tox::test::Simulation;
+
+constexpr std::uint64_t kFileSize = 1024 * 1024;
+constexpr std::uint64_t kTimeoutMs = 300 * 1000;
+constexpr double kKiB = 1024.0;
+
+/** One side of the transfer. */
+struct Endpoint {
+    std::unique_ptr<SimulatedNode> node;
+    SimulatedNode::ToxPtr tox;
+
+    std::uint64_t next_run = 0;
+
+    std::vector<std::uint8_t> chunk;
+    std::uint64_t received = 0;
+    bool done = false;
+
+    explicit Endpoint(Simulation &sim)
+        : node(sim.create_node())
+        , tox(node->create_tox())
+    {
+    }
+
+    void iterate(std::uint64_t now)
+    {
+        tox_iterate(tox.get(), this);
+        next_run = now + tox_iteration_interval(tox.get());
+    }
+};
+
+/** The link between the two nodes, one queue per direction. */
+class Bottleneck {
+public:
+    Bottleneck(Simulation &sim, double kib_s, std::uint64_t rtt_ms, double loss)
+        : sim_(sim)
+        , bytes_per_ms_(kib_s * kKiB / 1000.0)
+        , one_way_ms_(rtt_ms / 2)
+        , queue_ms_(static_cast<double>(std::max<std::uint64_t>(rtt_ms, 10)))
+        , loss_(loss)
+    {
+    }
+
+    bool operator()(Packet &p)
+    {
+        if (p.is_tcp) {
+            return true;
+        }
+
+        ++packets_;
+
+        if (loss_(rng_)) {
+            ++dropped_;
+            return false;
+        }
+
+        const double now = static_cast<double>(sim_.clock().current_time_ms());
+        // Directions are told apart by the sending port.
+        double &free_at = free_at_[p.from.port];
+        const double start = std::max(free_at, now);
+
+        if (start - now > queue_ms_) {
+            ++dropped_;
+            return false;
+        }
+
+        free_at = start + static_cast<double>(p.data.size()) / bytes_per_ms_;
+        p.delivery_time = static_cast<std::uint64_t>(free_at) + one_way_ms_;
+        return true;
+    }
+
+    double drop_rate() const
+    {
+        return packets_ == 0 ? 0.0 : static_cast<double>(dropped_) / static_cast<double>(packets_);
+    }
+
+private:
+    Simulation &sim_;
+    double bytes_per_ms_;
+    std::uint64_t one_way_ms_;
+    double queue_ms_;
+    std::bernoulli_distribution loss_;
+    std::mt19937 rng_{12345};
+    std::map<std::uint16_t, double> free_at_;
+    std::uint64_t packets_ = 0;
+    std::uint64_t dropped_ = 0;
+};
+
+void on_chunk_request(Tox *_Nonnull tox, Tox_Friend_Number friend_number,
+    Tox_File_Number file_number, std::uint64_t position, std::size_t length,
+    void *_Nullable user_data)
+{
+    auto *self = static_cast<Endpoint *>(user_data);
+    if (length == 0) {
+        self->done = true;
+        return;
+    }
+    self->chunk.resize(length);
+    tox_file_send_chunk(
+        tox, friend_number, file_number, position, self->chunk.data(), length, nullptr);
+}
+
+void on_file_recv(Tox *_Nonnull tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+    std::uint32_t, std::uint64_t, const std::uint8_t *_Nullable, std::size_t, void *_Nullable)
+{
+    tox_file_control(tox, friend_number, file_number, TOX_FILE_CONTROL_RESUME, nullptr);
+}
+
+void on_recv_chunk(Tox *_Nonnull, Tox_Friend_Number, Tox_File_Number, std::uint64_t,
+    const std::uint8_t *_Nullable, std::size_t length, void *_Nullable user_data)
+{
+    auto *self = static_cast<Endpoint *>(user_data);
+    self->received += length;
+    if (length == 0) {
+        self->done = true;
+    }
+}
+
+void BM_CongestionControl(benchmark::State &state)
+{
+    const auto cc = static_cast<Tox_Congestion_Control>(state.range(0));
+    const double kib_s = static_cast<double>(state.range(1));
+    const auto rtt_ms = static_cast<std::uint64_t>(state.range(2));
+    const double loss = static_cast<double>(state.range(3)) / 1000.0;
+
+    Simulation sim{12345};
+    Endpoint sender{sim};
+    Endpoint receiver{sim};
+
+    if (sender.tox == nullptr || receiver.tox == nullptr) {
+        state.SkipWithError("failed to create tox instances");
+        return;
+    }
+
+    tox_set_congestion_control(sender.tox.get(), cc);
+    tox_set_congestion_control(receiver.tox.get(), cc);
+
+    if (!tox::test::connect_friends(
+            sim, *sender.node, sender.tox.get(), *receiver.node, receiver.tox.get())) {
+        state.SkipWithError("failed to connect friends");
+        return;
+    }
+
+    Bottleneck bottleneck(sim, kib_s, rtt_ms, loss);
+    sim.net().add_filter([&bottleneck](Packet &p) { return bottleneck(p); });
+
+    tox_callback_file_chunk_request(sender.tox.get(), on_chunk_request);
+    tox_callback_file_recv(receiver.tox.get(), on_file_recv);
+    tox_callback_file_recv_chunk(receiver.tox.get(), on_recv_chunk);
+
+    std::uint64_t sim_ms = 0;
+
+    for (auto _ : state) {
+        sender.done = false;
+        receiver.done = false;
+
+        if (tox_file_send(sender.tox.get(), 0, TOX_FILE_KIND_DATA, kFileSize, nullptr,
+                reinterpret_cast<const std::uint8_t *>("file"), 4, nullptr)
+            == UINT32_MAX) {
+            state.SkipWithError("tox_file_send failed");
+            return;
+        }
+
+        const std::uint64_t start = sim.clock().current_time_ms();
+
+        while (!receiver.done) {
+            const std::uint64_t now = sim.clock().current_time_ms();
+            if (now - start > kTimeoutMs) {
+                state.SkipWithError("transfer timed out");
+                return;
+            }
+
+            for (Endpoint *ep : {&sender, &receiver}) {
+                if (now >= ep->next_run) {
+                    ep->iterate(now);
+                }
+            }
+
+            sim.advance_time(1);
+        }
+
+        sim_ms += sim.clock().current_time_ms() - start;
+    }
+
+    const double kib = static_cast<double>(receiver.received) / kKiB;
+    const double throughput = sim_ms == 0 ? 0.0 : kib / (static_cast<double>(sim_ms) / 1000.0);
+
+    state.counters["throughput_kib_s"] = throughput;
+    state.counters["utilization"] = throughput / kib_s;
+    state.counters["drop_rate"] = bottleneck.drop_rate();
+}
+
+// A transfer takes seconds of simulated time, so run a single iteration of
+// each profile.
+BENCHMARK(BM_CongestionControl)
+    ->ArgNames({"cc", "kib_s", "rtt_ms", "loss_pm"})
+    ->ArgsProduct({{TOX_CONGESTION_CONTROL_LEGACY, TOX_CONGESTION_CONTROL_CUBIC}, {256, 2048},
+        {20, 200}, {0, 10}})
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
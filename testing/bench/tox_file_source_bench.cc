@@ -0,0 +1,248 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// CPU cost of moving file data through toxcore over the simulated network,
+// with the per-chunk callbacks and with file sources and sinks.
+//
+// Arguments:
+// - mode: 0 for the chunk request and receive callbacks, 1 for memory
+//   regions on both sides, 2 for read and write callbacks on both sides.
+//
+// Reported counters:
+// - cpu_ms_per_gb: CPU time spent in tox_iterate on both sides per GiB.
+// - callbacks_per_mb: client callbacks on both sides per MiB.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "../../testing/support/public/simulation.hh"
+#include "../../testing/support/public/tox_network.hh"
+#include "../../toxcore/tox.h"
+#include "../../toxcore/tox_private.h"
+
+namespace {
+
+using tox::test::Packet;
+using tox::test::SimulatedNode;
+using tox::test::Simulation;
+
+constexpr std::uint64_t kFileSize = 8 * 1024 * 1024;
+constexpr std::uint64_t kTimeoutMs = 600 * 1000;
+constexpr std::uint64_t kLatencyMs = 5;
+constexpr double kMiB = 1024.0 * 1024.0;
+constexpr double kGiB = kMiB * 1024.0;
+
+enum class Mode { kCallbacks = 0, kRegions = 1, kStreams = 2 };
+
+/** One side of the transfer. */
+struct Endpoint {
+    std::unique_ptr<SimulatedNode> node;
+    SimulatedNode::ToxPtr tox;
+
+    std::uint64_t next_run = 0;
+    std::chrono::nanoseconds cpu{0};
+
+    Mode mode = Mode::kCallbacks;
+    std::vector<std::uint8_t> file;
+    std::uint64_t received = 0;
+    std::uint64_t callbacks = 0;
+    bool done = false;
+
+    explicit Endpoint(Simulation &sim)
+        : node(sim.create_node())
+        , tox(node->create_tox())
+        , file(kFileSize)
+    {
+    }
+
+    void iterate(std::uint64_t now)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        tox_iterate(tox.get(), this);
+        cpu += std::chrono::steady_clock::now() - start;
+
+        next_run = now + tox_iteration_interval(tox.get());
+    }
+};
+
+std::size_t read_file(void *_Nullable user_data, std::uint64_t position, std::uint8_t *_Nonnull data,
+    std::size_t length)
+{
+    auto *self = static_cast<Endpoint *>(user_data);
+    ++self->callbacks;
+    if (position >= self->file.size()) {
+        return 0;
+    }
+    length = std::min<std::size_t>(length, self->file.size() - position);
+    std::memcpy(data, self->file.data() + position, length);
+    return length;
+}
+
+bool write_file(void *_Nullable user_data, std::uint64_t position, const std::uint8_t *_Nonnull data,
+    std::size_t length)
+{
+    auto *self = static_cast<Endpoint *>(user_data);
+    ++self->callbacks;
+    if (position > self->file.size() || length > self->file.size() - position) {
+        return false;
+    }
+    std::memcpy(self->file.data() + position, data, length);
+    self->received += length;
+    return true;
+}
+
+void on_chunk_request(Tox *_Nonnull tox, Tox_Friend_Number friend_number,
+    Tox_File_Number file_number, std::uint64_t position, std::size_t length,
+    void *_Nullable user_data)
+{
+    auto *self = static_cast<Endpoint *>(user_data);
+    ++self->callbacks;
+    if (length == 0) {
+        self->done = true;
+        return;
+    }
+    tox_file_send_chunk(
+        tox, friend_number, file_number, position, self->file.data() + position, length, nullptr);
+}
+
+void on_file_recv(Tox *_Nonnull tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+    std::uint32_t, std::uint64_t, const std::uint8_t *_Nullable, std::size_t, void *_Nullable user_data)
+{
+    auto *self = static_cast<Endpoint *>(user_data);
+
+    if (self->mode == Mode::kRegions) {
+        tox_file_set_sink_region(
+            tox, friend_number, file_number, self->file.data(), self->file.size(), nullptr);
+    } else if (self->mode == Mode::kStreams) {
+        tox_file_set_sink_callback(tox, friend_number, file_number, write_file, self, 0, nullptr);
+    }
+
+    tox_file_control(tox, friend_number, file_number, TOX_FILE_CONTROL_RESUME, nullptr);
+}
+
+void on_recv_chunk(Tox *_Nonnull, Tox_Friend_Number, Tox_File_Number, std::uint64_t position,
+    const std::uint8_t *_Nullable, std::size_t length, void *_Nullable user_data)
+{
+    auto *self = static_cast<Endpoint *>(user_data);
+    ++self->callbacks;
+    if (length == 0) {
+        if (self->mode == Mode::kRegions) {
+            self->received = position;
+        }
+        self->done = true;
+        return;
+    }
+    self->received += length;
+}
+
+void BM_FileSource(benchmark::State &state)
+{
+    const auto mode = static_cast<Mode>(state.range(0));
+
+    Simulation sim{12345};
+    Endpoint sender{sim};
+    Endpoint receiver{sim};
+
+    if (sender.tox == nullptr || receiver.tox == nullptr
+        || !tox::test::connect_friends(
+            sim, *sender.node, sender.tox.get(), *receiver.node, receiver.tox.get())) {
+        state.SkipWithError("failed to connect friends");
+        return;
+    }
+
+    sender.mode = mode;
+    receiver.mode = mode;
+
+    sim.net().add_filter([&](Packet &p) {
+        p.delivery_time = sim.clock().current_time_ms() + kLatencyMs;
+        return true;
+    });
+
+    tox_callback_file_chunk_request(sender.tox.get(), on_chunk_request);
+    tox_callback_file_recv(receiver.tox.get(), on_file_recv);
+    tox_callback_file_recv_chunk(receiver.tox.get(), on_recv_chunk);
+
+    std::uint64_t received = 0;
+
+    for (auto _ : state) {
+        sender.done = false;
+        receiver.done = false;
+        receiver.received = 0;
+
+        const Tox_File_Number file_number
+            = tox_file_send(sender.tox.get(), 0, TOX_FILE_KIND_DATA, kFileSize, nullptr,
+                reinterpret_cast<const std::uint8_t *>("file"), 4, nullptr);
+
+        if (file_number == UINT32_MAX) {
+            state.SkipWithError("tox_file_send failed");
+            return;
+        }
+
+        bool ok = true;
+
+        if (mode == Mode::kRegions) {
+            ok = tox_file_set_source_region(sender.tox.get(), 0, file_number, sender.file.data(),
+                sender.file.size(), nullptr);
+        } else if (mode == Mode::kStreams) {
+            ok = tox_file_set_source_callback(
+                sender.tox.get(), 0, file_number, read_file, &sender, 0, nullptr);
+        }
+
+        if (!ok) {
+            state.SkipWithError("setting the file source failed");
+            return;
+        }
+
+        const std::uint64_t start = sim.clock().current_time_ms();
+
+        while (!receiver.done) {
+            const std::uint64_t now = sim.clock().current_time_ms();
+            if (now - start > kTimeoutMs) {
+                state.SkipWithError("transfer timed out");
+                return;
+            }
+
+            for (Endpoint *ep : {&sender, &receiver}) {
+                if (now >= ep->next_run) {
+                    ep->iterate(now);
+                }
+            }
+
+            sim.advance_time(1);
+        }
+
+        received += receiver.received;
+    }
+
+    const double cpu_ms
+        = std::chrono::duration<double, std::milli>(sender.cpu + receiver.cpu).count();
+    const double bytes = static_cast<double>(received);
+
+    state.counters["cpu_ms_per_gb"] = received == 0 ? 0.0 : cpu_ms / (bytes / kGiB);
+    state.counters["callbacks_per_mb"] = received == 0
+        ? 0.0
+        : static_cast<double>(sender.callbacks + receiver.callbacks) / (bytes / kMiB);
+    state.SetBytesProcessed(static_cast<std::int64_t>(received));
+}
+
+// Each iteration transfers one file. Connecting the friends is expensive and
+// a transfer takes a while, so run a fixed number of iterations.
+BENCHMARK(BM_FileSource)
+    ->ArgName("mode")
+    ->Arg(static_cast<int>(Mode::kCallbacks))
+    ->Arg(static_cast<int>(Mode::kRegions))
+    ->Arg(static_cast<int>(Mode::kStreams))
+    ->Iterations(3)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// File transfer over the simulated network, with each side run the way an
+// event loop would run it: tox_iterate is called when tox_iteration_interval
+// has passed, or, when waking on readable sockets, as soon as a packet for
+// that side arrives.
+//
+// Reported counters:
+// - throughput_mb_s: MiB received per second of simulated time.
+// - cpu_ms_per_mb: CPU time spent in tox_iterate on both sides per MiB.
+// - recv_iterations_per_mb: receiver tox_iterate calls per MiB.
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../../testing/support/public/simulation.hh"
+#include "../../testing/support/public/tox_network.hh"
+#include "../../toxcore/tox.h"
+
+namespace {
+
+using tox::test::Packet;
+using tox::test::SimulatedNode;
+using tox::test::Simulation;
+
+constexpr std::uint64_t kFileSize = 4 * 1024 * 1024;
+constexpr std::uint64_t kTimeoutMs = 600 * 1000;
+constexpr double kMiB = 1024.0 * 1024.0;
+
+/** One side of the transfer, with its own wakeup schedule. */
+struct Endpoint {
+    std::unique_ptr<SimulatedNode> node;
+    SimulatedNode::ToxPtr tox;
+
+    std::uint64_t next_run = 0;
+
+    std::uint64_t iterations = 0;
+    std::chrono::nanoseconds cpu{0};
+
+    std::vector<std::uint8_t> chunk;
+    std::uint64_t received = 0;
+    bool done = false;
+
+    explicit Endpoint(Simulation &sim)
+        : node(sim.create_node())
+        , tox(node->create_tox())
+    {
+    }
+
+    bool readable() { return node->get_primary_socket()->recv_buffer_size() != 0; }
+
+    void iterate(std::uint64_t now)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        tox_iterate(tox.get(), this);
+        cpu += std::chrono::steady_clock::now() - start;
+        ++iterations;
+
+        next_run = now + tox_iteration_interval(tox.get());
+    }
+};
+
+void on_chunk_request(Tox *_Nonnull tox, Tox_Friend_Number friend_number,
+    Tox_File_Number file_number, std::uint64_t position, std::size_t length,
+    void *_Nullable user_data)
+{
+    auto *self = static_cast<Endpoint *>(user_data);
+    if (length == 0) {
+        self->done = true;
+        return;
+    }
+    self->chunk.resize(length);
+    tox_file_send_chunk(
+        tox, friend_number, file_number, position, self->chunk.data(), length, nullptr);
+}
+
+void on_file_recv(Tox *_Nonnull tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+    std::uint32_t, std::uint64_t, const std::uint8_t *_Nullable, std::size_t, void *_Nullable)
+{
+    tox_file_control(tox, friend_number, file_number, TOX_FILE_CONTROL_RESUME, nullptr);
+}
+
+void on_recv_chunk(Tox *_Nonnull, Tox_Friend_Number, Tox_File_Number, std::uint64_t,
+    const std::uint8_t *_Nullable, std::size_t length, void *_Nullable user_data)
+{
+    auto *self = static_cast<Endpoint *>(user_data);
+    self->received += length;
+    if (length == 0) {
+        self->done = true;
+    }
+}
+
+void BM_FileTransfer(benchmark::State &state)
+{
+    const auto latency_ms = static_cast<std::uint64_t>(state.range(0));
+    const bool wake_on_readable = state.range(1) != 0;
+
+    Simulation sim{12345};
+    Endpoint sender{sim};
+    Endpoint receiver{sim};
+
+    if (sender.tox == nullptr || receiver.tox == nullptr
+        || !tox::test::connect_friends(
+            sim, *sender.node, sender.tox.get(), *receiver.node, receiver.tox.get())) {
+        state.SkipWithError("failed to connect friends");
+        return;
+    }
+
+    sim.net().add_filter([&](Packet &p) {
+        p.delivery_time = sim.clock().current_time_ms() + latency_ms;
+        return true;
+    });
+
+    tox_callback_file_chunk_request(sender.tox.get(), on_chunk_request);
+    tox_callback_file_recv(receiver.tox.get(), on_file_recv);
+    tox_callback_file_recv_chunk(receiver.tox.get(), on_recv_chunk);
+
+    std::uint64_t sim_ms = 0;
+
+    for (auto _ : state) {
+        sender.done = false;
+        receiver.done = false;
+
+        if (tox_file_send(sender.tox.get(), 0, TOX_FILE_KIND_DATA, kFileSize, nullptr,
+                reinterpret_cast<const std::uint8_t *>("file"), 4, nullptr)
+            == UINT32_MAX) {
+            state.SkipWithError("tox_file_send failed");
+            return;
+        }
+
+        const std::uint64_t start = sim.clock().current_time_ms();
+
+        while (!receiver.done) {
+            const std::uint64_t now = sim.clock().current_time_ms();
+            if (now - start > kTimeoutMs) {
+                state.SkipWithError("transfer timed out");
+                return;
+            }
+
+            for (Endpoint *ep : {&sender, &receiver}) {
+                if (now >= ep->next_run || (wake_on_readable && ep->readable())) {
+                    ep->iterate(now);
+                }
+            }
+
+            sim.advance_time(1);
+        }
+
+        sim_ms += sim.clock().current_time_ms() - start;
+    }
+
+    const double mb = static_cast<double>(receiver.received) / kMiB;
+    const double cpu_ms
+        = std::chrono::duration<double, std::milli>(sender.cpu + receiver.cpu).count();
+
+    state.counters["throughput_mb_s"]
+        = sim_ms == 0 ? 0.0 : mb / (static_cast<double>(sim_ms) / 1000.0);
+    state.counters["cpu_ms_per_mb"] = mb == 0 ? 0.0 : cpu_ms / mb;
+    state.counters["recv_iterations_per_mb"]
+        = mb == 0 ? 0.0 : static_cast<double>(receiver.iterations) / mb;
+    state.SetBytesProcessed(static_cast<std::int64_t>(receiver.received));
+}
+
+// Each iteration transfers one file. Connecting the friends is expensive and
+// a transfer takes a while, so run a fixed number of iterations.
+BENCHMARK(BM_FileTransfer)
+    ->ArgNames({"latency_ms", "wake_on_readable"})
+    ->Args({5, 0})
+    ->Args({5, 1})
+    ->Args({50, 0})
+    ->Args({50, 1})
+    ->Iterations(3)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -12,6 +12,7 @@
 #include "../../testing/support/public/simulation.hh"
 #include "../../testing/support/public/tox_network.hh"
 #include "../../toxcore/tox.h"
+#include "../../toxcore/tox_private.h"
 
 namespace {
 
@@ -20,6 +21,46 @@ using tox::test::setup_connected_friends;
 using tox::test::SimulatedNode;
 using tox::test::Simulation;
 
+// --- Profiling ---
+
+struct PhaseCounter {
+    Tox_Iterate_Phase phase;
+    const char *name;
+};
+
+constexpr PhaseCounter kPhaseCounters[] = {
+    {TOX_ITERATE_PHASE_NETWORKING_POLL, "networking_poll_ns"},
+    {TOX_ITERATE_PHASE_DHT, "dht_ns"},
+    {TOX_ITERATE_PHASE_NET_CRYPTO, "net_crypto_ns"},
+    {TOX_ITERATE_PHASE_ONION_CLIENT, "onion_client_ns"},
+    {TOX_ITERATE_PHASE_FRIEND_CONNECTIONS, "friend_connections_ns"},
+    {TOX_ITERATE_PHASE_FRIENDS, "friends_ns"},
+    {TOX_ITERATE_PHASE_GROUP_CHATS, "group_chats_ns"},
+    {TOX_ITERATE_PHASE_CONFERENCES, "conferences_ns"},
+};
+
+/** @brief Starts profiling the phases of tox_iterate, dropping what the set-up did. */
+void start_iterate_profile(Tox *tox)
+{
+    tox_iterate_profile_set_enabled(tox, true);
+    tox_iterate_profile_reset(tox);
+}
+
+/**
+ * @brief Reports the mean time per tox_iterate of each phase, so a phase that
+ * grows with the number of friends shows up next to the total.
+ */
+void report_iterate_profile(benchmark::State &state, Tox *tox)
+{
+    for (const PhaseCounter &counter : kPhaseCounters) {
+        state.counters[counter.name] = benchmark::Counter(
+            static_cast<double>(tox_iterate_profile_get_phase_total_ns(tox, counter.phase)),
+            benchmark::Counter::kAvgIterations);
+    }
+
+    tox_iterate_profile_set_enabled(tox, false);
+}
+
 // --- Helper Contexts ---
 
 struct GroupContext {
@@ -366,10 +407,14 @@ GroupScalingContext::~GroupScalingContext() = default;
 
 BENCHMARK_DEFINE_F(ToxIterateScalingFixture, Iterate)(benchmark::State &state)
 {
+    start_iterate_profile(main_tox.get());
+
     for (auto _ : state) {
         tox_iterate(main_tox.get(), nullptr);
     }
 
+    report_iterate_profile(state, main_tox.get());
+
     state.counters["mem_current"]
         = benchmark::Counter(static_cast<double>(main_node->fake_memory().current_allocation()),
             benchmark::Counter::kDefaults, benchmark::Counter::OneK::kIs1024);
@@ -387,11 +432,14 @@ BENCHMARK_REGISTER_F(ToxIterateScalingFixture, Iterate)
 void RunConnectedScaling(benchmark::State &state, ConnectedContext &ctx)
 {
     ctx.Setup(state.range(0));
+    start_iterate_profile(ctx.main_tox.get());
 
     for (auto _ : state) {
         tox_iterate(ctx.main_tox.get(), nullptr);
     }
 
+    report_iterate_profile(state, ctx.main_tox.get());
+
     state.counters["mem_current"]
         = benchmark::Counter(static_cast<double>(ctx.main_node->fake_memory().current_allocation()),
             benchmark::Counter::kDefaults, benchmark::Counter::OneK::kIs1024);
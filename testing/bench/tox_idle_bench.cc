@@ -0,0 +1,145 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// Idle Tox instances on the simulated network, each run the way an event loop
+// would run it: tox_iterate is called when tox_iteration_interval has passed,
+// and nothing else happens. Simulated time jumps straight to the next wakeup.
+//
+// Reported counters:
+// - wakeups_per_min: tox_iterate calls per instance per simulated minute.
+// - cpu_us_per_min: CPU time spent in tox_iterate per instance per simulated
+//   minute.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../../testing/support/public/simulation.hh"
+#include "../../testing/support/public/tox_network.hh"
+#include "../../toxcore/tox.h"
+
+namespace {
+
+using tox::test::SimulatedNode;
+using tox::test::Simulation;
+
+constexpr std::uint64_t kIdleMs = 10 * 60 * 1000;
+
+struct Instance {
+    std::unique_ptr<SimulatedNode> node;
+    SimulatedNode::ToxPtr tox;
+
+    std::uint64_t next_run = 0;
+    std::uint64_t wakeups = 0;
+    std::chrono::nanoseconds cpu{0};
+
+    explicit Instance(Simulation &sim)
+        : node(sim.create_node())
+        , tox(node->create_tox())
+    {
+    }
+
+    void iterate(std::uint64_t now)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        tox_iterate(tox.get(), nullptr);
+        cpu += std::chrono::steady_clock::now() - start;
+        ++wakeups;
+
+        next_run = now + tox_iteration_interval(tox.get());
+    }
+};
+
+// Argument: 0 for a single instance without friends, 1 for two instances
+// that are friends with each other and connected.
+void BM_IdleWakeups(benchmark::State &state)
+{
+    const bool with_friend = state.range(0) != 0;
+
+    Simulation sim{12345};
+    std::vector<std::unique_ptr<Instance>> instances;
+    instances.push_back(std::make_unique<Instance>(sim));
+
+    if (with_friend) {
+        instances.push_back(std::make_unique<Instance>(sim));
+    }
+
+    for (const auto &instance : instances) {
+        if (instance->tox == nullptr) {
+            state.SkipWithError("failed to create tox");
+            return;
+        }
+    }
+
+    if (with_friend
+        && !tox::test::connect_friends(sim, *instances[0]->node, instances[0]->tox.get(),
+            *instances[1]->node, instances[1]->tox.get())) {
+        state.SkipWithError("failed to connect friends");
+        return;
+    }
+
+    for (auto _ : state) {
+        for (const auto &instance : instances) {
+            instance->wakeups = 0;
+            instance->cpu = std::chrono::nanoseconds{0};
+        }
+
+        const std::uint64_t start = sim.clock().current_time_ms();
+
+        while (sim.clock().current_time_ms() - start < kIdleMs) {
+            const std::uint64_t now = sim.clock().current_time_ms();
+            std::uint64_t next = now + kIdleMs;
+
+            for (const auto &instance : instances) {
+                if (now >= instance->next_run) {
+                    instance->iterate(now);
+                }
+                next = std::min(next, instance->next_run);
+            }
+
+            sim.advance_time(next > now ? next - now : 1);
+        }
+    }
+
+    if (with_friend
+        && (tox_friend_get_connection_status(instances[0]->tox.get(), 0, nullptr)
+                == TOX_CONNECTION_NONE
+            || tox_friend_get_connection_status(instances[1]->tox.get(), 0, nullptr)
+                == TOX_CONNECTION_NONE)) {
+        state.SkipWithError("friends disconnected while idle");
+        return;
+    }
+
+    std::uint64_t wakeups = 0;
+    std::chrono::nanoseconds cpu{0};
+
+    for (const auto &instance : instances) {
+        wakeups += instance->wakeups;
+        cpu += instance->cpu;
+    }
+
+    // Counters cover the last iteration only, which ran for kIdleMs.
+    const double minutes
+        = static_cast<double>(kIdleMs) / 60000.0 * static_cast<double>(instances.size());
+
+    state.counters["wakeups_per_min"] = static_cast<double>(wakeups) / minutes;
+    state.counters["cpu_us_per_min"]
+        = std::chrono::duration<double, std::micro>(cpu).count() / minutes;
+}
+
+// Each iteration idles for ten simulated minutes.
+BENCHMARK(BM_IdleWakeups)
+    ->ArgName("with_friend")
+    ->Arg(0)
+    ->Arg(1)
+    ->Iterations(3)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
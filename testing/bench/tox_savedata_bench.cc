@@ -0,0 +1,150 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// Cost of persisting a single change to a profile with many friends: rewriting
+// the whole savedata with tox_get_savedata, versus writing a journal to append
+// to a base written by tox_savedata_compact.
+//
+// Arguments:
+// - friends: number of friends in the profile.
+// - change: 0 to change our name, 1 to delete a friend and add it again.
+//
+// Reported counters:
+// - bytes_per_save: bytes the client writes to its save file per change.
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../../testing/support/public/simulation.hh"
+#include "../../toxcore/tox.h"
+#include "../../toxcore/tox_private.h"
+
+namespace {
+
+using tox::test::SimulatedNode;
+using tox::test::Simulation;
+
+using Public_Key = std::array<std::uint8_t, TOX_PUBLIC_KEY_SIZE>;
+
+struct Profile {
+    Simulation sim{12345};
+    std::unique_ptr<SimulatedNode> node = sim.create_node();
+    SimulatedNode::ToxPtr tox = node->create_tox();
+    std::vector<Public_Key> friends;
+    std::uint32_t changes = 0;
+
+    explicit Profile(std::int64_t num_friends)
+    {
+        if (tox == nullptr) {
+            return;
+        }
+
+        std::mt19937 rng(12345);
+        std::uniform_int_distribution<int> byte(0, 255);
+
+        for (std::int64_t i = 0; i < num_friends; ++i) {
+            Public_Key pk;
+
+            for (std::uint8_t &b : pk) {
+                b = static_cast<std::uint8_t>(byte(rng));
+            }
+
+            // Valid public keys have the top bit of the last byte cleared.
+            pk[TOX_PUBLIC_KEY_SIZE - 1] &= 0x7f;
+
+            if (tox_friend_add_norequest(tox.get(), pk.data(), nullptr) != UINT32_MAX) {
+                friends.push_back(pk);
+            }
+        }
+    }
+
+    void change(std::int64_t kind)
+    {
+        ++changes;
+
+        if (kind == 0) {
+            const std::array<std::uint8_t, 4> name = {'n', 'a', 'm', static_cast<std::uint8_t>(changes)};
+            tox_self_set_name(tox.get(), name.data(), name.size(), nullptr);
+            return;
+        }
+
+        const Public_Key &pk = friends[changes % friends.size()];
+        tox_friend_delete(tox.get(), tox_friend_by_public_key(tox.get(), pk.data(), nullptr), nullptr);
+        tox_friend_add_norequest(tox.get(), pk.data(), nullptr);
+    }
+};
+
+void BM_SaveFull(benchmark::State &state)
+{
+    Profile profile(state.range(0));
+
+    if (profile.tox == nullptr || profile.friends.empty()) {
+        state.SkipWithError("failed to create profile");
+        return;
+    }
+
+    std::vector<std::uint8_t> savedata;
+    std::uint64_t bytes = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        profile.change(state.range(1));
+        state.ResumeTiming();
+
+        savedata.resize(tox_get_savedata_size(profile.tox.get()));
+        tox_get_savedata(profile.tox.get(), savedata.data());
+        bytes += savedata.size();
+        benchmark::DoNotOptimize(savedata.data());
+    }
+
+    state.counters["bytes_per_save"] = benchmark::Counter(
+        static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+}
+
+void BM_SaveJournal(benchmark::State &state)
+{
+    Profile profile(state.range(0));
+
+    if (profile.tox == nullptr || profile.friends.empty()) {
+        state.SkipWithError("failed to create profile");
+        return;
+    }
+
+    std::vector<std::uint8_t> base(tox_savedata_compact_size(profile.tox.get()));
+    base.resize(tox_savedata_compact(profile.tox.get(), base.data()));
+
+    std::vector<std::uint8_t> journal;
+    std::uint64_t bytes = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        profile.change(state.range(1));
+        state.ResumeTiming();
+
+        journal.resize(tox_savedata_journal_size(profile.tox.get()));
+        bytes += tox_savedata_journal(profile.tox.get(), journal.data(), nullptr);
+        benchmark::DoNotOptimize(journal.data());
+    }
+
+    state.counters["bytes_per_save"] = benchmark::Counter(
+        static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_SaveFull)
+    ->ArgNames({"friends", "change"})
+    ->ArgsProduct({{100, 10000}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SaveJournal)
+    ->ArgNames({"friends", "change"})
+    ->ArgsProduct({{100, 10000}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
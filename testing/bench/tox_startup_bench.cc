@@ -0,0 +1,158 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// Startup latency of a profile with many friends: tox_new from synthetic
+// savedata, with and without experimental_lazy_load.
+//
+// Arguments:
+// - friends: number of friends in the savedata.
+// - lazy: 1 to set experimental_lazy_load.
+//
+// Reported counters:
+// - savedata_bytes: size of the loaded savedata.
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../../testing/support/public/simulation.hh"
+#include "../../toxcore/tox.h"
+
+namespace {
+
+using tox::test::SimulatedNode;
+using tox::test::Simulation;
+
+/** Savedata of a profile with `num_friends` random friends, built once per size. */
+const std::vector<std::uint8_t> &synthetic_savedata(std::int64_t num_friends)
+{
+    static std::map<std::int64_t, std::vector<std::uint8_t>> cache;
+    std::vector<std::uint8_t> &savedata = cache[num_friends];
+
+    if (!savedata.empty()) {
+        return savedata;
+    }
+
+    Simulation sim{12345};
+    auto node = sim.create_node();
+    SimulatedNode::ToxPtr tox = node->create_tox();
+
+    if (tox == nullptr) {
+        return savedata;
+    }
+
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for (std::int64_t i = 0; i < num_friends; ++i) {
+        std::array<std::uint8_t, TOX_PUBLIC_KEY_SIZE> pk;
+
+        for (std::uint8_t &b : pk) {
+            b = static_cast<std::uint8_t>(byte(rng));
+        }
+
+        // Valid public keys have the top bit of the last byte cleared.
+        pk[TOX_PUBLIC_KEY_SIZE - 1] &= 0x7f;
+        tox_friend_add_norequest(tox.get(), pk.data(), nullptr);
+    }
+
+    savedata.resize(tox_get_savedata_size(tox.get()));
+    tox_get_savedata(tox.get(), savedata.data());
+    return savedata;
+}
+
+struct Loader {
+    Simulation sim{12345};
+    std::unique_ptr<SimulatedNode> node = sim.create_node();
+    std::unique_ptr<Tox_Options, decltype(&tox_options_free)> options{
+        tox_options_new(nullptr), tox_options_free};
+
+    Loader(const std::vector<std::uint8_t> &savedata, bool lazy)
+    {
+        if (options == nullptr) {
+            return;
+        }
+
+        tox_options_set_savedata_type(options.get(), TOX_SAVEDATA_TYPE_TOX_SAVE);
+        tox_options_set_savedata_data(options.get(), savedata.data(), savedata.size());
+        tox_options_set_experimental_lazy_load(options.get(), lazy);
+    }
+};
+
+// Time spent in tox_new.
+void BM_ToxNew(benchmark::State &state)
+{
+    const std::vector<std::uint8_t> &savedata = synthetic_savedata(state.range(0));
+    Loader loader(savedata, state.range(1) != 0);
+
+    if (savedata.empty() || loader.options == nullptr) {
+        state.SkipWithError("failed to create savedata");
+        return;
+    }
+
+    for (auto _ : state) {
+        SimulatedNode::ToxPtr tox = loader.node->create_tox(loader.options.get());
+
+        state.PauseTiming();
+
+        if (tox == nullptr
+            || tox_self_get_friend_list_size(tox.get()) != static_cast<std::size_t>(state.range(0))) {
+            state.SkipWithError("failed to load savedata");
+            return;
+        }
+
+        tox.reset();
+        state.ResumeTiming();
+    }
+
+    state.counters["savedata_bytes"] = static_cast<double>(savedata.size());
+}
+
+// Time spent in tox_new and the first tox_iterate, which is where the deferred
+// work starts.
+void BM_ToxNewAndIterate(benchmark::State &state)
+{
+    const std::vector<std::uint8_t> &savedata = synthetic_savedata(state.range(0));
+    Loader loader(savedata, state.range(1) != 0);
+
+    if (savedata.empty() || loader.options == nullptr) {
+        state.SkipWithError("failed to create savedata");
+        return;
+    }
+
+    for (auto _ : state) {
+        SimulatedNode::ToxPtr tox = loader.node->create_tox(loader.options.get());
+
+        if (tox == nullptr) {
+            state.SkipWithError("failed to load savedata");
+            return;
+        }
+
+        tox_iterate(tox.get(), nullptr);
+
+        state.PauseTiming();
+        tox.reset();
+        state.ResumeTiming();
+    }
+
+    state.counters["savedata_bytes"] = static_cast<double>(savedata.size());
+}
+
+BENCHMARK(BM_ToxNew)
+    ->ArgNames({"friends", "lazy"})
+    ->ArgsProduct({{1000, 10000}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ToxNewAndIterate)
+    ->ArgNames({"friends", "lazy"})
+    ->ArgsProduct({{1000, 10000}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,350 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// Message latency and file transfer throughput between two TCP-only friends
+// that share three relays of different speeds. Each relay link has its own
+// one-way latency and bandwidth: two fast relays with similar RTTs and one
+// slow relay.
+//
+// Arguments:
+// - selection: the Tox_Tcp_Relay_Selection of both friends.
+//
+// Reported counters:
+// - message_ms: mean time from sending a message to receiving it.
+// - throughput_kib_s: file data KiB received per second of simulated time.
+// - fastest_share: fraction of the sender's relay traffic that went through
+//   the relay with the lowest RTT.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "../../testing/support/public/simulation.hh"
+#include "../../toxcore/network.h"
+#include "../../toxcore/tox.h"
+#include "../../toxcore/tox_private.h"
+
+namespace {
+
+using tox::test::Packet;
+using tox::test::SimulatedNode;
+using tox::test::Simulation;
+
+constexpr std::uint64_t kFileSize = 2 * 1024 * 1024;
+constexpr std::uint32_t kMessages = 20;
+constexpr std::uint64_t kConnectTimeoutMs = 120 * 1000;
+// Long enough for the first relay pings, which go out 30 seconds after connecting.
+constexpr std::uint64_t kWarmupMs = 40 * 1000;
+constexpr std::uint64_t kTimeoutMs = 600 * 1000;
+constexpr double kKiB = 1024.0;
+
+struct RelayLink {
+    std::uint16_t port;
+    std::uint64_t one_way_ms;
+    double kib_s;
+};
+
+constexpr std::array<RelayLink, 3> kRelays{{
+    {33451, 10, 256},
+    {33452, 13, 256},
+    {33453, 60, 256},
+}};
+
+struct Node {
+    std::unique_ptr<SimulatedNode> node;
+    SimulatedNode::ToxPtr tox;
+    std::uint64_t next_run = 0;
+
+    bool message_received = false;
+    std::vector<std::uint8_t> chunk;
+    std::uint64_t received = 0;
+    bool done = false;
+};
+
+/** Delays TCP packets to and from each relay by its latency and bandwidth. */
+class RelayLinks {
+public:
+    explicit RelayLinks(Simulation &sim)
+        : sim_(sim)
+    {
+    }
+
+    void add(const IP &ip, const RelayLink &link) { links_.push_back({ip, link}); }
+
+    bool operator()(Packet &p)
+    {
+        if (!p.is_tcp) {
+            return true;
+        }
+
+        for (std::size_t i = 0; i < links_.size(); ++i) {
+            const bool from_relay = ip_equal(&p.from.ip, &links_[i].first);
+
+            if (!from_relay && !ip_equal(&p.to.ip, &links_[i].first)) {
+                continue;
+            }
+
+            const RelayLink &link = links_[i].second;
+            const double now = static_cast<double>(sim_.clock().current_time_ms());
+            // Each client has its own link to the relay, one queue per direction.
+            const IP_Port &client = from_relay ? p.to : p.from;
+            double &free_at = free_at_[{i, from_relay, client.port}];
+            free_at = std::max(free_at, now)
+                + static_cast<double>(p.data.size()) / (link.kib_s * kKiB / 1000.0);
+            p.delivery_time = static_cast<std::uint64_t>(free_at) + link.one_way_ms;
+            return true;
+        }
+
+        return true;
+    }
+
+private:
+    Simulation &sim_;
+    std::vector<std::pair<IP, RelayLink>> links_;
+    std::map<std::tuple<std::size_t, bool, std::uint16_t>, double> free_at_;
+};
+
+void on_friend_message(Tox *_Nonnull, Tox_Friend_Number, Tox_Message_Type, const std::uint8_t *_Nonnull,
+    std::size_t, void *_Nullable user_data)
+{
+    static_cast<Node *>(user_data)->message_received = true;
+}
+
+void on_chunk_request(Tox *_Nonnull tox, Tox_Friend_Number friend_number,
+    Tox_File_Number file_number, std::uint64_t position, std::size_t length,
+    void *_Nullable user_data)
+{
+    auto *self = static_cast<Node *>(user_data);
+    if (length == 0) {
+        return;
+    }
+    self->chunk.resize(length);
+    tox_file_send_chunk(
+        tox, friend_number, file_number, position, self->chunk.data(), length, nullptr);
+}
+
+void on_file_recv(Tox *_Nonnull tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+    std::uint32_t, std::uint64_t, const std::uint8_t *_Nullable, std::size_t, void *_Nullable)
+{
+    tox_file_control(tox, friend_number, file_number, TOX_FILE_CONTROL_RESUME, nullptr);
+}
+
+void on_recv_chunk(Tox *_Nonnull, Tox_Friend_Number, Tox_File_Number, std::uint64_t,
+    const std::uint8_t *_Nullable, std::size_t length, void *_Nullable user_data)
+{
+    auto *self = static_cast<Node *>(user_data);
+    self->received += length;
+    if (length == 0) {
+        self->done = true;
+    }
+}
+
+void BM_TcpRelaySelection(benchmark::State &state)
+{
+    const auto selection = static_cast<Tox_Tcp_Relay_Selection>(state.range(0));
+
+    Simulation sim{12345};
+
+    struct ToxOptionsDeleter {
+        void operator()(Tox_Options *opts) { tox_options_free(opts); }
+    };
+    std::unique_ptr<Tox_Options, ToxOptionsDeleter> opts(tox_options_new(nullptr));
+    tox_options_set_ipv6_enabled(opts.get(), false);
+    tox_options_set_local_discovery_enabled(opts.get(), false);
+
+    // Declared before the nodes, whose sockets still pass through the filter
+    // when they are closed.
+    RelayLinks links(sim);
+
+    std::vector<Node> nodes(kRelays.size() + 2);
+
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        const bool relay = i < kRelays.size();
+        // Relays talk UDP among themselves for the DHT, clients only TCP.
+        tox_options_set_udp_enabled(opts.get(), relay);
+        tox_options_set_tcp_port(opts.get(), relay ? kRelays[i].port : 0);
+        tox_options_set_start_port(opts.get(), relay ? kRelays[i].port : 0);
+        tox_options_set_end_port(opts.get(), relay ? kRelays[i].port : 0);
+
+        nodes[i].node = sim.create_node();
+        nodes[i].tox = nodes[i].node->create_tox(opts.get());
+
+        if (nodes[i].tox == nullptr) {
+            state.SkipWithError("failed to create tox instances");
+            return;
+        }
+    }
+
+    Node &sender = nodes[kRelays.size()];
+    Node &receiver = nodes[kRelays.size() + 1];
+
+    for (std::size_t i = 0; i < kRelays.size(); ++i) {
+        links.add(nodes[i].node->ip, kRelays[i]);
+
+        char ip[TOX_INET_ADDRSTRLEN];
+        ip_parse_addr(&nodes[i].node->ip, ip, sizeof(ip));
+        std::uint8_t dht_id[TOX_PUBLIC_KEY_SIZE];
+        tox_self_get_dht_id(nodes[i].tox.get(), dht_id);
+
+        for (std::size_t j = 0; j < nodes.size(); ++j) {
+            if (j == i) {
+                continue;
+            }
+            if (j < kRelays.size()) {
+                tox_bootstrap(nodes[j].tox.get(), ip, kRelays[i].port, dht_id, nullptr);
+            } else {
+                tox_add_tcp_relay(nodes[j].tox.get(), ip, kRelays[i].port, dht_id, nullptr);
+            }
+        }
+    }
+
+    sim.net().add_filter([&links](Packet &p) { return links(p); });
+
+    for (Node *client : {&sender, &receiver}) {
+        tox_set_tcp_relay_selection(client->tox.get(), selection);
+    }
+
+    std::uint8_t pk[TOX_PUBLIC_KEY_SIZE];
+    tox_self_get_public_key(receiver.tox.get(), pk);
+    tox_friend_add_norequest(sender.tox.get(), pk, nullptr);
+    tox_self_get_public_key(sender.tox.get(), pk);
+    tox_friend_add_norequest(receiver.tox.get(), pk, nullptr);
+
+    tox_callback_friend_message(receiver.tox.get(), on_friend_message);
+    tox_callback_file_chunk_request(sender.tox.get(), on_chunk_request);
+    tox_callback_file_recv(receiver.tox.get(), on_file_recv);
+    tox_callback_file_recv_chunk(receiver.tox.get(), on_recv_chunk);
+
+    const auto run_until = [&](const auto &condition, std::uint64_t timeout_ms) {
+        const std::uint64_t start = sim.clock().current_time_ms();
+
+        while (!condition()) {
+            const std::uint64_t now = sim.clock().current_time_ms();
+            if (now - start > timeout_ms) {
+                return false;
+            }
+
+            for (Node &n : nodes) {
+                if (now >= n.next_run) {
+                    tox_iterate(n.tox.get(), &n);
+                    n.next_run = now + tox_iteration_interval(n.tox.get());
+                }
+            }
+
+            sim.advance_time(1);
+        }
+
+        return true;
+    };
+
+    const auto friends_connected = [&]() {
+        return tox_friend_get_connection_status(sender.tox.get(), 0, nullptr) != TOX_CONNECTION_NONE
+            && tox_friend_get_connection_status(receiver.tox.get(), 0, nullptr) != TOX_CONNECTION_NONE;
+    };
+
+    if (!run_until(friends_connected, kConnectTimeoutMs)) {
+        state.SkipWithError("failed to connect friends");
+        return;
+    }
+
+    const std::uint64_t warm_until = sim.clock().current_time_ms() + kWarmupMs;
+    run_until([&]() { return sim.clock().current_time_ms() >= warm_until; }, kWarmupMs + 1);
+
+    std::uint64_t message_ms = 0;
+    std::uint64_t messages = 0;
+    std::uint64_t transfer_ms = 0;
+    std::vector<std::uint64_t> relay_bytes(tox_tcp_relay_count(sender.tox.get()));
+
+    for (auto _ : state) {
+        for (std::uint32_t i = 0; i < kMessages; ++i) {
+            receiver.message_received = false;
+            const std::uint8_t msg[] = "ping";
+            const std::uint64_t start = sim.clock().current_time_ms();
+
+            tox_friend_send_message(
+                sender.tox.get(), 0, TOX_MESSAGE_TYPE_NORMAL, msg, sizeof(msg), nullptr);
+
+            if (!run_until([&]() { return receiver.message_received; }, kTimeoutMs)) {
+                state.SkipWithError("message timed out");
+                return;
+            }
+
+            message_ms += sim.clock().current_time_ms() - start;
+            ++messages;
+        }
+
+        const std::uint32_t relay_count = tox_tcp_relay_count(sender.tox.get());
+        std::vector<std::uint64_t> bytes_before(relay_count);
+        for (std::uint32_t i = 0; i < relay_count; ++i) {
+            bytes_before[i] = tox_tcp_relay_get_bytes_sent(sender.tox.get(), i);
+        }
+
+        receiver.done = false;
+        if (tox_file_send(sender.tox.get(), 0, TOX_FILE_KIND_DATA, kFileSize, nullptr,
+                reinterpret_cast<const std::uint8_t *>("file"), 4, nullptr)
+            == UINT32_MAX) {
+            state.SkipWithError("tox_file_send failed");
+            return;
+        }
+
+        const std::uint64_t start = sim.clock().current_time_ms();
+
+        if (!run_until([&]() { return receiver.done; }, kTimeoutMs)) {
+            state.SkipWithError("transfer timed out");
+            return;
+        }
+
+        transfer_ms += sim.clock().current_time_ms() - start;
+
+        relay_bytes.resize(std::max<std::size_t>(relay_bytes.size(), relay_count));
+        for (std::uint32_t i = 0; i < relay_count; ++i) {
+            relay_bytes[i] += tox_tcp_relay_get_bytes_sent(sender.tox.get(), i) - bytes_before[i];
+        }
+    }
+
+    std::uint32_t fastest = 0;
+    std::uint32_t fastest_rtt = UINT32_MAX;
+    std::uint64_t total_bytes = 0;
+
+    for (std::uint32_t i = 0; i < relay_bytes.size(); ++i) {
+        const std::uint32_t rtt = tox_tcp_relay_get_rtt(sender.tox.get(), i);
+        if (rtt != 0 && rtt < fastest_rtt) {
+            fastest = i;
+            fastest_rtt = rtt;
+        }
+        total_bytes += relay_bytes[i];
+    }
+
+    const double kib = static_cast<double>(receiver.received) / kKiB;
+
+    state.counters["message_ms"]
+        = messages == 0 ? 0.0 : static_cast<double>(message_ms) / static_cast<double>(messages);
+    state.counters["throughput_kib_s"]
+        = transfer_ms == 0 ? 0.0 : kib / (static_cast<double>(transfer_ms) / 1000.0);
+    state.counters["fastest_share"] = total_bytes == 0 || relay_bytes.empty()
+        ? 0.0
+        : static_cast<double>(relay_bytes[fastest]) / static_cast<double>(total_bytes);
+}
+
+// Setting up the relays and friends takes minutes of simulated time, so run a
+// single iteration of each mode.
+BENCHMARK(BM_TcpRelaySelection)
+    ->ArgName("selection")
+    ->Arg(TOX_TCP_RELAY_SELECTION_FIRST)
+    ->Arg(TOX_TCP_RELAY_SELECTION_FASTEST)
+    ->Arg(TOX_TCP_RELAY_SELECTION_STRIPED)
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -48,6 +48,11 @@ struct ACSession {
     /* Audio frame receive callback */
     ac_audio_receive_frame_cb *_Nullable acb;
     void *_Nullable user_data;
+
+    /* statistics, see ACStats */
+    uint32_t frames_decoded;
+    uint32_t frames_concealed;
+    uint32_t decode_time_us;
 };
 
 
@@ -56,6 +61,7 @@ static void jbuf_clear(struct JitterBuffer *_Nonnull q);
 static void jbuf_free(struct JitterBuffer *_Nullable q);
 static int jbuf_write(const Logger *_Nonnull log, struct JitterBuffer *_Nonnull q, struct RTPMessage *_Nonnull m);
 static struct RTPMessage *_Nullable jbuf_read(struct JitterBuffer *_Nonnull q, int32_t *_Nonnull success);
+static uint32_t jbuf_depth(const struct JitterBuffer *_Nonnull q);
 static OpusEncoder *_Nullable create_audio_encoder(const Logger *_Nonnull log, uint32_t bit_rate, uint32_t sampling_rate,
         uint8_t channel_count);
 static bool reconfigure_audio_encoder(const Logger *_Nonnull log, OpusEncoder *_Nonnull *_Nonnull e, uint32_t new_br, uint32_t new_sr,
@@ -182,6 +188,9 @@ void ac_iterate(ACSession *ac)
 
         pthread_mutex_unlock(ac->queue_mutex);
 
+        const bool concealed = rc == 2;
+        const uint64_t start_time = current_time_monotonic(ac->mono_time);
+
         if (rc == 2) {
             /* Packet Loss Concealment (PLC) */
             LOGGER_DEBUG(ac->log, "OPUS correction");
@@ -248,6 +257,20 @@ void ac_iterate(ACSession *ac)
             free(msg);
         }
 
+        if (rc >= 0) {
+            if (concealed) {
+                ++ac->frames_concealed;
+            } else {
+                ++ac->frames_decoded;
+            }
+
+            // Moving average over roughly the last 8 frames. The clock has
+            // millisecond resolution, but averaging makes up for that.
+            const uint64_t decode_time_ms = current_time_monotonic(ac->mono_time) - start_time;
+            ac->decode_time_us = ac->decode_time_us - ac->decode_time_us / 8
+                                 + (uint32_t)min_u64(decode_time_ms * 1000 / 8, UINT32_MAX / 8);
+        }
+
         if (rc < 0) {
             LOGGER_WARNING(ac->log, "Decoding error: %s", opus_strerror(rc));
         } else if (ac->acb != nullptr && ac->lp_sampling_rate != 0) {
@@ -316,6 +339,17 @@ uint32_t ac_get_lp_frame_duration(const ACSession *ac)
     return ac->lp_frame_duration;
 }
 
+void ac_get_stats(ACSession *ac, ACStats *stats)
+{
+    stats->frames_decoded = ac->frames_decoded;
+    stats->frames_concealed = ac->frames_concealed;
+    stats->decode_time_us = ac->decode_time_us;
+
+    pthread_mutex_lock(ac->queue_mutex);
+    stats->jitter_buffer_depth = jbuf_depth((const struct JitterBuffer *)ac->j_buf);
+    pthread_mutex_unlock(ac->queue_mutex);
+}
+
 int ac_encode(ACSession *ac, const int16_t *pcm, size_t sample_count, uint8_t *dest, size_t dest_max)
 {
     const int vrc = opus_encode(ac->encoder, pcm, (int)sample_count, dest, (int)dest_max);
@@ -446,6 +480,11 @@ static struct RTPMessage *jbuf_read(struct JitterBuffer *q, int32_t *success)
     *success = 0;
     return nullptr;
 }
+
+static uint32_t jbuf_depth(const struct JitterBuffer *q)
+{
+    return (uint16_t)(q->top - q->bottom);
+}
 static OpusEncoder *create_audio_encoder(const Logger *log, uint32_t bit_rate, uint32_t sampling_rate,
         uint8_t channel_count)
 {
@@ -40,6 +40,20 @@ typedef void ac_audio_receive_frame_cb(uint32_t friend_number, const int16_t *_N
 
 typedef struct ACSession ACSession;
 
+/**
+ * Decoder statistics of an audio session.
+ */
+typedef struct ACStats {
+    /** Number of frames decoded from received packets. */
+    uint32_t frames_decoded;
+    /** Number of frames synthesised by packet loss concealment. */
+    uint32_t frames_concealed;
+    /** Moving average of the time it took to decode a frame, in microseconds. */
+    uint32_t decode_time_us;
+    /** Number of packets (and gaps) waiting in the jitter buffer. */
+    uint32_t jitter_buffer_depth;
+} ACStats;
+
 struct RTPMessage;
 
 ACSession *_Nullable ac_new(Mono_Time *_Nonnull mono_time, const Logger *_Nonnull log, uint32_t friend_number,
@@ -51,6 +65,14 @@ int ac_reconfigure_encoder(ACSession *_Nullable ac, uint32_t bit_rate, uint32_t
 
 uint32_t ac_get_lp_frame_duration(const ACSession *_Nonnull ac);
 
+/**
+ * @brief Get the decoder statistics.
+ *
+ * The counters are updated by @ref ac_iterate without extra locking, so this
+ * must not be called concurrently with it.
+ */
+void ac_get_stats(ACSession *_Nonnull ac, ACStats *_Nonnull stats);
+
 int ac_encode(ACSession *_Nonnull ac, const int16_t *_Nonnull pcm, size_t sample_count, uint8_t *_Nonnull dest, size_t dest_max);
 
 #ifdef __cplusplus
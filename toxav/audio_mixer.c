@@ -0,0 +1,261 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+#include "audio_mixer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "../toxcore/ccompat.h"
+
+/**
+ * Number of frames a source buffers before it starts contributing to the mix.
+ * This absorbs the jitter between packet arrival and the mixer clock.
+ */
+#define AUDIO_MIX_PREBUFFER_FRAMES 2
+
+/**
+ * Maximum number of frames a source buffers. If a peer sends faster than the
+ * mixer consumes (clock drift, or a burst after a network hiccup), the oldest
+ * audio is dropped so the peer doesn't drift further and further behind.
+ */
+#define AUDIO_MIX_MAX_BUFFERED_FRAMES 5
+
+#define AUDIO_MIX_MAX_BUFFERED_SAMPLES (AUDIO_MIX_MAX_BUFFERED_FRAMES * AUDIO_MIX_FRAME_SAMPLES)
+
+static int16_t saturate_s16(int32_t value)
+{
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    }
+
+    if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+
+    return (int16_t)value;
+}
+
+void audio_mix_add_scalar(int16_t *dst, const int16_t *src, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = saturate_s16((int32_t)dst[i] + src[i]);
+    }
+}
+
+void audio_mix_add_gain_scalar(int16_t *dst, const int16_t *src, size_t count, uint16_t gain)
+{
+    for (size_t i = 0; i < count; ++i) {
+        // Arithmetic shift, like the SIMD versions: rounds towards -infinity.
+        const int32_t scaled = ((int32_t)src[i] * gain) >> 8;
+        dst[i] = saturate_s16((int32_t)dst[i] + saturate_s16(scaled));
+    }
+}
+
+void audio_mix_add(int16_t *dst, const int16_t *src, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+
+    for (; i + 8 <= count; i += 8) {
+        const __m128i d = _mm_loadu_si128((const __m128i *)(const void *)(dst + i));
+        const __m128i s = _mm_loadu_si128((const __m128i *)(const void *)(src + i));
+        _mm_storeu_si128((__m128i *)(void *)(dst + i), _mm_adds_epi16(d, s));
+    }
+
+#elif defined(__ARM_NEON)
+
+    for (; i + 8 <= count; i += 8) {
+        vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(dst + i), vld1q_s16(src + i)));
+    }
+
+#endif
+
+    audio_mix_add_scalar(dst + i, src + i, count - i);
+}
+
+void audio_mix_add_gain(int16_t *dst, const int16_t *src, size_t count, uint16_t gain)
+{
+    if (gain > AUDIO_MIX_MAX_GAIN) {
+        gain = AUDIO_MIX_MAX_GAIN;
+    }
+
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i g = _mm_set1_epi16((int16_t)gain);
+
+    for (; i + 8 <= count; i += 8) {
+        const __m128i s = _mm_loadu_si128((const __m128i *)(const void *)(src + i));
+        // Full 32 bit products from the low and high halves.
+        const __m128i lo = _mm_mullo_epi16(s, g);
+        const __m128i hi = _mm_mulhi_epi16(s, g);
+        const __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 8);
+        const __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 8);
+        const __m128i scaled = _mm_packs_epi32(p0, p1);
+        const __m128i d = _mm_loadu_si128((const __m128i *)(const void *)(dst + i));
+        _mm_storeu_si128((__m128i *)(void *)(dst + i), _mm_adds_epi16(d, scaled));
+    }
+
+#elif defined(__ARM_NEON)
+    const int16x4_t g = vdup_n_s16((int16_t)gain);
+
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t s = vld1q_s16(src + i);
+        const int32x4_t p0 = vmull_s16(vget_low_s16(s), g);
+        const int32x4_t p1 = vmull_s16(vget_high_s16(s), g);
+        const int16x8_t scaled = vcombine_s16(vqshrn_n_s32(p0, 8), vqshrn_n_s32(p1, 8));
+        vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(dst + i), scaled));
+    }
+
+#endif
+
+    audio_mix_add_gain_scalar(dst + i, src + i, count - i, gain);
+}
+
+struct Audio_Mix_Source {
+    uint8_t channels;
+    uint16_t gain;
+
+    /** Whether the source has filled up and contributes to the mix. */
+    bool primed;
+
+    /** Offset of the first buffered sample, in samples per channel. */
+    size_t start;
+    /** Number of buffered samples per channel. */
+    size_t length;
+
+    int16_t pcm[];
+};
+
+Audio_Mix_Source *audio_mix_source_new(uint8_t channels)
+{
+    if (channels != 1 && channels != 2) {
+        return nullptr;
+    }
+
+    Audio_Mix_Source *source = (Audio_Mix_Source *)calloc(
+                                   1, sizeof(Audio_Mix_Source) + AUDIO_MIX_MAX_BUFFERED_SAMPLES * channels * sizeof(int16_t));
+
+    if (source == nullptr) {
+        return nullptr;
+    }
+
+    source->channels = channels;
+    source->gain = AUDIO_MIX_UNITY_GAIN;
+    return source;
+}
+
+void audio_mix_source_kill(Audio_Mix_Source *source)
+{
+    free(source);
+}
+
+void audio_mix_source_set_gain(Audio_Mix_Source *source, uint16_t gain)
+{
+    source->gain = gain < AUDIO_MIX_MAX_GAIN ? gain : AUDIO_MIX_MAX_GAIN;
+}
+
+uint16_t audio_mix_source_get_gain(const Audio_Mix_Source *source)
+{
+    return source->gain;
+}
+
+/** Copy @p samples samples from @p in_channels to the source's channel count. */
+static void convert_channels(int16_t *_Nonnull dst, uint8_t channels,
+                             const int16_t *_Nonnull pcm, uint8_t in_channels, size_t samples)
+{
+    if (in_channels == channels) {
+        memcpy(dst, pcm, samples * channels * sizeof(int16_t));
+    } else if (channels == 1) {
+        // Stereo to mono: average both channels.
+        for (size_t i = 0; i < samples; ++i) {
+            dst[i] = (int16_t)(((int32_t)pcm[2 * i] + pcm[2 * i + 1]) >> 1);
+        }
+    } else {
+        // Mono to stereo: same sample on both channels.
+        for (size_t i = 0; i < samples; ++i) {
+            dst[2 * i] = pcm[i];
+            dst[2 * i + 1] = pcm[i];
+        }
+    }
+}
+
+bool audio_mix_source_push(Audio_Mix_Source *source, const int16_t *pcm, size_t samples, uint8_t channels)
+{
+    if (channels != 1 && channels != 2) {
+        return false;
+    }
+
+    if (samples > AUDIO_MIX_MAX_BUFFERED_SAMPLES) {
+        // Only the most recent audio fits anyway.
+        pcm += (samples - AUDIO_MIX_MAX_BUFFERED_SAMPLES) * channels;
+        samples = AUDIO_MIX_MAX_BUFFERED_SAMPLES;
+    }
+
+    if (source->length + samples > AUDIO_MIX_MAX_BUFFERED_SAMPLES) {
+        // Too far behind the mixer clock: drop the oldest audio.
+        const size_t drop = source->length + samples - AUDIO_MIX_MAX_BUFFERED_SAMPLES;
+        source->start += drop;
+        source->length -= drop;
+    }
+
+    if (source->start + source->length + samples > AUDIO_MIX_MAX_BUFFERED_SAMPLES) {
+        memmove(source->pcm, source->pcm + source->start * source->channels,
+                source->length * source->channels * sizeof(int16_t));
+        source->start = 0;
+    }
+
+    convert_channels(source->pcm + (source->start + source->length) * source->channels, source->channels,
+                     pcm, channels, samples);
+    source->length += samples;
+
+    if (source->length >= AUDIO_MIX_PREBUFFER_FRAMES * AUDIO_MIX_FRAME_SAMPLES) {
+        source->primed = true;
+    }
+
+    return true;
+}
+
+size_t audio_mix_source_buffered(const Audio_Mix_Source *source)
+{
+    return source->length;
+}
+
+size_t audio_mix_source_mix_into(Audio_Mix_Source *source, int16_t *frame)
+{
+    if (!source->primed) {
+        return 0;
+    }
+
+    const size_t samples = source->length < AUDIO_MIX_FRAME_SAMPLES ? source->length : AUDIO_MIX_FRAME_SAMPLES;
+    const int16_t *pcm = source->pcm + source->start * source->channels;
+
+    if (source->gain == AUDIO_MIX_UNITY_GAIN) {
+        audio_mix_add(frame, pcm, samples * source->channels);
+    } else {
+        audio_mix_add_gain(frame, pcm, samples * source->channels, source->gain);
+    }
+
+    source->start += samples;
+    source->length -= samples;
+
+    if (source->length == 0) {
+        source->start = 0;
+    }
+
+    if (samples < AUDIO_MIX_FRAME_SAMPLES) {
+        // Ran dry: fill up again before contributing, rather than stuttering
+        // in and out every frame.
+        source->primed = false;
+    }
+
+    return samples;
+}
@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+#ifndef C_TOXCORE_TOXAV_AUDIO_MIXER_H
+#define C_TOXCORE_TOXAV_AUDIO_MIXER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../toxcore/attributes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Sample rate of the mixed output. Conference audio is always decoded at 48 kHz. */
+#define AUDIO_MIX_SAMPLE_RATE 48000
+
+/** Length of one mixed output frame in milliseconds. */
+#define AUDIO_MIX_FRAME_MS 20
+
+/** Samples per channel in one mixed output frame. */
+#define AUDIO_MIX_FRAME_SAMPLES (AUDIO_MIX_SAMPLE_RATE / 1000 * AUDIO_MIX_FRAME_MS)
+
+/** Gain that leaves the samples unchanged. Gains are in units of 1/256. */
+#define AUDIO_MIX_UNITY_GAIN 256
+
+/** Largest supported gain (4x). */
+#define AUDIO_MIX_MAX_GAIN (4 * AUDIO_MIX_UNITY_GAIN)
+
+/**
+ * @brief Add @p count samples of @p src to @p dst, saturating at the int16
+ *   range instead of wrapping around.
+ *
+ * Uses SSE2 or NEON if available.
+ */
+void audio_mix_add(int16_t *_Nonnull dst, const int16_t *_Nonnull src, size_t count);
+
+/**
+ * @brief Like `audio_mix_add`, but scales @p src by `gain / 256` first.
+ *
+ * @param gain Between 0 and @ref AUDIO_MIX_MAX_GAIN.
+ */
+void audio_mix_add_gain(int16_t *_Nonnull dst, const int16_t *_Nonnull src, size_t count, uint16_t gain);
+
+/** @brief Portable version of `audio_mix_add`, for testing and benchmarks. */
+void audio_mix_add_scalar(int16_t *_Nonnull dst, const int16_t *_Nonnull src, size_t count);
+
+/** @brief Portable version of `audio_mix_add_gain`, for testing and benchmarks. */
+void audio_mix_add_gain_scalar(int16_t *_Nonnull dst, const int16_t *_Nonnull src, size_t count, uint16_t gain);
+
+/**
+ * One input of the mixer, e.g. the decoded audio of one conference peer.
+ *
+ * Decoded audio arrives in bursts and in packet sized chunks, while the mixer
+ * produces fixed size frames on its own clock. The source buffers the audio in
+ * between: it only starts contributing once it has a couple of frames
+ * buffered, and drops the oldest audio if it falls too far behind, so every
+ * source stays within a bounded distance of the mixer clock.
+ */
+typedef struct Audio_Mix_Source Audio_Mix_Source;
+
+/**
+ * @brief Create a mixer source.
+ *
+ * @param channels The number of channels of the mixed output (1 or 2). Input
+ *   with a different number of channels is converted when it is pushed.
+ */
+Audio_Mix_Source *_Nullable audio_mix_source_new(uint8_t channels);
+void audio_mix_source_kill(Audio_Mix_Source *_Nullable source);
+
+void audio_mix_source_set_gain(Audio_Mix_Source *_Nonnull source, uint16_t gain);
+uint16_t audio_mix_source_get_gain(const Audio_Mix_Source *_Nonnull source);
+
+/**
+ * @brief Append decoded audio to the source.
+ *
+ * @param pcm Interleaved samples, `samples * channels` values.
+ * @param samples Samples per channel.
+ * @param channels 1 or 2.
+ *
+ * @retval true on success.
+ * @retval false if the channel count is invalid.
+ */
+bool audio_mix_source_push(Audio_Mix_Source *_Nonnull source, const int16_t *_Nonnull pcm, size_t samples,
+                           uint8_t channels);
+
+/** @brief Number of samples per channel currently buffered. */
+size_t audio_mix_source_buffered(const Audio_Mix_Source *_Nonnull source);
+
+/**
+ * @brief Mix the next @ref AUDIO_MIX_FRAME_SAMPLES samples of the source into
+ *   @p frame.
+ *
+ * A source that is still filling up contributes nothing. If it runs dry, it
+ * contributes what it has left and then fills up again before it is heard
+ * again.
+ *
+ * @param frame `AUDIO_MIX_FRAME_SAMPLES * channels` samples.
+ *
+ * @return the number of samples per channel taken from the source.
+ */
+size_t audio_mix_source_mix_into(Audio_Mix_Source *_Nonnull source, int16_t *_Nonnull frame);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* C_TOXCORE_TOXAV_AUDIO_MIXER_H */
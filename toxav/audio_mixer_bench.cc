@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "audio_mixer.h"
+
+namespace {
+
+/** One 20 ms stereo frame of pseudo-random audio per peer. */
+std::vector<std::vector<std::int16_t>> make_peers(std::size_t count)
+{
+    std::vector<std::vector<std::int16_t>> peers(count);
+    std::uint32_t seed = 12345;
+    for (auto &pcm : peers) {
+        pcm.resize(AUDIO_MIX_FRAME_SAMPLES * 2);
+        for (auto &s : pcm) {
+            seed = seed * 1103515245 + 12345;
+            s = static_cast<std::int16_t>(seed >> 16);
+        }
+    }
+    return peers;
+}
+
+template <void (*Mix)(int16_t *_Nonnull, const int16_t *_Nonnull, std::size_t)>
+void BM_MixFrame(benchmark::State &state)
+{
+    const auto peers = make_peers(static_cast<std::size_t>(state.range(0)));
+    std::vector<std::int16_t> frame(AUDIO_MIX_FRAME_SAMPLES * 2);
+
+    for (auto _ : state) {
+        std::fill(frame.begin(), frame.end(), 0);
+        for (const auto &pcm : peers) {
+            Mix(frame.data(), pcm.data(), frame.size());
+        }
+        benchmark::DoNotOptimize(frame.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(
+        state.iterations() * state.range(0) * static_cast<std::int64_t>(frame.size() * sizeof(std::int16_t)));
+}
+
+template <void (*Mix)(int16_t *_Nonnull, const int16_t *_Nonnull, std::size_t, std::uint16_t)>
+void BM_MixFrameGain(benchmark::State &state)
+{
+    const auto peers = make_peers(static_cast<std::size_t>(state.range(0)));
+    std::vector<std::int16_t> frame(AUDIO_MIX_FRAME_SAMPLES * 2);
+
+    for (auto _ : state) {
+        std::fill(frame.begin(), frame.end(), 0);
+        for (const auto &pcm : peers) {
+            Mix(frame.data(), pcm.data(), frame.size(), AUDIO_MIX_UNITY_GAIN / 2);
+        }
+        benchmark::DoNotOptimize(frame.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(
+        state.iterations() * state.range(0) * static_cast<std::int64_t>(frame.size() * sizeof(std::int16_t)));
+}
+
+BENCHMARK(BM_MixFrame<audio_mix_add>)->Arg(2)->Arg(10)->Arg(50);
+BENCHMARK(BM_MixFrame<audio_mix_add_scalar>)->Arg(2)->Arg(10)->Arg(50);
+BENCHMARK(BM_MixFrameGain<audio_mix_add_gain>)->Arg(2)->Arg(10)->Arg(50);
+BENCHMARK(BM_MixFrameGain<audio_mix_add_gain_scalar>)->Arg(2)->Arg(10)->Arg(50);
+
+/** The whole per-frame path: buffering, alignment and mixing of all sources. */
+void BM_MixSources(benchmark::State &state)
+{
+    const std::size_t count = static_cast<std::size_t>(state.range(0));
+    const auto peers = make_peers(count);
+    std::vector<Audio_Mix_Source *> sources;
+    for (std::size_t i = 0; i < count; ++i) {
+        sources.push_back(audio_mix_source_new(2));
+        audio_mix_source_push(sources.back(), peers[i].data(), AUDIO_MIX_FRAME_SAMPLES, 2);
+    }
+    std::vector<std::int16_t> frame(AUDIO_MIX_FRAME_SAMPLES * 2);
+
+    for (auto _ : state) {
+        std::fill(frame.begin(), frame.end(), 0);
+        for (std::size_t i = 0; i < count; ++i) {
+            audio_mix_source_push(sources[i], peers[i].data(), AUDIO_MIX_FRAME_SAMPLES, 2);
+            audio_mix_source_mix_into(sources[i], frame.data());
+        }
+        benchmark::DoNotOptimize(frame.data());
+        benchmark::ClobberMemory();
+    }
+
+    for (Audio_Mix_Source *source : sources) {
+        audio_mix_source_kill(source);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_MixSources)->Arg(2)->Arg(10)->Arg(50);
+
+}  // namespace
+
+BENCHMARK_MAIN();
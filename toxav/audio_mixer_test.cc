@@ -0,0 +1,208 @@
+#include "audio_mixer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "../toxcore/attributes.h"
+
+namespace {
+
+std::vector<std::int16_t> random_pcm(std::size_t count, std::uint32_t seed)
+{
+    std::minstd_rand rng{seed};
+    std::uniform_int_distribution<int> dist(INT16_MIN, INT16_MAX);
+    std::vector<std::int16_t> pcm(count);
+    for (auto &s : pcm) {
+        s = static_cast<std::int16_t>(dist(rng));
+    }
+    return pcm;
+}
+
+TEST(AudioMixer, AddSaturates)
+{
+    std::vector<std::int16_t> dst = {30000, -30000, 100, INT16_MAX, INT16_MIN, 0, 1, -1, 20000};
+    const std::vector<std::int16_t> src = {10000, -10000, -200, 1, -1, 0, -1, 1, 20000};
+
+    audio_mix_add(dst.data(), src.data(), dst.size());
+
+    const std::vector<std::int16_t> expected
+        = {INT16_MAX, INT16_MIN, -100, INT16_MAX, INT16_MIN, 0, 0, 0, INT16_MAX};
+    EXPECT_EQ(dst, expected);
+}
+
+TEST(AudioMixer, AddMatchesScalar)
+{
+    // Odd length, so both the vector loop and the scalar tail are used.
+    const std::size_t count = 1027;
+    const std::vector<std::int16_t> src = random_pcm(count, 1);
+    std::vector<std::int16_t> simd = random_pcm(count, 2);
+    std::vector<std::int16_t> scalar = simd;
+
+    audio_mix_add(simd.data(), src.data(), count);
+    audio_mix_add_scalar(scalar.data(), src.data(), count);
+
+    EXPECT_EQ(simd, scalar);
+}
+
+TEST(AudioMixer, AddGainMatchesScalar)
+{
+    const std::size_t count = 1027;
+    const std::vector<std::int16_t> src = random_pcm(count, 3);
+
+    for (const std::uint16_t gain : {0, 64, 255, 256, 300, 512, 1024}) {
+        std::vector<std::int16_t> simd = random_pcm(count, 4);
+        std::vector<std::int16_t> scalar = simd;
+
+        audio_mix_add_gain(simd.data(), src.data(), count, gain);
+        audio_mix_add_gain_scalar(scalar.data(), src.data(), count, gain);
+
+        EXPECT_EQ(simd, scalar) << "gain " << gain;
+    }
+}
+
+TEST(AudioMixer, GainScales)
+{
+    std::vector<std::int16_t> dst(16, 0);
+    const std::vector<std::int16_t> src(16, 1000);
+
+    audio_mix_add_gain(dst.data(), src.data(), dst.size(), AUDIO_MIX_UNITY_GAIN / 2);
+    EXPECT_EQ(dst[0], 500);
+    EXPECT_EQ(dst[15], 500);
+
+    audio_mix_add_gain(dst.data(), src.data(), dst.size(), AUDIO_MIX_MAX_GAIN);
+    EXPECT_EQ(dst[0], 4500);
+
+    // Gains beyond the maximum are clamped.
+    std::vector<std::int16_t> big(16, 0);
+    audio_mix_add_gain(big.data(), src.data(), big.size(), 60000);
+    EXPECT_EQ(big[0], 4000);
+}
+
+class AudioMixSourceTest : public ::testing::Test {
+protected:
+    void TearDown() override { audio_mix_source_kill(source); }
+
+    void push_frames(std::size_t frames, std::int16_t value, std::uint8_t channels)
+    {
+        const std::vector<std::int16_t> pcm(AUDIO_MIX_FRAME_SAMPLES * channels * frames, value);
+        ASSERT_TRUE(audio_mix_source_push(source, pcm.data(), AUDIO_MIX_FRAME_SAMPLES * frames, channels));
+    }
+
+    Audio_Mix_Source *_Nullable source = nullptr;
+};
+
+TEST_F(AudioMixSourceTest, PrebuffersBeforeContributing)
+{
+    source = audio_mix_source_new(1);
+    ASSERT_NE(source, nullptr);
+
+    std::vector<std::int16_t> frame(AUDIO_MIX_FRAME_SAMPLES, 0);
+
+    push_frames(1, 100, 1);
+    EXPECT_EQ(audio_mix_source_mix_into(source, frame.data()), 0);
+    EXPECT_EQ(frame[0], 0);
+
+    push_frames(1, 100, 1);
+    EXPECT_EQ(audio_mix_source_mix_into(source, frame.data()), AUDIO_MIX_FRAME_SAMPLES);
+    EXPECT_EQ(frame[0], 100);
+    EXPECT_EQ(frame[AUDIO_MIX_FRAME_SAMPLES - 1], 100);
+    EXPECT_EQ(audio_mix_source_buffered(source), AUDIO_MIX_FRAME_SAMPLES);
+}
+
+TEST_F(AudioMixSourceTest, RunsDryThenRefills)
+{
+    source = audio_mix_source_new(1);
+    ASSERT_NE(source, nullptr);
+
+    // 2.5 frames: the third mix only gets half a frame.
+    push_frames(2, 10, 1);
+    const std::vector<std::int16_t> half(AUDIO_MIX_FRAME_SAMPLES / 2, 10);
+    audio_mix_source_push(source, half.data(), half.size(), 1);
+
+    std::vector<std::int16_t> frame(AUDIO_MIX_FRAME_SAMPLES, 0);
+    EXPECT_EQ(audio_mix_source_mix_into(source, frame.data()), AUDIO_MIX_FRAME_SAMPLES);
+    EXPECT_EQ(audio_mix_source_mix_into(source, frame.data()), AUDIO_MIX_FRAME_SAMPLES);
+    EXPECT_EQ(audio_mix_source_mix_into(source, frame.data()), AUDIO_MIX_FRAME_SAMPLES / 2);
+
+    // One frame is not enough to be heard again.
+    push_frames(1, 10, 1);
+    EXPECT_EQ(audio_mix_source_mix_into(source, frame.data()), 0);
+    push_frames(1, 10, 1);
+    EXPECT_EQ(audio_mix_source_mix_into(source, frame.data()), AUDIO_MIX_FRAME_SAMPLES);
+}
+
+TEST_F(AudioMixSourceTest, DropsOldestWhenTooFarBehind)
+{
+    source = audio_mix_source_new(1);
+    ASSERT_NE(source, nullptr);
+
+    push_frames(5, 1, 1);
+    push_frames(3, 2, 1);
+
+    // Bounded buffer: the oldest frames were dropped.
+    EXPECT_EQ(audio_mix_source_buffered(source), 5 * AUDIO_MIX_FRAME_SAMPLES);
+
+    std::vector<std::int16_t> frame(AUDIO_MIX_FRAME_SAMPLES, 0);
+    audio_mix_source_mix_into(source, frame.data());
+    audio_mix_source_mix_into(source, frame.data());
+    EXPECT_EQ(frame[0], 2);  // 1 + 1
+    std::fill(frame.begin(), frame.end(), 0);
+    audio_mix_source_mix_into(source, frame.data());
+    EXPECT_EQ(frame[0], 2);
+}
+
+TEST_F(AudioMixSourceTest, ConvertsChannels)
+{
+    source = audio_mix_source_new(2);
+    ASSERT_NE(source, nullptr);
+
+    push_frames(2, 300, 1);
+    std::vector<std::int16_t> frame(AUDIO_MIX_FRAME_SAMPLES * 2, 0);
+    audio_mix_source_mix_into(source, frame.data());
+    EXPECT_EQ(frame[0], 300);
+    EXPECT_EQ(frame[1], 300);
+
+    audio_mix_source_kill(source);
+    source = audio_mix_source_new(1);
+    ASSERT_NE(source, nullptr);
+
+    std::vector<std::int16_t> stereo(AUDIO_MIX_FRAME_SAMPLES * 2 * 2);
+    for (std::size_t i = 0; i < stereo.size(); i += 2) {
+        stereo[i] = 100;
+        stereo[i + 1] = 300;
+    }
+    audio_mix_source_push(source, stereo.data(), AUDIO_MIX_FRAME_SAMPLES * 2, 2);
+    std::vector<std::int16_t> mono(AUDIO_MIX_FRAME_SAMPLES, 0);
+    audio_mix_source_mix_into(source, mono.data());
+    EXPECT_EQ(mono[0], 200);
+}
+
+TEST_F(AudioMixSourceTest, AppliesGain)
+{
+    source = audio_mix_source_new(1);
+    ASSERT_NE(source, nullptr);
+    audio_mix_source_set_gain(source, AUDIO_MIX_UNITY_GAIN * 2);
+
+    push_frames(2, 1000, 1);
+    std::vector<std::int16_t> frame(AUDIO_MIX_FRAME_SAMPLES, 0);
+    audio_mix_source_mix_into(source, frame.data());
+    EXPECT_EQ(frame[0], 2000);
+}
+
+TEST_F(AudioMixSourceTest, RejectsInvalidChannels)
+{
+    EXPECT_EQ(audio_mix_source_new(0), nullptr);
+    EXPECT_EQ(audio_mix_source_new(3), nullptr);
+
+    source = audio_mix_source_new(1);
+    ASSERT_NE(source, nullptr);
+    const std::int16_t pcm[6] = {0};
+    EXPECT_FALSE(audio_mix_source_push(source, pcm, 2, 3));
+}
+
+}  // namespace
@@ -11,16 +11,17 @@
 
 #include "ring_buffer.h"
 
+#include "../toxcore/atomics.h"
 #include "../toxcore/ccompat.h"
 #include "../toxcore/logger.h"
 #include "../toxcore/mono_time.h"
 #include "../toxcore/network.h"
 #include "../toxcore/util.h"
 
-
 #define BWC_SEND_INTERVAL_MS 950     // 0.95s
 #define BWC_AVG_PKT_COUNT 20
 #define BWC_AVG_LOSS_OVER_CYCLES_COUNT 30
+#define BWC_SEND_LOSS_TIMEOUT_MS 5000
 
 typedef struct BWCCycle {
     uint32_t last_recv_timestamp; /* Last recv update time stamp */
@@ -51,6 +52,14 @@ struct BWController {
     uint32_t packet_loss_counted_cycles;
     Mono_Time *_Nonnull bwc_mono_time;
     bool bwc_receive_active; /* if this is set to false then incoming bwc packets will not be processed by bwc_handle_data() */
+
+    /*
+     * Written on the tox thread, read by the getters on any thread. The
+     * losses are the bits of a float.
+     */
+    Tox_Atomic_U32 receive_loss; /* Loss in the last completed cycle */
+    Tox_Atomic_U32 send_loss; /* Loss in the last update from the peer */
+    Tox_Atomic_U32 send_loss_time; /* Time of the last update from the peer */
 };
 
 struct BWCMessage {
@@ -60,6 +69,21 @@ struct BWCMessage {
 
 static void send_update(BWController *_Nonnull bwc);
 
+static void stat_store_loss(Tox_Atomic_U32 *_Nonnull stat, float loss)
+{
+    uint32_t bits;
+    memcpy(&bits, &loss, sizeof(bits));
+    tox_atomic_u32_store(stat, bits);
+}
+
+static float stat_load_loss(const Tox_Atomic_U32 *_Nonnull stat)
+{
+    const uint32_t bits = tox_atomic_u32_load(stat);
+    float loss;
+    memcpy(&loss, &bits, sizeof(loss));
+    return loss;
+}
+
 
 BWController *bwc_new(const Logger *log, uint32_t friendnumber,
                       bwc_loss_report_cb *mcb, void *mcb_user_data,
@@ -137,6 +161,8 @@ static void send_update(BWController *bwc)
     if (bwc->packet_loss_counted_cycles > BWC_AVG_LOSS_OVER_CYCLES_COUNT &&
             current_time_monotonic(bwc->bwc_mono_time) - bwc->cycle.last_sent_timestamp > BWC_SEND_INTERVAL_MS) {
         bwc->packet_loss_counted_cycles = 0;
+        stat_store_loss(&bwc->receive_loss, bwc->cycle.lost == 0 ? 0.0F
+                        : (float)((double)bwc->cycle.lost / ((double)bwc->cycle.recv + (double)bwc->cycle.lost)));
 
         if (bwc->cycle.lost != 0) {
             LOGGER_DEBUG(bwc->log, "%p Sent update rcv: %u lost: %u percent: %f %%",
@@ -177,6 +203,9 @@ static int on_update(BWController *_Nonnull bwc, const struct BWCMessage *_Nonnu
 
     const uint32_t lost = msg->lost;
 
+    stat_store_loss(&bwc->send_loss, lost == 0 ? 0.0F : (float)((double)lost / ((double)msg->recv + (double)lost)));
+    tox_atomic_u32_store(&bwc->send_loss_time, bwc->cycle.last_recv_timestamp);
+
     if (lost != 0 && bwc->mcb != nullptr) {
         const uint32_t recv = msg->recv;
         LOGGER_DEBUG(bwc->log, "recved: %u lost: %u percentage: %f %%", recv, lost,
@@ -213,3 +242,20 @@ void bwc_handle_packet(BWController *bwc, const uint8_t *data, size_t length)
 
     on_update(bwc, &msg);
 }
+
+float bwc_get_receive_loss(const BWController *bwc)
+{
+    return stat_load_loss(&bwc->receive_loss);
+}
+
+float bwc_get_send_loss(const BWController *bwc)
+{
+    const uint32_t now = (uint32_t)current_time_monotonic(bwc->bwc_mono_time);
+    const uint32_t send_loss_time = tox_atomic_u32_load(&bwc->send_loss_time);
+
+    if (send_loss_time == 0 || now - send_loss_time > BWC_SEND_LOSS_TIMEOUT_MS) {
+        return 0.0F;
+    }
+
+    return stat_load_loss(&bwc->send_loss);
+}
@@ -35,6 +35,21 @@ void bwc_add_recv(BWController *_Nullable bwc, uint32_t recv_bytes);
 
 void bwc_handle_packet(BWController *_Nullable bwc, const uint8_t *_Nonnull data, size_t length);
 
+/**
+ * @brief Fraction of the incoming media data lost in the last completed
+ *   measurement cycle, between 0 and 1.
+ */
+float bwc_get_receive_loss(const BWController *_Nonnull bwc);
+
+/**
+ * @brief Fraction of the outgoing media data lost, as last reported by the
+ *   peer, between 0 and 1.
+ *
+ * The peer only reports loss when there is some, so this is 0 if no report
+ * arrived for a few seconds.
+ */
+float bwc_get_send_loss(const BWController *_Nonnull bwc);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -361,6 +361,43 @@ TEST_F(BwcTest, RateLimitBypassBug)
     bwc_kill(bwc);
 }
 
+TEST_F(BwcTest, LossGetters)
+{
+    MockBwcData sd;
+    BWController *bwc = bwc_new(
+        log, 123, MockBwcData::loss_report, &sd, MockBwcData::send_packet, &sd, mono_time);
+    ASSERT_NE(bwc, nullptr);
+
+    EXPECT_EQ(bwc_get_receive_loss(bwc), 0.0f);
+    EXPECT_EQ(bwc_get_send_loss(bwc), 0.0f);
+
+    // Incoming loss, measured locally once a cycle completes.
+    for (int i = 0; i < 30; ++i) {
+        bwc_add_recv(bwc, 1000);
+    }
+    bwc_add_lost(bwc, 11000);
+    tm.t += 1000;
+    mono_time_update(mono_time);
+    bwc_add_recv(bwc, 1000);
+    ASSERT_EQ(sd.sent_packets.size(), 1);
+    EXPECT_FLOAT_EQ(bwc_get_receive_loss(bwc), 11000.0f / (11000.0f + 31000.0f));
+
+    // Outgoing loss, as reported by the peer.
+    std::uint8_t packet[9];
+    packet[0] = BWC_PACKET_ID;
+    net_pack_u32(packet + 1, 100);  // lost
+    net_pack_u32(packet + 5, 300);  // recv
+    bwc_handle_packet(bwc, packet, sizeof(packet));
+    EXPECT_FLOAT_EQ(bwc_get_send_loss(bwc), 0.25f);
+
+    // The peer stops reporting once the loss is gone.
+    tm.t += 6000;
+    mono_time_update(mono_time);
+    EXPECT_EQ(bwc_get_send_loss(bwc), 0.0f);
+
+    bwc_kill(bwc);
+}
+
 TEST_F(BwcTest, NoCrashOnNullSendPacket)
 {
     BWController *bwc = bwc_new(log, 123, nullptr, nullptr, nullptr, nullptr, mono_time);
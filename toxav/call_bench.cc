@@ -0,0 +1,409 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// End-to-end benchmark of ToxAV calls over the simulated network.
+//
+// Every call runs the full media path in both directions: encode, RTP
+// packetisation, pacing, net_crypto, the simulated network, reassembly,
+// decoding and the receive callback. The network applies the configured
+// latency, jitter and loss to every UDP packet once the calls are set up.
+//
+// Reported counters:
+// - p50_ms/p95_ms/p99_ms: glass-to-glass video latency on the simulated clock,
+//   i.e. from toxav_video_send_frame to the receive callback. Encode and decode
+//   don't take simulated time, so this measures network, pacing and buffering
+//   delay, quantised to the simulation step.
+// - video_delivery/audio_delivery: fraction of the sent frames that arrived.
+// - cpu_ms_per_call: CPU time spent per call per simulated second.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../testing/support/public/simulation.hh"
+#include "../toxcore/attributes.h"
+#include "../toxcore/network.h"
+#include "../toxcore/tox.h"
+#include "av_test_support.hh"
+#include "toxav.h"
+
+namespace {
+
+using tox::test::Packet;
+using tox::test::SimulatedNode;
+using tox::test::Simulation;
+
+constexpr std::uint64_t kStepMs = 5;
+constexpr std::uint64_t kAudioFrameMs = 20;
+constexpr std::uint64_t kVideoFrameMs = 40;  // 25 fps
+constexpr std::uint64_t kWarmupMs = 2000;
+
+constexpr std::uint32_t kSamplingRate = 48000;
+constexpr std::uint8_t kChannels = 1;
+constexpr std::size_t kSampleCount = kSamplingRate / 1000 * kAudioFrameMs;
+
+constexpr std::uint16_t kWidth = 320;
+constexpr std::uint16_t kHeight = 240;
+
+constexpr std::uint32_t kAudioBitRate = 48;
+constexpr std::uint32_t kVideoBitRate = 500;
+
+// Each video frame carries its sequence number in the luma plane, as one
+// black or white 16x16 block per bit along the top edge. This survives lossy
+// encoding and identifies the frame on the receiving side.
+constexpr int kMarkerBits = 16;
+constexpr int kMarkerBlock = 16;
+
+void write_marker(std::vector<std::uint8_t> &y, std::uint16_t seq)
+{
+    for (int bit = 0; bit < kMarkerBits; ++bit) {
+        const std::uint8_t value = (seq >> bit) & 1 ? 235 : 16;
+        for (int r = 0; r < kMarkerBlock; ++r) {
+            std::fill_n(&y[r * kWidth + bit * kMarkerBlock], kMarkerBlock, value);
+        }
+    }
+}
+
+std::uint16_t read_marker(const std::uint8_t *_Nonnull y, std::int32_t ystride)
+{
+    std::uint16_t seq = 0;
+    for (int bit = 0; bit < kMarkerBits; ++bit) {
+        const std::uint8_t value
+            = y[(kMarkerBlock / 2) * ystride + bit * kMarkerBlock + kMarkerBlock / 2];
+        if (value > 128) {
+            seq |= 1 << bit;
+        }
+    }
+    return seq;
+}
+
+struct Totals {
+    std::vector<std::uint32_t> latencies;
+    std::uint64_t audio_sent = 0;
+    std::uint64_t audio_received = 0;
+    std::uint64_t video_sent = 0;
+    std::uint64_t video_received = 0;
+
+    void reset() { *this = Totals{}; }
+};
+
+/** One side of a call. Both sides send audio and video to each other. */
+struct Endpoint {
+    Simulation *_Nonnull sim;
+    Totals *_Nonnull totals;
+    std::unique_ptr<SimulatedNode> node;
+    SimulatedNode::ToxPtr tox;
+    ToxAV *_Nullable av = nullptr;
+    Endpoint *_Nullable peer = nullptr;
+
+    bool in_call = false;
+
+    std::uint16_t next_seq = 0;
+    std::vector<std::uint64_t> send_times = std::vector<std::uint64_t>(1 << kMarkerBits);
+
+    std::vector<std::int16_t> pcm = std::vector<std::int16_t>(kSampleCount * kChannels);
+    std::vector<std::uint8_t> y = std::vector<std::uint8_t>(kWidth * kHeight);
+    std::vector<std::uint8_t> u = std::vector<std::uint8_t>(kWidth / 2 * kHeight / 2);
+    std::vector<std::uint8_t> v = std::vector<std::uint8_t>(kWidth / 2 * kHeight / 2);
+    int audio_index = 0;
+
+    Endpoint(Simulation &sim_in, Totals &totals_in)
+        : sim(&sim_in)
+        , totals(&totals_in)
+        , node(sim_in.create_node())
+        , tox(node->create_tox())
+    {
+    }
+
+    ~Endpoint()
+    {
+        if (av != nullptr) {
+            toxav_kill(av);
+        }
+    }
+
+    Endpoint(const Endpoint &) = delete;
+    Endpoint &operator=(const Endpoint &) = delete;
+
+    bool init()
+    {
+        if (tox == nullptr) {
+            return false;
+        }
+
+        av = toxav_new(tox.get(), nullptr);
+        if (av == nullptr) {
+            return false;
+        }
+
+        toxav_callback_call(av, on_call, this);
+        toxav_callback_call_state(av, on_call_state, this);
+        toxav_callback_audio_receive_frame(av, on_audio_frame, this);
+        toxav_callback_video_receive_frame(av, on_video_frame, this);
+        return true;
+    }
+
+    void iterate()
+    {
+        tox_iterate(tox.get(), nullptr);
+        toxav_iterate(av);
+    }
+
+    void send_audio()
+    {
+        fill_audio_frame(kSamplingRate, kChannels, audio_index++, kSampleCount, pcm);
+        if (toxav_audio_send_frame(av, 0, pcm.data(), kSampleCount, kChannels, kSamplingRate, nullptr)) {
+            ++totals->audio_sent;
+        }
+    }
+
+    void send_video()
+    {
+        const std::uint16_t seq = next_seq++;
+        fill_video_frame(kWidth, kHeight, seq, y, u, v);
+        write_marker(y, seq);
+        send_times[seq] = sim->clock().current_time_ms();
+        if (toxav_video_send_frame(av, 0, kWidth, kHeight, y.data(), u.data(), v.data(), nullptr)) {
+            ++totals->video_sent;
+        }
+    }
+
+    static void on_call(ToxAV *_Nonnull av, Tox_Friend_Number friend_number, bool, bool,
+        void *_Nullable user_data)
+    {
+        auto *self = static_cast<Endpoint *>(user_data);
+        self->in_call = toxav_answer(av, friend_number, kAudioBitRate, kVideoBitRate, nullptr);
+    }
+
+    static void on_call_state(
+        ToxAV *_Nonnull, Tox_Friend_Number, std::uint32_t state, void *_Nullable user_data)
+    {
+        auto *self = static_cast<Endpoint *>(user_data);
+        self->in_call = (state
+                            & (TOXAV_FRIEND_CALL_STATE_ERROR | TOXAV_FRIEND_CALL_STATE_FINISHED))
+            == 0;
+    }
+
+    static void on_audio_frame(ToxAV *_Nonnull, Tox_Friend_Number, const std::int16_t *_Nonnull,
+        std::size_t, std::uint8_t, std::uint32_t, void *_Nullable user_data)
+    {
+        auto *self = static_cast<Endpoint *>(user_data);
+        ++self->totals->audio_received;
+    }
+
+    static void on_video_frame(ToxAV *_Nonnull, Tox_Friend_Number, std::uint16_t width,
+        std::uint16_t height, const std::uint8_t *_Nonnull y, const std::uint8_t *_Nonnull,
+        const std::uint8_t *_Nonnull, std::int32_t ystride, std::int32_t, std::int32_t,
+        void *_Nullable user_data)
+    {
+        auto *self = static_cast<Endpoint *>(user_data);
+        if (width != kWidth || height != kHeight) {
+            return;
+        }
+
+        const std::uint16_t seq = read_marker(y, ystride);
+        const std::uint64_t sent = self->peer->send_times[seq];
+        const std::uint64_t now = self->sim->clock().current_time_ms();
+        ++self->totals->video_received;
+
+        if (sent != 0 && now >= sent) {
+            self->totals->latencies.push_back(static_cast<std::uint32_t>(now - sent));
+        }
+    }
+};
+
+struct Call {
+    std::unique_ptr<Endpoint> caller;
+    std::unique_ptr<Endpoint> callee;
+};
+
+bool connect(Simulation &sim, std::vector<Call> &calls)
+{
+    for (Call &call : calls) {
+        Endpoint &a = *call.caller;
+        Endpoint &b = *call.callee;
+
+        std::uint8_t pk_a[TOX_PUBLIC_KEY_SIZE];
+        std::uint8_t pk_b[TOX_PUBLIC_KEY_SIZE];
+        tox_self_get_public_key(a.tox.get(), pk_a);
+        tox_self_get_public_key(b.tox.get(), pk_b);
+
+        if (tox_friend_add_norequest(a.tox.get(), pk_b, nullptr) != 0
+            || tox_friend_add_norequest(b.tox.get(), pk_a, nullptr) != 0) {
+            return false;
+        }
+
+        std::uint8_t dht_id[TOX_PUBLIC_KEY_SIZE];
+        tox_self_get_dht_id(a.tox.get(), dht_id);
+        char ip_str[TOX_INET_ADDRSTRLEN];
+        ip_parse_addr(&a.node->ip, ip_str, sizeof(ip_str));
+        tox_bootstrap(b.tox.get(), ip_str, a.node->get_primary_socket()->local_port(), dht_id, nullptr);
+    }
+
+    const auto all = [&](auto &&pred) {
+        return std::all_of(calls.begin(), calls.end(), pred);
+    };
+
+    const auto iterate_all = [&]() {
+        for (Call &call : calls) {
+            call.caller->iterate();
+            call.callee->iterate();
+        }
+    };
+
+    sim.run_until(
+        [&]() {
+            iterate_all();
+            return all([](const Call &call) {
+                return tox_friend_get_connection_status(call.caller->tox.get(), 0, nullptr)
+                    != TOX_CONNECTION_NONE
+                    && tox_friend_get_connection_status(call.callee->tox.get(), 0, nullptr)
+                    != TOX_CONNECTION_NONE;
+            });
+        },
+        60000);
+
+    for (Call &call : calls) {
+        if (!toxav_call(call.caller->av, 0, kAudioBitRate, kVideoBitRate, nullptr)) {
+            return false;
+        }
+    }
+
+    sim.run_until(
+        [&]() {
+            iterate_all();
+            return all([](const Call &call) { return call.caller->in_call && call.callee->in_call; });
+        },
+        10000);
+
+    return all([](const Call &call) { return call.caller->in_call && call.callee->in_call; });
+}
+
+/** Run all calls for @p duration_ms of simulated time. */
+void run_calls(Simulation &sim, std::vector<Call> &calls, std::uint64_t duration_ms)
+{
+    for (std::uint64_t t = 0; t < duration_ms; t += kStepMs) {
+        const std::uint64_t now = sim.clock().current_time_ms();
+        const bool audio_due = now % kAudioFrameMs == 0;
+        const bool video_due = now % kVideoFrameMs == 0;
+
+        for (Call &call : calls) {
+            for (Endpoint *ep : {call.caller.get(), call.callee.get()}) {
+                if (audio_due) {
+                    ep->send_audio();
+                }
+                if (video_due) {
+                    ep->send_video();
+                }
+                ep->iterate();
+            }
+        }
+
+        sim.advance_time(kStepMs);
+    }
+}
+
+std::uint32_t percentile(const std::vector<std::uint32_t> &sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1))];
+}
+
+void BM_Calls(benchmark::State &state)
+{
+    const auto num_calls = static_cast<std::size_t>(state.range(0));
+    const auto latency_ms = static_cast<std::uint64_t>(state.range(1));
+    const auto jitter_ms = static_cast<std::uint64_t>(state.range(2));
+    const double loss = static_cast<double>(state.range(3)) / 100.0;
+
+    // The simulated clock starts and advances in multiples of kStepMs, so
+    // frames fall due exactly on a step.
+    Simulation sim{12345};
+    sim.net().set_latency(latency_ms);
+
+    bool impaired = false;
+    std::minstd_rand rng{42};
+    sim.net().add_filter([&](Packet &p) {
+        if (!impaired || p.is_tcp) {
+            return true;
+        }
+        if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < loss) {
+            return false;
+        }
+        if (jitter_ms != 0) {
+            p.delivery_time += std::uniform_int_distribution<std::uint64_t>(0, jitter_ms)(rng);
+        }
+        return true;
+    });
+
+    Totals totals;
+    std::vector<Call> calls;
+    for (std::size_t i = 0; i < num_calls; ++i) {
+        Call call{std::make_unique<Endpoint>(sim, totals), std::make_unique<Endpoint>(sim, totals)};
+        if (!call.caller->init() || !call.callee->init()) {
+            state.SkipWithError("failed to create ToxAV instance");
+            return;
+        }
+        call.caller->peer = call.callee.get();
+        call.callee->peer = call.caller.get();
+        calls.push_back(std::move(call));
+    }
+
+    if (!connect(sim, calls)) {
+        state.SkipWithError("failed to set up calls");
+        return;
+    }
+
+    impaired = true;
+
+    // Let the encoders, bandwidth controllers and jitter buffers settle.
+    run_calls(sim, calls, kWarmupMs);
+    totals.reset();
+
+    const std::clock_t cpu_start = std::clock();
+
+    for (auto _ : state) {
+        run_calls(sim, calls, 1000);
+    }
+
+    const double cpu_ms = 1000.0 * static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    std::sort(totals.latencies.begin(), totals.latencies.end());
+    state.counters["p50_ms"] = percentile(totals.latencies, 0.50);
+    state.counters["p95_ms"] = percentile(totals.latencies, 0.95);
+    state.counters["p99_ms"] = percentile(totals.latencies, 0.99);
+    state.counters["video_delivery"] = totals.video_sent == 0
+        ? 0.0
+        : static_cast<double>(totals.video_received) / static_cast<double>(totals.video_sent);
+    state.counters["audio_delivery"] = totals.audio_sent == 0
+        ? 0.0
+        : static_cast<double>(totals.audio_received) / static_cast<double>(totals.audio_sent);
+    state.counters["cpu_ms_per_call"]
+        = cpu_ms / static_cast<double>(state.iterations()) / static_cast<double>(num_calls);
+}
+
+// Each iteration is one second of simulated time for all calls. The setup
+// (connecting and starting the calls) is expensive, so run a fixed number of
+// iterations instead of letting the library pick one.
+BENCHMARK(BM_Calls)
+    ->ArgNames({"calls", "latency_ms", "jitter_ms", "loss_pct"})
+    ->Args({1, 20, 0, 0})
+    ->Args({1, 50, 10, 1})
+    ->Args({1, 100, 30, 5})
+    ->Args({4, 50, 10, 1})
+    ->Args({16, 50, 10, 1})
+    ->Iterations(10)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
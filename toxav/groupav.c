@@ -12,10 +12,17 @@
 #include "../toxcore/mono_time.h"
 #include "../toxcore/tox_struct.h"
 #include "../toxcore/util.h"
+#include "audio_mixer.h"
 
 #define GROUP_JBUF_SIZE 6
 #define GROUP_JBUF_DEAD_SECONDS 4
 
+/**
+ * If the mixer clock falls behind by more than this (because no audio arrived
+ * for a while), it restarts instead of catching up with a burst of frames.
+ */
+#define GROUP_AV_MIX_RESYNC_MS 200
+
 typedef struct Group_Audio_Packet {
     uint16_t sequnum;
     uint16_t length;
@@ -174,6 +181,11 @@ typedef struct Group_AV {
 
     audio_data_cb *_Nullable audio_data;
     void *_Nullable userdata;
+
+    /* Number of channels of the mixed output, 0 if audio is delivered per peer. */
+    uint8_t mix_channels;
+    /* Time at which the next mixed frame is due, 0 if the mixer clock is stopped. */
+    uint64_t next_mix_time;
 } Group_AV;
 
 typedef struct Group_Peer_AV {
@@ -183,6 +195,10 @@ typedef struct Group_Peer_AV {
     OpusDecoder *_Nullable audio_decoder;
     int decoder_channels;
     unsigned int last_packet_samples;
+
+    /* Decoded audio waiting to be mixed. Created on demand in mixed mode. */
+    Audio_Mix_Source *_Nullable mix_source;
+    uint16_t mix_gain;
 } Group_Peer_AV;
 
 static void kill_group_av(Group_AV *_Nonnull group_av)
@@ -266,6 +282,7 @@ static void group_av_peer_new(void *_Nonnull object, Tox_Conference_Number confe
 
     peer_av->mono_time = g_mono_time(group_av->g_c);
     peer_av->buffer = create_queue(GROUP_JBUF_SIZE);
+    peer_av->mix_gain = AUDIO_MIX_UNITY_GAIN;
 
     if (group_peer_set_object(group_av->g_c, conference_number, peer_number, peer_av) == -1) {
         free(peer_av);
@@ -285,6 +302,7 @@ static void group_av_peer_delete(void *_Nullable object, Tox_Conference_Number c
     }
 
     terminate_queue(peer_av->buffer);
+    audio_mix_source_kill(peer_av->mix_source);
     free(peer_object);
 }
 
@@ -390,7 +408,20 @@ static int decode_audio_packet(Group_AV *_Nonnull group_av, Group_Peer_AV *_Nonn
 
     if (out_audio != nullptr) {
 
-        if (group_av->audio_data != nullptr) {
+        if (group_av->mix_channels != 0) {
+            if (peer_av->mix_source == nullptr) {
+                peer_av->mix_source = audio_mix_source_new(group_av->mix_channels);
+
+                if (peer_av->mix_source != nullptr) {
+                    audio_mix_source_set_gain(peer_av->mix_source, peer_av->mix_gain);
+                }
+            }
+
+            if (peer_av->mix_source != nullptr) {
+                audio_mix_source_push(peer_av->mix_source, out_audio, (size_t)out_audio_samples,
+                                      (uint8_t)peer_av->decoder_channels);
+            }
+        } else if (group_av->audio_data != nullptr) {
             group_av->audio_data(group_av->tox, conference_number, peer_number, out_audio, (uint32_t)out_audio_samples,
                                  (uint8_t)peer_av->decoder_channels, sample_rate, group_av->userdata);
         }
@@ -402,6 +433,51 @@ static int decode_audio_packet(Group_AV *_Nonnull group_av, Group_Peer_AV *_Nonn
     return -1;
 }
 
+/**
+ * Deliver the mixed frames that are due according to the mixer clock, each
+ * one the sum of the next frame of every peer's buffered audio.
+ *
+ * The clock is driven by incoming audio. After a gap in which nobody sent
+ * anything, it restarts rather than catching up with a burst of silence.
+ */
+static void group_av_mix(Group_AV *_Nonnull group_av, Tox_Conference_Number conference_number,
+                         const Mono_Time *_Nonnull mono_time)
+{
+    const uint64_t now = current_time_monotonic(mono_time);
+
+    if (group_av->next_mix_time == 0 || now > group_av->next_mix_time + GROUP_AV_MIX_RESYNC_MS) {
+        group_av->next_mix_time = now;
+    }
+
+    const int numpeers = group_number_peers(group_av->g_c, conference_number, false);
+
+    if (numpeers < 0) {
+        return;
+    }
+
+    int16_t frame[AUDIO_MIX_FRAME_SAMPLES * 2];
+    const size_t frame_length = AUDIO_MIX_FRAME_SAMPLES * group_av->mix_channels;
+
+    while (group_av->next_mix_time <= now) {
+        memset(frame, 0, frame_length * sizeof(int16_t));
+
+        for (uint32_t i = 0; i < (uint32_t)numpeers; ++i) {
+            Group_Peer_AV *peer_av = (Group_Peer_AV *)group_peer_get_object(group_av->g_c, conference_number, i);
+
+            if (peer_av != nullptr && peer_av->mix_source != nullptr) {
+                audio_mix_source_mix_into(peer_av->mix_source, frame);
+            }
+        }
+
+        group_av->next_mix_time += AUDIO_MIX_FRAME_MS;
+
+        if (group_av->audio_data != nullptr) {
+            group_av->audio_data(group_av->tox, conference_number, GROUP_AV_MIXED_PEER, frame, AUDIO_MIX_FRAME_SAMPLES,
+                                 group_av->mix_channels, AUDIO_MIX_SAMPLE_RATE, group_av->userdata);
+        }
+    }
+}
+
 static int handle_group_audio_packet(void *_Nonnull object, Tox_Conference_Number conference_number, Tox_Conference_Peer_Number peer_number, void *_Nonnull peer_object,
                                      const uint8_t *_Nonnull packet, uint16_t length)
 {
@@ -439,6 +515,10 @@ static int handle_group_audio_packet(void *_Nonnull object, Tox_Conference_Numbe
         /* Continue. */
     }
 
+    if (group_av->mix_channels != 0) {
+        group_av_mix(group_av, conference_number, peer_av->mono_time);
+    }
+
     return 0;
 }
 
@@ -531,6 +611,80 @@ bool groupchat_av_enabled(const Group_Chats *g_c, Tox_Conference_Number conferen
     return group_get_object(g_c, conference_number) != nullptr;
 }
 
+/** @brief Switch between per-peer audio callbacks and a single mixed stream.
+ *
+ * @retval 0 on success.
+ * @retval -1 on failure.
+ */
+int groupchat_av_set_mixing(const Group_Chats *g_c, Tox_Conference_Number conference_number, uint8_t channels)
+{
+    if (channels > 2) {
+        return -1;
+    }
+
+    Group_AV *group_av = (Group_AV *)group_get_object(g_c, conference_number);
+
+    if (group_av == nullptr) {
+        return -1;
+    }
+
+    if (group_av->mix_channels == channels) {
+        return 0;
+    }
+
+    const int numpeers = group_number_peers(g_c, conference_number, false);
+
+    if (numpeers < 0) {
+        return -1;
+    }
+
+    // Buffered audio has the old channel count, so start over. Sources are
+    // created again when the next audio arrives.
+    for (uint32_t i = 0; i < (uint32_t)numpeers; ++i) {
+        Group_Peer_AV *peer_av = (Group_Peer_AV *)group_peer_get_object(g_c, conference_number, i);
+
+        if (peer_av != nullptr) {
+            audio_mix_source_kill(peer_av->mix_source);
+            peer_av->mix_source = nullptr;
+        }
+    }
+
+    group_av->mix_channels = channels;
+    group_av->next_mix_time = 0;
+    return 0;
+}
+
+/** @brief Set the gain applied to a peer's audio in the mixed stream.
+ *
+ * @retval 0 on success.
+ * @retval -1 on failure.
+ */
+int groupchat_av_set_peer_gain(const Group_Chats *g_c, Tox_Conference_Number conference_number,
+                               Tox_Conference_Peer_Number peer_number, float gain)
+{
+    if (!(gain >= 0.0F && gain <= (float)AUDIO_MIX_MAX_GAIN / AUDIO_MIX_UNITY_GAIN)) {
+        return -1;
+    }
+
+    if (group_get_object(g_c, conference_number) == nullptr) {
+        return -1;
+    }
+
+    Group_Peer_AV *peer_av = (Group_Peer_AV *)group_peer_get_object(g_c, conference_number, peer_number);
+
+    if (peer_av == nullptr) {
+        return -1;
+    }
+
+    peer_av->mix_gain = (uint16_t)(gain * AUDIO_MIX_UNITY_GAIN + 0.5F);
+
+    if (peer_av->mix_source != nullptr) {
+        audio_mix_source_set_gain(peer_av->mix_source, peer_av->mix_gain);
+    }
+
+    return 0;
+}
+
 /** @brief Create and connect to a new toxav group.
  *
  * @return conference number on success.
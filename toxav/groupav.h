@@ -13,6 +13,9 @@
 
 #define GROUP_AUDIO_PACKET_ID 192
 
+/** Peer number passed to the audio callback for the mixed stream. */
+#define GROUP_AV_MIXED_PEER UINT32_MAX
+
 // TODO(iphydf): Use this better typed one instead of the void-pointer one below.
 // typedef void audio_data_cb(Tox *tox, uint32_t conference_number, uint32_t peer_number, const int16_t *pcm,
 //                            uint32_t samples, uint8_t channels, uint32_t sample_rate, void *userdata);
@@ -58,6 +61,29 @@ int groupchat_enable_av(const Logger *_Nonnull log, Tox *_Nonnull tox, Group_Cha
  */
 int groupchat_disable_av(const Group_Chats *_Nonnull g_c, Tox_Conference_Number conference_number);
 
+/** @brief Switch between per-peer audio callbacks and a single mixed stream.
+ *
+ * With mixing enabled, decoded audio of all peers is buffered, aligned to a
+ * common 20 ms clock and mixed, and the audio callback is called once per
+ * frame with peer number @ref GROUP_AV_MIXED_PEER.
+ *
+ * @param channels 1 or 2 for mixed output, 0 for per-peer callbacks.
+ *
+ * @retval 0 on success.
+ * @retval -1 on failure.
+ */
+int groupchat_av_set_mixing(const Group_Chats *_Nonnull g_c, Tox_Conference_Number conference_number, uint8_t channels);
+
+/** @brief Set the gain applied to a peer's audio in the mixed stream.
+ *
+ * @param gain Between 0 and 4, 1 leaves the audio unchanged.
+ *
+ * @retval 0 on success.
+ * @retval -1 on failure.
+ */
+int groupchat_av_set_peer_gain(const Group_Chats *_Nonnull g_c, Tox_Conference_Number conference_number,
+                               Tox_Conference_Peer_Number peer_number, float gain);
+
 /** Return whether A/V is enabled in the conference. */
 bool groupchat_av_enabled(const Group_Chats *_Nonnull g_c, Tox_Conference_Number conference_number);
 
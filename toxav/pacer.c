@@ -0,0 +1,316 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+#include "pacer.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../toxcore/ccompat.h"
+#include "../toxcore/logger.h"
+#include "../toxcore/mono_time.h"
+#include "../toxcore/util.h"
+
+/**
+ * Multiplier (in percent) applied to the target bit rate. Sending a bit faster
+ * than the encoder produces data means a frame is out of the queue well before
+ * the next one arrives, while still spreading a key frame over a few frame
+ * intervals instead of a single burst.
+ */
+#define PACER_PACING_FACTOR_PERCENT 250
+
+/**
+ * If the queue would take longer than this to drain at the pacing rate, the
+ * rate is raised so that it drains within this time. This bounds the latency
+ * added by the pacer when the encoder overshoots its target.
+ */
+#define PACER_MAX_QUEUE_DELAY_MS 200
+
+/**
+ * The budget never accumulates more than this many milliseconds worth of data,
+ * so an idle period does not turn into a burst.
+ */
+#define PACER_MAX_BURST_MS 5
+
+/**
+ * Minimum budget cap in bytes, so at very low rates we can still send a full
+ * sized packet without waiting for two refills.
+ */
+#define PACER_MIN_BURST_BYTES 1500
+
+typedef struct Pacer_Packet {
+    struct Pacer_Packet *_Nullable next;
+    uint16_t length;
+    uint8_t data[];
+} Pacer_Packet;
+
+struct Pacer {
+    const Logger *_Nonnull log;
+    const Mono_Time *_Nonnull mono_time;
+
+    pacer_send_packet_cb *_Nullable send_packet;
+    void *_Nullable send_packet_user_data;
+
+    pthread_mutex_t *_Nonnull mutex;
+
+    /** Target media bit rate in bits per second. 0 means no pacing. */
+    uint32_t bit_rate;
+
+    /**
+     * Send budget in milli-bytes (1/1000 byte). Refilled with
+     * `rate / 8` milli-bytes per millisecond. May become negative after a
+     * send; nothing is sent from the queue until it is non-negative again.
+     */
+    int64_t budget;
+    uint64_t last_refill;
+
+    Pacer_Packet *_Nullable head;
+    Pacer_Packet *_Nullable tail;
+    uint32_t queue_length;
+    uint32_t queue_bytes;
+};
+
+Pacer *pacer_new(const Logger *log, const Mono_Time *mono_time,
+                 pacer_send_packet_cb *send_packet, void *send_packet_user_data)
+{
+    Pacer *pacer = (Pacer *)calloc(1, sizeof(Pacer));
+
+    if (pacer == nullptr) {
+        LOGGER_ERROR(log, "Failed to allocate pacer");
+        return nullptr;
+    }
+
+    pacer->mutex = (pthread_mutex_t *)calloc(1, sizeof(pthread_mutex_t));
+
+    if (pacer->mutex == nullptr) {
+        free(pacer);
+        return nullptr;
+    }
+
+    if (create_recursive_mutex(pacer->mutex) != 0) {
+        LOGGER_ERROR(log, "Failed to create recursive mutex!");
+        free(pacer->mutex);
+        free(pacer);
+        return nullptr;
+    }
+
+    pacer->log = log;
+    pacer->mono_time = mono_time;
+    pacer->send_packet = send_packet;
+    pacer->send_packet_user_data = send_packet_user_data;
+    pacer->last_refill = current_time_monotonic(mono_time);
+
+    return pacer;
+}
+
+void pacer_kill(Pacer *pacer)
+{
+    if (pacer == nullptr) {
+        return;
+    }
+
+    Pacer_Packet *it = pacer->head;
+
+    while (it != nullptr) {
+        Pacer_Packet *next = it->next;
+        free(it);
+        it = next;
+    }
+
+    pthread_mutex_destroy(pacer->mutex);
+    free(pacer->mutex);
+    free(pacer);
+}
+
+/**
+ * The rate at which the queue is drained, in bits per second. This is the
+ * target bit rate times the pacing factor, raised if necessary so the queue
+ * drains within `PACER_MAX_QUEUE_DELAY_MS`.
+ */
+static uint64_t pacer_rate(const Pacer *_Nonnull pacer)
+{
+    const uint64_t pacing_rate = (uint64_t)pacer->bit_rate * PACER_PACING_FACTOR_PERCENT / 100;
+    const uint64_t drain_rate = (uint64_t)pacer->queue_bytes * 8 * 1000 / PACER_MAX_QUEUE_DELAY_MS;
+    return max_u64(pacing_rate, drain_rate);
+}
+
+/**
+ * The send budget at time `now`, i.e. the stored budget plus what has been
+ * refilled since the last refill, capped at the burst size.
+ */
+static int64_t pacer_budget_at(const Pacer *_Nonnull pacer, uint64_t now)
+{
+    if (pacer->bit_rate == 0) {
+        return 0;
+    }
+
+    const uint64_t elapsed = now > pacer->last_refill ? now - pacer->last_refill : 0;
+    const uint64_t rate = pacer_rate(pacer);
+    const int64_t max_budget = (int64_t)max_u64(PACER_MIN_BURST_BYTES * 1000, rate * PACER_MAX_BURST_MS / 8);
+
+    // Cap elapsed time so a long idle period can't overflow the computation.
+    const int64_t refill = (int64_t)(min_u64(elapsed, 60000) * rate / 8);
+
+    return min_s64(pacer->budget + refill, max_s64(max_budget, pacer->budget));
+}
+
+static void pacer_refill(Pacer *_Nonnull pacer)
+{
+    const uint64_t now = current_time_monotonic(pacer->mono_time);
+    pacer->budget = pacer_budget_at(pacer, now);
+    pacer->last_refill = now;
+}
+
+void pacer_set_bit_rate(Pacer *pacer, uint32_t bit_rate)
+{
+    pthread_mutex_lock(pacer->mutex);
+
+    if (pacer->bit_rate != bit_rate) {
+        // Account the time so far at the old rate.
+        pacer_refill(pacer);
+        LOGGER_DEBUG(pacer->log, "pacer bit rate: %u -> %u", pacer->bit_rate, bit_rate);
+        pacer->bit_rate = bit_rate;
+    }
+
+    pthread_mutex_unlock(pacer->mutex);
+}
+
+int pacer_enqueue(Pacer *pacer, const uint8_t *data, uint16_t length)
+{
+    pthread_mutex_lock(pacer->mutex);
+
+    if (pacer->queue_bytes + length > PACER_MAX_QUEUE_BYTES) {
+        LOGGER_WARNING(pacer->log, "pacer queue full (%u bytes), dropping packet", pacer->queue_bytes);
+        pthread_mutex_unlock(pacer->mutex);
+        return -1;
+    }
+
+    Pacer_Packet *packet = (Pacer_Packet *)malloc(sizeof(Pacer_Packet) + length);
+
+    if (packet == nullptr) {
+        pthread_mutex_unlock(pacer->mutex);
+        return -1;
+    }
+
+    packet->next = nullptr;
+    packet->length = length;
+    memcpy(packet->data, data, length);
+
+    if (pacer->tail == nullptr) {
+        // Refill before the queue becomes non-empty, so the time the queue was
+        // empty is accounted against the (smaller) burst cap.
+        pacer_refill(pacer);
+        pacer->head = packet;
+    } else {
+        pacer->tail->next = packet;
+    }
+
+    pacer->tail = packet;
+    ++pacer->queue_length;
+    pacer->queue_bytes += length;
+
+    pthread_mutex_unlock(pacer->mutex);
+    return 0;
+}
+
+int pacer_send_priority(Pacer *pacer, const uint8_t *data, uint16_t length)
+{
+    pthread_mutex_lock(pacer->mutex);
+
+    pacer_refill(pacer);
+
+    if (pacer->bit_rate != 0) {
+        pacer->budget -= (int64_t)length * 1000;
+    }
+
+    const int ret = pacer->send_packet != nullptr
+                    ? pacer->send_packet(pacer->send_packet_user_data, data, length)
+                    : 0;
+
+    pthread_mutex_unlock(pacer->mutex);
+    return ret;
+}
+
+uint32_t pacer_process(Pacer *pacer)
+{
+    pthread_mutex_lock(pacer->mutex);
+
+    pacer_refill(pacer);
+
+    uint32_t sent = 0;
+
+    while (pacer->head != nullptr && (pacer->bit_rate == 0 || pacer->budget >= 0)) {
+        Pacer_Packet *packet = pacer->head;
+        pacer->head = packet->next;
+
+        if (pacer->head == nullptr) {
+            pacer->tail = nullptr;
+        }
+
+        --pacer->queue_length;
+        pacer->queue_bytes -= packet->length;
+
+        if (pacer->bit_rate != 0) {
+            pacer->budget -= (int64_t)packet->length * 1000;
+        }
+
+        if (pacer->send_packet != nullptr
+                && pacer->send_packet(pacer->send_packet_user_data, packet->data, packet->length) != 0) {
+            LOGGER_DEBUG(pacer->log, "pacer: failed to send packet of %u bytes", packet->length);
+        }
+
+        free(packet);
+        ++sent;
+    }
+
+    pthread_mutex_unlock(pacer->mutex);
+    return sent;
+}
+
+/** @brief Milliseconds until `millibytes` of budget have been refilled. */
+static uint32_t pacer_time_for(const Pacer *_Nonnull pacer, int64_t millibytes)
+{
+    if (millibytes <= 0 || pacer->bit_rate == 0) {
+        return 0;
+    }
+
+    const uint64_t rate = pacer_rate(pacer);
+    // Round up: budget is refilled with rate/8 milli-bytes per millisecond.
+    const uint64_t ms = ((uint64_t)millibytes * 8 + rate - 1) / rate;
+    return (uint32_t)min_u64(ms, UINT32_MAX - 1);
+}
+
+uint32_t pacer_queue_delay(const Pacer *pacer)
+{
+    pthread_mutex_lock(pacer->mutex);
+    const int64_t budget = pacer_budget_at(pacer, current_time_monotonic(pacer->mono_time));
+    const uint32_t delay = pacer_time_for(pacer, (int64_t)pacer->queue_bytes * 1000 - budget);
+    pthread_mutex_unlock(pacer->mutex);
+    return delay;
+}
+
+uint32_t pacer_next_send_delay(const Pacer *pacer)
+{
+    pthread_mutex_lock(pacer->mutex);
+    const int64_t budget = pacer_budget_at(pacer, current_time_monotonic(pacer->mono_time));
+    const uint32_t delay = pacer->head == nullptr ? UINT32_MAX : pacer_time_for(pacer, -budget);
+    pthread_mutex_unlock(pacer->mutex);
+    return delay;
+}
+
+uint32_t pacer_queue_length(const Pacer *pacer)
+{
+    pthread_mutex_lock(pacer->mutex);
+    const uint32_t length = pacer->queue_length;
+    pthread_mutex_unlock(pacer->mutex);
+    return length;
+}
+
+uint32_t pacer_queue_bytes(const Pacer *pacer)
+{
+    pthread_mutex_lock(pacer->mutex);
+    const uint32_t bytes = pacer->queue_bytes;
+    pthread_mutex_unlock(pacer->mutex);
+    return bytes;
+}
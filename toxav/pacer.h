@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+#ifndef C_TOXCORE_TOXAV_PACER_H
+#define C_TOXCORE_TOXAV_PACER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../toxcore/logger.h"
+#include "../toxcore/mono_time.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Token bucket send pacer for the packets of one call.
+ *
+ * Large video frames (in particular key frames) are split by RTP into dozens of
+ * lossy packets. Sending them back-to-back overflows NAT and router buffers and
+ * causes loss exactly on the frames the decoder needs most. The pacer queues
+ * video packets and releases them at a rate derived from the current target
+ * bit rate, so the fragments of a frame are spread over the frame interval.
+ *
+ * Audio packets bypass the queue (they are small and latency sensitive) but
+ * still consume budget, so queued video yields to audio.
+ *
+ * All functions are thread-safe.
+ */
+typedef struct Pacer Pacer;
+
+typedef int pacer_send_packet_cb(void *_Nullable user_data, const uint8_t *_Nonnull data, uint16_t length);
+
+/**
+ * Maximum number of bytes held in the pacer queue. Packets enqueued beyond
+ * this limit are rejected.
+ */
+#define PACER_MAX_QUEUE_BYTES (4 * 1024 * 1024)
+
+Pacer *_Nullable pacer_new(const Logger *_Nonnull log, const Mono_Time *_Nonnull mono_time,
+                           pacer_send_packet_cb *_Nullable send_packet, void *_Nullable send_packet_user_data);
+void pacer_kill(Pacer *_Nullable pacer);
+
+/**
+ * @brief Set the target media bit rate in bits per second.
+ *
+ * The pacer sends somewhat faster than this so that a frame does not spill
+ * into the next frame interval. A bit rate of 0 disables pacing: queued
+ * packets are sent on the next call to `pacer_process`.
+ */
+void pacer_set_bit_rate(Pacer *_Nonnull pacer, uint32_t bit_rate);
+
+/**
+ * @brief Queue a low priority (video) packet.
+ *
+ * @retval 0 on success.
+ * @retval -1 if the packet could not be queued (queue full or out of memory).
+ */
+int pacer_enqueue(Pacer *_Nonnull pacer, const uint8_t *_Nonnull data, uint16_t length);
+
+/**
+ * @brief Send a high priority (audio) packet immediately.
+ *
+ * The packet is sent without waiting for budget, but its size is deducted
+ * from the budget so that queued packets are delayed accordingly.
+ *
+ * @return the result of the send callback.
+ */
+int pacer_send_priority(Pacer *_Nonnull pacer, const uint8_t *_Nonnull data, uint16_t length);
+
+/**
+ * @brief Send as many queued packets as the current budget allows.
+ *
+ * @return the number of packets sent.
+ */
+uint32_t pacer_process(Pacer *_Nonnull pacer);
+
+/**
+ * @brief Expected time in milliseconds until all currently queued packets
+ *   have been sent.
+ */
+uint32_t pacer_queue_delay(const Pacer *_Nonnull pacer);
+
+/**
+ * @brief Time in milliseconds until `pacer_process` can send the next queued
+ *   packet. Returns UINT32_MAX if the queue is empty.
+ */
+uint32_t pacer_next_send_delay(const Pacer *_Nonnull pacer);
+
+/** @brief Number of packets currently in the queue. */
+uint32_t pacer_queue_length(const Pacer *_Nonnull pacer);
+
+/** @brief Number of bytes currently in the queue. */
+uint32_t pacer_queue_bytes(const Pacer *_Nonnull pacer);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* C_TOXCORE_TOXAV_PACER_H */
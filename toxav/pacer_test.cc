@@ -0,0 +1,202 @@
+#include "pacer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../toxcore/attributes.h"
+#include "../toxcore/logger.h"
+#include "../toxcore/mono_time.h"
+#include "../toxcore/os_memory.h"
+
+namespace {
+
+struct PacerTimeMock {
+    std::uint64_t t;
+};
+
+std::uint64_t pacer_mock_time_cb(void *ud) { return static_cast<PacerTimeMock *>(ud)->t; }
+
+struct MockPacerData {
+    std::vector<std::vector<std::uint8_t>> sent_packets;
+
+    static int send_packet(
+        void *_Nullable user_data, const std::uint8_t *_Nonnull data, std::uint16_t length)
+    {
+        auto *sd = static_cast<MockPacerData *>(user_data);
+        sd->sent_packets.emplace_back(data, data + length);
+        return 0;
+    }
+};
+
+class PacerTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        const Memory *mem = os_memory();
+        log = logger_new(mem);
+        tm.t = 1000;
+        mono_time = mono_time_new(mem, pacer_mock_time_cb, &tm);
+        mono_time_update(mono_time);
+        pacer = pacer_new(log, mono_time, MockPacerData::send_packet, &sd);
+        ASSERT_NE(pacer, nullptr);
+    }
+
+    void TearDown() override
+    {
+        const Memory *_Nonnull mem = os_memory();
+        pacer_kill(pacer);
+        mono_time_free(mem, mono_time);
+        logger_kill(log);
+    }
+
+    void enqueue(std::size_t count, std::uint16_t size, std::uint8_t marker = 0)
+    {
+        std::vector<std::uint8_t> data(size, marker);
+        for (std::size_t i = 0; i < count; ++i) {
+            ASSERT_EQ(pacer_enqueue(pacer, data.data(), size), 0);
+        }
+    }
+
+    Logger *_Nullable log;
+    Mono_Time *_Nullable mono_time;
+    Pacer *_Nullable pacer;
+    PacerTimeMock tm;
+    MockPacerData sd;
+};
+
+TEST_F(PacerTest, NoRateSendsEverythingImmediately)
+{
+    enqueue(50, 1000);
+    EXPECT_EQ(pacer_queue_length(pacer), 50);
+    EXPECT_TRUE(sd.sent_packets.empty());
+
+    EXPECT_EQ(pacer_process(pacer), 50);
+    EXPECT_EQ(sd.sent_packets.size(), 50);
+    EXPECT_EQ(pacer_queue_length(pacer), 0);
+    EXPECT_EQ(pacer_queue_bytes(pacer), 0);
+    EXPECT_EQ(pacer_queue_delay(pacer), 0);
+}
+
+TEST_F(PacerTest, SpreadsBurstOverTime)
+{
+    // 1 Mbit/s target, paced at 2.5 Mbit/s = 312.5 bytes per millisecond.
+    pacer_set_bit_rate(pacer, 1000000);
+
+    // A 50 KB key frame.
+    enqueue(50, 1000);
+    pacer_process(pacer);
+    EXPECT_LT(sd.sent_packets.size(), 5);
+    EXPECT_GT(pacer_queue_delay(pacer), 100);
+    EXPECT_GT(pacer_next_send_delay(pacer), 0);
+
+    std::uint64_t elapsed = 0;
+    while (pacer_queue_length(pacer) > 0 && elapsed < 1000) {
+        tm.t += 1;
+        ++elapsed;
+        pacer_process(pacer);
+    }
+
+    EXPECT_EQ(sd.sent_packets.size(), 50);
+    // 50 KB at 312.5 bytes/ms takes 160 ms.
+    EXPECT_GE(elapsed, 140);
+    EXPECT_LE(elapsed, 180);
+    EXPECT_EQ(pacer_next_send_delay(pacer), UINT32_MAX);
+}
+
+TEST_F(PacerTest, PreservesOrder)
+{
+    pacer_set_bit_rate(pacer, 500000);
+
+    for (std::uint8_t i = 0; i < 20; ++i) {
+        enqueue(1, 1000, i);
+    }
+
+    while (pacer_queue_length(pacer) > 0) {
+        tm.t += 1;
+        pacer_process(pacer);
+    }
+
+    ASSERT_EQ(sd.sent_packets.size(), 20);
+    for (std::uint8_t i = 0; i < 20; ++i) {
+        EXPECT_EQ(sd.sent_packets[i][0], i);
+    }
+}
+
+TEST_F(PacerTest, PriorityPacketsBypassQueue)
+{
+    pacer_set_bit_rate(pacer, 1000000);
+    enqueue(20, 1000, 1);
+    pacer_process(pacer);
+    const std::size_t sent_before = sd.sent_packets.size();
+
+    const std::uint8_t audio[100] = {2};
+    EXPECT_EQ(pacer_send_priority(pacer, audio, sizeof(audio)), 0);
+
+    ASSERT_EQ(sd.sent_packets.size(), sent_before + 1);
+    EXPECT_EQ(sd.sent_packets.back()[0], 2);
+    EXPECT_EQ(pacer_queue_length(pacer), 20 - sent_before);
+}
+
+TEST_F(PacerTest, PriorityPacketsConsumeBudget)
+{
+    pacer_set_bit_rate(pacer, 1000000);
+    const std::uint32_t delay_before = pacer_queue_delay(pacer);
+
+    const std::uint8_t audio[1000] = {0};
+    for (int i = 0; i < 10; ++i) {
+        pacer_send_priority(pacer, audio, sizeof(audio));
+    }
+
+    enqueue(1, 1000);
+    pacer_process(pacer);
+    // The video packet has to wait for the budget the audio used up.
+    EXPECT_EQ(pacer_queue_length(pacer), 1);
+    EXPECT_GT(pacer_queue_delay(pacer), delay_before);
+    EXPECT_GT(pacer_next_send_delay(pacer), 0);
+
+    tm.t += pacer_next_send_delay(pacer);
+    pacer_process(pacer);
+    EXPECT_EQ(pacer_queue_length(pacer), 0);
+}
+
+TEST_F(PacerTest, IdleTimeDoesNotCauseBurst)
+{
+    pacer_set_bit_rate(pacer, 1000000);
+    tm.t += 10000;
+
+    enqueue(50, 1000);
+    pacer_process(pacer);
+    EXPECT_LT(sd.sent_packets.size(), 5);
+}
+
+TEST_F(PacerTest, LargeQueueDrainsWithinBoundedDelay)
+{
+    // Very low target rate, but a frame much larger than it.
+    pacer_set_bit_rate(pacer, 10000);
+    enqueue(100, 1000);
+    EXPECT_LE(pacer_queue_delay(pacer), 250);
+}
+
+TEST_F(PacerTest, QueueLimit)
+{
+    pacer_set_bit_rate(pacer, 1000000);
+    std::vector<std::uint8_t> data(1000);
+    std::size_t queued = 0;
+    while (pacer_enqueue(pacer, data.data(), static_cast<std::uint16_t>(data.size())) == 0) {
+        ++queued;
+        ASSERT_LE(queued * data.size(), PACER_MAX_QUEUE_BYTES);
+    }
+    EXPECT_EQ(pacer_queue_bytes(pacer), queued * data.size());
+}
+
+TEST_F(PacerTest, KillWithQueuedPackets)
+{
+    pacer_set_bit_rate(pacer, 1000);
+    enqueue(10, 1000);
+    // TearDown frees the pacer with packets still in the queue.
+}
+
+}  // namespace
@@ -10,6 +10,7 @@
 
 #include <sodium.h>
 
+#include "../toxcore/atomics.h"
 #include "../toxcore/ccompat.h"
 #include "../toxcore/logger.h"
 #include "../toxcore/mono_time.h"
@@ -17,7 +18,6 @@
 #include "../toxcore/network.h"
 #include "../toxcore/util.h"
 
-
 /**
  * Maximum size of a single RTP frame in bytes.
  * This limit prevents memory exhaustion attacks where a malicious peer sends
@@ -26,6 +26,24 @@
  */
 #define MAX_RTP_FRAME_SIZE (32 * 1024 * 1024)
 
+/**
+ * Payload size of each fragment of a multipart frame (except the last one,
+ * which may be shorter). FEC parity covers fragments of exactly this size.
+ */
+#define RTP_MAX_PIECE_SIZE (MAX_CRYPTO_DATA_SIZE - (RTP_HEADER_SIZE + 1))
+
+/**
+ * The peer only reports loss when there is some, so if we haven't heard from
+ * it for this long, we assume the loss is gone and stop sending FEC.
+ */
+#define RTP_FEC_LOSS_TIMEOUT_MS 5000
+
+/** Window over which the send bit rate is measured. */
+#define RTP_SEND_RATE_WINDOW_MS 1000
+
+/** Largest transit time difference that counts towards the jitter estimate. */
+#define RTP_MAX_JITTER_SAMPLE_MS 10000
+
 struct RTPHeader {
     /* Standard RTP header */
     unsigned ve: 2; /* Version has only 2 bits! */
@@ -63,6 +81,17 @@ struct RTPHeader {
      */
     uint32_t received_length_full;
 
+    /**
+     * For @ref RTP_FEC_PARITY packets: index of the first fragment covered by
+     * the parity.
+     */
+    uint16_t fec_first;
+    /**
+     * For @ref RTP_FEC_PARITY packets: number of fragments covered by the
+     * parity.
+     */
+    uint16_t fec_count;
+
     /**
      * Data offset of the current part (lower bits).
      */
@@ -106,6 +135,13 @@ struct RTPWorkBuffer {
      * The message currently being assembled.
      */
     struct RTPMessage *_Nullable buf;
+    /**
+     * Bitmap of the fragments received (or recovered) so far, used to rebuild
+     * a lost fragment from FEC parity. This is null for single part frames and
+     * for frames that are not split into @ref RTP_MAX_PIECE_SIZE fragments, in
+     * which case parity packets are ignored.
+     */
+    uint8_t *_Nullable fragments;
 };
 
 struct RTPWorkBufferList {
@@ -138,6 +174,30 @@ struct RTPSession {
 
     void *_Nonnull cs;
     rtp_m_cb *_Nonnull mcb;
+
+    /* Number of video fragments per FEC parity packet, 0 if FEC is off. */
+    uint8_t fec_group_size;
+    /* Time of the last loss report, 0 if the group size was set explicitly. */
+    uint64_t fec_loss_time;
+
+    /* Statistics, see RTPStats. */
+    uint64_t packets_sent;
+    /* Arrival time minus sender time stamp of the last frame. */
+    uint32_t last_transit;
+    uint32_t last_transit_timestamp;
+    bool has_transit;
+    /* Interarrival jitter in 1/16 ms. */
+    uint32_t jitter_q4;
+    /*
+     * Receive statistics, written on the tox thread by rtp_receive_packet and
+     * read by rtp_get_stats on any thread.
+     */
+    Tox_Atomic_U64 packets_received;
+    Tox_Atomic_U64 jitter;
+    /* Bytes sent since send_rate_start, and the rate of the previous window. */
+    uint64_t send_rate_start;
+    uint32_t send_rate_bytes;
+    uint32_t send_bit_rate;
 };
 
 const uint8_t *rtp_message_data(const RTPMessage *msg)
@@ -216,6 +276,48 @@ static struct RTPMessage *_Nullable new_message(const Logger *_Nonnull log, cons
     return msg;
 }
 
+/** @brief Number of fragments a frame of @p length bytes is split into. */
+static uint32_t rtp_fragment_count(uint32_t length)
+{
+    return (length + RTP_MAX_PIECE_SIZE - 1) / RTP_MAX_PIECE_SIZE;
+}
+
+/** @brief Length of fragment @p index of a frame of @p length bytes. */
+static uint16_t rtp_fragment_length(uint32_t length, uint32_t index)
+{
+    return (uint16_t)min_u32(length - index * RTP_MAX_PIECE_SIZE, RTP_MAX_PIECE_SIZE);
+}
+
+static bool fragment_is_set(const uint8_t *_Nonnull fragments, uint32_t index)
+{
+    return (fragments[index / 8] & (1 << (index % 8))) != 0;
+}
+
+static void fragment_set(uint8_t *_Nonnull fragments, uint32_t index)
+{
+    fragments[index / 8] |= (uint8_t)(1 << (index % 8));
+}
+
+static void xor_bytes(uint8_t *_Nonnull dest, const uint8_t *_Nonnull src, uint16_t length)
+{
+    uint16_t i = 0;
+
+    // Word at a time; the compiler can't vectorise the byte loop because dest
+    // and src may alias.
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t d;
+        uint64_t s;
+        memcpy(&d, dest + i, sizeof(d));
+        memcpy(&s, src + i, sizeof(s));
+        d ^= s;
+        memcpy(dest + i, &d, sizeof(d));
+    }
+
+    for (; i < length; ++i) {
+        dest[i] ^= src[i];
+    }
+}
+
 /**
  * Instruct the caller to clear slot 0.
  */
@@ -238,24 +340,35 @@ static struct RTPMessage *_Nullable new_message(const Logger *_Nonnull log, cons
  * do not kick it out right away if all slots are full instead kick out the new
  * incoming interframe.
  */
+static int8_t find_slot(const struct RTPWorkBufferList *_Nonnull wkbl, const struct RTPHeader *_Nonnull header)
+{
+    for (uint8_t i = 0; i < wkbl->next_free_entry; ++i) {
+        const struct RTPWorkBuffer *slot = &wkbl->work_buffer[i];
+
+        if ((slot->buf->header.sequnum == header->sequnum) && (slot->buf->header.timestamp == header->timestamp)) {
+            // Sequence number and timestamp match, so this slot belongs to
+            // the same frame.
+            //
+            // In reality, these will almost certainly either both match or
+            // both not match. Only if somehow there were 65535 frames
+            // between, the timestamp will matter.
+            return i;
+        }
+    }
+
+    return -1;
+}
+
 static int8_t get_slot(const Logger *_Nonnull log, struct RTPWorkBufferList *_Nonnull wkbl, bool is_keyframe,
                        const struct RTPHeader *_Nonnull header, bool is_multipart)
 {
     if (is_multipart) {
         // This RTP message is part of a multipart frame, so we try to find an
         // existing slot with the previous parts of the frame in it.
-        for (uint8_t i = 0; i < wkbl->next_free_entry; ++i) {
-            const struct RTPWorkBuffer *slot = &wkbl->work_buffer[i];
-
-            if ((slot->buf->header.sequnum == header->sequnum) && (slot->buf->header.timestamp == header->timestamp)) {
-                // Sequence number and timestamp match, so this slot belongs to
-                // the same frame.
-                //
-                // In reality, these will almost certainly either both match or
-                // both not match. Only if somehow there were 65535 frames
-                // between, the timestamp will matter.
-                return i;
-            }
+        const int8_t slot_id = find_slot(wkbl, header);
+
+        if (slot_id >= 0) {
+            return slot_id;
         }
     }
 
@@ -378,6 +491,8 @@ static struct RTPMessage *_Nullable process_frame(const Logger *_Nonnull log, st
     struct RTPMessage *msg = slot->buf;
     msg->len = msg->header.data_length_full;
     slot->buf = nullptr;
+    free(slot->fragments);
+    slot->fragments = nullptr;
 
     assert(wkbl->next_free_entry >= 1 && wkbl->next_free_entry <= USED_RTP_WORKBUFFER_COUNT);
 
@@ -445,11 +560,17 @@ static bool fill_data_into_slot(const Logger *_Nonnull log, struct RTPWorkBuffer
         // the full length of large frames. Instead, we use slot->received_len.
         msg->len = 0;
         msg->header = *header;
+        msg->header.received_length_full = 0;
 
         slot->buf = msg;
         slot->is_keyframe = is_keyframe;
         slot->received_len = 0;
 
+        if (header->data_length_full > RTP_MAX_PIECE_SIZE) {
+            // If this fails, we just can't use FEC for this frame.
+            slot->fragments = (uint8_t *)calloc(rtp_fragment_count(header->data_length_full) / 8 + 1, 1);
+        }
+
         assert(wkbl->next_free_entry < USED_RTP_WORKBUFFER_COUNT);
         ++wkbl->next_free_entry;
     } else {
@@ -470,6 +591,23 @@ static bool fill_data_into_slot(const Logger *_Nonnull log, struct RTPWorkBuffer
         return false;
     }
 
+    if (slot->fragments != nullptr) {
+        const uint32_t index = header->offset_full / RTP_MAX_PIECE_SIZE;
+
+        if (header->offset_full % RTP_MAX_PIECE_SIZE != 0
+                || incoming_data_length != rtp_fragment_length(header->data_length_full, index)) {
+            // The sender splits frames differently than we do, so we can't
+            // match parity packets against fragments.
+            free(slot->fragments);
+            slot->fragments = nullptr;
+        } else if (fragment_is_set(slot->fragments, index)) {
+            // Duplicate, or a late copy of a fragment we already recovered.
+            return false;
+        } else {
+            fragment_set(slot->fragments, index);
+        }
+    }
+
     // Copy the incoming chunk of data into the correct position in the full
     // frame data array.
     memcpy(
@@ -482,7 +620,9 @@ static bool fill_data_into_slot(const Logger *_Nonnull log, struct RTPWorkBuffer
     slot->received_len += incoming_data_length;
 
     // Update received length also in the header of the message, for later use.
-    slot->buf->header.received_length_full = slot->received_len;
+    // This only counts data that actually arrived, not fragments rebuilt from
+    // FEC, so the loss reported to the sender reflects the network.
+    slot->buf->header.received_length_full += incoming_data_length;
 
     return slot->received_len == header->data_length_full;
 }
@@ -507,6 +647,107 @@ static void update_bwc_values(RTPSession *_Nonnull session, const struct RTPMess
     }
 }
 
+/**
+ * Rebuild a lost fragment of the frame in @p slot from an FEC parity packet.
+ *
+ * The parity is the XOR of the covered fragments, each zero-padded to the
+ * length of the first one. If exactly one of them is missing, XOR-ing the
+ * parity with all the others yields the missing one.
+ *
+ * @retval true if a fragment was recovered.
+ */
+static bool recover_fragment(const Logger *_Nonnull log, struct RTPWorkBuffer *_Nonnull slot,
+                             const struct RTPHeader *_Nonnull header,
+                             const uint8_t *_Nonnull parity, uint16_t parity_length)
+{
+    if (slot->fragments == nullptr || header->fec_count == 0) {
+        return false;
+    }
+
+    const uint32_t length = slot->buf->header.data_length_full;
+    const uint32_t first = header->fec_first;
+    const uint32_t end = first + header->fec_count;
+
+    if (end > rtp_fragment_count(length) || parity_length != rtp_fragment_length(length, first)) {
+        LOGGER_WARNING(log, "Invalid FEC packet: fragments %u..%u, length %u, frame length %u",
+                       (unsigned)first, (unsigned)end, (unsigned)parity_length, (unsigned)length);
+        return false;
+    }
+
+    uint32_t missing = end;
+
+    for (uint32_t i = first; i < end; ++i) {
+        if (!fragment_is_set(slot->fragments, i)) {
+            if (missing != end) {
+                // More than one fragment is missing, so parity doesn't help.
+                return false;
+            }
+
+            missing = i;
+        }
+    }
+
+    if (missing == end) {
+        // Nothing to recover.
+        return false;
+    }
+
+    uint8_t *const dest = slot->buf->data + missing * RTP_MAX_PIECE_SIZE;
+    const uint16_t missing_length = rtp_fragment_length(length, missing);
+    memcpy(dest, parity, missing_length);
+
+    for (uint32_t i = first; i < end; ++i) {
+        if (i != missing) {
+            xor_bytes(dest, slot->buf->data + i * RTP_MAX_PIECE_SIZE,
+                      min_u16(missing_length, rtp_fragment_length(length, i)));
+        }
+    }
+
+    fragment_set(slot->fragments, missing);
+    slot->received_len += missing_length;
+
+    LOGGER_DEBUG(log, "FEC: recovered fragment %u of frame %u", (unsigned)missing, (unsigned)header->sequnum);
+    return true;
+}
+
+/**
+ * Handle an FEC parity packet for a video frame that is currently being
+ * assembled. If it completes the frame, the frame is passed on.
+ *
+ * @retval -1 if the packet was not used.
+ * @retval 0 on success.
+ */
+static int handle_fec_packet(const Logger *_Nonnull log, RTPSession *_Nonnull session, const struct RTPHeader *_Nonnull header,
+                             const uint8_t *_Nonnull parity, uint16_t parity_length)
+{
+    struct RTPWorkBufferList *const wkbl = session->work_buffer_list;
+    const int8_t slot_id = find_slot(wkbl, header);
+
+    // Either the frame is already complete (and gone), or none of it arrived.
+    if (slot_id < 0) {
+        return -1;
+    }
+
+    struct RTPWorkBuffer *const slot = &wkbl->work_buffer[slot_id];
+
+    if (!recover_fragment(log, slot, header, parity, parity_length)) {
+        return -1;
+    }
+
+    if (slot->received_len != slot->buf->header.data_length_full) {
+        return 0;
+    }
+
+    struct RTPMessage *m_new = process_frame(log, wkbl, (uint8_t)slot_id);
+
+    if (m_new != nullptr) {
+        update_bwc_values(session, m_new);
+        session->mcb(session->mono_time, session->cs, m_new);
+    }
+
+    return 0;
+}
+
 /**
  * Handle a single RTP video packet.
  *
@@ -536,6 +777,10 @@ static int handle_video_packet(const Logger *_Nonnull log, RTPSession *_Nonnull
 
     LOGGER_DEBUG(log, "wkbl->next_free_entry:003=%d", session->work_buffer_list->next_free_entry);
 
+    if ((header->flags & RTP_FEC_PARITY) != 0) {
+        return handle_fec_packet(log, session, header, incoming_data, incoming_data_length);
+    }
+
     const bool is_multipart = full_frame_length != incoming_data_length;
 
     /* The message was sent in single part */
@@ -620,6 +865,37 @@ static int handle_video_packet(const Logger *_Nonnull log, RTPSession *_Nonnull
     return 0;
 }
 
+/**
+ * Count a received packet and update the interarrival jitter estimate as in
+ * RFC 3550, section 6.4.1. All fragments of a frame carry the same time stamp,
+ * so only the first fragment of each frame is used for the estimate.
+ */
+static void update_receive_stats(RTPSession *_Nonnull session, const struct RTPHeader *_Nonnull header)
+{
+    tox_atomic_u64_increment(&session->packets_received);
+
+    if (session->has_transit && session->last_transit_timestamp == header->timestamp) {
+        return;
+    }
+
+    // Both time stamps are milliseconds on different clocks, so the transit
+    // time has an arbitrary offset, which cancels out in the difference.
+    const uint32_t transit = (uint32_t)current_time_monotonic(session->mono_time) - header->timestamp;
+
+    if (session->has_transit) {
+        const int32_t d = (int32_t)(transit - session->last_transit);
+        // Clamp, so a bogus time stamp can't overflow the estimate.
+        const uint32_t abs_d = min_u32(d < 0 ? 0U - (uint32_t)d : (uint32_t)d, RTP_MAX_JITTER_SAMPLE_MS);
+        // J += (|D| - J) / 16, with J in units of 1/16 ms.
+        session->jitter_q4 = session->jitter_q4 - ((session->jitter_q4 + 8) >> 4) + abs_d;
+        tox_atomic_u64_store(&session->jitter, (session->jitter_q4 + 8) >> 4);
+    }
+
+    session->last_transit = transit;
+    session->last_transit_timestamp = header->timestamp;
+    session->has_transit = true;
+}
+
 /**
  * receive custom lossypackets and process them. they can be incoming audio or video packets
  */
@@ -654,7 +930,10 @@ void rtp_receive_packet(RTPSession *session, const uint8_t *data, size_t length)
         return;
     }
 
-    if ((header.flags & RTP_LARGE_FRAME) != 0 && header.offset_full >= header.data_length_full) {
+    // Parity packets have an offset past the end of the frame, so that
+    // receivers that don't know about FEC discard them here.
+    if ((header.flags & RTP_LARGE_FRAME) != 0 && (header.flags & RTP_FEC_PARITY) == 0
+            && header.offset_full >= header.data_length_full) {
         LOGGER_ERROR(log, "Invalid video packet: frame offset (%u) >= full frame length (%u)",
                      (unsigned)header.offset_full, (unsigned)header.data_length_full);
         return;
@@ -666,6 +945,8 @@ void rtp_receive_packet(RTPSession *session, const uint8_t *data, size_t length)
         return;
     }
 
+    update_receive_stats(session, &header);
+
     LOGGER_DEBUG(log, "header.pt %d, video %d", (uint8_t)header.pt, RTP_TYPE_VIDEO % 128);
 
     // The sender uses the new large-frame capable protocol and is sending a
@@ -807,6 +1088,8 @@ size_t rtp_header_pack(uint8_t *const rdata, const struct RTPHeader *header)
     p += net_pack_u32(p, header->offset_full);
     p += net_pack_u32(p, header->data_length_full);
     p += net_pack_u32(p, header->received_length_full);
+    p += net_pack_u16(p, header->fec_first);
+    p += net_pack_u16(p, header->fec_count);
 
     for (size_t i = 0; i < RTP_PADDING_FIELDS; ++i) {
         p += net_pack_u32(p, 0);
@@ -838,6 +1121,8 @@ size_t rtp_header_unpack(const uint8_t *data, struct RTPHeader *header)
     p += net_unpack_u32(p, &header->offset_full);
     p += net_unpack_u32(p, &header->data_length_full);
     p += net_unpack_u32(p, &header->received_length_full);
+    p += net_unpack_u16(p, &header->fec_first);
+    p += net_unpack_u16(p, &header->fec_count);
 
     p += sizeof(uint32_t) * RTP_PADDING_FIELDS;
 
@@ -916,6 +1201,7 @@ void rtp_kill(const Logger *log, RTPSession *session)
     if (session->work_buffer_list != nullptr) {
         for (int8_t i = 0; i < session->work_buffer_list->next_free_entry; ++i) {
             free(session->work_buffer_list->work_buffer[i].buf);
+            free(session->work_buffer_list->work_buffer[i].fragments);
         }
         free(session->work_buffer_list);
     }
@@ -948,6 +1234,21 @@ static void rtp_send_piece(RTPSession *_Nonnull session, const struct RTPHeader
     if (session->send_packet != nullptr) {
         session->send_packet(session->send_packet_user_data, rdata, rdata_size);
     }
+
+    ++session->packets_sent;
+
+    if (session->mono_time != nullptr) {
+        const uint64_t now = current_time_monotonic(session->mono_time);
+
+        if (now - session->send_rate_start >= RTP_SEND_RATE_WINDOW_MS) {
+            session->send_bit_rate = (uint32_t)min_u64(
+                                         (uint64_t)session->send_rate_bytes * 8 * 1000 / (now - session->send_rate_start), UINT32_MAX);
+            session->send_rate_start = now;
+            session->send_rate_bytes = 0;
+        }
+
+        session->send_rate_bytes += rdata_size;
+    }
 }
 
 static struct RTPHeader rtp_default_header(const RTPSession *_Nonnull session, uint32_t length, bool is_keyframe)
@@ -989,6 +1290,93 @@ static struct RTPHeader rtp_default_header(const RTPSession *_Nonnull session, u
     return header;
 }
 
+/**
+ * Send the parity over fragments `[first, first + count)` of the frame
+ * described by @p header.
+ */
+static void rtp_send_parity(RTPSession *_Nonnull session, const struct RTPHeader *_Nonnull header, uint8_t *_Nonnull rdata,
+                            const uint8_t *_Nonnull parity, uint16_t parity_length, uint32_t first, uint32_t count)
+{
+    struct RTPHeader fec_header = *header;
+    fec_header.flags |= RTP_FEC_PARITY;
+    fec_header.offset_full = header->data_length_full;
+    fec_header.offset_lower = 0;
+    fec_header.fec_first = (uint16_t)first;
+    fec_header.fec_count = (uint16_t)count;
+    rtp_send_piece(session, &fec_header, parity, rdata, parity_length);
+}
+
+/**
+ * The FEC group size for the next frame. Switches FEC off if the peer stopped
+ * reporting loss.
+ */
+static uint8_t rtp_current_fec_group_size(RTPSession *_Nonnull session)
+{
+    if (session->fec_loss_time != 0 && session->mono_time != nullptr
+            && current_time_monotonic(session->mono_time) - session->fec_loss_time > RTP_FEC_LOSS_TIMEOUT_MS) {
+        LOGGER_DEBUG(session->log, "FEC: no loss reported recently, switching off");
+        session->fec_group_size = 0;
+        session->fec_loss_time = 0;
+    }
+
+    return session->fec_group_size;
+}
+
+void rtp_get_stats(const RTPSession *session, RTPStats *stats)
+{
+    stats->packets_received = tox_atomic_u64_load(&session->packets_received);
+    stats->packets_sent = session->packets_sent;
+    stats->jitter = (uint32_t)tox_atomic_u64_load(&session->jitter);
+    stats->send_bit_rate = session->send_bit_rate;
+
+    if (session->mono_time != nullptr
+            && current_time_monotonic(session->mono_time) - session->send_rate_start >= 2 * RTP_SEND_RATE_WINDOW_MS) {
+        // Nothing was sent for a while.
+        stats->send_bit_rate = 0;
+    }
+}
+
+void rtp_set_fec_group_size(RTPSession *session, uint8_t group_size)
+{
+    session->fec_group_size = group_size;
+    session->fec_loss_time = 0;
+}
+
+uint8_t rtp_get_fec_group_size(const RTPSession *session)
+{
+    return session->fec_group_size;
+}
+
+void rtp_set_reported_loss(RTPSession *session, float loss)
+{
+    // Parity over k fragments recovers a frame group if at most one of its
+    // k + 1 packets is lost, so pick smaller groups as loss rises. This tops
+    // out at 50% overhead; beyond that, lowering the bit rate is the answer.
+    uint8_t group_size;
+
+    if (loss < 0.01F) {
+        group_size = 0;
+    } else if (loss < 0.03F) {
+        group_size = 10;
+    } else if (loss < 0.06F) {
+        group_size = 6;
+    } else if (loss < 0.1F) {
+        group_size = 4;
+    } else if (loss < 0.2F) {
+        group_size = 3;
+    } else {
+        group_size = 2;
+    }
+
+    if (group_size != session->fec_group_size) {
+        LOGGER_DEBUG(session->log, "FEC: loss %f%%, group size %u -> %u",
+                     (double)loss * 100, session->fec_group_size, group_size);
+    }
+
+    session->fec_group_size = group_size;
+    session->fec_loss_time = session->mono_time != nullptr ? current_time_monotonic(session->mono_time) : 0;
+}
+
 /**
  * @brief Send a frame of audio or video data, chunked in @ref RTPMessage instances.
  *
@@ -1022,24 +1410,40 @@ int rtp_send_data(const Logger *log, RTPSession *session, const uint8_t *data, u
     } else {
         /*
          * The length is greater than the maximum allowed length (including header)
-         * Send the packet in multiple pieces.
+         * Send the packet in multiple pieces, each group of fec_group_size
+         * pieces followed by a parity packet if FEC is on.
          */
+        const uint8_t fec_group_size = rtp_current_fec_group_size(session);
+        const bool fec = fec_group_size != 0 && length > RTP_MAX_PIECE_SIZE
+                         && rtp_fragment_count(length) <= UINT16_MAX;
+        uint8_t parity[RTP_MAX_PIECE_SIZE];
+        uint16_t parity_length = 0;
+        uint32_t fragment = 0;
+        uint32_t group_first = 0;
         uint32_t sent = 0;
-        uint16_t piece = MAX_CRYPTO_DATA_SIZE - (RTP_HEADER_SIZE + 1);
 
-        while ((length - sent) + RTP_HEADER_SIZE + 1 > MAX_CRYPTO_DATA_SIZE) {
+        while (sent < length) {
+            const uint16_t piece = (uint16_t)min_u32(length - sent, RTP_MAX_PIECE_SIZE);
             rtp_send_piece(session, &header, data + sent, rdata, piece);
 
+            if (fec) {
+                if (fragment == group_first) {
+                    memcpy(parity, data + sent, piece);
+                    parity_length = piece;
+                } else {
+                    xor_bytes(parity, data + sent, piece);
+                }
+            }
+
             sent += piece;
+            ++fragment;
             header.offset_lower = (uint16_t)sent;
             header.offset_full = sent; // raw data offset, without any header
-        }
-
-        /* Send remaining */
-        piece = (uint16_t)(length - sent);
 
-        if (piece != 0) {
-            rtp_send_piece(session, &header, data + sent, rdata, piece);
+            if (fec && (fragment - group_first == fec_group_size || sent == length)) {
+                rtp_send_parity(session, &header, rdata, parity, parity_length, group_first, fragment - group_first);
+                group_first = fragment;
+            }
         }
     }
 
@@ -25,7 +25,7 @@ extern "C" {
  * Number of 32 bit padding fields between @ref RTPHeader::offset_lower and
  * everything before it.
  */
-#define RTP_PADDING_FIELDS 11
+#define RTP_PADDING_FIELDS 10
 
 /**
  * Payload type identifier. Also used as rtp callback prefix.
@@ -49,6 +49,11 @@ typedef enum RTPFlags {
      * Whether the packet is part of a key frame.
      */
     RTP_KEY_FRAME = 1 << 1,
+    /**
+     * The packet carries XOR parity over a group of fragments of the frame
+     * rather than frame data. See @ref rtp_set_fec_group_size.
+     */
+    RTP_FEC_PARITY = 1 << 2,
 } RTPFlags;
 
 typedef struct RTPHeader RTPHeader;
@@ -117,6 +122,53 @@ void rtp_stop_receiving_mark(RTPSession *_Nullable session);
 int rtp_send_data(const Logger *_Nonnull log, RTPSession *_Nonnull session, const uint8_t *_Nonnull data, uint32_t length,
                   bool is_keyframe);
 
+/**
+ * @brief Set a fixed number of video fragments covered by each FEC parity
+ *   packet.
+ *
+ * After every @p group_size fragments of a multipart video frame, one parity
+ * packet (the XOR of those fragments) is sent, which allows the receiver to
+ * rebuild a single lost fragment per group. 0 disables FEC.
+ *
+ * Receivers that don't understand parity packets discard them as invalid.
+ */
+void rtp_set_fec_group_size(RTPSession *_Nonnull session, uint8_t group_size);
+uint8_t rtp_get_fec_group_size(const RTPSession *_Nonnull session);
+
+/**
+ * Counters of an RTP session, for call statistics.
+ */
+typedef struct RTPStats {
+    /** Number of valid packets received. */
+    uint64_t packets_received;
+    /** Number of packets sent, including FEC parity packets. */
+    uint64_t packets_sent;
+    /** Interarrival jitter of received frames in milliseconds (RFC 3550). */
+    uint32_t jitter;
+    /** Bit rate sent during the last second, including RTP headers. */
+    uint32_t send_bit_rate;
+} RTPStats;
+
+/**
+ * @brief Get the current counters of the session.
+ *
+ * The receive counters may be read while @ref rtp_receive_packet runs on
+ * another thread. The send counters are updated by @ref rtp_send_data, so the
+ * caller must hold whatever lock serialises that.
+ */
+void rtp_get_stats(const RTPSession *_Nonnull session, RTPStats *_Nonnull stats);
+
+/**
+ * @brief Adapt the FEC group size to the packet loss reported by the peer.
+ *
+ * Higher loss selects smaller groups (more redundancy). Since the peer only
+ * reports non-zero loss, FEC is switched off again if no report arrived for a
+ * few seconds.
+ *
+ * @param loss Fraction of bytes lost, between 0 and 1.
+ */
+void rtp_set_reported_loss(RTPSession *_Nonnull session, float loss);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -6,7 +6,11 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <map>
+#include <random>
 #include <vector>
 
 #include "../toxcore/attributes.h"
@@ -14,6 +18,7 @@
 #include "../toxcore/mono_time.h"
 #include "../toxcore/os_memory.h"
 #include "av_test_support.hh"
+#include "pacer.h"
 #include "rtp.h"
 
 namespace {
@@ -71,6 +76,316 @@ BENCHMARK_DEFINE_F(RtpBench, ReceivePacket)(benchmark::State &state)
 }
 BENCHMARK_REGISTER_F(RtpBench, ReceivePacket)->Arg(100)->Arg(1000);
 
+/**
+ * Sends video frames through a lossy channel from one RTP session to another
+ * and counts how many arrive intact, with and without FEC.
+ */
+class RtpFecBench : public benchmark::Fixture {
+public:
+    void SetUp(const ::benchmark::State &) override
+    {
+        const Memory *_Nonnull mem = os_memory();
+        log = logger_new(mem);
+        mono_time = mono_time_new(mem, nullptr, nullptr);
+
+        sender = rtp_new(log, RTP_TYPE_VIDEO, mono_time, capture_packet, this, nullptr, nullptr,
+            nullptr, this, count_frame);
+        receiver = rtp_new(log, RTP_TYPE_VIDEO, mono_time, nullptr, nullptr, nullptr, nullptr,
+            nullptr, this, count_frame);
+    }
+
+    void TearDown(const ::benchmark::State &) override
+    {
+        const Memory *mem = os_memory();
+        rtp_kill(log, receiver);
+        rtp_kill(log, sender);
+        mono_time_free(mem, mono_time);
+        logger_kill(log);
+    }
+
+    static int capture_packet(
+        void *_Nullable user_data, const std::uint8_t *_Nonnull data, std::uint16_t length)
+    {
+        auto *self = static_cast<RtpFecBench *>(user_data);
+        self->packets.emplace_back(data, data + length);
+        return 0;
+    }
+
+    static int count_frame(
+        const Mono_Time *_Nonnull /*mono_time*/, void *_Nullable cs, RTPMessage *_Nonnull msg)
+    {
+        auto *self = static_cast<RtpFecBench *>(cs);
+
+        if (rtp_message_len(msg) == self->frame.size()
+            && std::memcmp(rtp_message_data(msg), self->frame.data(), self->frame.size()) == 0) {
+            ++self->intact_frames;
+        }
+
+        std::free(msg);
+        return 0;
+    }
+
+    Logger *_Nullable log = nullptr;
+    Mono_Time *_Nullable mono_time = nullptr;
+    RTPSession *_Nullable sender = nullptr;
+    RTPSession *_Nullable receiver = nullptr;
+    std::vector<std::vector<std::uint8_t>> packets;
+    std::vector<std::uint8_t> frame;
+    std::uint64_t intact_frames = 0;
+};
+
+// Arguments: random loss in permille, FEC group size (0 = off).
+BENCHMARK_DEFINE_F(RtpFecBench, FrameRecovery)(benchmark::State &state)
+{
+    const std::uint32_t loss_permille = static_cast<std::uint32_t>(state.range(0));
+    rtp_set_fec_group_size(sender, static_cast<std::uint8_t>(state.range(1)));
+
+    // A 30 KB frame is about 24 fragments.
+    frame.resize(30000);
+    for (std::size_t i = 0; i < frame.size(); ++i) {
+        frame[i] = static_cast<std::uint8_t>(i * 13 + 1);
+    }
+
+    std::minstd_rand rng{42};
+    std::uint64_t frames_sent = 0;
+    std::uint64_t packets_sent = 0;
+    intact_frames = 0;
+
+    for (auto _ : state) {
+        packets.clear();
+        rtp_send_data(log, sender, frame.data(), static_cast<std::uint32_t>(frame.size()), false);
+        ++frames_sent;
+        packets_sent += packets.size();
+
+        for (const auto &packet : packets) {
+            if (rng() % 1000 >= loss_permille) {
+                rtp_receive_packet(receiver, packet.data(), packet.size());
+            }
+        }
+    }
+
+    state.counters["frame_recovery"]
+        = static_cast<double>(intact_frames) / static_cast<double>(frames_sent);
+    state.counters["packets_per_frame"]
+        = static_cast<double>(packets_sent) / static_cast<double>(frames_sent);
+}
+BENCHMARK_REGISTER_F(RtpFecBench, FrameRecovery)
+    ->ArgsProduct({{0, 10, 50, 100}, {0, 10, 4, 2}});
+
+// CPU cost of computing parity on the sending side.
+BENCHMARK_DEFINE_F(RtpFecBench, SendWithFec)(benchmark::State &state)
+{
+    rtp_set_fec_group_size(sender, static_cast<std::uint8_t>(state.range(0)));
+    frame.assign(60000, 0xAA);
+
+    for (auto _ : state) {
+        packets.clear();
+        rtp_send_data(log, sender, frame.data(), static_cast<std::uint32_t>(frame.size()), false);
+        benchmark::DoNotOptimize(packets.back());
+    }
+}
+BENCHMARK_REGISTER_F(RtpFecBench, SendWithFec)->Arg(0)->Arg(10)->Arg(4)->Arg(2);
+
+/**
+ * A bottleneck link with a drop-tail buffer, like the uplink of a home router.
+ * Packets that don't fit in the buffer are dropped, the rest are forwarded at
+ * the link rate and additionally subject to random loss.
+ */
+struct BottleneckLink {
+    struct FrameStats {
+        bool is_keyframe = false;
+        std::uint32_t sent = 0;
+        std::uint32_t delivered = 0;
+    };
+
+    std::uint32_t bytes_per_ms;
+    std::uint32_t buffer_bytes;
+    std::uint32_t loss_permille;
+
+    std::deque<std::vector<std::uint8_t>> queue;
+    std::uint32_t queued_bytes = 0;
+    std::uint32_t credit = 0;
+    std::minstd_rand rng{42};
+    std::map<std::uint16_t, FrameStats> frames;
+
+    BottleneckLink(std::uint32_t rate_bps, std::uint32_t buffer, std::uint32_t loss)
+        : bytes_per_ms(rate_bps / 8000)
+        , buffer_bytes(buffer)
+        , loss_permille(loss)
+    {
+    }
+
+    // Packet layout: 1 byte packet id, then the RTP header with the sequence
+    // number at offset 2 and the flags at offset 12.
+    static std::uint16_t sequnum(const std::vector<std::uint8_t> &packet)
+    {
+        return static_cast<std::uint16_t>(packet[3] << 8 | packet[4]);
+    }
+
+    static bool is_keyframe(const std::uint8_t *_Nonnull data)
+    {
+        return (data[1 + 12 + 7] & RTP_KEY_FRAME) != 0;
+    }
+
+    static int send_packet(
+        void *_Nullable user_data, const std::uint8_t *_Nonnull data, std::uint16_t length)
+    {
+        auto *link = static_cast<BottleneckLink *>(user_data);
+        std::vector<std::uint8_t> packet(data, data + length);
+
+        FrameStats &frame = link->frames[sequnum(packet)];
+        frame.is_keyframe = is_keyframe(data);
+        ++frame.sent;
+
+        if (link->queued_bytes + length > link->buffer_bytes) {
+            return 0;  // Drop-tail.
+        }
+
+        link->queued_bytes += length;
+        link->queue.push_back(std::move(packet));
+        return 0;
+    }
+
+    void tick()
+    {
+        credit += bytes_per_ms;
+
+        while (!queue.empty() && queue.front().size() <= credit) {
+            const std::vector<std::uint8_t> &packet = queue.front();
+            credit -= static_cast<std::uint32_t>(packet.size());
+            queued_bytes -= static_cast<std::uint32_t>(packet.size());
+
+            if (rng() % 1000 >= loss_permille) {
+                ++frames[sequnum(packet)].delivered;
+            }
+
+            queue.pop_front();
+        }
+
+        if (queue.empty()) {
+            credit = 0;
+        }
+    }
+};
+
+class PacedLinkBench : public benchmark::Fixture {
+public:
+    void SetUp(const ::benchmark::State &) override
+    {
+        const Memory *_Nonnull mem = os_memory();
+        log = logger_new(mem);
+        tm.t = 1000;
+        mono_time = mono_time_new(mem, mock_time_cb, &tm);
+        mono_time_update(mono_time);
+    }
+
+    void TearDown(const ::benchmark::State &) override
+    {
+        const Memory *mem = os_memory();
+        mono_time_free(mem, mono_time);
+        logger_kill(log);
+    }
+
+    static int pacer_enqueue_cb(
+        void *_Nullable user_data, const std::uint8_t *_Nonnull data, std::uint16_t length)
+    {
+        return pacer_enqueue(static_cast<Pacer *>(user_data), data, length);
+    }
+
+    void advance(BottleneckLink &link, Pacer *_Nullable pacer)
+    {
+        tm.t += 1;
+        mono_time_update(mono_time);
+
+        if (pacer != nullptr) {
+            pacer_process(pacer);
+        }
+
+        link.tick();
+    }
+
+    Logger *_Nullable log = nullptr;
+    Mono_Time *_Nullable mono_time = nullptr;
+    MockTime tm;
+};
+
+/**
+ * Send 10 seconds of 30 fps video (a 40 KB key frame every second, 3 KB delta
+ * frames in between; about 1 Mbit/s) over a 2 Mbit/s link with a 16 KB buffer
+ * and count the frames that arrive incomplete. Without pacing the key frame
+ * burst overflows the buffer.
+ *
+ * Arguments: paced (0/1), random loss in permille.
+ */
+BENCHMARK_DEFINE_F(PacedLinkBench, KeyframeLoss)(benchmark::State &state)
+{
+    const bool paced = state.range(0) != 0;
+    const std::uint32_t loss_permille = static_cast<std::uint32_t>(state.range(1));
+
+    const std::vector<std::uint8_t> keyframe(40000, 0xAA);
+    const std::vector<std::uint8_t> delta_frame(3000, 0xBB);
+
+    std::uint64_t keyframes_total = 0;
+    std::uint64_t keyframes_lost = 0;
+    std::uint64_t frames_total = 0;
+    std::uint64_t frames_lost = 0;
+
+    for (auto _ : state) {
+        BottleneckLink link(2000000, 16000, loss_permille);
+        Pacer *pacer = nullptr;
+
+        if (paced) {
+            pacer = pacer_new(log, mono_time, BottleneckLink::send_packet, &link);
+            pacer_set_bit_rate(pacer, 1000000);
+        }
+
+        RTPSession *session = paced
+            ? rtp_new(log, RTP_TYPE_VIDEO, mono_time, pacer_enqueue_cb, pacer, nullptr, nullptr,
+                  nullptr, &link, RtpMock::noop_cb)
+            : rtp_new(log, RTP_TYPE_VIDEO, mono_time, BottleneckLink::send_packet, &link,
+                  nullptr, nullptr, nullptr, &link, RtpMock::noop_cb);
+
+        for (int frame = 0; frame < 300; ++frame) {
+            const std::vector<std::uint8_t> &data = frame % 30 == 0 ? keyframe : delta_frame;
+            rtp_send_data(log, session, data.data(), static_cast<std::uint32_t>(data.size()),
+                frame % 30 == 0);
+
+            for (int ms = 0; ms < 33; ++ms) {
+                advance(link, pacer);
+            }
+        }
+
+        // Let the pacer and the link drain.
+        while (!link.queue.empty() || (pacer != nullptr && pacer_queue_length(pacer) > 0)) {
+            advance(link, pacer);
+        }
+
+        for (const auto &[seq, frame] : link.frames) {
+            const bool lost = frame.delivered < frame.sent;
+            ++frames_total;
+            frames_lost += lost;
+
+            if (frame.is_keyframe) {
+                ++keyframes_total;
+                keyframes_lost += lost;
+            }
+        }
+
+        rtp_kill(log, session);
+        pacer_kill(pacer);
+    }
+
+    state.counters["keyframe_loss"]
+        = static_cast<double>(keyframes_lost) / static_cast<double>(keyframes_total);
+    state.counters["frame_loss"]
+        = static_cast<double>(frames_lost) / static_cast<double>(frames_total);
+}
+BENCHMARK_REGISTER_F(PacedLinkBench, KeyframeLoss)
+    ->Args({0, 0})
+    ->Args({1, 0})
+    ->Args({0, 5})
+    ->Args({1, 5});
+
 }  // namespace
 
 BENCHMARK_MAIN();
@@ -972,4 +972,329 @@ TEST_F(RtpPublicTest, HeapBufferOverflowLogRead)
     rtp_kill(log, session);
 }
 
+/** Fragment payload size used by rtp_send_data. */
+constexpr std::uint32_t kPieceSize = MAX_CRYPTO_DATA_SIZE - (RTP_HEADER_SIZE + 1);
+
+bool is_fec_packet(const std::vector<std::uint8_t> &pkt)
+{
+    // Flags are the 64 bit big endian value at offset 12 of the RTP header.
+    return (pkt[1 + 12 + 7] & RTP_FEC_PARITY) != 0;
+}
+
+std::vector<std::uint8_t> make_frame(std::uint32_t size)
+{
+    std::vector<std::uint8_t> data(size);
+    for (std::uint32_t i = 0; i < size; ++i) {
+        data[i] = static_cast<std::uint8_t>(i * 7 + i / 251);
+    }
+    return data;
+}
+
+TEST_F(RtpPublicTest, FecPacketsPerGroup)
+{
+    MockSessionData sd;
+    RTPSession *session = rtp_new(log, RTP_TYPE_VIDEO, mono_time, mock_send_packet, &sd,
+        mock_add_recv, mock_add_lost, &sd, &sd, mock_m_cb);
+    rtp_set_fec_group_size(session, 4);
+
+    // 10 fragments, the last one short: 3 groups (4, 4, 2).
+    const std::vector<std::uint8_t> data = make_frame(kPieceSize * 9 + 100);
+    rtp_send_data(log, session, data.data(), static_cast<std::uint32_t>(data.size()), true);
+
+    ASSERT_EQ(sd.sent_packets.size(), 13);
+    EXPECT_TRUE(is_fec_packet(sd.sent_packets[4]));
+    EXPECT_TRUE(is_fec_packet(sd.sent_packets[9]));
+    EXPECT_TRUE(is_fec_packet(sd.sent_packets[12]));
+    EXPECT_EQ(std::count_if(sd.sent_packets.begin(), sd.sent_packets.end(), is_fec_packet), 3);
+
+    // Without loss, parity packets are simply ignored.
+    for (const auto &pkt : sd.sent_packets) {
+        rtp_receive_packet(session, pkt.data(), pkt.size());
+    }
+
+    ASSERT_EQ(sd.received_frames.size(), 1);
+    EXPECT_EQ(sd.received_frames[0], data);
+
+    rtp_kill(log, session);
+}
+
+TEST_F(RtpPublicTest, FecRecoversOneLostFragmentPerGroup)
+{
+    MockSessionData sd;
+    RTPSession *session = rtp_new(log, RTP_TYPE_VIDEO, mono_time, mock_send_packet, &sd,
+        mock_add_recv, mock_add_lost, &sd, &sd, mock_m_cb);
+    rtp_set_fec_group_size(session, 4);
+
+    const std::vector<std::uint8_t> data = make_frame(kPieceSize * 9 + 100);
+    rtp_send_data(log, session, data.data(), static_cast<std::uint32_t>(data.size()), true);
+    ASSERT_EQ(sd.sent_packets.size(), 13);
+
+    // Lose the first fragment of group 0, a middle one of group 1 and the
+    // short last fragment.
+    for (std::size_t i = 0; i < sd.sent_packets.size(); ++i) {
+        if (i == 0 || i == 7 || i == 11) {
+            continue;
+        }
+        rtp_receive_packet(session, sd.sent_packets[i].data(), sd.sent_packets[i].size());
+    }
+
+    ASSERT_EQ(sd.received_frames.size(), 1);
+    EXPECT_EQ(sd.received_frames[0], data);
+
+    rtp_kill(log, session);
+}
+
+TEST_F(RtpPublicTest, FecCannotRecoverTwoLossesInGroup)
+{
+    MockSessionData sd;
+    RTPSession *session = rtp_new(log, RTP_TYPE_VIDEO, mono_time, mock_send_packet, &sd,
+        mock_add_recv, mock_add_lost, &sd, &sd, mock_m_cb);
+    rtp_set_fec_group_size(session, 4);
+
+    const std::vector<std::uint8_t> data = make_frame(kPieceSize * 8);
+    rtp_send_data(log, session, data.data(), static_cast<std::uint32_t>(data.size()), false);
+    ASSERT_EQ(sd.sent_packets.size(), 10);
+
+    for (std::size_t i = 0; i < sd.sent_packets.size(); ++i) {
+        if (i == 1 || i == 2) {
+            continue;
+        }
+        rtp_receive_packet(session, sd.sent_packets[i].data(), sd.sent_packets[i].size());
+    }
+
+    EXPECT_TRUE(sd.received_frames.empty());
+
+    rtp_kill(log, session);
+}
+
+TEST_F(RtpPublicTest, FecDuplicatesDoNotCorruptFrame)
+{
+    MockSessionData sd;
+    RTPSession *session = rtp_new(log, RTP_TYPE_VIDEO, mono_time, mock_send_packet, &sd,
+        mock_add_recv, mock_add_lost, &sd, &sd, mock_m_cb);
+    rtp_set_fec_group_size(session, 2);
+
+    const std::vector<std::uint8_t> data = make_frame(kPieceSize * 3 + 10);
+    rtp_send_data(log, session, data.data(), static_cast<std::uint32_t>(data.size()), false);
+    // 4 fragments in 2 groups of 2.
+    ASSERT_EQ(sd.sent_packets.size(), 6);
+
+    // Fragment 0 is recovered from parity, then arrives late. Fragment 2 is
+    // received twice.
+    for (const std::size_t i : {1, 2, 0, 3, 3}) {
+        rtp_receive_packet(session, sd.sent_packets[i].data(), sd.sent_packets[i].size());
+    }
+    EXPECT_TRUE(sd.received_frames.empty());
+    rtp_receive_packet(session, sd.sent_packets[4].data(), sd.sent_packets[4].size());
+
+    ASSERT_EQ(sd.received_frames.size(), 1);
+    EXPECT_EQ(sd.received_frames[0], data);
+
+    rtp_kill(log, session);
+}
+
+TEST_F(RtpPublicTest, FecRecoveredBytesAreReportedLost)
+{
+    MockSessionData sd;
+    RTPSession *session = rtp_new(log, RTP_TYPE_VIDEO, mono_time, mock_send_packet, &sd,
+        mock_add_recv, mock_add_lost, &sd, &sd, mock_m_cb);
+
+    // Get past DISMISS_FIRST_LOST_VIDEO_PACKET_COUNT.
+    std::uint8_t small[] = "test";
+    for (int i = 0; i < 10; ++i) {
+        sd.sent_packets.clear();
+        rtp_send_data(log, session, small, sizeof(small), false);
+        rtp_receive_packet(session, sd.sent_packets[0].data(), sd.sent_packets[0].size());
+    }
+
+    rtp_set_fec_group_size(session, 4);
+    sd.sent_packets.clear();
+    const std::vector<std::uint8_t> data = make_frame(kPieceSize * 4);
+    rtp_send_data(log, session, data.data(), static_cast<std::uint32_t>(data.size()), false);
+    ASSERT_EQ(sd.sent_packets.size(), 5);
+
+    for (std::size_t i = 1; i < sd.sent_packets.size(); ++i) {
+        rtp_receive_packet(session, sd.sent_packets[i].data(), sd.sent_packets[i].size());
+    }
+
+    ASSERT_EQ(sd.received_frames.size(), 11);
+    EXPECT_EQ(sd.received_frames.back(), data);
+    // The sender should still learn about the loss so it keeps sending FEC.
+    EXPECT_EQ(sd.total_bytes_lost, kPieceSize);
+
+    rtp_kill(log, session);
+}
+
+TEST_F(RtpPublicTest, FecIgnoresInvalidParity)
+{
+    MockSessionData sd;
+    RTPSession *session = rtp_new(log, RTP_TYPE_VIDEO, mono_time, mock_send_packet, &sd,
+        mock_add_recv, mock_add_lost, &sd, &sd, mock_m_cb);
+    rtp_set_fec_group_size(session, 4);
+
+    const std::vector<std::uint8_t> data = make_frame(kPieceSize * 4);
+    rtp_send_data(log, session, data.data(), static_cast<std::uint32_t>(data.size()), false);
+    ASSERT_EQ(sd.sent_packets.size(), 5);
+
+    for (std::size_t i = 1; i < 4; ++i) {
+        rtp_receive_packet(session, sd.sent_packets[i].data(), sd.sent_packets[i].size());
+    }
+
+    // Claim the parity covers more fragments than the frame has.
+    std::vector<std::uint8_t> bad = sd.sent_packets[4];
+    bad[1 + 34] = 0;
+    bad[1 + 35] = 200;
+    rtp_receive_packet(session, bad.data(), bad.size());
+
+    // Truncated parity.
+    bad = sd.sent_packets[4];
+    bad.resize(bad.size() - 10);
+    rtp_receive_packet(session, bad.data(), bad.size());
+
+    EXPECT_TRUE(sd.received_frames.empty());
+
+    rtp_receive_packet(session, sd.sent_packets[4].data(), sd.sent_packets[4].size());
+    ASSERT_EQ(sd.received_frames.size(), 1);
+    EXPECT_EQ(sd.received_frames[0], data);
+
+    rtp_kill(log, session);
+}
+
+struct FecTimeMock {
+    std::uint64_t t;
+};
+
+std::uint64_t fec_mock_time_cb(void *ud) { return static_cast<FecTimeMock *>(ud)->t; }
+
+TEST_F(RtpPublicTest, FecAdaptsToReportedLoss)
+{
+    const Memory *_Nonnull mem = os_memory();
+    FecTimeMock tm{1000};
+    Mono_Time *mock_mono_time = mono_time_new(mem, fec_mock_time_cb, &tm);
+
+    MockSessionData sd;
+    RTPSession *session = rtp_new(log, RTP_TYPE_VIDEO, mock_mono_time, mock_send_packet, &sd,
+        nullptr, nullptr, nullptr, &sd, mock_m_cb);
+
+    EXPECT_EQ(rtp_get_fec_group_size(session), 0);
+
+    rtp_set_reported_loss(session, 0.005F);
+    EXPECT_EQ(rtp_get_fec_group_size(session), 0);
+
+    rtp_set_reported_loss(session, 0.02F);
+    const std::uint8_t low_loss_group = rtp_get_fec_group_size(session);
+    EXPECT_GT(low_loss_group, 0);
+
+    rtp_set_reported_loss(session, 0.15F);
+    const std::uint8_t high_loss_group = rtp_get_fec_group_size(session);
+    EXPECT_GT(high_loss_group, 0);
+    EXPECT_LT(high_loss_group, low_loss_group);
+
+    // No report for a while: FEC is switched off on the next frame.
+    tm.t += 10000;
+    const std::vector<std::uint8_t> data = make_frame(kPieceSize * 4);
+    rtp_send_data(log, session, data.data(), static_cast<std::uint32_t>(data.size()), false);
+    EXPECT_EQ(sd.sent_packets.size(), 4);
+    EXPECT_EQ(rtp_get_fec_group_size(session), 0);
+
+    // An explicitly set group size does not time out.
+    rtp_set_fec_group_size(session, 3);
+    tm.t += 10000;
+    sd.sent_packets.clear();
+    rtp_send_data(log, session, data.data(), static_cast<std::uint32_t>(data.size()), false);
+    EXPECT_EQ(sd.sent_packets.size(), 6);
+
+    rtp_kill(log, session);
+    mono_time_free(mem, mock_mono_time);
+}
+
+TEST_F(RtpPublicTest, StatsCountPacketsAndJitter)
+{
+    const Memory *_Nonnull mem = os_memory();
+    FecTimeMock tm{1000};
+    Mono_Time *mock_mono_time = mono_time_new(mem, fec_mock_time_cb, &tm);
+
+    MockSessionData sd;
+    RTPSession *session = rtp_new(log, RTP_TYPE_AUDIO, mock_mono_time, mock_send_packet, &sd,
+        nullptr, nullptr, nullptr, &sd, mock_m_cb);
+
+    // One 100 byte frame every 20 ms, arriving after the given network delay.
+    const std::uint8_t data[100] = {0};
+    auto send_and_receive = [&](std::uint64_t delay) {
+        const std::uint64_t sent = tm.t;
+        rtp_send_data(log, session, data, sizeof(data), false);
+        tm.t += delay;
+        rtp_receive_packet(session, sd.sent_packets.back().data(), sd.sent_packets.back().size());
+        tm.t = sent + 20;
+    };
+
+    RTPStats stats;
+
+    // Constant delay: no jitter.
+    for (int i = 0; i < 20; ++i) {
+        send_and_receive(30);
+    }
+
+    rtp_get_stats(session, &stats);
+    EXPECT_EQ(stats.packets_sent, 20);
+    EXPECT_EQ(stats.packets_received, 20);
+    EXPECT_EQ(stats.jitter, 0);
+
+    // Delay alternating between 10 and 50 ms: the estimate approaches 40 ms.
+    for (int i = 0; i < 50; ++i) {
+        send_and_receive(i % 2 == 0 ? 10 : 50);
+    }
+
+    rtp_get_stats(session, &stats);
+    EXPECT_EQ(stats.packets_received, 70);
+    EXPECT_GT(stats.jitter, 30);
+    EXPECT_LE(stats.jitter, 40);
+
+    // 50 packets of 100 bytes plus headers per second.
+    EXPECT_NEAR(stats.send_bit_rate, 50 * (100 + RTP_HEADER_SIZE + 1) * 8, 2000);
+
+    // Nothing sent for a while.
+    tm.t += 5000;
+    rtp_get_stats(session, &stats);
+    EXPECT_EQ(stats.send_bit_rate, 0);
+
+    rtp_kill(log, session);
+    mono_time_free(mem, mock_mono_time);
+}
+
+TEST_F(RtpPublicTest, StatsJitterUsesFirstFragmentOfFrame)
+{
+    const Memory *_Nonnull mem = os_memory();
+    FecTimeMock tm{1000};
+    Mono_Time *mock_mono_time = mono_time_new(mem, fec_mock_time_cb, &tm);
+
+    MockSessionData sd;
+    RTPSession *session = rtp_new(log, RTP_TYPE_VIDEO, mock_mono_time, mock_send_packet, &sd,
+        nullptr, nullptr, nullptr, &sd, mock_m_cb);
+
+    const std::vector<std::uint8_t> data = make_frame(kPieceSize * 4);
+
+    for (int frame = 0; frame < 10; ++frame) {
+        sd.sent_packets.clear();
+        rtp_send_data(log, session, data.data(), static_cast<std::uint32_t>(data.size()), false);
+
+        // The fragments of a frame arrive spread out over time, but that is
+        // not jitter between frames.
+        for (const auto &packet : sd.sent_packets) {
+            tm.t += 10;
+            rtp_receive_packet(session, packet.data(), packet.size());
+        }
+
+        tm.t += 60;
+    }
+
+    RTPStats stats;
+    rtp_get_stats(session, &stats);
+    EXPECT_EQ(stats.packets_received, 40);
+    EXPECT_EQ(stats.jitter, 0);
+
+    rtp_kill(log, session);
+    mono_time_free(mem, mock_mono_time);
+}
+
 }  // namespace
@@ -12,6 +12,7 @@
 #include "audio.h"
 #include "bwcontroller.h"
 #include "msi.h"
+#include "pacer.h"
 #include "rtp.h"
 #include "video.h"
 
@@ -31,6 +32,9 @@
 // iteration interval that is used when no call is active
 #define IDLE_ITERATION_INTERVAL_MS 1000
 
+// how often the call_stats callback is invoked for each call
+#define CALL_STATS_INTERVAL_MS 1000
+
 typedef struct ToxAVCall ToxAVCall;
 
 static ToxAVCall *_Nullable call_get(ToxAV *_Nonnull av, uint32_t friend_number);
@@ -49,6 +53,7 @@ struct ToxAVCall {
     VCSession *_Nullable video;
 
     BWController *_Nullable bwc;
+    Pacer *_Nullable pacer;
 
     bool active;
     MSICall *_Nullable msi_call;
@@ -66,6 +71,21 @@ struct ToxAVCall {
     toxav_video_receive_frame_cb *_Nullable vcb;
     void *_Nullable vcb_user_data;
 
+    /* Average encoding times in microseconds, guarded by mutex_audio and mutex_video */
+    uint32_t audio_encode_time_us;
+    uint32_t video_encode_time_us;
+
+    /** Time of the last call_stats callback */
+    uint64_t last_stats_time;
+
+    /**
+     * Loss last reported by the peer, not yet passed on to video_rtp. Guarded
+     * by av->mutex, because the report arrives on the tox thread, which must
+     * not take mutex_video.
+     */
+    float reported_video_loss;
+    bool has_reported_video_loss;
+
     pthread_mutex_t toxav_call_mutex[1];
 
     struct ToxAVCall *_Nullable prev;
@@ -85,6 +105,20 @@ typedef struct DecodeTimeStats {
     uint32_t interval;
 } DecodeTimeStats;
 
+struct Toxav_Call_Stats {
+    uint32_t rtt;
+    float receive_loss;
+    float send_loss;
+
+    RTPStats audio_rtp;
+    ACStats audio;
+    uint32_t audio_encode_time;
+
+    RTPStats video_rtp;
+    VCStats video;
+    uint32_t video_encode_time;
+};
+
 struct ToxAV {
     const struct Memory *_Nonnull mem;
     Logger *_Nonnull log;
@@ -115,6 +149,9 @@ struct ToxAV {
     /* Bit rate control callback */
     toxav_video_bit_rate_cb *_Nullable vbcb;
     void *_Nullable vbcb_user_data;
+    /* Call statistics callback */
+    toxav_call_stats_cb *_Nullable stcb;
+    void *_Nullable stcb_user_data;
 
     /* keep track of decode times for audio and video */
     DecodeTimeStats audio_stats;
@@ -124,6 +161,7 @@ struct ToxAV {
 };
 
 static void callback_bwc(BWController *_Nonnull bwc, Tox_Friend_Number friend_number, float loss, void *_Nonnull user_data);
+static void call_report_stats(ToxAVCall *_Nonnull call, toxav_call_stats_cb *_Nonnull stcb, void *_Nullable user_data);
 
 static int msi_send_packet(void *_Nonnull user_data, uint32_t friend_number, const uint8_t *_Nonnull data, size_t length)
 {
@@ -163,6 +201,35 @@ static int rtp_send_packet(void *_Nonnull user_data, const uint8_t *_Nonnull dat
     return error == TOX_ERR_FRIEND_CUSTOM_PACKET_OK ? 0 : -1;
 }
 
+/**
+ * Audio packets bypass the pacer queue, but are accounted in its budget so
+ * queued video yields to audio.
+ */
+static int rtp_send_audio_packet(void *_Nonnull user_data, const uint8_t *_Nonnull data, uint16_t length)
+{
+    const ToxAVCall *call = (const ToxAVCall *)user_data;
+
+    if (call->pacer == nullptr) {
+        return rtp_send_packet(user_data, data, length);
+    }
+
+    return pacer_send_priority(call->pacer, data, length);
+}
+
+/**
+ * Video packets are queued in the pacer and sent from `pacer_process`.
+ */
+static int rtp_send_video_packet(void *_Nonnull user_data, const uint8_t *_Nonnull data, uint16_t length)
+{
+    const ToxAVCall *call = (const ToxAVCall *)user_data;
+
+    if (call->pacer == nullptr) {
+        return rtp_send_packet(user_data, data, length);
+    }
+
+    return pacer_enqueue(call->pacer, data, length);
+}
+
 static void rtp_add_recv(void *_Nullable user_data, uint32_t bytes)
 {
     BWController *bwc = (BWController *)user_data;
@@ -367,7 +434,8 @@ ToxAV *_Nullable toxav_new(Tox *_Nonnull tox, Toxav_Err_New *_Nullable error)
     tox_callback_friend_lossy_packet_per_pktid(av->tox, handle_bwc_packet, BWC_PACKET_ID);
     tox_callback_friend_lossless_packet_per_pktid(av->tox, handle_msi_packet, PACKET_ID_MSI);
 
-    av->toxav_mono_time = mono_time_new(tox->sys.mem, nullptr, nullptr);
+    // Follow the Tox instance's clock, so ToxAV runs on simulated time in tests.
+    av->toxav_mono_time = mono_time_new(tox->sys.mem, tox->sys.mono_time_callback, tox->sys.mono_time_user_data);
 
     if (av->msi == nullptr) {
         tox_callback_friend_lossy_packet_per_pktid(av->tox, nullptr, RTP_TYPE_AUDIO);
@@ -477,6 +545,20 @@ uint32_t toxav_iteration_interval(const ToxAV *_Nonnull av)
                    toxav_video_iteration_interval(av));
 }
 
+/**
+ * @brief Update a moving average over roughly the last 8 samples.
+ *
+ * The clock only has millisecond resolution, but the average of many samples
+ * still gives a useful sub-millisecond value.
+ *
+ * @param average_us The current average in microseconds.
+ * @param sample_ms The new sample in milliseconds.
+ */
+static uint32_t update_time_average(uint32_t average_us, uint64_t sample_ms)
+{
+    return average_us - average_us / 8 + (uint32_t)min_u64(sample_ms * 1000 / 8, UINT32_MAX / 8);
+}
+
 /**
  * @brief calc_interval Calculates the needed iteration interval based on previous decode times
  * @param mono_time Mono_Time struct to work on
@@ -515,6 +597,10 @@ static void iterate_common(ToxAV *_Nonnull av, bool audio)
     const uint64_t start = current_time_monotonic(mono_time);
     int32_t frame_time = IDLE_ITERATION_INTERVAL_MS;
 
+    /* Read here, because av->mutex must not be taken while holding a call mutex */
+    toxav_call_stats_cb *stcb = av->stcb;
+    void *stcb_user_data = av->stcb_user_data;
+
     for (ToxAVCall *i = av->calls[av->calls_head]; i != nullptr; i = i->next) {
         if (!i->active) {
             continue;
@@ -535,6 +621,11 @@ static void iterate_common(ToxAV *_Nonnull av, bool audio)
             break;
         }
 
+        if (stcb != nullptr && current_time_monotonic(mono_time) - i->last_stats_time >= CALL_STATS_INTERVAL_MS) {
+            i->last_stats_time = current_time_monotonic(mono_time);
+            call_report_stats(i, stcb, stcb_user_data);
+        }
+
         if (audio) {
             ac_iterate(i->audio);
 
@@ -545,6 +636,15 @@ static void iterate_common(ToxAV *_Nonnull av, bool audio)
         } else {
             vc_iterate(i->video);
 
+            if (i->pacer != nullptr) {
+                pacer_process(i->pacer);
+
+                if (pacer_queue_length(i->pacer) > 0) {
+                    // Come back when the next queued packet may be sent.
+                    frame_time = min_s32((int32_t)min_u32(pacer_next_send_delay(i->pacer), INT32_MAX), frame_time);
+                }
+            }
+
             if ((i->msi_call->self_capabilities & MSI_CAP_R_VIDEO) != 0 &&
                     (i->msi_call->peer_capabilities & MSI_CAP_S_VIDEO) != 0) {
                 pthread_mutex_lock(vc_get_queue_mutex(i->video));
@@ -1089,8 +1189,11 @@ bool toxav_audio_send_frame(ToxAV *_Nonnull av, Tox_Friend_Number friend_number,
 
         sampling_rate = net_htonl(sampling_rate);
         memcpy(dest, &sampling_rate, sizeof(sampling_rate));
+        const uint64_t encode_start = current_time_monotonic(av->toxav_mono_time);
         const int vrc = ac_encode(call->audio, pcm, sample_count,
                                   dest + sizeof(sampling_rate), dest_size - sizeof(sampling_rate));
+        call->audio_encode_time_us = update_time_average(call->audio_encode_time_us,
+                                     current_time_monotonic(av->toxav_mono_time) - encode_start);
 
         if (vrc < 0) {
             pthread_mutex_unlock(call->mutex_audio);
@@ -1173,9 +1276,17 @@ bool toxav_video_send_frame(ToxAV *_Nonnull av, Tox_Friend_Number friend_number,
         goto RETURN;
     }
 
+    const bool has_reported_loss = call->has_reported_video_loss;
+    const float reported_loss = call->reported_video_loss;
+    call->has_reported_video_loss = false;
+
     pthread_mutex_lock(call->mutex_video);
     pthread_mutex_unlock(av->mutex);
 
+    if (has_reported_loss && call->video_rtp != nullptr) {
+        rtp_set_reported_loss(call->video_rtp, reported_loss);
+    }
+
     if (y == nullptr || u == nullptr || v == nullptr) {
         pthread_mutex_unlock(call->mutex_video);
         rc = TOXAV_ERR_SEND_FRAME_NULL;
@@ -1203,16 +1314,28 @@ bool toxav_video_send_frame(ToxAV *_Nonnull av, Tox_Friend_Number friend_number,
         rtp_session_set_ssrc(call->video_rtp, rtp_session_get_ssrc(call->video_rtp) + 1);
     }
 
+    const uint64_t encode_start = current_time_monotonic(av->toxav_mono_time);
+
     if (vc_encode(call->video, width, height, y, u, v, video_encode_flags) != 0) {
         pthread_mutex_unlock(call->mutex_video);
         rc = TOXAV_ERR_SEND_FRAME_INVALID;
         goto RETURN;
     }
 
+    call->video_encode_time_us = update_time_average(call->video_encode_time_us,
+                                 current_time_monotonic(av->toxav_mono_time) - encode_start);
+
     vc_increment_frame_counter(call->video);
 
+    // The pacer budget covers both streams, since audio packets are accounted in it.
+    pacer_set_bit_rate(call->pacer, (call->video_bit_rate + call->audio_bit_rate) * 1000);
+
     rc = send_frames(av, call);
 
+    // Send whatever the current budget allows right away; the rest is sent
+    // from toxav_video_iterate.
+    pacer_process(call->pacer);
+
     pthread_mutex_unlock(call->mutex_video);
 
 RETURN:
@@ -1224,6 +1347,241 @@ RETURN:
     return rc == TOXAV_ERR_SEND_FRAME_OK;
 }
 
+uint32_t toxav_video_get_send_queue_delay(ToxAV *_Nonnull av, Tox_Friend_Number friend_number, Toxav_Err_Call_Query *_Nullable error)
+{
+    Toxav_Err_Call_Query rc = TOXAV_ERR_CALL_QUERY_OK;
+    const ToxAVCall *call;
+    uint32_t delay = 0;
+
+    if (!tox_friend_exists(av->tox, friend_number)) {
+        rc = TOXAV_ERR_CALL_QUERY_FRIEND_NOT_FOUND;
+        goto RETURN;
+    }
+
+    pthread_mutex_lock(av->mutex);
+    call = call_get(av, friend_number);
+
+    if (call == nullptr || !call->active || call->pacer == nullptr) {
+        pthread_mutex_unlock(av->mutex);
+        rc = TOXAV_ERR_CALL_QUERY_FRIEND_NOT_IN_CALL;
+        goto RETURN;
+    }
+
+    delay = pacer_queue_delay(call->pacer);
+    pthread_mutex_unlock(av->mutex);
+
+RETURN:
+
+    if (error != nullptr) {
+        *error = rc;
+    }
+
+    return delay;
+}
+
+Toxav_Call_Stats *toxav_call_stats_new(void)
+{
+    return (Toxav_Call_Stats *)calloc(1, sizeof(Toxav_Call_Stats));
+}
+
+void toxav_call_stats_free(Toxav_Call_Stats *_Nullable stats)
+{
+    free(stats);
+}
+
+/**
+ * @brief Fill in the statistics of a call.
+ *
+ * Must be called with toxav_call_mutex held, which keeps the decoders in
+ * iterate_common from running concurrently. The RTT is passed in, because it
+ * has to be read under the tox lock, which must not be taken while holding
+ * av->mutex.
+ */
+static void call_get_stats(ToxAVCall *_Nonnull call, uint32_t rtt, Toxav_Call_Stats *_Nonnull stats)
+{
+    memset(stats, 0, sizeof(Toxav_Call_Stats));
+    stats->rtt = rtt;
+
+    if (call->bwc != nullptr) {
+        stats->receive_loss = bwc_get_receive_loss(call->bwc);
+        stats->send_loss = bwc_get_send_loss(call->bwc);
+    }
+
+    pthread_mutex_lock(call->mutex_audio);
+
+    if (call->audio_rtp != nullptr) {
+        rtp_get_stats(call->audio_rtp, &stats->audio_rtp);
+    }
+
+    if (call->audio != nullptr) {
+        ac_get_stats(call->audio, &stats->audio);
+    }
+
+    stats->audio_encode_time = call->audio_encode_time_us;
+    pthread_mutex_unlock(call->mutex_audio);
+
+    pthread_mutex_lock(call->mutex_video);
+
+    if (call->video_rtp != nullptr) {
+        rtp_get_stats(call->video_rtp, &stats->video_rtp);
+    }
+
+    if (call->video != nullptr) {
+        vc_get_stats(call->video, &stats->video);
+    }
+
+    stats->video_encode_time = call->video_encode_time_us;
+    pthread_mutex_unlock(call->mutex_video);
+}
+
+static uint32_t friend_get_rtt(const ToxAV *_Nonnull av, Tox_Friend_Number friend_number)
+{
+    tox_lock(av->tox);
+    const uint32_t rtt = m_get_friend_rtt(av->tox->m, friend_number);
+    tox_unlock(av->tox);
+    return rtt;
+}
+
+bool toxav_call_get_stats(ToxAV *_Nonnull av, Tox_Friend_Number friend_number, Toxav_Call_Stats *_Nonnull stats,
+                          Toxav_Err_Call_Query *_Nullable error)
+{
+    Toxav_Err_Call_Query rc = TOXAV_ERR_CALL_QUERY_OK;
+    ToxAVCall *call;
+    uint32_t rtt;
+
+    if (!tox_friend_exists(av->tox, friend_number)) {
+        rc = TOXAV_ERR_CALL_QUERY_FRIEND_NOT_FOUND;
+        goto RETURN;
+    }
+
+    rtt = friend_get_rtt(av, friend_number);
+
+    pthread_mutex_lock(av->mutex);
+    call = call_get(av, friend_number);
+
+    if (call == nullptr || !call->active) {
+        pthread_mutex_unlock(av->mutex);
+        rc = TOXAV_ERR_CALL_QUERY_FRIEND_NOT_IN_CALL;
+        goto RETURN;
+    }
+
+    pthread_mutex_lock(call->toxav_call_mutex);
+    call_get_stats(call, rtt, stats);
+    pthread_mutex_unlock(call->toxav_call_mutex);
+    pthread_mutex_unlock(av->mutex);
+
+RETURN:
+
+    if (error != nullptr) {
+        *error = rc;
+    }
+
+    return rc == TOXAV_ERR_CALL_QUERY_OK;
+}
+
+void toxav_callback_call_stats(ToxAV *_Nonnull av, toxav_call_stats_cb *_Nullable callback, void *_Nullable user_data)
+{
+    pthread_mutex_lock(av->mutex);
+    av->stcb = callback;
+    av->stcb_user_data = user_data;
+    pthread_mutex_unlock(av->mutex);
+}
+
+uint32_t toxav_call_stats_get_rtt(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->rtt;
+}
+
+uint32_t toxav_call_stats_get_audio_jitter(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->audio_rtp.jitter;
+}
+
+uint32_t toxav_call_stats_get_video_jitter(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->video_rtp.jitter;
+}
+
+float toxav_call_stats_get_receive_loss(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->receive_loss;
+}
+
+float toxav_call_stats_get_send_loss(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->send_loss;
+}
+
+uint64_t toxav_call_stats_get_audio_packets_received(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->audio_rtp.packets_received;
+}
+
+uint64_t toxav_call_stats_get_video_packets_received(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->video_rtp.packets_received;
+}
+
+uint32_t toxav_call_stats_get_audio_frames_decoded(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->audio.frames_decoded;
+}
+
+uint32_t toxav_call_stats_get_audio_frames_concealed(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->audio.frames_concealed;
+}
+
+uint32_t toxav_call_stats_get_video_frames_decoded(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->video.frames_decoded;
+}
+
+uint32_t toxav_call_stats_get_video_frames_dropped(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->video.frames_dropped;
+}
+
+uint32_t toxav_call_stats_get_audio_encode_time(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->audio_encode_time;
+}
+
+uint32_t toxav_call_stats_get_video_encode_time(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->video_encode_time;
+}
+
+uint32_t toxav_call_stats_get_audio_decode_time(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->audio.decode_time_us;
+}
+
+uint32_t toxav_call_stats_get_video_decode_time(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->video.decode_time_us;
+}
+
+uint32_t toxav_call_stats_get_audio_jitter_buffer_depth(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->audio.jitter_buffer_depth;
+}
+
+uint32_t toxav_call_stats_get_video_jitter_buffer_depth(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->video.queue_depth;
+}
+
+uint32_t toxav_call_stats_get_audio_send_bit_rate(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->audio_rtp.send_bit_rate;
+}
+
+uint32_t toxav_call_stats_get_video_send_bit_rate(const Toxav_Call_Stats *_Nonnull stats)
+{
+    return stats->video_rtp.send_bit_rate;
+}
+
 void toxav_callback_audio_receive_frame(ToxAV *_Nonnull av, toxav_audio_receive_frame_cb *_Nullable callback, void *_Nullable user_data)
 {
     pthread_mutex_lock(av->mutex);
@@ -1279,13 +1637,20 @@ static void callback_bwc(BWController *bwc, Tox_Friend_Number friend_number, flo
 
     LOGGER_DEBUG(call->av->log, "Reported loss of %f%%", (double)loss * 100);
 
+    pthread_mutex_lock(call->av->mutex);
+
+    /* Adapt the video FEC redundancy to the loss, even if it's too small to
+     * lower the bit rate for. The next video frame passes it on, since
+     * toxav_video_send_frame sends while holding mutex_video. */
+    call->reported_video_loss = loss;
+    call->has_reported_video_loss = true;
+
     /* if less than 10% data loss we do nothing! */
     if (loss < 0.1F) {
+        pthread_mutex_unlock(call->av->mutex);
         return;
     }
 
-    pthread_mutex_lock(call->av->mutex);
-
     if (call->video_bit_rate != 0) {
         if (call->av->vbcb == nullptr) {
             pthread_mutex_unlock(call->av->mutex);
@@ -1311,6 +1676,17 @@ static void callback_bwc(BWController *bwc, Tox_Friend_Number friend_number, flo
     pthread_mutex_unlock(call->av->mutex);
 }
 
+/**
+ * Invoke the call_stats callback for a call. Called from iterate_common with
+ * toxav_call_mutex held.
+ */
+static void call_report_stats(ToxAVCall *call, toxav_call_stats_cb *stcb, void *user_data)
+{
+    Toxav_Call_Stats stats;
+    call_get_stats(call, friend_get_rtt(call->av, call->friend_number), &stats);
+    stcb(call->av, call->friend_number, &stats, user_data);
+}
+
 static int callback_invite(void *object, MSICall *call)
 {
     ToxAV *toxav = (ToxAV *)object;
@@ -1635,6 +2011,13 @@ static bool call_prepare_transmission(ToxAVCall *call)
     /* Prepare bwc */
     call->bwc = bwc_new(av->log, call->friend_number, callback_bwc, call, rtp_send_packet, call, av->toxav_mono_time);
 
+    call->pacer = pacer_new(av->log, av->toxav_mono_time, rtp_send_packet, call);
+
+    if (call->pacer == nullptr) {
+        LOGGER_ERROR(av->log, "Failed to create pacer");
+        goto FAILURE;
+    }
+
     { /* Prepare audio */
         call->acb = av->acb;
         call->acb_user_data = av->acb_user_data;
@@ -1646,7 +2029,7 @@ static bool call_prepare_transmission(ToxAVCall *call)
         }
 
         call->audio_rtp = rtp_new(av->log, RTP_TYPE_AUDIO, av->toxav_mono_time,
-                                  rtp_send_packet, call,
+                                  rtp_send_audio_packet, call,
                                   rtp_add_recv, rtp_add_lost, call->bwc,
                                   call->audio, ac_queue_message);
 
@@ -1666,7 +2049,7 @@ static bool call_prepare_transmission(ToxAVCall *call)
         }
 
         call->video_rtp = rtp_new(av->log, RTP_TYPE_VIDEO, av->toxav_mono_time,
-                                  rtp_send_packet, call,
+                                  rtp_send_video_packet, call,
                                   rtp_add_recv, rtp_add_lost, call->bwc,
                                   call->video, vc_queue_message);
 
@@ -1689,6 +2072,8 @@ FAILURE:
     vc_kill(call->video);
     call->video_rtp = nullptr;
     call->video = nullptr;
+    pacer_kill(call->pacer);
+    call->pacer = nullptr;
     pthread_mutex_destroy(call->mutex_video);
 FAILURE_2:
     pthread_mutex_destroy(call->mutex_audio);
@@ -1724,6 +2109,9 @@ static void call_kill_transmission(ToxAVCall *call)
     call->video_rtp = nullptr;
     call->video = nullptr;
 
+    pacer_kill(call->pacer);
+    call->pacer = nullptr;
+
     pthread_mutex_destroy(call->mutex_audio);
     pthread_mutex_destroy(call->mutex_video);
 }
@@ -693,6 +693,41 @@ typedef void toxav_video_bit_rate_cb(ToxAV *av, Tox_Friend_Number friend_number,
  */
 void toxav_callback_video_bit_rate(ToxAV *av, toxav_video_bit_rate_cb *callback, void *user_data);
 
+typedef enum Toxav_Err_Call_Query {
+
+    /**
+     * The function returned successfully.
+     */
+    TOXAV_ERR_CALL_QUERY_OK,
+
+    /**
+     * The friend_number passed did not designate a valid friend.
+     */
+    TOXAV_ERR_CALL_QUERY_FRIEND_NOT_FOUND,
+
+    /**
+     * This client is currently not in a call with the friend.
+     */
+    TOXAV_ERR_CALL_QUERY_FRIEND_NOT_IN_CALL,
+
+} Toxav_Err_Call_Query;
+
+/**
+ * Return the current video send queue delay in milliseconds.
+ *
+ * Video frames are split into packets which are not all sent at once, but
+ * paced according to the current audio and video bit rates, so that large
+ * frames (e.g. key frames) don't overflow network buffers. This function
+ * returns the expected time until all currently queued video packets have been
+ * sent. A persistently high value means the video bit rate is too high for the
+ * frame sizes the encoder produces.
+ *
+ * @param friend_number The friend number of the friend in the call.
+ *
+ * @return the queue delay in milliseconds, or 0 on error.
+ */
+uint32_t toxav_video_get_send_queue_delay(ToxAV *av, Tox_Friend_Number friend_number, Toxav_Err_Call_Query *error);
+
 /** @} */
 
 /** @{
@@ -756,6 +791,146 @@ typedef void toxav_video_receive_frame_cb(
  */
 void toxav_callback_video_receive_frame(ToxAV *av, toxav_video_receive_frame_cb *callback, void *user_data);
 
+/** @} */
+
+/** @{
+ * @brief Call statistics
+ */
+
+/**
+ * A snapshot of the media statistics of a call.
+ *
+ * Obtain one with `toxav_call_get_stats`, or receive one in the `call_stats`
+ * callback. Counters are cumulative since the call started; times and rates
+ * describe the recent past.
+ */
+typedef struct Toxav_Call_Stats Toxav_Call_Stats;
+
+/**
+ * @brief Allocate a statistics snapshot to be filled by `toxav_call_get_stats`.
+ *
+ * @return NULL on memory allocation failure.
+ */
+Toxav_Call_Stats *toxav_call_stats_new(void);
+
+/**
+ * @brief Free a statistics snapshot allocated with `toxav_call_stats_new`.
+ */
+void toxav_call_stats_free(Toxav_Call_Stats *stats);
+
+/**
+ * @brief Get the current media statistics of a call.
+ *
+ * This only reads counters that the send and receive paths maintain anyway,
+ * so it is cheap enough to call once per second for every call.
+ *
+ * @param friend_number The friend number of the friend in the call.
+ * @param stats The snapshot to fill.
+ *
+ * @return true on success.
+ */
+bool toxav_call_get_stats(ToxAV *av, Tox_Friend_Number friend_number, Toxav_Call_Stats *stats,
+                          Toxav_Err_Call_Query *error);
+
+/**
+ * The function type for the call_stats callback.
+ *
+ * @param friend_number The friend number of the friend in the call.
+ * @param stats The current statistics of the call. Only valid during the
+ *   callback.
+ */
+typedef void toxav_call_stats_cb(ToxAV *av, Tox_Friend_Number friend_number, const Toxav_Call_Stats *stats,
+                                 void *user_data);
+
+/**
+ * Set the callback for the `call_stats` event. Pass NULL to unset.
+ *
+ * The callback is called from `toxav_iterate` (or `toxav_audio_iterate` /
+ * `toxav_video_iterate`) about once per second for every active call.
+ */
+void toxav_callback_call_stats(ToxAV *av, toxav_call_stats_cb *callback, void *user_data);
+
+/**
+ * @brief Smallest round trip time to the friend measured so far, in
+ *   milliseconds. 0 if the friend is not connected or no round trip was
+ *   measured yet.
+ */
+uint32_t toxav_call_stats_get_rtt(const Toxav_Call_Stats *stats);
+
+/**
+ * @brief Interarrival jitter of received audio frames in milliseconds, as
+ *   defined in RFC 3550.
+ */
+uint32_t toxav_call_stats_get_audio_jitter(const Toxav_Call_Stats *stats);
+
+/**
+ * @brief Interarrival jitter of received video frames in milliseconds.
+ */
+uint32_t toxav_call_stats_get_video_jitter(const Toxav_Call_Stats *stats);
+
+/**
+ * @brief Fraction of the received media data that was lost in the last
+ *   measurement cycle (about one second), between 0 and 1.
+ */
+float toxav_call_stats_get_receive_loss(const Toxav_Call_Stats *stats);
+
+/**
+ * @brief Fraction of the sent media data that the friend reported lost,
+ *   between 0 and 1.
+ */
+float toxav_call_stats_get_send_loss(const Toxav_Call_Stats *stats);
+
+/** @brief Number of audio packets received. */
+uint64_t toxav_call_stats_get_audio_packets_received(const Toxav_Call_Stats *stats);
+
+/** @brief Number of video packets received. */
+uint64_t toxav_call_stats_get_video_packets_received(const Toxav_Call_Stats *stats);
+
+/** @brief Number of audio frames decoded. */
+uint32_t toxav_call_stats_get_audio_frames_decoded(const Toxav_Call_Stats *stats);
+
+/**
+ * @brief Number of audio frames that were missing and replaced by packet loss
+ *   concealment.
+ */
+uint32_t toxav_call_stats_get_audio_frames_concealed(const Toxav_Call_Stats *stats);
+
+/** @brief Number of video frames decoded. */
+uint32_t toxav_call_stats_get_video_frames_decoded(const Toxav_Call_Stats *stats);
+
+/**
+ * @brief Number of received video frames that were dropped, because the
+ *   decoder fell behind or could not decode them.
+ */
+uint32_t toxav_call_stats_get_video_frames_dropped(const Toxav_Call_Stats *stats);
+
+/** @brief Average time to encode an audio frame, in microseconds. */
+uint32_t toxav_call_stats_get_audio_encode_time(const Toxav_Call_Stats *stats);
+
+/** @brief Average time to encode a video frame, in microseconds. */
+uint32_t toxav_call_stats_get_video_encode_time(const Toxav_Call_Stats *stats);
+
+/** @brief Average time to decode an audio frame, in microseconds. */
+uint32_t toxav_call_stats_get_audio_decode_time(const Toxav_Call_Stats *stats);
+
+/** @brief Average time to decode a video frame, in microseconds. */
+uint32_t toxav_call_stats_get_video_decode_time(const Toxav_Call_Stats *stats);
+
+/** @brief Number of audio packets waiting in the jitter buffer. */
+uint32_t toxav_call_stats_get_audio_jitter_buffer_depth(const Toxav_Call_Stats *stats);
+
+/** @brief Number of received video frames waiting to be decoded. */
+uint32_t toxav_call_stats_get_video_jitter_buffer_depth(const Toxav_Call_Stats *stats);
+
+/** @brief Audio bit rate sent during the last second, in bits per second. */
+uint32_t toxav_call_stats_get_audio_send_bit_rate(const Toxav_Call_Stats *stats);
+
+/**
+ * @brief Video bit rate sent during the last second, in bits per second,
+ *   including forward error correction.
+ */
+uint32_t toxav_call_stats_get_video_send_bit_rate(const Toxav_Call_Stats *stats);
+
 
 
 /***
@@ -847,6 +1022,31 @@ int32_t toxav_groupchat_disable_av(Tox *tox, Tox_Conference_Number conference_nu
 /** @brief Return whether A/V is enabled in the groupchat. */
 bool toxav_groupchat_av_enabled(Tox *tox, Tox_Conference_Number conference_number);
 
+/** @brief Deliver the audio of all peers as a single mixed stream.
+ *
+ * With mixing enabled, the audio callback is no longer called for each peer's
+ * packets. Instead, it is called with one 20 ms frame at 48 kHz at a time,
+ * containing the sum of the audio of all peers, and with `peer_number` set to
+ * `UINT32_MAX`. Frames are produced while peers are sending audio.
+ *
+ * @param channels Number of channels of the mixed stream (1 or 2), or 0 to
+ *   switch back to per-peer audio.
+ *
+ * @retval 0 on success.
+ * @retval -1 on failure.
+ */
+int32_t toxav_groupchat_set_audio_mixing(Tox *tox, Tox_Conference_Number conference_number, uint8_t channels);
+
+/** @brief Set the volume of a peer in the mixed audio stream.
+ *
+ * @param gain Between 0 (muted) and 4. 1 leaves the peer's audio unchanged.
+ *
+ * @retval 0 on success.
+ * @retval -1 on failure.
+ */
+int32_t toxav_groupchat_set_peer_gain(
+    Tox *tox, Tox_Conference_Number conference_number, Tox_Conference_Peer_Number peer_number, float gain);
+
 
 
 /** @} */
@@ -48,3 +48,24 @@ bool toxav_groupchat_av_enabled(Tox *_Nonnull tox, Tox_Conference_Number confere
 {
     return groupchat_av_enabled(tox->m->conferences_object, conference_number);
 }
+
+/** @brief Deliver the audio of all peers as a single mixed stream.
+ *
+ * @retval 0 on success.
+ * @retval -1 on failure.
+ */
+int32_t toxav_groupchat_set_audio_mixing(Tox *_Nonnull tox, Tox_Conference_Number conference_number, uint8_t channels)
+{
+    return groupchat_av_set_mixing(tox->m->conferences_object, conference_number, channels);
+}
+
+/** @brief Set the volume of a peer in the mixed audio stream.
+ *
+ * @retval 0 on success.
+ * @retval -1 on failure.
+ */
+int32_t toxav_groupchat_set_peer_gain(Tox *_Nonnull tox, Tox_Conference_Number conference_number,
+                                      Tox_Conference_Peer_Number peer_number, float gain)
+{
+    return groupchat_av_set_peer_gain(tox->m->conferences_object, conference_number, peer_number, gain);
+}
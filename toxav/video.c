@@ -48,8 +48,14 @@ struct VCSession {
     pthread_mutex_t *_Nonnull queue_mutex;
     const Logger *_Nonnull log;
     const Memory *_Nonnull mem;
+    const Mono_Time *_Nonnull mono_time;
 
     vpx_codec_iter_t iter;
+
+    /* statistics, see VCStats */
+    uint32_t frames_decoded;
+    uint32_t frames_dropped; /* guarded by queue_mutex */
+    uint32_t decode_time_us;
 };
 
 /**
@@ -305,6 +311,7 @@ VCSession *vc_new(const Memory *mem, const Logger *log, const Mono_Time *mono_ti
 
 #endif /* 0 */
 
+    vc->mono_time = mono_time;
     vc->linfts = current_time_monotonic(mono_time);
     vc->lcfd = 60;
     vc->vcb = cb;
@@ -390,14 +397,26 @@ void vc_iterate(VCSession *vc)
 
     LOGGER_DEBUG(vc->log, "vc_iterate: rb_read p->len=%u", full_data_len);
     LOGGER_DEBUG(vc->log, "vc_iterate: rb_read rb size=%d", (int)log_rb_size);
+    const uint64_t start_time = current_time_monotonic(vc->mono_time);
     const vpx_codec_err_t rc = vpx_codec_decode(vc->decoder, rtp_message_data(p), full_data_len, nullptr, 0);
     free(p);
 
     if (rc != VPX_CODEC_OK) {
         LOGGER_ERROR(vc->log, "Error decoding video: %d %s", (int)rc, vpx_codec_err_to_string(rc));
+        pthread_mutex_lock(vc->queue_mutex);
+        ++vc->frames_dropped;
+        pthread_mutex_unlock(vc->queue_mutex);
         return;
     }
 
+    ++vc->frames_decoded;
+
+    // Moving average over roughly the last 8 frames. The clock has millisecond
+    // resolution, but averaging makes up for that.
+    const uint64_t decode_time_ms = current_time_monotonic(vc->mono_time) - start_time;
+    vc->decode_time_us = vc->decode_time_us - vc->decode_time_us / 8
+                         + (uint32_t)min_u64(decode_time_ms * 1000 / 8, UINT32_MAX / 8);
+
     /* Play decoded images */
     vpx_codec_iter_t iter = nullptr;
 
@@ -451,7 +470,13 @@ int vc_queue_message(const Mono_Time *mono_time, void *cs, struct RTPMessage *ms
         LOGGER_DEBUG(vc->log, "rb_write msg->len=%d b0=%d b1=%d", (int)rtp_message_len(msg), (int)rtp_message_data(msg)[0], (int)rtp_message_data(msg)[1]);
     }
 
-    free(rb_write(vc->vbuf_raw, msg));
+    struct RTPMessage *const overwritten = (struct RTPMessage *)rb_write(vc->vbuf_raw, msg);
+
+    if (overwritten != nullptr) {
+        // The decoder is falling behind.
+        ++vc->frames_dropped;
+        free(overwritten);
+    }
 
     /* Calculate time it took for peer to send us this frame */
     const uint32_t t_lcfd = current_time_monotonic(mono_time) - vc->linfts;
@@ -609,6 +634,17 @@ uint32_t vc_get_lcfd(const VCSession *vc)
     return lcfd;
 }
 
+void vc_get_stats(VCSession *vc, VCStats *stats)
+{
+    stats->frames_decoded = vc->frames_decoded;
+    stats->decode_time_us = vc->decode_time_us;
+
+    pthread_mutex_lock(vc->queue_mutex);
+    stats->frames_dropped = vc->frames_dropped;
+    stats->queue_depth = rb_size(vc->vbuf_raw);
+    pthread_mutex_unlock(vc->queue_mutex);
+}
+
 pthread_mutex_t *vc_get_queue_mutex(VCSession *vc)
 {
     return vc->queue_mutex;
@@ -22,6 +22,20 @@ typedef void vc_video_receive_frame_cb(uint32_t friend_number, uint16_t width, u
 
 typedef struct VCSession VCSession;
 
+/**
+ * Decoder statistics of a video session.
+ */
+typedef struct VCStats {
+    /** Number of frames decoded successfully. */
+    uint32_t frames_decoded;
+    /** Number of frames dropped because the queue overflowed or decoding failed. */
+    uint32_t frames_dropped;
+    /** Moving average of the time it took to decode a frame, in microseconds. */
+    uint32_t decode_time_us;
+    /** Number of frames waiting to be decoded. */
+    uint32_t queue_depth;
+} VCStats;
+
 #define VC_EFLAG_NONE 0
 #define VC_EFLAG_FORCE_KF (1 << 0)
 
@@ -43,6 +57,14 @@ uint32_t vc_get_lcfd(const VCSession *_Nonnull vc);
 pthread_mutex_t *_Nonnull vc_get_queue_mutex(VCSession *_Nonnull vc);
 void vc_increment_frame_counter(VCSession *_Nonnull vc);
 
+/**
+ * @brief Get the decoder statistics.
+ *
+ * The decode counters are updated by @ref vc_iterate without extra locking, so
+ * this must not be called concurrently with it.
+ */
+void vc_get_stats(VCSession *_Nonnull vc, VCStats *_Nonnull stats);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
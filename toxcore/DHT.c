@@ -16,6 +16,7 @@
 #include "bin_pack.h"
 #include "ccompat.h"
 #include "crypto_core.h"
+#include "deadlines.h"
 #include "logger.h"
 #include "mem.h"
 #include "mono_time.h"
@@ -419,8 +420,8 @@ static bool bin_pack_node_handler(const void *_Nonnull arr, uint32_t index, cons
 
 int pack_nodes(const Logger *logger, uint8_t *data, uint16_t length, const Node_format *nodes, uint16_t number)
 {
-    const uint32_t size = bin_pack_obj_array_b_size(bin_pack_node_handler, nodes, number, logger);
-    if (!bin_pack_obj_array_b(bin_pack_node_handler, nodes, number, logger, data, length)) {
+    const uint32_t size = bin_pack_obj_array_b_written(bin_pack_node_handler, nodes, number, logger, data, length);
+    if (size == UINT32_MAX) {
         return -1;
     }
     return size;
@@ -2624,6 +2625,11 @@ void do_dht(DHT *dht)
     ping_iterate(dht->ping);
 }
 
+uint64_t dht_next_deadline(const DHT *dht)
+{
+    return deadline_from_seconds(dht->cur_time, 1);
+}
+
 void kill_dht(DHT *dht)
 {
     if (dht == nullptr) {
@@ -342,6 +342,14 @@ uint16_t closelist_nodes(const DHT *_Nonnull dht, Node_format *_Nonnull nodes, u
 /** Run this function at least a couple times per second (It's the main loop). */
 void do_dht(DHT *_Nonnull dht);
 
+/**
+ * @brief When `do_dht` next has work to do, in milliseconds on the
+ *   `mono_time_get_ms` clock.
+ *
+ * The DHT timers count in seconds and are all checked once per second.
+ */
+uint64_t dht_next_deadline(const DHT *_Nonnull dht);
+
 /*
  *  Use these two functions to bootstrap the client.
  */
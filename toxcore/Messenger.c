@@ -23,6 +23,7 @@
 #include "bin_unpack.h"
 #include "ccompat.h"
 #include "crypto_core.h"
+#include "deadlines.h"
 #include "forwarding.h"
 #include "friend_connection.h"
 #include "friend_requests.h"
@@ -30,6 +31,7 @@
 #include "group_chats.h"
 #include "group_common.h"
 #include "group_onion_announce.h"
+#include "iterate_profile.h"
 #include "logger.h"
 #include "mem.h"
 #include "mono_time.h"
@@ -103,6 +105,86 @@ static int realloc_friendlist(Messenger *_Nonnull m, uint32_t num)
     return 0;
 }
 
+/** @brief Grow a journal list so it can hold one more element.
+ *
+ * @retval false if there is no memory, in which case the journal can't record
+ *   the change and is marked incomplete.
+ */
+static bool journal_reserve(Messenger *_Nonnull m, void *_Nullable *_Nonnull list, uint32_t length, uint32_t *_Nonnull capacity,
+                            uint32_t size)
+{
+    if (length < *capacity) {
+        return true;
+    }
+
+    const uint32_t new_capacity = *capacity == 0 ? 16 : *capacity * 2;
+    void *new_list = mem_vrealloc(m->mem, *list, new_capacity, size);
+
+    if (new_list == nullptr) {
+        m->journal.incomplete = true;
+        return false;
+    }
+
+    *list = new_list;
+    *capacity = new_capacity;
+    return true;
+}
+
+/** @brief Record that the saved state of a friend changed. */
+static void journal_friend_changed(Messenger *_Nonnull m, int32_t friendnumber)
+{
+    Messenger_Journal *journal = &m->journal;
+    Friend *f = &m->friendlist[friendnumber];
+
+    if (!journal->started || f->journal_dirty) {
+        return;
+    }
+
+    void *list = journal->dirty_friends;
+
+    if (!journal_reserve(m, &list, journal->dirty_friends_length, &journal->dirty_friends_capacity, sizeof(uint32_t))) {
+        return;
+    }
+
+    journal->dirty_friends = (uint32_t *)list;
+    journal->dirty_friends[journal->dirty_friends_length] = (uint32_t)friendnumber;
+    ++journal->dirty_friends_length;
+    f->journal_dirty = true;
+}
+
+/** @brief Record that a friend is about to be deleted. */
+static void journal_friend_removed(Messenger *_Nonnull m, int32_t friendnumber)
+{
+    Messenger_Journal *journal = &m->journal;
+    const Friend *f = &m->friendlist[friendnumber];
+
+    if (!journal->started) {
+        return;
+    }
+
+    if (f->journal_dirty) {
+        // The friend number may be reused before the journal is written.
+        for (uint32_t i = 0; i < journal->dirty_friends_length; ++i) {
+            if (journal->dirty_friends[i] == (uint32_t)friendnumber) {
+                --journal->dirty_friends_length;
+                journal->dirty_friends[i] = journal->dirty_friends[journal->dirty_friends_length];
+                break;
+            }
+        }
+    }
+
+    void *list = journal->removed_friends;
+
+    if (!journal_reserve(m, &list, journal->removed_friends_length, &journal->removed_friends_capacity,
+                         CRYPTO_PUBLIC_KEY_SIZE)) {
+        return;
+    }
+
+    journal->removed_friends = (uint8_t *)list;
+    pk_copy(&journal->removed_friends[journal->removed_friends_length * CRYPTO_PUBLIC_KEY_SIZE], f->real_pk);
+    ++journal->removed_friends_length;
+}
+
 /** @return the friend number associated to that public key.
  * @retval -1 if no such friend.
  */
@@ -178,7 +260,67 @@ static int m_handle_status(void *_Nonnull object, int friendcon_id, bool status,
 static int m_handle_packet(void *_Nonnull object, int friendcon_id, const uint8_t *_Nonnull data, uint16_t length, void *_Nullable userdata);
 static int m_handle_lossy_packet(void *_Nonnull object, int friendcon_id, const uint8_t *_Nonnull data, uint16_t length,
                                  void *_Nullable userdata);
-static int32_t init_new_friend(Messenger *_Nonnull m, const uint8_t *_Nonnull real_pk, uint8_t status)
+/** @brief Create the friend connection of a friend whose connection was deferred. */
+static bool connect_friend(Messenger *_Nonnull m, int32_t friendnumber)
+{
+    Friend *const f = &m->friendlist[friendnumber];
+    const int friendcon_id = new_friend_connection(m->fr_c, f->real_pk);
+
+    if (friendcon_id == -1) {
+        return false;
+    }
+
+    f->friendcon_id = friendcon_id;
+    friend_connection_callbacks(m->fr_c, friendcon_id, MESSENGER_CALLBACK_INDEX, &m_handle_status, &m_handle_packet,
+                                &m_handle_lossy_packet, m, friendnumber);
+
+    if (friend_con_connected(m->fr_c, friendcon_id) == FRIENDCONN_STATUS_CONNECTED) {
+        send_online_packet(m, friendcon_id);
+    }
+
+    return true;
+}
+
+/** @brief Create the friend connections deferred while loading, a few per run.
+ *
+ * Each friend connection generates a key pair for the onion, so creating
+ * thousands of them at once would hold up `tox_new` or a single iteration.
+ */
+static void connect_unconnected_friends(Messenger *_Nonnull m)
+{
+    uint32_t budget = MAX_FRIEND_CONNECTS_PER_RUN;
+
+    if (mono_time_get_ms(m->mono_time) < m->unconnected_friends_retry_time) {
+        return;
+    }
+
+    while (m->num_unconnected_friends > 0 && budget > 0 && m->next_unconnected_friend < m->numfriends) {
+        const int32_t friendnumber = m->next_unconnected_friend;
+        const Friend *f = &m->friendlist[friendnumber];
+
+        if (f->status == NOFRIEND || f->friendcon_id != -1) {
+            ++m->next_unconnected_friend;
+            continue;
+        }
+
+        if (!connect_friend(m, friendnumber)) {
+            // Out of memory: back off rather than retrying every iteration.
+            m->unconnected_friends_retry_time = mono_time_get_ms(m->mono_time) + DEADLINE_POLL_INTERVAL;
+            return;
+        }
+
+        --m->num_unconnected_friends;
+        ++m->next_unconnected_friend;
+        --budget;
+    }
+}
+
+/** @brief Add a friend to the friend list.
+ *
+ * @param connect false to leave the friend without a friend connection until
+ *   `connect_unconnected_friends` gets to it. Only used while loading.
+ */
+static int32_t init_new_friend(Messenger *_Nonnull m, const uint8_t *_Nonnull real_pk, uint8_t status, bool connect)
 {
     if (m->numfriends == UINT32_MAX) {
         LOGGER_ERROR(m->log, "Friend list full: we have more than 4 billion friends");
@@ -193,9 +335,9 @@ static int32_t init_new_friend(Messenger *_Nonnull m, const uint8_t *_Nonnull re
 
     m->friendlist[m->numfriends] = empty_friend;
 
-    const int friendcon_id = new_friend_connection(m->fr_c, real_pk);
+    const int friendcon_id = connect ? new_friend_connection(m->fr_c, real_pk) : -1;
 
-    if (friendcon_id == -1) {
+    if (connect && friendcon_id == -1) {
         return FAERR_NOMEM;
     }
 
@@ -209,17 +351,25 @@ static int32_t init_new_friend(Messenger *_Nonnull m, const uint8_t *_Nonnull re
             m->friendlist[i].userstatus = USERSTATUS_NONE;
             m->friendlist[i].is_typing = false;
             m->friendlist[i].message_id = 0;
-            friend_connection_callbacks(m->fr_c, friendcon_id, MESSENGER_CALLBACK_INDEX, &m_handle_status, &m_handle_packet,
-                                        &m_handle_lossy_packet, m, i);
 
             if (m->numfriends == i) {
                 ++m->numfriends;
             }
 
-            if (friend_con_connected(m->fr_c, friendcon_id) == FRIENDCONN_STATUS_CONNECTED) {
-                send_online_packet(m, friendcon_id);
+            if (connect) {
+                friend_connection_callbacks(m->fr_c, friendcon_id, MESSENGER_CALLBACK_INDEX, &m_handle_status, &m_handle_packet,
+                                            &m_handle_lossy_packet, m, i);
+
+                if (friend_con_connected(m->fr_c, friendcon_id) == FRIENDCONN_STATUS_CONNECTED) {
+                    send_online_packet(m, friendcon_id);
+                }
+            } else {
+                ++m->num_unconnected_friends;
+                m->next_unconnected_friend = min_u32(m->next_unconnected_friend, i);
             }
 
+            journal_friend_changed(m, i);
+
             return i;
         }
     }
@@ -227,7 +377,7 @@ static int32_t init_new_friend(Messenger *_Nonnull m, const uint8_t *_Nonnull re
     return FAERR_NOMEM;
 }
 
-static int32_t m_add_friend_contact_norequest(Messenger *_Nonnull m, const uint8_t *_Nonnull real_pk)
+static int32_t m_add_friend_contact_norequest(Messenger *_Nonnull m, const uint8_t *_Nonnull real_pk, bool connect)
 {
     if (getfriend_id(m, real_pk) != -1) {
         return FAERR_ALREADYSENT;
@@ -237,7 +387,7 @@ static int32_t m_add_friend_contact_norequest(Messenger *_Nonnull m, const uint8
         return FAERR_OWNKEY;
     }
 
-    return init_new_friend(m, real_pk, FRIEND_CONFIRMED);
+    return init_new_friend(m, real_pk, FRIEND_CONFIRMED, connect);
 }
 
 /**
@@ -305,10 +455,11 @@ int32_t m_addfriend(Messenger *m, const uint8_t *address, const uint8_t *data, u
         }
 
         m->friendlist[friend_id].friendrequest_nospam = nospam;
+        journal_friend_changed(m, friend_id);
         return FAERR_SETNEWNOSPAM;
     }
 
-    const int32_t ret = init_new_friend(m, real_pk, FRIEND_ADDED);
+    const int32_t ret = init_new_friend(m, real_pk, FRIEND_ADDED, true);
 
     if (ret < 0) {
         return ret;
@@ -332,7 +483,7 @@ int32_t m_addfriend_norequest(Messenger *m, const uint8_t *real_pk)
         return FAERR_OWNKEY;
     }
 
-    return m_add_friend_contact_norequest(m, real_pk);
+    return m_add_friend_contact_norequest(m, real_pk, true);
 }
 
 static int clear_receipts(Messenger *_Nonnull m, int32_t friendnumber)
@@ -473,6 +624,8 @@ static int do_receipts(Messenger *_Nonnull m, int32_t friendnumber, void *_Nulla
     return 0;
 }
 
+static void break_files(const Messenger *_Nonnull m, int32_t friendnumber);
+
 /** @brief Remove a friend.
  *
  * @retval 0 if success.
@@ -485,15 +638,22 @@ int m_delfriend(Messenger *m, int32_t friendnumber)
     }
 
     clear_receipts(m, friendnumber);
+    break_files(m, friendnumber);
     remove_request_received(m->fr, m->friendlist[friendnumber].real_pk);
-    friend_connection_callbacks(m->fr_c, m->friendlist[friendnumber].friendcon_id, MESSENGER_CALLBACK_INDEX, nullptr,
-                                nullptr, nullptr, nullptr, 0);
 
-    if (friend_con_connected(m->fr_c, m->friendlist[friendnumber].friendcon_id) == FRIENDCONN_STATUS_CONNECTED) {
-        send_offline_packet(m, m->friendlist[friendnumber].friendcon_id);
-    }
+    if (m->friendlist[friendnumber].friendcon_id == -1) {
+        --m->num_unconnected_friends;
+    } else {
+        friend_connection_callbacks(m->fr_c, m->friendlist[friendnumber].friendcon_id, MESSENGER_CALLBACK_INDEX, nullptr,
+                                    nullptr, nullptr, nullptr, 0);
+
+        if (friend_con_connected(m->fr_c, m->friendlist[friendnumber].friendcon_id) == FRIENDCONN_STATUS_CONNECTED) {
+            send_offline_packet(m, m->friendlist[friendnumber].friendcon_id);
+        }
 
-    kill_friend_connection(m->fr_c, m->friendlist[friendnumber].friendcon_id);
+        kill_friend_connection(m->fr_c, m->friendlist[friendnumber].friendcon_id);
+    }
+    journal_friend_removed(m, friendnumber);
     m->friendlist[friendnumber] = empty_friend;
 
     uint32_t i;
@@ -546,6 +706,33 @@ int m_get_friend_connectionstatus(const Messenger *m, int32_t friendnumber)
     return m->friendlist[friendnumber].last_connection_udp_tcp;
 }
 
+uint32_t m_get_friend_rtt(const Messenger *m, int32_t friendnumber)
+{
+    if (!m_friend_exists(m, friendnumber) || m->friendlist[friendnumber].status != FRIEND_ONLINE) {
+        return 0;
+    }
+
+    const int crypt_conn_id = friend_connection_crypt_connection_id(m->fr_c, m->friendlist[friendnumber].friendcon_id);
+    return crypto_connection_rtt(m->net_crypto, crypt_conn_id);
+}
+
+bool m_get_friend_connection_stats(const Messenger *m, int32_t friendnumber, Crypto_Connection_Stats *stats)
+{
+    if (!m_friend_exists(m, friendnumber)) {
+        return false;
+    }
+
+    const int crypt_conn_id = friend_connection_crypt_connection_id(m->fr_c, m->friendlist[friendnumber].friendcon_id);
+
+    if (m->friendlist[friendnumber].status != FRIEND_ONLINE
+            || !crypto_connection_stats(m->net_crypto, crypt_conn_id, stats)) {
+        const Crypto_Connection_Stats empty_stats = {0};
+        *stats = empty_stats;
+    }
+
+    return true;
+}
+
 /**
  * Checks if there exists a friend with given friendnumber.
  *
@@ -668,8 +855,15 @@ int setfriendname(Messenger *m, int32_t friendnumber, const uint8_t *name, uint1
         return -1;
     }
 
-    m->friendlist[friendnumber].name_length = length;
-    memcpy(m->friendlist[friendnumber].name, name, length);
+    Friend *const f = &m->friendlist[friendnumber];
+
+    if (f->name_length == length && memcmp(f->name, name, length) == 0) {
+        return 0;
+    }
+
+    f->name_length = length;
+    memcpy(f->name, name, length);
+    journal_friend_changed(m, friendnumber);
     return 0;
 }
 
@@ -697,6 +891,7 @@ int setname(Messenger *m, const uint8_t *name, uint16_t length)
     }
 
     m->name_length = length;
+    m->journal.name_dirty = true;
 
     for (uint32_t i = 0; i < m->numfriends; ++i) {
         m->friendlist[i].name_sent = false;
@@ -771,6 +966,7 @@ int m_set_statusmessage(Messenger *m, const uint8_t *status, uint16_t length)
     }
 
     m->statusmessage_length = length;
+    m->journal.statusmessage_dirty = true;
 
     for (uint32_t i = 0; i < m->numfriends; ++i) {
         m->friendlist[i].statusmessage_sent = false;
@@ -820,6 +1016,7 @@ int m_set_userstatus(Messenger *m, uint8_t status)
     }
 
     userstatus_from_int(status, &m->userstatus);
+    m->journal.userstatus_dirty = true;
 
     for (uint32_t i = 0; i < m->numfriends; ++i) {
         m->friendlist[i].userstatus_sent = false;
@@ -950,7 +1147,7 @@ static bool send_user_istyping(const Messenger *_Nonnull m, int32_t friendnumber
     return write_cryptpacket_id(m, friendnumber, PACKET_ID_TYPING, &typing, sizeof(typing), false);
 }
 
-static int set_friend_statusmessage(const Messenger *_Nonnull m, int32_t friendnumber, const uint8_t *_Nonnull status, uint16_t length)
+static int set_friend_statusmessage(Messenger *_Nonnull m, int32_t friendnumber, const uint8_t *_Nonnull status, uint16_t length)
 {
     if (!m_friend_exists(m, friendnumber)) {
         return -1;
@@ -960,17 +1157,29 @@ static int set_friend_statusmessage(const Messenger *_Nonnull m, int32_t friendn
         return -1;
     }
 
+    Friend *const f = &m->friendlist[friendnumber];
+
+    if (f->statusmessage_length == length && (length == 0 || memcmp(f->statusmessage, status, length) == 0)) {
+        return 0;
+    }
+
     if (length > 0) {
-        memcpy(m->friendlist[friendnumber].statusmessage, status, length);
+        memcpy(f->statusmessage, status, length);
     }
 
-    m->friendlist[friendnumber].statusmessage_length = length;
+    f->statusmessage_length = length;
+    journal_friend_changed(m, friendnumber);
     return 0;
 }
 
-static void set_friend_userstatus(const Messenger *_Nonnull m, int32_t friendnumber, uint8_t status)
+static void set_friend_userstatus(Messenger *_Nonnull m, int32_t friendnumber, uint8_t status)
 {
+    const Userstatus old_status = m->friendlist[friendnumber].userstatus;
     userstatus_from_int(status, &m->friendlist[friendnumber].userstatus);
+
+    if (m->friendlist[friendnumber].userstatus != old_status) {
+        journal_friend_changed(m, friendnumber);
+    }
 }
 
 static void set_friend_typing(const Messenger *_Nonnull m, int32_t friendnumber, bool is_typing)
@@ -1043,8 +1252,6 @@ static void check_friend_tcp_udp(Messenger *_Nonnull m, int32_t friendnumber, vo
     m->friendlist[friendnumber].last_connection_udp_tcp = (Connection_Status)ret;
 }
 
-static void break_files(const Messenger *_Nonnull m, int32_t friendnumber);
-
 static void check_friend_connectionstatus(Messenger *_Nonnull m, int32_t friendnumber, uint8_t status, void *_Nullable userdata)
 {
     if (status == NOFRIEND) {
@@ -1073,8 +1280,15 @@ static void check_friend_connectionstatus(Messenger *_Nonnull m, int32_t friendn
 
 static void set_friend_status(Messenger *_Nonnull m, int32_t friendnumber, uint8_t status, void *_Nullable userdata)
 {
+    // Saved friends are either friend requests or confirmed friends.
+    const bool was_confirmed = m->friendlist[friendnumber].status >= FRIEND_CONFIRMED;
+
     check_friend_connectionstatus(m, friendnumber, status, userdata);
     m->friendlist[friendnumber].status = status;
+
+    if (was_confirmed != (status >= FRIEND_CONFIRMED)) {
+        journal_friend_changed(m, friendnumber);
+    }
 }
 
 /*** CONFERENCES */
@@ -1207,6 +1421,252 @@ int32_t file_by_id(const Messenger *m, uint32_t friendnumber, const uint8_t *fil
     return -2;
 }
 
+#define MAX_FILE_DATA_SIZE (MAX_CRYPTO_DATA_SIZE - 2)
+
+/** Read-ahead and write-behind buffer size used when the client passes 0. */
+#define FILE_STREAM_DEFAULT_BUFFER_SIZE (MAX_FILE_DATA_SIZE * 64)
+
+typedef enum File_Stream_Kind {
+    FILE_STREAM_SOURCE_REGION,
+    FILE_STREAM_SOURCE_CALLBACK,
+    FILE_STREAM_SINK_REGION,
+    FILE_STREAM_SINK_CALLBACK,
+} File_Stream_Kind;
+
+struct File_Stream {
+    File_Stream_Kind kind;
+
+    const uint8_t *_Nullable source;
+    uint8_t *_Nullable sink;
+    uint64_t region_size;
+
+    m_file_read_cb *_Nullable read;
+    m_file_write_cb *_Nullable write;
+    void *_Nullable object;
+
+    /** Read-ahead data of a source or unwritten data of a sink. */
+    uint8_t *_Nullable buffer;
+    uint32_t buffer_size;
+    /** File position of `buffer[0]`. */
+    uint64_t buffer_position;
+    uint32_t buffer_length;
+};
+
+static void file_stream_free(const Memory *_Nonnull mem, File_Stream *_Nullable stream)
+{
+    if (stream == nullptr) {
+        return;
+    }
+
+    mem_delete(mem, stream->buffer);
+    mem_delete(mem, stream);
+}
+
+/** @brief Mark a file transfer slot unused and free its stream. */
+static void file_transfer_clear(const Memory *_Nonnull mem, struct File_Transfers *_Nonnull ft)
+{
+    file_stream_free(mem, ft->stream);
+    ft->stream = nullptr;
+    ft->status = FILESTATUS_NONE;
+}
+
+/** @brief Point `data` at up to `length` bytes of a source at `position`.
+ *
+ * @return the number of bytes available, less than `length` at the end of the source.
+ */
+static uint16_t file_stream_read(File_Stream *_Nonnull stream, uint64_t position, uint16_t length,
+                                 const uint8_t *_Nullable *_Nonnull data)
+{
+    if (stream->kind == FILE_STREAM_SOURCE_REGION) {
+        assert(stream->source != nullptr);
+
+        if (position >= stream->region_size) {
+            *data = nullptr;
+            return 0;
+        }
+
+        *data = stream->source + position;
+        return min_u64(stream->region_size - position, length);
+    }
+
+    assert(stream->kind == FILE_STREAM_SOURCE_CALLBACK);
+    assert(stream->read != nullptr && stream->buffer != nullptr);
+
+    if (position < stream->buffer_position
+            || position - stream->buffer_position + length > stream->buffer_length) {
+        const size_t read = stream->read(stream->object, position, stream->buffer, stream->buffer_size);
+        stream->buffer_position = position;
+        stream->buffer_length = min_u64(read, stream->buffer_size);
+    }
+
+    const uint32_t offset = (uint32_t)(position - stream->buffer_position);
+
+    if (offset >= stream->buffer_length) {
+        *data = nullptr;
+        return 0;
+    }
+
+    *data = stream->buffer + offset;
+    return min_u32(stream->buffer_length - offset, length);
+}
+
+/** @brief Write the buffered data of a sink. */
+static bool file_stream_flush(File_Stream *_Nonnull stream)
+{
+    if (stream->kind != FILE_STREAM_SINK_CALLBACK || stream->buffer_length == 0) {
+        return true;
+    }
+
+    assert(stream->write != nullptr && stream->buffer != nullptr);
+    const bool ok = stream->write(stream->object, stream->buffer_position, stream->buffer, stream->buffer_length);
+    stream->buffer_position += stream->buffer_length;
+    stream->buffer_length = 0;
+    return ok;
+}
+
+/** @brief Store `length` bytes received at `position` in a sink. */
+static bool file_stream_write(File_Stream *_Nonnull stream, uint64_t position, const uint8_t *_Nullable data, uint16_t length)
+{
+    if (length == 0) {
+        return true;
+    }
+
+    assert(data != nullptr);
+
+    if (stream->kind == FILE_STREAM_SINK_REGION) {
+        assert(stream->sink != nullptr);
+
+        if (length > stream->region_size || position > stream->region_size - length) {
+            return false;
+        }
+
+        memcpy(stream->sink + position, data, length);
+        return true;
+    }
+
+    assert(stream->kind == FILE_STREAM_SINK_CALLBACK);
+    assert(stream->buffer != nullptr);
+
+    if (stream->buffer_length > 0
+            && (stream->buffer_length + length > stream->buffer_size
+                || stream->buffer_position + stream->buffer_length != position)) {
+        if (!file_stream_flush(stream)) {
+            return false;
+        }
+    }
+
+    if (stream->buffer_length == 0) {
+        stream->buffer_position = position;
+    }
+
+    memcpy(stream->buffer + stream->buffer_length, data, length);
+    stream->buffer_length += length;
+    return true;
+}
+
+/** @brief Give the transfer `filenumber` of a friend a copy of `init` as its stream.
+ *
+ * @return the values documented at file_set_source_region.
+ */
+static int file_stream_attach(const Messenger *_Nonnull m, int32_t friendnumber, uint32_t filenumber,
+                              const File_Stream *_Nonnull init, uint32_t buffer_size)
+{
+    if (!m_friend_exists(m, friendnumber)) {
+        return -1;
+    }
+
+    const bool inbound = filenumber >= (1 << 16);
+    const uint32_t temp_filenum = inbound ? (filenumber >> 16) - 1 : filenumber;
+
+    if (temp_filenum >= MAX_CONCURRENT_FILE_PIPES) {
+        return -2;
+    }
+
+    Friend *const f = &m->friendlist[friendnumber];
+    struct File_Transfers *ft = inbound ? &f->file_receiving[temp_filenum] : &f->file_sending[temp_filenum];
+
+    if (ft->status == FILESTATUS_NONE) {
+        return -2;
+    }
+
+    const bool is_sink = init->kind == FILE_STREAM_SINK_REGION || init->kind == FILE_STREAM_SINK_CALLBACK;
+
+    if (inbound != is_sink) {
+        return -3;
+    }
+
+    if (ft->stream != nullptr || (!inbound && ft->requested != ft->transferred)) {
+        return -4;
+    }
+
+    const bool is_region = init->kind == FILE_STREAM_SOURCE_REGION || init->kind == FILE_STREAM_SINK_REGION;
+
+    if (is_region && ft->size != UINT64_MAX && init->region_size < ft->size) {
+        return -5;
+    }
+
+    File_Stream *stream = (File_Stream *)mem_alloc(m->mem, sizeof(File_Stream));
+
+    if (stream == nullptr) {
+        return -6;
+    }
+
+    *stream = *init;
+    stream->buffer = nullptr;
+    stream->buffer_size = 0;
+    stream->buffer_position = ft->transferred;
+    stream->buffer_length = 0;
+
+    if (!is_region) {
+        stream->buffer_size = max_u32(buffer_size == 0 ? FILE_STREAM_DEFAULT_BUFFER_SIZE : buffer_size, MAX_FILE_DATA_SIZE);
+        stream->buffer = (uint8_t *)mem_balloc(m->mem, stream->buffer_size);
+
+        if (stream->buffer == nullptr) {
+            mem_delete(m->mem, stream);
+            return -6;
+        }
+    }
+
+    ft->stream = stream;
+    return 0;
+}
+
+int file_set_source_region(const Messenger *m, int32_t friendnumber, uint32_t filenumber,
+                           const uint8_t *data, uint64_t length)
+{
+    File_Stream init = {FILE_STREAM_SOURCE_REGION};
+    init.source = data;
+    init.region_size = length;
+    return file_stream_attach(m, friendnumber, filenumber, &init, 0);
+}
+
+int file_set_source_callback(const Messenger *m, int32_t friendnumber, uint32_t filenumber,
+                             m_file_read_cb *read, void *object, uint32_t buffer_size)
+{
+    File_Stream init = {FILE_STREAM_SOURCE_CALLBACK};
+    init.read = read;
+    init.object = object;
+    return file_stream_attach(m, friendnumber, filenumber, &init, buffer_size);
+}
+
+int file_set_sink_region(const Messenger *m, int32_t friendnumber, uint32_t filenumber,
+                         uint8_t *data, uint64_t length)
+{
+    File_Stream init = {FILE_STREAM_SINK_REGION};
+    init.sink = data;
+    init.region_size = length;
+    return file_stream_attach(m, friendnumber, filenumber, &init, 0);
+}
+
+int file_set_sink_callback(const Messenger *m, int32_t friendnumber, uint32_t filenumber,
+                           m_file_write_cb *write, void *object, uint32_t buffer_size)
+{
+    File_Stream init = {FILE_STREAM_SINK_CALLBACK};
+    init.write = write;
+    init.object = object;
+    return file_stream_attach(m, friendnumber, filenumber, &init, buffer_size);
+}
+
 /** @brief Send a file send request.
  * Maximum filename length is 255 bytes.
  * @retval 1 on success
@@ -1402,7 +1862,7 @@ int file_control(const Messenger *m, int32_t friendnumber, uint32_t filenumber,
                     --m->friendlist[friendnumber].num_sending_files;
                 }
 
-                ft->status = FILESTATUS_NONE;
+                file_transfer_clear(m->mem, ft);
                 break;
             }
             case FILECONTROL_PAUSE: {
@@ -1499,38 +1959,65 @@ static int64_t send_file_data_packet(const Messenger *_Nonnull m, int32_t friend
         return -1;
     }
 
-    const uint16_t packet_size = 2 + length;
-    VLA(uint8_t, packet, packet_size);
-    packet[0] = PACKET_ID_FILE_DATA;
-    packet[1] = filenumber;
-
-    if (length > 0) {
-        memcpy(packet + 2, data, length);
-    }
+    const uint8_t header[2] = {PACKET_ID_FILE_DATA, filenumber};
 
-    return write_cryptpacket(m->net_crypto, friend_connection_crypt_connection_id(m->fr_c,
-                             m->friendlist[friendnumber].friendcon_id), packet, packet_size, true);
+    return write_cryptpacket_parts(m->net_crypto, friend_connection_crypt_connection_id(m->fr_c,
+                                   m->friendlist[friendnumber].friendcon_id), header, sizeof(header), data, length, true);
 }
 
-#define MAX_FILE_DATA_SIZE (MAX_CRYPTO_DATA_SIZE - 2)
 #define MIN_SLOTS_FREE (CRYPTO_MIN_QUEUE_LENGTH / 4)
-/** @brief Send file data.
+
+/** @brief Send the next chunk of an outgoing file whose size and position were checked.
  *
  * @retval 0 on success
- * @retval -1 if friend not valid.
- * @retval -2 if friend not online.
- * @retval -3 if filenumber invalid.
- * @retval -4 if file transfer not transferring.
- * @retval -5 if bad data size.
  * @retval -6 if packet queue full.
- * @retval -7 if wrong position.
  */
-int send_file_data(const Messenger *m, int32_t friendnumber, uint32_t filenumber, uint64_t position,
-                   const uint8_t *data, uint16_t length)
+static int send_file_chunk(const Messenger *_Nonnull m, int32_t friendnumber, uint8_t filenumber,
+                           const uint8_t *_Nullable data, uint16_t length)
 {
-    assert(length == 0 || data != nullptr);
+    struct File_Transfers *ft = &m->friendlist[friendnumber].file_sending[filenumber];
 
-    if (!m_friend_exists(m, friendnumber)) {
+    /* Prevent file sending from filling up the entire buffer preventing messages from being sent.
+     * TODO(irungentoo): remove */
+    if (crypto_num_free_sendqueue_slots(m->net_crypto, friend_connection_crypt_connection_id(m->fr_c,
+                                        m->friendlist[friendnumber].friendcon_id)) < MIN_SLOTS_FREE) {
+        return -6;
+    }
+
+    const int64_t ret = send_file_data_packet(m, friendnumber, filenumber, data, length);
+
+    if (ret != -1) {
+        // TODO(irungentoo): record packet ids to check if other received complete file.
+        ft->transferred += length;
+
+        if (length != MAX_FILE_DATA_SIZE || ft->size == ft->transferred) {
+            ft->status = FILESTATUS_FINISHED;
+            ft->last_packet_number = ret;
+        }
+
+        return 0;
+    }
+
+    return -6;
+}
+
+/** @brief Send file data.
+ *
+ * @retval 0 on success
+ * @retval -1 if friend not valid.
+ * @retval -2 if friend not online.
+ * @retval -3 if filenumber invalid.
+ * @retval -4 if file transfer not transferring.
+ * @retval -5 if bad data size.
+ * @retval -6 if packet queue full.
+ * @retval -7 if wrong position.
+ */
+int send_file_data(const Messenger *m, int32_t friendnumber, uint32_t filenumber, uint64_t position,
+                   const uint8_t *data, uint16_t length)
+{
+    assert(length == 0 || data != nullptr);
+
+    if (!m_friend_exists(m, friendnumber)) {
         return -1;
     }
 
@@ -1564,28 +2051,70 @@ int send_file_data(const Messenger *m, int32_t friendnumber, uint32_t filenumber
         return -7;
     }
 
-    /* Prevent file sending from filling up the entire buffer preventing messages from being sent.
-     * TODO(irungentoo): remove */
-    if (crypto_num_free_sendqueue_slots(m->net_crypto, friend_connection_crypt_connection_id(m->fr_c,
-                                        m->friendlist[friendnumber].friendcon_id)) < MIN_SLOTS_FREE) {
-        return -6;
+    return send_file_chunk(m, friendnumber, (uint8_t)filenumber, data, length);
+}
+
+/** @brief Kill a transfer whose source or sink failed and tell the client as if the friend had killed it. */
+static void file_stream_failed(Messenger *_Nonnull m, int32_t friendnumber, bool inbound, uint8_t filenumber,
+                               void *_Nullable userdata)
+{
+    Friend *const f = &m->friendlist[friendnumber];
+    struct File_Transfers *ft = inbound ? &f->file_receiving[filenumber] : &f->file_sending[filenumber];
+    const uint32_t real_filenumber = inbound ? ((uint32_t)filenumber + 1) << 16 : filenumber;
+
+    LOGGER_DEBUG(m->log, "file %s (friend %d, file %d) failed; killing the transfer",
+                 inbound ? "sink" : "source", friendnumber, filenumber);
+
+    send_file_control_packet(m, friendnumber, inbound, filenumber, FILECONTROL_KILL, nullptr, 0);
+
+    if (!inbound && (ft->status == FILESTATUS_TRANSFERRING || ft->status == FILESTATUS_FINISHED)) {
+        --f->num_sending_files;
     }
 
-    const int64_t ret = send_file_data_packet(m, friendnumber, filenumber, data, length);
+    file_transfer_clear(m->mem, ft);
 
-    if (ret != -1) {
-        // TODO(irungentoo): record packet ids to check if other received complete file.
-        ft->transferred += length;
+    if (m->file_filecontrol != nullptr) {
+        m->file_filecontrol(m, friendnumber, real_filenumber, FILECONTROL_KILL, userdata);
+    }
+}
 
-        if (length != MAX_FILE_DATA_SIZE || ft->size == ft->transferred) {
-            ft->status = FILESTATUS_FINISHED;
-            ft->last_packet_number = ret;
+/**
+ * Send chunks of a file that has a source straight from the source into the
+ * send queue, until the queue is full or the whole file is queued.
+ *
+ * @return false if no more packets can be sent to this friend for now.
+ */
+static bool send_file_source_chunks(Messenger *_Nonnull m, int32_t friendnumber, uint8_t filenumber,
+                                    uint32_t *_Nonnull free_slots, void *_Nullable userdata)
+{
+    struct File_Transfers *const ft = &m->friendlist[friendnumber].file_sending[filenumber];
+    const int crypt_connection_id = friend_connection_crypt_connection_id(
+                                        m->fr_c, m->friendlist[friendnumber].friendcon_id);
+
+    while (ft->status == FILESTATUS_TRANSFERRING && ft->requested < ft->size) {
+        if (*free_slots == 0 || max_speed_reached(m->net_crypto, crypt_connection_id)) {
+            return false;
         }
 
-        return 0;
+        assert(ft->stream != nullptr);
+        const uint16_t length = min_u64(ft->size - ft->requested, MAX_FILE_DATA_SIZE);
+        const uint8_t *data = nullptr;
+        const uint16_t available = file_stream_read(ft->stream, ft->requested, length, &data);
+
+        if (available < length && ft->size != UINT64_MAX) {
+            file_stream_failed(m, friendnumber, false, filenumber, userdata);
+            return true;
+        }
+
+        if (send_file_chunk(m, friendnumber, filenumber, data, available) != 0) {
+            return false;
+        }
+
+        ft->requested = ft->transferred;
+        --*free_slots;
     }
 
-    return -6;
+    return true;
 }
 
 /**
@@ -1639,7 +2168,7 @@ static bool do_all_filetransfers(Messenger *_Nonnull m, int32_t friendnumber, vo
             }
 
             // Now it's inactive, we're no longer sending this.
-            ft->status = FILESTATUS_NONE;
+            file_transfer_clear(m->mem, ft);
             --friendcon->num_sending_files;
         } else if (ft->status == FILESTATUS_TRANSFERRING && ft->paused == FILE_PAUSE_NOT) {
             if (ft->size == 0) {
@@ -1648,6 +2177,14 @@ static bool do_all_filetransfers(Messenger *_Nonnull m, int32_t friendnumber, vo
                 continue;
             }
 
+            if (ft->stream != nullptr) {
+                if (!send_file_source_chunks(m, friendnumber, i, free_slots, userdata)) {
+                    return false;
+                }
+
+                continue;
+            }
+
             if (ft->size == ft->requested) {
                 // This file transfer is done.
                 continue;
@@ -1718,8 +2255,13 @@ static void break_files(const Messenger *m, int32_t friendnumber)
 
     // TODO(irungentoo): Inform the client which file transfers get killed with a callback?
     for (uint32_t i = 0; i < MAX_CONCURRENT_FILE_PIPES; ++i) {
-        f->file_sending[i].status = FILESTATUS_NONE;
-        f->file_receiving[i].status = FILESTATUS_NONE;
+        // Write out what was received so the client can resume from there.
+        if (f->file_receiving[i].stream != nullptr) {
+            file_stream_flush(f->file_receiving[i].stream);
+        }
+
+        file_transfer_clear(m->mem, &f->file_sending[i]);
+        file_transfer_clear(m->mem, &f->file_receiving[i]);
     }
 }
 
@@ -1805,7 +2347,7 @@ static int handle_filecontrol(Messenger *_Nonnull m, int32_t friendnumber, bool
                 --m->friendlist[friendnumber].num_sending_files;
             }
 
-            ft->status = FILESTATUS_NONE;
+            file_transfer_clear(m->mem, ft);
 
             return 0;
         }
@@ -2019,8 +2561,13 @@ static int m_handle_packet_nickname(Messenger *_Nonnull m, const int friendcon_i
         m->friend_namechange(m, friendcon_id, data_terminated, data_length, userdata);
     }
 
-    memcpy(m->friendlist[friendcon_id].name, data_terminated, data_length);
-    m->friendlist[friendcon_id].name_length = data_length;
+    Friend *const f = &m->friendlist[friendcon_id];
+
+    if (f->name_length != data_length || memcmp(f->name, data_terminated, data_length) != 0) {
+        memcpy(f->name, data_terminated, data_length);
+        f->name_length = data_length;
+        journal_friend_changed(m, friendcon_id);
+    }
 
     return 0;
 }
@@ -2250,6 +2797,29 @@ static int m_handle_packet_file_data(Messenger *_Nonnull m, const int friendcon_
         file_data_length = ft->size - ft->transferred;
     }
 
+    if (ft->stream != nullptr) {
+        const bool complete = file_data_length != MAX_FILE_DATA_SIZE || ft->transferred + file_data_length >= ft->size;
+
+        if (!file_stream_write(ft->stream, position, file_data, file_data_length)
+                || (complete && !file_stream_flush(ft->stream))) {
+            file_stream_failed(m, friendcon_id, true, filenumber, userdata);
+            return 0;
+        }
+
+        ft->transferred += file_data_length;
+
+        if (complete) {
+            /* Full file received: the client only hears about the end. */
+            if (m->file_filedata != nullptr) {
+                m->file_filedata(m, friendcon_id, real_filenumber, ft->transferred, nullptr, 0, userdata);
+            }
+
+            file_transfer_clear(m->mem, ft);
+        }
+
+        return 0;
+    }
+
     if (m->file_filedata != nullptr) {
         m->file_filedata(m, friendcon_id, real_filenumber, position, file_data, file_data_length, userdata);
     }
@@ -2269,7 +2839,7 @@ static int m_handle_packet_file_data(Messenger *_Nonnull m, const int friendcon_
 
     /* Data is zero, filetransfer is over. */
     if (file_data_length == 0) {
-        ft->status = FILESTATUS_NONE;
+        file_transfer_clear(m->mem, ft);
     }
 
     return 0;
@@ -2424,26 +2994,73 @@ static void m_connection_status_callback(Messenger *_Nonnull m, void *_Nullable
 
 #define DUMPING_CLIENTS_FRIENDS_EVERY_N_SECONDS 60UL
 
-/** @brief Minimum messenger run interval in ms
- * TODO(mannol): A/V
- */
-#define MIN_RUN_INTERVAL 50
+/** @brief When `do_friends` next has work to do. */
+static uint64_t friends_next_deadline(const Messenger *_Nonnull m)
+{
+    const uint64_t poll = mono_time_get_ms(m->mono_time) + DEADLINE_POLL_INTERVAL;
+    uint64_t due = DEADLINE_NEVER;
 
-/**
- * @brief Return the time in milliseconds before `do_messenger()` should be called again
- *   for optimal performance.
- *
- * @return time (in ms) before the next `do_messenger()` needs to be run on success.
- */
-uint32_t messenger_run_interval(const Messenger *m)
+    for (uint32_t i = 0; i < m->numfriends; ++i) {
+        const Friend *f = &m->friendlist[i];
+
+        if (f->status == FRIEND_ADDED) {
+            return poll;
+        }
+
+        if (f->status == FRIEND_REQUESTED) {
+            due = deadline_min(due, deadline_from_seconds(f->friendrequest_lastsent, (uint64_t)f->friendrequest_timeout + 1));
+        }
+
+        if (f->status == FRIEND_ONLINE) {
+            // Unsent updates are retried and file chunks are requested as
+            // the send queue drains.
+            if (!f->name_sent || !f->statusmessage_sent || !f->userstatus_sent || !f->user_istyping_sent
+                    || f->num_sending_files != 0) {
+                return poll;
+            }
+        }
+    }
+
+    return due;
+}
+
+void messenger_deadlines(const Messenger *m, Deadlines *deadlines)
 {
-    const uint32_t crypto_interval = crypto_run_interval(m->net_crypto);
+    const uint64_t now = mono_time_get_ms(m->mono_time);
 
-    if (crypto_interval > MIN_RUN_INTERVAL) {
-        return MIN_RUN_INTERVAL;
+    deadlines_init(deadlines);
+
+    if (!m->has_added_relays) {
+        deadlines_set(deadlines, DEADLINE_SOURCE_MESSENGER, now);
+        return;
     }
 
-    return crypto_interval;
+    deadlines_set(deadlines, DEADLINE_SOURCE_NET_CRYPTO, now + crypto_run_interval(m->net_crypto));
+    deadlines_set(deadlines, DEADLINE_SOURCE_TCP_CONNECTIONS, tcp_connections_next_deadline(nc_get_tcp_c(m->net_crypto)));
+
+    if (m->tcp_server != nullptr) {
+        // Accepting and serving clients waits for sockets.
+        deadlines_set(deadlines, DEADLINE_SOURCE_TCP_SERVER, now + DEADLINE_POLL_INTERVAL);
+    }
+
+    if (!m->options.udp_disabled) {
+        deadlines_set(deadlines, DEADLINE_SOURCE_DHT, dht_next_deadline(m->dht));
+    }
+
+    deadlines_set(deadlines, DEADLINE_SOURCE_ONION_CLIENT, onion_client_next_deadline(m->onion_c));
+    deadlines_set(deadlines, DEADLINE_SOURCE_FRIEND_CONNECTIONS, friend_connections_next_deadline(m->fr_c));
+    deadlines_set(deadlines, DEADLINE_SOURCE_MESSENGER,
+                  m->num_unconnected_friends > 0 ? max_u64(now, m->unconnected_friends_retry_time) : friends_next_deadline(m));
+    deadlines_set(deadlines, DEADLINE_SOURCE_GROUP_CHATS, gc_next_deadline(m->group_handler));
+}
+
+uint32_t messenger_max_run_interval(const Messenger *m)
+{
+    if (!m->options.udp_disabled || tcp_connected_relays_count(nc_get_tcp_c(m->net_crypto)) > 0) {
+        return DEADLINE_POLL_INTERVAL;
+    }
+
+    return MESSENGER_MAX_RUN_INTERVAL;
 }
 
 /** @brief Attempts to create a DHT announcement for a group chat with our connection info. An
@@ -2525,7 +3142,31 @@ static void do_gc_onion_friends(const Messenger *_Nonnull m)
     }
 }
 
-/** @brief The main loop that needs to be run at least 20 times per second. */
+bool m_set_iterate_profiling(Messenger *m, bool enabled)
+{
+    if (enabled == (m->iter_profile != nullptr)) {
+        return true;
+    }
+
+    if (!enabled) {
+        networking_set_iterate_profile(m->net, nullptr);
+        iterprof_kill(m->mem, m->iter_profile);
+        m->iter_profile = nullptr;
+        return true;
+    }
+
+    Iterate_Profile *profile = iterprof_new(m->mem, nullptr, nullptr);
+
+    if (profile == nullptr) {
+        return false;
+    }
+
+    m->iter_profile = profile;
+    networking_set_iterate_profile(m->net, profile);
+    return true;
+}
+
+/** @brief The main loop. Run it again when `messenger_deadlines()` says so. */
 void do_messenger(Messenger *m, void *userdata)
 {
     // Add the TCP relays, but only if this is the first time calling do_messenger
@@ -2548,22 +3189,41 @@ void do_messenger(Messenger *m, void *userdata)
         }
     }
 
+    Iterate_Profile *prof = m->iter_profile;
+    uint64_t t = iterprof_now(prof);
+
     if (!m->options.udp_disabled) {
         networking_poll(m->net, userdata);
+        t = iterprof_record_phase(prof, ITERATE_PHASE_NETWORKING_POLL, t);
         do_dht(m->dht);
+        t = iterprof_record_phase(prof, ITERATE_PHASE_DHT, t);
     }
 
     if (m->tcp_server != nullptr) {
         do_tcp_server(m->tcp_server, m->mono_time);
+        t = iterprof_record_phase(prof, ITERATE_PHASE_TCP_SERVER, t);
     }
 
+    connect_unconnected_friends(m);
+    // Creating friend connections is counted as part of their phase below.
+    const uint64_t connect_start = t;
+    t = iterprof_now(prof);
+    const uint64_t connect_ns = t - connect_start;
+
     do_net_crypto(m->net_crypto, userdata);
+    t = iterprof_record_phase(prof, ITERATE_PHASE_NET_CRYPTO, t);
     do_onion_client(m->onion_c);
+    t = iterprof_record_phase(prof, ITERATE_PHASE_ONION_CLIENT, t);
     do_friend_connections(m->fr_c, userdata);
+    t = iterprof_record_phase(prof, ITERATE_PHASE_FRIEND_CONNECTIONS, t - connect_ns);
     do_friends(m, userdata);
+    t = iterprof_record_phase(prof, ITERATE_PHASE_FRIENDS, t);
     do_gc(m->group_handler, userdata);
+    t = iterprof_record_phase(prof, ITERATE_PHASE_GROUP_CHATS, t);
     do_gca(m->mono_time, m->group_announce);
+    t = iterprof_record_phase(prof, ITERATE_PHASE_GROUP_ANNOUNCES, t);
     do_gc_onion_friends(m);
+    iterprof_record_phase(prof, ITERATE_PHASE_GROUP_ONION_FRIENDS, t);
     m_connection_status_callback(m, userdata);
 
     if (mono_time_get(m->mono_time) > m->lastdump + DUMPING_CLIENTS_FRIENDS_EVERY_N_SECONDS) {
@@ -2860,6 +3520,21 @@ static uint32_t m_plugin_size(const Messenger *_Nonnull m, State_Type type)
     return UINT32_MAX;
 }
 
+static uint8_t *_Nonnull m_plugin_save(const Messenger *_Nonnull m, State_Type type, uint8_t *_Nonnull data)
+{
+    for (uint8_t i = 0; i < m->options.state_plugins_length; ++i) {
+        const Messenger_State_Plugin plugin = m->options.state_plugins[i];
+
+        if (plugin.type == type) {
+            return plugin.save(m, data);
+        }
+    }
+
+    LOGGER_ERROR(m->log, "Unknown type encountered: %u", type);
+
+    return data;
+}
+
 /** return size of the messenger data (for saving). */
 uint32_t messenger_size(const Messenger *m)
 {
@@ -2941,6 +3616,32 @@ static uint32_t saved_friendslist_size(const Messenger *_Nonnull m)
     return count_friendlist(m) * friend_size();
 }
 
+static void saved_friend_from(const Friend *_Nonnull f, struct Saved_Friend *_Nonnull temp)
+{
+    temp->status = f->status;
+    memcpy(temp->real_pk, f->real_pk, CRYPTO_PUBLIC_KEY_SIZE);
+
+    if (temp->status < 3) {
+        // TODO(iphydf): Use uint16_t and min_u16 here.
+        const size_t friendrequest_length =
+            min_u32(f->info_size,
+                    min_u32(SAVED_FRIEND_REQUEST_SIZE, MAX_FRIEND_REQUEST_DATA_SIZE));
+        memcpy(temp->info, f->info, friendrequest_length);
+
+        temp->info_size = net_htons(f->info_size);
+        temp->friendrequest_nospam = f->friendrequest_nospam;
+    } else {
+        temp->status = 3;
+        memcpy(temp->name, f->name, f->name_length);
+        temp->name_length = net_htons(f->name_length);
+        memcpy(temp->statusmessage, f->statusmessage, f->statusmessage_length);
+        temp->statusmessage_length = net_htons(f->statusmessage_length);
+        temp->userstatus = f->userstatus;
+
+        net_pack_u64(temp->last_seen_time, f->last_seen_time);
+    }
+}
+
 static uint8_t *_Nonnull friends_list_save(const Messenger *_Nonnull m, uint8_t *_Nonnull data)
 {
     const uint32_t len = m_plugin_size(m, STATE_TYPE_FRIENDS);
@@ -2952,28 +3653,7 @@ static uint8_t *_Nonnull friends_list_save(const Messenger *_Nonnull m, uint8_t
     for (uint32_t i = 0; i < m->numfriends; ++i) {
         if (m->friendlist[i].status > 0) {
             struct Saved_Friend temp = { 0 };
-            temp.status = m->friendlist[i].status;
-            memcpy(temp.real_pk, m->friendlist[i].real_pk, CRYPTO_PUBLIC_KEY_SIZE);
-
-            if (temp.status < 3) {
-                // TODO(iphydf): Use uint16_t and min_u16 here.
-                const size_t friendrequest_length =
-                    min_u32(m->friendlist[i].info_size,
-                            min_u32(SAVED_FRIEND_REQUEST_SIZE, MAX_FRIEND_REQUEST_DATA_SIZE));
-                memcpy(temp.info, m->friendlist[i].info, friendrequest_length);
-
-                temp.info_size = net_htons(m->friendlist[i].info_size);
-                temp.friendrequest_nospam = m->friendlist[i].friendrequest_nospam;
-            } else {
-                temp.status = 3;
-                memcpy(temp.name, m->friendlist[i].name, m->friendlist[i].name_length);
-                temp.name_length = net_htons(m->friendlist[i].name_length);
-                memcpy(temp.statusmessage, m->friendlist[i].statusmessage, m->friendlist[i].statusmessage_length);
-                temp.statusmessage_length = net_htons(m->friendlist[i].statusmessage_length);
-                temp.userstatus = m->friendlist[i].userstatus;
-
-                net_pack_u64(temp.last_seen_time, m->friendlist[i].last_seen_time);
-            }
+            saved_friend_from(&m->friendlist[i], &temp);
 
             uint8_t *next_data = friend_save(&temp, cur_data);
             assert(next_data - cur_data == friend_size());
@@ -2991,6 +3671,34 @@ static uint8_t *_Nonnull friends_list_save(const Messenger *_Nonnull m, uint8_t
     return data;
 }
 
+static void load_saved_friend(Messenger *_Nonnull m, const struct Saved_Friend *_Nonnull temp)
+{
+    if (temp->status >= 3) {
+        if (!public_key_valid(temp->real_pk)) {
+            return;
+        }
+
+        const int fnum = m_add_friend_contact_norequest(m, temp->real_pk, !m->options.lazy_friend_connections);
+
+        if (fnum < 0) {
+            return;
+        }
+
+        setfriendname(m, fnum, temp->name, net_ntohs(temp->name_length));
+        set_friend_statusmessage(m, fnum, temp->statusmessage, net_ntohs(temp->statusmessage_length));
+        set_friend_userstatus(m, fnum, temp->userstatus);
+        net_unpack_u64(temp->last_seen_time, &m->friendlist[fnum].last_seen_time);
+    } else if (temp->status != 0) {
+        /* TODO(irungentoo): This is not a good way to do this. */
+        uint8_t address[FRIEND_ADDRESS_SIZE];
+        pk_copy(address, temp->real_pk);
+        memcpy(address + CRYPTO_PUBLIC_KEY_SIZE, &temp->friendrequest_nospam, sizeof(uint32_t));
+        uint16_t checksum = data_checksum(address, FRIEND_ADDRESS_SIZE - sizeof(checksum));
+        memcpy(address + CRYPTO_PUBLIC_KEY_SIZE + sizeof(uint32_t), &checksum, sizeof(checksum));
+        m_addfriend(m, address, temp->info, net_ntohs(temp->info_size));
+    }
+}
+
 static State_Load_Status friends_list_load(Messenger *_Nonnull m, const uint8_t *_Nonnull data, uint32_t length)
 {
     const uint32_t l_friend_size = friend_size();
@@ -3009,26 +3717,7 @@ static State_Load_Status friends_list_load(Messenger *_Nonnull m, const uint8_t
 
         cur_data = next_data;
 
-        if (temp.status >= 3) {
-            const int fnum = m_addfriend_norequest(m, temp.real_pk);
-
-            if (fnum < 0) {
-                continue;
-            }
-
-            setfriendname(m, fnum, temp.name, net_ntohs(temp.name_length));
-            set_friend_statusmessage(m, fnum, temp.statusmessage, net_ntohs(temp.statusmessage_length));
-            set_friend_userstatus(m, fnum, temp.userstatus);
-            net_unpack_u64(temp.last_seen_time, &m->friendlist[fnum].last_seen_time);
-        } else if (temp.status != 0) {
-            /* TODO(irungentoo): This is not a good way to do this. */
-            uint8_t address[FRIEND_ADDRESS_SIZE];
-            pk_copy(address, temp.real_pk);
-            memcpy(address + CRYPTO_PUBLIC_KEY_SIZE, &temp.friendrequest_nospam, sizeof(uint32_t));
-            uint16_t checksum = data_checksum(address, FRIEND_ADDRESS_SIZE - sizeof(checksum));
-            memcpy(address + CRYPTO_PUBLIC_KEY_SIZE + sizeof(uint32_t), &checksum, sizeof(checksum));
-            m_addfriend(m, address, temp.info, net_ntohs(temp.info_size));
-        }
+        load_saved_friend(m, &temp);
     }
 
     return STATE_LOAD_STATUS_CONTINUE;
@@ -3147,7 +3836,9 @@ static uint8_t *_Nonnull save_name(const Messenger *_Nonnull m, uint8_t *_Nonnul
 
 static State_Load_Status load_name(Messenger *_Nonnull m, const uint8_t *_Nonnull data, uint32_t length)
 {
-    if (length > 0 && length <= MAX_NAME_LENGTH) {
+    // An empty name is saved when a journal records that the name was cleared.
+    // In a base save it changes nothing, as the name starts out empty.
+    if (length <= MAX_NAME_LENGTH) {
         setname(m, data, length);
     }
 
@@ -3171,7 +3862,8 @@ static uint8_t *_Nonnull save_status_message(const Messenger *_Nonnull m, uint8_
 
 static State_Load_Status load_status_message(Messenger *_Nonnull m, const uint8_t *_Nonnull data, uint32_t length)
 {
-    if (length > 0 && length <= MAX_STATUSMESSAGE_LENGTH) {
+    // Empty for the same reason as in load_name.
+    if (length <= MAX_STATUSMESSAGE_LENGTH) {
         m_set_statusmessage(m, data, length);
     }
 
@@ -3306,9 +3998,153 @@ static void m_register_default_plugins(Messenger *_Nonnull m)
     m_register_state_plugin(m, STATE_TYPE_PATH_NODE, path_node_size, load_path_nodes, save_path_nodes);
 }
 
+// journal records
+static State_Load_Status load_friend_update(Messenger *_Nonnull m, const uint8_t *_Nonnull data, uint32_t length)
+{
+    if (length != friend_size()) {
+        return STATE_LOAD_STATUS_ERROR;
+    }
+
+    struct Saved_Friend temp = { 0 };
+    friend_load(&temp, data);
+
+    // A friend request may have become a confirmed friend, so replace the friend.
+    const int32_t friendnumber = getfriend_id(m, temp.real_pk);
+
+    if (friendnumber != -1) {
+        m_delfriend(m, friendnumber);
+    }
+
+    load_saved_friend(m, &temp);
+
+    return STATE_LOAD_STATUS_CONTINUE;
+}
+
+static State_Load_Status load_friend_remove(Messenger *_Nonnull m, const uint8_t *_Nonnull data, uint32_t length)
+{
+    if (length != CRYPTO_PUBLIC_KEY_SIZE) {
+        return STATE_LOAD_STATUS_ERROR;
+    }
+
+    const int32_t friendnumber = getfriend_id(m, data);
+
+    if (friendnumber != -1) {
+        m_delfriend(m, friendnumber);
+    }
+
+    return STATE_LOAD_STATUS_CONTINUE;
+}
+
+typedef struct Group_Update_Load {
+    Messenger *_Nonnull m;
+    /** The chat id the section is keyed by. */
+    const uint8_t *_Nonnull chat_id;
+} Group_Update_Load;
+
+static bool handle_group_update_load(void *_Nonnull obj, Bin_Unpack *_Nonnull bu)
+{
+    const Group_Update_Load *update = (const Group_Update_Load *)obj;
+    Messenger *m = update->m;
+
+    const int group_number = gc_group_load(m->group_handler, bu);
+
+    if (group_number < 0) {
+        LOGGER_WARNING(m->log, "Failed to load group from journal");
+        return true;
+    }
+
+    GC_Chat *chat = gc_get_group(m->group_handler, group_number);
+
+    if (chat == nullptr) {
+        return true;
+    }
+
+    uint8_t chat_id[CHAT_ID_SIZE];
+    gc_get_chat_id(chat, chat_id);
+
+    if (memcmp(chat_id, update->chat_id, CHAT_ID_SIZE) != 0) {
+        LOGGER_ERROR(m->log, "group in journal doesn't match the chat id of its section");
+        gc_group_unload(m->group_handler, chat);
+        return false;
+    }
+
+    return true;
+}
+
+static State_Load_Status load_group_update(Messenger *_Nonnull m, const uint8_t *_Nonnull data, uint32_t length)
+{
+    if (length < CHAT_ID_SIZE) {
+        return STATE_LOAD_STATUS_ERROR;
+    }
+
+    if (!m->options.groups_persistence_enabled) {
+        return STATE_LOAD_STATUS_CONTINUE;
+    }
+
+    GC_Chat *chat = gc_get_group_by_public_key(m->group_handler, data);
+
+    if (chat != nullptr) {
+        gc_group_unload(m->group_handler, chat);
+    }
+
+    Group_Update_Load update = {m, data};
+
+    if (!bin_unpack_obj(m->mem, handle_group_update_load, &update, data + CHAT_ID_SIZE, length - CHAT_ID_SIZE)) {
+        LOGGER_ERROR(m->log, "msgpack failed to unpack group from journal");
+        return STATE_LOAD_STATUS_ERROR;
+    }
+
+    return STATE_LOAD_STATUS_CONTINUE;
+}
+
+static State_Load_Status load_group_remove(Messenger *_Nonnull m, const uint8_t *_Nonnull data, uint32_t length)
+{
+    if (length != CHAT_ID_SIZE) {
+        return STATE_LOAD_STATUS_ERROR;
+    }
+
+    if (!m->options.groups_persistence_enabled) {
+        return STATE_LOAD_STATUS_CONTINUE;
+    }
+
+    GC_Chat *chat = gc_get_group_by_public_key(m->group_handler, data);
+
+    if (chat != nullptr) {
+        gc_group_unload(m->group_handler, chat);
+    }
+
+    return STATE_LOAD_STATUS_CONTINUE;
+}
+
 bool messenger_load_state_section(Messenger *m, const uint8_t *data, uint32_t length, uint16_t type,
                                   State_Load_Status *status)
 {
+    switch (type) {
+        case STATE_TYPE_FRIEND_UPDATE: {
+            *status = load_friend_update(m, data, length);
+            return true;
+        }
+
+        case STATE_TYPE_FRIEND_REMOVE: {
+            *status = load_friend_remove(m, data, length);
+            return true;
+        }
+
+        case STATE_TYPE_GROUP_UPDATE: {
+            *status = load_group_update(m, data, length);
+            return true;
+        }
+
+        case STATE_TYPE_GROUP_REMOVE: {
+            *status = load_group_remove(m, data, length);
+            return true;
+        }
+
+        default: {
+            break;
+        }
+    }
+
     for (uint8_t i = 0; i < m->options.state_plugins_length; ++i) {
         const Messenger_State_Plugin *const plugin = &m->options.state_plugins[i];
 
@@ -3321,6 +4157,275 @@ bool messenger_load_state_section(Messenger *m, const uint8_t *data, uint32_t le
     return false;
 }
 
+static bool pack_group_handler(const void *_Nonnull obj, const Logger *_Nonnull logger, Bin_Pack *_Nonnull bp)
+{
+    gc_group_save((const GC_Chat *)obj, bp);
+    return true;
+}
+
+static const Messenger_Journal_Group *_Nullable journal_find_group(const Messenger_Journal *_Nonnull journal,
+        const uint8_t *_Nonnull chat_id)
+{
+    for (uint32_t i = 0; i < journal->groups_length; ++i) {
+        if (memcmp(journal->groups[i].chat_id, chat_id, CHAT_ID_SIZE) == 0) {
+            return &journal->groups[i];
+        }
+    }
+
+    return nullptr;
+}
+
+/** @brief Forget all recorded changes, e.g. because they were written. */
+static void journal_clear(Messenger *_Nonnull m)
+{
+    Messenger_Journal *journal = &m->journal;
+
+    for (uint32_t i = 0; i < journal->dirty_friends_length; ++i) {
+        m->friendlist[journal->dirty_friends[i]].journal_dirty = false;
+    }
+
+    journal->dirty_friends_length = 0;
+    journal->removed_friends_length = 0;
+    journal->name_dirty = false;
+    journal->statusmessage_dirty = false;
+    journal->userstatus_dirty = false;
+    journal->nospam = get_nospam(m->fr);
+}
+
+/** @brief Remember a hash of every group as it is saved now. */
+static void journal_hash_groups(Messenger *_Nonnull m)
+{
+    Messenger_Journal *journal = &m->journal;
+    const GC_Session *c = m->group_handler;
+
+    mem_delete(m->mem, journal->groups);
+    journal->groups = nullptr;
+    journal->groups_length = 0;
+
+    const uint32_t num_groups = gc_count_groups(c);
+
+    if (!m->options.groups_persistence_enabled || num_groups == 0) {
+        return;
+    }
+
+    journal->groups = (Messenger_Journal_Group *)mem_valloc(m->mem, num_groups, sizeof(Messenger_Journal_Group));
+
+    if (journal->groups == nullptr) {
+        // Removed groups can't be detected without the list.
+        journal->incomplete = true;
+        return;
+    }
+
+    for (uint32_t i = 0; i < c->chats_index; ++i) {
+        const GC_Chat *chat = &c->chats[i];
+
+        if (!gc_group_is_valid(chat)) {
+            continue;
+        }
+
+        uint32_t len;
+        uint8_t *packed = bin_pack_obj_alloc(m->mem, pack_group_handler, chat, m->log, &len);
+
+        if (packed == nullptr) {
+            // Without a hash the group is written to the next journal again.
+            continue;
+        }
+
+        Messenger_Journal_Group *group = &journal->groups[journal->groups_length];
+        gc_get_chat_id(chat, group->chat_id);
+        crypto_sha256(group->hash, packed, len);
+        ++journal->groups_length;
+
+        mem_delete(m->mem, packed);
+    }
+}
+
+uint8_t *messenger_journal_base(Messenger *m, uint8_t *data)
+{
+    data = messenger_save(m, data);
+
+    journal_clear(m);
+    m->journal.incomplete = false;
+    journal_hash_groups(m);
+    m->journal.started = true;
+
+    return data;
+}
+
+uint32_t messenger_journal_size(const Messenger *m)
+{
+    const Messenger_Journal *journal = &m->journal;
+
+    if (!journal->started) {
+        return 0;
+    }
+
+    const uint32_t sizesubhead = sizeof(uint32_t) * 2;
+    uint32_t size = 0;
+
+    if (journal->nospam != get_nospam(m->fr)) {
+        size += sizesubhead + m_plugin_size(m, STATE_TYPE_NOSPAMKEYS);
+    }
+
+    if (journal->name_dirty) {
+        size += sizesubhead + m_plugin_size(m, STATE_TYPE_NAME);
+    }
+
+    if (journal->statusmessage_dirty) {
+        size += sizesubhead + m_plugin_size(m, STATE_TYPE_STATUSMESSAGE);
+    }
+
+    if (journal->userstatus_dirty) {
+        size += sizesubhead + m_plugin_size(m, STATE_TYPE_STATUS);
+    }
+
+    size += journal->removed_friends_length * (sizesubhead + CRYPTO_PUBLIC_KEY_SIZE);
+    size += journal->dirty_friends_length * (sizesubhead + friend_size());
+
+    if (!m->options.groups_persistence_enabled) {
+        return size;
+    }
+
+    // Whether a group changed is only known once it is packed, so count every
+    // group and every removal that could be written.
+    size += journal->groups_length * (sizesubhead + CHAT_ID_SIZE);
+
+    const GC_Session *c = m->group_handler;
+
+    for (uint32_t i = 0; i < c->chats_index; ++i) {
+        const GC_Chat *chat = &c->chats[i];
+
+        if (gc_group_is_valid(chat)) {
+            size += sizesubhead + CHAT_ID_SIZE + bin_pack_obj_size(pack_group_handler, chat, m->log);
+        }
+    }
+
+    return size;
+}
+
+static uint8_t *_Nonnull journal_save_groups(Messenger *_Nonnull m, Messenger_Journal_Group *_Nullable groups,
+        uint8_t *_Nonnull data, const uint8_t *_Nonnull end)
+{
+    Messenger_Journal *journal = &m->journal;
+    const GC_Session *c = m->group_handler;
+    const uint32_t sizesubhead = sizeof(uint32_t) * 2;
+
+    for (uint32_t i = 0; i < journal->groups_length; ++i) {
+        if (gc_get_group_by_public_key(c, journal->groups[i].chat_id) == nullptr) {
+            data = state_write_section_header(data, STATE_COOKIE_TYPE, CHAT_ID_SIZE, STATE_TYPE_GROUP_REMOVE);
+            memcpy(data, journal->groups[i].chat_id, CHAT_ID_SIZE);
+            data += CHAT_ID_SIZE;
+        }
+    }
+
+    uint32_t groups_length = 0;
+
+    for (uint32_t i = 0; i < c->chats_index; ++i) {
+        const GC_Chat *chat = &c->chats[i];
+
+        if (!gc_group_is_valid(chat)) {
+            continue;
+        }
+
+        // Pack the group in place and only keep it if its hash changed.
+        uint8_t *chat_id = data + sizesubhead;
+        uint8_t *packed = chat_id + CHAT_ID_SIZE;
+        const uint32_t len = (size_t)(end - data) >= sizesubhead + CHAT_ID_SIZE
+                             ? bin_pack_obj_written(pack_group_handler, chat, m->log, packed, (uint32_t)(end - packed))
+                             : UINT32_MAX;
+
+        if (len == UINT32_MAX) {
+            // A group missing from the journal could never be removed from
+            // the file, so ask the client for a new base instead.
+            LOGGER_ERROR(m->log, "failed to pack group into journal");
+            journal->incomplete = true;
+            break;
+        }
+
+        gc_get_chat_id(chat, chat_id);
+
+        Messenger_Journal_Group *group = &groups[groups_length];
+        memcpy(group->chat_id, chat_id, CHAT_ID_SIZE);
+        crypto_sha256(group->hash, packed, len);
+        ++groups_length;
+
+        const Messenger_Journal_Group *saved = journal_find_group(journal, chat_id);
+
+        if (saved != nullptr && crypto_sha256_eq(saved->hash, group->hash)) {
+            continue;
+        }
+
+        state_write_section_header(data, STATE_COOKIE_TYPE, CHAT_ID_SIZE + len, STATE_TYPE_GROUP_UPDATE);
+        data = packed + len;
+    }
+
+    mem_delete(m->mem, journal->groups);
+    journal->groups = groups;
+    journal->groups_length = groups_length;
+
+    return data;
+}
+
+uint8_t *messenger_journal_save(Messenger *m, uint8_t *data, uint32_t length)
+{
+    const uint8_t *const end = data + length;
+    Messenger_Journal *journal = &m->journal;
+
+    if (!journal->started || journal->incomplete) {
+        return data;
+    }
+
+    Messenger_Journal_Group *groups = nullptr;
+    const uint32_t num_groups = m->options.groups_persistence_enabled ? gc_count_groups(m->group_handler) : 0;
+
+    if (num_groups > 0) {
+        groups = (Messenger_Journal_Group *)mem_valloc(m->mem, num_groups, sizeof(Messenger_Journal_Group));
+
+        if (groups == nullptr) {
+            journal->incomplete = true;
+            return data;
+        }
+    }
+
+    if (journal->nospam != get_nospam(m->fr)) {
+        data = m_plugin_save(m, STATE_TYPE_NOSPAMKEYS, data);
+    }
+
+    if (journal->name_dirty) {
+        data = m_plugin_save(m, STATE_TYPE_NAME, data);
+    }
+
+    if (journal->statusmessage_dirty) {
+        data = m_plugin_save(m, STATE_TYPE_STATUSMESSAGE, data);
+    }
+
+    if (journal->userstatus_dirty) {
+        data = m_plugin_save(m, STATE_TYPE_STATUS, data);
+    }
+
+    for (uint32_t i = 0; i < journal->removed_friends_length; ++i) {
+        data = state_write_section_header(data, STATE_COOKIE_TYPE, CRYPTO_PUBLIC_KEY_SIZE, STATE_TYPE_FRIEND_REMOVE);
+        pk_copy(data, &journal->removed_friends[i * CRYPTO_PUBLIC_KEY_SIZE]);
+        data += CRYPTO_PUBLIC_KEY_SIZE;
+    }
+
+    for (uint32_t i = 0; i < journal->dirty_friends_length; ++i) {
+        struct Saved_Friend temp = { 0 };
+        saved_friend_from(&m->friendlist[journal->dirty_friends[i]], &temp);
+
+        data = state_write_section_header(data, STATE_COOKIE_TYPE, friend_size(), STATE_TYPE_FRIEND_UPDATE);
+        data = friend_save(&temp, data);
+    }
+
+    if (m->options.groups_persistence_enabled) {
+        data = journal_save_groups(m, groups, data, end);
+    }
+
+    journal_clear(m);
+
+    return data;
+}
+
 /** @brief Return the number of friends in the instance m.
  *
  * You should use this to determine how much memory to allocate
@@ -3598,7 +4703,6 @@ Messenger *new_messenger(Mono_Time *mono_time, const Memory *mem, const Random *
     set_filter_function(m->fr, &friend_already_added, m);
 
     m->lastdump = 0;
-    m->is_receiving_file = 0;
 
     m_register_default_plugins(m);
     callback_friendrequest(m->fr, m_handle_friend_request, m);
@@ -3636,38 +4740,20 @@ void kill_messenger(Messenger *m)
     netprof_kill(m->mem, m->tcp_np);
     kill_dht(m->dht);
     kill_networking(m->net);
+    iterprof_kill(m->mem, m->iter_profile);
 
     for (uint32_t i = 0; i < m->numfriends; ++i) {
         clear_receipts(m, i);
+        break_files(m, i);
     }
 
     mem_delete(m->mem, m->friendlist);
     friendreq_kill(m->fr);
 
+    mem_delete(m->mem, m->journal.dirty_friends);
+    mem_delete(m->mem, m->journal.removed_friends);
+    mem_delete(m->mem, m->journal.groups);
+
     mem_delete(m->mem, m->options.state_plugins);
     mem_delete(m->mem, m);
 }
-
-bool m_is_receiving_file(Messenger *m)
-{
-    // Only run the expensive loop below once every 64 tox_iterate calls.
-    const uint8_t skip_count = 64;
-
-    if (m->is_receiving_file != 0) {
-        --m->is_receiving_file;
-        return true;
-    }
-
-    // TODO(iphydf): This is a very expensive loop. Consider keeping track of
-    // the number of live file transfers.
-    for (size_t friend_number = 0; friend_number < m->numfriends; ++friend_number) {
-        for (size_t i = 0; i < MAX_CONCURRENT_FILE_PIPES; ++i) {
-            if (m->friendlist[friend_number].file_receiving[i].status == FILESTATUS_TRANSFERRING) {
-                m->is_receiving_file = skip_count;
-                return true;
-            }
-        }
-    }
-
-    return false;
-}
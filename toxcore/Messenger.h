@@ -19,11 +19,13 @@
 #include "announce.h"
 #include "attributes.h"
 #include "crypto_core.h"
+#include "deadlines.h"
 #include "forwarding.h"
 #include "friend_connection.h"
 #include "friend_requests.h"
 #include "group_announce.h"
 #include "group_common.h"
+#include "iterate_profile.h"
 #include "logger.h"
 #include "mem.h"
 #include "mono_time.h"
@@ -43,6 +45,8 @@
 #define NUM_SAVED_TCP_RELAYS 8
 /* This cannot be bigger than 256 */
 #define MAX_CONCURRENT_FILE_PIPES 256
+/* Friend connections created per do_messenger run for friends loaded with lazy_friend_connections. */
+#define MAX_FRIEND_CONNECTS_PER_RUN 64
 
 #define FRIEND_ADDRESS_SIZE (CRYPTO_PUBLIC_KEY_SIZE + sizeof(uint32_t) + sizeof(uint16_t))
 
@@ -87,6 +91,8 @@ typedef struct Messenger_Options {
     bool local_discovery_enabled;
     bool dht_announcements_enabled;
     bool groups_persistence_enabled;
+    /** Create the friend connections of loaded friends in do_messenger instead of while loading. */
+    bool lazy_friend_connections;
 
     Messenger_State_Plugin *_Nullable state_plugins;
     uint8_t state_plugins_length;
@@ -144,6 +150,9 @@ typedef enum Userstatus {
 
 #define FILE_ID_LENGTH 32
 
+/** @brief Where an outgoing file's data comes from or an incoming file's data goes. */
+typedef struct File_Stream File_Stream;
+
 struct File_Transfers {
     uint64_t size;
     uint64_t transferred;
@@ -152,6 +161,7 @@ struct File_Transfers {
     uint32_t last_packet_number; /* number of the last packet sent. */
     uint64_t requested; /* total data requested by the request chunk callback */
     uint8_t id[FILE_ID_LENGTH];
+    File_Stream *_Nullable stream; /* source or sink set by the client, NULL to use the chunk callbacks. */
 };
 typedef enum Filestatus {
     FILESTATUS_NONE,
@@ -202,6 +212,10 @@ typedef void m_file_chunk_request_cb(Messenger *_Nonnull m, uint32_t friend_numb
                                      size_t length, void *_Nullable user_data);
 typedef void m_file_recv_chunk_cb(Messenger *_Nonnull m, uint32_t friend_number, uint32_t file_number, uint64_t position,
                                   const uint8_t *_Nullable data, size_t length, void *_Nullable user_data);
+/** @brief Read up to `length` bytes at `position`; returns how many were read. */
+typedef size_t m_file_read_cb(void *_Nullable object, uint64_t position, uint8_t *_Nonnull data, size_t length);
+/** @brief Write `length` bytes at `position`; returns false on failure. */
+typedef bool m_file_write_cb(void *_Nullable object, uint64_t position, const uint8_t *_Nonnull data, size_t length);
 typedef void m_friend_lossy_packet_cb(Messenger *_Nonnull m, uint32_t friend_number, uint8_t packet_id, const uint8_t *_Nonnull data,
                                       size_t length, void *_Nullable user_data);
 typedef void m_friend_lossless_packet_cb(Messenger *_Nonnull m, uint32_t friend_number, uint8_t packet_id, const uint8_t *_Nonnull data,
@@ -241,8 +255,44 @@ typedef struct Friend {
 
     struct Receipts *_Nullable receipts_start;
     struct Receipts *_Nullable receipts_end;
+
+    bool journal_dirty; // true if the friend is in the journal's dirty friend list.
 } Friend;
 
+typedef struct Messenger_Journal_Group {
+    uint8_t chat_id[CHAT_ID_SIZE];
+    uint8_t hash[CRYPTO_SHA256_SIZE];
+} Messenger_Journal_Group;
+
+/**
+ * @brief Changes to the saved state since the journal base or the last journal.
+ *
+ * Friends and our own profile are tracked where they change. Groups change in
+ * too many places for that, so a hash of each saved group is kept instead and
+ * compared when the journal is written.
+ */
+typedef struct Messenger_Journal {
+    bool started;
+    // Set when a change could not be recorded. Only a new base fixes that.
+    bool incomplete;
+
+    bool name_dirty;
+    bool statusmessage_dirty;
+    bool userstatus_dirty;
+    uint32_t nospam;
+
+    uint32_t *_Nullable dirty_friends;
+    uint32_t dirty_friends_length;
+    uint32_t dirty_friends_capacity;
+
+    uint8_t *_Nullable removed_friends; // CRYPTO_PUBLIC_KEY_SIZE bytes per friend.
+    uint32_t removed_friends_length;
+    uint32_t removed_friends_capacity;
+
+    Messenger_Journal_Group *_Nullable groups;
+    uint32_t groups_length;
+} Messenger_Journal;
+
 struct Messenger {
     Logger *_Nonnull log;
     Mono_Time *_Nonnull mono_time;
@@ -253,6 +303,8 @@ struct Messenger {
     Networking_Core *_Nonnull net;
     Net_Crypto *_Nonnull net_crypto;
     Net_Profile *_Nonnull tcp_np;
+    /* Only while profiling is enabled, see `m_set_iterate_profiling`. */
+    Iterate_Profile *_Nullable iter_profile;
     DHT *_Nonnull dht;
 
     Forwarding *_Nullable forwarding;
@@ -277,8 +329,13 @@ struct Messenger {
     Friend *_Nullable friendlist;
     uint32_t numfriends;
 
+    // Friends without a friend connection yet, and where to look for them.
+    uint32_t num_unconnected_friends;
+    uint32_t next_unconnected_friend;
+    // Don't try to connect them before this time (ms) after running out of memory.
+    uint64_t unconnected_friends_retry_time;
+
     uint64_t lastdump;
-    uint8_t is_receiving_file;
 
     GC_Session *_Nonnull group_handler;
     GC_Announces_List *_Nonnull group_announce;
@@ -314,6 +371,8 @@ struct Messenger {
     Onion_Connection_Status last_connection_status;
 
     Messenger_Options options;
+
+    Messenger_Journal journal;
 };
 
 /**
@@ -408,6 +467,22 @@ int m_delfriend(Messenger *_Nonnull m, int32_t friendnumber);
  */
 int m_get_friend_connectionstatus(const Messenger *_Nonnull m, int32_t friendnumber);
 
+/** @brief Round trip time of the connection to a friend.
+ *
+ * @return the smallest round trip time in milliseconds measured so far.
+ * @retval 0 if the friend is not connected.
+ */
+uint32_t m_get_friend_rtt(const Messenger *_Nonnull m, int32_t friendnumber);
+
+/** @brief Traffic and latency counters of the connection to a friend.
+ *
+ * The counters start from zero on each new connection. If the friend is not
+ * connected, `stats` is zeroed.
+ *
+ * @retval false if the friend doesn't exist.
+ */
+bool m_get_friend_connection_stats(const Messenger *_Nonnull m, int32_t friendnumber, Crypto_Connection_Stats *_Nonnull stats);
+
 /**
  * Checks if there exists a friend with given friendnumber.
  *
@@ -684,6 +759,60 @@ int file_seek(const Messenger *_Nonnull m, int32_t friendnumber, uint32_t filenu
  */
 int send_file_data(const Messenger *_Nonnull m, int32_t friendnumber, uint32_t filenumber, uint64_t position,
                    const uint8_t *_Nullable data, uint16_t length);
+
+/** @brief Send an outgoing file from memory instead of the chunk request callback.
+ *
+ * The region must stay valid until the transfer ends. For files of unknown
+ * size (UINT64_MAX), the end of the region is the end of the file.
+ *
+ * @retval 0 on success
+ * @retval -1 if friend not valid.
+ * @retval -2 if filenumber invalid.
+ * @retval -3 if the file isn't outgoing.
+ * @retval -4 if a source is already set or requested chunks are still outstanding.
+ * @retval -5 if the region is smaller than the file.
+ * @retval -6 if memory allocation failed.
+ */
+int file_set_source_region(const Messenger *_Nonnull m, int32_t friendnumber, uint32_t filenumber,
+                           const uint8_t *_Nonnull data, uint64_t length);
+
+/** @brief Send an outgoing file by reading it with `read` instead of the chunk request callback.
+ *
+ * Data is read ahead into a buffer of `buffer_size` bytes (0 for a default
+ * size), so `read` is called once per buffer rather than once per packet. A
+ * short read ends a file of unknown size and kills a file of known size.
+ *
+ * @return the same values as file_set_source_region.
+ */
+int file_set_source_callback(const Messenger *_Nonnull m, int32_t friendnumber, uint32_t filenumber,
+                             m_file_read_cb *_Nonnull read, void *_Nullable object, uint32_t buffer_size);
+
+/** @brief Receive an incoming file into memory instead of the chunk receive callback.
+ *
+ * The chunk receive callback is still called with length 0 when the file is
+ * complete. Data that doesn't fit the region kills the transfer.
+ *
+ * @retval 0 on success
+ * @retval -1 if friend not valid.
+ * @retval -2 if filenumber invalid.
+ * @retval -3 if the file isn't incoming.
+ * @retval -4 if a sink is already set.
+ * @retval -5 if the region is smaller than the file.
+ * @retval -6 if memory allocation failed.
+ */
+int file_set_sink_region(const Messenger *_Nonnull m, int32_t friendnumber, uint32_t filenumber,
+                         uint8_t *_Nonnull data, uint64_t length);
+
+/** @brief Receive an incoming file by writing it with `write` instead of the chunk receive callback.
+ *
+ * Data is collected in a buffer of `buffer_size` bytes (0 for a default size)
+ * and written when the buffer is full, the file is complete or the friend goes
+ * offline. A failed write kills the transfer.
+ *
+ * @return the same values as file_set_sink_region.
+ */
+int file_set_sink_callback(const Messenger *_Nonnull m, int32_t friendnumber, uint32_t filenumber,
+                           m_file_write_cb *_Nonnull write, void *_Nullable object, uint32_t buffer_size);
 /*** CUSTOM PACKETS */
 
 /** @brief Set handlers for custom lossy packets. */
@@ -738,15 +867,40 @@ Messenger *_Nullable new_messenger(Mono_Time *_Nonnull mono_time, const Memory *
  * Free all datastructures.
  */
 void kill_messenger(Messenger *_Nullable m);
-/** @brief The main loop that needs to be run at least 20 times per second. */
+/**
+ * @brief Longest time in milliseconds between two `do_messenger()` calls
+ *   while no socket is open.
+ */
+#define MESSENGER_MAX_RUN_INTERVAL 1000
+
+/**
+ * @brief Longest time in milliseconds until the next `do_messenger()` call.
+ *
+ * Incoming packets are only read by `do_messenger()`, so while the UDP socket
+ * or a TCP relay connection is open this is `DEADLINE_POLL_INTERVAL`, and
+ * `MESSENGER_MAX_RUN_INTERVAL` otherwise.
+ */
+uint32_t messenger_max_run_interval(const Messenger *_Nonnull m);
+
+/** @brief The main loop. Run it again when `messenger_deadlines()` says so. */
 void do_messenger(Messenger *_Nonnull m, void *_Nullable userdata);
 /**
- * @brief Return the time in milliseconds before `do_messenger()` should be called again
- *   for optimal performance.
+ * @brief Set the deadline of every subsystem run by `do_messenger()`.
+ *
+ * Deadlines of sources that `do_messenger()` doesn't run, like conferences,
+ * are set to `DEADLINE_NEVER`.
+ */
+void messenger_deadlines(const Messenger *_Nonnull m, Deadlines *_Nonnull deadlines);
+
+/**
+ * @brief Start or stop timing the phases of `do_messenger()` and the UDP packet handlers.
  *
- * @return time (in ms) before the next `do_messenger()` needs to be run on success.
+ * Starting creates an empty profile in `m->iter_profile`, stopping frees it.
+ * While stopped, the timing costs one null check per phase.
+ *
+ * @retval false if the profile couldn't be allocated.
  */
-uint32_t messenger_run_interval(const Messenger *_Nonnull m);
+bool m_set_iterate_profiling(Messenger *_Nonnull m, bool enabled);
 
 /* SAVING AND LOADING FUNCTIONS: */
 
@@ -773,6 +927,24 @@ uint8_t *_Nonnull messenger_save(const Messenger *_Nonnull m, uint8_t *_Nonnull
  */
 bool messenger_load_state_section(Messenger *_Nonnull m, const uint8_t *_Nonnull data, uint32_t length, uint16_t type, State_Load_Status *_Nonnull status);
 
+/** @brief Save the messenger like `messenger_save()` and start a new journal.
+ *
+ * Changes made after this call are written by `messenger_journal_save()` as
+ * sections that are loaded after the ones saved here.
+ */
+uint8_t *_Nonnull messenger_journal_base(Messenger *_Nonnull m, uint8_t *_Nonnull data);
+
+/** @brief Return the size of the journal records `messenger_journal_save()` would write. */
+uint32_t messenger_journal_size(const Messenger *_Nonnull m);
+
+/** @brief Write journal records for the changes since the base or the last journal.
+ *
+ * `length` is the size of `data`, which must be at least
+ * `messenger_journal_size()` bytes. The changes are forgotten afterwards, so
+ * each change is written once.
+ */
+uint8_t *_Nonnull messenger_journal_save(Messenger *_Nonnull m, uint8_t *_Nonnull data, uint32_t length);
+
 /** @brief Return the number of friends in the instance m.
  *
  * You should use this to determine how much memory to allocate
@@ -788,6 +960,4 @@ uint32_t count_friendlist(const Messenger *_Nonnull m);
  */
 uint32_t copy_friendlist(const Messenger *_Nonnull m, uint32_t *_Nonnull out_list, uint32_t list_size);
 
-bool m_is_receiving_file(Messenger *_Nonnull m);
-
 #endif /* C_TOXCORE_TOXCORE_MESSENGER_H */
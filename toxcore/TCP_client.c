@@ -16,6 +16,7 @@
 #include "attributes.h"
 #include "ccompat.h"
 #include "crypto_core.h"
+#include "deadlines.h"
 #include "forwarding.h"
 #include "logger.h"
 #include "mem.h"
@@ -47,11 +48,22 @@ struct TCP_Client_Connection {
 
     uint64_t last_pinged;
     uint64_t ping_id;
+    /* When the ping with ping_id was sent, in ms of current_time_monotonic. */
+    uint64_t ping_sent_ms;
+    /* Smoothed round trip time to the relay in ms, 0 if not measured yet. */
+    uint32_t rtt;
+
+    /* Bytes of routed data accepted for sending. */
+    uint64_t bytes_sent;
 
     uint64_t ping_response_id;
     uint64_t ping_request_id;
 
-    TCP_Client_Conn connections[NUM_CLIENT_CONNECTIONS];
+    /* Indexed by connection id, grown as the relay hands out ids. */
+    TCP_Client_Conn *_Nullable connections;
+    uint32_t connections_length;
+    bool wide_ids; /* The relay enabled TCP_EXTENSION_WIDE_IDS. */
+
     tcp_routing_response_cb *_Nullable response_callback;
     void *_Nullable response_callback_object;
     tcp_routing_status_cb *_Nullable status_callback;
@@ -86,6 +98,16 @@ TCP_Client_Status tcp_con_status(const TCP_Client_Connection *con)
 {
     return con->status;
 }
+
+uint32_t tcp_con_rtt(const TCP_Client_Connection *con)
+{
+    return con->rtt;
+}
+
+uint64_t tcp_con_bytes_sent(const TCP_Client_Connection *con)
+{
+    return con->bytes_sent;
+}
 void *tcp_con_custom_object(const TCP_Client_Connection *con)
 {
     return con->custom_object;
@@ -385,9 +407,9 @@ static int tcp_send_ping_request(const Logger *_Nonnull logger, TCP_Client_Conne
  * @retval 0 if could not send packet.
  * @retval -1 on failure.
  */
-int send_data(const Logger *logger, TCP_Client_Connection *con, uint8_t con_id, const uint8_t *data, uint16_t length)
+int send_data(const Logger *logger, TCP_Client_Connection *con, uint32_t con_id, const uint8_t *data, uint16_t length)
 {
-    if (con_id >= NUM_CLIENT_CONNECTIONS) {
+    if (con_id >= con->connections_length) {
         return -1;
     }
 
@@ -399,16 +421,24 @@ int send_data(const Logger *logger, TCP_Client_Connection *con, uint8_t con_id,
         return 0;
     }
 
-    if (1 + length > MAX_PACKET_SIZE) {
+    const uint16_t header_size = tcp_con_id_size(con->wide_ids);
+
+    if ((uint32_t)header_size + length > MAX_PACKET_SIZE) {
         LOGGER_ERROR(logger, "Packet length too long: %u", length);
         return -1;
     }
 
-    const uint16_t packet_size = 1 + length;
+    const uint16_t packet_size = header_size + length;
     VLA(uint8_t, packet, packet_size);
-    packet[0] = con_id + NUM_RESERVED_PORTS;
-    memcpy(packet + 1, data, length);
-    return write_packet_tcp_secure_connection(logger, &con->con, packet, packet_size, false);
+    tcp_pack_con_id(packet, con_id, con->wide_ids);
+    memcpy(packet + header_size, data, length);
+    const int ret = write_packet_tcp_secure_connection(logger, &con->con, packet, packet_size, false);
+
+    if (ret == 1) {
+        con->bytes_sent += length;
+    }
+
+    return ret;
 }
 
 /**
@@ -438,9 +468,9 @@ int send_oob_packet(const Logger *logger, TCP_Client_Connection *con, const uint
  * return 0 on success.
  * return -1 on failure.
  */
-int set_tcp_connection_number(TCP_Client_Connection *con, uint8_t con_id, uint32_t number)
+int set_tcp_connection_number(TCP_Client_Connection *con, uint32_t con_id, uint32_t number)
 {
-    if (con_id >= NUM_CLIENT_CONNECTIONS) {
+    if (con_id >= con->connections_length) {
         return -1;
     }
 
@@ -469,12 +499,12 @@ void oob_data_handler(TCP_Client_Connection *con, tcp_oob_data_cb *oob_data_call
  * @retval 0 if could not send packet.
  * @retval -1 on failure (connection must be killed).
  */
-static int client_send_disconnect_notification(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull con, uint8_t id)
+static int client_send_disconnect_notification(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull con, uint32_t id)
 {
-    uint8_t packet[1 + 1];
+    uint8_t packet[1 + 2];
     packet[0] = TCP_PACKET_DISCONNECT_NOTIFICATION;
-    packet[1] = id;
-    return write_packet_tcp_secure_connection(logger, &con->con, packet, sizeof(packet), true);
+    const uint16_t length = 1 + tcp_pack_con_id(packet + 1, id, con->wide_ids);
+    return write_packet_tcp_secure_connection(logger, &con->con, packet, length, true);
 }
 
 /**
@@ -528,15 +558,15 @@ static int tcp_send_ping_response(const Logger *logger, TCP_Client_Connection *c
  * @retval 0 if could not send packet.
  * @retval -1 on failure (connection must be killed).
  */
-int send_disconnect_request(const Logger *logger, TCP_Client_Connection *con, uint8_t con_id)
+int send_disconnect_request(const Logger *logger, TCP_Client_Connection *con, uint32_t con_id)
 {
-    if (con_id >= NUM_CLIENT_CONNECTIONS) {
+    if (con_id >= con->connections_length) {
         return -1;
     }
 
     con->connections[con_id].status = 0;
     con->connections[con_id].number = 0;
-    return client_send_disconnect_notification(logger, con, con_id + NUM_RESERVED_PORTS);
+    return client_send_disconnect_notification(logger, con, con_id);
 }
 
 /**
@@ -700,17 +730,67 @@ TCP_Client_Connection *new_tcp_connection(
     return temp;
 }
 
-static int handle_tcp_client_routing_response(TCP_Client_Connection *_Nonnull conn, const uint8_t *_Nonnull data, uint16_t length)
+/** @brief Make room for connection id con_id.
+ *
+ * @retval true if con_id can be used.
+ */
+static bool reserve_client_connections(TCP_Client_Connection *_Nonnull conn, uint32_t con_id)
 {
-    if (length != 1 + 1 + CRYPTO_PUBLIC_KEY_SIZE) {
+    if (con_id < conn->connections_length) {
+        return true;
+    }
+
+    const uint32_t max = conn->wide_ids ? NUM_WIDE_CLIENT_CONNECTIONS : NUM_CLIENT_CONNECTIONS;
+
+    if (con_id >= max) {
+        return false;
+    }
+
+    const uint32_t new_length = min_u32(max, max_u32(con_id + 1, max_u32(conn->connections_length * 2, 8)));
+    TCP_Client_Conn *new_connections = (TCP_Client_Conn *)mem_vrealloc(
+                                           conn->con.mem, conn->connections, new_length, sizeof(TCP_Client_Conn));
+
+    if (new_connections == nullptr) {
+        return false;
+    }
+
+    memset(&new_connections[conn->connections_length], 0,
+           (new_length - conn->connections_length) * sizeof(TCP_Client_Conn));
+    conn->connections = new_connections;
+    conn->connections_length = new_length;
+    return true;
+}
+
+static int handle_tcp_client_routing_response(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull conn, const uint8_t *_Nonnull data,
+        uint16_t length)
+{
+    const uint16_t id_size = tcp_con_id_size(conn->wide_ids);
+
+    if (length != 1 + id_size + CRYPTO_PUBLIC_KEY_SIZE) {
         return -1;
     }
 
-    if (data[1] < NUM_RESERVED_PORTS) {
+    const uint8_t *public_key = data + 1 + id_size;
+    uint32_t con_id;
+    const bool accepted = tcp_unpack_con_id(data + 1, length - 1, conn->wide_ids, &con_id) != 0;
+    uint8_t extensions;
+
+    if (tcp_is_extensions_key(public_key, &extensions)) {
+        /* The relay doesn't know about extensions and routed us to a fake peer. */
+        if (accepted) {
+            client_send_disconnect_notification(logger, conn, con_id);
+        }
+
+        return 0;
+    }
+
+    if (!accepted) {
         return 0;
     }
 
-    const uint8_t con_id = data[1] - NUM_RESERVED_PORTS;
+    if (!reserve_client_connections(conn, con_id)) {
+        return -1;
+    }
 
     if (conn->connections[con_id].status != 0) {
         return 0;
@@ -718,7 +798,7 @@ static int handle_tcp_client_routing_response(TCP_Client_Connection *_Nonnull co
 
     conn->connections[con_id].status = 1;
     conn->connections[con_id].number = -1;
-    memcpy(conn->connections[con_id].public_key, data + 2, CRYPTO_PUBLIC_KEY_SIZE);
+    memcpy(conn->connections[con_id].public_key, public_key, CRYPTO_PUBLIC_KEY_SIZE);
 
     if (conn->response_callback != nullptr) {
         conn->response_callback(conn->response_callback_object, con_id, conn->connections[con_id].public_key);
@@ -729,15 +809,16 @@ static int handle_tcp_client_routing_response(TCP_Client_Connection *_Nonnull co
 
 static int handle_tcp_client_connection_notification(TCP_Client_Connection *_Nonnull conn, const uint8_t *_Nonnull data, uint16_t length)
 {
-    if (length != 1 + 1) {
-        return -1;
-    }
+    uint32_t con_id;
 
-    if (data[1] < NUM_RESERVED_PORTS) {
+    if (length != 1 + tcp_con_id_size(conn->wide_ids)
+            || tcp_unpack_con_id(data + 1, length - 1, conn->wide_ids, &con_id) == 0) {
         return -1;
     }
 
-    const uint8_t con_id = data[1] - NUM_RESERVED_PORTS;
+    if (con_id >= conn->connections_length) {
+        return 0;
+    }
 
     if (conn->connections[con_id].status != 1) {
         return 0;
@@ -755,15 +836,16 @@ static int handle_tcp_client_connection_notification(TCP_Client_Connection *_Non
 
 static int handle_tcp_client_disconnect_notification(TCP_Client_Connection *_Nonnull conn, const uint8_t *_Nonnull data, uint16_t length)
 {
-    if (length != 1 + 1) {
-        return -1;
-    }
+    uint32_t con_id;
 
-    if (data[1] < NUM_RESERVED_PORTS) {
+    if (length != 1 + tcp_con_id_size(conn->wide_ids)
+            || tcp_unpack_con_id(data + 1, length - 1, conn->wide_ids, &con_id) == 0) {
         return -1;
     }
 
-    const uint8_t con_id = data[1] - NUM_RESERVED_PORTS;
+    if (con_id >= conn->connections_length) {
+        return 0;
+    }
 
     if (conn->connections[con_id].status == 0) {
         return 0;
@@ -796,7 +878,20 @@ static int handle_tcp_client_ping(const Logger *_Nonnull logger, TCP_Client_Conn
     return 0;
 }
 
-static int handle_tcp_client_pong(TCP_Client_Connection *_Nonnull conn, const uint8_t *_Nonnull data, uint16_t length)
+/** @brief Fold an RTT sample into the smoothed RTT, with the RFC 6298 gain of 1/8. */
+static void update_rtt(TCP_Client_Connection *_Nonnull conn, uint64_t sample)
+{
+    const uint32_t rtt = (uint32_t)min_u64(max_u64(sample, 1), UINT32_MAX);
+
+    if (conn->rtt == 0) {
+        conn->rtt = rtt;
+    } else {
+        conn->rtt = (uint32_t)(((uint64_t)conn->rtt * 7 + rtt) / 8);
+    }
+}
+
+static int handle_tcp_client_pong(TCP_Client_Connection *_Nonnull conn, const Mono_Time *_Nonnull mono_time,
+                                  const uint8_t *_Nonnull data, uint16_t length)
 {
     if (length != 1 + sizeof(uint64_t)) {
         return -1;
@@ -808,6 +903,9 @@ static int handle_tcp_client_pong(TCP_Client_Connection *_Nonnull conn, const ui
     if (ping_id != 0) {
         if (ping_id == conn->ping_id) {
             conn->ping_id = 0;
+            // Sampled here rather than from the cached iteration time, so the
+            // RTT does not include how long the pong waited to be read.
+            update_rtt(conn, current_time_monotonic(mono_time) - conn->ping_sent_ms);
         }
 
         return 0;
@@ -816,6 +914,21 @@ static int handle_tcp_client_pong(TCP_Client_Connection *_Nonnull conn, const ui
     return -1;
 }
 
+static int handle_tcp_client_extensions(TCP_Client_Connection *_Nonnull conn, const uint8_t *_Nonnull data, uint16_t length)
+{
+    if (length != 1 + 1) {
+        return -1;
+    }
+
+    // The relay only enables extensions before handing out any ids.
+    if (conn->connections_length != 0) {
+        return -1;
+    }
+
+    conn->wide_ids = (data[1] & TCP_EXTENSION_WIDE_IDS) != 0;
+    return 0;
+}
+
 static int handle_tcp_client_oob_recv(TCP_Client_Connection *_Nonnull conn, const uint8_t *_Nonnull data, uint16_t length, void *_Nullable userdata)
 {
     if (length <= 1 + CRYPTO_PUBLIC_KEY_SIZE) {
@@ -834,8 +947,8 @@ static int handle_tcp_client_oob_recv(TCP_Client_Connection *_Nonnull conn, cons
  * @retval 0 on success
  * @retval -1 on failure
  */
-static int handle_tcp_client_packet(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull conn, const uint8_t *_Nonnull data,
-                                    uint16_t length, void *_Nullable userdata)
+static int handle_tcp_client_packet(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull conn, const Mono_Time *_Nonnull mono_time,
+                                    const uint8_t *_Nonnull data, uint16_t length, void *_Nullable userdata)
 {
     if (length <= 1) {
         return -1;
@@ -845,7 +958,7 @@ static int handle_tcp_client_packet(const Logger *_Nonnull logger, TCP_Client_Co
 
     switch (data[0]) {
         case TCP_PACKET_ROUTING_RESPONSE:
-            return handle_tcp_client_routing_response(conn, data, length);
+            return handle_tcp_client_routing_response(logger, conn, data, length);
 
         case TCP_PACKET_CONNECTION_NOTIFICATION:
             return handle_tcp_client_connection_notification(conn, data, length);
@@ -857,11 +970,14 @@ static int handle_tcp_client_packet(const Logger *_Nonnull logger, TCP_Client_Co
             return handle_tcp_client_ping(logger, conn, data, length);
 
         case TCP_PACKET_PONG:
-            return handle_tcp_client_pong(conn, data, length);
+            return handle_tcp_client_pong(conn, mono_time, data, length);
 
         case TCP_PACKET_OOB_RECV:
             return handle_tcp_client_oob_recv(conn, data, length, userdata);
 
+        case TCP_PACKET_EXTENSIONS:
+            return handle_tcp_client_extensions(conn, data, length);
+
         case TCP_PACKET_ONION_RESPONSE: {
             if (conn->onion_callback != nullptr) {
                 conn->onion_callback(conn->onion_callback_object, data + 1, length - 1, userdata);
@@ -877,15 +993,20 @@ static int handle_tcp_client_packet(const Logger *_Nonnull logger, TCP_Client_Co
         }
 
         default: {
-            if (data[0] < NUM_RESERVED_PORTS) {
+            uint32_t con_id;
+            const uint16_t header_size = tcp_unpack_con_id(data, length, conn->wide_ids, &con_id);
+
+            if (header_size == 0) {
                 return -1;
             }
 
-            const uint8_t con_id = data[0] - NUM_RESERVED_PORTS;
+            if (con_id >= conn->connections_length) {
+                return 0;
+            }
 
             if (conn->data_callback != nullptr) {
-                conn->data_callback(conn->data_callback_object, conn->connections[con_id].number, con_id, data + 1, length - 1,
-                                    userdata);
+                conn->data_callback(conn->data_callback_object, conn->connections[con_id].number, con_id, data + header_size,
+                                    length - header_size, userdata);
             }
         }
     }
@@ -893,7 +1014,8 @@ static int handle_tcp_client_packet(const Logger *_Nonnull logger, TCP_Client_Co
     return 0;
 }
 
-static bool tcp_process_packet(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull conn, void *_Nullable userdata)
+static bool tcp_process_packet(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull conn, const Mono_Time *_Nonnull mono_time,
+                               void *_Nullable userdata)
 {
     uint8_t packet[MAX_PACKET_SIZE];
     const int len = read_packet_tcp_secure_connection(logger, conn->con.mem, conn->con.ns, conn->con.sock, &conn->next_packet_length, conn->con.shared_key, conn->recv_nonce, packet, sizeof(packet),
@@ -908,7 +1030,7 @@ static bool tcp_process_packet(const Logger *_Nonnull logger, TCP_Client_Connect
         return false;
     }
 
-    if (handle_tcp_client_packet(logger, conn, packet, len, userdata) == -1) {
+    if (handle_tcp_client_packet(logger, conn, mono_time, packet, len, userdata) == -1) {
         conn->status = TCP_CLIENT_DISCONNECTED;
         return false;
     }
@@ -934,6 +1056,7 @@ static int do_confirmed_tcp(const Logger *_Nonnull logger, TCP_Client_Connection
         conn->ping_id = ping_id;
         tcp_send_ping_request(logger, conn);
         conn->last_pinged = mono_time_get(mono_time);
+        conn->ping_sent_ms = current_time_monotonic(mono_time);
     }
 
     if (conn->ping_id != 0 && mono_time_is_timeout(mono_time, conn->last_pinged, TCP_PING_TIMEOUT)) {
@@ -941,7 +1064,7 @@ static int do_confirmed_tcp(const Logger *_Nonnull logger, TCP_Client_Connection
         return 0;
     }
 
-    while (tcp_process_packet(logger, conn, userdata)) {
+    while (tcp_process_packet(logger, conn, mono_time, userdata)) {
         /* Keep reading until error or out of data. */
     }
 
@@ -1019,6 +1142,10 @@ void do_tcp_connection(const Logger *logger, const Mono_Time *mono_time,
             if (handle_handshake(tcp_connection, data) == 0) {
                 tcp_connection->kill_at = UINT64_MAX;
                 tcp_connection->status = TCP_CLIENT_CONFIRMED;
+                // First thing after the handshake, before any routing.
+                uint8_t extensions_key[CRYPTO_PUBLIC_KEY_SIZE];
+                tcp_extensions_key(extensions_key, TCP_EXTENSION_WIDE_IDS);
+                send_routing_request(logger, tcp_connection, extensions_key);
             } else {
                 tcp_connection->kill_at = 0;
                 tcp_connection->status = TCP_CLIENT_DISCONNECTED;
@@ -1035,6 +1162,33 @@ void do_tcp_connection(const Logger *logger, const Mono_Time *mono_time,
     }
 }
 
+uint64_t tcp_con_next_deadline(const TCP_Client_Connection *tcp_connection, const Mono_Time *mono_time)
+{
+    if (tcp_connection->status == TCP_CLIENT_DISCONNECTED) {
+        return DEADLINE_NEVER;
+    }
+
+    const uint64_t poll = mono_time_get_ms(mono_time) + DEADLINE_POLL_INTERVAL;
+    uint64_t due = tcp_connection->kill_at == UINT64_MAX
+                   ? DEADLINE_NEVER : deadline_from_seconds(tcp_connection->kill_at, 0);
+
+    if (tcp_connection->status != TCP_CLIENT_CONFIRMED) {
+        return deadline_min(due, poll);
+    }
+
+    const TCP_Connection *con = &tcp_connection->con;
+
+    // While a ping is outstanding, keep polling so its pong is read soon
+    // after it arrives and the RTT sample is not stretched to the deadline.
+    if (con->last_packet_length != 0 || con->priority_queue_start != nullptr
+            || tcp_connection->ping_request_id != 0 || tcp_connection->ping_response_id != 0
+            || tcp_connection->ping_id != 0) {
+        return deadline_min(due, poll);
+    }
+
+    return deadline_min(due, deadline_from_seconds(tcp_connection->last_pinged, TCP_PING_FREQUENCY));
+}
+
 /** Kill the TCP connection */
 void kill_tcp_connection(TCP_Client_Connection *tcp_connection)
 {
@@ -1045,6 +1199,7 @@ void kill_tcp_connection(TCP_Client_Connection *tcp_connection)
     const Memory *mem = tcp_connection->con.mem;
 
     wipe_priority_list(tcp_connection->con.mem, tcp_connection->con.priority_queue_start);
+    mem_delete(mem, tcp_connection->connections);
     kill_sock(tcp_connection->con.ns, tcp_connection->con.sock);
     crypto_memzero(tcp_connection, sizeof(TCP_Client_Connection));
     mem_delete(mem, tcp_connection);
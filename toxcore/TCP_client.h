@@ -55,6 +55,10 @@ typedef struct TCP_Client_Connection TCP_Client_Connection;
 const uint8_t *_Nonnull tcp_con_public_key(const TCP_Client_Connection *_Nonnull con);
 IP_Port tcp_con_ip_port(const TCP_Client_Connection *_Nonnull con);
 TCP_Client_Status tcp_con_status(const TCP_Client_Connection *_Nonnull con);
+/** @brief Smoothed round trip time to the relay in ms from its pings, 0 if not known yet. */
+uint32_t tcp_con_rtt(const TCP_Client_Connection *_Nonnull con);
+/** @brief Total bytes of routed data sent through the relay. */
+uint64_t tcp_con_bytes_sent(const TCP_Client_Connection *_Nonnull con);
 
 void *_Nullable tcp_con_custom_object(const TCP_Client_Connection *_Nonnull con);
 uint32_t tcp_con_custom_uint(const TCP_Client_Connection *_Nonnull con);
@@ -69,6 +73,14 @@ TCP_Client_Connection *_Nullable new_tcp_connection(
 /** Run the TCP connection */
 void do_tcp_connection(const Logger *_Nonnull logger, const Mono_Time *_Nonnull mono_time,
                        TCP_Client_Connection *_Nonnull tcp_connection, void *_Nullable userdata);
+/**
+ * @brief When `do_tcp_connection` next has work to do, in milliseconds on the
+ *   `mono_time_get_ms` clock.
+ *
+ * Handshakes and unsent data wait for the socket, so they are polled every
+ * `DEADLINE_POLL_INTERVAL`. Incoming data is not taken into account.
+ */
+uint64_t tcp_con_next_deadline(const TCP_Client_Connection *_Nonnull tcp_connection, const Mono_Time *_Nonnull mono_time);
 /** Kill the TCP connection */
 void kill_tcp_connection(TCP_Client_Connection *_Nullable tcp_connection);
 typedef int tcp_onion_response_cb(void *_Nonnull object, const uint8_t *_Nonnull data, uint16_t length, void *_Nullable userdata);
@@ -84,8 +96,8 @@ void onion_response_handler(TCP_Client_Connection *_Nonnull con, tcp_onion_respo
 int send_forward_request_tcp(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull con, const IP_Port *_Nonnull dest, const uint8_t *_Nonnull data, uint16_t length);
 void forwarding_handler(TCP_Client_Connection *_Nonnull con, forwarded_response_cb *_Nonnull forwarded_response_callback, void *_Nonnull object);
 
-typedef int tcp_routing_response_cb(void *_Nonnull object, uint8_t connection_id, const uint8_t *_Nonnull public_key);
-typedef int tcp_routing_status_cb(void *_Nonnull object, uint32_t number, uint8_t connection_id, uint8_t status);
+typedef int tcp_routing_response_cb(void *_Nonnull object, uint32_t connection_id, const uint8_t *_Nonnull public_key);
+typedef int tcp_routing_status_cb(void *_Nonnull object, uint32_t number, uint32_t connection_id, uint8_t status);
 
 /**
  * @retval 1 on success.
@@ -101,7 +113,7 @@ void routing_status_handler(TCP_Client_Connection *_Nonnull con, tcp_routing_sta
  * @retval 0 if could not send packet.
  * @retval -1 on failure (connection must be killed).
  */
-int send_disconnect_request(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull con, uint8_t con_id);
+int send_disconnect_request(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull con, uint32_t con_id);
 
 /** @brief Set the number that will be used as an argument in the callbacks related to con_id.
  *
@@ -110,9 +122,9 @@ int send_disconnect_request(const Logger *_Nonnull logger, TCP_Client_Connection
  * return 0 on success.
  * return -1 on failure.
  */
-int set_tcp_connection_number(TCP_Client_Connection *_Nonnull con, uint8_t con_id, uint32_t number);
+int set_tcp_connection_number(TCP_Client_Connection *_Nonnull con, uint32_t con_id, uint32_t number);
 
-typedef int tcp_routing_data_cb(void *_Nonnull object, uint32_t number, uint8_t connection_id, const uint8_t *_Nonnull data,
+typedef int tcp_routing_data_cb(void *_Nonnull object, uint32_t number, uint32_t connection_id, const uint8_t *_Nonnull data,
                                 uint16_t length, void *_Nullable userdata);
 
 /**
@@ -120,7 +132,7 @@ typedef int tcp_routing_data_cb(void *_Nonnull object, uint32_t number, uint8_t
  * @retval 0 if could not send packet.
  * @retval -1 on failure.
  */
-int send_data(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull con, uint8_t con_id, const uint8_t *_Nonnull data, uint16_t length);
+int send_data(const Logger *_Nonnull logger, TCP_Client_Connection *_Nonnull con, uint32_t con_id, const uint8_t *_Nonnull data, uint16_t length);
 void routing_data_handler(TCP_Client_Connection *_Nonnull con, tcp_routing_data_cb *_Nonnull data_callback, void *_Nonnull object);
 
 typedef int tcp_oob_data_cb(void *_Nonnull object, const uint8_t *_Nonnull public_key, const uint8_t *_Nonnull data, uint16_t length,
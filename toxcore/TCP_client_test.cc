@@ -5,6 +5,7 @@
 
 #include <gtest/gtest.h>
 
+#include <array>
 #include <cstdio>
 #include <cstring>
 #include <vector>
@@ -12,6 +13,7 @@
 #include "TCP_common.h"
 #include "attributes.h"
 #include "crypto_core.h"
+#include "deadlines.h"
 #include "logger.h"
 #include "mono_time.h"
 #include "net_profile.h"
@@ -55,6 +57,143 @@ protected:
     }
 };
 
+/** @brief A relay that answers the handshake and exchanges packets by hand. */
+class FakeRelay {
+public:
+    FakeRelay(SimulatedEnvironment &env, std::uint16_t port)
+        : node_(env.create_node(port))
+        , log_(logger_new(&node_->c_memory))
+        , port_(port)
+    {
+        sock_ = net_socket(&node_->c_network, net_family_ipv4(), TOX_SOCK_STREAM, TOX_PROTO_TCP);
+        set_socket_nonblock(&node_->c_network, sock_);
+        bind_to_port(&node_->c_network, sock_, net_family_ipv4(), port);
+        net_listen(&node_->c_network, sock_, 5);
+        crypto_new_keypair(&node_->c_random, public_key_, secret_key_);
+    }
+
+    ~FakeRelay()
+    {
+        if (sock_valid(accepted_)) {
+            kill_sock(&node_->c_network, accepted_);
+        }
+        kill_sock(&node_->c_network, sock_);
+        logger_kill(log_);
+    }
+
+    FakeRelay(const FakeRelay &) = delete;
+    FakeRelay &operator=(const FakeRelay &) = delete;
+
+    const IP &ip() const { return node_->node->ip; }
+
+    IP_Port ip_port() const
+    {
+        IP_Port ip_port{};
+        ip_port.ip = ip();
+        ip_port.port = net_htons(port_);
+        return ip_port;
+    }
+
+    const std::uint8_t *public_key() const { return public_key_; }
+
+    /** @brief Accept the client and answer its handshake. True once it is done. */
+    bool handshake()
+    {
+        if (confirmed_) {
+            return true;
+        }
+
+        if (!sock_valid(accepted_)) {
+            accepted_ = net_accept(&node_->c_network, sock_);
+
+            if (!sock_valid(accepted_)) {
+                return false;
+            }
+
+            set_socket_nonblock(&node_->c_network, accepted_);
+        }
+
+        std::uint8_t buf[TCP_CLIENT_HANDSHAKE_SIZE];
+        IP_Port remote = ip_port();
+
+        if (net_recv(&node_->c_network, log_, accepted_, buf, sizeof(buf), &remote) != sizeof(buf)) {
+            return false;
+        }
+
+        std::uint8_t shared_key[CRYPTO_SHARED_KEY_SIZE];
+        encrypt_precompute(buf, secret_key_, shared_key);
+
+        std::uint8_t plain[TCP_HANDSHAKE_PLAIN_SIZE];
+        if (decrypt_data_symmetric(&node_->c_memory, shared_key, buf + CRYPTO_PUBLIC_KEY_SIZE,
+                buf + CRYPTO_PUBLIC_KEY_SIZE + CRYPTO_NONCE_SIZE,
+                sizeof(buf) - (CRYPTO_PUBLIC_KEY_SIZE + CRYPTO_NONCE_SIZE), plain)
+            != TCP_HANDSHAKE_PLAIN_SIZE) {
+            return false;
+        }
+
+        std::memcpy(recv_nonce_, plain + CRYPTO_PUBLIC_KEY_SIZE, CRYPTO_NONCE_SIZE);
+
+        std::uint8_t temp_pk[CRYPTO_PUBLIC_KEY_SIZE];
+        std::uint8_t temp_sk[CRYPTO_SECRET_KEY_SIZE];
+        crypto_new_keypair(&node_->c_random, temp_pk, temp_sk);
+
+        std::uint8_t resp_plain[TCP_HANDSHAKE_PLAIN_SIZE];
+        std::memcpy(resp_plain, temp_pk, CRYPTO_PUBLIC_KEY_SIZE);
+        random_nonce(&node_->c_random, sent_nonce_);
+        std::memcpy(resp_plain + CRYPTO_PUBLIC_KEY_SIZE, sent_nonce_, CRYPTO_NONCE_SIZE);
+
+        std::uint8_t response[TCP_SERVER_HANDSHAKE_SIZE];
+        random_nonce(&node_->c_random, response);
+        encrypt_data_symmetric(&node_->c_memory, shared_key, response, resp_plain,
+            sizeof(resp_plain), response + CRYPTO_NONCE_SIZE);
+        net_send(&node_->c_network, log_, accepted_, response, sizeof(response), &remote, nullptr);
+
+        encrypt_precompute(plain, temp_sk, shared_key_);
+        confirmed_ = true;
+        return true;
+    }
+
+    void send(const std::vector<std::uint8_t> &data)
+    {
+        std::vector<std::uint8_t> packet(sizeof(std::uint16_t) + data.size() + CRYPTO_MAC_SIZE);
+        const std::uint16_t c_length = net_htons(data.size() + CRYPTO_MAC_SIZE);
+        std::memcpy(packet.data(), &c_length, sizeof(c_length));
+        encrypt_data_symmetric(&node_->c_memory, shared_key_, sent_nonce_, data.data(), data.size(),
+            packet.data() + sizeof(std::uint16_t));
+        increment_nonce(sent_nonce_);
+
+        const IP_Port remote = ip_port();
+        net_send(&node_->c_network, log_, accepted_, packet.data(), packet.size(), &remote, nullptr);
+    }
+
+    /** @brief The next packet from the client, or an empty one if none arrived. */
+    std::vector<std::uint8_t> recv()
+    {
+        std::vector<std::uint8_t> packet(MAX_PACKET_SIZE);
+        const IP_Port remote = ip_port();
+        const int len = read_packet_tcp_secure_connection(log_, &node_->c_memory,
+            &node_->c_network, accepted_, &next_packet_length_, shared_key_, recv_nonce_,
+            packet.data(), packet.size(), &remote);
+        packet.resize(len > 0 ? len : 0);
+        return packet;
+    }
+
+private:
+    std::unique_ptr<ScopedToxSystem> node_;
+    Logger *_Nonnull log_;
+    std::uint16_t port_;
+    Socket sock_ = net_invalid_socket();
+    Socket accepted_ = net_invalid_socket();
+    bool confirmed_ = false;
+
+    std::uint8_t public_key_[CRYPTO_PUBLIC_KEY_SIZE];
+    std::uint8_t secret_key_[CRYPTO_SECRET_KEY_SIZE];
+    std::uint8_t shared_key_[CRYPTO_SHARED_KEY_SIZE] = {0};
+    std::uint8_t sent_nonce_[CRYPTO_NONCE_SIZE] = {0};
+    std::uint8_t recv_nonce_[CRYPTO_NONCE_SIZE] = {0};
+    std::uint16_t next_packet_length_ = 0;
+};
+
 TEST_F(TCPClientTest, ConnectsToRelay)
 {
     auto server_node = env.create_node(33445);
@@ -371,4 +510,168 @@ TEST_F(TCPClientTest, SendDataIntegerOverflow)
     mono_time_free(&client_node->c_memory, client_time);
 }
 
+TEST_F(TCPClientTest, RttTracksRelayLatency)
+{
+    constexpr std::array<std::uint64_t, 2> kOneWayMs{10, 100};
+    FakeRelay near_relay(env, 33447);
+    FakeRelay far_relay(env, 33448);
+    const std::array<FakeRelay *, 2> relays{&near_relay, &far_relay};
+
+    env.simulation().net().add_filter(
+        [&clock = env.clock(), kOneWayMs, ips = std::array<IP, 2>{near_relay.ip(), far_relay.ip()}](
+            Packet &p) {
+            for (std::size_t i = 0; i < ips.size(); ++i) {
+                if (ip_equal(&p.from.ip, &ips[i]) || ip_equal(&p.to.ip, &ips[i])) {
+                    p.delivery_time = clock.current_time_ms() + kOneWayMs[i];
+                }
+            }
+            return true;
+        });
+
+    auto client_node = env.create_node(0);
+    Logger *client_log = logger_new(&client_node->c_memory);
+    logger_callback_log(client_log, &TCPClientTest::log_cb, nullptr, nullptr);
+    Mono_Time *client_time = create_mono_time(&client_node->c_memory);
+    Net_Profile *client_profile = netprof_new(client_log, &client_node->c_memory);
+
+    std::uint8_t client_pk[CRYPTO_PUBLIC_KEY_SIZE];
+    std::uint8_t client_sk[CRYPTO_SECRET_KEY_SIZE];
+    crypto_new_keypair(&client_node->c_random, client_pk, client_sk);
+
+    std::array<TCP_Client_Connection *, 2> conns{};
+    std::array<std::uint64_t, 2> next_run{};
+
+    for (std::size_t i = 0; i < relays.size(); ++i) {
+        const IP_Port ip_port = relays[i]->ip_port();
+        conns[i] = new_tcp_connection(client_log, &client_node->c_memory, client_time,
+            &client_node->c_random, &client_node->c_network, &ip_port, relays[i]->public_key(),
+            client_pk, client_sk, nullptr, client_profile);
+        ASSERT_NE(conns[i], nullptr);
+    }
+
+    const auto measured = [&]() { return tcp_con_rtt(conns[0]) != 0 && tcp_con_rtt(conns[1]) != 0; };
+    const std::uint64_t start_time = env.clock().current_time_ms();
+
+    while (!measured()
+        && env.clock().current_time_ms() - start_time < (TCP_PING_FREQUENCY + TCP_PING_TIMEOUT) * 1000) {
+        env.advance_time(1);
+        mono_time_update(client_time);
+
+        for (std::size_t i = 0; i < relays.size(); ++i) {
+            // Only run the client when it asks to be run, like an event loop would.
+            if (mono_time_get_ms(client_time) >= next_run[i]) {
+                do_tcp_connection(client_log, client_time, conns[i], nullptr);
+                next_run[i] = tcp_con_next_deadline(conns[i], client_time);
+            }
+
+            if (!relays[i]->handshake()) {
+                continue;
+            }
+
+            for (auto packet = relays[i]->recv(); !packet.empty(); packet = relays[i]->recv()) {
+                if (packet[0] == TCP_PACKET_PING) {
+                    packet[0] = TCP_PACKET_PONG;
+                    relays[i]->send(packet);
+                }
+            }
+        }
+    }
+
+    ASSERT_TRUE(measured());
+
+    for (std::size_t i = 0; i < relays.size(); ++i) {
+        // The pong is read at the latest one poll interval after it arrived.
+        EXPECT_GE(tcp_con_rtt(conns[i]), 2 * kOneWayMs[i]) << i;
+        EXPECT_LE(tcp_con_rtt(conns[i]), 2 * kOneWayMs[i] + DEADLINE_POLL_INTERVAL) << i;
+        kill_tcp_connection(conns[i]);
+    }
+
+    net_profile_deleter(client_profile, &client_node->c_memory);
+    logger_kill(client_log);
+    mono_time_free(&client_node->c_memory, client_time);
+}
+
+TEST_F(TCPClientTest, OldRelayKeepsOneByteIds)
+{
+    FakeRelay relay(env, 33449);
+
+    auto client_node = env.create_node(0);
+    Logger *client_log = logger_new(&client_node->c_memory);
+    logger_callback_log(client_log, &TCPClientTest::log_cb, nullptr, nullptr);
+    Mono_Time *client_time = create_mono_time(&client_node->c_memory);
+    Net_Profile *client_profile = netprof_new(client_log, &client_node->c_memory);
+
+    std::uint8_t client_pk[CRYPTO_PUBLIC_KEY_SIZE];
+    std::uint8_t client_sk[CRYPTO_SECRET_KEY_SIZE];
+    crypto_new_keypair(&client_node->c_random, client_pk, client_sk);
+
+    const IP_Port ip_port = relay.ip_port();
+    TCP_Client_Connection *conn = new_tcp_connection(client_log, &client_node->c_memory, client_time,
+        &client_node->c_random, &client_node->c_network, &ip_port, relay.public_key(), client_pk,
+        client_sk, nullptr, client_profile);
+    ASSERT_NE(conn, nullptr);
+
+    struct Responses {
+        std::vector<std::uint32_t> ids;
+    } responses;
+    routing_response_handler(
+        conn,
+        [](void *object, std::uint32_t connection_id, const std::uint8_t * /*public_key*/) {
+            static_cast<Responses *>(object)->ids.push_back(connection_id);
+            return 0;
+        },
+        &responses);
+
+    std::vector<std::vector<std::uint8_t>> disconnects;
+    std::uint8_t next_id = NUM_RESERVED_PORTS;
+
+    const auto run = [&](std::uint64_t ms) {
+        for (std::uint64_t i = 0; i < ms; ++i) {
+            env.advance_time(1);
+            mono_time_update(client_time);
+            do_tcp_connection(client_log, client_time, conn, nullptr);
+
+            if (!relay.handshake()) {
+                continue;
+            }
+
+            for (auto packet = relay.recv(); !packet.empty(); packet = relay.recv()) {
+                if (packet[0] == TCP_PACKET_ROUTING_REQUEST && packet.size() == 1 + CRYPTO_PUBLIC_KEY_SIZE) {
+                    // A relay without extensions routes every key, including the extensions key.
+                    std::vector<std::uint8_t> response{TCP_PACKET_ROUTING_RESPONSE, next_id++};
+                    response.insert(response.end(), packet.begin() + 1, packet.end());
+                    relay.send(response);
+                } else if (packet[0] == TCP_PACKET_DISCONNECT_NOTIFICATION) {
+                    disconnects.push_back(packet);
+                }
+            }
+        }
+    };
+
+    run(1000);
+
+    ASSERT_EQ(tcp_con_status(conn), TCP_CLIENT_CONFIRMED);
+    ASSERT_EQ(next_id, NUM_RESERVED_PORTS + 1) << "client did not offer extensions";
+    ASSERT_EQ(disconnects.size(), 1u);
+    EXPECT_EQ(disconnects[0], (std::vector<std::uint8_t>{TCP_PACKET_DISCONNECT_NOTIFICATION, NUM_RESERVED_PORTS}));
+    EXPECT_TRUE(responses.ids.empty());
+
+    std::uint8_t peer_pk[CRYPTO_PUBLIC_KEY_SIZE];
+    std::uint8_t peer_sk[CRYPTO_SECRET_KEY_SIZE];
+    crypto_new_keypair(&client_node->c_random, peer_pk, peer_sk);
+    ASSERT_EQ(send_routing_request(client_log, conn, peer_pk), 1);
+
+    run(1000);
+
+    // The response carries a one-byte id, which the client only accepts if it never switched to wide ids.
+    EXPECT_EQ(tcp_con_status(conn), TCP_CLIENT_CONFIRMED);
+    EXPECT_EQ(responses.ids, std::vector<std::uint32_t>{1});
+    EXPECT_EQ(disconnects.size(), 1u);
+
+    kill_tcp_connection(conn);
+    net_profile_deleter(client_profile, &client_node->c_memory);
+    logger_kill(client_log);
+    mono_time_free(&client_node->c_memory, client_time);
+}
+
 }  // namespace
@@ -318,6 +318,58 @@ int read_packet_tcp_secure_connection(
     return len;
 }
 
+void tcp_extensions_key(uint8_t key[CRYPTO_PUBLIC_KEY_SIZE], uint8_t flags)
+{
+    memset(key, 0, TCP_EXTENSIONS_KEY_PREFIX_SIZE);
+    key[TCP_EXTENSIONS_KEY_PREFIX_SIZE] = flags;
+}
+
+bool tcp_is_extensions_key(const uint8_t *key, uint8_t *flags)
+{
+    for (uint32_t i = 0; i < TCP_EXTENSIONS_KEY_PREFIX_SIZE; ++i) {
+        if (key[i] != 0) {
+            return false;
+        }
+    }
+
+    *flags = key[TCP_EXTENSIONS_KEY_PREFIX_SIZE];
+    return true;
+}
+
+uint16_t tcp_con_id_size(bool wide_ids)
+{
+    return wide_ids ? 2 : 1;
+}
+
+uint16_t tcp_pack_con_id(uint8_t *data, uint32_t con_id, bool wide_ids)
+{
+    if (!wide_ids) {
+        data[0] = (uint8_t)(con_id + NUM_RESERVED_PORTS);
+        return 1;
+    }
+
+    data[0] = (uint8_t)((con_id >> 8) + NUM_RESERVED_PORTS);
+    data[1] = (uint8_t)(con_id & 0xff);
+    return 2;
+}
+
+uint16_t tcp_unpack_con_id(const uint8_t *data, uint16_t length, bool wide_ids, uint32_t *con_id)
+{
+    const uint16_t size = tcp_con_id_size(wide_ids);
+
+    if (length < size || data[0] < NUM_RESERVED_PORTS) {
+        return 0;
+    }
+
+    if (!wide_ids) {
+        *con_id = data[0] - NUM_RESERVED_PORTS;
+    } else {
+        *con_id = ((uint32_t)(data[0] - NUM_RESERVED_PORTS) << 8) | data[1];
+    }
+
+    return size;
+}
+
 const char *tcp_packet_type_to_string(Tcp_Packet type)
 {
     switch (type) {
@@ -356,6 +408,9 @@ const char *tcp_packet_type_to_string(Tcp_Packet type)
 
         case TCP_PACKET_FORWARDING:
             return "TCP_PACKET_FORWARDING";
+
+        case TCP_PACKET_EXTENSIONS:
+            return "TCP_PACKET_EXTENSIONS";
     }
 
     return "<invalid Tcp_Packet>";
@@ -375,7 +430,8 @@ bool tcp_packet_from_int(uint32_t value, Tcp_Packet *out_enum)
         case TCP_PACKET_ONION_REQUEST:
         case TCP_PACKET_ONION_RESPONSE:
         case TCP_PACKET_FORWARD_REQUEST:
-        case TCP_PACKET_FORWARDING: {
+        case TCP_PACKET_FORWARDING:
+        case TCP_PACKET_EXTENSIONS: {
             *out_enum = (Tcp_Packet)value;
             return true;
         }
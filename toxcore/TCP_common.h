@@ -34,6 +34,30 @@ void wipe_priority_list(const Memory *_Nonnull mem, TCP_Priority_List *_Nullable
 #define NUM_RESERVED_PORTS 16
 #define NUM_CLIENT_CONNECTIONS (256 - NUM_RESERVED_PORTS)
 
+/** @brief Connections a client can route through one relay with TCP_EXTENSION_WIDE_IDS.
+ *
+ * Wide ids are two bytes, `NUM_RESERVED_PORTS + (id >> 8)` and `id & 0xff`, so
+ * at most `NUM_CLIENT_CONNECTIONS * 256` of them fit. The limit is lower to
+ * bound the memory one client can make the relay allocate.
+ *
+ * The relay keeps a slot of about 44 bytes per id plus an index entry of up to
+ * about 54 bytes, so a client using all of them costs it about 1.6 MiB, where
+ * the NUM_CLIENT_CONNECTIONS ids of a client without wide ids cost at most
+ * about 24 KiB. TCP_SERVER_MAX_WIDE_SLOTS bounds the total over all clients.
+ */
+#define NUM_WIDE_CLIENT_CONNECTIONS 16384
+
+/** @brief Protocol extensions a client and relay can agree on.
+ *
+ * The client asks for them with a routing request for the key made of
+ * TCP_EXTENSIONS_KEY_PREFIX_SIZE zero bytes followed by the extension flags.
+ * A relay that knows about extensions replies with TCP_PACKET_EXTENSIONS
+ * carrying the flags it enabled. Older relays send a normal routing response
+ * for that key instead, which tells the client to stay with the base protocol.
+ */
+#define TCP_EXTENSION_WIDE_IDS 0x01
+#define TCP_EXTENSIONS_KEY_PREFIX_SIZE (CRYPTO_PUBLIC_KEY_SIZE - 1)
+
 typedef enum Tcp_Packet {
     TCP_PACKET_ROUTING_REQUEST          = 0,
     TCP_PACKET_ROUTING_RESPONSE         = 1,
@@ -47,6 +71,7 @@ typedef enum Tcp_Packet {
     TCP_PACKET_ONION_RESPONSE           = 9,
     TCP_PACKET_FORWARD_REQUEST          = 10,
     TCP_PACKET_FORWARDING               = 11,
+    TCP_PACKET_EXTENSIONS               = 12,
 } Tcp_Packet;
 
 const char *_Nonnull tcp_packet_type_to_string(Tcp_Packet type);
@@ -57,6 +82,31 @@ bool tcp_packet_from_int(uint32_t value, Tcp_Packet *_Nonnull out_enum);
 #define TCP_CLIENT_HANDSHAKE_SIZE (CRYPTO_PUBLIC_KEY_SIZE + TCP_SERVER_HANDSHAKE_SIZE)
 #define TCP_MAX_OOB_DATA_LENGTH 1024
 
+/** @brief Write the routing request key asking for the extensions in `flags`. */
+void tcp_extensions_key(uint8_t key[CRYPTO_PUBLIC_KEY_SIZE], uint8_t flags);
+
+/** @brief Returns true if `key` is an extensions key, and stores its flags in `flags`. */
+bool tcp_is_extensions_key(const uint8_t *_Nonnull key, uint8_t *_Nonnull flags);
+
+/** @brief Size in bytes of a connection id on the wire. */
+uint16_t tcp_con_id_size(bool wide_ids);
+
+/** @brief Write a connection id, offset by NUM_RESERVED_PORTS.
+ *
+ * `con_id` must be below NUM_CLIENT_CONNECTIONS, or below
+ * NUM_WIDE_CLIENT_CONNECTIONS if `wide_ids` is set.
+ *
+ * @return the number of bytes written.
+ */
+uint16_t tcp_pack_con_id(uint8_t *_Nonnull data, uint32_t con_id, bool wide_ids);
+
+/** @brief Read a connection id written by tcp_pack_con_id.
+ *
+ * @return the number of bytes read, or 0 if `data` is too short or holds no
+ *   connection id.
+ */
+uint16_t tcp_unpack_con_id(const uint8_t *_Nonnull data, uint16_t length, bool wide_ids, uint32_t *_Nonnull con_id);
+
 /** frequency to ping connected nodes and timeout in seconds */
 #define TCP_PING_FREQUENCY 30
 #define TCP_PING_TIMEOUT 10
@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 
 #include <cstddef>
+#include <cstdint>
 
 #include "logger.h"
 #include "os_memory.h"
@@ -97,4 +98,48 @@ TEST(TCP_common, PriorityQueueOrderingAndIntegrity)
     logger_kill(logger);
 }
 
+TEST(TCP_common, ConnectionIdsRoundTrip)
+{
+    std::uint8_t data[2];
+    std::uint32_t con_id = 0;
+
+    ASSERT_EQ(tcp_pack_con_id(data, 239, false), 1);
+    EXPECT_EQ(data[0], 239 + NUM_RESERVED_PORTS);
+    ASSERT_EQ(tcp_unpack_con_id(data, sizeof(data), false, &con_id), 1);
+    EXPECT_EQ(con_id, 239);
+
+    for (const std::uint32_t id : {0u, 255u, 256u, 9999u, NUM_WIDE_CLIENT_CONNECTIONS - 1u}) {
+        ASSERT_EQ(tcp_pack_con_id(data, id, true), 2);
+        ASSERT_EQ(tcp_unpack_con_id(data, sizeof(data), true, &con_id), 2);
+        EXPECT_EQ(con_id, id);
+    }
+
+    // Reserved packet ids are never connection ids.
+    data[0] = NUM_RESERVED_PORTS - 1;
+    EXPECT_EQ(tcp_unpack_con_id(data, sizeof(data), false, &con_id), 0);
+    EXPECT_EQ(tcp_unpack_con_id(data, sizeof(data), true, &con_id), 0);
+
+    // A refused routing response.
+    data[0] = 0;
+    data[1] = 0;
+    EXPECT_EQ(tcp_unpack_con_id(data, sizeof(data), true, &con_id), 0);
+
+    // Too short for a wide id.
+    ASSERT_EQ(tcp_pack_con_id(data, 300, true), 2);
+    EXPECT_EQ(tcp_unpack_con_id(data, 1, true, &con_id), 0);
+}
+
+TEST(TCP_common, ExtensionsKey)
+{
+    std::uint8_t key[CRYPTO_PUBLIC_KEY_SIZE];
+    std::uint8_t flags = 0;
+
+    tcp_extensions_key(key, TCP_EXTENSION_WIDE_IDS);
+    ASSERT_TRUE(tcp_is_extensions_key(key, &flags));
+    EXPECT_EQ(flags, TCP_EXTENSION_WIDE_IDS);
+
+    key[0] = 1;
+    EXPECT_FALSE(tcp_is_extensions_key(key, &flags));
+}
+
 }
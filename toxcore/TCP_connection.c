@@ -16,6 +16,7 @@
 #include "attributes.h"
 #include "ccompat.h"
 #include "crypto_core.h"
+#include "deadlines.h"
 #include "forwarding.h"
 #include "logger.h"
 #include "mem.h"
@@ -58,6 +59,8 @@ struct TCP_Connections {
     bool onion_status;
     uint16_t onion_num_conns;
 
+    TCP_Relay_Selection relay_selection;
+
     /* Network profile for all TCP client packets. */
     Net_Profile *_Nullable net_profile;
 };
@@ -298,15 +301,170 @@ uint32_t tcp_connected_relays_count(const TCP_Connections *tcp_c)
     return count;
 }
 
-/** @brief Send a packet to the TCP connection.
+void tcp_connections_set_relay_selection(TCP_Connections *tcp_c, TCP_Relay_Selection selection)
+{
+    tcp_c->relay_selection = selection;
+}
+
+uint32_t tcp_relay_rtt(const TCP_Connections *tcp_c, uint32_t tcp_connections_number)
+{
+    const TCP_con *tcp_con = get_tcp_connection(tcp_c, tcp_connections_number);
+
+    if (tcp_con == nullptr || tcp_con->status != TCP_CONN_CONNECTED || tcp_con->connection == nullptr) {
+        return 0;
+    }
+
+    return tcp_con_rtt(tcp_con->connection);
+}
+
+uint64_t tcp_relay_bytes_sent(const TCP_Connections *tcp_c, uint32_t tcp_connections_number)
+{
+    const TCP_con *tcp_con = get_tcp_connection(tcp_c, tcp_connections_number);
+
+    if (tcp_con == nullptr || tcp_con->connection == nullptr) {
+        return 0;
+    }
+
+    return tcp_con_bytes_sent(tcp_con->connection);
+}
+
+bool tcp_relay_public_key(const TCP_Connections *tcp_c, uint32_t tcp_connections_number, uint8_t *public_key)
+{
+    const TCP_con *tcp_con = get_tcp_connection(tcp_c, tcp_connections_number);
+
+    if (tcp_con == nullptr) {
+        return false;
+    }
+
+    if (tcp_con->status == TCP_CONN_SLEEPING) {
+        memcpy(public_key, tcp_con->relay_pk, CRYPTO_PUBLIC_KEY_SIZE);
+        return true;
+    }
+
+    if (tcp_con->connection == nullptr) {
+        return false;
+    }
+
+    memcpy(public_key, tcp_con_public_key(tcp_con->connection), CRYPTO_PUBLIC_KEY_SIZE);
+    return true;
+}
+
+/** An online relay of a connection, as a candidate for sending a packet. */
+typedef struct TCP_Send_Candidate {
+    TCP_Conn_to *_Nonnull conn_to;
+    /* Smoothed RTT, UINT32_MAX if not measured yet. */
+    uint32_t rtt;
+} TCP_Send_Candidate;
+
+/** @brief Add a relay with the given RTT (0 if not measured) after the first `count` candidates.
  *
- * return -1 on failure.
- * return 0 on success.
+ * If `sorted`, the candidates stay sorted by RTT. The sort is stable so that
+ * equal RTTs keep the slot order, and unmeasured relays go last.
  */
-int send_packet_tcp_connection(const TCP_Connections *tcp_c, int connections_number, const uint8_t *packet,
-                               uint16_t length)
+static void tcp_add_send_candidate(TCP_Send_Candidate *_Nonnull candidates, uint32_t count, TCP_Conn_to *_Nonnull conn_to,
+                                   uint32_t rtt, bool sorted)
 {
-    const TCP_Connection_to *con_to = get_connection(tcp_c, connections_number);
+    const TCP_Send_Candidate candidate = {conn_to, rtt == 0 ? UINT32_MAX : rtt};
+    uint32_t j = count;
+
+    if (sorted) {
+        while (j > 0 && candidates[j - 1].rtt > candidate.rtt) {
+            candidates[j] = candidates[j - 1];
+            --j;
+        }
+    }
+
+    candidates[j] = candidate;
+}
+
+/** @brief Collect the relays the connection is online on, in the order they should be tried.
+ *
+ * @return the number of candidates.
+ */
+static uint32_t tcp_send_candidates(const TCP_Connections *_Nonnull tcp_c, TCP_Connection_to *_Nonnull con_to,
+                                    TCP_Send_Candidate candidates[MAX_FRIEND_TCP_CONNECTIONS])
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < MAX_FRIEND_TCP_CONNECTIONS; ++i) {
+        TCP_Conn_to *conn_to = &con_to->connections[i];
+        uint32_t tcp_con_num = conn_to->tcp_connection;
+
+        if (tcp_con_num == 0 || conn_to->status != TCP_CONNECTIONS_STATUS_ONLINE) {
+            continue;
+        }
+
+        tcp_con_num -= 1;
+        const TCP_con *tcp_con = get_tcp_connection(tcp_c, tcp_con_num);
+
+        if (tcp_con == nullptr) {
+            continue;
+        }
+
+        if (tcp_con->connection == nullptr) {
+            LOGGER_ERROR(tcp_c->logger, "TCP connection is null for connection number %u", tcp_con_num);
+            continue;
+        }
+
+        tcp_add_send_candidate(candidates, count, conn_to, tcp_con_rtt(tcp_con->connection),
+                               tcp_c->relay_selection != TCP_RELAY_SELECTION_FIRST);
+        ++count;
+    }
+
+    return count;
+}
+
+/** @brief Move the relay that should carry the next bulk packet to the front.
+ *
+ * Relays within 1.5 times the lowest RTT share the packets with smooth
+ * weighted round robin, each weighted by the inverse of its RTT. Slower
+ * relays are only used when those are full.
+ */
+static void tcp_stripe_candidates(TCP_Send_Candidate *_Nonnull candidates, uint32_t count)
+{
+    if (count < 2 || candidates[0].rtt == UINT32_MAX) {
+        return;
+    }
+
+    const uint32_t best_rtt = candidates[0].rtt;
+
+    const uint64_t max_rtt = (uint64_t)best_rtt + best_rtt / 2;
+    int32_t total_weight = 0;
+    uint32_t chosen = 0;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        TCP_Conn_to *conn_to = candidates[i].conn_to;
+
+        if (candidates[i].rtt > max_rtt) {
+            conn_to->stripe_credit = 0;
+            continue;
+        }
+
+        // Packets per unit of time scale with 1/RTT; best_rtt/rtt is in (2/3, 1].
+        const int32_t weight = (int32_t)(((uint64_t)best_rtt * 1000) / candidates[i].rtt);
+        total_weight += weight;
+        conn_to->stripe_credit += weight;
+
+        if (conn_to->stripe_credit > candidates[chosen].conn_to->stripe_credit) {
+            chosen = i;
+        }
+    }
+
+    candidates[chosen].conn_to->stripe_credit -= total_weight;
+
+    const TCP_Send_Candidate first = candidates[chosen];
+
+    for (uint32_t i = chosen; i > 0; --i) {
+        candidates[i] = candidates[i - 1];
+    }
+
+    candidates[0] = first;
+}
+
+static int send_packet_tcp_connection_to(const TCP_Connections *_Nonnull tcp_c, int connections_number, const uint8_t *_Nonnull packet,
+        uint16_t length, bool bulk)
+{
+    TCP_Connection_to *con_to = get_connection(tcp_c, connections_number);
 
     if (con_to == nullptr) {
         return -1;
@@ -314,41 +472,33 @@ int send_packet_tcp_connection(const TCP_Connections *tcp_c, int connections_num
 
     // TODO(irungentoo): detect and kill bad relays.
     // TODO(irungentoo): thread safety?
-    int ret = -1;
+    TCP_Send_Candidate candidates[MAX_FRIEND_TCP_CONNECTIONS];
+    const uint32_t count = tcp_send_candidates(tcp_c, con_to, candidates);
 
-    bool limit_reached = false;
+    if (bulk && tcp_c->relay_selection == TCP_RELAY_SELECTION_STRIPED) {
+        tcp_stripe_candidates(candidates, count);
+    }
 
-    for (uint32_t i = 0; i < MAX_FRIEND_TCP_CONNECTIONS; ++i) {
-        uint32_t tcp_con_num = con_to->connections[i].tcp_connection;
-        const uint8_t status = con_to->connections[i].status;
-        const uint8_t connection_id = con_to->connections[i].connection_id;
+    bool limit_reached = false;
 
-        if (tcp_con_num > 0 && status == TCP_CONNECTIONS_STATUS_ONLINE) {
-            tcp_con_num -= 1;
-            TCP_con *tcp_con = get_tcp_connection(tcp_c, tcp_con_num);
+    for (uint32_t i = 0; i < count; ++i) {
+        const TCP_Conn_to *conn_to = candidates[i].conn_to;
+        // tcp_send_candidates only returns relays with a connection.
+        const TCP_con *tcp_con = get_tcp_connection(tcp_c, conn_to->tcp_connection - 1);
 
-            if (tcp_con == nullptr) {
-                continue;
-            }
-
-            if (tcp_con->connection == nullptr) {
-                LOGGER_ERROR(tcp_c->logger, "TCP connection is null for connection number %u", tcp_con_num);
-                continue;
-            }
-            ret = send_data(tcp_c->logger, tcp_con->connection, connection_id, packet, length);
+        if (tcp_con == nullptr || tcp_con->connection == nullptr) {
+            continue;
+        }
 
-            if (ret == 0) {
-                limit_reached = true;
-            }
+        const int ret = send_data(tcp_c->logger, tcp_con->connection, conn_to->connection_id, packet, length);
 
-            if (ret == 1) {
-                break;
-            }
+        if (ret == 1) {
+            return 0;
         }
-    }
 
-    if (ret == 1) {
-        return 0;
+        if (ret == 0) {
+            limit_reached = true;
+        }
     }
 
     if (limit_reached) {
@@ -383,6 +533,23 @@ int send_packet_tcp_connection(const TCP_Connections *tcp_c, int connections_num
     return sent_any ? 0 : -1;
 }
 
+/** @brief Send a packet to the TCP connection.
+ *
+ * return -1 on failure.
+ * return 0 on success.
+ */
+int send_packet_tcp_connection(const TCP_Connections *tcp_c, int connections_number, const uint8_t *packet,
+                               uint16_t length)
+{
+    return send_packet_tcp_connection_to(tcp_c, connections_number, packet, length, false);
+}
+
+int send_bulk_packet_tcp_connection(const TCP_Connections *tcp_c, int connections_number, const uint8_t *packet,
+                                    uint16_t length)
+{
+    return send_packet_tcp_connection_to(tcp_c, connections_number, packet, length, true);
+}
+
 /** @brief Return a TCP connection number for use in send_tcp_onion_request.
  *
  * TODO(irungentoo): This number is just the index of an array that the elements
@@ -887,7 +1054,7 @@ static uint32_t online_tcp_connection_from_conn(const TCP_Connection_to *_Nonnul
  * @return index on success.
  * @retval -1 on failure.
  */
-static int set_tcp_connection_status(TCP_Connection_to *_Nonnull con_to, unsigned int tcp_connections_number, uint8_t status, uint8_t connection_id)
+static int set_tcp_connection_status(TCP_Connection_to *_Nonnull con_to, unsigned int tcp_connections_number, uint8_t status, uint16_t connection_id)
 {
     for (uint32_t i = 0; i < MAX_FRIEND_TCP_CONNECTIONS; ++i) {
         if (con_to->connections[i].tcp_connection == (tcp_connections_number + 1)) {
@@ -1091,7 +1258,7 @@ static int send_tcp_relay_routing_request(const TCP_Connections *_Nonnull tcp_c,
     return 0;
 }
 
-static int tcp_response_callback(void *_Nonnull object, uint8_t connection_id, const uint8_t *_Nonnull public_key)
+static int tcp_response_callback(void *_Nonnull object, uint32_t connection_id, const uint8_t *_Nonnull public_key)
 {
     const TCP_Client_Connection *tcp_client_con = (const TCP_Client_Connection *)object;
     const TCP_Connections *tcp_c = (const TCP_Connections *)tcp_con_custom_object(tcp_client_con);
@@ -1128,7 +1295,7 @@ static int tcp_response_callback(void *_Nonnull object, uint8_t connection_id, c
     return 0;
 }
 
-static int tcp_status_callback(void *_Nonnull object, uint32_t number, uint8_t connection_id, uint8_t status)
+static int tcp_status_callback(void *_Nonnull object, uint32_t number, uint32_t connection_id, uint8_t status)
 {
     const TCP_Client_Connection *tcp_client_con = (const TCP_Client_Connection *)object;
     const TCP_Connections *tcp_c = (const TCP_Connections *)tcp_con_custom_object(tcp_client_con);
@@ -1166,7 +1333,7 @@ static int tcp_status_callback(void *_Nonnull object, uint32_t number, uint8_t c
     return 0;
 }
 
-static int tcp_conn_data_callback(void *_Nonnull object, uint32_t number, uint8_t connection_id, const uint8_t *_Nonnull data,
+static int tcp_conn_data_callback(void *_Nonnull object, uint32_t number, uint32_t connection_id, const uint8_t *_Nonnull data,
                                   uint16_t length, void *_Nullable userdata)
 {
     const TCP_Client_Connection *tcp_client_con = (TCP_Client_Connection *)object;
@@ -1647,6 +1814,7 @@ TCP_Connections *new_tcp_connections(const Logger *logger, const Memory *mem, co
     memcpy(temp->self_secret_key, secret_key, CRYPTO_SECRET_KEY_SIZE);
     crypto_derive_public_key(temp->self_public_key, temp->self_secret_key);
     temp->proxy_info = *proxy_info;
+    temp->relay_selection = TCP_RELAY_SELECTION_FASTEST;
 
     return temp;
 }
@@ -1753,6 +1921,50 @@ void do_tcp_connections(const Logger *logger, TCP_Connections *tcp_c, void *user
     kill_nonused_tcp(tcp_c);
 }
 
+uint64_t tcp_connections_next_deadline(const TCP_Connections *tcp_c)
+{
+    const uint64_t poll = mono_time_get_ms(tcp_c->mono_time) + DEADLINE_POLL_INTERVAL;
+    const bool kill_unused = tcp_c->tcp_connections_length > RECOMMENDED_FRIEND_TCP_CONNECTIONS
+                             && tcp_connected_relays_count(tcp_c) > RECOMMENDED_FRIEND_TCP_CONNECTIONS;
+    uint64_t due = DEADLINE_NEVER;
+
+    for (uint32_t i = 0; i < tcp_c->tcp_connections_length; ++i) {
+        const TCP_con *tcp_con = &tcp_c->tcp_connections[i];
+
+        if (tcp_con->status == TCP_CONN_NONE) {
+            continue;
+        }
+
+        if (tcp_con->status == TCP_CONN_SLEEPING) {
+            if (tcp_con->unsleep) {
+                due = deadline_min(due, poll);
+            }
+
+            continue;
+        }
+
+        if (tcp_con->connection == nullptr) {
+            continue;
+        }
+
+        due = deadline_min(due, tcp_con_next_deadline(tcp_con->connection, tcp_c->mono_time));
+
+        if (tcp_con->status != TCP_CONN_CONNECTED || tcp_con->onion) {
+            continue;
+        }
+
+        // See do_tcp_conns and kill_nonused_tcp.
+        const bool will_sleep = tcp_con->lock_count > 0 && tcp_con->lock_count == tcp_con->sleep_count;
+        const bool will_kill = tcp_con->lock_count == 0 && kill_unused;
+
+        if (will_sleep || will_kill) {
+            due = deadline_min(due, deadline_from_seconds(tcp_con->connected_time, TCP_CONNECTION_ANNOUNCE_TIMEOUT));
+        }
+    }
+
+    return due;
+}
+
 void kill_tcp_connections(TCP_Connections *tcp_c)
 {
     if (tcp_c == nullptr) {
@@ -1770,3 +1982,21 @@ void kill_tcp_connections(TCP_Connections *tcp_c)
     mem_delete(tcp_c->mem, tcp_c);
 }
 
+void tcp_testonly_send_order(TCP_Relay_Selection selection, bool bulk, TCP_Conn_to *conns,
+                             const uint32_t *rtts, uint32_t count, uint32_t *order)
+{
+    TCP_Send_Candidate candidates[MAX_FRIEND_TCP_CONNECTIONS];
+    count = min_u32(count, MAX_FRIEND_TCP_CONNECTIONS);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        tcp_add_send_candidate(candidates, i, &conns[i], rtts[i], selection != TCP_RELAY_SELECTION_FIRST);
+    }
+
+    if (bulk && selection == TCP_RELAY_SELECTION_STRIPED) {
+        tcp_stripe_candidates(candidates, count);
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        order[i] = (uint32_t)(candidates[i].conn_to - conns);
+    }
+}
@@ -26,6 +26,10 @@
 #include "network.h"
 #include "rng.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define TCP_CONN_NONE 0
 #define TCP_CONN_VALID 1
 
@@ -55,7 +59,10 @@
 typedef struct TCP_Conn_to {
     uint32_t tcp_connection;
     uint8_t status;
-    uint8_t connection_id;
+    uint16_t connection_id;
+
+    /* Weighted round robin credit for striping bulk data over relays. */
+    int32_t stripe_credit;
 } TCP_Conn_to;
 
 typedef struct TCP_Connection_to {
@@ -83,6 +90,16 @@ typedef struct TCP_con {
 
 typedef struct TCP_Connections TCP_Connections;
 
+/** @brief How packets to a peer pick one of the relays the peer is online on. */
+typedef enum TCP_Relay_Selection {
+    /** The first online relay in the order the relays were added. */
+    TCP_RELAY_SELECTION_FIRST,
+    /** The online relay with the lowest ping RTT. */
+    TCP_RELAY_SELECTION_FASTEST,
+    /** As FASTEST, but bulk data is spread over all relays with a similar RTT. */
+    TCP_RELAY_SELECTION_STRIPED,
+} TCP_Relay_Selection;
+
 const uint8_t *_Nonnull tcp_connections_public_key(const TCP_Connections *_Nonnull tcp_c);
 
 uint32_t tcp_connections_count(const TCP_Connections *_Nonnull tcp_c);
@@ -93,6 +110,20 @@ uint32_t tcp_connected_relays_count(const TCP_Connections *_Nonnull tcp_c);
 /** @brief Returns true if we know of a valid TCP relay with the passed public key. */
 bool tcp_relay_is_valid(const TCP_Connections *_Nonnull tcp_c, const uint8_t *_Nonnull relay_pk);
 
+void tcp_connections_set_relay_selection(TCP_Connections *_Nonnull tcp_c, TCP_Relay_Selection selection);
+
+/** @brief Returns the smoothed RTT in ms to the relay, or 0 if it is not connected or not measured yet. */
+uint32_t tcp_relay_rtt(const TCP_Connections *_Nonnull tcp_c, uint32_t tcp_connections_number);
+
+/** @brief Returns the bytes of peer data sent through the relay since we connected to it. */
+uint64_t tcp_relay_bytes_sent(const TCP_Connections *_Nonnull tcp_c, uint32_t tcp_connections_number);
+
+/** @brief Copy the public key of the relay, also while it is sleeping.
+ *
+ * @retval false if the slot holds no relay.
+ */
+bool tcp_relay_public_key(const TCP_Connections *_Nonnull tcp_c, uint32_t tcp_connections_number, uint8_t *_Nonnull public_key);
+
 /** @brief Send a packet to the TCP connection.
  *
  * return -1 on failure.
@@ -100,6 +131,17 @@ bool tcp_relay_is_valid(const TCP_Connections *_Nonnull tcp_c, const uint8_t *_N
  */
 int send_packet_tcp_connection(const TCP_Connections *_Nonnull tcp_c, int connections_number, const uint8_t *_Nonnull packet, uint16_t length);
 
+/** @brief Send a bulk data packet to the TCP connection.
+ *
+ * Same as send_packet_tcp_connection, except that with TCP_RELAY_SELECTION_STRIPED
+ * consecutive packets are spread over the online relays in proportion to
+ * their speed.
+ *
+ * return -1 on failure.
+ * return 0 on success.
+ */
+int send_bulk_packet_tcp_connection(const TCP_Connections *_Nonnull tcp_c, int connections_number, const uint8_t *_Nonnull packet, uint16_t length);
+
 /** @brief Return a TCP connection number for use in send_tcp_onion_request.
  *
  * TODO(irungentoo): This number is just the index of an array that the elements
@@ -277,5 +319,26 @@ TCP_Connections *_Nullable new_tcp_connections(const Logger *_Nonnull logger, co
 int kill_tcp_relay_connection(TCP_Connections *_Nonnull tcp_c, int tcp_connections_number);
 
 void do_tcp_connections(const Logger *_Nonnull logger, TCP_Connections *_Nonnull tcp_c, void *_Nullable userdata);
+
+/**
+ * @brief When `do_tcp_connections` next has work to do, in milliseconds on
+ *   the `mono_time_get_ms` clock.
+ */
+uint64_t tcp_connections_next_deadline(const TCP_Connections *_Nonnull tcp_c);
 void kill_tcp_connections(TCP_Connections *_Nullable tcp_c);
+
+/** Unit test support functions. Do not use outside tests. */
+/** @brief Order relays the way a packet to a peer online on all of them tries them.
+ *
+ * `rtts[i]` is the RTT of `conns[i]`, 0 if not measured. The indices into
+ * `conns` are written to `order` in the order the relays are tried. Striping
+ * updates the credit in `conns`, so consecutive calls spread bulk packets.
+ */
+void tcp_testonly_send_order(TCP_Relay_Selection selection, bool bulk, TCP_Conn_to *_Nonnull conns,
+                             const uint32_t *_Nonnull rtts, uint32_t count, uint32_t *_Nonnull order);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
 #endif /* C_TOXCORE_TOXCORE_TCP_CONNECTION_H */
@@ -2,9 +2,92 @@
 
 #include <gtest/gtest.h>
 
+#include <array>
+#include <cstdint>
+
 namespace {
 
 // TODO(Jfreegman) make this useful or remove it after NGC is merged
 TEST(TCP_connection, NullTest) { (void)&tcp_send_oob_packet_using_relay; }
 
+template <std::size_t N>
+std::array<std::uint32_t, N> send_order(TCP_Relay_Selection selection, bool bulk,
+    std::array<TCP_Conn_to, N> &conns, const std::array<std::uint32_t, N> &rtts)
+{
+    std::array<std::uint32_t, N> order{};
+    tcp_testonly_send_order(selection, bulk, conns.data(), rtts.data(), N, order.data());
+    return order;
+}
+
+TEST(TCP_connection, FirstSelectionKeepsSlotOrder)
+{
+    std::array<TCP_Conn_to, 3> conns{};
+    const std::array<std::uint32_t, 3> rtts{90, 10, 50};
+    EXPECT_EQ(send_order(TCP_RELAY_SELECTION_FIRST, false, conns, rtts),
+        (std::array<std::uint32_t, 3>{0, 1, 2}));
+}
+
+TEST(TCP_connection, UnmeasuredRelaysAreTriedLast)
+{
+    std::array<TCP_Conn_to, 4> conns{};
+    const std::array<std::uint32_t, 4> rtts{0, 50, 0, 20};
+    EXPECT_EQ(send_order(TCP_RELAY_SELECTION_FASTEST, false, conns, rtts),
+        (std::array<std::uint32_t, 4>{3, 1, 0, 2}));
+}
+
+TEST(TCP_connection, EqualRttsKeepSlotOrder)
+{
+    std::array<TCP_Conn_to, 4> conns{};
+    const std::array<std::uint32_t, 4> rtts{30, 20, 30, 20};
+    EXPECT_EQ(send_order(TCP_RELAY_SELECTION_FASTEST, false, conns, rtts),
+        (std::array<std::uint32_t, 4>{1, 3, 0, 2}));
+}
+
+TEST(TCP_connection, NonBulkPacketsAreNotStriped)
+{
+    std::array<TCP_Conn_to, 2> conns{};
+    const std::array<std::uint32_t, 2> rtts{100, 100};
+
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(send_order(TCP_RELAY_SELECTION_STRIPED, false, conns, rtts),
+            (std::array<std::uint32_t, 2>{0, 1}));
+    }
+}
+
+TEST(TCP_connection, SlowRelaysGetNoStripeShare)
+{
+    std::array<TCP_Conn_to, 4> conns{};
+    // 150 is exactly 1.5 times the best RTT and still takes part.
+    const std::array<std::uint32_t, 4> rtts{151, 100, 0, 150};
+    std::array<std::uint32_t, 4> first{};
+
+    for (int i = 0; i < 1000; ++i) {
+        const auto order = send_order(TCP_RELAY_SELECTION_STRIPED, true, conns, rtts);
+        ++first[order[0]];
+    }
+
+    EXPECT_EQ(first[0], 0);
+    EXPECT_GT(first[1], 0);
+    EXPECT_EQ(first[2], 0);
+    EXPECT_GT(first[3], 0);
+}
+
+TEST(TCP_connection, StripeSplitFollowsInverseRtt)
+{
+    std::array<TCP_Conn_to, 2> conns{};
+    // Weights 1000 and 800: 5 of every 9 packets go to the faster relay.
+    const std::array<std::uint32_t, 2> rtts{125, 100};
+    std::array<std::uint32_t, 2> first{};
+
+    for (int i = 0; i < 900; ++i) {
+        const auto order = send_order(TCP_RELAY_SELECTION_STRIPED, true, conns, rtts);
+        ++first[order[0]];
+        // The other relay stays next in line in case the chosen one is full.
+        EXPECT_NE(order[1], order[0]);
+    }
+
+    EXPECT_EQ(first[0], 400);
+    EXPECT_EQ(first[1], 500);
+}
+
 }  // namespace
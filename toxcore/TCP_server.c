@@ -30,6 +30,7 @@
 #include "net_profile.h"
 #include "network.h"
 #include "onion.h"
+#include "util.h"
 
 #ifdef TCP_SERVER_USE_EPOLL
 #define TCP_SOCKET_LISTENING 0
@@ -43,7 +44,7 @@ typedef struct TCP_Secure_Conn {
     uint32_t index;
     // TODO(iphydf): Add an enum for this (same as in TCP_client.c, probably).
     uint8_t status; /* 0 if not used, 1 if other is offline, 2 if other is online. */
-    uint8_t other_id;
+    uint32_t other_id;
 } TCP_Secure_Conn;
 
 typedef struct TCP_Secure_Connection {
@@ -52,7 +53,14 @@ typedef struct TCP_Secure_Connection {
     uint8_t public_key[CRYPTO_PUBLIC_KEY_SIZE];
     uint8_t recv_nonce[CRYPTO_NONCE_SIZE]; /* Nonce of received packets. */
     uint16_t next_packet_length;
-    TCP_Secure_Conn connections[NUM_CLIENT_CONNECTIONS];
+    /* Indexed by the connection id the client uses, grown on demand. */
+    TCP_Secure_Conn *_Nullable connections;
+    uint32_t connections_length;
+    /* Connection id of each used slot by the peer's public key. */
+    BS_List key_list;
+    /* No slot below this connection id is free. */
+    uint32_t first_free;
+    bool wide_ids; /* The client negotiated TCP_EXTENSION_WIDE_IDS. */
     uint8_t status;
 
     uint64_t identifier;
@@ -92,6 +100,8 @@ struct TCP_Server {
     uint64_t counter;
 
     BS_List accepted_key_list;
+    /* Connection slots beyond NUM_CLIENT_CONNECTIONS, summed over all accepted connections. */
+    uint32_t num_wide_slots;
 
     /* Network profile for all TCP server packets. */
     Net_Profile *_Nullable net_profile;
@@ -110,6 +120,25 @@ size_t tcp_server_listen_count(const TCP_Server *tcp_server)
     return tcp_server->num_listening_socks;
 }
 
+uint32_t tcp_server_num_connections(const TCP_Server *tcp_server)
+{
+    return tcp_server->num_accepted_connections;
+}
+
+uint64_t tcp_server_accepted_count(const TCP_Server *tcp_server)
+{
+    return tcp_server->counter;
+}
+
+Socket tcp_server_event_socket(const TCP_Server *tcp_server)
+{
+#ifdef TCP_SERVER_USE_EPOLL
+    return net_socket_from_native(tcp_server->efd);
+#else
+    return net_invalid_socket();
+#endif /* TCP_SERVER_USE_EPOLL */
+}
+
 /** This is needed to compile on Android below API 21 */
 #ifdef TCP_SERVER_USE_EPOLL
 #ifndef EPOLLRDHUP
@@ -152,10 +181,65 @@ static void wipe_secure_connection(TCP_Secure_Connection *_Nonnull con)
 {
     if (con->status != 0) {
         wipe_priority_list(con->con.mem, con->con.priority_queue_start);
+        mem_delete(con->con.mem, con->connections);
+
+        if (con->status == TCP_STATUS_CONFIRMED) {
+            bs_list_free(&con->key_list);
+        }
+
         crypto_memzero(con, sizeof(TCP_Secure_Connection));
     }
 }
 
+/** @brief Returns the number of connection ids the client may use. */
+static uint32_t max_client_connections(const TCP_Secure_Connection *_Nonnull con)
+{
+    return con->wide_ids ? NUM_WIDE_CLIENT_CONNECTIONS : NUM_CLIENT_CONNECTIONS;
+}
+
+/** @brief Returns how many of `length` slots count towards TCP_SERVER_MAX_WIDE_SLOTS. */
+static uint32_t wide_slots(uint32_t length)
+{
+    return length > NUM_CLIENT_CONNECTIONS ? length - NUM_CLIENT_CONNECTIONS : 0;
+}
+
+/** @brief Grow the connections array of con so that it has a free slot.
+ *
+ * @return the index of the first new slot, or -1 if the client or the server
+ *   is at its limit or allocation failed.
+ */
+static int64_t grow_client_connections(TCP_Server *_Nonnull tcp_server, TCP_Secure_Connection *_Nonnull con)
+{
+    const uint32_t max = max_client_connections(con);
+    const uint32_t old_length = con->connections_length;
+
+    if (old_length >= max) {
+        return -1;
+    }
+
+    const uint32_t new_length = min_u32(max, max_u32(old_length * 2, 8));
+    const uint32_t added_wide_slots = wide_slots(new_length) - wide_slots(old_length);
+
+    if (added_wide_slots > TCP_SERVER_MAX_WIDE_SLOTS - tcp_server->num_wide_slots) {
+        LOGGER_DEBUG(tcp_server->logger, "connection %u: no wide connection ids left on this relay",
+                     (unsigned int)con->identifier);
+        return -1;
+    }
+
+    TCP_Secure_Conn *new_connections = (TCP_Secure_Conn *)mem_vrealloc(
+                                           con->con.mem, con->connections, new_length, sizeof(TCP_Secure_Conn));
+
+    if (new_connections == nullptr) {
+        return -1;
+    }
+
+    memset(&new_connections[old_length], 0, (new_length - old_length) * sizeof(TCP_Secure_Conn));
+    con->connections = new_connections;
+    con->connections_length = new_length;
+    tcp_server->num_wide_slots += added_wide_slots;
+    return old_length;
+}
+
 static void move_secure_connection(TCP_Secure_Connection *_Nonnull con_new, TCP_Secure_Connection *_Nonnull con_old)
 {
     *con_new = *con_old;
@@ -228,6 +312,9 @@ static int add_accepted(TCP_Server *_Nonnull tcp_server, const Mono_Time *_Nonnu
 
     move_secure_connection(&tcp_server->accepted_connection_array[index], con);
 
+    // Starts empty, so this can't fail.
+    bs_list_init(&tcp_server->accepted_connection_array[index].key_list, tcp_server->mem, CRYPTO_PUBLIC_KEY_SIZE, 0, memcmp);
+    tcp_server->accepted_connection_array[index].first_free = 0;
     tcp_server->accepted_connection_array[index].status = TCP_STATUS_CONFIRMED;
     ++tcp_server->num_accepted_connections;
     tcp_server->accepted_connection_array[index].identifier = ++tcp_server->counter;
@@ -257,6 +344,7 @@ static int del_accepted(TCP_Server *_Nonnull tcp_server, int index)
         return -1;
     }
 
+    tcp_server->num_wide_slots -= wide_slots(tcp_server->accepted_connection_array[index].connections_length);
     wipe_secure_connection(&tcp_server->accepted_connection_array[index]);
     --tcp_server->num_accepted_connections;
 
@@ -278,7 +366,7 @@ static void kill_tcp_secure_connection(TCP_Secure_Connection *_Nullable con)
     wipe_secure_connection(con);
 }
 
-static int rm_connection_index(TCP_Server *_Nonnull tcp_server, TCP_Secure_Connection *_Nonnull con, uint8_t con_number);
+static int rm_connection_index(TCP_Server *_Nonnull tcp_server, TCP_Secure_Connection *_Nonnull con, uint32_t con_number);
 
 /** @brief Kill an accepted TCP_Secure_Connection
  *
@@ -291,7 +379,7 @@ static int kill_accepted(TCP_Server *tcp_server, int index)
         return -1;
     }
 
-    for (uint32_t i = 0; i < NUM_CLIENT_CONNECTIONS; ++i) {
+    for (uint32_t i = 0; i < tcp_server->accepted_connection_array[index].connections_length; ++i) {
         rm_connection_index(tcp_server, &tcp_server->accepted_connection_array[index], i);
     }
 
@@ -390,14 +478,23 @@ static int read_connection_handshake(const Logger *_Nonnull logger, TCP_Secure_C
  * @retval 0 if could not send packet.
  * @retval -1 on failure (connection must be killed).
  */
-static int send_routing_response(const Logger *_Nonnull logger, TCP_Secure_Connection *_Nonnull con, uint8_t rpid, const uint8_t *_Nonnull public_key)
+static int send_routing_response(const Logger *_Nonnull logger, TCP_Secure_Connection *_Nonnull con, bool accepted, uint32_t id,
+                                 const uint8_t *_Nonnull public_key)
 {
-    uint8_t data[2 + CRYPTO_PUBLIC_KEY_SIZE];
-    data[0] = TCP_PACKET_ROUTING_RESPONSE;
-    data[1] = rpid;
-    memcpy(data + 2, public_key, CRYPTO_PUBLIC_KEY_SIZE);
+    uint8_t data[1 + 2 + CRYPTO_PUBLIC_KEY_SIZE] = {TCP_PACKET_ROUTING_RESPONSE};
+    uint16_t length = 1;
+
+    if (accepted) {
+        length += tcp_pack_con_id(data + length, id, con->wide_ids);
+    } else {
+        /* Zero is below NUM_RESERVED_PORTS, so it's not an id. */
+        length += tcp_con_id_size(con->wide_ids);
+    }
 
-    return write_packet_tcp_secure_connection(logger, &con->con, data, sizeof(data), true);
+    memcpy(data + length, public_key, CRYPTO_PUBLIC_KEY_SIZE);
+    length += CRYPTO_PUBLIC_KEY_SIZE;
+
+    return write_packet_tcp_secure_connection(logger, &con->con, data, length, true);
 }
 
 /**
@@ -405,10 +502,11 @@ static int send_routing_response(const Logger *_Nonnull logger, TCP_Secure_Conne
  * @retval 0 if could not send packet.
  * @retval -1 on failure (connection must be killed).
  */
-static int send_connect_notification(const Logger *_Nonnull logger, TCP_Secure_Connection *_Nonnull con, uint8_t id)
+static int send_connect_notification(const Logger *_Nonnull logger, TCP_Secure_Connection *_Nonnull con, uint32_t id)
 {
-    uint8_t data[2] = {TCP_PACKET_CONNECTION_NOTIFICATION, (uint8_t)(id + NUM_RESERVED_PORTS)};
-    return write_packet_tcp_secure_connection(logger, &con->con, data, sizeof(data), true);
+    uint8_t data[1 + 2] = {TCP_PACKET_CONNECTION_NOTIFICATION};
+    const uint16_t length = 1 + tcp_pack_con_id(data + 1, id, con->wide_ids);
+    return write_packet_tcp_secure_connection(logger, &con->con, data, length, true);
 }
 
 /**
@@ -416,10 +514,41 @@ static int send_connect_notification(const Logger *_Nonnull logger, TCP_Secure_C
  * @retval 0 if could not send packet.
  * @retval -1 on failure (connection must be killed).
  */
-static int send_disconnect_notification(const Logger *_Nonnull logger, TCP_Secure_Connection *_Nonnull con, uint8_t id)
+static int send_disconnect_notification(const Logger *_Nonnull logger, TCP_Secure_Connection *_Nonnull con, uint32_t id)
 {
-    uint8_t data[2] = {TCP_PACKET_DISCONNECT_NOTIFICATION, (uint8_t)(id + NUM_RESERVED_PORTS)};
-    return write_packet_tcp_secure_connection(logger, &con->con, data, sizeof(data), true);
+    uint8_t data[1 + 2] = {TCP_PACKET_DISCONNECT_NOTIFICATION};
+    const uint16_t length = 1 + tcp_pack_con_id(data + 1, id, con->wide_ids);
+    return write_packet_tcp_secure_connection(logger, &con->con, data, length, true);
+}
+
+/** @brief Answer a request for protocol extensions with the ones we enabled.
+ *
+ * Extensions change the packet formats, so they are only enabled before the
+ * client routes to anyone.
+ *
+ * @retval 0 on success.
+ * @retval -1 on failure (connection must be killed).
+ */
+static int handle_tcp_extensions_req(const Logger *_Nonnull logger, TCP_Secure_Connection *_Nonnull con, uint8_t requested)
+{
+    uint8_t enabled = con->wide_ids ? TCP_EXTENSION_WIDE_IDS : 0;
+
+    if (con->connections_length == 0) {
+        enabled = requested & TCP_EXTENSION_WIDE_IDS;
+    }
+
+    const uint8_t data[2] = {TCP_PACKET_EXTENSIONS, enabled};
+    const int ret = write_packet_tcp_secure_connection(logger, &con->con, data, sizeof(data), true);
+
+    if (ret == -1) {
+        return -1;
+    }
+
+    if (ret == 1) {
+        con->wide_ids = (enabled & TCP_EXTENSION_WIDE_IDS) != 0;
+    }
+
+    return 0;
 }
 
 /**
@@ -428,67 +557,66 @@ static int send_disconnect_notification(const Logger *_Nonnull logger, TCP_Secur
  */
 static int handle_tcp_routing_req(TCP_Server *_Nonnull tcp_server, uint32_t con_id, const uint8_t *_Nonnull public_key)
 {
-    uint32_t index = -1;
     TCP_Secure_Connection *con = &tcp_server->accepted_connection_array[con_id];
 
+    uint8_t extensions;
+
+    if (tcp_is_extensions_key(public_key, &extensions)) {
+        return handle_tcp_extensions_req(tcp_server->logger, con, extensions);
+    }
+
     /* If person tries to cennect to himself we deny the request*/
     if (pk_equal(con->public_key, public_key)) {
-        if (send_routing_response(tcp_server->logger, con, 0, public_key) == -1) {
+        if (send_routing_response(tcp_server->logger, con, false, 0, public_key) == -1) {
             return -1;
         }
 
         return 0;
     }
 
-    for (uint32_t i = 0; i < NUM_CLIENT_CONNECTIONS; ++i) {
-        if (con->connections[i].status != 0) {
-            if (pk_equal(public_key, con->connections[i].public_key)) {
-                if (send_routing_response(tcp_server->logger, con, i + NUM_RESERVED_PORTS, public_key) == -1) {
-                    return -1;
-                }
-
-                return 0;
-            }
-        } else if (index == (uint32_t) -1) {
-            index = i;
-        }
-    }
+    const int existing = bs_list_find(&con->key_list, public_key);
 
-    if (index == (uint32_t) -1) {
-        if (send_routing_response(tcp_server->logger, con, 0, public_key) == -1) {
+    if (existing != -1) {
+        if (send_routing_response(tcp_server->logger, con, true, (uint32_t)existing, public_key) == -1) {
             return -1;
         }
 
         return 0;
     }
 
-    const int ret = send_routing_response(tcp_server->logger, con, index + NUM_RESERVED_PORTS, public_key);
+    uint32_t index = con->first_free;
+
+    while (index < con->connections_length && con->connections[index].status != 0) {
+        ++index;
+    }
+
+    const bool has_slot = index < con->connections_length || grow_client_connections(tcp_server, con) != -1;
+
+    if (!has_slot || !bs_list_add(&con->key_list, public_key, (int)index)) {
+        if (send_routing_response(tcp_server->logger, con, false, 0, public_key) == -1) {
+            return -1;
+        }
 
-    if (ret == 0) {
         return 0;
     }
 
-    if (ret == -1) {
-        return -1;
+    const int ret = send_routing_response(tcp_server->logger, con, true, index, public_key);
+
+    if (ret != 1) {
+        bs_list_remove(&con->key_list, public_key, (int)index);
+        return ret;
     }
 
     con->connections[index].status = 1;
     memcpy(con->connections[index].public_key, public_key, CRYPTO_PUBLIC_KEY_SIZE);
+    con->first_free = index + 1;
     const int other_index = get_tcp_connection_index(tcp_server, public_key);
 
     if (other_index != -1) {
-        uint32_t other_id = -1;
         TCP_Secure_Connection *other_conn = &tcp_server->accepted_connection_array[other_index];
+        const int other_id = bs_list_find(&other_conn->key_list, con->public_key);
 
-        for (uint32_t i = 0; i < NUM_CLIENT_CONNECTIONS; ++i) {
-            if (other_conn->connections[i].status == 1
-                    && pk_equal(other_conn->connections[i].public_key, con->public_key)) {
-                other_id = i;
-                break;
-            }
-        }
-
-        if (other_id != (uint32_t) -1) {
+        if (other_id != -1 && other_conn->connections[other_id].status == 1) {
             con->connections[index].status = 2;
             con->connections[index].index = other_index;
             con->connections[index].other_id = other_id;
@@ -536,18 +664,19 @@ static int handle_tcp_oob_send(TCP_Server *_Nonnull tcp_server, uint32_t con_id,
  * return -1 on failure.
  * return 0 on success.
  */
-static int rm_connection_index(TCP_Server *tcp_server, TCP_Secure_Connection *con, uint8_t con_number)
+static int rm_connection_index(TCP_Server *tcp_server, TCP_Secure_Connection *con, uint32_t con_number)
 {
-    if (con_number >= NUM_CLIENT_CONNECTIONS) {
+    if (con_number >= con->connections_length) {
         return -1;
     }
 
     if (con->connections[con_number].status != 0) {
         if (con->connections[con_number].status == 2) {
             const uint32_t index = con->connections[con_number].index;
-            const uint8_t other_id = con->connections[con_number].other_id;
+            const uint32_t other_id = con->connections[con_number].other_id;
 
-            if (index >= tcp_server->size_accepted_connections) {
+            if (index >= tcp_server->size_accepted_connections
+                    || other_id >= tcp_server->accepted_connection_array[index].connections_length) {
                 return -1;
             }
 
@@ -558,6 +687,8 @@ static int rm_connection_index(TCP_Server *tcp_server, TCP_Secure_Connection *co
             send_disconnect_notification(tcp_server->logger, &tcp_server->accepted_connection_array[index], other_id);
         }
 
+        bs_list_remove(&con->key_list, con->connections[con_number].public_key, (int)con_number);
+        con->first_free = min_u32(con->first_free, con_number);
         con->connections[con_number].index = 0;
         con->connections[con_number].other_id = 0;
         con->connections[con_number].status = 0;
@@ -677,7 +808,7 @@ static int handle_tcp_packet(TCP_Server *_Nonnull tcp_server, uint32_t con_id, c
         }
 
         case TCP_PACKET_CONNECTION_NOTIFICATION: {
-            if (length != 2) {
+            if (length != 1 + tcp_con_id_size(con->wide_ids)) {
                 return -1;
             }
 
@@ -686,12 +817,15 @@ static int handle_tcp_packet(TCP_Server *_Nonnull tcp_server, uint32_t con_id, c
         }
 
         case TCP_PACKET_DISCONNECT_NOTIFICATION: {
-            if (length != 2) {
+            uint32_t c_id;
+
+            if (length != 1 + tcp_con_id_size(con->wide_ids)
+                    || tcp_unpack_con_id(data + 1, length - 1, con->wide_ids, &c_id) == 0) {
                 return -1;
             }
 
             LOGGER_TRACE(tcp_server->logger, "handling disconnect notification for %u", con_id);
-            return rm_connection_index(tcp_server, con, data[1] - NUM_RESERVED_PORTS);
+            return rm_connection_index(tcp_server, con, c_id);
         }
 
         case TCP_PACKET_PING: {
@@ -790,19 +924,22 @@ static int handle_tcp_packet(TCP_Server *_Nonnull tcp_server, uint32_t con_id, c
             return 0;
         }
 
-        case TCP_PACKET_FORWARDING: {
+        case TCP_PACKET_FORWARDING:
+        case TCP_PACKET_EXTENSIONS: {
             return -1;
         }
 
         default: {
-            if (data[0] < NUM_RESERVED_PORTS) {
+            uint32_t c_id;
+            const uint16_t header_length = tcp_unpack_con_id(data, length, con->wide_ids, &c_id);
+
+            if (header_length == 0) {
                 return -1;
             }
 
-            const uint8_t c_id = data[0] - NUM_RESERVED_PORTS;
             LOGGER_TRACE(tcp_server->logger, "handling packet id %u for %u", c_id, con_id);
 
-            if (c_id >= NUM_CLIENT_CONNECTIONS) {
+            if (c_id >= con->connections_length) {
                 return -1;
             }
 
@@ -814,13 +951,23 @@ static int handle_tcp_packet(TCP_Server *_Nonnull tcp_server, uint32_t con_id, c
                 return 0;
             }
 
-            const uint32_t index = con->connections[c_id].index;
-            const uint8_t other_c_id = con->connections[c_id].other_id + NUM_RESERVED_PORTS;
-            VLA(uint8_t, new_data, length);
-            memcpy(new_data, data, length);
-            new_data[0] = other_c_id;
+            TCP_Secure_Connection *other_conn = &tcp_server->accepted_connection_array[con->connections[c_id].index];
+            const uint16_t payload_length = length - header_length;
+
+            // The two ends may use different id sizes.
+            VLA(uint8_t, new_data, 2 + payload_length);
+            const uint16_t new_header_length = tcp_pack_con_id(new_data, con->connections[c_id].other_id, other_conn->wide_ids);
+
+            if (new_header_length + payload_length + CRYPTO_MAC_SIZE > MAX_PACKET_SIZE) {
+                // The sender's largest packets don't fit once their id grows
+                // to two bytes. That's no reason to drop the sender.
+                LOGGER_TRACE(tcp_server->logger, "dropping packet for %u: too large for a wide id", c_id);
+                return 0;
+            }
+
+            memcpy(new_data + new_header_length, data + header_length, payload_length);
             const int ret = write_packet_tcp_secure_connection(tcp_server->logger,
-                            &tcp_server->accepted_connection_array[index].con, new_data, length, false);
+                            &other_conn->con, new_data, new_header_length + payload_length, false);
 
             if (ret == -1) {
                 return -1;
@@ -34,6 +34,15 @@ extern "C" {
 
 #define ARRAY_ENTRY_SIZE 6
 
+/** @brief Connection ids beyond NUM_CLIENT_CONNECTIONS that all clients of a
+ * relay may use together.
+ *
+ * At about 100 bytes each, this bounds the memory wide ids cost the relay to
+ * about 25 MiB. Once it is reached, routing requests that need more ids are
+ * refused, but every client can still use NUM_CLIENT_CONNECTIONS.
+ */
+#define TCP_SERVER_MAX_WIDE_SLOTS (1 << 18)
+
 typedef enum TCP_Status {
     TCP_STATUS_NO_STATUS,
     TCP_STATUS_CONNECTED,
@@ -45,6 +54,19 @@ typedef struct TCP_Server TCP_Server;
 
 const uint8_t *_Nonnull tcp_server_public_key(const TCP_Server *_Nonnull tcp_server);
 size_t tcp_server_listen_count(const TCP_Server *_Nonnull tcp_server);
+/** @brief Number of clients that completed the handshake and are still connected. */
+uint32_t tcp_server_num_connections(const TCP_Server *_Nonnull tcp_server);
+/** @brief Number of connections that completed the handshake since the server started. */
+uint64_t tcp_server_accepted_count(const TCP_Server *_Nonnull tcp_server);
+
+/** @brief A socket that becomes readable when the server has sockets to service.
+ *
+ * This is the server's epoll descriptor, so an event loop can wait on it
+ * instead of calling `do_tcp_server` on a timer. Returns an invalid socket if
+ * the server was built without epoll. Either way, `do_tcp_server` must still
+ * run periodically to send pings and queued data.
+ */
+Socket tcp_server_event_socket(const TCP_Server *_Nonnull tcp_server);
 
 /** Create new TCP server instance. */
 TCP_Server *_Nullable new_tcp_server(const Logger *_Nonnull logger, const Memory *_Nonnull mem, const Random *_Nonnull rng, const Network *_Nonnull ns,
@@ -0,0 +1,158 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+#include "atomics.h"
+
+#ifndef TOX_ATOMICS_LOCK_FREE
+#include <pthread.h>
+#endif /* TOX_ATOMICS_LOCK_FREE */
+
+#ifdef TOX_ATOMICS_LOCK_FREE
+bool tox_atomic_bool_load(const Tox_Atomic_Bool *value)
+{
+    return atomic_load_explicit(value, memory_order_relaxed);
+}
+
+void tox_atomic_bool_store(Tox_Atomic_Bool *value, bool desired)
+{
+    atomic_store_explicit(value, desired, memory_order_relaxed);
+}
+
+uint32_t tox_atomic_u32_load(const Tox_Atomic_U32 *value)
+{
+    return atomic_load_explicit(value, memory_order_relaxed);
+}
+
+void tox_atomic_u32_store(Tox_Atomic_U32 *value, uint32_t desired)
+{
+    atomic_store_explicit(value, desired, memory_order_relaxed);
+}
+
+uint64_t tox_atomic_u64_load(const Tox_Atomic_U64 *value)
+{
+    return atomic_load_explicit(value, memory_order_relaxed);
+}
+
+void tox_atomic_u64_store(Tox_Atomic_U64 *value, uint64_t desired)
+{
+    atomic_store_explicit(value, desired, memory_order_relaxed);
+}
+
+void tox_atomic_u64_increment(Tox_Atomic_U64 *value)
+{
+    atomic_fetch_add_explicit(value, 1, memory_order_relaxed);
+}
+
+size_t tox_atomic_size_load(const Tox_Atomic_Size *value)
+{
+    return atomic_load_explicit(value, memory_order_relaxed);
+}
+
+size_t tox_atomic_size_load_acquire(const Tox_Atomic_Size *value)
+{
+    return atomic_load_explicit(value, memory_order_acquire);
+}
+
+void tox_atomic_size_store_release(Tox_Atomic_Size *value, size_t desired)
+{
+    atomic_store_explicit(value, desired, memory_order_release);
+}
+
+bool tox_atomic_size_compare_exchange(Tox_Atomic_Size *value, size_t *expected, size_t desired)
+{
+    return atomic_compare_exchange_weak_explicit(value, expected, desired,
+            memory_order_relaxed, memory_order_relaxed);
+}
+#else
+// One lock for all values. Taking and releasing it orders every access, so
+// this is at least as strong as any of the memory orders above.
+static pthread_mutex_t atomics_lock = PTHREAD_MUTEX_INITIALIZER;
+
+bool tox_atomic_bool_load(const Tox_Atomic_Bool *value)
+{
+    pthread_mutex_lock(&atomics_lock);
+    const bool result = *value;
+    pthread_mutex_unlock(&atomics_lock);
+    return result;
+}
+
+void tox_atomic_bool_store(Tox_Atomic_Bool *value, bool desired)
+{
+    pthread_mutex_lock(&atomics_lock);
+    *value = desired;
+    pthread_mutex_unlock(&atomics_lock);
+}
+
+uint32_t tox_atomic_u32_load(const Tox_Atomic_U32 *value)
+{
+    pthread_mutex_lock(&atomics_lock);
+    const uint32_t result = *value;
+    pthread_mutex_unlock(&atomics_lock);
+    return result;
+}
+
+void tox_atomic_u32_store(Tox_Atomic_U32 *value, uint32_t desired)
+{
+    pthread_mutex_lock(&atomics_lock);
+    *value = desired;
+    pthread_mutex_unlock(&atomics_lock);
+}
+
+uint64_t tox_atomic_u64_load(const Tox_Atomic_U64 *value)
+{
+    pthread_mutex_lock(&atomics_lock);
+    const uint64_t result = *value;
+    pthread_mutex_unlock(&atomics_lock);
+    return result;
+}
+
+void tox_atomic_u64_store(Tox_Atomic_U64 *value, uint64_t desired)
+{
+    pthread_mutex_lock(&atomics_lock);
+    *value = desired;
+    pthread_mutex_unlock(&atomics_lock);
+}
+
+void tox_atomic_u64_increment(Tox_Atomic_U64 *value)
+{
+    pthread_mutex_lock(&atomics_lock);
+    ++*value;
+    pthread_mutex_unlock(&atomics_lock);
+}
+
+size_t tox_atomic_size_load(const Tox_Atomic_Size *value)
+{
+    pthread_mutex_lock(&atomics_lock);
+    const size_t result = *value;
+    pthread_mutex_unlock(&atomics_lock);
+    return result;
+}
+
+size_t tox_atomic_size_load_acquire(const Tox_Atomic_Size *value)
+{
+    return tox_atomic_size_load(value);
+}
+
+void tox_atomic_size_store_release(Tox_Atomic_Size *value, size_t desired)
+{
+    pthread_mutex_lock(&atomics_lock);
+    *value = desired;
+    pthread_mutex_unlock(&atomics_lock);
+}
+
+bool tox_atomic_size_compare_exchange(Tox_Atomic_Size *value, size_t *expected, size_t desired)
+{
+    pthread_mutex_lock(&atomics_lock);
+    const bool equal = *value == *expected;
+
+    if (equal) {
+        *value = desired;
+    } else {
+        *expected = *value;
+    }
+
+    pthread_mutex_unlock(&atomics_lock);
+    return equal;
+}
+#endif /* TOX_ATOMICS_LOCK_FREE */
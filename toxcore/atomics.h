@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+/**
+ * Integers shared between threads.
+ */
+#ifndef C_TOXCORE_TOXCORE_ATOMICS_H
+#define C_TOXCORE_TOXCORE_ATOMICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "attributes.h"
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#if ATOMIC_BOOL_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_POINTER_LOCK_FREE == 2
+/**
+ * Defined when the operations below are single lock-free instructions. Without
+ * C11 atomics (older compilers and C++ builds of the C sources) or on targets
+ * without lock-free 64 bit atomics, every operation takes one process-wide
+ * mutex instead, so they are correct but slow and shouldn't be used in hot
+ * paths there.
+ */
+#define TOX_ATOMICS_LOCK_FREE 1
+#endif /* ATOMIC_*_LOCK_FREE */
+#endif /* C11 atomics */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef TOX_ATOMICS_LOCK_FREE
+typedef atomic_bool Tox_Atomic_Bool;
+typedef _Atomic(uint32_t) Tox_Atomic_U32;
+typedef _Atomic(uint64_t) Tox_Atomic_U64;
+typedef _Atomic(size_t) Tox_Atomic_Size;
+#else
+typedef bool Tox_Atomic_Bool;
+typedef uint32_t Tox_Atomic_U32;
+typedef uint64_t Tox_Atomic_U64;
+typedef size_t Tox_Atomic_Size;
+#endif /* TOX_ATOMICS_LOCK_FREE */
+
+/*
+ * Loads and stores only order the value itself (relaxed) unless their name
+ * says otherwise. Zeroed memory holds a valid 0 or false.
+ */
+
+bool tox_atomic_bool_load(const Tox_Atomic_Bool *_Nonnull value);
+void tox_atomic_bool_store(Tox_Atomic_Bool *_Nonnull value, bool desired);
+
+uint32_t tox_atomic_u32_load(const Tox_Atomic_U32 *_Nonnull value);
+void tox_atomic_u32_store(Tox_Atomic_U32 *_Nonnull value, uint32_t desired);
+
+uint64_t tox_atomic_u64_load(const Tox_Atomic_U64 *_Nonnull value);
+void tox_atomic_u64_store(Tox_Atomic_U64 *_Nonnull value, uint64_t desired);
+/** Add 1 to the value. */
+void tox_atomic_u64_increment(Tox_Atomic_U64 *_Nonnull value);
+
+size_t tox_atomic_size_load(const Tox_Atomic_Size *_Nonnull value);
+/** Load that no later memory access of this thread is moved before. */
+size_t tox_atomic_size_load_acquire(const Tox_Atomic_Size *_Nonnull value);
+/** Store that no earlier memory access of this thread is moved after. */
+void tox_atomic_size_store_release(Tox_Atomic_Size *_Nonnull value, size_t desired);
+/**
+ * @brief Replace the value with `desired` if it is equal to `expected`.
+ *
+ * May fail spuriously, so call it in a loop.
+ *
+ * @retval true if the value was replaced.
+ * @retval false otherwise, and `expected` is updated to the current value.
+ */
+bool tox_atomic_size_compare_exchange(Tox_Atomic_Size *_Nonnull value, size_t *_Nonnull expected, size_t desired);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* C_TOXCORE_TOXCORE_ATOMICS_H */
@@ -7,71 +7,149 @@
 #include <assert.h>
 #include <string.h>
 
-#include "../third_party/cmp/cmp.h"
 #include "attributes.h"
 #include "ccompat.h"
 #include "logger.h"
-
+#include "mem.h"
+
+/* MessagePack markers, see https://github.com/msgpack/msgpack/blob/master/spec.md. */
+#define MSGPACK_POSITIVE_FIXINT_MAX 0x7f
+#define MSGPACK_FIXARRAY 0x90
+#define MSGPACK_FIXARRAY_MAX 0x0f
+#define MSGPACK_FIXSTR 0xa0
+#define MSGPACK_FIXSTR_MAX 0x1f
+#define MSGPACK_NIL 0xc0
+#define MSGPACK_FALSE 0xc2
+#define MSGPACK_TRUE 0xc3
+#define MSGPACK_BIN8 0xc4
+#define MSGPACK_BIN16 0xc5
+#define MSGPACK_BIN32 0xc6
+#define MSGPACK_UINT8 0xcc
+#define MSGPACK_UINT16 0xcd
+#define MSGPACK_UINT32 0xce
+#define MSGPACK_UINT64 0xcf
+#define MSGPACK_STR8 0xd9
+#define MSGPACK_STR16 0xda
+#define MSGPACK_STR32 0xdb
+#define MSGPACK_ARRAY16 0xdc
+#define MSGPACK_ARRAY32 0xdd
+
+/* Initial size of a growable buffer. */
+#define BIN_PACK_INITIAL_CAPACITY 256
+
+/**
+ * The packer writes straight into the buffer, so packing a value is a bounds
+ * check and a few stores, without any calls through function pointers.
+ *
+ * There are three modes:
+ * - `bytes == nullptr` and `mem == nullptr`: only count the bytes.
+ * - `mem == nullptr`: write into a fixed-size buffer.
+ * - `mem != nullptr`: write into a buffer that grows as needed.
+ */
 struct Bin_Pack {
+    const Memory *_Nullable mem;
     uint8_t *_Nullable bytes;
     uint32_t bytes_size;
     uint32_t bytes_pos;
-    cmp_ctx_t ctx;
 };
 
-static bool null_reader(cmp_ctx_t *_Nonnull ctx, void *_Nullable data, size_t limit)
+static bool bin_pack_grow(Bin_Pack *_Nonnull bp, uint32_t needed)
 {
-    assert(limit == 0);
-    return false;
-}
+    assert(bp->mem != nullptr);
 
-static bool null_skipper(cmp_ctx_t *_Nonnull ctx, size_t count)
-{
-    assert(count == 0);
-    return false;
+    uint32_t capacity = bp->bytes_size < BIN_PACK_INITIAL_CAPACITY ? BIN_PACK_INITIAL_CAPACITY : bp->bytes_size;
+
+    while (capacity < needed) {
+        capacity = capacity > UINT32_MAX / 2 ? UINT32_MAX : capacity * 2;
+    }
+
+    uint8_t *const bytes = (uint8_t *)mem_brealloc(bp->mem, bp->bytes, capacity);
+
+    if (bytes == nullptr) {
+        return false;
+    }
+
+    bp->bytes = bytes;
+    bp->bytes_size = capacity;
+    return true;
 }
 
-static size_t buf_writer(cmp_ctx_t *_Nonnull ctx, const void *_Nullable data, size_t count)
+/** @brief Reserve `count` bytes at the current position and advance past them.
+ *
+ * @param ok Set to false if there is no space, true otherwise.
+ *
+ * @return where to write the bytes, or NULL if the packer only counts bytes or
+ *   there is no space.
+ */
+static uint8_t *_Nullable bin_pack_reserve(Bin_Pack *_Nonnull bp, uint32_t count, bool *_Nonnull ok)
 {
-    const uint8_t *const bytes = (const uint8_t *)data;
+    const uint32_t pos = bp->bytes_pos;
+    const uint32_t new_pos = pos + count;
 
-    if (count == 0) {
-        return 0;
+    if (new_pos < pos) {
+        // 32 bit overflow.
+        *ok = false;
+        return nullptr;
     }
 
-    if (bytes == nullptr) {
-        return 0;
+    if (bp->bytes == nullptr && bp->mem == nullptr) {
+        bp->bytes_pos = new_pos;
+        *ok = true;
+        return nullptr;
     }
-    Bin_Pack *const bp = (Bin_Pack *)ctx->buf;
-    assert(bp != nullptr);
-    const uint32_t new_pos = bp->bytes_pos + count;
-    if (new_pos < bp->bytes_pos) {
-        // 32 bit overflow.
-        return 0;
+
+    if (new_pos > bp->bytes_size && (bp->mem == nullptr || !bin_pack_grow(bp, new_pos))) {
+        // Buffer too small.
+        *ok = false;
+        return nullptr;
+    }
+
+    bp->bytes_pos = new_pos;
+    *ok = true;
+    return &bp->bytes[pos];
+}
+
+static bool bin_pack_write(Bin_Pack *_Nonnull bp, const uint8_t *_Nonnull data, uint32_t count)
+{
+    bool ok;
+    uint8_t *const dest = bin_pack_reserve(bp, count, &ok);
+
+    if (dest != nullptr) {
+        memcpy(dest, data, count);
     }
-    if (bp->bytes != nullptr) {
-        if (new_pos > bp->bytes_size) {
-            // Buffer too small.
-            return 0;
+
+    return ok;
+}
+
+/** @brief Write a marker byte followed by `size` bytes of big endian `val`. */
+static bool bin_pack_marker(Bin_Pack *_Nonnull bp, uint8_t marker, uint32_t size, uint64_t val)
+{
+    bool ok;
+    uint8_t *const dest = bin_pack_reserve(bp, 1 + size, &ok);
+
+    if (dest != nullptr) {
+        dest[0] = marker;
+
+        for (uint32_t i = 0; i < size; ++i) {
+            dest[1 + i] = (uint8_t)(val >> (8 * (size - 1 - i)));
         }
-        memcpy(&bp->bytes[bp->bytes_pos], bytes, count);
     }
-    bp->bytes_pos += count;
-    return count;
+
+    return ok;
 }
 
-static void bin_pack_init(Bin_Pack *_Nonnull bp, uint8_t *_Nullable buf, uint32_t buf_size)
+static void bin_pack_init(Bin_Pack *_Nonnull bp, const Memory *_Nullable mem, uint8_t *_Nullable buf, uint32_t buf_size)
 {
+    bp->mem = mem;
     bp->bytes = buf;
     bp->bytes_size = buf_size;
     bp->bytes_pos = 0;
-    cmp_init(&bp->ctx, bp, null_reader, null_skipper, buf_writer);
 }
 
 uint32_t bin_pack_obj_size(bin_pack_cb *callback, const void *obj, const Logger *logger)
 {
     Bin_Pack bp;
-    bin_pack_init(&bp, nullptr, 0);
+    bin_pack_init(&bp, nullptr, nullptr, 0);
     if (!callback(obj, logger, &bp)) {
         return UINT32_MAX;
     }
@@ -81,14 +159,39 @@ uint32_t bin_pack_obj_size(bin_pack_cb *callback, const void *obj, const Logger
 bool bin_pack_obj(bin_pack_cb *callback, const void *obj, const Logger *logger, uint8_t *buf, uint32_t buf_size)
 {
     Bin_Pack bp;
-    bin_pack_init(&bp, buf, buf_size);
+    bin_pack_init(&bp, nullptr, buf, buf_size);
     return callback(obj, logger, &bp);
 }
 
+uint32_t bin_pack_obj_written(bin_pack_cb *callback, const void *obj, const Logger *logger, uint8_t *buf, uint32_t buf_size)
+{
+    Bin_Pack bp;
+    bin_pack_init(&bp, nullptr, buf, buf_size);
+    if (!callback(obj, logger, &bp)) {
+        return UINT32_MAX;
+    }
+    return bp.bytes_pos;
+}
+
+uint8_t *bin_pack_obj_alloc(const Memory *mem, bin_pack_cb *callback, const void *obj, const Logger *logger, uint32_t *size)
+{
+    Bin_Pack bp;
+    bin_pack_init(&bp, mem, nullptr, 0);
+
+    // Reserve the initial capacity so that empty objects still get a buffer.
+    if (!bin_pack_grow(&bp, 1) || !callback(obj, logger, &bp)) {
+        mem_delete(mem, bp.bytes);
+        return nullptr;
+    }
+
+    *size = bp.bytes_pos;
+    return bp.bytes;
+}
+
 uint32_t bin_pack_obj_array_b_size(bin_pack_array_cb *callback, const void *arr, uint32_t arr_size, const Logger *logger)
 {
     Bin_Pack bp;
-    bin_pack_init(&bp, nullptr, 0);
+    bin_pack_init(&bp, nullptr, nullptr, 0);
     if (arr == nullptr) {
         assert(arr_size == 0);
     }
@@ -103,7 +206,7 @@ uint32_t bin_pack_obj_array_b_size(bin_pack_array_cb *callback, const void *arr,
 bool bin_pack_obj_array_b(bin_pack_array_cb *callback, const void *arr, uint32_t arr_size, const Logger *logger, uint8_t *buf, uint32_t buf_size)
 {
     Bin_Pack bp;
-    bin_pack_init(&bp, buf, buf_size);
+    bin_pack_init(&bp, nullptr, buf, buf_size);
     if (arr == nullptr) {
         assert(arr_size == 0);
     }
@@ -115,6 +218,21 @@ bool bin_pack_obj_array_b(bin_pack_array_cb *callback, const void *arr, uint32_t
     return true;
 }
 
+uint32_t bin_pack_obj_array_b_written(bin_pack_array_cb *callback, const void *arr, uint32_t arr_size, const Logger *logger, uint8_t *buf, uint32_t buf_size)
+{
+    Bin_Pack bp;
+    bin_pack_init(&bp, nullptr, buf, buf_size);
+    if (arr == nullptr) {
+        assert(arr_size == 0);
+    }
+    for (uint32_t i = 0; i < arr_size; ++i) {
+        if (!callback(arr, i, logger, &bp)) {
+            return UINT32_MAX;
+        }
+    }
+    return bp.bytes_pos;
+}
+
 bool bin_pack_obj_array(Bin_Pack *bp, bin_pack_array_cb *callback, const void *arr, uint32_t arr_size, const Logger *logger)
 {
     if (arr == nullptr) {
@@ -137,85 +255,142 @@ bool bin_pack_obj_array(Bin_Pack *bp, bin_pack_array_cb *callback, const void *a
 
 bool bin_pack_array(Bin_Pack *bp, uint32_t size)
 {
-    return cmp_write_array(&bp->ctx, size);
+    if (size <= MSGPACK_FIXARRAY_MAX) {
+        return bin_pack_marker(bp, MSGPACK_FIXARRAY | size, 0, 0);
+    }
+
+    if (size <= UINT16_MAX) {
+        return bin_pack_marker(bp, MSGPACK_ARRAY16, sizeof(uint16_t), size);
+    }
+
+    return bin_pack_marker(bp, MSGPACK_ARRAY32, sizeof(uint32_t), size);
 }
 
 bool bin_pack_bool(Bin_Pack *bp, bool val)
 {
-    return cmp_write_bool(&bp->ctx, val);
+    return bin_pack_marker(bp, val ? MSGPACK_TRUE : MSGPACK_FALSE, 0, 0);
+}
+
+/** @brief Pack an unsigned integer in the smallest MessagePack representation. */
+static bool bin_pack_uint(Bin_Pack *_Nonnull bp, uint64_t val)
+{
+    if (val <= MSGPACK_POSITIVE_FIXINT_MAX) {
+        return bin_pack_marker(bp, (uint8_t)val, 0, 0);
+    }
+
+    if (val <= UINT8_MAX) {
+        return bin_pack_marker(bp, MSGPACK_UINT8, sizeof(uint8_t), val);
+    }
+
+    if (val <= UINT16_MAX) {
+        return bin_pack_marker(bp, MSGPACK_UINT16, sizeof(uint16_t), val);
+    }
+
+    if (val <= UINT32_MAX) {
+        return bin_pack_marker(bp, MSGPACK_UINT32, sizeof(uint32_t), val);
+    }
+
+    return bin_pack_marker(bp, MSGPACK_UINT64, sizeof(uint64_t), val);
 }
 
 bool bin_pack_u08(Bin_Pack *bp, uint8_t val)
 {
-    return cmp_write_uinteger(&bp->ctx, val);
+    return bin_pack_uint(bp, val);
 }
 
 bool bin_pack_u16(Bin_Pack *bp, uint16_t val)
 {
-    return cmp_write_uinteger(&bp->ctx, val);
+    return bin_pack_uint(bp, val);
 }
 
 bool bin_pack_u32(Bin_Pack *bp, uint32_t val)
 {
-    return cmp_write_uinteger(&bp->ctx, val);
+    return bin_pack_uint(bp, val);
 }
 
 bool bin_pack_u64(Bin_Pack *bp, uint64_t val)
 {
-    return cmp_write_uinteger(&bp->ctx, val);
+    return bin_pack_uint(bp, val);
 }
 
 bool bin_pack_bin(Bin_Pack *bp, const uint8_t *data, uint32_t length)
 {
     if (length == 0) {
-        return cmp_write_bin_marker(&bp->ctx, 0);
+        return bin_pack_bin_marker(bp, 0);
     }
 
     if (data == nullptr) {
         return false;
     }
 
-    return cmp_write_bin(&bp->ctx, data, length);
+    return bin_pack_bin_marker(bp, length) && bin_pack_write(bp, data, length);
+}
+
+static bool bin_pack_str_marker(Bin_Pack *_Nonnull bp, uint32_t size)
+{
+    if (size <= MSGPACK_FIXSTR_MAX) {
+        return bin_pack_marker(bp, MSGPACK_FIXSTR | size, 0, 0);
+    }
+
+    if (size <= UINT8_MAX) {
+        return bin_pack_marker(bp, MSGPACK_STR8, sizeof(uint8_t), size);
+    }
+
+    if (size <= UINT16_MAX) {
+        return bin_pack_marker(bp, MSGPACK_STR16, sizeof(uint16_t), size);
+    }
+
+    return bin_pack_marker(bp, MSGPACK_STR32, sizeof(uint32_t), size);
 }
 
 bool bin_pack_str(Bin_Pack *bp, const char *data, uint32_t length)
 {
     if (length == 0) {
-        return cmp_write_str_marker(&bp->ctx, 0);
+        return bin_pack_str_marker(bp, 0);
     }
 
     if (data == nullptr) {
         return false;
     }
 
-    return cmp_write_str(&bp->ctx, data, length);
+    return bin_pack_str_marker(bp, length) && bin_pack_write(bp, (const uint8_t *)data, length);
 }
 
 bool bin_pack_nil(Bin_Pack *bp)
 {
-    return cmp_write_nil(&bp->ctx);
+    return bin_pack_marker(bp, MSGPACK_NIL, 0, 0);
 }
 
 bool bin_pack_bin_marker(Bin_Pack *bp, uint32_t size)
 {
-    return cmp_write_bin_marker(&bp->ctx, size);
+    if (size <= UINT8_MAX) {
+        return bin_pack_marker(bp, MSGPACK_BIN8, sizeof(uint8_t), size);
+    }
+
+    if (size <= UINT16_MAX) {
+        return bin_pack_marker(bp, MSGPACK_BIN16, sizeof(uint16_t), size);
+    }
+
+    return bin_pack_marker(bp, MSGPACK_BIN32, sizeof(uint32_t), size);
 }
 
 bool bin_pack_u08_b(Bin_Pack *bp, uint8_t val)
 {
-    return bp->ctx.write(&bp->ctx, &val, 1) == 1;
+    return bin_pack_write(bp, &val, sizeof(val));
 }
 
 bool bin_pack_u16_b(Bin_Pack *bp, uint16_t val)
 {
-    return bin_pack_u08_b(bp, (val >> 8) & 0xff)
-           && bin_pack_u08_b(bp, val & 0xff);
+    const uint8_t bytes[sizeof(uint16_t)] = {(uint8_t)(val >> 8), (uint8_t)val};
+    return bin_pack_write(bp, bytes, sizeof(bytes));
 }
 
 bool bin_pack_u32_b(Bin_Pack *bp, uint32_t val)
 {
-    return bin_pack_u16_b(bp, (val >> 16) & 0xffff)
-           && bin_pack_u16_b(bp, val & 0xffff);
+    const uint8_t bytes[sizeof(uint32_t)] = {
+        (uint8_t)(val >> 24), (uint8_t)(val >> 16), (uint8_t)(val >> 8), (uint8_t)val,
+    };
+    return bin_pack_write(bp, bytes, sizeof(bytes));
 }
 
 bool bin_pack_u64_b(Bin_Pack *bp, uint64_t val)
@@ -226,9 +401,13 @@ bool bin_pack_u64_b(Bin_Pack *bp, uint64_t val)
 
 bool bin_pack_bin_b(Bin_Pack *bp, const uint8_t *data, uint32_t length)
 {
-    if (length > 0 && data == nullptr) {
+    if (length == 0) {
+        return true;
+    }
+
+    if (data == nullptr) {
         return false;
     }
 
-    return bp->ctx.write(&bp->ctx, data, length) == length;
+    return bin_pack_write(bp, data, length);
 }
@@ -9,6 +9,7 @@
 
 #include "attributes.h"
 #include "logger.h"
+#include "mem.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -87,6 +88,30 @@ uint32_t bin_pack_obj_size(bin_pack_cb *_Nonnull callback, const void *_Nullable
  * @retval false if an error occurred (e.g. buffer overflow).
  */
 bool bin_pack_obj(bin_pack_cb *_Nonnull callback, const void *_Nullable obj, const Logger *_Nullable logger, uint8_t *_Nonnull buf, uint32_t buf_size);
+/** @brief Pack an object into a buffer and return how much of it was used.
+ *
+ * Like `bin_pack_obj`, but packs in a single pass when the caller has a buffer
+ * that is large enough (e.g. an upper bound or a fixed-size packet) and only
+ * needs the packed size afterwards, instead of calling `bin_pack_obj_size`
+ * first.
+ *
+ * @return The number of bytes written to `buf`.
+ * @retval UINT32_MAX if an error occurred (e.g. buffer overflow).
+ */
+uint32_t bin_pack_obj_written(bin_pack_cb *_Nonnull callback, const void *_Nullable obj, const Logger *_Nullable logger, uint8_t *_Nonnull buf, uint32_t buf_size);
+/** @brief Pack an object into a newly allocated buffer in a single pass.
+ *
+ * The buffer grows as the callback packs, so the object doesn't need to be
+ * sized with `bin_pack_obj_size` first. The buffer may be larger than the
+ * packed object.
+ *
+ * @param mem The allocator for the buffer. The caller frees it with `mem_delete`.
+ * @param size Set to the number of bytes packed on success.
+ *
+ * @return The buffer holding the packed object, or NULL on allocation failure
+ *   or if the callback failed.
+ */
+uint8_t *_Nullable bin_pack_obj_alloc(const Memory *_Nonnull mem, bin_pack_cb *_Nonnull callback, const void *_Nullable obj, const Logger *_Nullable logger, uint32_t *_Nonnull size);
 /** @brief Determine the serialised size of an object array.
  *
  * Behaves exactly like `bin_pack_obj_b_array` but doesn't write.
@@ -119,6 +144,14 @@ uint32_t bin_pack_obj_array_b_size(bin_pack_array_cb *_Nonnull callback, const v
  * @retval false if an error occurred (e.g. buffer overflow).
  */
 bool bin_pack_obj_array_b(bin_pack_array_cb *_Nonnull callback, const void *_Nullable arr, uint32_t arr_size, const Logger *_Nullable logger, uint8_t *_Nonnull buf, uint32_t buf_size);
+/** @brief Pack an object array into a buffer and return how much of it was used.
+ *
+ * The single-pass variant of `bin_pack_obj_array_b`, see `bin_pack_obj_written`.
+ *
+ * @return The number of bytes written to `buf`.
+ * @retval UINT32_MAX if an error occurred (e.g. buffer overflow).
+ */
+uint32_t bin_pack_obj_array_b_written(bin_pack_array_cb *_Nonnull callback, const void *_Nullable arr, uint32_t arr_size, const Logger *_Nullable logger, uint8_t *_Nonnull buf, uint32_t buf_size);
 /** @brief Encode an object array as MessagePack array into a bin packer.
  *
  * Calls the callback `arr_size` times with increasing `index` argument from 0 to
@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "bin_pack.h"
+#include "mem.h"
+#include "os_memory.h"
+
+namespace {
+
+// Shaped like a friend message event.
+struct Message {
+    std::uint32_t friend_number;
+    std::uint32_t type;
+    std::vector<std::uint8_t> message;
+};
+
+// Shaped like a Node_format: family, IPv4 address, port and public key.
+struct Node {
+    std::uint8_t family;
+    std::array<std::uint8_t, 4> ip;
+    std::uint16_t port;
+    std::array<std::uint8_t, 32> public_key;
+};
+
+bool pack_message(const void *_Nullable obj, const Logger *_Nullable logger, Bin_Pack *_Nonnull bp)
+{
+    const auto *msg = static_cast<const Message *>(obj);
+    return bin_pack_array(bp, 3) && bin_pack_u32(bp, msg->friend_number)
+        && bin_pack_u32(bp, msg->type)
+        && bin_pack_bin(bp, msg->message.data(), msg->message.size());
+}
+
+bool pack_node(const void *_Nullable arr, std::uint32_t index, const Logger *_Nullable logger,
+    Bin_Pack *_Nonnull bp)
+{
+    const Node &node = static_cast<const Node *>(arr)[index];
+    return bin_pack_u08_b(bp, node.family) && bin_pack_bin_b(bp, node.ip.data(), node.ip.size())
+        && bin_pack_u16_b(bp, node.port)
+        && bin_pack_bin_b(bp, node.public_key.data(), node.public_key.size());
+}
+
+Message make_message(std::int64_t length)
+{
+    return Message{12, 0, std::vector<std::uint8_t>(static_cast<std::size_t>(length), 'x')};
+}
+
+// Size the buffer with bin_pack_obj_size, then pack.
+void BM_PackMessageTwoPass(benchmark::State &state)
+{
+    const Message msg = make_message(state.range(0));
+    std::vector<std::uint8_t> buf;
+
+    for (auto _ : state) {
+        const std::uint32_t size = bin_pack_obj_size(pack_message, &msg, nullptr);
+        buf.resize(size);
+        benchmark::DoNotOptimize(bin_pack_obj(pack_message, &msg, nullptr, buf.data(), size));
+    }
+}
+
+// Pack once into a buffer that grows as needed.
+void BM_PackMessageAlloc(benchmark::State &state)
+{
+    const Memory *mem = os_memory();
+    const Message msg = make_message(state.range(0));
+
+    for (auto _ : state) {
+        std::uint32_t size;
+        std::uint8_t *packed = bin_pack_obj_alloc(mem, pack_message, &msg, nullptr, &size);
+        benchmark::DoNotOptimize(packed);
+        mem_delete(mem, packed);
+    }
+}
+
+// What pack_nodes did: size the nodes, then pack them.
+void BM_PackNodesTwoPass(benchmark::State &state)
+{
+    const std::vector<Node> nodes(4, Node{2, {127, 0, 0, 1}, 33445, {}});
+    std::array<std::uint8_t, 1024> buf;
+
+    for (auto _ : state) {
+        const std::uint32_t size = bin_pack_obj_array_b_size(pack_node, nodes.data(), nodes.size(), nullptr);
+        benchmark::DoNotOptimize(size);
+        benchmark::DoNotOptimize(
+            bin_pack_obj_array_b(pack_node, nodes.data(), nodes.size(), nullptr, buf.data(), buf.size()));
+    }
+}
+
+// What pack_nodes does now: pack them into the packet and keep the size.
+void BM_PackNodesWritten(benchmark::State &state)
+{
+    const std::vector<Node> nodes(4, Node{2, {127, 0, 0, 1}, 33445, {}});
+    std::array<std::uint8_t, 1024> buf;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bin_pack_obj_array_b_written(
+            pack_node, nodes.data(), nodes.size(), nullptr, buf.data(), buf.size()));
+    }
+}
+
+BENCHMARK(BM_PackMessageTwoPass)->ArgName("length")->Arg(16)->Arg(1372);
+BENCHMARK(BM_PackMessageAlloc)->ArgName("length")->Arg(16)->Arg(1372);
+BENCHMARK(BM_PackNodesTwoPass);
+BENCHMARK(BM_PackNodesWritten);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 
 #include <array>
+#include <vector>
 
 #include "attributes.h"
 #include "bin_unpack.h"
@@ -436,4 +437,102 @@ TEST(BinPack, UnpackFailsOnBufferOverrun)
         &res_bin, buf.data(), buf.size()));
 }
 
+std::vector<std::uint8_t> pack(bin_pack_cb *callback, const void *obj)
+{
+    std::vector<std::uint8_t> buf(bin_pack_obj_size(callback, obj, nullptr));
+    EXPECT_TRUE(bin_pack_obj(callback, obj, nullptr, buf.data(), buf.size()));
+    return buf;
+}
+
+TEST(BinPack, IntegersUseTheSmallestEncoding)
+{
+    const auto pack_u64 = [](const void *_Nullable obj, const Logger *_Nullable logger, Bin_Pack *_Nonnull bp) {
+        return bin_pack_u64(bp, *static_cast<const std::uint64_t *>(REQUIRE_NOT_NULL(obj)));
+    };
+
+    const std::uint64_t fixint = 0x7f;
+    EXPECT_EQ(pack(pack_u64, &fixint), (std::vector<std::uint8_t>{0x7f}));
+    const std::uint64_t u8 = 0x80;
+    EXPECT_EQ(pack(pack_u64, &u8), (std::vector<std::uint8_t>{0xcc, 0x80}));
+    const std::uint64_t u16 = 0x1234;
+    EXPECT_EQ(pack(pack_u64, &u16), (std::vector<std::uint8_t>{0xcd, 0x12, 0x34}));
+    const std::uint64_t u32 = 0x12345678;
+    EXPECT_EQ(pack(pack_u64, &u32), (std::vector<std::uint8_t>{0xce, 0x12, 0x34, 0x56, 0x78}));
+    const std::uint64_t u64 = 0x123456789aULL;
+    EXPECT_EQ(pack(pack_u64, &u64),
+        (std::vector<std::uint8_t>{0xcf, 0x00, 0x00, 0x00, 0x12, 0x34, 0x56, 0x78, 0x9a}));
+}
+
+TEST(BinPack, MarkersUseTheSmallestEncoding)
+{
+    const auto pack_markers = [](const void *_Nullable obj, const Logger *_Nullable logger, Bin_Pack *_Nonnull bp) {
+        const std::uint32_t size = *static_cast<const std::uint32_t *>(REQUIRE_NOT_NULL(obj));
+        return bin_pack_array(bp, size) && bin_pack_bin_marker(bp, size);
+    };
+
+    const std::uint32_t small = 15;
+    EXPECT_EQ(pack(pack_markers, &small), (std::vector<std::uint8_t>{0x9f, 0xc4, 0x0f}));
+    const std::uint32_t medium = 16;
+    EXPECT_EQ(pack(pack_markers, &medium), (std::vector<std::uint8_t>{0xdc, 0x00, 0x10, 0xc4, 0x10}));
+    const std::uint32_t large = 0x10000;
+    EXPECT_EQ(pack(pack_markers, &large),
+        (std::vector<std::uint8_t>{0xdd, 0x00, 0x01, 0x00, 0x00, 0xc6, 0x00, 0x01, 0x00, 0x00}));
+
+    const auto pack_other = [](const void *_Nullable obj, const Logger *_Nullable logger, Bin_Pack *_Nonnull bp) {
+        return bin_pack_nil(bp) && bin_pack_bool(bp, true) && bin_pack_bool(bp, false)
+            && bin_pack_str(bp, "abc", 3);
+    };
+    EXPECT_EQ(pack(pack_other, nullptr),
+        (std::vector<std::uint8_t>{0xc0, 0xc3, 0xc2, 0xa3, 'a', 'b', 'c'}));
+}
+
+TEST(BinPack, WrittenReturnsThePackedSize)
+{
+    const auto pack_u32_b = [](const void *_Nullable obj, const Logger *_Nullable logger, Bin_Pack *_Nonnull bp) {
+        return bin_pack_u32_b(bp, 0x01020304) && bin_pack_u08(bp, 0xff);
+    };
+
+    std::array<std::uint8_t, 8> buf{};
+    EXPECT_EQ(bin_pack_obj_written(pack_u32_b, nullptr, nullptr, buf.data(), buf.size()), 6);
+    EXPECT_EQ(buf[0], 0x01);
+    EXPECT_EQ(buf[4], 0xcc);
+    EXPECT_EQ(buf[5], 0xff);
+
+    EXPECT_EQ(bin_pack_obj_written(pack_u32_b, nullptr, nullptr, buf.data(), 5), UINT32_MAX);
+}
+
+TEST(BinPack, AllocGrowsTheBuffer)
+{
+    const Memory *_Nonnull mem = os_memory();
+    const std::vector<std::uint8_t> data(1000, 0xab);
+
+    const auto pack_data = [](const void *_Nullable obj, const Logger *_Nullable logger, Bin_Pack *_Nonnull bp) {
+        const auto *data = static_cast<const std::vector<std::uint8_t> *>(REQUIRE_NOT_NULL(obj));
+
+        for (int i = 0; i < 10; ++i) {
+            if (!bin_pack_bin(bp, data->data(), data->size())) {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    uint32_t size = 0;
+    std::uint8_t *packed = bin_pack_obj_alloc(mem, pack_data, &data, nullptr, &size);
+    ASSERT_NE(packed, nullptr);
+
+    const std::vector<std::uint8_t> expected = pack(pack_data, &data);
+    EXPECT_EQ(std::vector<std::uint8_t>(packed, packed + size), expected);
+    mem_delete(mem, packed);
+
+    // Empty objects still get a buffer.
+    packed = bin_pack_obj_alloc(
+        mem, [](const void *_Nullable obj, const Logger *_Nullable logger, Bin_Pack *_Nonnull bp) { return true; },
+        nullptr, nullptr, &size);
+    ASSERT_NE(packed, nullptr);
+    EXPECT_EQ(size, 0);
+    mem_delete(mem, packed);
+}
+
 }  // namespace
@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+#include "deadlines.h"
+
+#include "ccompat.h"
+
+void deadlines_init(Deadlines *deadlines)
+{
+    for (uint32_t i = 0; i < DEADLINE_SOURCE_COUNT; ++i) {
+        deadlines->due[i] = DEADLINE_NEVER;
+    }
+}
+
+void deadlines_set(Deadlines *deadlines, Deadline_Source source, uint64_t due)
+{
+    if ((uint32_t)source >= DEADLINE_SOURCE_COUNT) {
+        return;
+    }
+
+    deadlines->due[source] = due;
+}
+
+uint64_t deadlines_next(const Deadlines *deadlines, Deadline_Source *source)
+{
+    uint64_t next = DEADLINE_NEVER;
+
+    for (uint32_t i = 0; i < DEADLINE_SOURCE_COUNT; ++i) {
+        if (deadlines->due[i] < next) {
+            next = deadlines->due[i];
+
+            if (source != nullptr) {
+                *source = (Deadline_Source)i;
+            }
+        }
+    }
+
+    return next;
+}
+
+uint32_t deadlines_interval(const Deadlines *deadlines, uint64_t now, uint32_t max_interval)
+{
+    const uint64_t next = deadlines_next(deadlines, nullptr);
+
+    if (next <= now) {
+        return max_interval < 1 ? max_interval : 1;
+    }
+
+    if (next - now > max_interval) {
+        return max_interval;
+    }
+
+    return (uint32_t)(next - now);
+}
+
+uint64_t deadline_min(uint64_t a, uint64_t b)
+{
+    return a < b ? a : b;
+}
+
+uint64_t deadline_from_seconds(uint64_t timestamp, uint64_t timeout)
+{
+    const uint64_t seconds = timestamp + timeout;
+
+    if (seconds < timestamp || seconds > DEADLINE_NEVER / 1000) {
+        return DEADLINE_NEVER;
+    }
+
+    return seconds * 1000;
+}
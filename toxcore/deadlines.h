@@ -0,0 +1,95 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+/**
+ * The times at which the subsystems driven by `do_messenger` next have work
+ * to do, so that the caller knows how long it can sleep.
+ */
+#ifndef C_TOXCORE_TOXCORE_DEADLINES_H
+#define C_TOXCORE_TOXCORE_DEADLINES_H
+
+#include <stdint.h>
+
+#include "attributes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief A deadline that is never reached. */
+#define DEADLINE_NEVER UINT64_MAX
+
+/**
+ * @brief How often, in milliseconds, to poll for work whose deadline isn't
+ * known, e.g. waiting for a socket to become writable.
+ */
+#define DEADLINE_POLL_INTERVAL 50
+
+/** @brief The subsystems that register deadlines. */
+typedef enum Deadline_Source {
+    DEADLINE_SOURCE_NET_CRYPTO,
+    DEADLINE_SOURCE_TCP_CONNECTIONS,
+    DEADLINE_SOURCE_TCP_SERVER,
+    DEADLINE_SOURCE_DHT,
+    DEADLINE_SOURCE_ONION_CLIENT,
+    DEADLINE_SOURCE_FRIEND_CONNECTIONS,
+    DEADLINE_SOURCE_MESSENGER,
+    DEADLINE_SOURCE_GROUP_CHATS,
+    DEADLINE_SOURCE_CONFERENCES,
+
+    DEADLINE_SOURCE_COUNT,
+} Deadline_Source;
+
+/**
+ * @brief The next deadline of each subsystem.
+ *
+ * All deadlines are in milliseconds on the `mono_time_get_ms` clock.
+ */
+typedef struct Deadlines {
+    uint64_t due[DEADLINE_SOURCE_COUNT];
+} Deadlines;
+
+/** @brief Set all deadlines to `DEADLINE_NEVER`. */
+void deadlines_init(Deadlines *_Nonnull deadlines);
+
+/** @brief Replace the deadline of `source`. */
+void deadlines_set(Deadlines *_Nonnull deadlines, Deadline_Source source, uint64_t due);
+
+/**
+ * @brief The earliest deadline of all sources.
+ *
+ * @param source If not NULL, set to the source of the earliest deadline. Left
+ *   unchanged if there is none.
+ *
+ * @return the deadline, or `DEADLINE_NEVER` if no source has one.
+ */
+uint64_t deadlines_next(const Deadlines *_Nonnull deadlines, Deadline_Source *_Nullable source);
+
+/**
+ * @brief Milliseconds from `now` until the earliest deadline.
+ *
+ * Deadlines that have already passed give 1 ms rather than 0, so that a
+ * caller sleeping for the interval doesn't spin.
+ *
+ * @param max_interval Upper bound on the result.
+ */
+uint32_t deadlines_interval(const Deadlines *_Nonnull deadlines, uint64_t now, uint32_t max_interval);
+
+/** @brief The earlier of two deadlines. */
+uint64_t deadline_min(uint64_t a, uint64_t b);
+
+/**
+ * @brief The deadline of a `mono_time_is_timeout(timestamp, timeout)` check.
+ *
+ * Timers on the seconds clock fire at the start of the second in which the
+ * check first succeeds. For checks of the form `timestamp + timeout < now`,
+ * pass `timeout + 1`.
+ */
+uint64_t deadline_from_seconds(uint64_t timestamp, uint64_t timeout);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* C_TOXCORE_TOXCORE_DEADLINES_H */
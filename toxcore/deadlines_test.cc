@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+#include "deadlines.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(Deadlines, StartsWithNoDeadlines)
+{
+    Deadlines deadlines;
+    deadlines_init(&deadlines);
+
+    Deadline_Source source = DEADLINE_SOURCE_COUNT;
+    EXPECT_EQ(deadlines_next(&deadlines, &source), DEADLINE_NEVER);
+    EXPECT_EQ(source, DEADLINE_SOURCE_COUNT);
+    EXPECT_EQ(deadlines_interval(&deadlines, 1000, 5000), 5000);
+}
+
+TEST(Deadlines, NextIsTheEarliestSource)
+{
+    Deadlines deadlines;
+    deadlines_init(&deadlines);
+    deadlines_set(&deadlines, DEADLINE_SOURCE_DHT, 3000);
+    deadlines_set(&deadlines, DEADLINE_SOURCE_FRIEND_CONNECTIONS, 1500);
+    deadlines_set(&deadlines, DEADLINE_SOURCE_ONION_CLIENT, 2000);
+
+    Deadline_Source source = DEADLINE_SOURCE_COUNT;
+    EXPECT_EQ(deadlines_next(&deadlines, &source), 1500);
+    EXPECT_EQ(source, DEADLINE_SOURCE_FRIEND_CONNECTIONS);
+    EXPECT_EQ(deadlines_interval(&deadlines, 1000, 5000), 500);
+}
+
+TEST(Deadlines, SetReplacesThePreviousDeadline)
+{
+    Deadlines deadlines;
+    deadlines_init(&deadlines);
+    deadlines_set(&deadlines, DEADLINE_SOURCE_NET_CRYPTO, 1100);
+    deadlines_set(&deadlines, DEADLINE_SOURCE_NET_CRYPTO, 4000);
+
+    EXPECT_EQ(deadlines_next(&deadlines, nullptr), 4000);
+}
+
+TEST(Deadlines, IntervalIsClampedToMax)
+{
+    Deadlines deadlines;
+    deadlines_init(&deadlines);
+    deadlines_set(&deadlines, DEADLINE_SOURCE_DHT, 60000);
+
+    EXPECT_EQ(deadlines_interval(&deadlines, 1000, 1000), 1000);
+}
+
+TEST(Deadlines, PassedDeadlineDoesNotSpin)
+{
+    Deadlines deadlines;
+    deadlines_init(&deadlines);
+    deadlines_set(&deadlines, DEADLINE_SOURCE_MESSENGER, 900);
+
+    EXPECT_EQ(deadlines_interval(&deadlines, 1000, 1000), 1);
+    EXPECT_EQ(deadlines_interval(&deadlines, 900, 1000), 1);
+}
+
+TEST(Deadlines, FromSecondsIsTheStartOfTheTimeoutSecond)
+{
+    // mono_time_is_timeout(10, 5) first succeeds when mono_time_get() is 15.
+    EXPECT_EQ(deadline_from_seconds(10, 5), 15000);
+    EXPECT_EQ(deadline_from_seconds(0, 0), 0);
+}
+
+TEST(Deadlines, FromSecondsSaturates)
+{
+    EXPECT_EQ(deadline_from_seconds(UINT64_MAX, 1), DEADLINE_NEVER);
+    EXPECT_EQ(deadline_from_seconds(UINT64_MAX / 1000, 1), DEADLINE_NEVER);
+}
+
+TEST(Deadlines, MinPicksTheEarlier)
+{
+    EXPECT_EQ(deadline_min(5, 7), 5);
+    EXPECT_EQ(deadline_min(DEADLINE_NEVER, 7), 7);
+    EXPECT_EQ(deadline_min(DEADLINE_NEVER, DEADLINE_NEVER), DEADLINE_NEVER);
+}
+
+}  // namespace
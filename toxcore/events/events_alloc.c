@@ -8,6 +8,7 @@
 
 #include "../ccompat.h"
 #include "../mem.h"
+#include "../mem_arena.h"
 #include "../tox_event.h"
 #include "../tox_events.h"
 
@@ -46,14 +47,23 @@ void tox_events_free(Tox_Events *events)
         return;
     }
 
-    for (uint32_t i = 0; i < events->events_size; ++i) {
-        tox_event_destruct(&events->events[i], events->mem);
+    if (events->arena != nullptr) {
+        mem_arena_free(events->arena);
+    } else {
+        for (uint32_t i = 0; i < events->events_size; ++i) {
+            tox_event_destruct(&events->events[i], events->mem);
+        }
     }
 
     mem_delete(events->mem, events->events);
     mem_delete(events->mem, events);
 }
 
+const Memory *tox_events_get_event_memory(const Tox_Events *events)
+{
+    return events->arena != nullptr ? mem_arena_get_memory(events->arena) : events->mem;
+}
+
 bool tox_events_add(Tox_Events *events, const Tox_Event *event)
 {
     if (events->events_size == UINT32_MAX) {
@@ -9,6 +9,7 @@
 #include <stdint.h>
 
 #include "../attributes.h"
+#include "../mem_arena.h"
 #include "../tox.h"
 #include "../tox_events.h"
 #include "../tox_private.h"
@@ -25,6 +26,12 @@ struct Tox_Events {
     uint32_t events_capacity;
 
     const struct Memory *_Nonnull mem;
+
+    /**
+     * If not null, the event objects and their payloads are allocated from this
+     * arena instead of `mem`, and are all freed at once when it is reset.
+     */
+    Mem_Arena *_Nullable arena;
 };
 
 typedef struct Tox_Events_State {
@@ -78,6 +85,9 @@ Tox_Events_State *_Nonnull tox_events_alloc(void *_Nonnull user_data);
 
 bool tox_events_add(Tox_Events *_Nonnull events, const Tox_Event *_Nonnull event);
 
+/** @brief The allocator for the event objects and their payloads. */
+const struct Memory *_Nonnull tox_events_get_event_memory(const Tox_Events *_Nonnull events);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
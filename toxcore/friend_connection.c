@@ -16,6 +16,7 @@
 #include "attributes.h"
 #include "ccompat.h"
 #include "crypto_core.h"
+#include "deadlines.h"
 #include "logger.h"
 #include "mem.h"
 #include "mono_time.h"
@@ -1009,6 +1010,42 @@ void do_friend_connections(Friend_Connections *fr_c, void *userdata)
     }
 }
 
+uint64_t friend_connections_next_deadline(const Friend_Connections *fr_c)
+{
+    const uint64_t poll = mono_time_get_ms(fr_c->mono_time) + DEADLINE_POLL_INTERVAL;
+    uint64_t due = DEADLINE_NEVER;
+
+    for (uint32_t i = 0; i < fr_c->num_cons; ++i) {
+        const Friend_Conn *const friend_con = &fr_c->conns[i];
+
+        if (friend_con->status == FRIENDCONN_STATUS_CONNECTING) {
+            if (friend_con->dht_lock_token > 0) {
+                if (friend_con->crypt_connection_id == -1) {
+                    due = deadline_min(due, poll);
+                }
+
+                due = deadline_min(due, deadline_from_seconds(friend_con->dht_pk_lastrecv, FRIEND_DHT_TIMEOUT + 1));
+            }
+
+            if (!net_family_is_unspec(friend_con->dht_ip_port.ip.family)) {
+                due = deadline_min(due, deadline_from_seconds(friend_con->dht_ip_port_lastrecv, FRIEND_DHT_TIMEOUT + 1));
+            }
+        } else if (friend_con->status == FRIENDCONN_STATUS_CONNECTED) {
+            due = deadline_min(due, deadline_from_seconds(friend_con->ping_lastsent, FRIEND_PING_INTERVAL + 1));
+            due = deadline_min(due, deadline_from_seconds(friend_con->share_relays_lastsent, SHARE_RELAYS_INTERVAL + 1));
+            due = deadline_min(due, deadline_from_seconds(friend_con->ping_lastrecv, FRIEND_CONNECTION_TIMEOUT + 1));
+        }
+    }
+
+    if (fr_c->local_discovery_enabled && fr_c->broadcast != nullptr) {
+        due = deadline_min(due, deadline_from_seconds(fr_c->last_lan_discovery, LAN_DISCOVERY_INTERVAL + 1));
+    }
+
+    // A ping or relay list that couldn't be sent is retried, but not in a
+    // busy loop.
+    return due < poll ? poll : due;
+}
+
 /** Free everything related with friend_connections. */
 void kill_friend_connections(Friend_Connections *fr_c)
 {
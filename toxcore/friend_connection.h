@@ -157,6 +157,12 @@ Friend_Connections *_Nullable new_friend_connections(const Logger *_Nonnull logg
 /** main friend_connections loop. */
 void do_friend_connections(Friend_Connections *_Nonnull fr_c, void *_Nullable userdata);
 
+/**
+ * @brief When `do_friend_connections` next has work to do, in milliseconds on
+ *   the `mono_time_get_ms` clock.
+ */
+uint64_t friend_connections_next_deadline(const Friend_Connections *_Nonnull fr_c);
+
 /** Free everything related with friend_connections. */
 void kill_friend_connections(Friend_Connections *_Nullable fr_c);
 typedef struct Friend_Conn Friend_Conn;
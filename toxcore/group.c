@@ -16,6 +16,7 @@
 #include "attributes.h"
 #include "ccompat.h"
 #include "crypto_core.h"
+#include "deadlines.h"
 #include "friend_connection.h"
 #include "group_common.h"
 #include "logger.h"
@@ -3744,6 +3745,28 @@ void do_groupchats(Group_Chats *g_c, void *userdata)
     // TODO(irungentoo):
 }
 
+uint64_t conferences_next_deadline(const Group_Chats *g_c)
+{
+    uint64_t due = DEADLINE_NEVER;
+
+    for (uint16_t i = 0; i < g_c->num_chats; ++i) {
+        const Group_c *g = &g_c->chats[i];
+
+        if (g->status != GROUPCHAT_STATUS_CONNECTED) {
+            continue;
+        }
+
+        if (g->need_send_name) {
+            return mono_time_get_ms(g_c->mono_time);
+        }
+
+        // Pings and peer timeouts count in seconds.
+        due = deadline_from_seconds(mono_time_get(g_c->mono_time), 1);
+    }
+
+    return due;
+}
+
 /** Free everything related with group chats. */
 void kill_groupchats(Group_Chats *g_c)
 {
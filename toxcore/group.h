@@ -346,6 +346,12 @@ Group_Chats *_Nullable new_groupchats(const Mono_Time *_Nonnull mono_time, const
 
 /** main groupchats loop. */
 void do_groupchats(Group_Chats *_Nonnull g_c, void *_Nullable userdata);
+
+/**
+ * @brief When `do_groupchats` next has work to do, in milliseconds on the
+ *   `mono_time_get_ms` clock.
+ */
+uint64_t conferences_next_deadline(const Group_Chats *_Nonnull g_c);
 /** Free everything related with group chats. */
 void kill_groupchats(Group_Chats *_Nullable g_c);
 #endif /* C_TOXCORE_TOXCORE_GROUP_H */
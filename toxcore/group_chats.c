@@ -22,6 +22,7 @@
 #include "bin_unpack.h"
 #include "ccompat.h"
 #include "crypto_core.h"
+#include "deadlines.h"
 #include "friend_connection.h"
 #include "group_announce.h"
 #include "group_common.h"
@@ -3562,6 +3563,25 @@ int gc_get_peer_ip_address(const GC_Chat *chat, GC_Peer_Id peer_id, uint8_t *ip_
     return 0;
 }
 
+int gc_get_peer_connection_stats(const GC_Chat *chat, GC_Peer_Id peer_id, GC_Connection_Stats *stats)
+{
+    const int peer_number = get_peer_number_of_peer_id(chat, peer_id);
+
+    if (peer_number_is_self(peer_number)) {
+        return -1;
+    }
+
+    const GC_Connection *gconn = get_gc_connection(chat, peer_number);
+
+    if (gconn == nullptr) {
+        return -1;
+    }
+
+    *stats = gconn->stats;
+
+    return 0;
+}
+
 unsigned int gc_get_peer_connection_status(const GC_Chat *chat, GC_Peer_Id peer_id)
 {
     const int peer_number = get_peer_number_of_peer_id(chat, peer_id);
@@ -5223,7 +5243,7 @@ static int handle_gc_message_ack(const GC_Chat *_Nonnull chat, GC_Connection *_N
     const Group_Message_Ack_Type type = (Group_Message_Ack_Type) data[0];
 
     if (type == GR_ACK_RECV) {
-        if (!gcc_handle_ack(chat->log, chat->mem, gconn, message_id)) {
+        if (!gcc_handle_ack(chat->log, chat->mem, chat->mono_time, gconn, message_id)) {
             return -2;
         }
 
@@ -5244,6 +5264,8 @@ static int handle_gc_message_ack(const GC_Chat *_Nonnull chat, GC_Connection *_N
                 gconn->send_array[idx].message_id,
                 gconn->send_array[idx].packet_type) == 0) {
             gconn->send_array[idx].last_send_try = tm;
+            gconn->send_array[idx].resent = true;
+            ++gconn->stats.packets_resent;
             LOGGER_DEBUG(chat->log, "Re-sent requested packet %llu", (unsigned long long)message_id);
         } else {
             return -3;
@@ -6059,6 +6081,9 @@ static bool handle_gc_lossless_packet(const GC_Session *_Nonnull c, GC_Chat *_No
         return false;
     }
 
+    ++gconn->stats.packets_received;
+    gconn->stats.bytes_received += length;
+
     if (!gconn->handshaked && (packet_type != GP_HS_RESPONSE_ACK && packet_type != GP_INVITE_REQUEST)) {
         LOGGER_DEBUG(chat->log, "Got lossless packet type 0x%02x from unconfirmed peer", packet_type);
         mem_delete(chat->mem, data);
@@ -6209,6 +6234,9 @@ static bool handle_gc_lossy_packet(const GC_Session *_Nonnull c, GC_Chat *_Nonnu
         return false;
     }
 
+    ++gconn->stats.packets_received;
+    gconn->stats.bytes_received += length;
+
     const int ret = handle_gc_lossy_packet_decoded(c, chat, gconn, peer, packet_type, data, (uint16_t)len, userdata);
 
     mem_delete(chat->mem, data);
@@ -7181,6 +7209,32 @@ void do_gc(GC_Session *c, void *userdata)
     }
 }
 
+uint64_t gc_next_deadline(const GC_Session *c)
+{
+    const Mono_Time *mono_time = c->messenger->mono_time;
+    uint64_t due = DEADLINE_NEVER;
+
+    for (uint32_t i = 0; i < c->chats_index; ++i) {
+        const GC_Chat *chat = &c->chats[i];
+
+        if (chat->connection_state == CS_NONE) {
+            continue;
+        }
+
+        due = deadline_min(due, deadline_from_seconds(mono_time_get(mono_time), 1));
+
+        if (chat->flag_exit) {
+            due = deadline_min(due, mono_time_get_ms(mono_time));
+        }
+
+        if (chat->connection_state != CS_DISCONNECTED && chat->tcp_conn != nullptr) {
+            due = deadline_min(due, tcp_connections_next_deadline(chat->tcp_conn));
+        }
+    }
+
+    return due;
+}
+
 /** @brief Set the size of the groupchat list to n.
  *
  * Return true on success.
@@ -7470,6 +7524,11 @@ void gc_group_save(const GC_Chat *chat, Bin_Pack *bp)
     gc_save_pack_group(chat, bp);
 }
 
+void gc_group_unload(GC_Session *c, GC_Chat *chat)
+{
+    group_delete(c, chat);
+}
+
 int gc_group_load(GC_Session *c, Bin_Unpack *bu)
 {
     const int group_number = get_new_group_index(c->messenger->mem, c);
@@ -374,6 +374,13 @@ int gc_get_peer_ip_address_size(const GC_Chat *_Nonnull chat, GC_Peer_Id peer_id
  * Returns -2 if `ip_addr` is null.
  */
 int gc_get_peer_ip_address(const GC_Chat *_Nonnull chat, GC_Peer_Id peer_id, uint8_t *_Nullable ip_addr);
+
+/** @brief Copies the traffic and latency counters of our connection to the peer designated by `peer_id`.
+ *
+ * Returns 0 on success.
+ * Returns -1 if peer_id is invalid, designates ourself, or doesn't correspond to a valid peer connection.
+ */
+int gc_get_peer_connection_stats(const GC_Chat *_Nonnull chat, GC_Peer_Id peer_id, GC_Connection_Stats *_Nonnull stats);
 /** @brief Gets the connection status for peer associated with `peer_id`.
  *
  * If `peer_id` designates ourself, the return value indicates whether we're capable
@@ -537,6 +544,15 @@ void gc_callback_voice_state(const Messenger *_Nonnull m, gc_voice_state_cb *_Nu
 
 /** @brief The main loop. Should be called with every Messenger iteration. */
 void do_gc(GC_Session *_Nonnull c, void *_Nullable userdata);
+
+/**
+ * @brief When `do_gc` next has work to do, in milliseconds on the
+ *   `mono_time_get_ms` clock.
+ *
+ * Group timers count in seconds, so while any group is active this is at
+ * most the start of the next second.
+ */
+uint64_t gc_next_deadline(const GC_Session *_Nonnull c);
 /**
  * Make sure that DHT is initialized before calling this.
  * Returns a NULL pointer on failure.
@@ -558,6 +574,13 @@ int gc_group_load(GC_Session *_Nonnull c, Bin_Unpack *_Nonnull bu);
  */
 void gc_group_save(const GC_Chat *_Nonnull chat, Bin_Pack *_Nonnull bp);
 
+/** @brief Frees a group without telling its peers that we left.
+ *
+ * Used when a group loaded from saved data is replaced by a newer copy or was
+ * deleted later on.
+ */
+void gc_group_unload(GC_Session *_Nonnull c, GC_Chat *_Nonnull chat);
+
 /** @brief Creates a new group and adds it to the group sessions group array.
  *
  * The caller of this function has founder role privileges.
@@ -92,8 +92,23 @@ typedef struct GC_Message_Array_Entry {
     uint64_t message_id;
     uint64_t time_added;
     uint64_t last_send_try;
+    uint64_t time_added_ms;  /* for RTT samples from acks */
+    bool     resent;  /* acks for resent messages don't give RTT samples */
 } GC_Message_Array_Entry;
 
+/** Traffic and latency counters of a group connection. */
+typedef struct GC_Connection_Stats {
+    /** Encrypted packets and their size on the wire, UDP and TCP. */
+    uint64_t packets_sent;
+    uint64_t bytes_sent;
+    uint64_t packets_received;
+    uint64_t bytes_received;
+    /** Lossless packets sent again, on timeout or because the peer requested them. */
+    uint64_t packets_resent;
+    /** Smallest time in milliseconds from sending a lossless packet to its ack, 0 if none yet. */
+    uint64_t min_rtt;
+} GC_Connection_Stats;
+
 typedef struct GC_Connection {
     uint64_t send_message_id;   /* message_id of the next message we send to peer */
 
@@ -145,6 +160,8 @@ typedef struct GC_Connection {
     bool        pending_delete;  /* true if this peer has been marked for deletion */
     bool        delete_this_iteration;  /* true if this peer should be deleted this do_gc() iteration*/
     GC_Exit_Info exit_info;
+
+    GC_Connection_Stats stats;
 } GC_Connection;
 
 /***
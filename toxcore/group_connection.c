@@ -125,6 +125,8 @@ static bool create_array_entry(const Logger *_Nonnull log, const Memory *_Nonnul
     array_entry->message_id = message_id;
     array_entry->time_added = tm;
     array_entry->last_send_try = tm;
+    array_entry->time_added_ms = mono_time_get_ms(mono_time);
+    array_entry->resent = false;
 
     return true;
 }
@@ -239,7 +241,8 @@ bool gcc_send_lossless_packet_fragments(const GC_Chat *chat, GC_Connection *gcon
     return true;
 }
 
-bool gcc_handle_ack(const Logger *log, const Memory *mem, GC_Connection *gconn, uint64_t message_id)
+bool gcc_handle_ack(const Logger *log, const Memory *mem, const Mono_Time *mono_time, GC_Connection *gconn,
+                    uint64_t message_id)
 {
     uint16_t idx = gcc_get_array_index(message_id);
     GC_Message_Array_Entry *array_entry = &gconn->send_array[idx];
@@ -253,6 +256,14 @@ bool gcc_handle_ack(const Logger *log, const Memory *mem, GC_Connection *gconn,
         return false;
     }
 
+    if (!array_entry->resent) {
+        const uint64_t rtt = mono_time_get_ms(mono_time) - array_entry->time_added_ms;
+
+        if (gconn->stats.min_rtt == 0 || rtt < gconn->stats.min_rtt) {
+            gconn->stats.min_rtt = rtt == 0 ? 1 : rtt;
+        }
+    }
+
     clear_array_entry(mem, array_entry);
 
     /* Put send_array_start in proper position */
@@ -588,16 +599,15 @@ void gcc_resend_packets(const GC_Chat *chat, GC_Connection *gconn)
         if (delta > 1 && is_power_of_2(delta)) {
             gcc_encrypt_and_send_lossless_packet(chat, gconn, array_entry_loop->data, array_entry_loop->data_length,
                                                  array_entry_loop->message_id, array_entry_loop->packet_type);
+            array_entry_loop->resent = true;
+            ++gconn->stats.packets_resent;
         }
     }
 }
 
-bool gcc_send_packet(const GC_Chat *chat, GC_Connection *gconn, const uint8_t *packet, uint16_t length)
+/** @brief Sends an encrypted packet to the peer, directly or through TCP. */
+static bool send_packet_any(const GC_Chat *_Nonnull chat, GC_Connection *_Nonnull gconn, const uint8_t *_Nonnull packet, uint16_t length)
 {
-    if (packet == nullptr || length == 0) {
-        return false;
-    }
-
     bool direct_send_attempt = false;
 
     if (gcc_direct_conn_is_possible(chat, gconn)) {
@@ -621,6 +631,21 @@ bool gcc_send_packet(const GC_Chat *chat, GC_Connection *gconn, const uint8_t *p
     return ret == 0 || direct_send_attempt;
 }
 
+bool gcc_send_packet(const GC_Chat *chat, GC_Connection *gconn, const uint8_t *packet, uint16_t length)
+{
+    if (packet == nullptr || length == 0) {
+        return false;
+    }
+
+    if (!send_packet_any(chat, gconn, packet, length)) {
+        return false;
+    }
+
+    ++gconn->stats.packets_sent;
+    gconn->stats.bytes_sent += length;
+    return true;
+}
+
 int gcc_encrypt_and_send_lossless_packet(const GC_Chat *chat, GC_Connection *gconn, const uint8_t *data,
         uint16_t length, uint64_t message_id, uint8_t packet_type)
 {
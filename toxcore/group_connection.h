@@ -61,7 +61,8 @@ uint16_t gcc_get_array_index(uint64_t message_id);
  *
  * Return true on success.
  */
-bool gcc_handle_ack(const Logger *_Nonnull log, const Memory *_Nonnull mem, GC_Connection *_Nonnull gconn, uint64_t message_id);
+bool gcc_handle_ack(const Logger *_Nonnull log, const Memory *_Nonnull mem, const Mono_Time *_Nonnull mono_time, GC_Connection *_Nonnull gconn,
+                    uint64_t message_id);
 
 /** @brief Sets the send_message_id and send_array_start for `gconn` to `id`.
  *
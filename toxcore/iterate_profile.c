@@ -0,0 +1,225 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+/**
+ * Wall-time profile of the phases of one tox_iterate and of the UDP packet
+ * handlers.
+ */
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif /* _XOPEN_SOURCE */
+
+#if !defined(OS_WIN32) && (defined(_WIN32) || defined(__WIN32__) || defined(WIN32))
+#define OS_WIN32
+#endif /* WIN32 */
+
+#include "iterate_profile.h"
+
+#ifdef OS_WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif /* OS_WIN32 */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "attributes.h"
+#include "ccompat.h"
+#include "mem.h"
+
+typedef struct Iterate_Profile_Timing {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} Iterate_Profile_Timing;
+
+struct Iterate_Profile {
+    iterprof_clock_cb *_Nonnull clock;
+    void *_Nullable clock_user_data;
+
+    Iterate_Profile_Timing phases[ITERPROF_NUM_PHASES];
+    uint64_t phase_buckets[ITERPROF_NUM_PHASES][ITERPROF_NUM_BUCKETS];
+
+    Iterate_Profile_Timing packets[ITERPROF_NUM_PACKET_IDS];
+};
+
+#ifdef OS_WIN32
+static uint64_t current_time_ns_default(void *_Nullable user_data)
+{
+    LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (!QueryPerformanceFrequency(&freq) || !QueryPerformanceCounter(&count)) {
+        return 0;
+    }
+
+    const uint64_t sec = count.QuadPart / freq.QuadPart;
+    const uint64_t rem = count.QuadPart % freq.QuadPart;
+    return sec * UINT64_C(1000000000) + rem * UINT64_C(1000000000) / freq.QuadPart;
+}
+#else
+static uint64_t current_time_ns_default(void *_Nullable user_data)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return 0;
+    }
+
+    return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+#endif /* OS_WIN32 */
+
+/** @brief Returns the histogram bucket of a duration: floor(log2(ns)), capped at the last bucket. */
+static uint32_t duration_bucket(uint64_t ns)
+{
+    uint32_t bucket = 0;
+
+    while (ns > 1 && bucket < ITERPROF_NUM_BUCKETS - 1) {
+        ns >>= 1;
+        ++bucket;
+    }
+
+    return bucket;
+}
+
+static void timing_record(Iterate_Profile_Timing *_Nonnull timing, uint64_t ns)
+{
+    ++timing->count;
+    timing->total_ns += ns;
+
+    if (ns > timing->max_ns) {
+        timing->max_ns = ns;
+    }
+}
+
+uint64_t iterprof_now(const Iterate_Profile *profile)
+{
+    if (profile == nullptr) {
+        return 0;
+    }
+
+    return profile->clock(profile->clock_user_data);
+}
+
+uint64_t iterprof_record_phase(Iterate_Profile *profile, Iterate_Phase phase, uint64_t start)
+{
+    if (profile == nullptr || (unsigned int)phase >= ITERPROF_NUM_PHASES) {
+        return 0;
+    }
+
+    const uint64_t now = profile->clock(profile->clock_user_data);
+    const uint64_t ns = now > start ? now - start : 0;
+
+    timing_record(&profile->phases[phase], ns);
+    ++profile->phase_buckets[phase][duration_bucket(ns)];
+
+    return now;
+}
+
+void iterprof_record_packet(Iterate_Profile *profile, uint8_t id, uint64_t start)
+{
+    if (profile == nullptr) {
+        return;
+    }
+
+    const uint64_t now = profile->clock(profile->clock_user_data);
+    timing_record(&profile->packets[id], now > start ? now - start : 0);
+}
+
+uint64_t iterprof_get_phase_count(const Iterate_Profile *profile, Iterate_Phase phase)
+{
+    if (profile == nullptr || (unsigned int)phase >= ITERPROF_NUM_PHASES) {
+        return 0;
+    }
+
+    return profile->phases[phase].count;
+}
+
+uint64_t iterprof_get_phase_total_ns(const Iterate_Profile *profile, Iterate_Phase phase)
+{
+    if (profile == nullptr || (unsigned int)phase >= ITERPROF_NUM_PHASES) {
+        return 0;
+    }
+
+    return profile->phases[phase].total_ns;
+}
+
+uint64_t iterprof_get_phase_max_ns(const Iterate_Profile *profile, Iterate_Phase phase)
+{
+    if (profile == nullptr || (unsigned int)phase >= ITERPROF_NUM_PHASES) {
+        return 0;
+    }
+
+    return profile->phases[phase].max_ns;
+}
+
+uint64_t iterprof_get_phase_bucket(const Iterate_Profile *profile, Iterate_Phase phase, uint32_t bucket)
+{
+    if (profile == nullptr || (unsigned int)phase >= ITERPROF_NUM_PHASES || bucket >= ITERPROF_NUM_BUCKETS) {
+        return 0;
+    }
+
+    return profile->phase_buckets[phase][bucket];
+}
+
+uint64_t iterprof_get_packet_count(const Iterate_Profile *profile, uint8_t id)
+{
+    if (profile == nullptr) {
+        return 0;
+    }
+
+    return profile->packets[id].count;
+}
+
+uint64_t iterprof_get_packet_total_ns(const Iterate_Profile *profile, uint8_t id)
+{
+    if (profile == nullptr) {
+        return 0;
+    }
+
+    return profile->packets[id].total_ns;
+}
+
+uint64_t iterprof_get_packet_max_ns(const Iterate_Profile *profile, uint8_t id)
+{
+    if (profile == nullptr) {
+        return 0;
+    }
+
+    return profile->packets[id].max_ns;
+}
+
+void iterprof_reset(Iterate_Profile *profile)
+{
+    if (profile == nullptr) {
+        return;
+    }
+
+    memset(profile->phases, 0, sizeof(profile->phases));
+    memset(profile->phase_buckets, 0, sizeof(profile->phase_buckets));
+    memset(profile->packets, 0, sizeof(profile->packets));
+}
+
+Iterate_Profile *iterprof_new(const Memory *mem, iterprof_clock_cb *clock, void *clock_user_data)
+{
+    Iterate_Profile *profile = (Iterate_Profile *)mem_alloc(mem, sizeof(Iterate_Profile));
+
+    if (profile == nullptr) {
+        return nullptr;
+    }
+
+    profile->clock = clock != nullptr ? clock : current_time_ns_default;
+    profile->clock_user_data = clock_user_data;
+
+    return profile;
+}
+
+void iterprof_kill(const Memory *mem, Iterate_Profile *profile)
+{
+    if (profile != nullptr) {
+        mem_delete(mem, profile);
+    }
+}
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+/**
+ * Wall-time profile of the phases of one tox_iterate and of the UDP packet
+ * handlers.
+ */
+#ifndef C_TOXCORE_TOXCORE_ITERATE_PROFILE_H
+#define C_TOXCORE_TOXCORE_ITERATE_PROFILE_H
+
+#include <stdint.h>
+
+#include "attributes.h"
+#include "mem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of histogram buckets per phase. Bucket `i` counts durations in [2^i, 2^(i+1)) ns. */
+#define ITERPROF_NUM_BUCKETS 32
+
+/** Number of packet ids a handler can be registered for. */
+#define ITERPROF_NUM_PACKET_IDS 256
+
+/** The parts of tox_iterate that are timed separately. */
+typedef enum Iterate_Phase {
+    /** All of tox_iterate, including the phases below. */
+    ITERATE_PHASE_ITERATE,
+    /** Reading and handling UDP packets. */
+    ITERATE_PHASE_NETWORKING_POLL,
+    ITERATE_PHASE_DHT,
+    ITERATE_PHASE_TCP_SERVER,
+    ITERATE_PHASE_NET_CRYPTO,
+    ITERATE_PHASE_ONION_CLIENT,
+    ITERATE_PHASE_FRIEND_CONNECTIONS,
+    ITERATE_PHASE_FRIENDS,
+    ITERATE_PHASE_GROUP_CHATS,
+    ITERATE_PHASE_GROUP_ANNOUNCES,
+    ITERATE_PHASE_GROUP_ONION_FRIENDS,
+    ITERATE_PHASE_CONFERENCES,
+} Iterate_Phase;
+
+#define ITERPROF_NUM_PHASES (ITERATE_PHASE_CONFERENCES + 1)
+
+/** @brief Returns a monotonic time in nanoseconds. */
+typedef uint64_t iterprof_clock_cb(void *_Nullable user_data);
+
+/* If passed to a iterprof function as a nullptr the function will have no effect. */
+typedef struct Iterate_Profile Iterate_Profile;
+
+/**
+ * @brief Returns the current time to pass to the next `iterprof_record_*` call.
+ *
+ * Returns 0 without reading the clock if `profile` is nullptr.
+ */
+uint64_t iterprof_now(const Iterate_Profile *_Nullable profile);
+
+/**
+ * @brief Records a call of `phase` that started at `start`.
+ *
+ * @return the current time, which is the start of the next phase.
+ */
+uint64_t iterprof_record_phase(Iterate_Profile *_Nullable profile, Iterate_Phase phase, uint64_t start);
+
+/**
+ * @brief Records a call of the handler for packet `id` that started at `start`.
+ */
+void iterprof_record_packet(Iterate_Profile *_Nullable profile, uint8_t id, uint64_t start);
+
+/** @brief Returns the number of recorded calls of `phase`. */
+uint64_t iterprof_get_phase_count(const Iterate_Profile *_Nullable profile, Iterate_Phase phase);
+/** @brief Returns the total time spent in `phase` in nanoseconds. */
+uint64_t iterprof_get_phase_total_ns(const Iterate_Profile *_Nullable profile, Iterate_Phase phase);
+/** @brief Returns the longest call of `phase` in nanoseconds. */
+uint64_t iterprof_get_phase_max_ns(const Iterate_Profile *_Nullable profile, Iterate_Phase phase);
+/** @brief Returns the number of calls of `phase` that fell into histogram bucket `bucket`. */
+uint64_t iterprof_get_phase_bucket(const Iterate_Profile *_Nullable profile, Iterate_Phase phase, uint32_t bucket);
+
+/** @brief Returns the number of handled packets of type `id`. */
+uint64_t iterprof_get_packet_count(const Iterate_Profile *_Nullable profile, uint8_t id);
+/** @brief Returns the total time spent handling packets of type `id` in nanoseconds. */
+uint64_t iterprof_get_packet_total_ns(const Iterate_Profile *_Nullable profile, uint8_t id);
+/** @brief Returns the longest time spent handling one packet of type `id` in nanoseconds. */
+uint64_t iterprof_get_packet_max_ns(const Iterate_Profile *_Nullable profile, uint8_t id);
+
+/** @brief Clears all counters and histograms. */
+void iterprof_reset(Iterate_Profile *_Nullable profile);
+
+/**
+ * @brief Returns a new, empty profile.
+ *
+ * @param clock Time source, or nullptr for the system's monotonic clock. The
+ *   profile measures CPU-bound work, so this is the real clock even when the
+ *   tox instance runs on a simulated one.
+ */
+Iterate_Profile *_Nullable iterprof_new(const Memory *_Nonnull mem, iterprof_clock_cb *_Nullable clock,
+                                        void *_Nullable clock_user_data);
+
+/** @brief Frees the profile. */
+void iterprof_kill(const Memory *_Nonnull mem, Iterate_Profile *_Nullable profile);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* C_TOXCORE_TOXCORE_ITERATE_PROFILE_H */
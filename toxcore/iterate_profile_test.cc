@@ -0,0 +1,141 @@
+#include "iterate_profile.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "os_memory.h"
+
+namespace {
+
+struct FakeClock {
+    std::uint64_t now = 1000;
+
+    static std::uint64_t read(void *user_data) { return static_cast<FakeClock *>(user_data)->now; }
+};
+
+class IterateProfile : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        profile = iterprof_new(os_memory(), &FakeClock::read, &clock);
+        ASSERT_NE(profile, nullptr);
+    }
+
+    void TearDown() override { iterprof_kill(os_memory(), profile); }
+
+    FakeClock clock;
+    Iterate_Profile *profile = nullptr;
+};
+
+TEST_F(IterateProfile, NullProfileIsANoOp)
+{
+    EXPECT_EQ(iterprof_now(nullptr), 0);
+    EXPECT_EQ(iterprof_record_phase(nullptr, ITERATE_PHASE_DHT, 0), 0);
+    iterprof_record_packet(nullptr, 0x02, 0);
+    iterprof_reset(nullptr);
+
+    EXPECT_EQ(iterprof_get_phase_count(nullptr, ITERATE_PHASE_DHT), 0);
+    EXPECT_EQ(iterprof_get_packet_count(nullptr, 0x02), 0);
+}
+
+TEST_F(IterateProfile, PhasesChainOnOneClockRead)
+{
+    std::uint64_t t = iterprof_now(profile);
+
+    clock.now += 300;
+    t = iterprof_record_phase(profile, ITERATE_PHASE_NETWORKING_POLL, t);
+    EXPECT_EQ(t, clock.now);
+
+    clock.now += 5000;
+    t = iterprof_record_phase(profile, ITERATE_PHASE_DHT, t);
+
+    clock.now += 100;
+    iterprof_record_phase(profile, ITERATE_PHASE_DHT, t);
+
+    EXPECT_EQ(iterprof_get_phase_count(profile, ITERATE_PHASE_NETWORKING_POLL), 1);
+    EXPECT_EQ(iterprof_get_phase_total_ns(profile, ITERATE_PHASE_NETWORKING_POLL), 300);
+    EXPECT_EQ(iterprof_get_phase_count(profile, ITERATE_PHASE_DHT), 2);
+    EXPECT_EQ(iterprof_get_phase_total_ns(profile, ITERATE_PHASE_DHT), 5100);
+    EXPECT_EQ(iterprof_get_phase_max_ns(profile, ITERATE_PHASE_DHT), 5000);
+    EXPECT_EQ(iterprof_get_phase_count(profile, ITERATE_PHASE_FRIENDS), 0);
+}
+
+TEST_F(IterateProfile, HistogramBucketsArePowersOfTwo)
+{
+    const std::uint64_t durations[] = {0, 1, 2, 3, 4, 1023, 1024, UINT64_MAX / 2};
+
+    for (const std::uint64_t ns : durations) {
+        const std::uint64_t start = clock.now;
+        clock.now += ns;
+        iterprof_record_phase(profile, ITERATE_PHASE_ITERATE, start);
+        clock.now = 1000;
+    }
+
+    EXPECT_EQ(iterprof_get_phase_bucket(profile, ITERATE_PHASE_ITERATE, 0), 2);  // 0, 1
+    EXPECT_EQ(iterprof_get_phase_bucket(profile, ITERATE_PHASE_ITERATE, 1), 2);  // 2, 3
+    EXPECT_EQ(iterprof_get_phase_bucket(profile, ITERATE_PHASE_ITERATE, 2), 1);  // 4
+    EXPECT_EQ(iterprof_get_phase_bucket(profile, ITERATE_PHASE_ITERATE, 9), 1);  // 1023
+    EXPECT_EQ(iterprof_get_phase_bucket(profile, ITERATE_PHASE_ITERATE, 10), 1);  // 1024
+    EXPECT_EQ(iterprof_get_phase_bucket(profile, ITERATE_PHASE_ITERATE, ITERPROF_NUM_BUCKETS - 1), 1);
+    EXPECT_EQ(iterprof_get_phase_bucket(profile, ITERATE_PHASE_ITERATE, ITERPROF_NUM_BUCKETS), 0);
+}
+
+TEST_F(IterateProfile, BackwardsClockCountsAsZero)
+{
+    iterprof_record_phase(profile, ITERATE_PHASE_DHT, clock.now + 10);
+
+    EXPECT_EQ(iterprof_get_phase_count(profile, ITERATE_PHASE_DHT), 1);
+    EXPECT_EQ(iterprof_get_phase_total_ns(profile, ITERATE_PHASE_DHT), 0);
+}
+
+TEST_F(IterateProfile, PacketsAreKeyedById)
+{
+    std::uint64_t start = iterprof_now(profile);
+    clock.now += 700;
+    iterprof_record_packet(profile, 0x1b, start);
+
+    start = iterprof_now(profile);
+    clock.now += 200;
+    iterprof_record_packet(profile, 0x1b, start);
+
+    start = iterprof_now(profile);
+    clock.now += 50;
+    iterprof_record_packet(profile, 0x02, start);
+
+    EXPECT_EQ(iterprof_get_packet_count(profile, 0x1b), 2);
+    EXPECT_EQ(iterprof_get_packet_total_ns(profile, 0x1b), 900);
+    EXPECT_EQ(iterprof_get_packet_max_ns(profile, 0x1b), 700);
+    EXPECT_EQ(iterprof_get_packet_count(profile, 0x02), 1);
+    EXPECT_EQ(iterprof_get_packet_count(profile, 0xff), 0);
+}
+
+TEST_F(IterateProfile, ResetKeepsTheClock)
+{
+    const std::uint64_t start = iterprof_now(profile);
+    clock.now += 10;
+    iterprof_record_phase(profile, ITERATE_PHASE_FRIENDS, start);
+    iterprof_record_packet(profile, 0x02, start);
+
+    iterprof_reset(profile);
+
+    EXPECT_EQ(iterprof_get_phase_count(profile, ITERATE_PHASE_FRIENDS), 0);
+    EXPECT_EQ(iterprof_get_phase_bucket(profile, ITERATE_PHASE_FRIENDS, 3), 0);
+    EXPECT_EQ(iterprof_get_packet_count(profile, 0x02), 0);
+    EXPECT_EQ(iterprof_now(profile), clock.now);
+}
+
+TEST(IterateProfileSystemClock, IsMonotonic)
+{
+    Iterate_Profile *profile = iterprof_new(os_memory(), nullptr, nullptr);
+    ASSERT_NE(profile, nullptr);
+
+    const std::uint64_t a = iterprof_now(profile);
+    const std::uint64_t b = iterprof_now(profile);
+    EXPECT_NE(a, 0);
+    EXPECT_GE(b, a);
+
+    iterprof_kill(os_memory(), profile);
+}
+
+}  // namespace
@@ -10,12 +10,89 @@
 
 #include <assert.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "atomics.h"
 #include "ccompat.h"
 #include "mem.h"
+#include "mpmc_queue.h"
+
+#define LOGGER_MESSAGE_SIZE 1024
+
+/** Width and precision above this are formatted synchronously. */
+#define LOGGER_MAX_FIELD_WIDTH 4096
+
+typedef enum Log_Arg_Type {
+    LOG_ARG_PERCENT,
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_CHAR,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_POINTER,
+    LOG_ARG_STRING,
+} Log_Arg_Type;
+
+typedef enum Log_Arg_Size {
+    LOG_ARG_SIZE_DEFAULT,
+    LOG_ARG_SIZE_CHAR,
+    LOG_ARG_SIZE_SHORT,
+    LOG_ARG_SIZE_LONG,
+    LOG_ARG_SIZE_LONG_LONG,
+    LOG_ARG_SIZE_INTMAX,
+    LOG_ARG_SIZE_SIZE,
+    LOG_ARG_SIZE_PTRDIFF,
+} Log_Arg_Size;
+
+/**
+ * @brief A conversion specification in a format string.
+ *
+ * Only the subset used in log messages is understood: the `-` and `0` flags,
+ * literal width and precision, and the `diuoxXcfegps%` conversions.
+ */
+typedef struct Log_Spec {
+    /** Number of characters in the specification, including the `%`. */
+    uint32_t length;
+    /** Negative if the value is left-justified. */
+    int width;
+    /** -1 if there is no precision. */
+    int precision;
+    bool zero_pad;
+    Log_Arg_Type type;
+    Log_Arg_Size size;
+    char conversion;
+} Log_Spec;
+
+/**
+ * @brief A message recorded by `logger_write` in async mode.
+ *
+ * The arguments are stored in the order they appear in the format string:
+ * integers as `long long` or `unsigned long long`, floating point numbers as
+ * `double`, pointers as `void *`, and strings as a NUL terminated copy.
+ */
+typedef struct Log_Record {
+    Logger_Level level;
+    uint32_t line;
+    const char *_Nonnull file;
+    const char *_Nonnull func;
+    /** NULL if `data` holds the formatted message instead of arguments. */
+    const char *_Nullable format;
+    uint8_t data[LOGGER_MESSAGE_SIZE];
+} Log_Record;
+
+typedef struct Logger_Async {
+    uint32_t capacity;
+    Log_Record *_Nonnull records;
+    /** Records that `logger_write` can fill. */
+    Mpmc_Queue *_Nonnull free_records;
+    /** Records waiting for `logger_flush`, in the order they were written. */
+    Mpmc_Queue *_Nonnull pending;
+
+    Tox_Atomic_U64 dropped;
+} Logger_Async;
 
 struct Logger {
     const Memory *_Nonnull mem;
@@ -23,8 +100,466 @@ struct Logger {
     logger_cb *_Nullable callback;
     void *_Nullable context;
     void *_Nullable userdata;
+
+    Logger_Async *_Nullable async;
 };
 
+/** @brief Parse the specification starting at the `%` in `p`.
+ *
+ * @retval false if it is not in the subset we can record.
+ */
+static bool log_spec_parse(const char *_Nonnull p, Log_Spec *_Nonnull spec)
+{
+    const char *const start = p;
+    bool left = false;
+
+    spec->width = 0;
+    spec->precision = -1;
+    spec->zero_pad = false;
+    spec->size = LOG_ARG_SIZE_DEFAULT;
+
+    ++p;
+
+    for (;; ++p) {
+        if (*p == '-') {
+            left = true;
+        } else if (*p == '0') {
+            spec->zero_pad = true;
+        } else {
+            break;
+        }
+    }
+
+    while (*p >= '0' && *p <= '9') {
+        spec->width = spec->width * 10 + (*p - '0');
+        ++p;
+
+        if (spec->width > LOGGER_MAX_FIELD_WIDTH) {
+            return false;
+        }
+    }
+
+    if (left) {
+        spec->width = -spec->width;
+    }
+
+    if (*p == '.') {
+        ++p;
+        spec->precision = 0;
+
+        while (*p >= '0' && *p <= '9') {
+            spec->precision = spec->precision * 10 + (*p - '0');
+            ++p;
+
+            if (spec->precision > LOGGER_MAX_FIELD_WIDTH) {
+                return false;
+            }
+        }
+    }
+
+    switch (*p) {
+        case 'h': {
+            ++p;
+            spec->size = LOG_ARG_SIZE_SHORT;
+
+            if (*p == 'h') {
+                ++p;
+                spec->size = LOG_ARG_SIZE_CHAR;
+            }
+
+            break;
+        }
+
+        case 'l': {
+            ++p;
+            spec->size = LOG_ARG_SIZE_LONG;
+
+            if (*p == 'l') {
+                ++p;
+                spec->size = LOG_ARG_SIZE_LONG_LONG;
+            }
+
+            break;
+        }
+
+        case 'j': {
+            ++p;
+            spec->size = LOG_ARG_SIZE_INTMAX;
+            break;
+        }
+
+        case 'z': {
+            ++p;
+            spec->size = LOG_ARG_SIZE_SIZE;
+            break;
+        }
+
+        case 't': {
+            ++p;
+            spec->size = LOG_ARG_SIZE_PTRDIFF;
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    spec->conversion = *p;
+    spec->length = (uint32_t)(p - start) + 1;
+
+    const bool plain = spec->size == LOG_ARG_SIZE_DEFAULT && !spec->zero_pad;
+
+    switch (spec->conversion) {
+        case '%':
+            spec->type = LOG_ARG_PERCENT;
+            return spec->length == 2;
+
+        case 'd':
+        case 'i':
+            spec->type = LOG_ARG_INT;
+            // The `0` flag is ignored for integers with a precision.
+            spec->zero_pad = spec->zero_pad && spec->precision < 0;
+            return true;
+
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            spec->type = LOG_ARG_UINT;
+            spec->zero_pad = spec->zero_pad && spec->precision < 0;
+            return true;
+
+        case 'c':
+            spec->type = LOG_ARG_CHAR;
+            return plain;
+
+        case 'f':
+        case 'e':
+        case 'g':
+            // `l` has no effect on floating point conversions.
+            spec->type = LOG_ARG_DOUBLE;
+            return spec->size == LOG_ARG_SIZE_DEFAULT || spec->size == LOG_ARG_SIZE_LONG;
+
+        case 'p':
+            spec->type = LOG_ARG_POINTER;
+            return plain;
+
+        case 's':
+            spec->type = LOG_ARG_STRING;
+            return plain;
+
+        default:
+            return false;
+    }
+}
+
+static long long log_arg_int(Log_Arg_Size size, va_list *_Nonnull args)
+{
+    switch (size) {
+        case LOG_ARG_SIZE_CHAR:
+            return (signed char)va_arg(*args, int);
+
+        case LOG_ARG_SIZE_SHORT:
+            return (short)va_arg(*args, int);
+
+        case LOG_ARG_SIZE_LONG:
+            return va_arg(*args, long);
+
+        case LOG_ARG_SIZE_LONG_LONG:
+            return va_arg(*args, long long);
+
+        case LOG_ARG_SIZE_INTMAX:
+            return (long long)va_arg(*args, intmax_t);
+
+        case LOG_ARG_SIZE_SIZE:
+            return (long long)va_arg(*args, size_t);
+
+        case LOG_ARG_SIZE_PTRDIFF:
+            return (long long)va_arg(*args, ptrdiff_t);
+
+        case LOG_ARG_SIZE_DEFAULT:
+            break;
+    }
+
+    return va_arg(*args, int);
+}
+
+static unsigned long long log_arg_uint(Log_Arg_Size size, va_list *_Nonnull args)
+{
+    switch (size) {
+        case LOG_ARG_SIZE_CHAR:
+            return (unsigned char)va_arg(*args, unsigned int);
+
+        case LOG_ARG_SIZE_SHORT:
+            return (unsigned short)va_arg(*args, unsigned int);
+
+        case LOG_ARG_SIZE_LONG:
+            return va_arg(*args, unsigned long);
+
+        case LOG_ARG_SIZE_LONG_LONG:
+            return va_arg(*args, unsigned long long);
+
+        case LOG_ARG_SIZE_INTMAX:
+            return (unsigned long long)va_arg(*args, uintmax_t);
+
+        case LOG_ARG_SIZE_SIZE:
+            return (unsigned long long)va_arg(*args, size_t);
+
+        case LOG_ARG_SIZE_PTRDIFF:
+            return (unsigned long long)(size_t)va_arg(*args, ptrdiff_t);
+
+        case LOG_ARG_SIZE_DEFAULT:
+            break;
+    }
+
+    return va_arg(*args, unsigned int);
+}
+
+static bool log_record_put(Log_Record *_Nonnull rec, uint32_t *_Nonnull pos, const void *_Nonnull value, uint32_t size)
+{
+    if (size > sizeof(rec->data) - *pos) {
+        return false;
+    }
+
+    memcpy(&rec->data[*pos], value, size);
+    *pos += size;
+    return true;
+}
+
+static bool log_record_put_string(Log_Record *_Nonnull rec, uint32_t *_Nonnull pos, const char *_Nullable str, int precision)
+{
+    if (str == nullptr) {
+        str = "(null)";
+    }
+
+    // A longer string would be truncated by the message buffer anyway.
+    uint32_t max = LOGGER_MESSAGE_SIZE - 1;
+
+    if (precision >= 0 && (uint32_t)precision < max) {
+        max = (uint32_t)precision;
+    }
+
+    uint32_t length = 0;
+
+    while (length < max && str[length] != '\0') {
+        ++length;
+    }
+
+    if (length + 1 > sizeof(rec->data) - *pos) {
+        return false;
+    }
+
+    memcpy(&rec->data[*pos], str, length);
+    rec->data[*pos + length] = '\0';
+    *pos += length + 1;
+    return true;
+}
+
+/** @brief Copy the arguments of `format` into the record.
+ *
+ * @retval false if the format string or the arguments can't be recorded.
+ */
+static bool log_record_capture(Log_Record *_Nonnull rec, const char *_Nonnull format, va_list *_Nonnull args)
+{
+    uint32_t pos = 0;
+
+    for (const char *p = strchr(format, '%'); p != nullptr; p = strchr(p, '%')) {
+        Log_Spec spec;
+
+        if (!log_spec_parse(p, &spec)) {
+            return false;
+        }
+
+        p += spec.length;
+
+        bool ok = true;
+
+        switch (spec.type) {
+            case LOG_ARG_PERCENT:
+                break;
+
+            case LOG_ARG_INT: {
+                const long long value = log_arg_int(spec.size, args);
+                ok = log_record_put(rec, &pos, &value, sizeof(value));
+                break;
+            }
+
+            case LOG_ARG_UINT: {
+                const unsigned long long value = log_arg_uint(spec.size, args);
+                ok = log_record_put(rec, &pos, &value, sizeof(value));
+                break;
+            }
+
+            case LOG_ARG_CHAR: {
+                const long long value = va_arg(*args, int);
+                ok = log_record_put(rec, &pos, &value, sizeof(value));
+                break;
+            }
+
+            case LOG_ARG_DOUBLE: {
+                const double value = va_arg(*args, double);
+                ok = log_record_put(rec, &pos, &value, sizeof(value));
+                break;
+            }
+
+            case LOG_ARG_POINTER: {
+                const void *value = va_arg(*args, void *);
+                ok = log_record_put(rec, &pos, &value, sizeof(value));
+                break;
+            }
+
+            case LOG_ARG_STRING: {
+                ok = log_record_put_string(rec, &pos, va_arg(*args, const char *), spec.precision);
+                break;
+            }
+        }
+
+        if (!ok) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** @brief Format one recorded argument, like `snprintf` would. */
+static int log_spec_format(const Log_Spec *_Nonnull spec, const uint8_t *_Nonnull value, char *_Nonnull buf, size_t size)
+{
+    const bool zero = spec->zero_pad;
+
+    switch (spec->type) {
+        case LOG_ARG_PERCENT:
+            return snprintf(buf, size, "%%");
+
+        case LOG_ARG_INT: {
+            long long v;
+            memcpy(&v, value, sizeof(v));
+            return zero ? snprintf(buf, size, "%0*lld", spec->width, v)
+                   : snprintf(buf, size, "%*.*lld", spec->width, spec->precision, v);
+        }
+
+        case LOG_ARG_UINT: {
+            unsigned long long v;
+            memcpy(&v, value, sizeof(v));
+
+            switch (spec->conversion) {
+                case 'o':
+                    return zero ? snprintf(buf, size, "%0*llo", spec->width, v)
+                           : snprintf(buf, size, "%*.*llo", spec->width, spec->precision, v);
+
+                case 'x':
+                    return zero ? snprintf(buf, size, "%0*llx", spec->width, v)
+                           : snprintf(buf, size, "%*.*llx", spec->width, spec->precision, v);
+
+                case 'X':
+                    return zero ? snprintf(buf, size, "%0*llX", spec->width, v)
+                           : snprintf(buf, size, "%*.*llX", spec->width, spec->precision, v);
+
+                default:
+                    return zero ? snprintf(buf, size, "%0*llu", spec->width, v)
+                           : snprintf(buf, size, "%*.*llu", spec->width, spec->precision, v);
+            }
+        }
+
+        case LOG_ARG_CHAR: {
+            long long v;
+            memcpy(&v, value, sizeof(v));
+            return snprintf(buf, size, "%*c", spec->width, (int)v);
+        }
+
+        case LOG_ARG_DOUBLE: {
+            double v;
+            memcpy(&v, value, sizeof(v));
+
+            switch (spec->conversion) {
+                case 'e':
+                    return snprintf(buf, size, zero ? "%0*.*e" : "%*.*e", spec->width, spec->precision, v);
+
+                case 'g':
+                    return snprintf(buf, size, zero ? "%0*.*g" : "%*.*g", spec->width, spec->precision, v);
+
+                default:
+                    return snprintf(buf, size, zero ? "%0*.*f" : "%*.*f", spec->width, spec->precision, v);
+            }
+        }
+
+        case LOG_ARG_POINTER: {
+            void *v;
+            memcpy(&v, value, sizeof(v));
+            return snprintf(buf, size, "%*p", spec->width, v);
+        }
+
+        case LOG_ARG_STRING:
+            return snprintf(buf, size, "%*s", spec->width, (const char *)value);
+    }
+
+    return 0;
+}
+
+/** @brief Number of bytes the recorded argument takes in the record. */
+static uint32_t log_spec_value_size(const Log_Spec *_Nonnull spec, const uint8_t *_Nonnull value)
+{
+    switch (spec->type) {
+        case LOG_ARG_PERCENT:
+            return 0;
+
+        case LOG_ARG_INT:
+        case LOG_ARG_UINT:
+        case LOG_ARG_CHAR:
+            return sizeof(long long);
+
+        case LOG_ARG_DOUBLE:
+            return sizeof(double);
+
+        case LOG_ARG_POINTER:
+            return sizeof(void *);
+
+        case LOG_ARG_STRING:
+            return (uint32_t)strlen((const char *)value) + 1;
+    }
+
+    return 0;
+}
+
+/** @brief Format a record captured by `log_record_capture` into `msg`. */
+static void log_record_format(const Log_Record *_Nonnull rec, const char *_Nonnull format, char *_Nonnull msg, size_t size)
+{
+    size_t length = 0;
+    uint32_t pos = 0;
+    const char *p = format;
+
+    while (*p != '\0' && length + 1 < size) {
+        const char *const next = strchr(p, '%');
+        const size_t literal = next != nullptr ? (size_t)(next - p) : strlen(p);
+        const size_t copy = literal < size - 1 - length ? literal : size - 1 - length;
+
+        memcpy(&msg[length], p, copy);
+        length += copy;
+
+        if (next == nullptr || length + 1 >= size) {
+            break;
+        }
+
+        Log_Spec spec;
+
+        if (!log_spec_parse(next, &spec)) {
+            // Can't happen: the record was captured from the same format.
+            break;
+        }
+
+        const int written = log_spec_format(&spec, &rec->data[pos], &msg[length], size - length);
+
+        if (written > 0) {
+            length += (size_t)written < size - 1 - length ? (size_t)written : size - 1 - length;
+        }
+
+        pos += log_spec_value_size(&spec, &rec->data[pos]);
+        p = next + spec.length;
+    }
+
+    msg[length] = '\0';
+}
+
 /*
  * Public Functions
  */
@@ -42,12 +577,32 @@ Logger *logger_new(const Memory *mem)
     return log;
 }
 
+static void logger_async_free(const Memory *_Nonnull mem, Logger_Async *_Nullable async)
+{
+    if (async == nullptr) {
+        return;
+    }
+
+    mpmc_queue_free(async->pending);
+    mpmc_queue_free(async->free_records);
+    mem_delete(mem, async->records);
+    mem_delete(mem, async);
+}
+
 void logger_kill(Logger *log)
 {
     if (log == nullptr) {
         return;
     }
 
+    if (log->async != nullptr) {
+        while (logger_flush(log) > 0) {
+            continue;
+        }
+
+        logger_async_free(log->mem, log->async);
+    }
+
     mem_delete(log->mem, log);
 }
 
@@ -59,13 +614,52 @@ void logger_callback_log(Logger *log, logger_cb *function, void *context, void *
     log->userdata = userdata;
 }
 
-void logger_write(const Logger *log, Logger_Level level, const char *file, uint32_t line, const char *func,
-                  const char *format, ...)
+bool logger_enable_async(Logger *log, uint32_t capacity)
 {
-    if (log == nullptr) {
-        return;
+    assert(log != nullptr);
+
+    if (log->async != nullptr || capacity == 0) {
+        return false;
+    }
+
+    Logger_Async *async = (Logger_Async *)mem_alloc(log->mem, sizeof(Logger_Async));
+
+    if (async == nullptr) {
+        return false;
+    }
+
+    async->capacity = capacity;
+    async->records = (Log_Record *)mem_valloc(log->mem, capacity, sizeof(Log_Record));
+    async->free_records = mpmc_queue_new(log->mem, capacity);
+    async->pending = mpmc_queue_new(log->mem, capacity);
+
+    if (async->records == nullptr || async->free_records == nullptr || async->pending == nullptr) {
+        logger_async_free(log->mem, async);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < capacity; ++i) {
+        mpmc_queue_push(async->free_records, &async->records[i]);
+    }
+
+    log->async = async;
+    return true;
+}
+
+uint64_t logger_dropped(const Logger *log)
+{
+    assert(log != nullptr);
+
+    if (log->async == nullptr) {
+        return 0;
     }
 
+    return tox_atomic_u64_load(&log->async->dropped);
+}
+
+static void logger_deliver(const Logger *_Nonnull log, Logger_Level level, const char *_Nonnull file, uint32_t line,
+                           const char *_Nonnull func, const char *_Nonnull msg)
+{
     if (log->callback == nullptr) {
         return;
     }
@@ -84,14 +678,104 @@ void logger_write(const Logger *log, Logger_Level level, const char *file, uint3
     file = windows_filename != nullptr ? windows_filename + 1 : file;
 #endif /* WIN32 */
 
-    // Format message
-    char msg[1024];
+    log->callback(log->context, level, file, line, func, msg, log->userdata);
+}
+
+uint32_t logger_flush(Logger *log)
+{
+    assert(log != nullptr);
+
+    Logger_Async *async = log->async;
+
+    if (async == nullptr) {
+        return 0;
+    }
+
+    uint32_t delivered = 0;
+
+    while (delivered < async->capacity) {
+        Log_Record *rec = (Log_Record *)mpmc_queue_pop(async->pending);
+
+        if (rec == nullptr) {
+            break;
+        }
+
+        if (rec->format != nullptr) {
+            char msg[LOGGER_MESSAGE_SIZE];
+            log_record_format(rec, rec->format, msg, sizeof(msg));
+            logger_deliver(log, rec->level, rec->file, rec->line, rec->func, msg);
+        } else {
+            logger_deliver(log, rec->level, rec->file, rec->line, rec->func, (const char *)rec->data);
+        }
+
+        // Never full: there are only as many records as slots.
+        mpmc_queue_push(async->free_records, rec);
+        ++delivered;
+    }
+
+    return delivered;
+}
+
+/**
+ * `args` and `retry` are the same arguments. `retry` is used to format the
+ * message here when its arguments can't be recorded.
+ */
+GNU_PRINTF(6, 0)
+static void logger_write_async(Logger_Async *_Nonnull async, Logger_Level level, const char *_Nonnull file,
+                               uint32_t line, const char *_Nonnull func, const char *_Nonnull format,
+                               va_list *_Nonnull args, va_list *_Nonnull retry)
+{
+    Log_Record *rec = (Log_Record *)mpmc_queue_pop(async->free_records);
+
+    if (rec == nullptr) {
+        tox_atomic_u64_increment(&async->dropped);
+        return;
+    }
+
+    rec->level = level;
+    rec->file = file;
+    rec->line = line;
+    rec->func = func;
+    rec->format = format;
+
+    if (!log_record_capture(rec, format, args)) {
+        rec->format = nullptr;
+        vsnprintf((char *)rec->data, sizeof(rec->data), format, *retry);
+    }
+
+    mpmc_queue_push(async->pending, rec);
+}
+
+void logger_write(const Logger *log, Logger_Level level, const char *file, uint32_t line, const char *func,
+                  const char *format, ...)
+{
+    if (log == nullptr) {
+        return;
+    }
+
+    if (log->callback == nullptr) {
+        return;
+    }
+
     va_list args;
+
+    if (log->async != nullptr) {
+        va_list retry;
+        va_start(args, format);
+        va_copy(retry, args);
+        logger_write_async(log->async, level, file, line, func, format, &args, &retry);
+        va_end(retry);
+        va_end(args);
+        return;
+    }
+
+    // Format message
+    char msg[LOGGER_MESSAGE_SIZE];
     va_start(args, format);
     vsnprintf(msg, sizeof(msg), format, args);
     va_end(args);
 
-    log->callback(log->context, level, file, line, func, msg, log->userdata);
+    logger_deliver(log, level, file, line, func, msg);
 }
 
 void logger_abort(void)
@@ -9,6 +9,7 @@
 #ifndef C_TOXCORE_TOXCORE_LOGGER_H
 #define C_TOXCORE_TOXCORE_LOGGER_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "attributes.h"
@@ -42,7 +43,8 @@ typedef void logger_cb(void *_Nullable context, Logger_Level level, const char *
 Logger *_Nullable logger_new(const Memory *_Nonnull mem);
 
 /**
- * Frees all resources associated with the logger.
+ * Frees all resources associated with the logger. Messages recorded in async
+ * mode are delivered first.
  */
 void logger_kill(Logger *_Nullable log);
 /**
@@ -50,6 +52,34 @@ void logger_kill(Logger *_Nullable log);
  * The context parameter is passed to the callback as first argument.
  */
 void logger_callback_log(Logger *_Nonnull log, logger_cb *_Nullable function, void *_Nullable context, void *_Nullable userdata);
+
+/** @brief Defer formatting and delivery of messages to `logger_flush`.
+ *
+ * After this, `logger_write` only records the format string and a copy of its
+ * arguments in one of `capacity` preallocated records and returns. The message
+ * is formatted and passed to the callback by whichever thread next calls
+ * `logger_flush`. Messages written while all records are waiting to be flushed
+ * are dropped and counted.
+ *
+ * Must be called before any other thread uses the logger. Can only be called
+ * once.
+ *
+ * @retval false if memory allocation failed or async mode was already enabled.
+ */
+bool logger_enable_async(Logger *_Nonnull log, uint32_t capacity);
+
+/** @brief Format and deliver messages recorded in async mode.
+ *
+ * Safe to call from any thread, concurrently with `logger_write`. Delivers at
+ * most as many messages as there are records, so that a thread that logs in a
+ * loop can't keep it from returning.
+ *
+ * @return the number of messages delivered.
+ */
+uint32_t logger_flush(Logger *_Nonnull log);
+
+/** @brief Number of messages dropped in async mode because no record was free. */
+uint64_t logger_dropped(const Logger *_Nonnull log);
 /** @brief Main write function. If logging is disabled, this does nothing.
  *
  * If the logger is NULL and `NDEBUG` is not defined, this writes to stderr.
@@ -0,0 +1,129 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// Packet throughput of a loop that logs a trace line for every packet, the way
+// net_log_data does, with logging off, synchronous, and async with a client
+// thread flushing.
+//
+// Arguments:
+// - mode: 0 for no log callback, 1 for synchronous logging, 2 for async.
+//
+// Time and items_per_second are the CPU time of the thread handling packets,
+// so they don't include the flushing thread.
+//
+// Reported counters:
+// - dropped: messages dropped in async mode because the flushing thread fell
+//   behind.
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "logger.h"
+#include "os_memory.h"
+
+namespace {
+
+constexpr std::uint32_t kAsyncCapacity = 1024;
+
+struct LoggerDeleter {
+    void operator()(Logger *log) const { logger_kill(log); }
+};
+using LoggerPtr = std::unique_ptr<Logger, LoggerDeleter>;
+
+struct FileCloser {
+    void operator()(std::FILE *file) const { std::fclose(file); }
+};
+
+// Writes every message to /dev/null, like a client writing its log to a file.
+void write_message(void *context, Logger_Level level, const char *file, std::uint32_t line,
+    const char *func, const char *message, void *userdata)
+{
+    std::fprintf(static_cast<std::FILE *>(userdata), "%s:%u(%s): %s\n", file, line, func, message);
+}
+
+// Stands in for the packet handling the log line is written from.
+std::uint32_t handle_packet(const std::array<std::uint8_t, 1372> &packet)
+{
+    std::uint32_t sum = 0;
+
+    for (const std::uint8_t byte : packet) {
+        sum += byte;
+    }
+
+    return sum;
+}
+
+void BM_PacketLogging(benchmark::State &state)
+{
+    const std::int64_t mode = state.range(0);
+
+    std::unique_ptr<std::FILE, FileCloser> sink{std::fopen("/dev/null", "w")};
+    LoggerPtr log{logger_new(os_memory())};
+
+    if (sink == nullptr || log == nullptr) {
+        state.SkipWithError("failed to create logger");
+        return;
+    }
+
+    if (mode != 0) {
+        logger_callback_log(log.get(), write_message, nullptr, sink.get());
+    }
+
+    if (mode == 2 && !logger_enable_async(log.get(), kAsyncCapacity)) {
+        state.SkipWithError("failed to enable async logging");
+        return;
+    }
+
+    std::atomic<bool> running{true};
+    std::thread flusher;
+
+    if (mode == 2) {
+        flusher = std::thread([&log, &running]() {
+            while (running.load(std::memory_order_relaxed)) {
+                if (logger_flush(log.get()) == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::array<std::uint8_t, 1372> packet;
+    std::memset(packet.data(), 0x5a, packet.size());
+    packet[0] = 0x1b;
+
+    const char *ip = "192.168.100.200";
+    std::uint16_t port = 33445;
+
+    for (auto _ : state) {
+        const std::uint32_t sum = handle_packet(packet);
+        benchmark::DoNotOptimize(sum);
+
+        logger_write(log.get(), LOGGER_LEVEL_TRACE, __FILE__, __LINE__, __func__,
+            "[%02x = %-21s] %s %3u%c %s:%u (%d: %s) | %08x", packet[0], "CRYPTO_DATA", "=>O",
+            static_cast<unsigned>(packet.size() % 1000), '=', ip, port, 0, "OK", sum);
+        ++port;
+    }
+
+    running = false;
+
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["dropped"] = static_cast<double>(logger_dropped(log.get()));
+}
+
+BENCHMARK(BM_PacketLogging)->ArgName("mode")->Arg(0)->Arg(1)->Arg(2);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,201 @@
+#include "logger.h"
+
+#include <gtest/gtest.h>
+
+#include <cinttypes>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "os_memory.h"
+
+namespace {
+
+struct LoggerDeleter {
+    void operator()(Logger *log) const { logger_kill(log); }
+};
+using LoggerPtr = std::unique_ptr<Logger, LoggerDeleter>;
+
+struct Message {
+    Logger_Level level;
+    std::string file;
+    std::uint32_t line;
+    std::string func;
+    std::string text;
+};
+
+void record_message(void *context, Logger_Level level, const char *file, std::uint32_t line,
+    const char *func, const char *message, void *userdata)
+{
+    static_cast<std::vector<Message> *>(userdata)->push_back({level, file, line, func, message});
+}
+
+LoggerPtr new_logger(std::vector<Message> &messages, std::uint32_t async_capacity = 0)
+{
+    LoggerPtr log{logger_new(os_memory())};
+
+    if (log != nullptr) {
+        logger_callback_log(log.get(), record_message, nullptr, &messages);
+
+        if (async_capacity != 0 && !logger_enable_async(log.get(), async_capacity)) {
+            log.reset();
+        }
+    }
+
+    return log;
+}
+
+/** Writes a message with a synchronous and an async logger and compares the results. */
+void expect_same_message(const std::function<void(const Logger *)> &write)
+{
+    std::vector<Message> sync_messages;
+    std::vector<Message> async_messages;
+    LoggerPtr sync_log = new_logger(sync_messages);
+    LoggerPtr async_log = new_logger(async_messages, 4);
+    ASSERT_NE(sync_log, nullptr);
+    ASSERT_NE(async_log, nullptr);
+
+    write(sync_log.get());
+    write(async_log.get());
+
+    ASSERT_EQ(sync_messages.size(), 1);
+    EXPECT_TRUE(async_messages.empty());
+    EXPECT_EQ(logger_flush(async_log.get()), 1);
+    ASSERT_EQ(async_messages.size(), 1);
+    EXPECT_EQ(async_messages[0].text, sync_messages[0].text);
+    EXPECT_EQ(async_messages[0].file, sync_messages[0].file);
+    EXPECT_EQ(async_messages[0].line, sync_messages[0].line);
+    EXPECT_EQ(async_messages[0].func, sync_messages[0].func);
+    EXPECT_EQ(async_messages[0].level, sync_messages[0].level);
+}
+
+const int kPointerTarget = 0;
+
+#define EXPECT_SAME_MESSAGE(...)                                                               \
+    expect_same_message([&](const Logger *log) {                                               \
+        logger_write(log, LOGGER_LEVEL_INFO, "dir/file.c", __LINE__, __func__, __VA_ARGS__); \
+    })
+
+TEST(Logger, AsyncFormatsLikeSync)
+{
+    EXPECT_SAME_MESSAGE("no arguments");
+    EXPECT_SAME_MESSAGE("100%% done");
+    EXPECT_SAME_MESSAGE("%d %i %u %x %X %o", -42, 7, 42U, 0xbeefU, 0xbeefU, 8U);
+    EXPECT_SAME_MESSAGE("%02x %04x %3u %-5d| %.3d %08u", 5U, 0xabU, 7U, -3, 4, 12U);
+    EXPECT_SAME_MESSAGE("%hhu %hhd %hu %hd", 300, 200, 70000, 40000);
+    EXPECT_SAME_MESSAGE("%ld %lu %lld %llu", -1L, 1UL << 31, -(1LL << 40), ~0ULL);
+    EXPECT_SAME_MESSAGE("%zu %jd %td", sizeof(Message), INTMAX_MIN, PTRDIFF_MAX);
+    EXPECT_SAME_MESSAGE("%" PRIu64 " %" PRId32 " %" PRIx16, UINT64_MAX, INT32_MIN, UINT16_C(0xfff));
+    EXPECT_SAME_MESSAGE("%f %.2f %e %g %10.3lf", 1.5, 3.14159, 12345.678, 0.0001, -2.25);
+    EXPECT_SAME_MESSAGE("%c%c %3c", 'o', 'k', '!');
+    EXPECT_SAME_MESSAGE("%p %p", static_cast<const void *>(&kPointerTarget), nullptr);
+    EXPECT_SAME_MESSAGE("[%s] [%-21s] [%8s] [%.3s]", "abc", "left", "right", "truncated");
+}
+
+TEST(Logger, AsyncFallsBackToFormattingUnsupportedSpecs)
+{
+    EXPECT_SAME_MESSAGE("%*d|%-*s|", 5, 42, 4, "ab");
+    EXPECT_SAME_MESSAGE("%+d % d %#x", 5, 6, 255U);
+    EXPECT_SAME_MESSAGE("%Lf", 1.25L);
+}
+
+TEST(Logger, AsyncTruncatesLongMessages)
+{
+    const std::string long_string(2000, 'x');
+    EXPECT_SAME_MESSAGE("%s", long_string.c_str());
+    EXPECT_SAME_MESSAGE("%s %s %d", long_string.c_str(), long_string.c_str(), 1);
+    EXPECT_SAME_MESSAGE("%d %s", 1, long_string.c_str());
+}
+
+TEST(Logger, AsyncDoesNotKeepPointersToArguments)
+{
+    std::vector<Message> messages;
+    LoggerPtr log = new_logger(messages, 4);
+    ASSERT_NE(log, nullptr);
+
+    std::string name = "before";
+    logger_write(log.get(), LOGGER_LEVEL_INFO, "file.c", 1, "func", "name: %s", name.c_str());
+    name = "after!";
+
+    EXPECT_EQ(logger_flush(log.get()), 1);
+    ASSERT_EQ(messages.size(), 1);
+    EXPECT_EQ(messages[0].text, "name: before");
+}
+
+TEST(Logger, AsyncDropsMessagesWhenFull)
+{
+    std::vector<Message> messages;
+    LoggerPtr log = new_logger(messages, 2);
+    ASSERT_NE(log, nullptr);
+    EXPECT_FALSE(logger_enable_async(log.get(), 2));
+
+    for (int i = 0; i < 5; ++i) {
+        logger_write(log.get(), LOGGER_LEVEL_INFO, "file.c", 1, "func", "message %d", i);
+    }
+
+    EXPECT_EQ(logger_dropped(log.get()), 3);
+    EXPECT_EQ(logger_flush(log.get()), 2);
+    ASSERT_EQ(messages.size(), 2);
+    EXPECT_EQ(messages[0].text, "message 0");
+    EXPECT_EQ(messages[1].text, "message 1");
+
+    // Flushed records are reused.
+    logger_write(log.get(), LOGGER_LEVEL_INFO, "file.c", 1, "func", "message %d", 5);
+    EXPECT_EQ(logger_flush(log.get()), 1);
+    EXPECT_EQ(messages.back().text, "message 5");
+    EXPECT_EQ(logger_dropped(log.get()), 3);
+}
+
+TEST(Logger, KillDeliversPendingMessages)
+{
+    std::vector<Message> messages;
+    LoggerPtr log = new_logger(messages, 4);
+    ASSERT_NE(log, nullptr);
+
+    logger_write(log.get(), LOGGER_LEVEL_WARNING, "file.c", 1, "func", "pending");
+    EXPECT_TRUE(messages.empty());
+
+    log.reset();
+    ASSERT_EQ(messages.size(), 1);
+    EXPECT_EQ(messages[0].text, "pending");
+}
+
+TEST(Logger, AsyncDeliversMessagesFromManyThreads)
+{
+    std::vector<Message> messages;
+    LoggerPtr log = new_logger(messages, 64);
+    ASSERT_NE(log, nullptr);
+
+    constexpr int kThreads = 4;
+    constexpr int kMessages = 1000;
+
+    std::vector<std::thread> writers;
+
+    for (int t = 0; t < kThreads; ++t) {
+        writers.emplace_back([&log, t]() {
+            for (int i = 0; i < kMessages; ++i) {
+                logger_write(log.get(), LOGGER_LEVEL_INFO, "file.c", 1, "func", "%d:%d", t, i);
+            }
+        });
+    }
+
+    // Only this thread flushes, so the callback needs no locking.
+    std::uint64_t delivered = 0;
+
+    while (delivered + logger_dropped(log.get()) < kThreads * kMessages) {
+        delivered += logger_flush(log.get());
+    }
+
+    for (std::thread &writer : writers) {
+        writer.join();
+    }
+
+    delivered += logger_flush(log.get());
+    EXPECT_EQ(delivered, messages.size());
+    EXPECT_EQ(delivered + logger_dropped(log.get()), kThreads * kMessages);
+}
+
+}  // namespace
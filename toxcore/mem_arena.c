@@ -0,0 +1,224 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+#include "mem_arena.h"
+
+#include <string.h>
+
+#include "ccompat.h"
+#include "mem.h"
+
+/** Size of the first chunk. Later chunks double the arena's capacity. */
+#define MEM_ARENA_MIN_CHUNK_SIZE 4096
+
+/**
+ * Alignment of all allocations. Each allocation is preceded by this many bytes
+ * holding its size, which `realloc` needs to copy the old contents.
+ */
+#define MEM_ARENA_ALIGN 16
+
+typedef struct Mem_Arena_Chunk {
+    struct Mem_Arena_Chunk *_Nullable next;
+    uint32_t size;
+    uint32_t used;
+    uint8_t data[];
+} Mem_Arena_Chunk;
+
+struct Mem_Arena {
+    const Memory *_Nonnull mem;
+    Memory view;
+
+    Mem_Arena_Chunk *_Nullable head;
+    /** The chunk allocations currently come from. Chunks after it are unused. */
+    Mem_Arena_Chunk *_Nullable current;
+    uint64_t capacity;
+};
+
+static void *_Nullable chunk_alloc(Mem_Arena_Chunk *_Nonnull chunk, uint32_t size)
+{
+    const uintptr_t data = (uintptr_t)chunk->data;
+    const uintptr_t start = (data + chunk->used + MEM_ARENA_ALIGN - 1) & ~(uintptr_t)(MEM_ARENA_ALIGN - 1);
+    const uintptr_t ptr = start + MEM_ARENA_ALIGN;
+
+    if (ptr - data > chunk->size || chunk->size - (ptr - data) < size) {
+        return nullptr;
+    }
+
+    memcpy((void *)(ptr - MEM_ARENA_ALIGN), &size, sizeof(size));
+    chunk->used = (uint32_t)(ptr - data + size);
+    return (void *)ptr;
+}
+
+static uint32_t alloc_size(const void *_Nonnull ptr)
+{
+    uint32_t size;
+    memcpy(&size, (const uint8_t *)ptr - MEM_ARENA_ALIGN, sizeof(size));
+    return size;
+}
+
+static Mem_Arena_Chunk *_Nullable chunk_new(Mem_Arena *_Nonnull arena, uint32_t min_size)
+{
+    uint64_t size = arena->capacity > MEM_ARENA_MIN_CHUNK_SIZE ? arena->capacity : MEM_ARENA_MIN_CHUNK_SIZE;
+
+    if (size < min_size) {
+        size = min_size;
+    }
+
+    if (size > UINT32_MAX - sizeof(Mem_Arena_Chunk)) {
+        size = UINT32_MAX - sizeof(Mem_Arena_Chunk);
+    }
+
+    Mem_Arena_Chunk *chunk = (Mem_Arena_Chunk *)mem_balloc(arena->mem, (uint32_t)(sizeof(Mem_Arena_Chunk) + size));
+
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+
+    chunk->size = (uint32_t)size;
+    chunk->used = 0;
+
+    if (arena->current == nullptr) {
+        chunk->next = arena->head;
+        arena->head = chunk;
+    } else {
+        chunk->next = arena->current->next;
+        arena->current->next = chunk;
+    }
+
+    arena->current = chunk;
+    arena->capacity += size;
+    return chunk;
+}
+
+static void *_Nullable arena_malloc(void *_Nullable self, uint32_t size)
+{
+    Mem_Arena *arena = (Mem_Arena *)self;
+
+    if (size > UINT32_MAX - sizeof(Mem_Arena_Chunk) - 2 * MEM_ARENA_ALIGN) {
+        return nullptr;
+    }
+
+    if (arena->current != nullptr) {
+        void *ptr = chunk_alloc(arena->current, size);
+
+        if (ptr != nullptr) {
+            return ptr;
+        }
+
+        Mem_Arena_Chunk *next = arena->current->next;
+
+        if (next != nullptr) {
+            next->used = 0;
+            ptr = chunk_alloc(next, size);
+
+            if (ptr != nullptr) {
+                arena->current = next;
+                return ptr;
+            }
+        }
+    }
+
+    // Room for the size header and for aligning the start of the chunk.
+    Mem_Arena_Chunk *chunk = chunk_new(arena, size + 2 * MEM_ARENA_ALIGN);
+
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+
+    return chunk_alloc(chunk, size);
+}
+
+static void *_Nullable arena_realloc(void *_Nullable self, void *_Nullable ptr, uint32_t size)
+{
+    Mem_Arena *arena = (Mem_Arena *)self;
+
+    if (ptr == nullptr) {
+        return arena_malloc(self, size);
+    }
+
+    const uint32_t old_size = alloc_size(ptr);
+    Mem_Arena_Chunk *current = arena->current;
+
+    if (current != nullptr && (uint8_t *)ptr + old_size == current->data + current->used) {
+        // The most recent allocation: grow or shrink it in place.
+        const uint32_t offset = (uint32_t)((uint8_t *)ptr - current->data);
+
+        if (current->size - offset >= size) {
+            memcpy((uint8_t *)ptr - MEM_ARENA_ALIGN, &size, sizeof(size));
+            current->used = offset + size;
+            return ptr;
+        }
+    }
+
+    void *new_ptr = arena_malloc(self, size);
+
+    if (new_ptr == nullptr) {
+        return nullptr;
+    }
+
+    memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+    return new_ptr;
+}
+
+static void arena_dealloc(void *_Nullable self, void *_Nullable ptr)
+{
+    // Freed all at once by mem_arena_reset.
+}
+
+static const Memory_Funcs mem_arena_funcs = {
+    arena_malloc,
+    arena_realloc,
+    arena_dealloc,
+};
+
+Mem_Arena *mem_arena_new(const Memory *mem)
+{
+    Mem_Arena *arena = (Mem_Arena *)mem_alloc(mem, sizeof(Mem_Arena));
+
+    if (arena == nullptr) {
+        return nullptr;
+    }
+
+    arena->mem = mem;
+    arena->view.funcs = &mem_arena_funcs;
+    arena->view.user_data = arena;
+    return arena;
+}
+
+void mem_arena_free(Mem_Arena *arena)
+{
+    if (arena == nullptr) {
+        return;
+    }
+
+    Mem_Arena_Chunk *chunk = arena->head;
+
+    while (chunk != nullptr) {
+        Mem_Arena_Chunk *next = chunk->next;
+        mem_delete(arena->mem, chunk);
+        chunk = next;
+    }
+
+    mem_delete(arena->mem, arena);
+}
+
+const Memory *mem_arena_get_memory(const Mem_Arena *arena)
+{
+    return &arena->view;
+}
+
+void mem_arena_reset(Mem_Arena *arena)
+{
+    // Later chunks are reset when allocation moves on to them.
+    arena->current = arena->head;
+
+    if (arena->current != nullptr) {
+        arena->current->used = 0;
+    }
+}
+
+uint64_t mem_arena_capacity(const Mem_Arena *arena)
+{
+    return arena->capacity;
+}
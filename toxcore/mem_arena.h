@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+/**
+ * Bump allocator for short-lived objects that are all freed together.
+ */
+#ifndef C_TOXCORE_TOXCORE_MEM_ARENA_H
+#define C_TOXCORE_TOXCORE_MEM_ARENA_H
+
+#include <stdint.h>
+
+#include "attributes.h"
+#include "mem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A memory arena.
+ *
+ * Allocations are carved out of large chunks obtained from a backing
+ * allocator. Freeing a single allocation does nothing; all of them are
+ * released at once by `mem_arena_reset`, which keeps the chunks for reuse. Once
+ * the arena has grown to the size a workload needs, allocating from it no
+ * longer touches the backing allocator.
+ */
+typedef struct Mem_Arena Mem_Arena;
+
+/**
+ * @brief Create an empty arena.
+ *
+ * @param mem The backing allocator for the arena's chunks.
+ */
+Mem_Arena *_Nullable mem_arena_new(const Memory *_Nonnull mem);
+
+/** @brief Free the arena and everything allocated from it. */
+void mem_arena_free(Mem_Arena *_Nullable arena);
+
+/**
+ * @brief An allocator that allocates from the arena.
+ *
+ * It can be passed to any code that takes a `Memory`. Deallocation through it
+ * is a no-op, and reallocation copies unless the block is the most recent
+ * allocation.
+ */
+const Memory *_Nonnull mem_arena_get_memory(const Mem_Arena *_Nonnull arena);
+
+/**
+ * @brief Release all allocations at once, in constant time.
+ *
+ * All pointers obtained from the arena become invalid.
+ */
+void mem_arena_reset(Mem_Arena *_Nonnull arena);
+
+/** @brief Total number of bytes the arena holds in chunks. */
+uint64_t mem_arena_capacity(const Mem_Arena *_Nonnull arena);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* C_TOXCORE_TOXCORE_MEM_ARENA_H */
@@ -0,0 +1,122 @@
+#include "mem_arena.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "attributes.h"
+#include "mem.h"
+#include "os_memory.h"
+
+namespace {
+
+class MemArenaTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        arena = mem_arena_new(os_memory());
+        ASSERT_NE(arena, nullptr);
+        mem = mem_arena_get_memory(arena);
+    }
+
+    void TearDown() override { mem_arena_free(arena); }
+
+    Mem_Arena *_Nullable arena = nullptr;
+    const Memory *_Nullable mem = nullptr;
+};
+
+TEST_F(MemArenaTest, AllocationsAreAlignedAndDistinct)
+{
+    std::vector<std::uint8_t *> ptrs;
+    for (std::uint32_t size = 1; size < 100; ++size) {
+        auto *ptr = static_cast<std::uint8_t *>(mem_balloc(mem, size));
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % 16, 0);
+        std::memset(ptr, static_cast<int>(size), size);
+        ptrs.push_back(ptr);
+    }
+
+    for (std::uint32_t size = 1; size < 100; ++size) {
+        EXPECT_EQ(ptrs[size - 1][0], size);
+        EXPECT_EQ(ptrs[size - 1][size - 1], size);
+    }
+}
+
+TEST_F(MemArenaTest, ResetReusesChunks)
+{
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 1000; ++i) {
+            ASSERT_NE(mem_balloc(mem, 100), nullptr);
+        }
+        mem_arena_reset(arena);
+    }
+
+    const std::uint64_t capacity = mem_arena_capacity(arena);
+
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 1000; ++i) {
+            ASSERT_NE(mem_balloc(mem, 100), nullptr);
+        }
+        mem_arena_reset(arena);
+    }
+
+    EXPECT_EQ(mem_arena_capacity(arena), capacity);
+}
+
+TEST_F(MemArenaTest, ReallocGrowsLastAllocationInPlace)
+{
+    auto *ptr = static_cast<std::uint8_t *>(mem_balloc(mem, 10));
+    ASSERT_NE(ptr, nullptr);
+    std::memset(ptr, 7, 10);
+
+    auto *grown = static_cast<std::uint8_t *>(mem_brealloc(mem, ptr, 100));
+    EXPECT_EQ(grown, ptr);
+    EXPECT_EQ(grown[9], 7);
+}
+
+TEST_F(MemArenaTest, ReallocCopiesEarlierAllocation)
+{
+    auto *ptr = static_cast<std::uint8_t *>(mem_balloc(mem, 10));
+    ASSERT_NE(ptr, nullptr);
+    std::memset(ptr, 7, 10);
+    ASSERT_NE(mem_balloc(mem, 10), nullptr);
+
+    auto *grown = static_cast<std::uint8_t *>(mem_brealloc(mem, ptr, 100));
+    ASSERT_NE(grown, nullptr);
+    EXPECT_NE(grown, ptr);
+    EXPECT_EQ(grown[0], 7);
+    EXPECT_EQ(grown[9], 7);
+}
+
+TEST_F(MemArenaTest, LargeAllocations)
+{
+    auto *small = static_cast<std::uint8_t *>(mem_balloc(mem, 16));
+    ASSERT_NE(small, nullptr);
+    small[0] = 1;
+
+    auto *large = static_cast<std::uint8_t *>(mem_balloc(mem, 1024 * 1024));
+    ASSERT_NE(large, nullptr);
+    std::memset(large, 2, 1024 * 1024);
+
+    EXPECT_EQ(small[0], 1);
+    EXPECT_GE(mem_arena_capacity(arena), 1024 * 1024);
+
+    // The large chunk is reused after a reset.
+    mem_arena_reset(arena);
+    const std::uint64_t capacity = mem_arena_capacity(arena);
+    ASSERT_NE(mem_balloc(mem, 16), nullptr);
+    ASSERT_NE(mem_balloc(mem, 1024 * 1024), nullptr);
+    EXPECT_EQ(mem_arena_capacity(arena), capacity);
+}
+
+TEST_F(MemArenaTest, FreeIsNoOp)
+{
+    void *ptr = mem_balloc(mem, 10);
+    mem_delete(mem, ptr);
+    mem_delete(mem, nullptr);
+    EXPECT_NE(mem_balloc(mem, 10), nullptr);
+}
+
+}  // namespace
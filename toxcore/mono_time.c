@@ -32,20 +32,34 @@
 #include <pthread.h>
 #include <time.h>
 
+#include "atomics.h"
 #include "attributes.h"
 #include "ccompat.h"
 #include "mem.h"
 #include "util.h"
 
+#if !defined(TOX_ATOMICS_LOCK_FREE) && !defined(ESP_PLATFORM)
+#define MONO_TIME_RWLOCK 1
+#endif /* !TOX_ATOMICS_LOCK_FREE && !ESP_PLATFORM */
+
 /** don't call into system billions of times for no reason */
 struct Mono_Time {
+    /**
+     * Read by every timeout check, possibly from several threads. With
+     * lock-free 64 bit atomics, readers never wait for each other or for
+     * `mono_time_update`. Otherwise a read-write lock protects it.
+     */
+#ifdef TOX_ATOMICS_LOCK_FREE
+    Tox_Atomic_U64 cur_time;
+#else
     uint64_t cur_time;
+#endif /* TOX_ATOMICS_LOCK_FREE */
     uint64_t base_time;
 
-#ifndef ESP_PLATFORM
+#ifdef MONO_TIME_RWLOCK
     /** protect @ref cur_time from concurrent access */
     pthread_rwlock_t *_Nonnull time_update_lock;
-#endif /* ESP_PLATFORM */
+#endif /* MONO_TIME_RWLOCK */
 
     mono_time_current_time_cb *_Nonnull current_time_callback;
     void *_Nullable user_data;
@@ -115,7 +129,7 @@ Mono_Time *mono_time_new(const Memory *mem, mono_time_current_time_cb *current_t
         return nullptr;
     }
 
-#ifndef ESP_PLATFORM
+#ifdef MONO_TIME_RWLOCK
     pthread_rwlock_t *const rwlock = (pthread_rwlock_t *)mem_alloc(mem, sizeof(pthread_rwlock_t));
 
     if (rwlock == nullptr) {
@@ -130,11 +144,15 @@ Mono_Time *mono_time_new(const Memory *mem, mono_time_current_time_cb *current_t
     }
 
     mono_time->time_update_lock = rwlock;
-#endif /* ESP_PLATFORM */
+#endif /* MONO_TIME_RWLOCK */
 
     mono_time_set_current_time_callback(mono_time, current_time_callback, user_data);
 
+#ifdef TOX_ATOMICS_LOCK_FREE
+    tox_atomic_u64_store(&mono_time->cur_time, 0);
+#else
     mono_time->cur_time = 0;
+#endif /* TOX_ATOMICS_LOCK_FREE */
 #ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
     // Maximum reproducibility. Never return time = 0.
     mono_time->base_time = 1000000000;
@@ -154,10 +172,10 @@ void mono_time_free(const Memory *mem, Mono_Time *mono_time)
     if (mono_time == nullptr) {
         return;
     }
-#ifndef ESP_PLATFORM
+#ifdef MONO_TIME_RWLOCK
     pthread_rwlock_destroy(mono_time->time_update_lock);
     mem_delete(mem, mono_time->time_update_lock);
-#endif /* ESP_PLATFORM */
+#endif /* MONO_TIME_RWLOCK */
     mem_delete(mem, mono_time);
 }
 
@@ -166,26 +184,36 @@ void mono_time_update(Mono_Time *mono_time)
     const uint64_t cur_time =
         mono_time->base_time + mono_time->current_time_callback(mono_time->user_data);
 
-#ifndef ESP_PLATFORM
+#ifdef TOX_ATOMICS_LOCK_FREE
+    // Only the value itself is shared, so no ordering with other memory is
+    // needed.
+    tox_atomic_u64_store(&mono_time->cur_time, cur_time);
+#else
+#ifdef MONO_TIME_RWLOCK
     pthread_rwlock_wrlock(mono_time->time_update_lock);
-#endif /* ESP_PLATFORM */
+#endif /* MONO_TIME_RWLOCK */
     mono_time->cur_time = cur_time;
-#ifndef ESP_PLATFORM
+#ifdef MONO_TIME_RWLOCK
     pthread_rwlock_unlock(mono_time->time_update_lock);
-#endif /* ESP_PLATFORM */
+#endif /* MONO_TIME_RWLOCK */
+#endif /* TOX_ATOMICS_LOCK_FREE */
 }
 
 uint64_t mono_time_get_ms(const Mono_Time *mono_time)
 {
-#if !defined(ESP_PLATFORM) && !defined(FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION)
+#ifdef TOX_ATOMICS_LOCK_FREE
+    return tox_atomic_u64_load(&mono_time->cur_time);
+#else
+#if defined(MONO_TIME_RWLOCK) && !defined(FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION)
     // Fuzzing is only single thread for now, no locking needed */
     pthread_rwlock_rdlock(mono_time->time_update_lock);
-#endif /* !ESP_PLATFORM */
+#endif /* MONO_TIME_RWLOCK */
     const uint64_t cur_time = mono_time->cur_time;
-#if !defined(ESP_PLATFORM) && !defined(FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION)
+#if defined(MONO_TIME_RWLOCK) && !defined(FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION)
     pthread_rwlock_unlock(mono_time->time_update_lock);
-#endif /* !ESP_PLATFORM */
+#endif /* MONO_TIME_RWLOCK */
     return cur_time;
+#endif /* TOX_ATOMICS_LOCK_FREE */
 }
 
 uint64_t mono_time_get(const Mono_Time *mono_time)
@@ -53,6 +53,9 @@ void mono_time_free(const Memory *_Nonnull mem, Mono_Time *_Nullable mono_time);
 /**
  * Update mono_time; subsequent calls to mono_time_get or mono_time_is_timeout
  * will use the time at the call to mono_time_update.
+ *
+ * Other threads may read the time while it is being updated. They see either
+ * the old or the new time.
  */
 void mono_time_update(Mono_Time *_Nonnull mono_time);
 
@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "mono_time.h"
+#include "os_memory.h"
+
+namespace {
+
+/** Shared by all threads of a benchmark run, like the Tox and ToxAV threads. */
+Mono_Time *_Nullable shared_mono_time = nullptr;
+
+void setup(const benchmark::State &state)
+{
+    shared_mono_time = mono_time_new(os_memory(), nullptr, nullptr);
+}
+
+void teardown(const benchmark::State &state)
+{
+    mono_time_free(os_memory(), shared_mono_time);
+    shared_mono_time = nullptr;
+}
+
+// Every thread reads the time, the way timeout checks do.
+void BM_MonoTimeGet(benchmark::State &state)
+{
+    Mono_Time *mono_time = shared_mono_time;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mono_time_get_ms(mono_time));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Thread 0 updates the time in a loop while the other threads read it.
+void BM_MonoTimeGetWithUpdater(benchmark::State &state)
+{
+    Mono_Time *mono_time = shared_mono_time;
+    const bool updater = state.thread_index() == 0;
+
+    for (auto _ : state) {
+        if (updater) {
+            mono_time_update(mono_time);
+        } else {
+            benchmark::DoNotOptimize(mono_time_get_ms(mono_time));
+        }
+    }
+
+    if (!updater) {
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+BENCHMARK(BM_MonoTimeGet)->Setup(setup)->Teardown(teardown)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_MonoTimeGetWithUpdater)
+    ->Setup(setup)
+    ->Teardown(teardown)
+    ->ThreadRange(2, 8)
+    ->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
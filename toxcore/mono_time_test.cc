@@ -5,6 +5,10 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "attributes.h"
 #include "mono_time_test_util.hh"
 
@@ -107,4 +111,55 @@ TEST(MonoTime, CustomTime)
     mono_time_free(&c_mem, mono_time);
 }
 
+TEST(MonoTime, ConcurrentReadersSeeEveryUpdateInOrder)
+{
+    SimulatedEnvironment env{12345};
+    auto c_mem = env.fake_memory().c_memory();
+    Mono_Time *mono_time = mono_time_new(&c_mem, nullptr, nullptr);
+    ASSERT_NE(mono_time, nullptr);
+
+    std::atomic<std::uint64_t> clock{0};
+    mono_time_set_current_time_callback(
+        mono_time,
+        [](void *_Nullable user_data) {
+            return static_cast<std::atomic<std::uint64_t> *>(user_data)->load();
+        },
+        &clock);
+    mono_time_update(mono_time);
+
+    const std::uint64_t start = mono_time_get_ms(mono_time);
+    constexpr std::uint64_t kUpdates = 100000;
+    std::atomic<bool> done{false};
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            std::uint64_t last = start;
+            while (!done.load()) {
+                const std::uint64_t now = mono_time_get_ms(mono_time);
+                if (now < last || now > start + kUpdates) {
+                    ++errors;
+                }
+                last = now;
+            }
+        });
+    }
+
+    for (std::uint64_t i = 0; i < kUpdates; ++i) {
+        ++clock;
+        mono_time_update(mono_time);
+    }
+
+    done = true;
+    for (std::thread &reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(errors.load(), 0);
+    EXPECT_EQ(mono_time_get_ms(mono_time), start + kUpdates);
+
+    mono_time_free(&c_mem, mono_time);
+}
+
 }  // namespace
@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+#include "mpmc_queue.h"
+
+#include <stddef.h>
+
+#include "atomics.h"
+#include "ccompat.h"
+#include "mem.h"
+
+/** Keeps the producer and consumer positions in separate cache lines. */
+#define MPMC_QUEUE_CACHE_LINE 64
+
+#define MPMC_QUEUE_MAX_CAPACITY (UINT32_C(1) << 31)
+
+typedef struct Mpmc_Slot {
+    /**
+     * Equal to the position of the push that may fill the slot, or one past
+     * the position of the pop that may empty it. Any other value means the
+     * slot belongs to another lap around the ring.
+     */
+    Tox_Atomic_Size seq;
+    void *_Nullable item;
+} Mpmc_Slot;
+
+struct Mpmc_Queue {
+    const Memory *_Nonnull mem;
+    Mpmc_Slot *_Nonnull slots;
+    size_t mask;
+
+    uint8_t pad0[MPMC_QUEUE_CACHE_LINE];
+    Tox_Atomic_Size push_pos;
+    uint8_t pad1[MPMC_QUEUE_CACHE_LINE];
+    Tox_Atomic_Size pop_pos;
+    uint8_t pad2[MPMC_QUEUE_CACHE_LINE];
+};
+
+Mpmc_Queue *mpmc_queue_new(const Memory *mem, uint32_t capacity)
+{
+    if (capacity == 0 || capacity > MPMC_QUEUE_MAX_CAPACITY) {
+        return nullptr;
+    }
+
+    size_t size = 1;
+
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    Mpmc_Queue *queue = (Mpmc_Queue *)mem_alloc(mem, sizeof(Mpmc_Queue));
+
+    if (queue == nullptr) {
+        return nullptr;
+    }
+
+    Mpmc_Slot *slots = (Mpmc_Slot *)mem_valloc(mem, (uint32_t)size, sizeof(Mpmc_Slot));
+
+    if (slots == nullptr) {
+        mem_delete(mem, queue);
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+        tox_atomic_size_store_release(&slots[i].seq, i);
+        slots[i].item = nullptr;
+    }
+
+    queue->mem = mem;
+    queue->slots = slots;
+    queue->mask = size - 1;
+    tox_atomic_size_store_release(&queue->push_pos, 0);
+    tox_atomic_size_store_release(&queue->pop_pos, 0);
+    return queue;
+}
+
+void mpmc_queue_free(Mpmc_Queue *queue)
+{
+    if (queue == nullptr) {
+        return;
+    }
+
+    mem_delete(queue->mem, queue->slots);
+    mem_delete(queue->mem, queue);
+}
+
+bool mpmc_queue_push(Mpmc_Queue *queue, void *item)
+{
+    size_t pos = tox_atomic_size_load(&queue->push_pos);
+    Mpmc_Slot *slot;
+
+    while (true) {
+        slot = &queue->slots[pos & queue->mask];
+        const size_t seq = tox_atomic_size_load_acquire(&slot->seq);
+
+        if (seq == pos) {
+            if (tox_atomic_size_compare_exchange(&queue->push_pos, &pos, pos + 1)) {
+                break;
+            }
+        } else if ((ptrdiff_t)(seq - pos) < 0) {
+            // The slot still holds an item from the previous lap: full.
+            return false;
+        } else {
+            // Another producer claimed this position first.
+            pos = tox_atomic_size_load(&queue->push_pos);
+        }
+    }
+
+    slot->item = item;
+    tox_atomic_size_store_release(&slot->seq, pos + 1);
+
+    return true;
+}
+
+void *mpmc_queue_pop(Mpmc_Queue *queue)
+{
+    size_t pos = tox_atomic_size_load(&queue->pop_pos);
+    Mpmc_Slot *slot;
+
+    while (true) {
+        slot = &queue->slots[pos & queue->mask];
+        const size_t seq = tox_atomic_size_load_acquire(&slot->seq);
+
+        if (seq == pos + 1) {
+            if (tox_atomic_size_compare_exchange(&queue->pop_pos, &pos, pos + 1)) {
+                break;
+            }
+        } else if ((ptrdiff_t)(seq - (pos + 1)) < 0) {
+            // The slot hasn't been filled in this lap yet: empty.
+            return nullptr;
+        } else {
+            // Another consumer claimed this position first.
+            pos = tox_atomic_size_load(&queue->pop_pos);
+        }
+    }
+
+    void *item = slot->item;
+    slot->item = nullptr;
+    tox_atomic_size_store_release(&slot->seq, pos + queue->mask + 1);
+
+    return item;
+}
+
+uint32_t mpmc_queue_size(const Mpmc_Queue *queue)
+{
+    const size_t pop_pos = tox_atomic_size_load_acquire(&queue->pop_pos);
+    const size_t push_pos = tox_atomic_size_load_acquire(&queue->push_pos);
+
+    // The pop position is loaded first and neither position ever goes back,
+    // so the difference can't be negative. Pushes and pops between the loads
+    // can make it larger than the queue, though.
+    const size_t size = push_pos - pop_pos;
+
+    if (size > queue->mask + 1) {
+        return (uint32_t)(queue->mask + 1);
+    }
+
+    return (uint32_t)size;
+}
+
+uint32_t mpmc_queue_capacity(const Mpmc_Queue *queue)
+{
+    return (uint32_t)(queue->mask + 1);
+}
@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+/**
+ * Bounded queue for handing pointers from one thread to another.
+ */
+#ifndef C_TOXCORE_TOXCORE_MPMC_QUEUE_H
+#define C_TOXCORE_TOXCORE_MPMC_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "attributes.h"
+#include "mem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A bounded multi-producer, multi-consumer queue of pointers.
+ *
+ * The queue is a fixed size ring where each slot carries a sequence number
+ * telling producers and consumers whose turn it is to use it. Pushing and
+ * popping never block and never allocate. They are lock-free where the atomics
+ * in atomics.h are; otherwise every access to a position takes a mutex.
+ */
+typedef struct Mpmc_Queue Mpmc_Queue;
+
+/**
+ * @brief Create an empty queue.
+ *
+ * @param capacity Maximum number of items in the queue. Rounded up to a power
+ *   of 2. Must be between 1 and 2^31.
+ */
+Mpmc_Queue *_Nullable mpmc_queue_new(const Memory *_Nonnull mem, uint32_t capacity);
+
+/**
+ * @brief Free the queue.
+ *
+ * Items still in the queue are not freed. No other thread may be using the
+ * queue at this point.
+ */
+void mpmc_queue_free(Mpmc_Queue *_Nullable queue);
+
+/**
+ * @brief Add an item to the back of the queue.
+ *
+ * @retval false if the queue is full.
+ */
+bool mpmc_queue_push(Mpmc_Queue *_Nonnull queue, void *_Nonnull item);
+
+/**
+ * @brief Remove the item at the front of the queue.
+ *
+ * @return the item, or NULL if the queue is empty.
+ */
+void *_Nullable mpmc_queue_pop(Mpmc_Queue *_Nonnull queue);
+
+/**
+ * @brief Number of items in the queue.
+ *
+ * With concurrent pushes and pops this is a snapshot that may already be out
+ * of date when it returns.
+ */
+uint32_t mpmc_queue_size(const Mpmc_Queue *_Nonnull queue);
+
+/** @brief Maximum number of items the queue can hold. */
+uint32_t mpmc_queue_capacity(const Mpmc_Queue *_Nonnull queue);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* C_TOXCORE_TOXCORE_MPMC_QUEUE_H */
@@ -0,0 +1,120 @@
+#include "mpmc_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "os_memory.h"
+
+namespace {
+
+struct MpmcQueueDeleter {
+    void operator()(Mpmc_Queue *queue) const { mpmc_queue_free(queue); }
+};
+using MpmcQueuePtr = std::unique_ptr<Mpmc_Queue, MpmcQueueDeleter>;
+
+void *item(std::uintptr_t value) { return reinterpret_cast<void *>(value); }
+
+TEST(MpmcQueue, RejectsInvalidCapacity)
+{
+    EXPECT_EQ(mpmc_queue_new(os_memory(), 0), nullptr);
+    EXPECT_EQ(mpmc_queue_new(os_memory(), UINT32_MAX), nullptr);
+}
+
+TEST(MpmcQueue, CapacityIsRoundedUpToPowerOfTwo)
+{
+    MpmcQueuePtr queue{mpmc_queue_new(os_memory(), 5)};
+    ASSERT_NE(queue, nullptr);
+    EXPECT_EQ(mpmc_queue_capacity(queue.get()), 8);
+}
+
+TEST(MpmcQueue, PopsInPushOrder)
+{
+    MpmcQueuePtr queue{mpmc_queue_new(os_memory(), 4)};
+    ASSERT_NE(queue, nullptr);
+    EXPECT_EQ(mpmc_queue_pop(queue.get()), nullptr);
+
+    // Go around the ring a few times.
+    for (std::uintptr_t round = 0; round < 5; ++round) {
+        for (std::uintptr_t i = 1; i <= 3; ++i) {
+            ASSERT_TRUE(mpmc_queue_push(queue.get(), item(round * 10 + i)));
+        }
+        EXPECT_EQ(mpmc_queue_size(queue.get()), 3);
+        for (std::uintptr_t i = 1; i <= 3; ++i) {
+            EXPECT_EQ(mpmc_queue_pop(queue.get()), item(round * 10 + i));
+        }
+        EXPECT_EQ(mpmc_queue_pop(queue.get()), nullptr);
+    }
+}
+
+TEST(MpmcQueue, PushFailsWhenFull)
+{
+    MpmcQueuePtr queue{mpmc_queue_new(os_memory(), 2)};
+    ASSERT_NE(queue, nullptr);
+    EXPECT_TRUE(mpmc_queue_push(queue.get(), item(1)));
+    EXPECT_TRUE(mpmc_queue_push(queue.get(), item(2)));
+    EXPECT_FALSE(mpmc_queue_push(queue.get(), item(3)));
+    EXPECT_EQ(mpmc_queue_size(queue.get()), 2);
+
+    EXPECT_EQ(mpmc_queue_pop(queue.get()), item(1));
+    EXPECT_TRUE(mpmc_queue_push(queue.get(), item(3)));
+    EXPECT_EQ(mpmc_queue_pop(queue.get()), item(2));
+    EXPECT_EQ(mpmc_queue_pop(queue.get()), item(3));
+}
+
+TEST(MpmcQueue, ConcurrentProducersAndConsumers)
+{
+    constexpr std::uintptr_t kProducers = 4;
+    constexpr std::uintptr_t kConsumers = 4;
+    constexpr std::uintptr_t kItems = 20000;
+
+    MpmcQueuePtr queue{mpmc_queue_new(os_memory(), 64)};
+    ASSERT_NE(queue, nullptr);
+
+    // Items are (producer << 32) | sequence, +1 so none of them is NULL.
+    std::vector<std::atomic<std::uint32_t>> seen(kProducers * kItems);
+    std::atomic<std::uintptr_t> popped{0};
+
+    std::vector<std::thread> threads;
+    for (std::uintptr_t p = 0; p < kProducers; ++p) {
+        threads.emplace_back([&queue, p] {
+            for (std::uintptr_t i = 0; i < kItems; ++i) {
+                while (!mpmc_queue_push(queue.get(), item(p * kItems + i + 1))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::uintptr_t c = 0; c < kConsumers; ++c) {
+        threads.emplace_back([&queue, &seen, &popped] {
+            std::vector<std::uintptr_t> last(kProducers, 0);
+            while (popped.load() < kProducers * kItems) {
+                void *value = mpmc_queue_pop(queue.get());
+                if (value == nullptr) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                const std::uintptr_t index = reinterpret_cast<std::uintptr_t>(value) - 1;
+                // Each consumer sees each producer's items in order.
+                EXPECT_GE(index % kItems + 1, last[index / kItems]);
+                last[index / kItems] = index % kItems + 1;
+                ++seen[index];
+                ++popped;
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (const auto &count : seen) {
+        EXPECT_EQ(count.load(), 1);
+    }
+    EXPECT_EQ(mpmc_queue_pop(queue.get()), nullptr);
+}
+
+}  // namespace
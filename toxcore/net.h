@@ -220,6 +220,7 @@ bool net_join_multicast(const Network *_Nonnull ns, Socket sock, Family family);
 bool net_set_socket_nonblock(const Network *_Nonnull ns, Socket sock);
 bool net_set_socket_nosigpipe(const Network *_Nonnull ns, Socket sock);
 bool net_set_socket_reuseaddr(const Network *_Nonnull ns, Socket sock);
+bool net_set_socket_reuseport(const Network *_Nonnull ns, Socket sock);
 bool net_set_socket_dualstack(const Network *_Nonnull ns, Socket sock);
 bool net_set_socket_buffer_size(const Network *_Nonnull ns, Socket sock, int size);
 bool net_set_socket_broadcast(const Network *_Nonnull ns, Socket sock);
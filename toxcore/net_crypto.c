@@ -30,6 +30,7 @@
 #include "logger.h"
 #include "mem.h"
 #include "mono_time.h"
+#include "net_crypto_congestion.h"
 #include "net_profile.h"
 #include "network.h"
 #include "util.h"
@@ -39,8 +40,25 @@ typedef struct Packet_Data {
     uint8_t data[MAX_CRYPTO_DATA_SIZE];
 } Packet_Data;
 
+/** Number of slots a Packets_Array allocates for its first packet. */
+#define PACKETS_ARRAY_MIN_CAPACITY 16
+
+/**
+ * Window of packets numbered `{buffer_start, buffer_end)`, holes included.
+ *
+ * Packets are stored in a ring of `capacity` slots that grows as packets are
+ * added further from `buffer_start` and shrinks as the window empties, up to
+ * CRYPTO_PACKET_BUFFER_SIZE slots. Packet `n` is in slot `n % capacity` if
+ * `n - buffer_start < capacity`; any other packet in the window is a hole.
+ * The ring is only allocated when the first packet is added.
+ */
 typedef struct Packets_Array {
-    Packet_Data *_Nullable buffer[CRYPTO_PACKET_BUFFER_SIZE];
+    Packet_Data *_Nullable *_Nullable buffer;
+    /* Bit `slot` is set if `buffer[slot]` holds a packet, so that packets and
+     * holes can be found 64 slots at a time. Allocated with the ring. */
+    uint64_t *_Nullable present;
+    uint32_t  capacity; /* 0 or a power of 2 */
+    uint32_t  num_present; /* number of packets in the ring */
     uint32_t  buffer_start;
     uint32_t  buffer_end; /* packet numbers in array: `{buffer_start, buffer_end)` */
 } Packets_Array;
@@ -117,28 +135,31 @@ typedef struct Crypto_Connection {
     uint64_t last_request_packet_sent;
     uint64_t direct_send_attempt_time;
 
+    bool sack_peer; /* The peer has sent us a selective-ack request packet, so it understands them. */
+    uint8_t sack_offers; /* Selective-ack request packets sent before the peer was known to understand them. */
+
     uint32_t packet_counter;
     double packet_recv_rate;
     uint64_t packet_counter_set;
 
-    double packet_send_rate;
+    Congestion_Control congestion;
+
     uint32_t packets_left;
     uint64_t last_packets_left_set;
     double last_packets_left_rem;
 
-    double packet_send_rate_requested;
     uint32_t packets_left_requested;
     uint64_t last_packets_left_requested_set;
     double last_packets_left_requested_rem;
 
-    uint32_t last_sendqueue_size[CONGESTION_QUEUE_ARRAY_SIZE];
-    uint32_t last_sendqueue_counter;
-    long signed int last_num_packets_sent[CONGESTION_LAST_SENT_ARRAY_SIZE];
-    long signed int last_num_packets_resent[CONGESTION_LAST_SENT_ARRAY_SIZE];
     uint32_t packets_sent;
     uint32_t packets_resent;
-    uint64_t last_congestion_event;
     uint64_t rtt_time;
+    /* Whether rtt_time holds a measured round trip time yet. */
+    bool rtt_sampled;
+
+    /* Totals since the connection was created; send_rate, rtt and congestion_events are filled in when read. */
+    Crypto_Connection_Stats stats;
 
     /* TCP_connection connection_number */
     unsigned int connection_number_tcp;
@@ -190,6 +211,12 @@ struct Net_Crypto {
 
     /* Handshake mode selection: NOISE_ONLY, NOISE_BOTH, or LEGACY_ONLY */
     Crypto_Handshake_Mode handshake_mode;
+
+    /* Congestion controller for new connections. */
+    Congestion_Control_Type congestion_control;
+
+    /* Whether selective-ack request packets are offered and understood. */
+    bool sack_enabled;
 };
 
 /** @brief Free a Noise_Handshake, zeroing its contents first.
@@ -1081,11 +1108,15 @@ static IP_Port return_ip_port_connection(const Net_Crypto *_Nonnull c, int crypt
 }
 
 /** @brief Sends a packet to the peer using the fastest route.
+ *
+ * @param bulk Whether the packet carries bulk data that may be spread over
+ *   several TCP relays, see send_bulk_packet_tcp_connection.
  *
  * @retval -1 on failure.
  * @retval 0 on success.
  */
-static int send_packet_to(const Net_Crypto *_Nonnull c, int crypt_connection_id, const uint8_t *_Nonnull data, uint16_t length)
+static int send_packet_to(const Net_Crypto *_Nonnull c, int crypt_connection_id, const uint8_t *_Nonnull data, uint16_t length,
+                          bool bulk)
 {
 // TODO(irungentoo): TCP, etc...
     Crypto_Connection *conn = get_crypto_connection(c, crypt_connection_id);
@@ -1126,7 +1157,9 @@ static int send_packet_to(const Net_Crypto *_Nonnull c, int crypt_connection_id,
         }
     }
 
-    const int ret = send_packet_tcp_connection(c->tcp_c, conn->connection_number_tcp, data, length);
+    const int ret = bulk
+                    ? send_bulk_packet_tcp_connection(c->tcp_c, conn->connection_number_tcp, data, length)
+                    : send_packet_tcp_connection(c->tcp_c, conn->connection_number_tcp, data, length);
 
     if (ret == 0) {
         conn->last_tcp_sent = current_time_monotonic(c->mono_time);
@@ -1149,6 +1182,190 @@ static uint32_t num_packets_array(const Packets_Array *_Nonnull array)
     return array->buffer_end - array->buffer_start;
 }
 
+/** @brief Return the packet with this number, or NULL if there is none.
+ *
+ * The number must be in the window.
+ */
+static Packet_Data *_Nullable packets_array_get(const Packets_Array *_Nonnull array, uint32_t number)
+{
+    if (array->buffer == nullptr || number - array->buffer_start >= array->capacity) {
+        return nullptr;
+    }
+
+    return array->buffer[number & (array->capacity - 1)];
+}
+
+/** @brief Free the packet with this number, if there is one.
+ *
+ * @return true if there was a packet to free.
+ */
+static bool packets_array_remove(const Memory *_Nonnull mem, Packets_Array *_Nonnull array, uint32_t number)
+{
+    Packet_Data *data = packets_array_get(array, number);
+
+    if (data == nullptr) {
+        return false;
+    }
+
+    const uint32_t slot = number & (array->capacity - 1);
+    mem_delete(mem, data);
+    array->buffer[slot] = nullptr;
+    array->present[slot / 64] &= ~(UINT64_C(1) << (slot % 64));
+    --array->num_present;
+    return true;
+}
+
+/** @brief Put a packet into the empty slot of this number, which must fit in the ring. */
+static void packets_array_put(Packets_Array *_Nonnull array, uint32_t number, Packet_Data *_Nonnull data)
+{
+    const uint32_t slot = number & (array->capacity - 1);
+    array->buffer[slot] = data;
+    array->present[slot / 64] |= UINT64_C(1) << (slot % 64);
+    ++array->num_present;
+}
+
+/** @brief Index of the lowest set bit of `x`, which must not be 0. */
+static uint32_t lowest_bit(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t)__builtin_ctzll(x);
+#else
+    uint32_t i = 0;
+
+    while ((x & 1) == 0) {
+        x >>= 1;
+        ++i;
+    }
+
+    return i;
+#endif /* __GNUC__ || __clang__ */
+}
+
+/** @brief Find the first packet, or the first hole, in `{from, to}`.
+ *
+ * Both numbers must be in the window, `from` no later than `to`. Slots are
+ * checked 64 at a time, so this takes one step per 64 numbers skipped.
+ *
+ * @param want_packet true to look for a packet, false to look for a hole.
+ * @return the number found, or `to` if there is none.
+ */
+static uint32_t packets_array_find(const Packets_Array *_Nonnull array, uint32_t from, uint32_t to, bool want_packet)
+{
+    uint32_t pos = from - array->buffer_start;
+    uint32_t end = to - array->buffer_start;
+
+    // Past the ring, everything is a hole.
+    if (end > array->capacity) {
+        if (!want_packet && pos >= array->capacity) {
+            return from;
+        }
+
+        end = array->capacity;
+    }
+
+    // Rings smaller than 64 use the low bits of a single word.
+    const uint32_t word_bits = min_u32(array->capacity, 64);
+
+    while (pos < end) {
+        const uint32_t slot = (array->buffer_start + pos) & (array->capacity - 1);
+        const uint32_t bit = slot % 64;
+        const uint32_t count = min_u32(word_bits - bit, end - pos);
+        const uint64_t mask = (count == 64 ? UINT64_MAX : (UINT64_C(1) << count) - 1) << bit;
+        const uint64_t word = want_packet ? array->present[slot / 64] : ~array->present[slot / 64];
+        const uint64_t found = word & mask;
+
+        if (found != 0) {
+            return array->buffer_start + pos + (lowest_bit(found) - bit);
+        }
+
+        pos += count;
+    }
+
+    if (!want_packet && to - array->buffer_start > end) {
+        return array->buffer_start + end;
+    }
+
+    return to;
+}
+
+/** @brief Move the packets to a ring of `capacity` slots.
+ *
+ * Every packet must fit: its number minus `buffer_start` is less than
+ * `capacity`.
+ */
+static bool packets_array_resize(const Memory *_Nonnull mem, Packets_Array *_Nonnull array, uint32_t capacity)
+{
+    Packet_Data **buffer = (Packet_Data **)mem_valloc(mem, capacity, sizeof(Packet_Data *));
+    uint64_t *present = (uint64_t *)mem_valloc(mem, (capacity + 63) / 64, sizeof(uint64_t));
+
+    if (buffer == nullptr || present == nullptr) {
+        mem_delete(mem, present);
+        mem_delete(mem, buffer);
+        return false;
+    }
+
+    if (array->buffer != nullptr) {
+        const uint32_t count = min_u32(num_packets_array(array), min_u32(array->capacity, capacity));
+
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t number = array->buffer_start + i;
+            const uint32_t slot = number & (capacity - 1);
+            buffer[slot] = array->buffer[number & (array->capacity - 1)];
+
+            if (buffer[slot] != nullptr) {
+                present[slot / 64] |= UINT64_C(1) << (slot % 64);
+            }
+        }
+
+        mem_delete(mem, array->present);
+        mem_delete(mem, array->buffer);
+    }
+
+    array->buffer = buffer;
+    array->present = present;
+    array->capacity = capacity;
+    return true;
+}
+
+/** @brief Make room for a packet with this number.
+ *
+ * The number minus `buffer_start` must be less than CRYPTO_PACKET_BUFFER_SIZE.
+ */
+static bool packets_array_reserve(const Memory *_Nonnull mem, Packets_Array *_Nonnull array, uint32_t number)
+{
+    const uint32_t needed = number - array->buffer_start + 1;
+
+    if (needed <= array->capacity) {
+        return true;
+    }
+
+    uint32_t capacity = max_u32(array->capacity, PACKETS_ARRAY_MIN_CAPACITY);
+
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    return packets_array_resize(mem, array, capacity);
+}
+
+/** @brief Halve the ring while the window uses a quarter of it or less.
+ *
+ * Failing to allocate the smaller ring leaves the array as it was.
+ */
+static void packets_array_shrink(const Memory *_Nonnull mem, Packets_Array *_Nonnull array)
+{
+    const uint32_t num = num_packets_array(array);
+    uint32_t capacity = array->capacity;
+
+    while (capacity > PACKETS_ARRAY_MIN_CAPACITY && num <= capacity / 4) {
+        capacity /= 2;
+    }
+
+    if (capacity != array->capacity) {
+        packets_array_resize(mem, array, capacity);
+    }
+}
+
 /** @brief Add data with packet number to array.
  *
  * @retval -1 on failure.
@@ -1160,9 +1377,11 @@ static int add_data_to_buffer(const Memory *_Nonnull mem, Packets_Array *_Nonnul
         return -1;
     }
 
-    const uint32_t num = number % CRYPTO_PACKET_BUFFER_SIZE;
+    if (packets_array_get(array, number) != nullptr) {
+        return -1;
+    }
 
-    if (array->buffer[num] != nullptr) {
+    if (!packets_array_reserve(mem, array, number)) {
         return -1;
     }
 
@@ -1173,7 +1392,7 @@ static int add_data_to_buffer(const Memory *_Nonnull mem, Packets_Array *_Nonnul
     }
 
     *new_d = *data;
-    array->buffer[num] = new_d;
+    packets_array_put(array, number, new_d);
 
     if (number - array->buffer_start >= num_packets_array(array)) {
         array->buffer_end = number + 1;
@@ -1196,27 +1415,37 @@ static int get_data_pointer(const Packets_Array *_Nonnull array, Packet_Data *_N
         return -1;
     }
 
-    const uint32_t num = number % CRYPTO_PACKET_BUFFER_SIZE;
+    Packet_Data *found = packets_array_get(array, number);
 
-    if (array->buffer[num] == nullptr) {
+    if (found == nullptr) {
         return 0;
     }
 
-    *data = array->buffer[num];
+    *data = found;
     return 1;
 }
 
-/** @brief Add data to end of array.
+/** @brief Add the concatenation of header and data to end of array.
+ *
+ * The packet is copied straight into its new slot, so callers can assemble it
+ * from parts without a staging buffer.
  *
  * @retval -1 on failure.
  * @return packet number on success.
  */
-static int64_t add_data_end_of_buffer(const Logger *_Nonnull logger, const Memory *_Nonnull mem, Packets_Array *_Nonnull array, const Packet_Data *_Nonnull data)
+static int64_t add_data_end_of_buffer(const Logger *_Nonnull logger, const Memory *_Nonnull mem, Packets_Array *_Nonnull array,
+                                      const uint8_t *_Nonnull header, uint16_t header_length,
+                                      const uint8_t *_Nullable data, uint16_t length)
 {
     const uint32_t num_spots = num_packets_array(array);
 
     if (num_spots >= CRYPTO_PACKET_BUFFER_SIZE) {
-        LOGGER_WARNING(logger, "crypto packet buffer size exceeded; rejecting packet of length %d", data->length);
+        LOGGER_WARNING(logger, "crypto packet buffer size exceeded; rejecting packet of length %d", header_length + length);
+        return -1;
+    }
+
+    if (!packets_array_reserve(mem, array, array->buffer_end)) {
+        LOGGER_ERROR(logger, "packet buffer allocation failed");
         return -1;
     }
 
@@ -1227,9 +1456,16 @@ static int64_t add_data_end_of_buffer(const Logger *_Nonnull logger, const Memor
         return -1;
     }
 
-    *new_d = *data;
+    new_d->sent_time = 0;
+    new_d->length = header_length + length;
+    memcpy(new_d->data, header, header_length);
+
+    if (data != nullptr && length > 0) {
+        memcpy(new_d->data + header_length, data, length);
+    }
+
     const uint32_t id = array->buffer_end;
-    array->buffer[id % CRYPTO_PACKET_BUFFER_SIZE] = new_d;
+    packets_array_put(array, id, new_d);
     ++array->buffer_end;
     return id;
 }
@@ -1245,26 +1481,26 @@ static int64_t read_data_beg_buffer(const Memory *_Nonnull mem, Packets_Array *_
         return -1;
     }
 
-    const uint32_t num = array->buffer_start % CRYPTO_PACKET_BUFFER_SIZE;
+    const Packet_Data *found = packets_array_get(array, array->buffer_start);
 
-    if (array->buffer[num] == nullptr) {
+    if (found == nullptr) {
         return -1;
     }
 
-    *data = *array->buffer[num];
+    *data = *found;
     const uint32_t id = array->buffer_start;
+    packets_array_remove(mem, array, id);
     ++array->buffer_start;
-    mem_delete(mem, array->buffer[num]);
-    array->buffer[num] = nullptr;
+    packets_array_shrink(mem, array);
     return id;
 }
 
 /** @brief Delete all packets in array before number (but not number)
  *
  * @retval -1 on failure.
- * @retval 0 on success
+ * @return the number of packets deleted on success.
  */
-static int clear_buffer_until(const Memory *_Nonnull mem, Packets_Array *_Nonnull array, uint32_t number)
+static int32_t clear_buffer_until(const Memory *_Nonnull mem, Packets_Array *_Nonnull array, uint32_t number)
 {
     const uint32_t num_spots = num_packets_array(array);
 
@@ -1272,35 +1508,36 @@ static int clear_buffer_until(const Memory *_Nonnull mem, Packets_Array *_Nonnul
         return -1;
     }
 
-    uint32_t i;
-
-    for (i = array->buffer_start; i != number; ++i) {
-        const uint32_t num = i % CRYPTO_PACKET_BUFFER_SIZE;
+    // Packets further than `capacity` from the start are holes, so there is
+    // nothing to free past that.
+    const uint32_t count = min_u32(number - array->buffer_start, array->capacity);
+    int32_t removed = 0;
 
-        if (array->buffer[num] != nullptr) {
-            mem_delete(mem, array->buffer[num]);
-            array->buffer[num] = nullptr;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (packets_array_remove(mem, array, array->buffer_start + i)) {
+            ++removed;
         }
     }
 
-    array->buffer_start = i;
-    return 0;
+    array->buffer_start = number;
+    packets_array_shrink(mem, array);
+    return removed;
 }
 
 static int clear_buffer(const Memory *_Nonnull mem, Packets_Array *_Nonnull array)
 {
-    uint32_t i;
-
-    for (i = array->buffer_start; i != array->buffer_end; ++i) {
-        const uint32_t num = i % CRYPTO_PACKET_BUFFER_SIZE;
+    const uint32_t count = min_u32(num_packets_array(array), array->capacity);
 
-        if (array->buffer[num] != nullptr) {
-            mem_delete(mem, array->buffer[num]);
-            array->buffer[num] = nullptr;
-        }
+    for (uint32_t i = 0; i < count; ++i) {
+        packets_array_remove(mem, array, array->buffer_start + i);
     }
 
-    array->buffer_start = i;
+    mem_delete(mem, array->present);
+    mem_delete(mem, array->buffer);
+    array->buffer = nullptr;
+    array->present = nullptr;
+    array->capacity = 0;
+    array->buffer_start = array->buffer_end;
     return 0;
 }
 
@@ -1351,9 +1588,7 @@ static int generate_request_packet(uint8_t *_Nonnull data, uint16_t length, cons
     uint32_t n = 1;
 
     for (uint32_t i = recv_array->buffer_start; i != recv_array->buffer_end; ++i) {
-        const uint32_t num = i % CRYPTO_PACKET_BUFFER_SIZE;
-
-        if (recv_array->buffer[num] == nullptr) {
+        if (packets_array_get(recv_array, i) == nullptr) {
             data[cur_len] = n;
             n = 0;
             ++cur_len;
@@ -1380,11 +1615,15 @@ static int generate_request_packet(uint8_t *_Nonnull data, uint16_t length, cons
 /** @brief Handle a request data packet.
  * Remove all the packets the other received from the array.
  *
+ * @param acked Incremented for each packet removed from the array.
+ * @param lost Incremented for each requested packet that was sent more than
+ *   `rtt_time` ago and is now marked to be sent again.
+ *
  * @retval -1 on failure.
  * @return number of requested packets on success.
  */
 static int handle_request_packet(const Memory *_Nonnull mem, const Mono_Time *_Nonnull mono_time, Packets_Array *_Nonnull send_array, const uint8_t *_Nonnull data, uint16_t length,
-                                 uint64_t *_Nonnull latest_send_time, uint64_t rtt_time)
+                                 uint64_t *_Nonnull latest_send_time, uint64_t rtt_time, uint32_t *_Nonnull acked, uint32_t *_Nonnull lost)
 {
     if (length == 0) {
         return -1;
@@ -1412,14 +1651,13 @@ static int handle_request_packet(const Memory *_Nonnull mem, const Mono_Time *_N
             break;
         }
 
-        const uint32_t num = i % CRYPTO_PACKET_BUFFER_SIZE;
+        Packet_Data *packet = packets_array_get(send_array, i);
 
         if (n == data[0]) {
-            if (send_array->buffer[num] != nullptr) {
-                const uint64_t sent_time = send_array->buffer[num]->sent_time;
-
-                if ((sent_time + rtt_time) < temp_time) {
-                    send_array->buffer[num]->sent_time = 0;
+            if (packet != nullptr) {
+                if (packet->sent_time != 0 && (packet->sent_time + rtt_time) < temp_time) {
+                    packet->sent_time = 0;
+                    ++*lost;
                 }
             }
 
@@ -1428,11 +1666,10 @@ static int handle_request_packet(const Memory *_Nonnull mem, const Mono_Time *_N
             n = 0;
             ++requested;
         } else {
-            if (send_array->buffer[num] != nullptr) {
-                l_sent_time = max_u64(l_sent_time, send_array->buffer[num]->sent_time);
-
-                mem_delete(mem, send_array->buffer[num]);
-                send_array->buffer[num] = nullptr;
+            if (packet != nullptr) {
+                l_sent_time = max_u64(l_sent_time, packet->sent_time);
+                packets_array_remove(mem, send_array, i);
+                ++*acked;
             }
         }
 
@@ -1455,6 +1692,266 @@ static int handle_request_packet(const Memory *_Nonnull mem, const Mono_Time *_N
     return requested;
 }
 
+/*
+ * A selective-ack request packet describes the receive window as ranges:
+ *
+ *   [uint8_t PACKET_ID_SACK]
+ *   [uint16_t window: number of packets described, counted from buffer_start]
+ *   [range] * n
+ *
+ * Each range skips `gap` received packets after the end of the previous hole
+ * (or buffer_start) and then names `hole` missing ones. Everything in the
+ * window after the last hole was received. If the holes don't all fit, the
+ * window ends at the first one that was left out, so the packet never acks
+ * a packet it didn't see.
+ *
+ * A range with `gap < 32` and `hole <= 4`, as left by scattered loss, is one
+ * byte: `gap << 2 | (hole - 1)`. Any other range is the byte 0x80 followed by
+ * the numbers `gap` and `hole - 1`. A number below 128 is one byte, larger
+ * ones are two bytes in big endian with the top bit set. Windows are at most
+ * CRYPTO_PACKET_BUFFER_SIZE long, so gaps and holes always fit.
+ */
+#define SACK_HEADER_SIZE 3 /* id, window */
+#define SACK_RANGE_MAX_SIZE 5 /* marker, gap, hole - 1 */
+#define SACK_LONG_RANGE 0x80
+
+/* Number of selective-ack request packets sent to a peer that hasn't sent one
+ * back before giving up on it understanding them. */
+#define CRYPTO_SACK_OFFERS 8
+
+/** @brief Write a number of a selective-ack range, which must be below 32768.
+ *
+ * @return number of bytes written.
+ */
+static uint16_t sack_pack_number(uint8_t *_Nonnull data, uint16_t value)
+{
+    if (value < 0x80) {
+        data[0] = (uint8_t)value;
+        return 1;
+    }
+
+    data[0] = (uint8_t)(0x80 | (value >> 8));
+    data[1] = (uint8_t)(value & 0xff);
+    return 2;
+}
+
+/** @brief Read a number of a selective-ack range.
+ *
+ * @return number of bytes read, 0 if the number doesn't fit in `length`.
+ */
+static uint16_t sack_unpack_number(const uint8_t *_Nonnull data, uint16_t length, uint16_t *_Nonnull value)
+{
+    if (length == 0) {
+        return 0;
+    }
+
+    if ((data[0] & 0x80) == 0) {
+        *value = data[0];
+        return 1;
+    }
+
+    if (length < 2) {
+        return 0;
+    }
+
+    *value = (uint16_t)(((data[0] & 0x7f) << 8) | data[1]);
+    return 2;
+}
+
+/** @brief Write a selective-ack range.
+ *
+ * @return number of bytes written, at most SACK_RANGE_MAX_SIZE.
+ */
+static uint16_t sack_pack_range(uint8_t *_Nonnull data, uint16_t gap, uint32_t hole)
+{
+    if (gap < 32 && hole <= 4) {
+        data[0] = (uint8_t)(gap << 2 | (hole - 1));
+        return 1;
+    }
+
+    data[0] = SACK_LONG_RANGE;
+    uint16_t len = 1;
+    len += sack_pack_number(data + len, gap);
+    len += sack_pack_number(data + len, (uint16_t)(hole - 1));
+    return len;
+}
+
+/** @brief Read the range at `data[*pos]` and move `*pos` past it.
+ *
+ * @retval false if the range is cut off or malformed.
+ */
+static bool sack_unpack_range(const uint8_t *_Nonnull data, uint16_t length, uint16_t *_Nonnull pos,
+                              uint16_t *_Nonnull gap, uint32_t *_Nonnull hole)
+{
+    const uint8_t first = data[*pos];
+
+    if ((first & SACK_LONG_RANGE) == 0) {
+        *gap = first >> 2;
+        *hole = (uint32_t)(first & 0x03) + 1;
+        ++*pos;
+        return true;
+    }
+
+    if (first != SACK_LONG_RANGE) {
+        return false;
+    }
+
+    uint16_t offset = *pos + 1;
+    const uint16_t gap_len = sack_unpack_number(data + offset, length - offset, gap);
+
+    if (gap_len == 0) {
+        return false;
+    }
+
+    offset += gap_len;
+    uint16_t hole_minus_one;
+    const uint16_t hole_len = sack_unpack_number(data + offset, length - offset, &hole_minus_one);
+
+    if (hole_len == 0) {
+        return false;
+    }
+
+    *hole = (uint32_t)hole_minus_one + 1;
+    *pos = offset + hole_len;
+    return true;
+}
+
+/**
+ * @brief Create a selective-ack request packet from recv_array into data of length.
+ *
+ * Takes one step per hole and per 64 packets of the window.
+ *
+ * @retval -1 on failure.
+ * @return length of packet on success.
+ */
+static int generate_sack_packet(uint8_t *_Nonnull data, uint16_t length, const Packets_Array *_Nonnull recv_array)
+{
+    if (length < SACK_HEADER_SIZE) {
+        return -1;
+    }
+
+    data[0] = PACKET_ID_SACK;
+
+    const uint32_t start = recv_array->buffer_start;
+    const uint32_t end = recv_array->buffer_end;
+    uint32_t window = end - start;
+    uint16_t cur_len = SACK_HEADER_SIZE;
+
+    if (recv_array->num_present != window) {
+        uint32_t pos = start;
+
+        while (true) {
+            const uint32_t hole = packets_array_find(recv_array, pos, end, false);
+
+            if (hole == end) {
+                break;
+            }
+
+            if (length - cur_len < SACK_RANGE_MAX_SIZE) {
+                window = hole - start;
+                break;
+            }
+
+            const uint32_t hole_end = packets_array_find(recv_array, hole, end, true);
+            cur_len += sack_pack_range(data + cur_len, (uint16_t)(hole - pos), hole_end - hole);
+            pos = hole_end;
+        }
+    }
+
+    net_pack_u16(data + 1, (uint16_t)window);
+    return cur_len;
+}
+
+/** @brief Remove the packets in `{from, to}` from the array as received by the peer. */
+static void ack_packet_range(const Memory *_Nonnull mem, Packets_Array *_Nonnull send_array, uint32_t from, uint32_t to,
+                             uint64_t *_Nonnull l_sent_time, uint32_t *_Nonnull acked)
+{
+    for (uint32_t i = packets_array_find(send_array, from, to, true); i != to;
+            i = packets_array_find(send_array, i + 1, to, true)) {
+        const Packet_Data *packet = packets_array_get(send_array, i);
+        *l_sent_time = max_u64(*l_sent_time, packet->sent_time);
+        packets_array_remove(mem, send_array, i);
+        ++*acked;
+    }
+}
+
+/** @brief Handle a selective-ack request packet.
+ *
+ * Works like handle_request_packet, in one step per range and per packet
+ * acked or requested rather than per packet in the window.
+ *
+ * @retval -1 on failure.
+ * @return number of requested packets on success.
+ */
+static int handle_sack_packet(const Memory *_Nonnull mem, const Mono_Time *_Nonnull mono_time, Packets_Array *_Nonnull send_array, const uint8_t *_Nonnull data, uint16_t length,
+                              uint64_t *_Nonnull latest_send_time, uint64_t rtt_time, uint32_t *_Nonnull acked, uint32_t *_Nonnull lost)
+{
+    if (length < SACK_HEADER_SIZE || data[0] != PACKET_ID_SACK) {
+        return -1;
+    }
+
+    uint16_t window;
+    net_unpack_u16(data + 1, &window);
+
+    if (window > num_packets_array(send_array)) {
+        return -1;
+    }
+
+    // Check all ranges first, so a bad packet changes nothing.
+    uint32_t described = 0;
+
+    for (uint16_t i = SACK_HEADER_SIZE; i < length;) {
+        uint16_t gap;
+        uint32_t hole;
+
+        if (!sack_unpack_range(data, length, &i, &gap, &hole)) {
+            return -1;
+        }
+
+        described += gap + hole;
+
+        if (described > window) {
+            return -1;
+        }
+    }
+
+    const uint32_t end = send_array->buffer_start + window;
+    const uint64_t temp_time = current_time_monotonic(mono_time);
+    uint64_t l_sent_time = 0;
+    uint32_t requested = 0;
+    uint32_t pos = send_array->buffer_start;
+
+    for (uint16_t i = SACK_HEADER_SIZE; i < length;) {
+        uint16_t gap;
+        uint32_t hole;
+        sack_unpack_range(data, length, &i, &gap, &hole);
+
+        ack_packet_range(mem, send_array, pos, pos + gap, &l_sent_time, acked);
+        pos += gap;
+
+        const uint32_t hole_end = pos + hole;
+
+        // Packets in holes weren't acked before, so they are mostly all there.
+        for (uint32_t j = pos; j != hole_end; ++j) {
+            Packet_Data *packet = packets_array_get(send_array, j);
+
+            if (packet != nullptr && packet->sent_time != 0 && (packet->sent_time + rtt_time) < temp_time) {
+                packet->sent_time = 0;
+                ++*lost;
+            }
+        }
+
+        requested += hole;
+        pos = hole_end;
+    }
+
+    ack_packet_range(mem, send_array, pos, end, &l_sent_time, acked);
+
+    *latest_send_time = max_u64(*latest_send_time, l_sent_time);
+
+    return requested;
+}
+
 /** END: Array Related functions */
 
 #define MAX_DATA_DATA_PACKET_SIZE (MAX_CRYPTO_PACKET_SIZE - (1 + sizeof(uint16_t) + CRYPTO_MAC_SIZE))
@@ -1464,7 +1961,8 @@ static int handle_request_packet(const Memory *_Nonnull mem, const Mono_Time *_N
  * @retval -1 on failure.
  * @retval 0 on success.
  */
-static int send_data_packet(const Net_Crypto *_Nonnull c, int crypt_connection_id, const uint8_t *_Nonnull data, uint16_t length)
+static int send_data_packet(const Net_Crypto *_Nonnull c, int crypt_connection_id, const uint8_t *_Nonnull data, uint16_t length,
+                            bool bulk)
 {
     const uint16_t max_length = MAX_CRYPTO_PACKET_SIZE - (1 + sizeof(uint16_t) + CRYPTO_MAC_SIZE);
 
@@ -1504,7 +2002,13 @@ static int send_data_packet(const Net_Crypto *_Nonnull c, int crypt_connection_i
 
     increment_nonce(conn->send_nonce);
 
-    return send_packet_to(c, crypt_connection_id, packet, packet_size);
+    if (send_packet_to(c, crypt_connection_id, packet, packet_size, bulk) != 0) {
+        return -1;
+    }
+
+    ++conn->stats.packets_sent;
+    conn->stats.bytes_sent += packet_size;
+    return 0;
 }
 
 /** @brief Creates and sends a data packet with buffer_start and num to the peer using the fastest route.
@@ -1512,7 +2016,8 @@ static int send_data_packet(const Net_Crypto *_Nonnull c, int crypt_connection_i
  * @retval -1 on failure.
  * @retval 0 on success.
  */
-static int send_data_packet_helper(const Net_Crypto *_Nonnull c, int crypt_connection_id, uint32_t buffer_start, uint32_t num, const uint8_t *_Nonnull data, uint16_t length)
+static int send_data_packet_helper(const Net_Crypto *_Nonnull c, int crypt_connection_id, uint32_t buffer_start, uint32_t num, const uint8_t *_Nonnull data, uint16_t length,
+                                   bool bulk)
 {
     if (length == 0 || length > MAX_CRYPTO_DATA_SIZE) {
         LOGGER_ERROR(c->log, "zero-length or too large data packet: %d (max: %d)", length, MAX_CRYPTO_PACKET_SIZE);
@@ -1529,7 +2034,14 @@ static int send_data_packet_helper(const Net_Crypto *_Nonnull c, int crypt_conne
     memzero(packet + (sizeof(uint32_t) * 2), padding_length);
     memcpy(packet + (sizeof(uint32_t) * 2) + padding_length, data, length);
 
-    return send_data_packet(c, crypt_connection_id, packet, packet_size);
+    return send_data_packet(c, crypt_connection_id, packet, packet_size, bulk);
+}
+
+/** @brief Whether a queued lossless packet is file or custom data rather than a message. */
+static bool is_bulk_packet(const Packet_Data *_Nonnull dt)
+{
+    return dt->data[0] == PACKET_ID_FILE_DATA
+           || (dt->data[0] >= PACKET_ID_RANGE_LOSSLESS_CUSTOM_START && dt->data[0] <= PACKET_ID_RANGE_LOSSLESS_CUSTOM_END);
 }
 
 static int reset_max_speed_reached(const Net_Crypto *_Nonnull c, int crypt_connection_id)
@@ -1549,7 +2061,7 @@ static int reset_max_speed_reached(const Net_Crypto *_Nonnull c, int crypt_conne
 
         if (ret == 1 && dt->sent_time == 0) {
             if (send_data_packet_helper(c, crypt_connection_id, conn->recv_array.buffer_start, packet_num,
-                                        dt->data, dt->length) != 0) {
+                                        dt->data, dt->length, is_bulk_packet(dt)) != 0) {
                 return -1;
             }
 
@@ -1563,14 +2075,20 @@ static int reset_max_speed_reached(const Net_Crypto *_Nonnull c, int crypt_conne
 }
 
 /**
+ * @brief Queue the concatenation of header and data and send it.
+ *
  * @retval -1 if data could not be put in packet queue.
  * @return positive packet number if data was put into the queue.
  */
-static int64_t send_lossless_packet(const Net_Crypto *_Nonnull c, int crypt_connection_id, const uint8_t *_Nonnull data, uint16_t length, bool congestion_control)
+static int64_t send_lossless_packet(const Net_Crypto *_Nonnull c, int crypt_connection_id,
+                                    const uint8_t *_Nonnull header, uint16_t header_length,
+                                    const uint8_t *_Nullable data, uint16_t length, bool congestion_control)
 {
-    if (length == 0 || length > MAX_CRYPTO_DATA_SIZE) {
-        LOGGER_ERROR(c->log, "rejecting too large (or empty) packet of size %d on crypt connection %d", length,
-                     crypt_connection_id);
+    const uint32_t total_length = (uint32_t)header_length + length;
+
+    if (total_length == 0 || total_length > MAX_CRYPTO_DATA_SIZE) {
+        LOGGER_ERROR(c->log, "rejecting too large (or empty) packet of size %u on crypt connection %d",
+                     (unsigned int)total_length, crypt_connection_id);
         return -1;
     }
 
@@ -1589,11 +2107,8 @@ static int64_t send_lossless_packet(const Net_Crypto *_Nonnull c, int crypt_conn
         return -1;
     }
 
-    Packet_Data dt;
-    dt.sent_time = 0;
-    dt.length = length;
-    memcpy(dt.data, data, length);
-    const int64_t packet_num = add_data_end_of_buffer(c->log, c->mem, &conn->send_array, &dt);
+    const int64_t packet_num = add_data_end_of_buffer(c->log, c->mem, &conn->send_array, header, header_length,
+                               data, length);
 
     if (packet_num == -1) {
         return -1;
@@ -1603,12 +2118,15 @@ static int64_t send_lossless_packet(const Net_Crypto *_Nonnull c, int crypt_conn
         return packet_num;
     }
 
-    if (send_data_packet_helper(c, crypt_connection_id, conn->recv_array.buffer_start, packet_num, data, length) == 0) {
-        Packet_Data *dt1 = nullptr;
+    Packet_Data *dt = nullptr;
 
-        if (get_data_pointer(&conn->send_array, &dt1, packet_num) == 1) {
-            dt1->sent_time = current_time_monotonic(c->mono_time);
-        }
+    if (get_data_pointer(&conn->send_array, &dt, packet_num) != 1) {
+        return packet_num;
+    }
+
+    if (send_data_packet_helper(c, crypt_connection_id, conn->recv_array.buffer_start, packet_num, dt->data, dt->length,
+                                is_bulk_packet(dt)) == 0) {
+        dt->sent_time = current_time_monotonic(c->mono_time);
     } else {
         conn->maximum_speed_reached = true;
         LOGGER_DEBUG(c->log, "send_data_packet failed (packet_num = %ld)", (long)packet_num);
@@ -1688,13 +2206,33 @@ static int handle_data_packet(const Net_Crypto *_Nonnull c, int crypt_connection
  */
 static int send_request_packet(const Net_Crypto *_Nonnull c, int crypt_connection_id)
 {
-    const Crypto_Connection *conn = get_crypto_connection(c, crypt_connection_id);
+    Crypto_Connection *conn = get_crypto_connection(c, crypt_connection_id);
 
     if (conn == nullptr) {
         return -1;
     }
 
     uint8_t data[MAX_CRYPTO_DATA_SIZE];
+
+    // Until the peer answers with a selective-ack packet, it may not know
+    // them, so send the old kind as well. It drops the ones it doesn't know.
+    if (c->sack_enabled && (conn->sack_peer || conn->sack_offers < CRYPTO_SACK_OFFERS)) {
+        const int len = generate_sack_packet(data, sizeof(data), &conn->recv_array);
+
+        if (len == -1) {
+            return -1;
+        }
+
+        const int ret = send_data_packet_helper(c, crypt_connection_id, conn->recv_array.buffer_start,
+                                                conn->send_array.buffer_end, data, len, false);
+
+        if (conn->sack_peer) {
+            return ret;
+        }
+
+        ++conn->sack_offers;
+    }
+
     const int len = generate_request_packet(data, sizeof(data), &conn->recv_array);
 
     if (len == -1) {
@@ -1702,7 +2240,7 @@ static int send_request_packet(const Net_Crypto *_Nonnull c, int crypt_connectio
     }
 
     return send_data_packet_helper(c, crypt_connection_id, conn->recv_array.buffer_start, conn->send_array.buffer_end, data,
-                                   len);
+                                   len, false);
 }
 
 /** @brief Send up to max num previously requested data packets.
@@ -1744,7 +2282,7 @@ static int send_requested_packets(const Net_Crypto *_Nonnull c, int crypt_connec
         }
 
         if (send_data_packet_helper(c, crypt_connection_id, conn->recv_array.buffer_start, packet_num, dt->data,
-                                    dt->length) == 0) {
+                                    dt->length, is_bulk_packet(dt)) == 0) {
             dt->sent_time = temp_time;
             ++num_sent;
         }
@@ -1833,7 +2371,7 @@ static int send_temp_packet(const Net_Crypto *_Nonnull c, int crypt_connection_i
         return -1;
     }
 
-    if (send_packet_to(c, crypt_connection_id, conn->temp_packet, conn->temp_packet_length) != 0) {
+    if (send_packet_to(c, crypt_connection_id, conn->temp_packet, conn->temp_packet_length, false) != 0) {
         return -1;
     }
 
@@ -1918,7 +2456,7 @@ static int send_kill_packet(const Net_Crypto *_Nonnull c, int crypt_connection_i
     const uint8_t kill_packet[1] = {PACKET_ID_KILL};
 
     return send_data_packet_helper(c, crypt_connection_id, conn->recv_array.buffer_start, conn->send_array.buffer_end,
-                                   kill_packet, sizeof(kill_packet));
+                                   kill_packet, sizeof(kill_packet), false);
 }
 
 static void connection_kill(Net_Crypto *_Nonnull c, int crypt_connection_id, void *_Nullable userdata)
@@ -1965,6 +2503,9 @@ static int handle_data_packet_core(Net_Crypto *_Nonnull c, int crypt_connection_
         return -1;
     }
 
+    ++conn->stats.packets_received;
+    conn->stats.bytes_received += length;
+
     uint32_t buffer_start;
     uint32_t num;
     memcpy(&buffer_start, data, sizeof(uint32_t));
@@ -1973,6 +2514,8 @@ static int handle_data_packet_core(Net_Crypto *_Nonnull c, int crypt_connection_
     num = net_ntohl(num);
 
     uint64_t rtt_calc_time = 0;
+    uint32_t acked = 0;
+    uint32_t lost = 0;
 
     if (buffer_start != conn->send_array.buffer_start) {
         Packet_Data *packet_time;
@@ -1981,9 +2524,13 @@ static int handle_data_packet_core(Net_Crypto *_Nonnull c, int crypt_connection_
             rtt_calc_time = packet_time->sent_time;
         }
 
-        if (clear_buffer_until(c->mem, &conn->send_array, buffer_start) != 0) {
+        const int32_t cleared = clear_buffer_until(c->mem, &conn->send_array, buffer_start);
+
+        if (cleared == -1) {
             return -1;
         }
+
+        acked = (uint32_t)cleared;
     }
 
     const uint8_t *real_data = data + (sizeof(uint32_t) * 2);
@@ -2017,7 +2564,7 @@ static int handle_data_packet_core(Net_Crypto *_Nonnull c, int crypt_connection_
         }
     }
 
-    if (real_data[0] == PACKET_ID_REQUEST) {
+    if (real_data[0] == PACKET_ID_REQUEST || (real_data[0] == PACKET_ID_SACK && c->sack_enabled)) {
         uint64_t rtt_time;
 
         if (udp) {
@@ -2026,7 +2573,16 @@ static int handle_data_packet_core(Net_Crypto *_Nonnull c, int crypt_connection_
             rtt_time = DEFAULT_TCP_PING_CONNECTION;
         }
 
-        const int requested = handle_request_packet(c->mem, c->mono_time, &conn->send_array, real_data, real_length, &rtt_calc_time, rtt_time);
+        int requested;
+
+        if (real_data[0] == PACKET_ID_SACK) {
+            requested = handle_sack_packet(c->mem, c->mono_time, &conn->send_array, real_data, real_length, &rtt_calc_time,
+                                           rtt_time, &acked, &lost);
+            conn->sack_peer = conn->sack_peer || requested != -1;
+        } else {
+            requested = handle_request_packet(c->mem, c->mono_time, &conn->send_array, real_data, real_length, &rtt_calc_time,
+                                              rtt_time, &acked, &lost);
+        }
 
         if (requested == -1) {
             return -1;
@@ -2076,12 +2632,25 @@ static int handle_data_packet_core(Net_Crypto *_Nonnull c, int crypt_connection_
         return -1;
     }
 
+    const uint64_t now = current_time_monotonic(c->mono_time);
+    uint64_t rtt_sample = 0;
+
     if (rtt_calc_time != 0) {
-        const uint64_t rtt_time = current_time_monotonic(c->mono_time) - rtt_calc_time;
+        rtt_sample = now - rtt_calc_time;
 
-        if (rtt_time < conn->rtt_time) {
-            conn->rtt_time = rtt_time;
+        if (rtt_sample < conn->rtt_time) {
+            conn->rtt_time = rtt_sample;
         }
+
+        conn->rtt_sampled = true;
+    }
+
+    if (acked != 0 || rtt_sample != 0) {
+        congestion_on_ack(&conn->congestion, now, acked, rtt_sample);
+    }
+
+    if (lost != 0) {
+        congestion_on_loss(&conn->congestion, now, lost);
     }
 
     return 0;
@@ -2447,10 +3016,9 @@ static int create_crypto_connection(Net_Crypto *_Nonnull c)
 
         // Memsetting float/double to 0 is non-portable, so we explicitly set them to 0
         c->crypto_connections[id].packet_recv_rate = 0.0;
-        c->crypto_connections[id].packet_send_rate = 0.0;
         c->crypto_connections[id].last_packets_left_rem = 0.0;
-        c->crypto_connections[id].packet_send_rate_requested = 0.0;
         c->crypto_connections[id].last_packets_left_requested_rem = 0.0;
+        congestion_init(&c->crypto_connections[id].congestion, c->congestion_control);
 
         // TODO(Green-Sky): This enum is likely unneeded and the same as FREE.
         c->crypto_connections[id].status = CRYPTO_CONN_NO_CONNECTION;
@@ -2485,6 +3053,9 @@ static int wipe_crypto_connection(Net_Crypto *_Nonnull c, int crypt_connection_i
     /* May still be allocated if connection was killed before CRYPTO_CONN_ESTABLISHED. */
     noise_handshake_free(c->mem, &c->crypto_connections[crypt_connection_id].noise_handshake);
 
+    clear_buffer(c->mem, &c->crypto_connections[crypt_connection_id].send_array);
+    clear_buffer(c->mem, &c->crypto_connections[crypt_connection_id].recv_array);
+
     crypto_memzero(&c->crypto_connections[crypt_connection_id], sizeof(Crypto_Connection));
 
     /* check if we can resize the connections array */
@@ -2798,8 +3369,6 @@ int accept_crypto_connection(Net_Crypto *c, const New_Connection *n_c)
     }
 
     memcpy(conn->peer_dht_public_key, n_c->peer_dht_public_key, CRYPTO_PUBLIC_KEY_SIZE);
-    conn->packet_send_rate = CRYPTO_PACKET_MIN_RATE;
-    conn->packet_send_rate_requested = CRYPTO_PACKET_MIN_RATE;
     conn->packets_left = CRYPTO_MIN_QUEUE_LENGTH;
     conn->rtt_time = DEFAULT_PING_CONNECTION;
     crypto_connection_add_source(c, crypt_connection_id, &n_c->source);
@@ -2844,8 +3413,6 @@ int new_crypto_connection(Net_Crypto *c, const uint8_t *real_public_key, const u
     memset(conn->recv_nonce, 0, CRYPTO_NONCE_SIZE);
 
     conn->status = CRYPTO_CONN_COOKIE_REQUESTING;
-    conn->packet_send_rate = CRYPTO_PACKET_MIN_RATE;
-    conn->packet_send_rate_requested = CRYPTO_PACKET_MIN_RATE;
     conn->packets_left = CRYPTO_MIN_QUEUE_LENGTH;
     conn->rtt_time = DEFAULT_PING_CONNECTION;
     memcpy(conn->peer_dht_public_key, dht_public_key, CRYPTO_PUBLIC_KEY_SIZE);
@@ -3251,30 +3818,32 @@ static int udp_handle_packet(void *_Nonnull object, const IP_Port *_Nonnull sour
 }
 
 /** @brief The dT for the average packet receiving rate calculations.
- * Also used as the
+ * Also used as the interval of congestion control updates.
  */
-#define PACKET_COUNTER_AVERAGE_INTERVAL 50
+#define PACKET_COUNTER_AVERAGE_INTERVAL CONGESTION_INTERVAL
 
 /** @brief Ratio of recv queue size / recv packet rate (in seconds) times
  * the number of ms between request packets to send at that ratio
  */
 #define REQUEST_PACKETS_COMPARE_CONSTANT (0.125 * 100.0)
 
-/** @brief Timeout for increasing speed after congestion event (in ms). */
-#define CONGESTION_EVENT_TIMEOUT 1000
-
-/**
- * If the send queue is SEND_QUEUE_RATIO times larger than the
- * calculated link speed the packet send speed will be reduced
- * by a value depending on this number.
+/** @brief Number of received packets a connection may leave in the socket between two runs.
+ *
+ * While a connection receives data, do_net_crypto asks to be run often enough
+ * to read this many packets at a time, so the interval follows the packet
+ * rate instead of being fixed.
  */
-#define SEND_QUEUE_RATIO 2.0
+#define RECV_BATCH_PACKETS 32
+
+/** @brief Time after a TCP packet was sent during which the send rate is kept (in ms). */
+#define TCP_TO_UDP_HOLD_TIME 1000
 
 static void send_crypto_packets(Net_Crypto *_Nonnull c)
 {
     const uint64_t temp_time = current_time_monotonic(c->mono_time);
     double total_send_rate = 0;
-    uint32_t peak_request_packet_interval = -1;
+    /* Time until the earliest receive side deadline of any connection. */
+    uint32_t next_recv_deadline = -1;
 
     for (uint32_t i = 0; i < c->crypto_connections_length; ++i) {
         Crypto_Connection *conn = get_crypto_connection(c, i);
@@ -3320,8 +3889,18 @@ static void send_crypto_packets(Net_Crypto *_Nonnull c)
                     }
                 }
 
-                if (request_packet_interval < peak_request_packet_interval) {
-                    peak_request_packet_interval = request_packet_interval;
+                const uint64_t since_request = temp_time - conn->last_request_packet_sent;
+                const uint32_t until_request = since_request < (uint64_t)request_packet_interval
+                                               ? (uint32_t)((uint64_t)request_packet_interval - since_request) : 0;
+
+                if (until_request < next_recv_deadline) {
+                    next_recv_deadline = until_request;
+                }
+
+                const double recv_batch_interval = RECV_BATCH_PACKETS * 1000.0 / conn->packet_recv_rate;
+
+                if (recv_batch_interval < next_recv_deadline) {
+                    next_recv_deadline = (uint32_t)recv_batch_interval;
                 }
             }
 
@@ -3338,88 +3917,19 @@ static void send_crypto_packets(Net_Crypto *_Nonnull c)
                 const uint32_t packets_resent = conn->packets_resent;
                 conn->packets_resent = 0;
 
-                /* conjestion control
-                 *  calculate a new value of conn->packet_send_rate based on some data
-                 */
-
-                const unsigned int pos = conn->last_sendqueue_counter % CONGESTION_QUEUE_ARRAY_SIZE;
-                conn->last_sendqueue_size[pos] = num_packets_array(&conn->send_array);
-
-                long signed int sum = 0;
-                sum = (long signed int)conn->last_sendqueue_size[pos] -
-                      (long signed int)conn->last_sendqueue_size[(pos + 1) % CONGESTION_QUEUE_ARRAY_SIZE];
-
-                const unsigned int n_p_pos = conn->last_sendqueue_counter % CONGESTION_LAST_SENT_ARRAY_SIZE;
-                conn->last_num_packets_sent[n_p_pos] = packets_sent;
-                conn->last_num_packets_resent[n_p_pos] = packets_resent;
-
-                conn->last_sendqueue_counter = (conn->last_sendqueue_counter + 1) %
-                                               (CONGESTION_QUEUE_ARRAY_SIZE * CONGESTION_LAST_SENT_ARRAY_SIZE);
-
                 bool direct_connected = false;
                 /* return value can be ignored since the `if` above ensures the connection is established */
                 crypto_connection_status(c, i, &direct_connected, nullptr);
 
-                /* When switching from TCP to UDP, don't change the packet send rate for CONGESTION_EVENT_TIMEOUT ms. */
-                if (!(direct_connected && conn->last_tcp_sent + CONGESTION_EVENT_TIMEOUT > temp_time)) {
-                    long signed int total_sent = 0;
-                    long signed int total_resent = 0;
-
-                    // TODO(irungentoo): use real delay
-                    unsigned int delay = (unsigned int)(((double)conn->rtt_time / PACKET_COUNTER_AVERAGE_INTERVAL) + 0.5);
-                    const unsigned int packets_set_rem_array = CONGESTION_LAST_SENT_ARRAY_SIZE - CONGESTION_QUEUE_ARRAY_SIZE;
-
-                    if (delay > packets_set_rem_array) {
-                        delay = packets_set_rem_array;
-                    }
-
-                    for (unsigned j = 0; j < CONGESTION_QUEUE_ARRAY_SIZE; ++j) {
-                        const unsigned int ind = (j + (packets_set_rem_array  - delay) + n_p_pos) % CONGESTION_LAST_SENT_ARRAY_SIZE;
-                        total_sent += conn->last_num_packets_sent[ind];
-                        total_resent += conn->last_num_packets_resent[ind];
-                    }
-
-                    if (sum > 0) {
-                        total_sent -= sum;
-                    } else {
-                        if (total_resent > -sum) {
-                            total_resent = -sum;
-                        }
-                    }
-
-                    /* if queue is too big only allow resending packets. */
-                    const uint32_t npackets = num_packets_array(&conn->send_array);
-                    double min_speed = 1000.0 * (((double)total_sent) / ((double)CONGESTION_QUEUE_ARRAY_SIZE *
-                                                 PACKET_COUNTER_AVERAGE_INTERVAL));
-
-                    const double min_speed_request = 1000.0 * (((double)(total_sent + total_resent)) / (
-                                                         (double)CONGESTION_QUEUE_ARRAY_SIZE * PACKET_COUNTER_AVERAGE_INTERVAL));
-
-                    if (min_speed < CRYPTO_PACKET_MIN_RATE) {
-                        min_speed = CRYPTO_PACKET_MIN_RATE;
-                    }
-
-                    const double send_array_ratio = (double)npackets / min_speed;
-
-                    // TODO(irungentoo): Improve formula?
-                    if (send_array_ratio > SEND_QUEUE_RATIO && CRYPTO_MIN_QUEUE_LENGTH < npackets) {
-                        conn->packet_send_rate = min_speed * (1.0 / (send_array_ratio / SEND_QUEUE_RATIO));
-                    } else if (conn->last_congestion_event + CONGESTION_EVENT_TIMEOUT < temp_time) {
-                        conn->packet_send_rate = min_speed * 1.2;
-                    } else {
-                        conn->packet_send_rate = min_speed * 0.9;
-                    }
-
-                    conn->packet_send_rate_requested = min_speed_request * 1.2;
-
-                    if (conn->packet_send_rate < CRYPTO_PACKET_MIN_RATE) {
-                        conn->packet_send_rate = CRYPTO_PACKET_MIN_RATE;
-                    }
-
-                    if (conn->packet_send_rate_requested < conn->packet_send_rate) {
-                        conn->packet_send_rate_requested = conn->packet_send_rate;
-                    }
-                }
+                Congestion_Interval interval;
+                interval.now = temp_time;
+                interval.packets_sent = packets_sent;
+                interval.packets_resent = packets_resent;
+                interval.send_queue_size = num_packets_array(&conn->send_array);
+                interval.min_rtt = conn->rtt_time;
+                /* When switching from TCP to UDP, don't change the packet send rate for TCP_TO_UDP_HOLD_TIME ms. */
+                interval.hold = direct_connected && conn->last_tcp_sent + TCP_TO_UDP_HOLD_TIME > temp_time;
+                congestion_on_interval(&conn->congestion, &interval);
             }
 
             if (conn->last_packets_left_set == 0 || conn->last_packets_left_requested_set == 0) {
@@ -3428,8 +3938,8 @@ static void send_crypto_packets(Net_Crypto *_Nonnull c)
                 conn->packets_left_requested = CRYPTO_MIN_QUEUE_LENGTH;
                 conn->packets_left = CRYPTO_MIN_QUEUE_LENGTH;
             } else {
-                if (((uint64_t)((1000.0 / conn->packet_send_rate) + 0.5) + conn->last_packets_left_set) <= temp_time) {
-                    double n_packets = conn->packet_send_rate * (((double)(temp_time - conn->last_packets_left_set)) / 1000.0);
+                if (((uint64_t)((1000.0 / conn->congestion.send_rate) + 0.5) + conn->last_packets_left_set) <= temp_time) {
+                    double n_packets = conn->congestion.send_rate * (((double)(temp_time - conn->last_packets_left_set)) / 1000.0);
                     n_packets += conn->last_packets_left_rem;
 
                     const uint32_t num_packets = n_packets;
@@ -3445,9 +3955,9 @@ static void send_crypto_packets(Net_Crypto *_Nonnull c)
                     conn->last_packets_left_rem = rem;
                 }
 
-                if (((uint64_t)((1000.0 / conn->packet_send_rate_requested) + 0.5) + conn->last_packets_left_requested_set) <=
+                if (((uint64_t)((1000.0 / conn->congestion.send_rate_requested) + 0.5) + conn->last_packets_left_requested_set) <=
                         temp_time) {
-                    double n_packets = conn->packet_send_rate_requested * (((double)(temp_time - conn->last_packets_left_requested_set)) /
+                    double n_packets = conn->congestion.send_rate_requested * (((double)(temp_time - conn->last_packets_left_requested_set)) /
                                        1000.0);
                     n_packets += conn->last_packets_left_requested_rem;
 
@@ -3469,23 +3979,24 @@ static void send_crypto_packets(Net_Crypto *_Nonnull c)
             if (ret != -1) {
                 conn->packets_left_requested -= ret;
                 conn->packets_resent += ret;
+                conn->stats.packets_resent += ret;
 
                 if ((unsigned int)ret < conn->packets_left) {
                     conn->packets_left -= ret;
                 } else {
-                    conn->last_congestion_event = temp_time;
+                    congestion_on_send_limited(&conn->congestion, temp_time);
                     conn->packets_left = 0;
                 }
             }
 
-            if (conn->packet_send_rate > CRYPTO_PACKET_MIN_RATE * 1.5) {
-                total_send_rate += conn->packet_send_rate;
+            if (conn->congestion.send_rate > CRYPTO_PACKET_MIN_RATE * 1.5) {
+                total_send_rate += conn->congestion.send_rate;
             }
         }
     }
 
     c->current_sleep_time = -1;
-    uint32_t sleep_time = peak_request_packet_interval;
+    uint32_t sleep_time = next_recv_deadline;
 
     if (c->current_sleep_time > sleep_time) {
         c->current_sleep_time = sleep_time;
@@ -3504,6 +4015,12 @@ static void send_crypto_packets(Net_Crypto *_Nonnull c)
     if (c->current_sleep_time > sleep_time) {
         c->current_sleep_time = sleep_time;
     }
+
+    // A deadline that has already passed is handled on the next run, which
+    // shouldn't be a busy loop.
+    if (c->current_sleep_time == 0) {
+        c->current_sleep_time = 1;
+    }
 }
 
 /**
@@ -3548,14 +4065,20 @@ uint32_t crypto_num_free_sendqueue_slots(const Net_Crypto *c, int crypt_connecti
 int64_t write_cryptpacket(const Net_Crypto *c, int crypt_connection_id, const uint8_t *data, uint16_t length,
                           bool congestion_control)
 {
-    if (length == 0) {
+    return write_cryptpacket_parts(c, crypt_connection_id, data, length, nullptr, 0, congestion_control);
+}
+
+int64_t write_cryptpacket_parts(const Net_Crypto *c, int crypt_connection_id, const uint8_t *header, uint16_t header_length,
+                                const uint8_t *data, uint16_t length, bool congestion_control)
+{
+    if (header_length == 0) {
         // We need at least a packet id.
         LOGGER_ERROR(c->log, "rejecting empty packet for crypto connection %d", crypt_connection_id);
         return -1;
     }
 
-    if (data[0] < PACKET_ID_RANGE_LOSSLESS_START || data[0] > PACKET_ID_RANGE_LOSSLESS_END) {
-        LOGGER_ERROR(c->log, "rejecting lossless packet with out-of-range id %d", data[0]);
+    if (header[0] < PACKET_ID_RANGE_LOSSLESS_START || header[0] > PACKET_ID_RANGE_LOSSLESS_END) {
+        LOGGER_ERROR(c->log, "rejecting lossless packet with out-of-range id %d", header[0]);
         return -1;
     }
 
@@ -3572,12 +4095,13 @@ int64_t write_cryptpacket(const Net_Crypto *c, int crypt_connection_id, const ui
     }
 
     if (congestion_control && conn->packets_left == 0) {
-        LOGGER_ERROR(c->log, "congestion control: rejecting packet of length %d on crypt connection %d", length,
-                     crypt_connection_id);
+        LOGGER_ERROR(c->log, "congestion control: rejecting packet of length %d on crypt connection %d",
+                     header_length + length, crypt_connection_id);
         return -1;
     }
 
-    const int64_t ret = send_lossless_packet(c, crypt_connection_id, data, length, congestion_control);
+    const int64_t ret = send_lossless_packet(c, crypt_connection_id, header, header_length, data, length,
+                        congestion_control);
 
     if (ret == -1) {
         return -1;
@@ -3648,7 +4172,7 @@ int send_lossy_cryptpacket(const Net_Crypto *c, int crypt_connection_id, const u
     if (conn != nullptr) {
         const uint32_t buffer_start = conn->recv_array.buffer_start;
         const uint32_t buffer_end = conn->send_array.buffer_end;
-        ret = send_data_packet_helper(c, crypt_connection_id, buffer_start, buffer_end, data, length);
+        ret = send_data_packet_helper(c, crypt_connection_id, buffer_start, buffer_end, data, length, false);
     }
 
     return ret;
@@ -3675,8 +4199,6 @@ int crypto_kill(Net_Crypto *c, int crypt_connection_id)
         bs_list_remove(&c->ip_port_list, (uint8_t *)&conn->ip_portv4, crypt_connection_id);
         bs_list_remove(&c->ip_port_list, (uint8_t *)&conn->ip_portv6, crypt_connection_id);
         clear_temp_packet(c, crypt_connection_id);
-        clear_buffer(c->mem, &conn->send_array);
-        clear_buffer(c->mem, &conn->recv_array);
         ret = wipe_crypto_connection(c, crypt_connection_id);
     }
 
@@ -3710,6 +4232,46 @@ bool crypto_connection_status(const Net_Crypto *c, int crypt_connection_id, bool
     return true;
 }
 
+uint32_t crypto_connection_rtt(const Net_Crypto *c, int crypt_connection_id)
+{
+    const Crypto_Connection *conn = get_crypto_connection(c, crypt_connection_id);
+
+    if (conn == nullptr) {
+        return 0;
+    }
+
+    if (!conn->rtt_sampled) {
+        return 0;
+    }
+
+    return (uint32_t)min_u64(conn->rtt_time, UINT32_MAX);
+}
+
+bool crypto_connection_stats(const Net_Crypto *c, int crypt_connection_id, Crypto_Connection_Stats *stats)
+{
+    const Crypto_Connection *conn = get_crypto_connection(c, crypt_connection_id);
+
+    if (conn == nullptr) {
+        return false;
+    }
+
+    *stats = conn->stats;
+    stats->send_rate = conn->congestion.send_rate;
+    stats->rtt = conn->rtt_sampled ? conn->rtt_time : 0;
+    stats->congestion_events = conn->congestion.events;
+    return true;
+}
+
+void net_crypto_set_congestion_control(Net_Crypto *c, Congestion_Control_Type type)
+{
+    c->congestion_control = type;
+}
+
+void net_crypto_set_sack(Net_Crypto *c, bool enabled)
+{
+    c->sack_enabled = enabled;
+}
+
 void new_keys(Net_Crypto *c)
 {
     crypto_new_keypair(c->rng, c->self_id_public_key, c->self_id_secret_key);
@@ -3775,6 +4337,8 @@ Net_Crypto *new_net_crypto(const Logger *log, const Memory *mem, const Random *r
 
     /* Handshake mode selection: NOISE_ONLY, NOISE_BOTH, or LEGACY_ONLY */
     temp->handshake_mode = handshake_mode;
+    temp->congestion_control = CONGESTION_CONTROL_LEGACY;
+    temp->sack_enabled = true;
 
     new_keys(temp);
     new_symmetric_key(rng, temp->cookie_symmetric_key);
@@ -3879,3 +4443,39 @@ bool nc_testonly_get_noise_enabled(const Net_Crypto *c, int conn_id)
     }
     return conn->noise_handshake_enabled;
 }
+
+bool nc_testonly_get_sack_enabled(const Net_Crypto *c, int conn_id)
+{
+    const Crypto_Connection *conn = get_crypto_connection(c, conn_id);
+    if (conn == nullptr) {
+        return false;
+    }
+    return c->sack_enabled && conn->sack_peer;
+}
+
+int nc_testonly_generate_request_packet(const Net_Crypto *c, int conn_id, bool sack, uint8_t *data, uint16_t length)
+{
+    const Crypto_Connection *conn = get_crypto_connection(c, conn_id);
+    if (conn == nullptr) {
+        return -1;
+    }
+    return sack ? generate_sack_packet(data, length, &conn->recv_array)
+           : generate_request_packet(data, length, &conn->recv_array);
+}
+
+int nc_testonly_handle_request_packet(Net_Crypto *c, int conn_id, const uint8_t *data, uint16_t length)
+{
+    Crypto_Connection *conn = get_crypto_connection(c, conn_id);
+    if (conn == nullptr || length == 0) {
+        return -1;
+    }
+    uint64_t latest_send_time = 0;
+    uint32_t acked = 0;
+    uint32_t lost = 0;
+    if (data[0] == PACKET_ID_SACK) {
+        return handle_sack_packet(c->mem, c->mono_time, &conn->send_array, data, length, &latest_send_time, conn->rtt_time,
+                                  &acked, &lost);
+    }
+    return handle_request_packet(c->mem, c->mono_time, &conn->send_array, data, length, &latest_send_time, conn->rtt_time,
+                                 &acked, &lost);
+}
@@ -21,6 +21,7 @@
 #include "mem.h"
 #include "mono_time.h"
 #include "net.h"
+#include "net_crypto_congestion.h"
 #include "net_profile.h"
 #include "network.h"
 #include "rng.h"
@@ -77,6 +78,7 @@ typedef struct Net_Crypto_DHT_Funcs {
 typedef enum Packet_Id {
     PACKET_ID_REQUEST            = 1, // Used to request unreceived packets
     PACKET_ID_KILL               = 2, // Used to kill connection
+    PACKET_ID_SACK               = 3, // Used to request unreceived packets as ranges
 
     PACKET_ID_ONLINE             = 24,
     PACKET_ID_OFFLINE            = 25,
@@ -103,10 +105,10 @@ typedef enum Packet_Id {
 #define CRYPTO_PACKET_BUFFER_SIZE 32768 // Must be a power of 2
 
 /** Minimum packet rate per second. */
-#define CRYPTO_PACKET_MIN_RATE 4.0
+#define CRYPTO_PACKET_MIN_RATE CONGESTION_MIN_RATE
 
 /** Minimum packet queue max length. */
-#define CRYPTO_MIN_QUEUE_LENGTH 64
+#define CRYPTO_MIN_QUEUE_LENGTH CONGESTION_MIN_QUEUE_LENGTH
 
 /** Maximum total size of packets that net_crypto sends. */
 #define MAX_CRYPTO_PACKET_SIZE 1400
@@ -134,13 +136,6 @@ typedef enum Packet_Id {
 /** All packets will be padded a number of bytes based on this number. */
 #define CRYPTO_MAX_PADDING 8
 
-/**
- * Base current transfer speed on last CONGESTION_QUEUE_ARRAY_SIZE number of points taken
- * at the dT defined in net_crypto.c
- */
-#define CONGESTION_QUEUE_ARRAY_SIZE 12
-#define CONGESTION_LAST_SENT_ARRAY_SIZE (CONGESTION_QUEUE_ARRAY_SIZE * 2)
-
 /** Default connection ping in ms. */
 #define DEFAULT_PING_CONNECTION 1000
 #define DEFAULT_TCP_PING_CONNECTION 500
@@ -268,6 +263,16 @@ bool max_speed_reached(const Net_Crypto *_Nonnull c, int crypt_connection_id);
  */
 int64_t write_cryptpacket(const Net_Crypto *_Nonnull c, int crypt_connection_id, const uint8_t *_Nonnull data, uint16_t length, bool congestion_control);
 
+/** @brief Sends a lossless cryptopacket made of a header followed by a payload.
+ *
+ * Same as write_cryptpacket, but the two parts are copied straight into the
+ * send queue, so large payloads don't need to be staged next to their header
+ * first. The first byte of the header must be in the PACKET_ID_RANGE_LOSSLESS.
+ */
+int64_t write_cryptpacket_parts(const Net_Crypto *_Nonnull c, int crypt_connection_id,
+                                const uint8_t *_Nonnull header, uint16_t header_length,
+                                const uint8_t *_Nullable data, uint16_t length, bool congestion_control);
+
 /** @brief Check if packet_number was received by the other side.
  *
  * packet_number must be a valid packet number of a packet sent on this connection.
@@ -374,6 +379,54 @@ int crypto_kill(Net_Crypto *_Nonnull c, int crypt_connection_id);
  */
 bool crypto_connection_status(
     const Net_Crypto *_Nonnull c, int crypt_connection_id, bool *_Nonnull direct_connected, uint32_t *_Nullable online_tcp_relays);
+
+/**
+ * @return the smallest round trip time in milliseconds measured on the
+ *   connection so far.
+ * @retval 0 if the connection is invalid or no round trip was measured yet.
+ */
+uint32_t crypto_connection_rtt(const Net_Crypto *_Nonnull c, int crypt_connection_id);
+
+/** @brief Traffic and latency counters of one crypto connection. */
+typedef struct Crypto_Connection_Stats {
+    /** Encrypted data packets and their size on the wire, UDP and TCP. */
+    uint64_t packets_sent;
+    uint64_t bytes_sent;
+    uint64_t packets_received;
+    uint64_t bytes_received;
+    /** Lossless packets sent again because the peer requested them. */
+    uint64_t packets_resent;
+    /** Lossless packets per second the congestion controller allows. */
+    double send_rate;
+    /** Smallest round trip time in milliseconds, as `crypto_connection_rtt`. */
+    uint64_t rtt;
+    /** Times the congestion controller backed off. */
+    uint64_t congestion_events;
+} Crypto_Connection_Stats;
+
+/**
+ * @brief Fill `stats` with the counters of a connection since it was created.
+ *
+ * @retval false if the connection is invalid.
+ */
+bool crypto_connection_stats(const Net_Crypto *_Nonnull c, int crypt_connection_id, Crypto_Connection_Stats *_Nonnull stats);
+
+/**
+ * @brief Select the congestion controller for connections created from now on.
+ *
+ * Existing connections keep theirs. The default is @ref CONGESTION_CONTROL_LEGACY.
+ */
+void net_crypto_set_congestion_control(Net_Crypto *_Nonnull c, Congestion_Control_Type type);
+
+/**
+ * @brief Allow or forbid selective-ack request packets.
+ *
+ * When allowed (the default), each connection offers them to the peer next to
+ * the old request packets and switches to them once the peer sends one back.
+ * When forbidden, only old request packets are sent and received ones are
+ * dropped, like a peer that doesn't know them.
+ */
+void net_crypto_set_sack(Net_Crypto *_Nonnull c, bool enabled);
 /** @brief Generate our public and private keys.
  * Only call this function the first time the program starts.
  */
@@ -408,6 +461,9 @@ void kill_net_crypto(Net_Crypto *_Nullable c);
 /** Unit test support functions. Do not use outside tests. */
 void nc_testonly_get_secrets(const Net_Crypto *_Nonnull c, int conn_id, uint8_t *_Nonnull shared_key, uint8_t *_Nonnull sent_nonce, uint8_t *_Nonnull recv_nonce);
 bool nc_testonly_get_noise_enabled(const Net_Crypto *_Nonnull c, int conn_id);
+bool nc_testonly_get_sack_enabled(const Net_Crypto *_Nonnull c, int conn_id);
+int nc_testonly_generate_request_packet(const Net_Crypto *_Nonnull c, int conn_id, bool sack, uint8_t *_Nonnull data, uint16_t length);
+int nc_testonly_handle_request_packet(Net_Crypto *_Nonnull c, int conn_id, const uint8_t *_Nonnull data, uint16_t length);
 
 #ifdef __cplusplus
 } /* extern "C" */
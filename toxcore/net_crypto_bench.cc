@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// Memory cost of crypto connections that don't carry data yet, like those of
+// friends that are being looked for.
+//
+// Arguments:
+// - connections: number of connections created per iteration.
+//
+// Reported counters:
+// - bytes_per_connection: bytes allocated per connection, including its share
+//   of the connections array.
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../testing/support/public/simulated_environment.hh"
+#include "DHT_test_util.hh"
+#include "crypto_core.h"
+#include "net_crypto.h"
+#include "net_profile.h"
+
+namespace {
+
+using tox::test::SimulatedEnvironment;
+
+void BM_ConnectionMemory(benchmark::State &state)
+{
+    const std::size_t num_connections = static_cast<std::size_t>(state.range(0));
+
+    SimulatedEnvironment env{12345};
+    WrappedMockDHT dht(env, 33445);
+    const Memory *mem = &dht.node().c_memory;
+
+    std::unique_ptr<Net_Profile, std::function<void(Net_Profile *)>> net_profile(
+        netprof_new(dht.logger(), mem), [mem](Net_Profile *p) { netprof_kill(mem, p); });
+
+    TCP_Proxy_Info proxy_info = {{0}, TCP_PROXY_NONE};
+    std::unique_ptr<Net_Crypto, void (*)(Net_Crypto *)> net_crypto(
+        new_net_crypto(dht.logger(), mem, &dht.node().c_random, &dht.node().c_network,
+            dht.mono_time(), dht.networking(), dht.get_dht(), &WrappedMockDHT::funcs,
+            &proxy_info, net_profile.get(), CRYPTO_HANDSHAKE_MODE_NOISE_BOTH),
+        kill_net_crypto);
+
+    if (net_profile == nullptr || net_crypto == nullptr) {
+        state.SkipWithError("failed to create net_crypto");
+        return;
+    }
+
+    using Public_Key = std::array<std::uint8_t, CRYPTO_PUBLIC_KEY_SIZE>;
+    std::vector<Public_Key> real_keys(num_connections);
+    std::vector<Public_Key> dht_keys(num_connections);
+
+    for (std::size_t i = 0; i < num_connections; ++i) {
+        random_bytes(&dht.node().c_random, real_keys[i].data(), real_keys[i].size());
+        random_bytes(&dht.node().c_random, dht_keys[i].data(), dht_keys[i].size());
+    }
+
+    tox::test::FakeMemory &memory = env.fake_memory();
+    std::vector<int> ids;
+    ids.reserve(num_connections);
+    std::size_t bytes = 0;
+
+    for (auto _ : state) {
+        const std::size_t before = memory.current_allocation();
+
+        for (std::size_t i = 0; i < num_connections; ++i) {
+            ids.push_back(
+                new_crypto_connection(net_crypto.get(), real_keys[i].data(), dht_keys[i].data()));
+        }
+
+        state.PauseTiming();
+        bytes = memory.current_allocation() - before;
+
+        for (const int id : ids) {
+            if (id == -1) {
+                state.SkipWithError("failed to create connection");
+                return;
+            }
+
+            crypto_kill(net_crypto.get(), id);
+        }
+
+        ids.clear();
+        state.ResumeTiming();
+    }
+
+    state.counters["bytes_per_connection"]
+        = static_cast<double>(bytes) / static_cast<double>(num_connections);
+}
+
+BENCHMARK(BM_ConnectionMemory)
+    ->ArgName("connections")
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,350 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+#include "net_crypto_congestion.h"
+
+#include <string.h>
+
+#include "ccompat.h"
+
+/** @brief Timeout for increasing speed after congestion event (in ms). */
+#define CONGESTION_EVENT_TIMEOUT 1000
+
+/**
+ * If the send queue is SEND_QUEUE_RATIO times larger than the
+ * calculated link speed the packet send speed will be reduced
+ * by a value depending on this number.
+ */
+#define SEND_QUEUE_RATIO 2.0
+
+static void legacy_on_interval(Congestion_Control *_Nonnull cc, const Congestion_Interval *_Nonnull interval)
+{
+    Congestion_Legacy *legacy = &cc->state.legacy;
+
+    const unsigned int pos = legacy->last_sendqueue_counter % CONGESTION_QUEUE_ARRAY_SIZE;
+    legacy->last_sendqueue_size[pos] = interval->send_queue_size;
+
+    long signed int sum = 0;
+    sum = (long signed int)legacy->last_sendqueue_size[pos] -
+          (long signed int)legacy->last_sendqueue_size[(pos + 1) % CONGESTION_QUEUE_ARRAY_SIZE];
+
+    const unsigned int n_p_pos = legacy->last_sendqueue_counter % CONGESTION_LAST_SENT_ARRAY_SIZE;
+    legacy->last_num_packets_sent[n_p_pos] = interval->packets_sent;
+    legacy->last_num_packets_resent[n_p_pos] = interval->packets_resent;
+
+    legacy->last_sendqueue_counter = (legacy->last_sendqueue_counter + 1) %
+                                     (CONGESTION_QUEUE_ARRAY_SIZE * CONGESTION_LAST_SENT_ARRAY_SIZE);
+
+    if (interval->hold) {
+        return;
+    }
+
+    long signed int total_sent = 0;
+    long signed int total_resent = 0;
+
+    // TODO(irungentoo): use real delay
+    unsigned int delay = (unsigned int)(((double)interval->min_rtt / CONGESTION_INTERVAL) + 0.5);
+    const unsigned int packets_set_rem_array = CONGESTION_LAST_SENT_ARRAY_SIZE - CONGESTION_QUEUE_ARRAY_SIZE;
+
+    if (delay > packets_set_rem_array) {
+        delay = packets_set_rem_array;
+    }
+
+    for (unsigned j = 0; j < CONGESTION_QUEUE_ARRAY_SIZE; ++j) {
+        const unsigned int ind = (j + (packets_set_rem_array  - delay) + n_p_pos) % CONGESTION_LAST_SENT_ARRAY_SIZE;
+        total_sent += legacy->last_num_packets_sent[ind];
+        total_resent += legacy->last_num_packets_resent[ind];
+    }
+
+    if (sum > 0) {
+        total_sent -= sum;
+    } else {
+        if (total_resent > -sum) {
+            total_resent = -sum;
+        }
+    }
+
+    /* if queue is too big only allow resending packets. */
+    const uint32_t npackets = interval->send_queue_size;
+    double min_speed = 1000.0 * (((double)total_sent) / ((double)CONGESTION_QUEUE_ARRAY_SIZE *
+                                 CONGESTION_INTERVAL));
+
+    const double min_speed_request = 1000.0 * (((double)(total_sent + total_resent)) / (
+                                         (double)CONGESTION_QUEUE_ARRAY_SIZE * CONGESTION_INTERVAL));
+
+    if (min_speed < CONGESTION_MIN_RATE) {
+        min_speed = CONGESTION_MIN_RATE;
+    }
+
+    const double send_array_ratio = (double)npackets / min_speed;
+
+    // TODO(irungentoo): Improve formula?
+    if (send_array_ratio > SEND_QUEUE_RATIO && CONGESTION_MIN_QUEUE_LENGTH < npackets) {
+        cc->send_rate = min_speed * (1.0 / (send_array_ratio / SEND_QUEUE_RATIO));
+    } else if (legacy->last_congestion_event + CONGESTION_EVENT_TIMEOUT < interval->now) {
+        cc->send_rate = min_speed * 1.2;
+    } else {
+        cc->send_rate = min_speed * 0.9;
+    }
+
+    cc->send_rate_requested = min_speed_request * 1.2;
+
+    if (cc->send_rate < CONGESTION_MIN_RATE) {
+        cc->send_rate = CONGESTION_MIN_RATE;
+    }
+
+    if (cc->send_rate_requested < cc->send_rate) {
+        cc->send_rate_requested = cc->send_rate;
+    }
+}
+
+static void legacy_on_ack(Congestion_Control *_Nonnull cc, uint64_t now, uint32_t acked, uint64_t rtt)
+{
+    /* The legacy controller only looks at the per-interval statistics. */
+}
+
+static void legacy_on_loss(Congestion_Control *_Nonnull cc, uint64_t now, uint32_t lost)
+{
+    /* Re-requested packets show up in the per-interval statistics. */
+}
+
+static void legacy_on_send_limited(Congestion_Control *_Nonnull cc, uint64_t now)
+{
+    Congestion_Legacy *legacy = &cc->state.legacy;
+
+    /* Running out again while the rate is still being lowered is the same event. */
+    if (legacy->last_congestion_event + CONGESTION_EVENT_TIMEOUT < now) {
+        ++cc->events;
+    }
+
+    legacy->last_congestion_event = now;
+}
+
+static const Congestion_Control_Funcs legacy_funcs = {
+    CONGESTION_CONTROL_LEGACY,
+    legacy_on_interval,
+    legacy_on_ack,
+    legacy_on_loss,
+    legacy_on_send_limited,
+};
+
+/** @brief CUBIC scaling constant, in packets per second cubed. */
+#define CUBIC_C 0.4
+/** @brief Multiplicative window decrease on loss. */
+#define CUBIC_BETA 0.7
+/** @brief Reno window increase per RTT in the TCP-friendly region. */
+#define CUBIC_ALPHA (3.0 * (1.0 - CUBIC_BETA) / (1.0 + CUBIC_BETA))
+
+#define CUBIC_INITIAL_WINDOW 10.0
+#define CUBIC_MIN_WINDOW 2.0
+/** @brief The send array can't hold more packets than this anyway. */
+#define CUBIC_MAX_WINDOW 32768.0
+
+/** @brief RTT in ms assumed until the first sample. */
+#define CUBIC_DEFAULT_RTT 1000.0
+
+/** @brief Pacing gain during slow start, so the rate keeps up with the doubling window. */
+#define CUBIC_SLOW_START_GAIN 2.0
+
+static double cube_root(double x)
+{
+    if (x <= 0.0) {
+        return 0.0;
+    }
+
+    double y = 1.0;
+
+    while (y * y * y < x) {
+        y *= 2.0;
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        y = (2.0 * y + x / (y * y)) / 3.0;
+    }
+
+    return y;
+}
+
+static double cubic_rtt(const Congestion_Cubic *_Nonnull cubic)
+{
+    return cubic->srtt != 0.0 ? cubic->srtt : CUBIC_DEFAULT_RTT;
+}
+
+static void cubic_update_rate(Congestion_Control *_Nonnull cc)
+{
+    const Congestion_Cubic *cubic = &cc->state.cubic;
+    const double gain = cubic->cwnd < cubic->ssthresh ? CUBIC_SLOW_START_GAIN : 1.0;
+
+    cc->send_rate = gain * cubic->cwnd * 1000.0 / cubic_rtt(cubic);
+
+    if (cc->send_rate < CONGESTION_MIN_RATE) {
+        cc->send_rate = CONGESTION_MIN_RATE;
+    }
+
+    /* Re-requested packets are sent within the window, not on top of it. */
+    cc->send_rate_requested = cc->send_rate;
+}
+
+static void cubic_on_interval(Congestion_Control *_Nonnull cc, const Congestion_Interval *_Nonnull interval)
+{
+    cc->state.cubic.send_queue_size = interval->send_queue_size;
+}
+
+static void cubic_on_ack(Congestion_Control *_Nonnull cc, uint64_t now, uint32_t acked, uint64_t rtt)
+{
+    Congestion_Cubic *cubic = &cc->state.cubic;
+
+    if (rtt != 0) {
+        cubic->srtt = cubic->srtt == 0.0 ? (double)rtt : cubic->srtt + ((double)rtt - cubic->srtt) / 8.0;
+
+        if (cubic->min_rtt == 0 || rtt < cubic->min_rtt) {
+            cubic->min_rtt = rtt;
+        }
+    }
+
+    /* Don't grow the window while the application doesn't fill it. */
+    if (acked == 0 || (double)cubic->send_queue_size * 2.0 < cubic->cwnd) {
+        cubic_update_rate(cc);
+        return;
+    }
+
+    if (cubic->cwnd < cubic->ssthresh) {
+        cubic->cwnd += acked;
+    } else {
+        if (cubic->epoch_start == 0) {
+            cubic->epoch_start = now;
+            cubic->w_est = cubic->cwnd;
+
+            if (cubic->cwnd < cubic->w_max) {
+                cubic->k = cube_root((cubic->w_max - cubic->cwnd) / CUBIC_C);
+                cubic->origin = cubic->w_max;
+            } else {
+                cubic->k = 0.0;
+                cubic->origin = cubic->cwnd;
+            }
+        }
+
+        /* The window the cubic function reaches one RTT from now. */
+        const double t = (double)(now - cubic->epoch_start) / 1000.0 + cubic_rtt(cubic) / 1000.0 - cubic->k;
+        double target = cubic->origin + CUBIC_C * t * t * t;
+
+        cubic->w_est += CUBIC_ALPHA * acked / cubic->cwnd;
+
+        /* Grow at least as fast as Reno would. */
+        if (target < cubic->w_est) {
+            target = cubic->w_est;
+        }
+
+        if (target > cubic->cwnd * 1.5) {
+            target = cubic->cwnd * 1.5;
+        }
+
+        if (target > cubic->cwnd) {
+            cubic->cwnd += (target - cubic->cwnd) / cubic->cwnd * acked;
+        }
+    }
+
+    if (cubic->cwnd > CUBIC_MAX_WINDOW) {
+        cubic->cwnd = CUBIC_MAX_WINDOW;
+    }
+
+    cubic_update_rate(cc);
+}
+
+static void cubic_on_loss(Congestion_Control *_Nonnull cc, uint64_t now, uint32_t lost)
+{
+    Congestion_Cubic *cubic = &cc->state.cubic;
+
+    if (lost == 0 || now < cubic->recovery_end) {
+        return;
+    }
+
+    /* Losses within the next RTT are from the same congestion event. */
+    ++cc->events;
+    cubic->recovery_end = now + (uint64_t)cubic_rtt(cubic);
+    cubic->epoch_start = 0;
+
+    /* Fast convergence: give up bandwidth faster if the window keeps shrinking. */
+    if (cubic->cwnd < cubic->w_max) {
+        cubic->w_max = cubic->cwnd * (1.0 + CUBIC_BETA) / 2.0;
+    } else {
+        cubic->w_max = cubic->cwnd;
+    }
+
+    cubic->cwnd *= CUBIC_BETA;
+
+    if (cubic->cwnd < CUBIC_MIN_WINDOW) {
+        cubic->cwnd = CUBIC_MIN_WINDOW;
+    }
+
+    cubic->ssthresh = cubic->cwnd;
+    cubic_update_rate(cc);
+}
+
+static void cubic_on_send_limited(Congestion_Control *_Nonnull cc, uint64_t now)
+{
+    /* Running out of packets to send is not a congestion signal for CUBIC. */
+}
+
+static const Congestion_Control_Funcs cubic_funcs = {
+    CONGESTION_CONTROL_CUBIC,
+    cubic_on_interval,
+    cubic_on_ack,
+    cubic_on_loss,
+    cubic_on_send_limited,
+};
+
+void congestion_init(Congestion_Control *cc, Congestion_Control_Type type)
+{
+    memset(cc, 0, sizeof(*cc));
+
+    // Memsetting float/double to 0 is non-portable, so we explicitly set them.
+    cc->send_rate = CONGESTION_MIN_RATE;
+    cc->send_rate_requested = CONGESTION_MIN_RATE;
+
+    switch (type) {
+        case CONGESTION_CONTROL_CUBIC: {
+            Congestion_Cubic *cubic = &cc->state.cubic;
+            cc->funcs = &cubic_funcs;
+            cubic->cwnd = CUBIC_INITIAL_WINDOW;
+            cubic->ssthresh = CUBIC_MAX_WINDOW;
+            cubic->w_max = 0.0;
+            cubic->w_est = 0.0;
+            cubic->k = 0.0;
+            cubic->origin = 0.0;
+            cubic->srtt = 0.0;
+            return;
+        }
+
+        case CONGESTION_CONTROL_LEGACY:
+            break;
+    }
+
+    cc->funcs = &legacy_funcs;
+}
+
+Congestion_Control_Type congestion_type(const Congestion_Control *cc)
+{
+    return cc->funcs->type;
+}
+
+void congestion_on_interval(Congestion_Control *cc, const Congestion_Interval *interval)
+{
+    cc->funcs->on_interval(cc, interval);
+}
+
+void congestion_on_ack(Congestion_Control *cc, uint64_t now, uint32_t acked, uint64_t rtt)
+{
+    cc->funcs->on_ack(cc, now, acked, rtt);
+}
+
+void congestion_on_loss(Congestion_Control *cc, uint64_t now, uint32_t lost)
+{
+    cc->funcs->on_loss(cc, now, lost);
+}
+
+void congestion_on_send_limited(Congestion_Control *cc, uint64_t now)
+{
+    cc->funcs->on_send_limited(cc, now);
+}
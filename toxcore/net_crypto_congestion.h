@@ -0,0 +1,159 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+/**
+ * Congestion control for net_crypto connections.
+ *
+ * A controller decides how many lossless packets per second a connection may
+ * send. net_crypto feeds it what it observes (acks and re-requests from
+ * request packets, RTT samples, and per-interval send statistics) and paces
+ * its sends with a token bucket filled at the rates the controller sets.
+ */
+#ifndef C_TOXCORE_TOXCORE_NET_CRYPTO_CONGESTION_H
+#define C_TOXCORE_TOXCORE_NET_CRYPTO_CONGESTION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "attributes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Minimum packet rate per second. */
+#define CONGESTION_MIN_RATE 4.0
+
+/** @brief Minimum packet queue max length. */
+#define CONGESTION_MIN_QUEUE_LENGTH 64
+
+/** @brief Interval in ms at which `congestion_on_interval` is called. */
+#define CONGESTION_INTERVAL 50
+
+/**
+ * Base current transfer speed on last CONGESTION_QUEUE_ARRAY_SIZE number of points taken
+ * at the dT defined by CONGESTION_INTERVAL.
+ */
+#define CONGESTION_QUEUE_ARRAY_SIZE 12
+#define CONGESTION_LAST_SENT_ARRAY_SIZE (CONGESTION_QUEUE_ARRAY_SIZE * 2)
+
+/** @brief The available congestion controllers. */
+typedef enum Congestion_Control_Type {
+    /** The send queue heuristic net_crypto has always used. */
+    CONGESTION_CONTROL_LEGACY,
+    /** CUBIC (RFC 9438) window growth, converted to a rate with the smoothed RTT. */
+    CONGESTION_CONTROL_CUBIC,
+} Congestion_Control_Type;
+
+/** @brief What the sender did during the last `CONGESTION_INTERVAL` ms. */
+typedef struct Congestion_Interval {
+    uint64_t now;
+    /** New lossless packets sent. */
+    uint32_t packets_sent;
+    /** Packets sent again because the peer requested them. */
+    uint32_t packets_resent;
+    /** Packets sent but not yet acked. */
+    uint32_t send_queue_size;
+    /** Lowest RTT seen on the connection. */
+    uint64_t min_rtt;
+    /** Keep the current rates, e.g. right after switching from TCP to UDP. */
+    bool hold;
+} Congestion_Interval;
+
+typedef struct Congestion_Legacy {
+    uint32_t last_sendqueue_size[CONGESTION_QUEUE_ARRAY_SIZE];
+    uint32_t last_sendqueue_counter;
+    long signed int last_num_packets_sent[CONGESTION_LAST_SENT_ARRAY_SIZE];
+    long signed int last_num_packets_resent[CONGESTION_LAST_SENT_ARRAY_SIZE];
+    uint64_t last_congestion_event;
+} Congestion_Legacy;
+
+typedef struct Congestion_Cubic {
+    /** Congestion window in packets. */
+    double cwnd;
+    double ssthresh;
+    /** Window before the last reduction. */
+    double w_max;
+    /** Window a Reno sender would have, for the TCP-friendly region. */
+    double w_est;
+    /** Time in seconds the cubic function takes to grow back to `origin`. */
+    double k;
+    double origin;
+    /** Start of the current congestion avoidance epoch, 0 if none. */
+    uint64_t epoch_start;
+    /** Losses reported before this time belong to the last congestion event. */
+    uint64_t recovery_end;
+    /** Smoothed RTT in ms, 0 until the first sample. */
+    double srtt;
+    uint64_t min_rtt;
+    uint32_t send_queue_size;
+} Congestion_Cubic;
+
+typedef struct Congestion_Control Congestion_Control;
+
+typedef void congestion_interval_cb(Congestion_Control *_Nonnull cc, const Congestion_Interval *_Nonnull interval);
+typedef void congestion_ack_cb(Congestion_Control *_Nonnull cc, uint64_t now, uint32_t acked, uint64_t rtt);
+typedef void congestion_loss_cb(Congestion_Control *_Nonnull cc, uint64_t now, uint32_t lost);
+typedef void congestion_send_limited_cb(Congestion_Control *_Nonnull cc, uint64_t now);
+
+/** @brief The functions a congestion controller implements. */
+typedef struct Congestion_Control_Funcs {
+    Congestion_Control_Type type;
+    congestion_interval_cb *_Nonnull on_interval;
+    congestion_ack_cb *_Nonnull on_ack;
+    congestion_loss_cb *_Nonnull on_loss;
+    congestion_send_limited_cb *_Nonnull on_send_limited;
+} Congestion_Control_Funcs;
+
+/**
+ * @brief The congestion control state of one connection.
+ *
+ * Embedded in the connection, so the controller state is a union rather than
+ * a separate allocation.
+ */
+struct Congestion_Control {
+    const Congestion_Control_Funcs *_Nonnull funcs;
+
+    /** Packets per second for new packets. */
+    double send_rate;
+    /** Packets per second for new and re-requested packets, at least `send_rate`. */
+    double send_rate_requested;
+
+    /** Congestion events so far, i.e. how often the controller backed off. */
+    uint64_t events;
+
+    union {
+        Congestion_Legacy legacy;
+        Congestion_Cubic cubic;
+    } state;
+};
+
+/** @brief Reset `cc` to the initial state of the given controller. */
+void congestion_init(Congestion_Control *_Nonnull cc, Congestion_Control_Type type);
+
+Congestion_Control_Type congestion_type(const Congestion_Control *_Nonnull cc);
+
+/** @brief Called every `CONGESTION_INTERVAL` ms while the connection is established. */
+void congestion_on_interval(Congestion_Control *_Nonnull cc, const Congestion_Interval *_Nonnull interval);
+
+/**
+ * @brief Called for each request packet received.
+ *
+ * @param acked Number of packets the request packet acknowledged.
+ * @param rtt RTT sample in ms from the newest acknowledged packet, or 0 if
+ *   there was none.
+ */
+void congestion_on_ack(Congestion_Control *_Nonnull cc, uint64_t now, uint32_t acked, uint64_t rtt);
+
+/** @brief Called when the peer requested packets again that were sent more than an RTT ago. */
+void congestion_on_loss(Congestion_Control *_Nonnull cc, uint64_t now, uint32_t lost);
+
+/** @brief Called when re-requested packets used up all of the packets the connection may send. */
+void congestion_on_send_limited(Congestion_Control *_Nonnull cc, uint64_t now);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* C_TOXCORE_TOXCORE_NET_CRYPTO_CONGESTION_H */
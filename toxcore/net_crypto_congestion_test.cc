@@ -0,0 +1,185 @@
+#include "net_crypto_congestion.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+namespace {
+
+Congestion_Interval make_interval(std::uint64_t now, std::uint32_t sent, std::uint32_t queue)
+{
+    Congestion_Interval interval{};
+    interval.now = now;
+    interval.packets_sent = sent;
+    interval.send_queue_size = queue;
+    interval.min_rtt = 100;
+    return interval;
+}
+
+TEST(CongestionControl, InitSelectsController)
+{
+    Congestion_Control cc;
+
+    congestion_init(&cc, CONGESTION_CONTROL_LEGACY);
+    EXPECT_EQ(congestion_type(&cc), CONGESTION_CONTROL_LEGACY);
+    EXPECT_EQ(cc.send_rate, CONGESTION_MIN_RATE);
+    EXPECT_EQ(cc.send_rate_requested, CONGESTION_MIN_RATE);
+
+    congestion_init(&cc, CONGESTION_CONTROL_CUBIC);
+    EXPECT_EQ(congestion_type(&cc), CONGESTION_CONTROL_CUBIC);
+    EXPECT_EQ(cc.send_rate, CONGESTION_MIN_RATE);
+}
+
+TEST(CongestionControl, LegacySpeedsUpWhileQueueIsShort)
+{
+    Congestion_Control cc;
+    congestion_init(&cc, CONGESTION_CONTROL_LEGACY);
+
+    std::uint64_t now = 10000;
+
+    for (int i = 0; i < CONGESTION_LAST_SENT_ARRAY_SIZE; ++i) {
+        const Congestion_Interval interval = make_interval(now, 10, 20);
+        congestion_on_interval(&cc, &interval);
+        now += CONGESTION_INTERVAL;
+    }
+
+    // 10 packets per 50 ms interval is 200 packets per second, plus 20%.
+    EXPECT_DOUBLE_EQ(cc.send_rate, 240.0);
+    EXPECT_DOUBLE_EQ(cc.send_rate_requested, 240.0);
+}
+
+TEST(CongestionControl, LegacySlowsDownAfterSendLimit)
+{
+    Congestion_Control cc;
+    congestion_init(&cc, CONGESTION_CONTROL_LEGACY);
+
+    std::uint64_t now = 10000;
+
+    for (int i = 0; i < CONGESTION_LAST_SENT_ARRAY_SIZE; ++i) {
+        const Congestion_Interval interval = make_interval(now, 10, 20);
+        congestion_on_interval(&cc, &interval);
+        now += CONGESTION_INTERVAL;
+    }
+
+    congestion_on_send_limited(&cc, now);
+    const Congestion_Interval interval = make_interval(now, 10, 20);
+    congestion_on_interval(&cc, &interval);
+    EXPECT_DOUBLE_EQ(cc.send_rate, 180.0);
+    EXPECT_EQ(cc.events, 1);
+
+    // Running out again within a second is the same event.
+    congestion_on_send_limited(&cc, now + CONGESTION_INTERVAL);
+    EXPECT_EQ(cc.events, 1);
+}
+
+TEST(CongestionControl, LegacyKeepsRateOnHold)
+{
+    Congestion_Control cc;
+    congestion_init(&cc, CONGESTION_CONTROL_LEGACY);
+
+    Congestion_Interval interval = make_interval(10000, 10, 20);
+    interval.hold = true;
+    congestion_on_interval(&cc, &interval);
+    EXPECT_EQ(cc.send_rate, CONGESTION_MIN_RATE);
+}
+
+/** Acks `acked` packets with a full send queue, so the window isn't application limited. */
+void cubic_ack(Congestion_Control &cc, std::uint64_t now, std::uint32_t acked, std::uint64_t rtt)
+{
+    const Congestion_Interval interval = make_interval(now, 0, 100000);
+    congestion_on_interval(&cc, &interval);
+    congestion_on_ack(&cc, now, acked, rtt);
+}
+
+TEST(CongestionControl, CubicSendsOneWindowPerRtt)
+{
+    Congestion_Control cc;
+    congestion_init(&cc, CONGESTION_CONTROL_CUBIC);
+
+    cubic_ack(cc, 1000, 10, 100);
+
+    // Slow start: 20 packets per 100 ms, doubled to keep up with the window.
+    EXPECT_DOUBLE_EQ(cc.state.cubic.cwnd, 20.0);
+    EXPECT_DOUBLE_EQ(cc.send_rate, 400.0);
+    EXPECT_DOUBLE_EQ(cc.send_rate_requested, cc.send_rate);
+}
+
+TEST(CongestionControl, CubicReducesWindowOncePerLossEvent)
+{
+    Congestion_Control cc;
+    congestion_init(&cc, CONGESTION_CONTROL_CUBIC);
+
+    cubic_ack(cc, 1000, 90, 100);
+    ASSERT_DOUBLE_EQ(cc.state.cubic.cwnd, 100.0);
+
+    congestion_on_loss(&cc, 1100, 3);
+    EXPECT_DOUBLE_EQ(cc.state.cubic.cwnd, 70.0);
+    EXPECT_DOUBLE_EQ(cc.state.cubic.w_max, 100.0);
+    EXPECT_DOUBLE_EQ(cc.send_rate, 700.0);
+
+    // Within the same RTT: same congestion event.
+    congestion_on_loss(&cc, 1150, 1);
+    EXPECT_DOUBLE_EQ(cc.state.cubic.cwnd, 70.0);
+    EXPECT_EQ(cc.events, 1);
+
+    congestion_on_loss(&cc, 1300, 1);
+    EXPECT_DOUBLE_EQ(cc.state.cubic.cwnd, 49.0);
+    EXPECT_EQ(cc.events, 2);
+}
+
+TEST(CongestionControl, CubicGrowsBackToWindowBeforeLoss)
+{
+    Congestion_Control cc;
+    congestion_init(&cc, CONGESTION_CONTROL_CUBIC);
+
+    cubic_ack(cc, 1000, 90, 100);
+    congestion_on_loss(&cc, 1100, 1);
+    ASSERT_DOUBLE_EQ(cc.state.cubic.cwnd, 70.0);
+
+    // Ack a window every RTT for 10 seconds.
+    double previous = cc.state.cubic.cwnd;
+    bool reached_w_max = false;
+
+    for (std::uint64_t now = 1200; now < 11200; now += 100) {
+        cubic_ack(cc, now, static_cast<std::uint32_t>(cc.state.cubic.cwnd), 100);
+        EXPECT_GE(cc.state.cubic.cwnd, previous);
+        previous = cc.state.cubic.cwnd;
+
+        if (cc.state.cubic.cwnd >= 100.0) {
+            reached_w_max = true;
+        }
+    }
+
+    EXPECT_TRUE(reached_w_max);
+    // Past w_max, growth speeds up again.
+    EXPECT_GT(cc.state.cubic.cwnd, 150.0);
+}
+
+TEST(CongestionControl, CubicDoesNotGrowWhileApplicationLimited)
+{
+    Congestion_Control cc;
+    congestion_init(&cc, CONGESTION_CONTROL_CUBIC);
+
+    for (std::uint64_t now = 1000; now < 5000; now += 100) {
+        const Congestion_Interval interval = make_interval(now, 1, 1);
+        congestion_on_interval(&cc, &interval);
+        congestion_on_ack(&cc, now, 1, 100);
+    }
+
+    EXPECT_DOUBLE_EQ(cc.state.cubic.cwnd, 10.0);
+}
+
+TEST(CongestionControl, CubicSmoothsRttSamples)
+{
+    Congestion_Control cc;
+    congestion_init(&cc, CONGESTION_CONTROL_CUBIC);
+
+    congestion_on_ack(&cc, 1000, 0, 100);
+    EXPECT_DOUBLE_EQ(cc.state.cubic.srtt, 100.0);
+
+    congestion_on_ack(&cc, 1100, 0, 180);
+    EXPECT_DOUBLE_EQ(cc.state.cubic.srtt, 110.0);
+    EXPECT_EQ(cc.state.cubic.min_rtt, 100);
+}
+
+}  // namespace
@@ -0,0 +1,321 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+// Cost of describing and handling lost packets over a large window of
+// lossless packets in flight, with the old run-length request packets and with
+// selective-ack ranges.
+//
+// Alice queues the window as fast as Bob's socket takes it. One in eight of
+// the packets she sends is lost on the way to Bob, in bursts, so Bob's
+// request packets describe many holes over a large window.
+//
+// BM_RequestPacket drops all of Alice's packets once she has sent as many as
+// the window, so Bob is left with the holes that the retransmissions didn't
+// fill, and measures one request: Bob building it and Alice handling it.
+//
+// BM_BurstLossRecovery lets the retransmissions through and measures the
+// whole recovery.
+//
+// Arguments:
+// - sack: 0 for old request packets only, 1 for selective-ack packets.
+// - window: packets queued before any are acked.
+// - burst: packets lost in a row, followed by 7 times as many that arrive.
+//
+// Reported counters:
+// - requested (BM_RequestPacket): missing packets the request packet names.
+//   A full packet may not have room for all of them.
+// - request_bytes (BM_RequestPacket): size of the request packet.
+// - recovery_ms (BM_BurstLossRecovery): simulated time from queueing the
+//   window to Bob having all of it, in 20 ms one-way delay.
+// - poll_us (BM_BurstLossRecovery): real time of one do_net_crypto round on
+//   both sides while recovering.
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../testing/support/public/simulated_environment.hh"
+#include "DHT_test_util.hh"
+#include "net_crypto.h"
+#include "net_profile.h"
+#include "network.h"
+
+namespace {
+
+using tox::test::SimulatedEnvironment;
+
+constexpr std::uint16_t kAlicePort = 33445;
+constexpr std::uint16_t kBobPort = 33446;
+constexpr std::uint64_t kStepMs = 10;
+constexpr std::uint64_t kDeadlineMs = 120000;
+constexpr std::size_t kLossPeriod = 8;
+// Packets queued per step, well below the receive queue of a simulated socket.
+constexpr std::size_t kQueueChunk = 256;
+
+class Node {
+public:
+    Node(SimulatedEnvironment &env, std::uint16_t port, bool sack)
+        : dht_(env, port)
+        , net_profile_(netprof_new(dht_.logger(), &dht_.node().c_memory),
+              [mem = &dht_.node().c_memory](Net_Profile *p) { netprof_kill(mem, p); })
+        , net_crypto_(nullptr, [](Net_Crypto *c) { kill_net_crypto(c); })
+    {
+        TCP_Proxy_Info proxy_info = {{0}, TCP_PROXY_NONE};
+        net_crypto_.reset(new_net_crypto(dht_.logger(), &dht_.node().c_memory,
+            &dht_.node().c_random, &dht_.node().c_network, dht_.mono_time(), dht_.networking(),
+            dht_.get_dht(), &WrappedMockDHT::funcs, &proxy_info, net_profile_.get(),
+            CRYPTO_HANDSHAKE_MODE_NOISE_BOTH));
+
+        if (net_crypto_ != nullptr) {
+            net_crypto_set_sack(net_crypto_.get(), sack);
+            new_connection_handler(net_crypto_.get(), &Node::accept_cb, this);
+        }
+    }
+
+    bool ok() const { return net_profile_ != nullptr && net_crypto_ != nullptr; }
+    Net_Crypto *_Nonnull net_crypto() { return net_crypto_.get(); }
+
+    bool connect_to(Node &other)
+    {
+        conn_id_ = new_crypto_connection(
+            net_crypto_.get(), nc_get_self_public_key(other.net_crypto()), other.dht_.dht_public_key());
+        if (conn_id_ == -1) {
+            return false;
+        }
+
+        IP_Port addr = other.dht_.get_ip_port();
+        set_direct_ip_port(net_crypto_.get(), conn_id_, &addr, true);
+        set_callbacks();
+        return true;
+    }
+
+    void poll()
+    {
+        dht_.poll();
+        do_net_crypto(net_crypto_.get(), nullptr);
+    }
+
+    int conn_id() const { return conn_id_; }
+    bool connected() const { return connected_; }
+    std::size_t received() const { return received_; }
+
+private:
+    void set_callbacks()
+    {
+        connection_status_handler(net_crypto_.get(), conn_id_, &Node::status_cb, this, 0);
+        connection_data_handler(net_crypto_.get(), conn_id_, &Node::data_cb, this, 0);
+    }
+
+    static int accept_cb(void *_Nonnull object, const New_Connection *_Nonnull n_c)
+    {
+        auto *self = static_cast<Node *>(object);
+        self->conn_id_ = accept_crypto_connection(self->net_crypto_.get(), n_c);
+        if (self->conn_id_ != -1) {
+            self->set_callbacks();
+        }
+        return self->conn_id_;
+    }
+
+    static int status_cb(void *_Nonnull object, int id, bool status, void *_Nullable userdata)
+    {
+        static_cast<Node *>(object)->connected_ = status;
+        return 0;
+    }
+
+    static int data_cb(void *_Nonnull object, int id, const std::uint8_t *_Nonnull data,
+        std::uint16_t length, void *_Nullable userdata)
+    {
+        ++static_cast<Node *>(object)->received_;
+        return 0;
+    }
+
+    WrappedMockDHT dht_;
+    std::unique_ptr<Net_Profile, std::function<void(Net_Profile *)>> net_profile_;
+    std::unique_ptr<Net_Crypto, void (*)(Net_Crypto *)> net_crypto_;
+    int conn_id_ = -1;
+    bool connected_ = false;
+    std::size_t received_ = 0;
+};
+
+bool connect(SimulatedEnvironment &env, Node &alice, Node &bob)
+{
+    if (!alice.ok() || !bob.ok() || !alice.connect_to(bob)) {
+        return false;
+    }
+
+    const std::uint64_t start = env.clock().current_time_ms();
+    while (!(alice.connected() && bob.connected()) && env.clock().current_time_ms() - start < 5000) {
+        alice.poll();
+        bob.poll();
+        env.advance_time(kStepMs);
+    }
+
+    return alice.connected() && bob.connected();
+}
+
+/** @brief Drop bursts of Alice's next `window` data packets, and all after if `drop_rest`. */
+void add_burst_filter(SimulatedEnvironment &env, std::size_t &data_packets, std::size_t window,
+    std::size_t burst, bool drop_rest)
+{
+    const std::size_t spacing = burst * kLossPeriod;
+    env.simulation().net().add_filter([&env, &data_packets, window, burst, spacing, drop_rest](
+                                          tox::test::Packet &p) {
+        if (p.data.empty() || p.data[0] != NET_PACKET_CRYPTO_DATA) {
+            return true;
+        }
+        p.delivery_time = env.clock().current_time_ms() + 20;
+        if (net_ntohs(p.to.port) != kBobPort) {
+            return true;
+        }
+        const std::size_t i = data_packets++;
+        return i < window ? i % spacing >= burst : !drop_rest;
+    });
+}
+
+bool queue_window(SimulatedEnvironment &env, Node &alice, Node &bob, std::size_t window)
+{
+    const std::uint8_t data[] = {160, 0, 0, 0};
+    for (std::size_t i = 0; i < window; ++i) {
+        if (write_cryptpacket(alice.net_crypto(), alice.conn_id(), data, sizeof(data), false) == -1) {
+            return false;
+        }
+
+        if ((i + 1) % kQueueChunk == 0) {
+            alice.poll();
+            bob.poll();
+            env.advance_time(kStepMs);
+        }
+    }
+    return true;
+}
+
+void BM_RequestPacket(benchmark::State &state)
+{
+    const bool sack = state.range(0) != 0;
+    const auto window = static_cast<std::size_t>(state.range(1));
+    const auto burst = static_cast<std::size_t>(state.range(2));
+
+    SimulatedEnvironment env{12345};
+    // Declared before the nodes, which still send packets when killed.
+    std::size_t data_packets = 0;
+    Node alice(env, kAlicePort, true);
+    Node bob(env, kBobPort, true);
+
+    if (!connect(env, alice, bob)) {
+        state.SkipWithError("failed to connect");
+        return;
+    }
+
+    add_burst_filter(env, data_packets, window, burst, true);
+
+    if (!queue_window(env, alice, bob, window)) {
+        state.SkipWithError("failed to queue the window");
+        return;
+    }
+
+    // Let the last packets and requests arrive.
+    for (int i = 0; i < 100; ++i) {
+        alice.poll();
+        bob.poll();
+        env.advance_time(kStepMs);
+    }
+
+    std::vector<std::uint8_t> packet(MAX_CRYPTO_DATA_SIZE);
+    int len = 0;
+    int requested = 0;
+
+    for (auto _ : state) {
+        len = nc_testonly_generate_request_packet(
+            bob.net_crypto(), bob.conn_id(), sack, packet.data(), packet.size());
+        requested = len == -1
+            ? -1
+            : nc_testonly_handle_request_packet(alice.net_crypto(), alice.conn_id(), packet.data(), len);
+        if (requested == -1) {
+            state.SkipWithError("failed to build or handle the request packet");
+            return;
+        }
+    }
+
+    state.counters["requested"] = requested;
+    state.counters["request_bytes"] = len;
+}
+
+void BM_BurstLossRecovery(benchmark::State &state)
+{
+    const bool sack = state.range(0) != 0;
+    const auto window = static_cast<std::size_t>(state.range(1));
+    const auto burst = static_cast<std::size_t>(state.range(2));
+
+    double recovery_ms = 0;
+    double poll_us = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        SimulatedEnvironment env{12345};
+        // Declared before the nodes, which still send packets when killed.
+        std::size_t data_packets = 0;
+        Node alice(env, kAlicePort, sack);
+        Node bob(env, kBobPort, sack);
+
+        if (!connect(env, alice, bob)) {
+            state.SkipWithError("failed to connect");
+            return;
+        }
+
+        add_burst_filter(env, data_packets, window, burst, false);
+
+        const std::uint64_t start = env.clock().current_time_ms();
+
+        if (!queue_window(env, alice, bob, window)) {
+            state.SkipWithError("failed to queue the window");
+            return;
+        }
+
+        std::chrono::steady_clock::duration polling{};
+        std::size_t polls = 0;
+        state.ResumeTiming();
+
+        while (bob.received() < window && env.clock().current_time_ms() - start < kDeadlineMs) {
+            const auto poll_start = std::chrono::steady_clock::now();
+            alice.poll();
+            bob.poll();
+            polling += std::chrono::steady_clock::now() - poll_start;
+            ++polls;
+            env.advance_time(kStepMs);
+        }
+
+        state.PauseTiming();
+        if (bob.received() < window) {
+            state.SkipWithError("the window was not delivered in time");
+            return;
+        }
+
+        recovery_ms = static_cast<double>(env.clock().current_time_ms() - start);
+        poll_us = std::chrono::duration<double, std::micro>(polling).count() / static_cast<double>(polls);
+        state.ResumeTiming();
+    }
+
+    state.counters["recovery_ms"] = recovery_ms;
+    state.counters["poll_us"] = poll_us;
+}
+
+BENCHMARK(BM_RequestPacket)
+    ->ArgNames({"sack", "window", "burst"})
+    ->ArgsProduct({{0, 1}, {4096, 16384}, {1, 64}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_BurstLossRecovery)
+    ->ArgNames({"sack", "window", "burst"})
+    ->ArgsProduct({{0, 1}, {4096, 16384}, {1, 64}})
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
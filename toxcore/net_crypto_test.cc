@@ -132,6 +132,13 @@ public:
         return connections_[conn_id].received_data;
     }
 
+    const std::vector<std::vector<std::uint8_t>> &get_received_history(int conn_id) const
+    {
+        if (conn_id < 0 || conn_id >= static_cast<int>(connections_.size()))
+            return empty_history_;
+        return connections_[conn_id].received_history;
+    }
+
     // Helper to get the ID assigned to a peer by Public Key (for the acceptor side)
     int get_connection_id_by_pk(const std::uint8_t *pk) { return last_accepted_id_; }
 
@@ -148,12 +155,14 @@ private:
     struct ConnectionState {
         bool connected = false;
         std::vector<std::uint8_t> received_data;
+        std::vector<std::vector<std::uint8_t>> received_history;
     };
 
     // We map connection IDs to state. connection IDs are small ints.
     std::vector<ConnectionState> connections_{128};
     int last_accepted_id_ = -1;
     std::vector<std::uint8_t> empty_vector_;
+    std::vector<std::vector<std::uint8_t>> empty_history_;
 
     void setup_connection_callbacks(int id)
     {
@@ -195,6 +204,7 @@ private:
         auto *self = static_cast<TestNode *>(object);
         if (id < static_cast<int>(self->connections_.size())) {
             self->connections_[id].received_data.assign(data, data + length);
+            self->connections_[id].received_history.emplace_back(data, data + length);
         }
         return 0;
     }
@@ -267,6 +277,54 @@ TEST_F(NetCryptoTest, EndToEndDataExchange)
     EXPECT_TRUE(data_received) << "Bob did not receive the correct data";
 }
 
+TEST_F(NetCryptoTest, RttIsZeroUntilMeasured)
+{
+    NetCryptoNode alice(env, 33445);
+    NetCryptoNode bob(env, 33446);
+
+    // 30 ms one-way delay for everything.
+    env.simulation().net().add_filter([&](tox::test::Packet &p) {
+        p.delivery_time = env.clock().current_time_ms() + 30;
+        return true;
+    });
+
+    int alice_conn_id = alice.connect_to(bob);
+    ASSERT_NE(alice_conn_id, -1);
+    EXPECT_EQ(crypto_connection_rtt(alice.get_net_crypto(), alice_conn_id), 0);
+
+    Crypto_Connection_Stats stats;
+    ASSERT_TRUE(crypto_connection_stats(alice.get_net_crypto(), alice_conn_id, &stats));
+    EXPECT_EQ(stats.rtt, 0);
+
+    auto start = env.clock().current_time_ms();
+
+    while ((env.clock().current_time_ms() - start) < 5000 && !alice.is_connected(alice_conn_id)) {
+        alice.poll();
+        bob.poll();
+        env.advance_time(10);
+    }
+    ASSERT_TRUE(alice.is_connected(alice_conn_id));
+
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(alice.send_data(alice_conn_id, {160, static_cast<std::uint8_t>(i)}));
+    }
+
+    start = env.clock().current_time_ms();
+
+    while ((env.clock().current_time_ms() - start) < 2000) {
+        alice.poll();
+        bob.poll();
+        env.advance_time(10);
+    }
+
+    const std::uint32_t rtt = crypto_connection_rtt(alice.get_net_crypto(), alice_conn_id);
+    EXPECT_GE(rtt, 60);
+    EXPECT_LT(rtt, DEFAULT_PING_CONNECTION);
+
+    ASSERT_TRUE(crypto_connection_stats(alice.get_net_crypto(), alice_conn_id, &stats));
+    EXPECT_EQ(stats.rtt, rtt);
+}
+
 TEST_F(NetCryptoTest, ConnectionTimeout)
 {
     NetCryptoNode alice(env, 33445);
@@ -371,6 +429,259 @@ TEST_F(NetCryptoTest, DataLossAndRetransmission)
     EXPECT_TRUE(data_received) << "Bob failed to receive data after retransmission";
 }
 
+TEST_F(NetCryptoTest, ManyPacketsInFlightAreDeliveredInOrder)
+{
+    NetCryptoNode alice(env, 33445);
+    NetCryptoNode bob(env, 33446);
+
+    int alice_conn_id = alice.connect_to(bob);
+    ASSERT_NE(alice_conn_id, -1);
+
+    auto start = env.clock().current_time_ms();
+    int bob_conn_id = -1;
+    bool connected = false;
+
+    while ((env.clock().current_time_ms() - start) < 5000) {
+        alice.poll();
+        bob.poll();
+        env.advance_time(10);
+
+        bob_conn_id = bob.get_connection_id_by_pk(alice.real_public_key());
+        if (alice.is_connected(alice_conn_id) && bob_conn_id != -1
+            && bob.is_connected(bob_conn_id)) {
+            connected = true;
+            break;
+        }
+    }
+    ASSERT_TRUE(connected);
+
+    // Drop the first data packet, so Bob holds all the others until it is
+    // retransmitted. That's many more than the initial window size on both
+    // sides.
+    bool dropped = false;
+    env.simulation().net().add_filter([&](tox::test::Packet &p) {
+        if (!dropped && net_ntohs(p.to.port) == 33446 && p.data.size() > 0
+            && p.data[0] == NET_PACKET_CRYPTO_DATA) {
+            dropped = true;
+            return false;
+        }
+        return true;
+    });
+
+    constexpr int kPackets = 300;
+    std::vector<std::vector<std::uint8_t>> sent;
+
+    for (int i = 0; i < kPackets; ++i) {
+        sent.push_back({160, static_cast<std::uint8_t>(i >> 8), static_cast<std::uint8_t>(i)});
+        ASSERT_TRUE(alice.send_data(alice_conn_id, sent.back())) << i;
+    }
+
+    start = env.clock().current_time_ms();
+
+    while ((env.clock().current_time_ms() - start) < 10000
+        && bob.get_received_history(bob_conn_id).size() < sent.size()) {
+        alice.poll();
+        bob.poll();
+        env.advance_time(50);
+    }
+
+    EXPECT_TRUE(dropped);
+    EXPECT_EQ(bob.get_received_history(bob_conn_id), sent);
+}
+
+TEST_F(NetCryptoTest, CubicCongestionControlDeliversDataUnderLoss)
+{
+    NetCryptoNode alice(env, 33445);
+    NetCryptoNode bob(env, 33446);
+    net_crypto_set_congestion_control(alice.get_net_crypto(), CONGESTION_CONTROL_CUBIC);
+
+    int alice_conn_id = alice.connect_to(bob);
+    ASSERT_NE(alice_conn_id, -1);
+
+    auto start = env.clock().current_time_ms();
+    int bob_conn_id = -1;
+    bool connected = false;
+
+    while ((env.clock().current_time_ms() - start) < 5000) {
+        alice.poll();
+        bob.poll();
+        env.advance_time(10);
+
+        bob_conn_id = bob.get_connection_id_by_pk(alice.real_public_key());
+        if (alice.is_connected(alice_conn_id) && bob_conn_id != -1
+            && bob.is_connected(bob_conn_id)) {
+            connected = true;
+            break;
+        }
+    }
+    ASSERT_TRUE(connected);
+
+    // Drop every 50th data packet in both directions, and delay all of them.
+    int data_packets = 0;
+    env.simulation().net().add_filter([&](tox::test::Packet &p) {
+        if (p.data.empty() || p.data[0] != NET_PACKET_CRYPTO_DATA) {
+            return true;
+        }
+        p.delivery_time = env.clock().current_time_ms() + 20;
+        return ++data_packets % 50 != 0;
+    });
+
+    constexpr int kPackets = 1000;
+    std::vector<std::vector<std::uint8_t>> sent;
+    start = env.clock().current_time_ms();
+
+    while ((env.clock().current_time_ms() - start) < 60000
+        && bob.get_received_history(bob_conn_id).size() < kPackets) {
+        while (sent.size() < kPackets
+            && crypto_num_free_sendqueue_slots(alice.get_net_crypto(), alice_conn_id) > 0) {
+            const int i = static_cast<int>(sent.size());
+            const std::vector<std::uint8_t> data{
+                160, static_cast<std::uint8_t>(i >> 8), static_cast<std::uint8_t>(i)};
+
+            if (write_cryptpacket(alice.get_net_crypto(), alice_conn_id, data.data(), data.size(), true)
+                == -1) {
+                break;
+            }
+
+            sent.push_back(data);
+        }
+
+        alice.poll();
+        bob.poll();
+        env.advance_time(5);
+    }
+
+    EXPECT_GT(data_packets, kPackets);
+    EXPECT_EQ(bob.get_received_history(bob_conn_id), sent);
+}
+
+TEST_F(NetCryptoTest, SelectiveAckRecoversBurstLoss)
+{
+    NetCryptoNode alice(env, 33445);
+    NetCryptoNode bob(env, 33446);
+
+    int alice_conn_id = alice.connect_to(bob);
+    ASSERT_NE(alice_conn_id, -1);
+
+    auto start = env.clock().current_time_ms();
+    int bob_conn_id = -1;
+    bool connected = false;
+
+    while ((env.clock().current_time_ms() - start) < 5000) {
+        alice.poll();
+        bob.poll();
+        env.advance_time(10);
+
+        bob_conn_id = bob.get_connection_id_by_pk(alice.real_public_key());
+        if (alice.is_connected(alice_conn_id) && bob_conn_id != -1
+            && bob.is_connected(bob_conn_id)) {
+            connected = true;
+            break;
+        }
+    }
+    ASSERT_TRUE(connected);
+
+    // Drop two bursts of data packets from Alice, so Bob's window has
+    // several long holes to describe.
+    int data_packets = 0;
+    env.simulation().net().add_filter([&](tox::test::Packet &p) {
+        if (net_ntohs(p.to.port) != 33446 || p.data.empty() || p.data[0] != NET_PACKET_CRYPTO_DATA) {
+            return true;
+        }
+        ++data_packets;
+        return !(data_packets >= 10 && data_packets < 60) && !(data_packets >= 150 && data_packets < 170);
+    });
+
+    constexpr int kPackets = 300;
+    std::vector<std::vector<std::uint8_t>> sent;
+
+    for (int i = 0; i < kPackets; ++i) {
+        sent.push_back({160, static_cast<std::uint8_t>(i >> 8), static_cast<std::uint8_t>(i)});
+        ASSERT_TRUE(alice.send_data(alice_conn_id, sent.back())) << i;
+    }
+
+    start = env.clock().current_time_ms();
+
+    while ((env.clock().current_time_ms() - start) < 10000
+        && bob.get_received_history(bob_conn_id).size() < sent.size()) {
+        alice.poll();
+        bob.poll();
+        env.advance_time(50);
+    }
+
+    EXPECT_GE(data_packets, 170);
+    EXPECT_EQ(bob.get_received_history(bob_conn_id), sent);
+    EXPECT_TRUE(nc_testonly_get_sack_enabled(alice.get_net_crypto(), alice_conn_id));
+    EXPECT_TRUE(nc_testonly_get_sack_enabled(bob.get_net_crypto(), bob_conn_id));
+}
+
+TEST_F(NetCryptoTest, SelectiveAckFallsBackToRequestPackets)
+{
+    NetCryptoNode alice(env, 33445);
+    NetCryptoNode bob(env, 33446);
+    // Bob behaves like a peer that doesn't know selective-ack packets.
+    net_crypto_set_sack(bob.get_net_crypto(), false);
+
+    int alice_conn_id = alice.connect_to(bob);
+    ASSERT_NE(alice_conn_id, -1);
+
+    auto start = env.clock().current_time_ms();
+    int bob_conn_id = -1;
+    bool connected = false;
+
+    while ((env.clock().current_time_ms() - start) < 5000) {
+        alice.poll();
+        bob.poll();
+        env.advance_time(10);
+
+        bob_conn_id = bob.get_connection_id_by_pk(alice.real_public_key());
+        if (alice.is_connected(alice_conn_id) && bob_conn_id != -1
+            && bob.is_connected(bob_conn_id)) {
+            connected = true;
+            break;
+        }
+    }
+    ASSERT_TRUE(connected);
+
+    // Drop a burst in each direction.
+    int alice_packets = 0;
+    int bob_packets = 0;
+    env.simulation().net().add_filter([&](tox::test::Packet &p) {
+        if (p.data.empty() || p.data[0] != NET_PACKET_CRYPTO_DATA) {
+            return true;
+        }
+        int &count = net_ntohs(p.to.port) == 33446 ? alice_packets : bob_packets;
+        ++count;
+        return count < 5 || count >= 25;
+    });
+
+    constexpr int kPackets = 100;
+    std::vector<std::vector<std::uint8_t>> alice_sent;
+    std::vector<std::vector<std::uint8_t>> bob_sent;
+
+    for (int i = 0; i < kPackets; ++i) {
+        alice_sent.push_back({160, 0, static_cast<std::uint8_t>(i)});
+        bob_sent.push_back({160, 1, static_cast<std::uint8_t>(i)});
+        ASSERT_TRUE(alice.send_data(alice_conn_id, alice_sent.back())) << i;
+        ASSERT_TRUE(bob.send_data(bob_conn_id, bob_sent.back())) << i;
+    }
+
+    start = env.clock().current_time_ms();
+
+    while ((env.clock().current_time_ms() - start) < 20000
+        && (bob.get_received_history(bob_conn_id).size() < alice_sent.size()
+            || alice.get_received_history(alice_conn_id).size() < bob_sent.size())) {
+        alice.poll();
+        bob.poll();
+        env.advance_time(50);
+    }
+
+    EXPECT_EQ(bob.get_received_history(bob_conn_id), alice_sent);
+    EXPECT_EQ(alice.get_received_history(alice_conn_id), bob_sent);
+    EXPECT_FALSE(nc_testonly_get_sack_enabled(alice.get_net_crypto(), alice_conn_id));
+    EXPECT_FALSE(nc_testonly_get_sack_enabled(bob.get_net_crypto(), bob_conn_id));
+}
+
 TEST_F(NetCryptoTest, CookieRequestCPUExhaustion)
 {
     NetCryptoNode victim(env, 33445);
@@ -18,6 +18,7 @@
 #include "attributes.h"
 #include "bin_pack.h"
 #include "ccompat.h"
+#include "iterate_profile.h"
 #include "logger.h"
 #include "mem.h"
 #include "net.h"
@@ -110,6 +111,11 @@ bool set_socket_reuseaddr(const Network *ns, Socket sock)
     return net_set_socket_reuseaddr(ns, sock);
 }
 
+bool set_socket_reuseport(const Network *ns, Socket sock)
+{
+    return net_set_socket_reuseport(ns, sock);
+}
+
 bool set_socket_dualstack(const Network *ns, Socket sock)
 {
     return net_set_socket_dualstack(ns, sock);
@@ -127,11 +133,14 @@ struct Networking_Core {
     const Network *_Nonnull ns;
 
     Family family;
+    /* The address and port we are bound to, network byte order port. */
+    IP ip;
     uint16_t port;
     /* Our UDP socket. */
     Socket sock;
 
     Net_Profile *_Nullable udp_net_profile;
+    Iterate_Profile *_Nullable iter_profile;
 };
 
 Family net_family(const Networking_Core *net)
@@ -144,6 +153,11 @@ uint16_t net_port(const Networking_Core *net)
     return net->port;
 }
 
+Socket net_sock(const Networking_Core *net)
+{
+    return net->sock;
+}
+
 /* Basic network functions:
  */
 
@@ -253,6 +267,39 @@ void networking_registerhandler(Networking_Core *net, uint8_t byte, packet_handl
     net->packethandlers[byte].object = object;
 }
 
+int networking_recv(const Networking_Core *net, Socket sock, IP_Port *ip_port, uint8_t *data, uint32_t *length)
+{
+    return receivepacket(net->ns, net->log, sock, ip_port, data, length);
+}
+
+void networking_handle_packet(const Networking_Core *net, const IP_Port *source, const uint8_t *data, uint16_t length,
+                              void *userdata)
+{
+    if (length < 1) {
+        return;
+    }
+
+    netprof_record_packet(net->udp_net_profile, data[0], length, PACKET_DIRECTION_RECV);
+
+    const Packet_Handler *const handler = &net->packethandlers[data[0]];
+
+    if (handler->function == nullptr) {
+        // TODO(https://github.com/TokTok/c-toxcore/issues/1115): Make this
+        // a warning or error again.
+        LOGGER_DEBUG(net->log, "[%02u] -- Packet has no handler", data[0]);
+        return;
+    }
+
+    if (net->iter_profile == nullptr) {
+        handler->function(handler->object, source, data, length, userdata);
+        return;
+    }
+
+    const uint64_t start = iterprof_now(net->iter_profile);
+    handler->function(handler->object, source, data, length, userdata);
+    iterprof_record_packet(net->iter_profile, data[0], start);
+}
+
 void networking_poll(const Networking_Core *net, void *userdata)
 {
     if (net_family_is_unspec(net->family)) {
@@ -265,22 +312,7 @@ void networking_poll(const Networking_Core *net, void *userdata)
     uint32_t length;
 
     while (receivepacket(net->ns, net->log, net->sock, &ip_port, data, &length) != -1) {
-        if (length < 1) {
-            continue;
-        }
-
-        netprof_record_packet(net->udp_net_profile, data[0], length, PACKET_DIRECTION_RECV);
-
-        const Packet_Handler *const handler = &net->packethandlers[data[0]];
-
-        if (handler->function == nullptr) {
-            // TODO(https://github.com/TokTok/c-toxcore/issues/1115): Make this
-            // a warning or error again.
-            LOGGER_DEBUG(net->log, "[%02u] -- Packet has no handler", data[0]);
-            continue;
-        }
-
-        handler->function(handler->object, &ip_port, data, length, userdata);
+        networking_handle_packet(net, &ip_port, data, (uint16_t)length, userdata);
     }
 }
 
@@ -294,9 +326,9 @@ void networking_poll(const Networking_Core *net, void *userdata)
  *
  * If error is non NULL it is set to 0 if no issues, 1 if socket related error, 2 if other.
  */
-Networking_Core *new_networking_ex(
-    const Logger *log, const Memory *mem, const Network *ns, const IP *ip,
-    uint16_t port_from, uint16_t port_to, unsigned int *error)
+static Networking_Core *_Nullable new_networking_impl(
+    const Logger *_Nonnull log, const Memory *_Nonnull mem, const Network *_Nonnull ns, const IP *_Nonnull ip,
+    uint16_t port_from, uint16_t port_to, bool reuse_port, unsigned int *_Nullable error)
 {
     /* If both from and to are 0, use default port range
      * If one is 0 and the other is non-0, use the non-0 value as only port
@@ -397,6 +429,17 @@ Networking_Core *new_networking_ex(
         return nullptr;
     }
 
+    if (reuse_port && !set_socket_reuseport(ns, temp->sock)) {
+        LOGGER_ERROR(log, "failed to set SO_REUSEPORT");
+        kill_networking(temp);
+
+        if (error != nullptr) {
+            *error = 1;
+        }
+
+        return nullptr;
+    }
+
     /* Bind our socket to port PORT and the given IP address (usually 0.0.0.0 or ::) */
     uint16_t *portptr = nullptr;
     IP_Port addr;
@@ -454,6 +497,7 @@ Networking_Core *new_networking_ex(
         const int res = ns_bind(ns, temp->sock, &addr);
 
         if (res == 0) {
+            temp->ip = addr.ip;
             temp->port = *portptr;
 
             Ip_Ntoa ip_str;
@@ -497,6 +541,62 @@ Networking_Core *new_networking_ex(
     return nullptr;
 }
 
+Networking_Core *new_networking_ex(
+    const Logger *log, const Memory *mem, const Network *ns, const IP *ip,
+    uint16_t port_from, uint16_t port_to, unsigned int *error)
+{
+    return new_networking_impl(log, mem, ns, ip, port_from, port_to, false, error);
+}
+
+Networking_Core *new_networking_reuseport(
+    const Logger *log, const Memory *mem, const Network *ns, const IP *ip,
+    uint16_t port_from, uint16_t port_to, unsigned int *error)
+{
+    return new_networking_impl(log, mem, ns, ip, port_from, port_to, true, error);
+}
+
+Socket networking_open_reuseport_socket(const Networking_Core *net)
+{
+    if (net_family_is_unspec(net->family)) {
+        return net_invalid_socket();
+    }
+
+    const Socket sock = net_socket(net->ns, net->family, TOX_SOCK_DGRAM, TOX_PROTO_UDP);
+
+    if (!sock_valid(sock)) {
+        return net_invalid_socket();
+    }
+
+    if (!net_set_socket_buffer_size(net->ns, sock, 1024 * 1024 * 2)) {
+        LOGGER_WARNING(net->log, "failed to set socket buffer size");
+    }
+
+    bool ok = set_socket_nosigpipe(net->ns, sock)
+              && set_socket_nonblock(net->ns, sock)
+              && set_socket_reuseport(net->ns, sock);
+
+    if (ok && net_family_is_ipv6(net->family) && !set_socket_dualstack(net->ns, sock)) {
+        LOGGER_ERROR(net->log, "Dual-stack socket failed to enable, won't be able to receive from IPv4 addresses");
+    }
+
+    if (ok) {
+        IP_Port addr;
+        addr.ip = net->ip;
+        addr.port = net->port;
+        ok = ns_bind(net->ns, sock, &addr) == 0;
+    }
+
+    if (!ok) {
+        const int neterror = net_error();
+        Net_Strerror error_str;
+        LOGGER_ERROR(net->log, "failed to open a reuseport socket: %d, %s", neterror, net_strerror(neterror, &error_str));
+        kill_sock(net->ns, sock);
+        return net_invalid_socket();
+    }
+
+    return sock;
+}
+
 Networking_Core *new_networking_no_udp(const Logger *log, const Memory *mem, const Network *ns)
 {
     /* this is the easiest way to completely disable UDP without changing too much code. */
@@ -775,13 +875,9 @@ static bool bin_pack_ip_port_handler(const void *_Nonnull obj, const Logger *_No
 
 int pack_ip_port(const Logger *logger, uint8_t *data, uint16_t length, const IP_Port *ip_port)
 {
-    const uint32_t size = bin_pack_obj_size(bin_pack_ip_port_handler, ip_port, logger);
+    const uint32_t size = bin_pack_obj_written(bin_pack_ip_port_handler, ip_port, logger, data, length);
 
-    if (size > length) {
-        return -1;
-    }
-
-    if (!bin_pack_obj(bin_pack_ip_port_handler, ip_port, logger, data, length)) {
+    if (size == UINT32_MAX) {
         return -1;
     }
 
@@ -1173,3 +1269,8 @@ const Net_Profile *net_get_net_profile(const Networking_Core *net)
 
     return net->udp_net_profile;
 }
+
+void networking_set_iterate_profile(Networking_Core *net, Iterate_Profile *profile)
+{
+    net->iter_profile = profile;
+}
@@ -15,6 +15,7 @@
 
 #include "attributes.h"
 #include "bin_pack.h"
+#include "iterate_profile.h"
 #include "logger.h"
 #include "mem.h"
 #include "net.h"
@@ -258,6 +259,8 @@ typedef struct Networking_Core Networking_Core;
 
 Family net_family(const Networking_Core *_Nonnull net);
 uint16_t net_port(const Networking_Core *_Nonnull net);
+/** @brief The UDP socket of `net`, e.g. to wait for it to become readable. */
+Socket net_sock(const Networking_Core *_Nonnull net);
 
 /** Close the socket. */
 void kill_sock(const Network *_Nonnull ns, Socket sock);
@@ -283,6 +286,14 @@ bool set_socket_nosigpipe(const Network *_Nonnull ns, Socket sock);
  */
 bool set_socket_reuseaddr(const Network *_Nonnull ns, Socket sock);
 
+/**
+ * Enable SO_REUSEPORT on socket, so that several sockets can bind to the same
+ * port and the kernel spreads incoming packets over them.
+ *
+ * @return true on success, false on failure or if the system doesn't support it.
+ */
+bool set_socket_reuseport(const Network *_Nonnull ns, Socket sock);
+
 /**
  * Set socket to dual (IPv4 + IPv6 socket)
  *
@@ -318,6 +329,24 @@ int sendpacket(const Networking_Core *_Nonnull net, const IP_Port *_Nonnull ip_p
 void networking_registerhandler(Networking_Core *_Nonnull net, uint8_t byte, packet_handler_cb *_Nullable cb, void *_Nullable object);
 /** Call this several times a second. */
 void networking_poll(const Networking_Core *_Nonnull net, void *_Nullable userdata);
+
+/** @brief Receive one packet from `sock`, which is `net`'s socket or one
+ * opened with `networking_open_reuseport_socket`.
+ *
+ * `data` must have room for MAX_UDP_PACKET_SIZE bytes.
+ *
+ * @retval 0 if a packet was received.
+ * @retval -1 if there was nothing to receive.
+ */
+int networking_recv(const Networking_Core *_Nonnull net, Socket sock, IP_Port *_Nonnull ip_port, uint8_t *_Nonnull data,
+                    uint32_t *_Nonnull length);
+
+/** @brief Pass a received packet to the handler registered for its first byte.
+ *
+ * `networking_poll` is `networking_recv` followed by this, for each packet.
+ */
+void networking_handle_packet(const Networking_Core *_Nonnull net, const IP_Port *_Nonnull source, const uint8_t *_Nonnull data,
+                              uint16_t length, void *_Nullable userdata);
 typedef enum Net_Err_Connect {
     NET_ERR_CONNECT_OK,
     NET_ERR_CONNECT_INVALID_FAMILY,
@@ -398,6 +427,27 @@ Networking_Core *_Nullable new_networking_ex(
     uint16_t port_from, uint16_t port_to, unsigned int *_Nullable error);
 Networking_Core *_Nullable new_networking_no_udp(const Logger *_Nonnull log, const Memory *_Nonnull mem, const Network *_Nonnull ns);
 
+/** @brief Like `new_networking_ex`, but with SO_REUSEPORT set on the socket.
+ *
+ * Other sockets can then be bound to the same port with
+ * `networking_open_reuseport_socket`. Fails if the system doesn't support
+ * SO_REUSEPORT.
+ */
+Networking_Core *_Nullable new_networking_reuseport(
+    const Logger *_Nonnull log, const Memory *_Nonnull mem, const Network *_Nonnull ns, const IP *_Nonnull ip,
+    uint16_t port_from, uint16_t port_to, unsigned int *_Nullable error);
+
+/** @brief Open another nonblocking UDP socket bound to the address and port of `net`.
+ *
+ * `net` must have been created with `new_networking_reuseport`. Packets sent
+ * to the port are spread over all sockets bound to it, so the new socket must
+ * be read with `networking_recv`. Replies can go out through `net` as usual.
+ * The caller closes the socket with `kill_sock`.
+ *
+ * @return an invalid socket on failure.
+ */
+Socket networking_open_reuseport_socket(const Networking_Core *_Nonnull net);
+
 /** Function to cleanup networking stuff (doesn't do much right now). */
 void kill_networking(Networking_Core *_Nullable net);
 /** @brief Returns a pointer to the network net_profile object associated with `net`.
@@ -406,6 +456,12 @@ void kill_networking(Networking_Core *_Nullable net);
  */
 const Net_Profile *_Nullable net_get_net_profile(const Networking_Core *_Nonnull net);
 
+/** @brief Times every packet handler call in `profile`, or stops timing them if it is null.
+ *
+ * The profile is not owned by `net` and must outlive it or be unset first.
+ */
+void networking_set_iterate_profile(Networking_Core *_Nonnull net, Iterate_Profile *_Nullable profile);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -281,6 +281,19 @@ static int in_entries(const Onion_Announce *_Nonnull onion_a, const uint8_t *_No
     return -1;
 }
 
+uint32_t onion_announce_num_entries(const Onion_Announce *onion_a)
+{
+    uint32_t count = 0;
+
+    for (unsigned int i = 0; i < ONION_ANNOUNCE_MAX_ENTRIES; ++i) {
+        if (!mono_time_is_timeout(onion_a->mono_time, onion_a->entries[i].announce_time, ONION_ANNOUNCE_TIMEOUT)) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
 typedef struct Onion_Announce_Entry_Cmp {
     const Memory *_Nonnull mem;
     const Mono_Time *_Nonnull mono_time;
@@ -136,6 +136,9 @@ Onion_Announce *_Nullable new_onion_announce(const Logger *_Nonnull log, const M
 
 void kill_onion_announce(Onion_Announce *_Nullable onion_a);
 
+/** @brief Number of announce entries that haven't timed out yet. */
+uint32_t onion_announce_num_entries(const Onion_Announce *_Nonnull onion_a);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -18,6 +18,7 @@
 #include "attributes.h"
 #include "ccompat.h"
 #include "crypto_core.h"
+#include "deadlines.h"
 #include "group_announce.h"
 #include "group_onion_announce.h"
 #include "list.h"
@@ -2177,6 +2178,11 @@ void do_onion_client(Onion_Client *onion_c)
     onion_c->last_run = mono_time_get(onion_c->mono_time);
 }
 
+uint64_t onion_client_next_deadline(const Onion_Client *onion_c)
+{
+    return deadline_from_seconds(onion_c->last_run, 1);
+}
+
 Onion_Client *new_onion_client(const Logger *logger, const Memory *mem, const Random *rng, const Mono_Time *mono_time, Net_Crypto *c,
                                DHT *dht, Networking_Core *net)
 {
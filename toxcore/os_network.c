@@ -688,6 +688,16 @@ bool net_set_socket_reuseaddr(const Network *ns, Socket sock)
 #endif /* OS_WIN32 */
 }
 
+bool net_set_socket_reuseport(const Network *ns, Socket sock)
+{
+#ifdef SO_REUSEPORT
+    int set = 1;
+    return ns_setsockopt(ns, sock, SOL_SOCKET, SO_REUSEPORT, &set, sizeof(set)) == 0;
+#else
+    return false;
+#endif /* SO_REUSEPORT */
+}
+
 bool net_set_socket_dualstack(const Network *ns, Socket sock)
 {
     int ipv6only = 0;
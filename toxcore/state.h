@@ -40,6 +40,11 @@ typedef enum State_Type {
     STATE_TYPE_GROUPS        = 7,
     STATE_TYPE_TCP_RELAY     = 10,
     STATE_TYPE_PATH_NODE     = 11,
+    // Journal records, only found after a journal base snapshot.
+    STATE_TYPE_FRIEND_UPDATE = 12,
+    STATE_TYPE_FRIEND_REMOVE = 13,
+    STATE_TYPE_GROUP_UPDATE  = 14,
+    STATE_TYPE_GROUP_REMOVE  = 15,
     STATE_TYPE_CONFERENCES   = 20,
     STATE_TYPE_END           = 255,
 } State_Type;
@@ -22,10 +22,12 @@
 #include "attributes.h"
 #include "ccompat.h"
 #include "crypto_core.h"
+#include "deadlines.h"
 #include "friend_requests.h"
 #include "group.h"
 #include "group_chats.h"
 #include "group_common.h"
+#include "iterate_profile.h"
 #include "logger.h"
 #include "mem.h"
 #include "mono_time.h"
@@ -615,6 +617,15 @@ static State_Load_Status state_load_callback(void *_Nonnull outer, const uint8_t
     return STATE_LOAD_STATUS_CONTINUE;
 }
 
+static State_Load_Status state_check_callback(void *_Nonnull outer, const uint8_t *_Nonnull data, uint32_t length, uint16_t type)
+{
+    if (type == STATE_TYPE_END) {
+        return length == 0 ? STATE_LOAD_STATUS_END : STATE_LOAD_STATUS_ERROR;
+    }
+
+    return STATE_LOAD_STATUS_CONTINUE;
+}
+
 /** Load tox from data of size length. */
 static int tox_load(Tox *_Nonnull tox, const uint8_t *_Nonnull data, uint32_t length)
 {
@@ -632,6 +643,14 @@ static int tox_load(Tox *_Nonnull tox, const uint8_t *_Nonnull data, uint32_t le
         return -1;
     }
 
+    // Check the section framing before loading anything, so truncated or
+    // corrupt savedata is rejected without doing the expensive part.
+    if (tox->m->options.lazy_friend_connections
+            && state_load(tox->m->log, state_check_callback, tox, data + cookie_len,
+                          length - cookie_len, STATE_COOKIE_TYPE) != 0) {
+        return -1;
+    }
+
     return state_load(tox->m->log, state_load_callback, tox, data + cookie_len,
                       length - cookie_len, STATE_COOKIE_TYPE);
 }
@@ -725,6 +744,7 @@ static Tox *_Nullable tox_new_system(const struct Tox_Options *_Nullable options
     m_options.local_discovery_enabled = tox_options_get_local_discovery_enabled(opts);
     m_options.dht_announcements_enabled = tox_options_get_dht_announcements_enabled(opts);
     m_options.groups_persistence_enabled = tox_options_get_experimental_groups_persistence(opts);
+    m_options.lazy_friend_connections = tox_options_get_experimental_lazy_load(opts);
 
     if (m_options.udp_disabled) {
         m_options.local_discovery_enabled = false;
@@ -1226,12 +1246,15 @@ uint32_t tox_iteration_interval(const Tox *_Nonnull tox)
 {
     assert(tox != nullptr);
     tox_lock(tox);
-    uint32_t ret = messenger_run_interval(tox->m);
 
-    if (m_is_receiving_file(tox->m)) {
-        ret = 1;
+    Deadlines deadlines;
+    messenger_deadlines(tox->m, &deadlines);
+
+    if (tox->m->conferences_object != nullptr) {
+        deadlines_set(&deadlines, DEADLINE_SOURCE_CONFERENCES, conferences_next_deadline(tox->m->conferences_object));
     }
 
+    const uint32_t ret = deadlines_interval(&deadlines, mono_time_get_ms(tox->mono_time), messenger_max_run_interval(tox->m));
     tox_unlock(tox);
     return ret;
 }
@@ -1241,11 +1264,18 @@ void tox_iterate_with_options(Tox *_Nonnull tox, const Tox_Iterate_Options *_Nul
     assert(tox != nullptr);
     tox_lock(tox);
 
+    Iterate_Profile *prof = tox->m->iter_profile;
+    const uint64_t start = iterprof_now(prof);
+
     mono_time_update(tox->mono_time);
 
     struct Tox_Userdata tox_data = { tox, user_data };
     do_messenger(tox->m, &tox_data);
+
+    const uint64_t conferences_start = iterprof_now(prof);
     do_groupchats(tox->m->conferences_object, &tox_data);
+    iterprof_record_phase(prof, ITERATE_PHASE_CONFERENCES, conferences_start);
+    iterprof_record_phase(prof, ITERATE_PHASE_ITERATE, start);
 
     tox_unlock(tox);
 }
@@ -668,6 +668,12 @@ void tox_callback_self_connection_status(Tox *tox, tox_self_connection_status_cb
 /**
  * @brief Return the time in milliseconds before `tox_iterate()` should be
  *   called again for optimal performance.
+ *
+ * This is the time until the next timer of the instance is due. Packets are
+ * only read by `tox_iterate()`, so while the instance has its UDP socket or a
+ * TCP relay connection open, this is at most 50 milliseconds. Otherwise it is
+ * at most one second. Calling `tox_iterate()` earlier than necessary is
+ * harmless.
  */
 uint32_t tox_iteration_interval(const Tox *tox);
 
@@ -1670,3 +1670,80 @@ const char *tox_netprof_direction_to_string(Tox_Netprof_Direction value)
 
     return "<invalid Tox_Netprof_Direction>";
 }
+const char *tox_err_file_stream_to_string(Tox_Err_File_Stream value)
+{
+    switch (value) {
+        case TOX_ERR_FILE_STREAM_OK:
+            return "TOX_ERR_FILE_STREAM_OK";
+        case TOX_ERR_FILE_STREAM_FRIEND_NOT_FOUND:
+            return "TOX_ERR_FILE_STREAM_FRIEND_NOT_FOUND";
+        case TOX_ERR_FILE_STREAM_NOT_FOUND:
+            return "TOX_ERR_FILE_STREAM_NOT_FOUND";
+        case TOX_ERR_FILE_STREAM_WRONG_DIRECTION:
+            return "TOX_ERR_FILE_STREAM_WRONG_DIRECTION";
+        case TOX_ERR_FILE_STREAM_BUSY:
+            return "TOX_ERR_FILE_STREAM_BUSY";
+        case TOX_ERR_FILE_STREAM_TOO_SMALL:
+            return "TOX_ERR_FILE_STREAM_TOO_SMALL";
+        case TOX_ERR_FILE_STREAM_MALLOC:
+            return "TOX_ERR_FILE_STREAM_MALLOC";
+    }
+
+    return "<invalid Tox_Err_File_Stream>";
+}
+
+const char *tox_congestion_control_to_string(Tox_Congestion_Control value)
+{
+    switch (value) {
+        case TOX_CONGESTION_CONTROL_LEGACY:
+            return "TOX_CONGESTION_CONTROL_LEGACY";
+        case TOX_CONGESTION_CONTROL_CUBIC:
+            return "TOX_CONGESTION_CONTROL_CUBIC";
+    }
+
+    return "<invalid Tox_Congestion_Control>";
+}
+const char *tox_tcp_relay_selection_to_string(Tox_Tcp_Relay_Selection value)
+{
+    switch (value) {
+        case TOX_TCP_RELAY_SELECTION_FIRST:
+            return "TOX_TCP_RELAY_SELECTION_FIRST";
+        case TOX_TCP_RELAY_SELECTION_FASTEST:
+            return "TOX_TCP_RELAY_SELECTION_FASTEST";
+        case TOX_TCP_RELAY_SELECTION_STRIPED:
+            return "TOX_TCP_RELAY_SELECTION_STRIPED";
+    }
+
+    return "<invalid Tox_Tcp_Relay_Selection>";
+}
+const char *tox_iterate_phase_to_string(Tox_Iterate_Phase value)
+{
+    switch (value) {
+        case TOX_ITERATE_PHASE_ITERATE:
+            return "TOX_ITERATE_PHASE_ITERATE";
+        case TOX_ITERATE_PHASE_NETWORKING_POLL:
+            return "TOX_ITERATE_PHASE_NETWORKING_POLL";
+        case TOX_ITERATE_PHASE_DHT:
+            return "TOX_ITERATE_PHASE_DHT";
+        case TOX_ITERATE_PHASE_TCP_SERVER:
+            return "TOX_ITERATE_PHASE_TCP_SERVER";
+        case TOX_ITERATE_PHASE_NET_CRYPTO:
+            return "TOX_ITERATE_PHASE_NET_CRYPTO";
+        case TOX_ITERATE_PHASE_ONION_CLIENT:
+            return "TOX_ITERATE_PHASE_ONION_CLIENT";
+        case TOX_ITERATE_PHASE_FRIEND_CONNECTIONS:
+            return "TOX_ITERATE_PHASE_FRIEND_CONNECTIONS";
+        case TOX_ITERATE_PHASE_FRIENDS:
+            return "TOX_ITERATE_PHASE_FRIENDS";
+        case TOX_ITERATE_PHASE_GROUP_CHATS:
+            return "TOX_ITERATE_PHASE_GROUP_CHATS";
+        case TOX_ITERATE_PHASE_GROUP_ANNOUNCES:
+            return "TOX_ITERATE_PHASE_GROUP_ANNOUNCES";
+        case TOX_ITERATE_PHASE_GROUP_ONION_FRIENDS:
+            return "TOX_ITERATE_PHASE_GROUP_ONION_FRIENDS";
+        case TOX_ITERATE_PHASE_CONFERENCES:
+            return "TOX_ITERATE_PHASE_CONFERENCES";
+    }
+
+    return "<invalid Tox_Iterate_Phase>";
+}
@@ -10,6 +10,8 @@
 #include "attributes.h"
 #include "ccompat.h"
 #include "events/events_alloc.h" // IWYU pragma: keep
+#include "mpmc_queue.h"
+#include "os_memory.h"
 #include "tox_event.h"
 #include "tox_events.h"
 
@@ -624,3 +626,162 @@ void tox_dispatch_invoke(const Tox_Dispatch *_Nonnull dispatch, const Tox_Events
         tox_dispatch_invoke_event(dispatch, event, user_data);
     }
 }
+
+struct Tox_Event_Queue {
+    Mpmc_Queue *_Nonnull batches;
+    Tox_Event_Queue_Overflow overflow;
+
+    // Only touched by the publishing thread.
+    uint64_t published;
+    uint64_t dropped_batches;
+    uint64_t dropped_events;
+    uint32_t high_water;
+};
+
+Tox_Event_Queue *_Nullable tox_event_queue_new(
+    uint32_t capacity, Tox_Event_Queue_Overflow overflow, Tox_Err_Event_Queue_New *_Nullable error)
+{
+    if (capacity == 0 || capacity > (UINT32_C(1) << 31)) {
+        if (error != nullptr) {
+            *error = TOX_ERR_EVENT_QUEUE_NEW_CAPACITY;
+        }
+
+        return nullptr;
+    }
+
+    Tox_Event_Queue *queue = (Tox_Event_Queue *)calloc(1, sizeof(Tox_Event_Queue));
+
+    if (queue == nullptr) {
+        if (error != nullptr) {
+            *error = TOX_ERR_EVENT_QUEUE_NEW_MALLOC;
+        }
+
+        return nullptr;
+    }
+
+    Mpmc_Queue *batches = mpmc_queue_new(os_memory(), capacity);
+
+    if (batches == nullptr) {
+        free(queue);
+
+        if (error != nullptr) {
+            *error = TOX_ERR_EVENT_QUEUE_NEW_MALLOC;
+        }
+
+        return nullptr;
+    }
+
+    queue->batches = batches;
+    queue->overflow = overflow;
+
+    if (error != nullptr) {
+        *error = TOX_ERR_EVENT_QUEUE_NEW_OK;
+    }
+
+    return queue;
+}
+
+void tox_event_queue_free(Tox_Event_Queue *_Nullable queue)
+{
+    if (queue == nullptr) {
+        return;
+    }
+
+    Tox_Events *events;
+
+    while ((events = tox_event_queue_pop(queue)) != nullptr) {
+        tox_events_free(events);
+    }
+
+    mpmc_queue_free(queue->batches);
+    free(queue);
+}
+
+static void tox_event_queue_drop(Tox_Event_Queue *_Nonnull queue, Tox_Events *_Nonnull events)
+{
+    ++queue->dropped_batches;
+    queue->dropped_events += tox_events_get_size(events);
+    tox_events_free(events);
+}
+
+bool tox_dispatch_publish(Tox_Event_Queue *_Nonnull queue, Tox_Events *_Nonnull events)
+{
+    bool dropped = false;
+
+    while (!mpmc_queue_push(queue->batches, events)) {
+        dropped = true;
+
+        if (queue->overflow == TOX_EVENT_QUEUE_OVERFLOW_DROP_NEWEST) {
+            tox_event_queue_drop(queue, events);
+            return false;
+        }
+
+        // Make room. If a consumer got there first, the pop finds nothing and
+        // the next push succeeds.
+        Tox_Events *oldest = tox_event_queue_pop(queue);
+
+        if (oldest != nullptr) {
+            tox_event_queue_drop(queue, oldest);
+        }
+    }
+
+    ++queue->published;
+
+    const uint32_t size = mpmc_queue_size(queue->batches);
+
+    if (size > queue->high_water) {
+        queue->high_water = size;
+    }
+
+    return !dropped;
+}
+
+Tox_Events *_Nullable tox_event_queue_pop(Tox_Event_Queue *_Nonnull queue)
+{
+    return (Tox_Events *)mpmc_queue_pop(queue->batches);
+}
+
+uint32_t tox_dispatch_drain(const Tox_Dispatch *_Nonnull dispatch, Tox_Event_Queue *_Nonnull queue,
+                            uint32_t max_batches, void *_Nullable user_data)
+{
+    uint32_t count = 0;
+
+    while (max_batches == 0 || count < max_batches) {
+        Tox_Events *events = tox_event_queue_pop(queue);
+
+        if (events == nullptr) {
+            break;
+        }
+
+        tox_dispatch_invoke(dispatch, events, user_data);
+        tox_events_free(events);
+        ++count;
+    }
+
+    return count;
+}
+
+uint32_t tox_event_queue_get_size(const Tox_Event_Queue *_Nonnull queue)
+{
+    return mpmc_queue_size(queue->batches);
+}
+
+uint64_t tox_event_queue_get_published(const Tox_Event_Queue *_Nonnull queue)
+{
+    return queue->published;
+}
+
+uint64_t tox_event_queue_get_dropped_batches(const Tox_Event_Queue *_Nonnull queue)
+{
+    return queue->dropped_batches;
+}
+
+uint64_t tox_event_queue_get_dropped_events(const Tox_Event_Queue *_Nonnull queue)
+{
+    return queue->dropped_events;
+}
+
+uint32_t tox_event_queue_get_high_water(const Tox_Event_Queue *_Nonnull queue)
+{
+    return queue->high_water;
+}
@@ -12,6 +12,9 @@
 #ifndef C_TOXCORE_TOXCORE_TOX_DISPATCH_H
 #define C_TOXCORE_TOXCORE_TOX_DISPATCH_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "tox.h"
 #include "tox_events.h"
 
@@ -58,6 +61,138 @@ void tox_dispatch_free(Tox_Dispatch *dispatch);
  */
 void tox_dispatch_invoke(const Tox_Dispatch *dispatch, const Tox_Events *events, void *user_data);
 
+/**
+ * @brief A bounded queue of event batches.
+ *
+ * It lets the thread that iterates the Tox instance hand events off to one or
+ * more consumer threads, so that slow callbacks don't hold up networking. The
+ * Tox thread publishes each batch returned by @ref tox_events_iterate with
+ * @ref tox_dispatch_publish, and consumer threads run the callbacks with
+ * @ref tox_dispatch_drain.
+ *
+ * Publishing and draining never block and never allocate. Only one thread may
+ * publish to a queue at a time; any number of threads may drain it.
+ */
+typedef struct Tox_Event_Queue Tox_Event_Queue;
+
+/**
+ * @brief What to do when a batch is published to a full queue.
+ */
+typedef enum Tox_Event_Queue_Overflow {
+    /**
+     * Discard the batch being published. Consumers see a gap at the end.
+     */
+    TOX_EVENT_QUEUE_OVERFLOW_DROP_NEWEST,
+
+    /**
+     * Discard the oldest queued batches until the new one fits. Consumers see
+     * the most recent events.
+     */
+    TOX_EVENT_QUEUE_OVERFLOW_DROP_OLDEST,
+} Tox_Event_Queue_Overflow;
+
+typedef enum Tox_Err_Event_Queue_New {
+    /**
+     * The function returned successfully.
+     */
+    TOX_ERR_EVENT_QUEUE_NEW_OK,
+
+    /**
+     * The function failed to allocate memory for the queue.
+     */
+    TOX_ERR_EVENT_QUEUE_NEW_MALLOC,
+
+    /**
+     * The capacity was 0 or larger than 2^31.
+     */
+    TOX_ERR_EVENT_QUEUE_NEW_CAPACITY,
+} Tox_Err_Event_Queue_New;
+
+/**
+ * @brief Creates a new empty event queue.
+ *
+ * @param capacity Maximum number of batches in the queue. Rounded up to a
+ *   power of 2.
+ * @param overflow What to do when the queue is full.
+ */
+Tox_Event_Queue *tox_event_queue_new(
+    uint32_t capacity, Tox_Event_Queue_Overflow overflow, Tox_Err_Event_Queue_New *error);
+
+/**
+ * @brief Deallocate an event queue and any batches still in it.
+ *
+ * No other thread may be using the queue.
+ */
+void tox_event_queue_free(Tox_Event_Queue *queue);
+
+/**
+ * @brief Add a batch of events to the queue.
+ *
+ * The queue takes ownership of the batch, also when it is dropped. Batches
+ * created with @ref tox_events_new and filled by @ref tox_events_iterate_into
+ * are reused by the caller and must not be published.
+ *
+ * @param queue The event queue.
+ * @param events The events object received from @ref tox_events_iterate.
+ *
+ * @retval false if a batch was dropped because the queue was full.
+ */
+bool tox_dispatch_publish(Tox_Event_Queue *queue, Tox_Events *events);
+
+/**
+ * @brief Take the oldest batch out of the queue.
+ *
+ * @return the batch, to be freed with @ref tox_events_free, or NULL if the
+ *   queue is empty.
+ */
+Tox_Events *tox_event_queue_pop(Tox_Event_Queue *queue);
+
+/**
+ * @brief Invoke registered callbacks for queued batches and free them.
+ *
+ * Returns when the queue is empty or after `max_batches` batches, whichever
+ * comes first. Callbacks run on the calling thread.
+ *
+ * @param dispatch The events dispatch table.
+ * @param queue The event queue.
+ * @param max_batches Maximum number of batches to dispatch, or 0 for no limit.
+ * @param user_data User data pointer to pass down to the callbacks.
+ *
+ * @return the number of batches dispatched.
+ */
+uint32_t tox_dispatch_drain(const Tox_Dispatch *dispatch, Tox_Event_Queue *queue,
+                            uint32_t max_batches, void *user_data);
+
+/**
+ * @brief Number of batches currently in the queue.
+ *
+ * Can be called from any thread.
+ */
+uint32_t tox_event_queue_get_size(const Tox_Event_Queue *queue);
+
+/**
+ * @brief Number of batches accepted by @ref tox_dispatch_publish.
+ *
+ * This and the other statistics below belong to the publishing thread, and
+ * must only be read from it.
+ */
+uint64_t tox_event_queue_get_published(const Tox_Event_Queue *queue);
+
+/**
+ * @brief Number of batches discarded because the queue was full.
+ */
+uint64_t tox_event_queue_get_dropped_batches(const Tox_Event_Queue *queue);
+
+/**
+ * @brief Number of events in the discarded batches.
+ */
+uint64_t tox_event_queue_get_dropped_events(const Tox_Event_Queue *queue);
+
+/**
+ * @brief Largest number of batches that were in the queue at once.
+ */
+uint32_t tox_event_queue_get_high_water(const Tox_Event_Queue *queue);
+
 typedef void tox_events_conference_connected_cb(
     const Tox_Event_Conference_Connected *event, void *user_data);
 typedef void tox_events_conference_invite_cb(
@@ -0,0 +1,173 @@
+// clang-format off
+#include "../testing/support/public/simulated_environment.hh"
+#include "tox_dispatch.h"
+// clang-format on
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "tox_events.h"
+
+namespace {
+
+using tox::test::SimulatedEnvironment;
+
+class ToxEventQueueTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        node = env.create_node(33445);
+        dispatch = tox_dispatch_new(nullptr);
+        ASSERT_NE(dispatch, nullptr);
+    }
+
+    void TearDown() override { tox_dispatch_free(dispatch); }
+
+    /** A batch of `count` typing events, one for each of friends 0 to count-1. */
+    Tox_Events *make_batch(std::uint8_t count)
+    {
+        std::vector<std::uint8_t> bytes{static_cast<std::uint8_t>(0x90 | count)};
+        for (std::uint8_t i = 0; i < count; ++i) {
+            bytes.insert(bytes.end(), {0x92, TOX_EVENT_FRIEND_TYPING, 0x92, i, 0xc3});
+        }
+        return tox_events_load(&node->system, bytes.data(), bytes.size());
+    }
+
+    SimulatedEnvironment env{12345};
+    std::unique_ptr<tox::test::ScopedToxSystem> node;
+    Tox_Dispatch *dispatch = nullptr;
+};
+
+void count_typing(const Tox_Event_Friend_Typing *event, void *user_data)
+{
+    ++*static_cast<std::atomic<std::uint32_t> *>(user_data);
+}
+
+TEST_F(ToxEventQueueTest, RejectsZeroCapacity)
+{
+    Tox_Err_Event_Queue_New err;
+    EXPECT_EQ(tox_event_queue_new(0, TOX_EVENT_QUEUE_OVERFLOW_DROP_NEWEST, &err), nullptr);
+    EXPECT_EQ(err, TOX_ERR_EVENT_QUEUE_NEW_CAPACITY);
+}
+
+TEST_F(ToxEventQueueTest, DrainInvokesCallbacks)
+{
+    Tox_Err_Event_Queue_New err;
+    Tox_Event_Queue *queue = tox_event_queue_new(4, TOX_EVENT_QUEUE_OVERFLOW_DROP_NEWEST, &err);
+    ASSERT_NE(queue, nullptr);
+    EXPECT_EQ(err, TOX_ERR_EVENT_QUEUE_NEW_OK);
+    tox_events_callback_friend_typing(dispatch, count_typing);
+
+    EXPECT_TRUE(tox_dispatch_publish(queue, make_batch(2)));
+    EXPECT_TRUE(tox_dispatch_publish(queue, make_batch(3)));
+    EXPECT_TRUE(tox_dispatch_publish(queue, make_batch(1)));
+    EXPECT_EQ(tox_event_queue_get_size(queue), 3);
+
+    std::atomic<std::uint32_t> typing{0};
+    EXPECT_EQ(tox_dispatch_drain(dispatch, queue, 2, &typing), 2);
+    EXPECT_EQ(typing, 5);
+    EXPECT_EQ(tox_dispatch_drain(dispatch, queue, 0, &typing), 1);
+    EXPECT_EQ(typing, 6);
+    EXPECT_EQ(tox_dispatch_drain(dispatch, queue, 0, &typing), 0);
+
+    EXPECT_EQ(tox_event_queue_get_published(queue), 3);
+    EXPECT_EQ(tox_event_queue_get_high_water(queue), 3);
+    EXPECT_EQ(tox_event_queue_get_dropped_batches(queue), 0);
+    tox_event_queue_free(queue);
+}
+
+TEST_F(ToxEventQueueTest, DropNewestKeepsQueuedBatches)
+{
+    Tox_Event_Queue *queue = tox_event_queue_new(2, TOX_EVENT_QUEUE_OVERFLOW_DROP_NEWEST, nullptr);
+    ASSERT_NE(queue, nullptr);
+
+    EXPECT_TRUE(tox_dispatch_publish(queue, make_batch(1)));
+    EXPECT_TRUE(tox_dispatch_publish(queue, make_batch(2)));
+    EXPECT_FALSE(tox_dispatch_publish(queue, make_batch(3)));
+
+    EXPECT_EQ(tox_event_queue_get_published(queue), 2);
+    EXPECT_EQ(tox_event_queue_get_dropped_batches(queue), 1);
+    EXPECT_EQ(tox_event_queue_get_dropped_events(queue), 3);
+    EXPECT_EQ(tox_event_queue_get_high_water(queue), 2);
+
+    Tox_Events *events = tox_event_queue_pop(queue);
+    ASSERT_NE(events, nullptr);
+    EXPECT_EQ(tox_events_get_size(events), 1);
+    tox_events_free(events);
+
+    // The remaining batch is freed with the queue.
+    tox_event_queue_free(queue);
+}
+
+TEST_F(ToxEventQueueTest, DropOldestKeepsNewBatches)
+{
+    Tox_Event_Queue *queue = tox_event_queue_new(2, TOX_EVENT_QUEUE_OVERFLOW_DROP_OLDEST, nullptr);
+    ASSERT_NE(queue, nullptr);
+
+    EXPECT_TRUE(tox_dispatch_publish(queue, make_batch(1)));
+    EXPECT_TRUE(tox_dispatch_publish(queue, make_batch(2)));
+    EXPECT_FALSE(tox_dispatch_publish(queue, make_batch(3)));
+
+    EXPECT_EQ(tox_event_queue_get_published(queue), 3);
+    EXPECT_EQ(tox_event_queue_get_dropped_batches(queue), 1);
+    EXPECT_EQ(tox_event_queue_get_dropped_events(queue), 1);
+
+    for (const std::uint32_t size : {2, 3}) {
+        Tox_Events *events = tox_event_queue_pop(queue);
+        ASSERT_NE(events, nullptr);
+        EXPECT_EQ(tox_events_get_size(events), size);
+        tox_events_free(events);
+    }
+
+    tox_event_queue_free(queue);
+}
+
+TEST_F(ToxEventQueueTest, ConsumerThreadsSeeAllEvents)
+{
+    constexpr int kBatches = 1000;
+    Tox_Event_Queue *queue = tox_event_queue_new(16, TOX_EVENT_QUEUE_OVERFLOW_DROP_NEWEST, nullptr);
+    ASSERT_NE(queue, nullptr);
+    tox_events_callback_friend_typing(dispatch, count_typing);
+
+    // Batches are created up front: the simulated environment is not thread safe.
+    std::vector<Tox_Events *> batches;
+    for (int i = 0; i < kBatches; ++i) {
+        batches.push_back(make_batch(4));
+    }
+
+    std::atomic<std::uint32_t> typing{0};
+    std::atomic<bool> done{false};
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < 3; ++i) {
+        consumers.emplace_back([&] {
+            while (!done || tox_event_queue_get_size(queue) != 0) {
+                if (tox_dispatch_drain(dispatch, queue, 0, &typing) == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (Tox_Events *events : batches) {
+        while (tox_event_queue_get_size(queue) == 16) {
+            std::this_thread::yield();
+        }
+        tox_dispatch_publish(queue, events);
+    }
+    done = true;
+    for (std::thread &consumer : consumers) {
+        consumer.join();
+    }
+
+    EXPECT_EQ(typing + tox_event_queue_get_dropped_events(queue), kBatches * 4);
+    EXPECT_EQ(tox_event_queue_get_published(queue) + tox_event_queue_get_dropped_batches(queue),
+        kBatches);
+    tox_event_queue_free(queue);
+}
+
+}  // namespace
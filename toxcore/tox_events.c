@@ -14,6 +14,7 @@
 #include "events/events_alloc.h"
 #include "logger.h"
 #include "mem.h"
+#include "mem_arena.h"
 #include "tox.h"
 #include "tox_event.h"
 #include "tox_private.h"
@@ -109,6 +110,66 @@ Tox_Events *tox_events_iterate(Tox *tox, const Tox_Iterate_Options *options, Tox
     return state.events;
 }
 
+Tox_Events *tox_events_new(const Tox *tox)
+{
+    const Memory *mem = tox_get_system(tox)->mem;
+    Tox_Events *events = (Tox_Events *)mem_alloc(mem, sizeof(Tox_Events));
+
+    if (events == nullptr) {
+        return nullptr;
+    }
+
+    *events = (Tox_Events) {
+        nullptr
+    };
+    events->mem = mem;
+    events->arena = mem_arena_new(mem);
+
+    if (events->arena == nullptr) {
+        mem_delete(mem, events);
+        return nullptr;
+    }
+
+    return events;
+}
+
+void tox_events_clear(Tox_Events *events)
+{
+    if (events->arena != nullptr) {
+        mem_arena_reset(events->arena);
+    } else {
+        for (uint32_t i = 0; i < events->events_size; ++i) {
+            tox_event_destruct(&events->events[i], events->mem);
+        }
+    }
+
+    // Keep the capacity of the events array for the next batch.
+    events->events_size = 0;
+}
+
+bool tox_events_iterate_into(Tox *tox, const Tox_Iterate_Options *options, Tox_Events *events, Tox_Err_Events_Iterate *error)
+{
+    tox_events_clear(events);
+
+    Tox_Events_State state = {TOX_ERR_EVENTS_ITERATE_OK, tox_events_get_event_memory(events), events};
+
+    tox_iterate_with_options(tox, options, &state);
+
+    if (error != nullptr) {
+        *error = state.error;
+    }
+
+    if (state.error == TOX_ERR_EVENTS_ITERATE_OK) {
+        return true;
+    }
+
+    if (tox_iterate_options_get_fail_hard(options)) {
+        tox_events_clear(events);
+    }
+
+    return false;
+}
+
 static bool tox_event_pack_handler(const void *_Nonnull arr, uint32_t index, const Logger *_Nonnull logger, Bin_Pack *_Nonnull bp)
 {
     const Tox_Event *events = (const Tox_Event *)arr;
@@ -143,13 +204,13 @@ static bool tox_events_unpack_handler(void *_Nonnull obj, Bin_Unpack *_Nonnull b
 
     for (uint32_t i = 0; i < size; ++i) {
         Tox_Event event = {TOX_EVENT_INVALID};
-        if (!tox_event_unpack_into(&event, bu, events->mem)) {
-            tox_event_destruct(&event, events->mem);
+        if (!tox_event_unpack_into(&event, bu, tox_events_get_event_memory(events))) {
+            tox_event_destruct(&event, tox_events_get_event_memory(events));
             return false;
         }
 
         if (!tox_events_add(events, &event)) {
-            tox_event_destruct(&event, events->mem);
+            tox_event_destruct(&event, tox_events_get_event_memory(events));
             return false;
         }
     }
@@ -519,7 +519,8 @@ const Tox_Event_Dht_Nodes_Response *_Nullable tox_event_get_dht_nodes_response(
 /**
  * Container object for all Tox core events.
  *
- * This is an immutable object once created.
+ * This is an immutable object once created, except for objects that are
+ * refilled with `tox_events_iterate_into`.
  */
 typedef struct Tox_Events Tox_Events;
 
@@ -575,6 +576,53 @@ Tox_Events *_Nullable tox_events_iterate(
     const Tox_Iterate_Options *_Nullable options,
     Tox_Err_Events_Iterate *_Nullable error);
 
+/**
+ * Create an empty events object for use with `tox_events_iterate_into`.
+ *
+ * Unlike the objects returned by `tox_events_iterate`, this one is meant to be
+ * kept and refilled on every iteration. The events and their data (message
+ * text, file chunks, packets, etc.) are allocated from an arena that is reset
+ * in constant time before each iteration. Once the object has grown to fit the
+ * client's event rate, iterating no longer allocates memory.
+ *
+ * The result must be freed using `tox_events_free`.
+ *
+ * @return a new events object, or NULL on allocation failure.
+ */
+Tox_Events *_Nullable tox_events_new(const Tox *_Nonnull tox);
+
+/**
+ * Remove all events from the events object.
+ *
+ * All pointers into the removed events, including byte buffers, will be
+ * invalid once this function returns.
+ */
+void tox_events_clear(Tox_Events *_Nonnull events);
+
+/**
+ * Run a single `tox_iterate` iteration and record all the events into an
+ * existing events object.
+ *
+ * The events from the previous iteration are cleared first, so they, and
+ * pointers into them, are only valid until the next call. Typically the
+ * object comes from `tox_events_new`, but any events object works.
+ *
+ * If `fail_hard` in @p options is `true`, any failure will leave the events
+ * object empty.
+ *
+ * @param tox The Tox instance to iterate on.
+ * @param options Options for the iteration. If NULL, default options are used.
+ * @param events The events object to record into.
+ * @param error An error code. Will be set to OK on success.
+ *
+ * @return true if all events were recorded.
+ */
+bool tox_events_iterate_into(
+    Tox *_Nonnull tox,
+    const Tox_Iterate_Options *_Nullable options,
+    Tox_Events *_Nonnull events,
+    Tox_Err_Events_Iterate *_Nullable error);
+
 /**
  * Dispatch all events in the events object to the registered callbacks in the
  * Tox instance.
@@ -0,0 +1,158 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later
+ * Copyright © 2026 The TokTok team.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "../testing/support/public/simulation.hh"
+#include "../testing/support/public/tox_network.hh"
+#include "tox.h"
+#include "tox_events.h"
+
+namespace {
+
+using tox::test::SimulatedNode;
+using tox::test::Simulation;
+
+/**
+ * Two connected Tox instances. The sender sends a batch of messages, and the
+ * receiver records them as events. All allocations made by the receiver while
+ * iterating are counted, including the ones `tox_iterate` itself makes, so
+ * the per event count doesn't quite reach zero.
+ */
+class ToxEventsBench : public benchmark::Fixture {
+public:
+    void SetUp(const ::benchmark::State &state) override
+    {
+        setup_error.clear();
+        allocations = 0;
+        events = 0;
+
+        sim = std::make_unique<Simulation>(12345);
+        sender_node = sim->create_node();
+        receiver_node = sim->create_node();
+        sender = sender_node->create_tox();
+        receiver = receiver_node->create_tox();
+
+        if (sender == nullptr || receiver == nullptr
+            || !tox::test::connect_friends(
+                *sim, *sender_node, sender.get(), *receiver_node, receiver.get())) {
+            setup_error = "failed to connect friends";
+            return;
+        }
+
+        tox_events_init(receiver.get());
+        receiver_node->fake_memory().set_observer([this](bool) {
+            if (counting) {
+                ++allocations;
+            }
+        });
+    }
+
+    void TearDown(const ::benchmark::State &state) override
+    {
+        if (receiver_node != nullptr) {
+            receiver_node->fake_memory().set_observer(nullptr);
+        }
+        receiver.reset();
+        sender.reset();
+        receiver_node.reset();
+        sender_node.reset();
+        sim.reset();
+    }
+
+    void send_batch(std::int64_t count)
+    {
+        const std::uint8_t message[] = "The quick brown fox jumps over the lazy dog";
+        for (std::int64_t i = 0; i < count; ++i) {
+            tox_friend_send_message(
+                sender.get(), 0, TOX_MESSAGE_TYPE_NORMAL, message, sizeof(message), nullptr);
+        }
+        tox_iterate(sender.get(), nullptr);
+        sim->advance_time(1);
+    }
+
+    void report(benchmark::State &state)
+    {
+        state.counters["events"] = static_cast<double>(events);
+        state.counters["allocs_per_event"]
+            = events == 0 ? 0.0 : static_cast<double>(allocations) / static_cast<double>(events);
+        state.SetItemsProcessed(static_cast<std::int64_t>(events));
+    }
+
+    std::unique_ptr<Simulation> sim;
+    std::unique_ptr<SimulatedNode> sender_node;
+    std::unique_ptr<SimulatedNode> receiver_node;
+    SimulatedNode::ToxPtr sender;
+    SimulatedNode::ToxPtr receiver;
+    std::string setup_error;
+
+    bool counting = false;
+    std::uint64_t allocations = 0;
+    std::uint64_t events = 0;
+};
+
+// A new events object per iteration, freed after use.
+BENCHMARK_DEFINE_F(ToxEventsBench, Iterate)(benchmark::State &state)
+{
+    if (!setup_error.empty()) {
+        state.SkipWithError(setup_error.c_str());
+        return;
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        send_batch(state.range(0));
+        state.ResumeTiming();
+
+        counting = true;
+        Tox_Events *batch = tox_events_iterate(receiver.get(), nullptr, nullptr);
+        events += tox_events_get_size(batch);
+        tox_events_free(batch);
+        counting = false;
+    }
+
+    report(state);
+}
+
+// One events object, reused across iterations.
+BENCHMARK_DEFINE_F(ToxEventsBench, IterateInto)(benchmark::State &state)
+{
+    if (!setup_error.empty()) {
+        state.SkipWithError(setup_error.c_str());
+        return;
+    }
+
+    Tox_Events *batch = tox_events_new(receiver.get());
+
+    // Let the arena and the events array grow to their steady state size.
+    for (int i = 0; i < 3; ++i) {
+        send_batch(state.range(0));
+        tox_events_iterate_into(receiver.get(), nullptr, batch, nullptr);
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        send_batch(state.range(0));
+        state.ResumeTiming();
+
+        counting = true;
+        tox_events_iterate_into(receiver.get(), nullptr, batch, nullptr);
+        events += tox_events_get_size(batch);
+        counting = false;
+    }
+
+    tox_events_free(batch);
+    report(state);
+}
+
+BENCHMARK_REGISTER_F(ToxEventsBench, Iterate)->Arg(1)->Arg(16)->Arg(128);
+BENCHMARK_REGISTER_F(ToxEventsBench, IterateInto)->Arg(1)->Arg(16)->Arg(128);
+
+}  // namespace
+
+BENCHMARK_MAIN();
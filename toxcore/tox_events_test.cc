@@ -1,5 +1,6 @@
 // clang-format off
 #include "../testing/support/public/simulated_environment.hh"
+#include "../testing/support/public/tox_network.hh"
 #include "tox_events.h"
 // clang-format on
 
@@ -7,6 +8,8 @@
 
 #include <array>
 #include <cstdint>
+#include <cstring>
+#include <string>
 #include <vector>
 
 #include "crypto_core.h"
@@ -15,6 +18,8 @@
 namespace {
 
 using tox::test::SimulatedEnvironment;
+using tox::test::SimulatedNode;
+using tox::test::Simulation;
 
 TEST(ToxEvents, UnpackRandomDataDoesntCrash)
 {
@@ -77,4 +82,72 @@ TEST(ToxEvents, DealsWithHugeMsgpackArrays)
     EXPECT_EQ(tox_events_load(&node->system, data.data(), data.size()), nullptr);
 }
 
+TEST(ToxEvents, ClearEmptiesLoadedEvents)
+{
+    SimulatedEnvironment env{12345};
+    auto node = env.create_node(33445);
+    std::array<std::uint8_t, 6> packed{0x91, 0x92, 0xcc, 0x00, 0xcc, 0x01};
+    Tox_Events *events = tox_events_load(&node->system, packed.data(), packed.size());
+    ASSERT_NE(events, nullptr);
+    ASSERT_EQ(tox_events_get_size(events), 1);
+    tox_events_clear(events);
+    EXPECT_EQ(tox_events_get_size(events), 0);
+    EXPECT_EQ(tox_events_get(events, 0), nullptr);
+    tox_events_free(events);
+}
+
+TEST(ToxEvents, IterateIntoReusesEvents)
+{
+    Simulation sim{12345};
+    auto sender_node = sim.create_node();
+    auto receiver_node = sim.create_node();
+    auto sender = sender_node->create_tox();
+    auto receiver = receiver_node->create_tox();
+    ASSERT_NE(sender, nullptr);
+    ASSERT_NE(receiver, nullptr);
+    ASSERT_TRUE(tox::test::connect_friends(
+        sim, *sender_node, sender.get(), *receiver_node, receiver.get()));
+
+    tox_events_init(receiver.get());
+    Tox_Events *events = tox_events_new(receiver.get());
+    ASSERT_NE(events, nullptr);
+
+    for (int round = 0; round < 5; ++round) {
+        const std::string text = "message " + std::to_string(round);
+        for (int i = 0; i < 3; ++i) {
+            tox_friend_send_message(sender.get(), 0, TOX_MESSAGE_TYPE_NORMAL,
+                reinterpret_cast<const std::uint8_t *>(text.data()), text.size(), nullptr);
+        }
+        tox_iterate(sender.get(), nullptr);
+
+        // Only this round's messages, not the previous ones.
+        int messages = 0;
+        for (int tries = 0; tries < 20 && messages < 3; ++tries) {
+            sim.advance_time(10);
+
+            Tox_Err_Events_Iterate err;
+            EXPECT_TRUE(tox_events_iterate_into(receiver.get(), nullptr, events, &err));
+            EXPECT_EQ(err, TOX_ERR_EVENTS_ITERATE_OK);
+
+            for (std::uint32_t i = 0; i < tox_events_get_size(events); ++i) {
+                const Tox_Event_Friend_Message *msg
+                    = tox_event_get_friend_message(tox_events_get(events, i));
+                if (msg == nullptr) {
+                    continue;
+                }
+                ++messages;
+                ASSERT_EQ(tox_event_friend_message_get_message_length(msg), text.size());
+                EXPECT_EQ(std::memcmp(tox_event_friend_message_get_message(msg), text.data(),
+                              text.size()),
+                    0);
+            }
+
+            tox_iterate(sender.get(), nullptr);
+        }
+        EXPECT_EQ(messages, 3);
+    }
+
+    tox_events_free(events);
+}
+
 }  // namespace
@@ -198,6 +198,14 @@ void tox_options_set_experimental_disable_dns(Tox_Options *_Nonnull options, boo
 {
     options->experimental_disable_dns = experimental_disable_dns;
 }
+bool tox_options_get_experimental_lazy_load(const Tox_Options *_Nonnull options)
+{
+    return options->experimental_lazy_load;
+}
+void tox_options_set_experimental_lazy_load(Tox_Options *_Nonnull options, bool experimental_lazy_load)
+{
+    options->experimental_lazy_load = experimental_lazy_load;
+}
 bool tox_options_get_experimental_owned_data(const Tox_Options *_Nonnull options)
 {
     return options->experimental_owned_data;
@@ -266,6 +274,7 @@ void tox_options_default(Tox_Options *_Nonnull options)
         tox_options_set_experimental_groups_persistence(options, false);
         tox_options_set_handshake_mode(options, TOX_HANDSHAKE_MODE_NOISE_AND_LEGACY);
         tox_options_set_experimental_disable_dns(options, false);
+        tox_options_set_experimental_lazy_load(options, false);
         tox_options_set_experimental_owned_data(options, false);
     }
 }
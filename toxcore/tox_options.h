@@ -318,6 +318,19 @@ struct Tox_Options {
      */
     bool experimental_disable_dns;
 
+    /**
+     * @brief Defer setting up friend connections when loading savedata.
+     *
+     * Friends are loaded from the savedata as usual and the friend list, names
+     * and statuses are available right after `tox_new`, but the connections
+     * used to find them on the network are created over the first few calls
+     * to `tox_iterate`. This makes `tox_new` much faster for profiles with
+     * many friends.
+     *
+     * Default: false.
+     */
+    bool experimental_lazy_load;
+
     /**
      * @brief Whether the savedata data is owned by the Tox_Options object.
      *
@@ -436,6 +449,10 @@ bool tox_options_get_experimental_disable_dns(const Tox_Options *options);
 
 void tox_options_set_experimental_disable_dns(Tox_Options *options, bool experimental_disable_dns);
 
+bool tox_options_get_experimental_lazy_load(const Tox_Options *options);
+
+void tox_options_set_experimental_lazy_load(Tox_Options *options, bool experimental_lazy_load);
+
 /**
  * @brief Initialises a Tox_Options object with the default options.
  *
@@ -12,22 +12,28 @@
 
 #include "DHT.h"
 #include "Messenger.h"
+#include "TCP_connection.h"
 #include "TCP_server.h"
 #include "ccompat.h"
 #include "crypto_core.h"
 #include "group_chats.h"
+#include "group.h"
 #include "group_common.h"
+#include "iterate_profile.h"
 #include "logger.h"
 #include "mem.h"
 #include "net.h"
 #include "net_crypto.h"
+#include "net_crypto_congestion.h"
 #include "net_profile.h"
 #include "network.h"
 #include "os_memory.h"
 #include "os_network.h"
 #include "os_random.h"
+#include "state.h"
 #include "tox.h"
 #include "tox_struct.h"  // IWYU pragma: keep
+#include "util.h"
 
 #define SET_ERROR_PARAMETER(param, x) \
     do {                              \
@@ -182,6 +188,445 @@ uint16_t tox_dht_get_num_closelist_announce_capable(const Tox *tox)
     return num_cap;
 }
 
+size_t tox_savedata_compact_size(const Tox *tox)
+{
+    assert(tox != nullptr);
+    tox_lock(tox);
+    const size_t ret = 2 * sizeof(uint32_t)
+                       + messenger_size(tox->m)
+                       + conferences_size(tox->m->conferences_object);
+    tox_unlock(tox);
+    return ret;
+}
+
+size_t tox_savedata_compact(Tox *tox, uint8_t *savedata)
+{
+    assert(tox != nullptr);
+
+    if (savedata == nullptr) {
+        return 0;
+    }
+
+    memzero(savedata, tox_savedata_compact_size(tox));
+
+    tox_lock(tox);
+
+    const uint8_t *const start = savedata;
+    const uint32_t size32 = sizeof(uint32_t);
+
+    // write cookie
+    memzero(savedata, size32);
+    savedata += size32;
+    host_to_lendian_bytes32(savedata, STATE_COOKIE_GLOBAL);
+    savedata += size32;
+
+    // No end section: journal records are appended after the base.
+    savedata = messenger_journal_base(tox->m, savedata);
+    savedata = conferences_save(tox->m->conferences_object, savedata);
+
+    tox_unlock(tox);
+
+    return (size_t)(savedata - start);
+}
+
+size_t tox_savedata_journal_size(const Tox *tox)
+{
+    assert(tox != nullptr);
+    tox_lock(tox);
+    const size_t ret = messenger_journal_size(tox->m);
+    tox_unlock(tox);
+    return ret;
+}
+
+size_t tox_savedata_journal(Tox *tox, uint8_t *journal, Tox_Err_Savedata_Journal *error)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+
+    if (!tox->m->journal.started) {
+        tox_unlock(tox);
+        SET_ERROR_PARAMETER(error, TOX_ERR_SAVEDATA_JOURNAL_NOT_STARTED);
+        return 0;
+    }
+
+    if (tox->m->journal.incomplete) {
+        tox_unlock(tox);
+        SET_ERROR_PARAMETER(error, TOX_ERR_SAVEDATA_JOURNAL_INCOMPLETE);
+        return 0;
+    }
+
+    const uint32_t size = messenger_journal_size(tox->m);
+
+    if (size == 0) {
+        tox_unlock(tox);
+        SET_ERROR_PARAMETER(error, TOX_ERR_SAVEDATA_JOURNAL_OK);
+        return 0;
+    }
+
+    memzero(journal, size);
+
+    const uint8_t *const end = messenger_journal_save(tox->m, journal, size);
+    const bool incomplete = tox->m->journal.incomplete;
+
+    tox_unlock(tox);
+
+    if (incomplete) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_SAVEDATA_JOURNAL_INCOMPLETE);
+        return 0;
+    }
+
+    SET_ERROR_PARAMETER(error, TOX_ERR_SAVEDATA_JOURNAL_OK);
+    return (size_t)(end - journal);
+}
+
+bool tox_log_async_enable(Tox *tox, uint32_t capacity)
+{
+    assert(tox != nullptr);
+    return logger_enable_async(tox->log, capacity);
+}
+
+uint32_t tox_log_flush(Tox *tox)
+{
+    assert(tox != nullptr);
+    return logger_flush(tox->log);
+}
+
+uint64_t tox_log_dropped(const Tox *tox)
+{
+    assert(tox != nullptr);
+    return logger_dropped(tox->log);
+}
+
+void tox_set_congestion_control(Tox *tox, Tox_Congestion_Control congestion_control)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    net_crypto_set_congestion_control(tox->m->net_crypto, congestion_control == TOX_CONGESTION_CONTROL_CUBIC
+                                      ? CONGESTION_CONTROL_CUBIC : CONGESTION_CONTROL_LEGACY);
+    tox_unlock(tox);
+}
+
+void tox_set_tcp_relay_selection(Tox *tox, Tox_Tcp_Relay_Selection selection)
+{
+    assert(tox != nullptr);
+
+    TCP_Relay_Selection tcp_selection = TCP_RELAY_SELECTION_FASTEST;
+
+    switch (selection) {
+        case TOX_TCP_RELAY_SELECTION_FIRST: {
+            tcp_selection = TCP_RELAY_SELECTION_FIRST;
+            break;
+        }
+
+        case TOX_TCP_RELAY_SELECTION_FASTEST: {
+            tcp_selection = TCP_RELAY_SELECTION_FASTEST;
+            break;
+        }
+
+        case TOX_TCP_RELAY_SELECTION_STRIPED: {
+            tcp_selection = TCP_RELAY_SELECTION_STRIPED;
+            break;
+        }
+    }
+
+    tox_lock(tox);
+    tcp_connections_set_relay_selection(nc_get_tcp_c(tox->m->net_crypto), tcp_selection);
+    tox_unlock(tox);
+}
+
+uint32_t tox_tcp_relay_count(const Tox *tox)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const uint32_t count = tcp_connections_count(nc_get_tcp_c(tox->m->net_crypto));
+    tox_unlock(tox);
+
+    return count;
+}
+
+uint32_t tox_tcp_relay_get_rtt(const Tox *tox, uint32_t relay_number)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const uint32_t rtt = tcp_relay_rtt(nc_get_tcp_c(tox->m->net_crypto), relay_number);
+    tox_unlock(tox);
+
+    return rtt;
+}
+
+uint64_t tox_tcp_relay_get_bytes_sent(const Tox *tox, uint32_t relay_number)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const uint64_t bytes = tcp_relay_bytes_sent(nc_get_tcp_c(tox->m->net_crypto), relay_number);
+    tox_unlock(tox);
+
+    return bytes;
+}
+
+bool tox_tcp_relay_get_public_key(const Tox *tox, uint32_t relay_number, uint8_t *public_key)
+{
+    assert(tox != nullptr);
+    assert(public_key != nullptr);
+
+    tox_lock(tox);
+    const bool ok = tcp_relay_public_key(nc_get_tcp_c(tox->m->net_crypto), relay_number, public_key);
+    tox_unlock(tox);
+
+    return ok;
+}
+
+bool tox_friend_get_connection_stats(const Tox *tox, Tox_Friend_Number friend_number,
+                                     Tox_Connection_Stats *stats, Tox_Err_Friend_Query *error)
+{
+    assert(tox != nullptr);
+    assert(stats != nullptr);
+
+    Crypto_Connection_Stats conn_stats;
+
+    tox_lock(tox);
+    const bool ok = m_get_friend_connection_stats(tox->m, friend_number, &conn_stats);
+    tox_unlock(tox);
+
+    if (!ok) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_FRIEND_QUERY_FRIEND_NOT_FOUND);
+        return false;
+    }
+
+    stats->packets_sent = conn_stats.packets_sent;
+    stats->bytes_sent = conn_stats.bytes_sent;
+    stats->packets_received = conn_stats.packets_received;
+    stats->bytes_received = conn_stats.bytes_received;
+    stats->packets_resent = conn_stats.packets_resent;
+    stats->send_rate = conn_stats.send_rate;
+    stats->rtt = (uint32_t)min_u64(conn_stats.rtt, UINT32_MAX);
+    stats->congestion_events = conn_stats.congestion_events;
+
+    SET_ERROR_PARAMETER(error, TOX_ERR_FRIEND_QUERY_OK);
+    return true;
+}
+
+bool tox_group_peer_get_connection_stats(const Tox *tox, uint32_t group_number, uint32_t peer_id,
+        Tox_Connection_Stats *stats, Tox_Err_Group_Peer_Query *error)
+{
+    assert(tox != nullptr);
+    assert(stats != nullptr);
+
+    tox_lock(tox);
+    const GC_Chat *chat = gc_get_group(tox->m->group_handler, group_number);
+
+    if (chat == nullptr) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_GROUP_PEER_QUERY_GROUP_NOT_FOUND);
+        tox_unlock(tox);
+        return false;
+    }
+
+    GC_Connection_Stats conn_stats;
+    const int ret = gc_get_peer_connection_stats(chat, gc_peer_id_from_int(peer_id), &conn_stats);
+    tox_unlock(tox);
+
+    if (ret == -1) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_GROUP_PEER_QUERY_PEER_NOT_FOUND);
+        return false;
+    }
+
+    stats->packets_sent = conn_stats.packets_sent;
+    stats->bytes_sent = conn_stats.bytes_sent;
+    stats->packets_received = conn_stats.packets_received;
+    stats->bytes_received = conn_stats.bytes_received;
+    stats->packets_resent = conn_stats.packets_resent;
+    stats->send_rate = 0;
+    stats->rtt = (uint32_t)min_u64(conn_stats.min_rtt, UINT32_MAX);
+    stats->congestion_events = 0;
+
+    SET_ERROR_PARAMETER(error, TOX_ERR_GROUP_PEER_QUERY_OK);
+    return true;
+}
+
+bool tox_iterate_profile_set_enabled(Tox *tox, bool enabled)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const bool ret = m_set_iterate_profiling(tox->m, enabled);
+    tox_unlock(tox);
+
+    return ret;
+}
+
+void tox_iterate_profile_reset(Tox *tox)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    iterprof_reset(tox->m->iter_profile);
+    tox_unlock(tox);
+}
+
+uint64_t tox_iterate_profile_get_phase_count(const Tox *tox, Tox_Iterate_Phase phase)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const uint64_t count = iterprof_get_phase_count(tox->m->iter_profile, (Iterate_Phase)phase);
+    tox_unlock(tox);
+
+    return count;
+}
+
+uint64_t tox_iterate_profile_get_phase_total_ns(const Tox *tox, Tox_Iterate_Phase phase)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const uint64_t ns = iterprof_get_phase_total_ns(tox->m->iter_profile, (Iterate_Phase)phase);
+    tox_unlock(tox);
+
+    return ns;
+}
+
+uint64_t tox_iterate_profile_get_phase_max_ns(const Tox *tox, Tox_Iterate_Phase phase)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const uint64_t ns = iterprof_get_phase_max_ns(tox->m->iter_profile, (Iterate_Phase)phase);
+    tox_unlock(tox);
+
+    return ns;
+}
+
+uint64_t tox_iterate_profile_get_phase_bucket(const Tox *tox, Tox_Iterate_Phase phase, uint32_t bucket)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const uint64_t count = iterprof_get_phase_bucket(tox->m->iter_profile, (Iterate_Phase)phase, bucket);
+    tox_unlock(tox);
+
+    return count;
+}
+
+uint64_t tox_iterate_profile_get_packet_count(const Tox *tox, uint8_t id)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const uint64_t count = iterprof_get_packet_count(tox->m->iter_profile, id);
+    tox_unlock(tox);
+
+    return count;
+}
+
+uint64_t tox_iterate_profile_get_packet_total_ns(const Tox *tox, uint8_t id)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const uint64_t ns = iterprof_get_packet_total_ns(tox->m->iter_profile, id);
+    tox_unlock(tox);
+
+    return ns;
+}
+
+uint64_t tox_iterate_profile_get_packet_max_ns(const Tox *tox, uint8_t id)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const uint64_t ns = iterprof_get_packet_max_ns(tox->m->iter_profile, id);
+    tox_unlock(tox);
+
+    return ns;
+}
+
+static bool set_file_stream_error(int ret, Tox_Err_File_Stream *_Nullable error)
+{
+    switch (ret) {
+        case 0: {
+            SET_ERROR_PARAMETER(error, TOX_ERR_FILE_STREAM_OK);
+            return true;
+        }
+
+        case -1: {
+            SET_ERROR_PARAMETER(error, TOX_ERR_FILE_STREAM_FRIEND_NOT_FOUND);
+            return false;
+        }
+
+        case -2: {
+            SET_ERROR_PARAMETER(error, TOX_ERR_FILE_STREAM_NOT_FOUND);
+            return false;
+        }
+
+        case -3: {
+            SET_ERROR_PARAMETER(error, TOX_ERR_FILE_STREAM_WRONG_DIRECTION);
+            return false;
+        }
+
+        case -4: {
+            SET_ERROR_PARAMETER(error, TOX_ERR_FILE_STREAM_BUSY);
+            return false;
+        }
+
+        case -5: {
+            SET_ERROR_PARAMETER(error, TOX_ERR_FILE_STREAM_TOO_SMALL);
+            return false;
+        }
+
+        default: {
+            SET_ERROR_PARAMETER(error, TOX_ERR_FILE_STREAM_MALLOC);
+            return false;
+        }
+    }
+}
+
+bool tox_file_set_source_region(Tox *tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+                                const uint8_t *data, uint64_t length, Tox_Err_File_Stream *error)
+{
+    assert(tox != nullptr);
+    tox_lock(tox);
+    const int ret = file_set_source_region(tox->m, friend_number, file_number, data, length);
+    tox_unlock(tox);
+    return set_file_stream_error(ret, error);
+}
+
+bool tox_file_set_source_callback(Tox *tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+                                  tox_file_read_cb *read, void *user_data, uint32_t buffer_size,
+                                  Tox_Err_File_Stream *error)
+{
+    assert(tox != nullptr);
+    tox_lock(tox);
+    const int ret = file_set_source_callback(tox->m, friend_number, file_number, read, user_data, buffer_size);
+    tox_unlock(tox);
+    return set_file_stream_error(ret, error);
+}
+
+bool tox_file_set_sink_region(Tox *tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+                              uint8_t *data, uint64_t length, Tox_Err_File_Stream *error)
+{
+    assert(tox != nullptr);
+    tox_lock(tox);
+    const int ret = file_set_sink_region(tox->m, friend_number, file_number, data, length);
+    tox_unlock(tox);
+    return set_file_stream_error(ret, error);
+}
+
+bool tox_file_set_sink_callback(Tox *tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+                                tox_file_write_cb *write, void *user_data, uint32_t buffer_size,
+                                Tox_Err_File_Stream *error)
+{
+    assert(tox != nullptr);
+    tox_lock(tox);
+    const int ret = file_set_sink_callback(tox->m, friend_number, file_number, write, user_data, buffer_size);
+    tox_unlock(tox);
+    return set_file_stream_error(ret, error);
+}
+
 size_t tox_group_peer_get_ip_address_size(const Tox *tox, uint32_t group_number, uint32_t peer_id,
         Tox_Err_Group_Peer_Query *error)
 {
@@ -429,3 +874,14 @@ uint64_t tox_netprof_get_packet_total_bytes(const Tox *tox, Tox_Netprof_Packet_T
 
     return bytes;
 }
+
+bool tox_testonly_friend_has_connection(const Tox *tox, Tox_Friend_Number friend_number)
+{
+    assert(tox != nullptr);
+
+    tox_lock(tox);
+    const bool has_connection = getfriendcon_id(tox->m, friend_number) != -1;
+    tox_unlock(tox);
+
+    return has_connection;
+}
@@ -486,6 +486,538 @@ uint64_t tox_netprof_get_packet_total_bytes(const Tox *_Nonnull tox, Tox_Netprof
         Tox_Netprof_Direction direction);
 
 
+/*******************************************************************************
+ *
+ * :: Journaled savedata.
+ *
+ ******************************************************************************/
+
+/**
+ * A journaled save file is a base written by `tox_savedata_compact` followed
+ * by any number of journals written by `tox_savedata_journal`. Each journal
+ * records the changes since the previous one, so a client appends it to the
+ * file instead of rewriting all friends after every change. The whole file is
+ * loaded by `tox_new` as `TOX_SAVEDATA_TYPE_TOX_SAVE`.
+ *
+ * The journal records our name, status message, status and nospam, friends
+ * that were added, removed or changed, and groups if groups persistence is
+ * enabled. DHT nodes, TCP relays, conferences and friends' last seen times
+ * are only saved by the base.
+ *
+ * The base has no end marker, so a journal must never be appended to the
+ * output of `tox_get_savedata`: its changes would not be loaded.
+ */
+
+/**
+ * Return the maximum number of bytes `tox_savedata_compact` writes.
+ */
+size_t tox_savedata_compact_size(const Tox *_Nonnull tox);
+
+/**
+ * Write a new journal base to `savedata` and start a new journal.
+ *
+ * This is how journaling is started after `tox_new`, and how a journaled file
+ * is compacted: the client replaces the whole file with the base. Changes
+ * made before this call are not written to the next journal.
+ *
+ * Journals must be appended right after the returned number of bytes, not
+ * after `tox_savedata_compact_size` bytes, because the size is an upper bound.
+ *
+ * @param savedata A memory region of at least `tox_savedata_compact_size`
+ *   bytes. If this parameter is NULL, this function has no effect.
+ *
+ * @return the number of bytes written to `savedata`.
+ */
+size_t tox_savedata_compact(Tox *_Nonnull tox, uint8_t *_Nullable savedata);
+
+typedef enum Tox_Err_Savedata_Journal {
+    TOX_ERR_SAVEDATA_JOURNAL_OK,
+
+    /**
+     * `tox_savedata_compact` was never called, so there is no base to append
+     * to.
+     */
+    TOX_ERR_SAVEDATA_JOURNAL_NOT_STARTED,
+
+    /**
+     * A change could not be recorded because memory allocation failed. Call
+     * `tox_savedata_compact` and replace the file instead.
+     */
+    TOX_ERR_SAVEDATA_JOURNAL_INCOMPLETE,
+} Tox_Err_Savedata_Journal;
+
+/**
+ * Return the largest number of bytes `tox_savedata_journal` can write.
+ *
+ * Groups are counted whole because whether they changed is only known when
+ * the journal is written.
+ */
+size_t tox_savedata_journal_size(const Tox *_Nonnull tox);
+
+/**
+ * Write the changes since the last base or journal to `journal`.
+ *
+ * The written bytes are appended to the save file. Nothing is written if
+ * nothing changed. Each change is written once, so the journal must be
+ * appended before this function is called again.
+ *
+ * @param journal A memory region of at least `tox_savedata_journal_size`
+ *   bytes.
+ *
+ * @return the number of bytes written.
+ */
+size_t tox_savedata_journal(Tox *_Nonnull tox, uint8_t *_Nonnull journal, Tox_Err_Savedata_Journal *_Nullable error);
+
+/*******************************************************************************
+ *
+ * :: Async logging.
+ *
+ ******************************************************************************/
+
+/**
+ * In async mode, logging only records the format string and a copy of the
+ * arguments in a preallocated record. Formatting and the log callback run on
+ * whichever thread calls `tox_log_flush`, typically a thread the client
+ * dedicates to it, so a slow log callback doesn't slow down the threads
+ * running `tox_iterate` and ToxAV.
+ *
+ * Messages written while every record is waiting to be flushed are dropped
+ * and counted. Messages still waiting in `tox_kill` are delivered by the
+ * thread calling it.
+ */
+
+/**
+ * Switch the log callback to async mode.
+ *
+ * Must be called before any other thread uses this Tox instance. Can only be
+ * called once.
+ *
+ * @param capacity The number of messages that can wait to be flushed. Each
+ *   takes a little over 1 KiB.
+ *
+ * @return true on success, false if memory allocation failed or async mode
+ *   was already enabled.
+ */
+bool tox_log_async_enable(Tox *_Nonnull tox, uint32_t capacity);
+
+/**
+ * Format the waiting messages and pass them to the log callback.
+ *
+ * Doesn't take the Tox lock, so it can be called while another thread is in
+ * `tox_iterate`. If several threads call it, the log callback runs on them
+ * concurrently.
+ *
+ * @return the number of messages delivered. At most `capacity` are delivered
+ *   per call.
+ */
+uint32_t tox_log_flush(Tox *_Nonnull tox);
+
+/**
+ * Return the number of messages dropped in async mode because none of the
+ * records was free.
+ */
+uint64_t tox_log_dropped(const Tox *_Nonnull tox);
+
+/*******************************************************************************
+ *
+ * :: Congestion control.
+ *
+ ******************************************************************************/
+
+/**
+ * Algorithms that decide how fast lossless packets (messages, file transfer
+ * data, custom lossless packets) are sent to a friend.
+ */
+typedef enum Tox_Congestion_Control {
+    /**
+     * Adjust the rate from the size of the send queue and the rate at which
+     * packets were sent. The default.
+     */
+    TOX_CONGESTION_CONTROL_LEGACY,
+
+    /**
+     * CUBIC: grow a congestion window on acks and shrink it on loss, and send
+     * one window per smoothed round trip time.
+     */
+    TOX_CONGESTION_CONTROL_CUBIC,
+} Tox_Congestion_Control;
+
+const char *_Nonnull tox_congestion_control_to_string(Tox_Congestion_Control value);
+
+/**
+ * Select the congestion control algorithm for friend connections established
+ * from now on. Connections that are already up keep their algorithm.
+ *
+ * Only the sending side's choice matters, so peers don't need to agree.
+ */
+void tox_set_congestion_control(Tox *_Nonnull tox, Tox_Congestion_Control congestion_control);
+
+/*******************************************************************************
+ *
+ * :: TCP relay selection.
+ *
+ ******************************************************************************/
+
+/**
+ * How packets to a friend pick one of the TCP relays the friend is reachable
+ * through, when there is no direct UDP connection.
+ *
+ * Relays are timed with the pings toxcore already sends them every 30
+ * seconds, so the RTT is that of our own leg to the relay.
+ */
+typedef enum Tox_Tcp_Relay_Selection {
+    /**
+     * The first relay in the order the relays were added.
+     */
+    TOX_TCP_RELAY_SELECTION_FIRST,
+
+    /**
+     * The relay with the lowest RTT. The default.
+     */
+    TOX_TCP_RELAY_SELECTION_FASTEST,
+
+    /**
+     * Like FASTEST for messages, but file transfer and custom packet data is
+     * spread over all relays whose RTT is at most 1.5 times the lowest one.
+     */
+    TOX_TCP_RELAY_SELECTION_STRIPED,
+} Tox_Tcp_Relay_Selection;
+
+const char *_Nonnull tox_tcp_relay_selection_to_string(Tox_Tcp_Relay_Selection value);
+
+/**
+ * Select how packets to friends pick a TCP relay. Takes effect from the next
+ * packet sent, on all friend connections.
+ *
+ * Only the sending side's choice matters, so peers don't need to agree.
+ */
+void tox_set_tcp_relay_selection(Tox *_Nonnull tox, Tox_Tcp_Relay_Selection selection);
+
+/**
+ * Number of TCP relay slots. Relays are numbered from 0 to this value minus
+ * one; not all of them are connected.
+ */
+uint32_t tox_tcp_relay_count(const Tox *_Nonnull tox);
+
+/**
+ * Smoothed round trip time to a TCP relay in milliseconds, or 0 if we are not
+ * connected to it or haven't timed it yet.
+ */
+uint32_t tox_tcp_relay_get_rtt(const Tox *_Nonnull tox, uint32_t relay_number);
+
+/**
+ * Bytes of friend data sent through a TCP relay since we connected to it.
+ */
+uint64_t tox_tcp_relay_get_bytes_sent(const Tox *_Nonnull tox, uint32_t relay_number);
+
+/**
+ * Copy the public key of a TCP relay, to tell which relay a slot number
+ * refers to.
+ *
+ * @param public_key A memory region of at least TOX_PUBLIC_KEY_SIZE bytes.
+ *
+ * @return false if the slot holds no relay.
+ */
+bool tox_tcp_relay_get_public_key(const Tox *_Nonnull tox, uint32_t relay_number, uint8_t *_Nonnull public_key);
+
+/*******************************************************************************
+ *
+ * :: Connection statistics.
+ *
+ ******************************************************************************/
+
+/**
+ * Traffic and latency counters of the connection to a friend or group peer.
+ *
+ * Packets and bytes are counted as they go over the wire, encrypted, through
+ * UDP or a TCP relay. The counters start from zero on each new connection.
+ */
+typedef struct Tox_Connection_Stats {
+    uint64_t packets_sent;
+    uint64_t bytes_sent;
+    uint64_t packets_received;
+    uint64_t bytes_received;
+
+    /**
+     * Lossless packets sent again because they were lost or the peer asked
+     * for them.
+     */
+    uint64_t packets_resent;
+
+    /**
+     * Packets per second the congestion control currently allows. Always 0
+     * for group peers, whose packets aren't rate limited.
+     */
+    double send_rate;
+
+    /**
+     * Smallest round trip time in milliseconds measured so far, 0 until the
+     * first measurement.
+     */
+    uint32_t rtt;
+
+    /**
+     * Times the congestion control has slowed down because of loss or a full
+     * send queue. Always 0 for group peers.
+     */
+    uint64_t congestion_events;
+} Tox_Connection_Stats;
+
+/**
+ * Copy the counters of the connection to a friend to `stats`.
+ *
+ * If the friend is offline, all counters are 0.
+ *
+ * @return true on success.
+ */
+bool tox_friend_get_connection_stats(const Tox *_Nonnull tox, Tox_Friend_Number friend_number,
+                                     Tox_Connection_Stats *_Nonnull stats, Tox_Err_Friend_Query *_Nullable error);
+
+/**
+ * Copy the counters of the connection to a group peer to `stats`.
+ *
+ * @param group_number The group number of the group we wish to query.
+ * @param peer_id The ID of the peer, which can't be ourself.
+ *
+ * @return true on success.
+ */
+bool tox_group_peer_get_connection_stats(const Tox *_Nonnull tox, uint32_t group_number, uint32_t peer_id,
+        Tox_Connection_Stats *_Nonnull stats, Tox_Err_Group_Peer_Query *_Nullable error);
+
+/*******************************************************************************
+ *
+ * :: tox_iterate profiling.
+ *
+ ******************************************************************************/
+
+/**
+ * While enabled, every call of tox_iterate records the wall time of each of
+ * its phases, and every UDP packet records the time its handler took, keyed
+ * by packet ID. Handlers run inside the NETWORKING_POLL phase.
+ *
+ * The clock is the system's monotonic clock, read twice per packet and once
+ * per phase. While disabled, nothing is timed.
+ */
+typedef enum Tox_Iterate_Phase {
+    /**
+     * All of tox_iterate, including the phases below.
+     */
+    TOX_ITERATE_PHASE_ITERATE,
+
+    /**
+     * Reading UDP packets and running their handlers.
+     */
+    TOX_ITERATE_PHASE_NETWORKING_POLL,
+
+    TOX_ITERATE_PHASE_DHT,
+
+    /**
+     * The TCP relay run by this instance, if enabled.
+     */
+    TOX_ITERATE_PHASE_TCP_SERVER,
+
+    TOX_ITERATE_PHASE_NET_CRYPTO,
+
+    TOX_ITERATE_PHASE_ONION_CLIENT,
+
+    /**
+     * Includes creating the friend connections of friends loaded from a save.
+     */
+    TOX_ITERATE_PHASE_FRIEND_CONNECTIONS,
+
+    TOX_ITERATE_PHASE_FRIENDS,
+
+    TOX_ITERATE_PHASE_GROUP_CHATS,
+
+    TOX_ITERATE_PHASE_GROUP_ANNOUNCES,
+
+    TOX_ITERATE_PHASE_GROUP_ONION_FRIENDS,
+
+    /**
+     * Conferences (the old group chats).
+     */
+    TOX_ITERATE_PHASE_CONFERENCES,
+} Tox_Iterate_Phase;
+
+const char *_Nonnull tox_iterate_phase_to_string(Tox_Iterate_Phase value);
+
+/**
+ * Number of buckets in a phase's histogram. Bucket `i` counts calls that took
+ * from 2^i up to 2^(i+1) nanoseconds; the last one also counts longer calls.
+ */
+#define TOX_ITERATE_PROFILE_BUCKETS 32
+
+/**
+ * Start or stop profiling. Starting clears all counters.
+ *
+ * @return false if memory for the profile couldn't be allocated.
+ */
+bool tox_iterate_profile_set_enabled(Tox *_Nonnull tox, bool enabled);
+
+/**
+ * Clear all counters, e.g. to skip the start-up of the instance.
+ */
+void tox_iterate_profile_reset(Tox *_Nonnull tox);
+
+/**
+ * Return the number of times `phase` ran. All phase and packet getters return
+ * 0 while profiling is disabled.
+ */
+uint64_t tox_iterate_profile_get_phase_count(const Tox *_Nonnull tox, Tox_Iterate_Phase phase);
+
+/**
+ * Return the total time spent in `phase` in nanoseconds.
+ */
+uint64_t tox_iterate_profile_get_phase_total_ns(const Tox *_Nonnull tox, Tox_Iterate_Phase phase);
+
+/**
+ * Return the longest single run of `phase` in nanoseconds.
+ */
+uint64_t tox_iterate_profile_get_phase_max_ns(const Tox *_Nonnull tox, Tox_Iterate_Phase phase);
+
+/**
+ * Return the number of runs of `phase` that fell into histogram bucket
+ * `bucket`, or 0 if `bucket` is at least TOX_ITERATE_PROFILE_BUCKETS.
+ */
+uint64_t tox_iterate_profile_get_phase_bucket(const Tox *_Nonnull tox, Tox_Iterate_Phase phase, uint32_t bucket);
+
+/**
+ * Return the number of UDP packets with ID `id` that were handled.
+ *
+ * Packet IDs are those of Tox_Netprof_Packet_Id.
+ */
+uint64_t tox_iterate_profile_get_packet_count(const Tox *_Nonnull tox, uint8_t id);
+
+/**
+ * Return the total time spent in the handler of UDP packet ID `id` in
+ * nanoseconds.
+ */
+uint64_t tox_iterate_profile_get_packet_total_ns(const Tox *_Nonnull tox, uint8_t id);
+
+/**
+ * Return the longest single run of the handler of UDP packet ID `id` in
+ * nanoseconds.
+ */
+uint64_t tox_iterate_profile_get_packet_max_ns(const Tox *_Nonnull tox, uint8_t id);
+
+/*******************************************************************************
+ *
+ * :: File sources and sinks.
+ *
+ ******************************************************************************/
+
+/**
+ * A file transfer can read its data from, or write it to, a source or sink
+ * the client sets up once, instead of going through `file_chunk_request` and
+ * `file_recv_chunk` for every chunk of about 1.3 KiB. Outgoing data is copied
+ * straight from the source into the packet send queue.
+ *
+ * With a sink, `file_recv_chunk` is only called with length 0 when the file
+ * is complete. With a source, `file_chunk_request` is only called with length
+ * 0 when the friend has received the whole file. A source or sink that fails
+ * kills the transfer, and `file_recv_control` is called with
+ * TOX_FILE_CONTROL_CANCEL as if the friend had cancelled it.
+ *
+ * Toxcore does no file I/O, so clients wanting to send from a file descriptor
+ * pass a read callback that calls `pread` or map the file and pass the region.
+ */
+
+/**
+ * Read up to `length` bytes of the file at `position` into `data`.
+ *
+ * @return the number of bytes read. Fewer than `length` means the end of the
+ *   file was reached.
+ */
+typedef size_t tox_file_read_cb(void *_Nullable user_data, uint64_t position, uint8_t *_Nonnull data, size_t length);
+
+/**
+ * Write `length` bytes of the file at `position`.
+ *
+ * @return true on success, false to kill the transfer.
+ */
+typedef bool tox_file_write_cb(void *_Nullable user_data, uint64_t position, const uint8_t *_Nonnull data, size_t length);
+
+typedef enum Tox_Err_File_Stream {
+    TOX_ERR_FILE_STREAM_OK,
+
+    /**
+     * The friend_number passed did not designate a valid friend.
+     */
+    TOX_ERR_FILE_STREAM_FRIEND_NOT_FOUND,
+
+    /**
+     * No file transfer with the given file number was found for the given
+     * friend.
+     */
+    TOX_ERR_FILE_STREAM_NOT_FOUND,
+
+    /**
+     * A source was passed for an incoming file, or a sink for an outgoing one.
+     */
+    TOX_ERR_FILE_STREAM_WRONG_DIRECTION,
+
+    /**
+     * The transfer already has a source or sink, or chunks requested with
+     * `file_chunk_request` haven't been sent yet.
+     */
+    TOX_ERR_FILE_STREAM_BUSY,
+
+    /**
+     * The memory region is smaller than the file.
+     */
+    TOX_ERR_FILE_STREAM_TOO_SMALL,
+
+    /**
+     * A memory allocation failed.
+     */
+    TOX_ERR_FILE_STREAM_MALLOC,
+} Tox_Err_File_Stream;
+
+const char *_Nonnull tox_err_file_stream_to_string(Tox_Err_File_Stream value);
+
+/**
+ * Send an outgoing file from a memory region, e.g. a mapped file.
+ *
+ * The region must stay valid until the transfer ends. For a file of unknown
+ * size (UINT64_MAX), the end of the region ends the file.
+ */
+bool tox_file_set_source_region(Tox *_Nonnull tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+                                const uint8_t *_Nonnull data, uint64_t length, Tox_Err_File_Stream *_Nullable error);
+
+/**
+ * Send an outgoing file by calling `read` from `tox_iterate`.
+ *
+ * @param buffer_size Bytes read ahead per call to `read`, or 0 for a default
+ *   of about 85 KiB.
+ */
+bool tox_file_set_source_callback(Tox *_Nonnull tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+                                  tox_file_read_cb *_Nonnull read, void *_Nullable user_data, uint32_t buffer_size,
+                                  Tox_Err_File_Stream *_Nullable error);
+
+/**
+ * Receive an incoming file into a memory region.
+ *
+ * Data is written at its position in the file, so the region must stay valid
+ * until the transfer ends. Data beyond the end of the region kills the
+ * transfer.
+ */
+bool tox_file_set_sink_region(Tox *_Nonnull tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+                              uint8_t *_Nonnull data, uint64_t length, Tox_Err_File_Stream *_Nullable error);
+
+/**
+ * Receive an incoming file by calling `write` from `tox_iterate`.
+ *
+ * Data is written when `buffer_size` bytes have been received, when the file
+ * is complete, and when the friend goes offline, so a broken transfer can be
+ * resumed from the last byte written.
+ *
+ * @param buffer_size Bytes collected per call to `write`, or 0 for a default
+ *   of about 85 KiB.
+ */
+bool tox_file_set_sink_callback(Tox *_Nonnull tox, Tox_Friend_Number friend_number, Tox_File_Number file_number,
+                                tox_file_write_cb *_Nonnull write, void *_Nullable user_data, uint32_t buffer_size,
+                                Tox_Err_File_Stream *_Nullable error);
+
 /*******************************************************************************
  *
  * :: DHT groupchat queries.
@@ -532,6 +1064,13 @@ size_t tox_group_peer_get_ip_address_size(const Tox *_Nonnull tox, uint32_t grou
 bool tox_group_peer_get_ip_address(const Tox *_Nonnull tox, uint32_t group_number, uint32_t peer_id, uint8_t *_Nonnull ip_addr,
                                    Tox_Err_Group_Peer_Query *_Nullable error);
 
+/** Unit test support functions. Do not use outside tests. */
+/**
+ * Whether the friend has a friend connection yet. With experimental_lazy_load
+ * set, loaded friends get theirs during the first few tox_iterate calls.
+ */
+bool tox_testonly_friend_has_connection(const Tox *_Nonnull tox, Tox_Friend_Number friend_number);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
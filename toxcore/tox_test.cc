@@ -5,14 +5,17 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <array>
 #include <vector>
 
+#include "Messenger.h"
 #include "attributes.h"
 #include "crypto_core.h"
 #include "tox_log_level.h"
 #include "tox_options.h"
 #include "tox_private.h"
+#include "tox_struct.h"  // IWYU pragma: keep
 
 namespace {
 
@@ -82,6 +85,65 @@ TEST(Tox, BootstrapErrorCodes)
     tox_kill(tox);
 }
 
+TEST(Tox, TcpRelayPublicKeyIdentifiesTheSlot)
+{
+    Tox *tox = tox_new(nullptr, nullptr);
+    ASSERT_NE(tox, nullptr);
+
+    std::array<std::uint8_t, TOX_PUBLIC_KEY_SIZE> relay_pk;
+    relay_pk.fill(0x42);
+    ASSERT_TRUE(tox_add_tcp_relay(tox, "127.0.0.1", 33445, relay_pk.data(), nullptr));
+    ASSERT_EQ(tox_tcp_relay_count(tox), 1);
+
+    std::array<std::uint8_t, TOX_PUBLIC_KEY_SIZE> pk{};
+    EXPECT_TRUE(tox_tcp_relay_get_public_key(tox, 0, pk.data()));
+    EXPECT_EQ(pk, relay_pk);
+    EXPECT_FALSE(tox_tcp_relay_get_public_key(tox, 1, pk.data()));
+
+    tox_kill(tox);
+}
+
+TEST(Tox, IterationIntervalIsShortWhileSocketsAreOpen)
+{
+    SimulatedEnvironment env{12345};
+    auto node = env.create_node(33545);
+    Tox_Options_Testing testing_opts = {};
+    testing_opts.operating_system = &node->system;
+
+    struct Tox_Options *options = tox_options_new(nullptr);
+    ASSERT_NE(options, nullptr);
+
+    // Packets on the UDP socket are only read by tox_iterate.
+    Tox *tox = tox_new_testing(options, nullptr, &testing_opts, nullptr);
+    ASSERT_NE(tox, nullptr);
+
+    for (int i = 0; i < 10; ++i) {
+        tox_iterate(tox, nullptr);
+        EXPECT_LE(tox_iteration_interval(tox), 50);
+        env.advance_time(tox_iteration_interval(tox));
+    }
+
+    tox_kill(tox);
+
+    // Without sockets, an idle instance sleeps longer.
+    tox_options_set_udp_enabled(options, false);
+    tox = tox_new_testing(options, nullptr, &testing_opts, nullptr);
+    ASSERT_NE(tox, nullptr);
+
+    std::uint32_t longest = 0;
+
+    for (int i = 0; i < 10; ++i) {
+        tox_iterate(tox, nullptr);
+        longest = std::max(longest, tox_iteration_interval(tox));
+        env.advance_time(tox_iteration_interval(tox));
+    }
+
+    EXPECT_GT(longest, 50);
+
+    tox_options_free(options);
+    tox_kill(tox);
+}
+
 TEST(Tox, OneTest)
 {
     SimulatedEnvironment env{12345};
@@ -218,4 +280,226 @@ TEST(Tox, OneTest)
     tox_kill(tox2);
 }
 
+TEST(Tox, JournaledSavedataLoadsTheLatestState)
+{
+    SimulatedEnvironment env{12345};
+    auto node = env.create_node(33545);
+    Tox_Options_Testing testing_opts = {};
+    testing_opts.operating_system = &node->system;
+
+    struct Tox_Options *options = tox_options_new(nullptr);
+    ASSERT_NE(options, nullptr);
+    Tox *tox1 = tox_new_testing(options, nullptr, &testing_opts, nullptr);
+    ASSERT_NE(tox1, nullptr);
+
+    std::array<std::array<std::uint8_t, TOX_PUBLIC_KEY_SIZE>, 3> friend_pks;
+    std::array<std::uint8_t, CRYPTO_SECRET_KEY_SIZE> friend_sk;
+
+    for (auto &pk : friend_pks) {
+        ASSERT_EQ(crypto_new_keypair(&node->c_random, pk.data(), friend_sk.data()), 0);
+    }
+
+    std::vector<std::uint8_t> journal(1);
+    Tox_Err_Savedata_Journal err_journal;
+    EXPECT_EQ(tox_savedata_journal(tox1, journal.data(), &err_journal), 0);
+    EXPECT_EQ(err_journal, TOX_ERR_SAVEDATA_JOURNAL_NOT_STARTED);
+
+    const std::uint8_t base_name[] = "base";
+    tox_self_set_name(tox1, base_name, sizeof(base_name), nullptr);
+    tox_friend_add_norequest(tox1, friend_pks[0].data(), nullptr);
+    tox_friend_add_norequest(tox1, friend_pks[1].data(), nullptr);
+
+    std::vector<std::uint8_t> savedata(tox_savedata_compact_size(tox1));
+    savedata.resize(tox_savedata_compact(tox1, savedata.data()));
+    EXPECT_GT(savedata.size(), 0u);
+
+    // Nothing changed since the base.
+    journal.resize(tox_savedata_journal_size(tox1) + 1);
+    EXPECT_EQ(tox_savedata_journal(tox1, journal.data(), &err_journal), 0);
+    EXPECT_EQ(err_journal, TOX_ERR_SAVEDATA_JOURNAL_OK);
+
+    const std::uint8_t name[] = "journal";
+    tox_self_set_name(tox1, name, sizeof(name), nullptr);
+    tox_self_set_status(tox1, TOX_USER_STATUS_BUSY);
+    tox_friend_delete(tox1, tox_friend_by_public_key(tox1, friend_pks[0].data(), nullptr), nullptr);
+    tox_friend_add_norequest(tox1, friend_pks[2].data(), nullptr);
+
+    journal.resize(tox_savedata_journal_size(tox1));
+    std::size_t written = tox_savedata_journal(tox1, journal.data(), &err_journal);
+    EXPECT_EQ(err_journal, TOX_ERR_SAVEDATA_JOURNAL_OK);
+    EXPECT_GT(written, 0u);
+    savedata.insert(savedata.end(), journal.begin(), journal.begin() + written);
+
+    const std::uint8_t status_message[] = "appended";
+    tox_self_set_status_message(tox1, status_message, sizeof(status_message), nullptr);
+
+    journal.resize(tox_savedata_journal_size(tox1));
+    written = tox_savedata_journal(tox1, journal.data(), &err_journal);
+    EXPECT_EQ(err_journal, TOX_ERR_SAVEDATA_JOURNAL_OK);
+    savedata.insert(savedata.end(), journal.begin(), journal.begin() + written);
+
+    tox_kill(tox1);
+
+    tox_options_set_savedata_type(options, TOX_SAVEDATA_TYPE_TOX_SAVE);
+    tox_options_set_savedata_data(options, savedata.data(), savedata.size());
+    Tox_Err_New err_new;
+    Tox *tox2 = tox_new_testing(options, &err_new, &testing_opts, nullptr);
+    ASSERT_EQ(err_new, TOX_ERR_NEW_OK) << "Load failed";
+
+    std::vector<std::uint8_t> loaded_name(tox_self_get_name_size(tox2));
+    tox_self_get_name(tox2, loaded_name.data());
+    EXPECT_EQ(loaded_name, std::vector<std::uint8_t>(name, name + sizeof(name)));
+
+    std::vector<std::uint8_t> loaded_status_message(tox_self_get_status_message_size(tox2));
+    tox_self_get_status_message(tox2, loaded_status_message.data());
+    EXPECT_EQ(loaded_status_message,
+        std::vector<std::uint8_t>(status_message, status_message + sizeof(status_message)));
+
+    EXPECT_EQ(tox_self_get_status(tox2), TOX_USER_STATUS_BUSY);
+
+    EXPECT_EQ(tox_self_get_friend_list_size(tox2), 2);
+    Tox_Err_Friend_By_Public_Key err_by_pk;
+    tox_friend_by_public_key(tox2, friend_pks[0].data(), &err_by_pk);
+    EXPECT_EQ(err_by_pk, TOX_ERR_FRIEND_BY_PUBLIC_KEY_NOT_FOUND);
+    tox_friend_by_public_key(tox2, friend_pks[1].data(), &err_by_pk);
+    EXPECT_EQ(err_by_pk, TOX_ERR_FRIEND_BY_PUBLIC_KEY_OK);
+    tox_friend_by_public_key(tox2, friend_pks[2].data(), &err_by_pk);
+    EXPECT_EQ(err_by_pk, TOX_ERR_FRIEND_BY_PUBLIC_KEY_OK);
+
+    tox_options_free(options);
+    tox_kill(tox2);
+}
+
+TEST(Tox, JournaledSavedataClearsTheNameAndStatusMessage)
+{
+    SimulatedEnvironment env{12345};
+    auto node = env.create_node(33545);
+    Tox_Options_Testing testing_opts = {};
+    testing_opts.operating_system = &node->system;
+
+    struct Tox_Options *options = tox_options_new(nullptr);
+    ASSERT_NE(options, nullptr);
+    Tox *tox1 = tox_new_testing(options, nullptr, &testing_opts, nullptr);
+    ASSERT_NE(tox1, nullptr);
+
+    const std::uint8_t name[] = "base";
+    tox_self_set_name(tox1, name, sizeof(name), nullptr);
+    tox_self_set_status_message(tox1, name, sizeof(name), nullptr);
+
+    std::vector<std::uint8_t> savedata(tox_savedata_compact_size(tox1));
+    savedata.resize(tox_savedata_compact(tox1, savedata.data()));
+    const std::size_t base_size = savedata.size();
+
+    tox_self_set_name(tox1, nullptr, 0, nullptr);
+    tox_self_set_status_message(tox1, nullptr, 0, nullptr);
+
+    std::vector<std::uint8_t> journal(tox_savedata_journal_size(tox1));
+    Tox_Err_Savedata_Journal err_journal;
+    const std::size_t written = tox_savedata_journal(tox1, journal.data(), &err_journal);
+    EXPECT_EQ(err_journal, TOX_ERR_SAVEDATA_JOURNAL_OK);
+    savedata.insert(savedata.end(), journal.begin(), journal.begin() + written);
+
+    tox_kill(tox1);
+
+    tox_options_set_savedata_type(options, TOX_SAVEDATA_TYPE_TOX_SAVE);
+    Tox_Err_New err_new;
+
+    // The base alone keeps its name and status message.
+    tox_options_set_savedata_data(options, savedata.data(), base_size);
+    Tox *tox2 = tox_new_testing(options, &err_new, &testing_opts, nullptr);
+    ASSERT_EQ(err_new, TOX_ERR_NEW_OK) << "Load failed";
+    EXPECT_EQ(tox_self_get_name_size(tox2), sizeof(name));
+    EXPECT_EQ(tox_self_get_status_message_size(tox2), sizeof(name));
+
+    // A plain save of an instance without a name has empty sections for
+    // them, which load as they always did.
+    tox_self_set_name(tox2, nullptr, 0, nullptr);
+    tox_self_set_status_message(tox2, nullptr, 0, nullptr);
+    std::vector<std::uint8_t> empty_savedata(tox_get_savedata_size(tox2));
+    tox_get_savedata(tox2, empty_savedata.data());
+    tox_kill(tox2);
+
+    tox_options_set_savedata_data(options, empty_savedata.data(), empty_savedata.size());
+    tox2 = tox_new_testing(options, &err_new, &testing_opts, nullptr);
+    ASSERT_EQ(err_new, TOX_ERR_NEW_OK) << "Load failed";
+    EXPECT_EQ(tox_self_get_name_size(tox2), 0);
+    EXPECT_EQ(tox_self_get_status_message_size(tox2), 0);
+    tox_kill(tox2);
+
+    // The empty records of the journal clear what the base set.
+    tox_options_set_savedata_data(options, savedata.data(), savedata.size());
+    tox2 = tox_new_testing(options, &err_new, &testing_opts, nullptr);
+    ASSERT_EQ(err_new, TOX_ERR_NEW_OK) << "Load failed";
+    EXPECT_EQ(tox_self_get_name_size(tox2), 0);
+    EXPECT_EQ(tox_self_get_status_message_size(tox2), 0);
+
+    tox_options_free(options);
+    tox_kill(tox2);
+}
+
+TEST(Tox, LazyLoadKeepsTheFriendList)
+{
+    SimulatedEnvironment env{12345};
+    auto node = env.create_node(33545);
+    Tox_Options_Testing testing_opts = {};
+    testing_opts.operating_system = &node->system;
+
+    struct Tox_Options *options = tox_options_new(nullptr);
+    ASSERT_NE(options, nullptr);
+    Tox *tox1 = tox_new_testing(options, nullptr, &testing_opts, nullptr);
+    ASSERT_NE(tox1, nullptr);
+
+    // More friends than get a connection in one iteration.
+    std::array<std::array<std::uint8_t, TOX_PUBLIC_KEY_SIZE>, 100> friend_pks;
+    std::array<std::uint8_t, CRYPTO_SECRET_KEY_SIZE> friend_sk;
+
+    for (auto &pk : friend_pks) {
+        ASSERT_EQ(crypto_new_keypair(&node->c_random, pk.data(), friend_sk.data()), 0);
+        ASSERT_NE(tox_friend_add_norequest(tox1, pk.data(), nullptr), UINT32_MAX);
+    }
+
+    std::vector<std::uint8_t> savedata(tox_get_savedata_size(tox1));
+    tox_get_savedata(tox1, savedata.data());
+    tox_kill(tox1);
+
+    tox_options_set_experimental_lazy_load(options, true);
+    tox_options_set_savedata_type(options, TOX_SAVEDATA_TYPE_TOX_SAVE);
+
+    // Truncated savedata is rejected before anything is loaded. The size
+    // includes room for DHT nodes and relays we don't have, so cut it in the
+    // middle of the friend list.
+    tox_options_set_savedata_data(options, savedata.data(), savedata.size() / 2);
+    Tox_Err_New err_new;
+    EXPECT_EQ(tox_new_testing(options, &err_new, &testing_opts, nullptr), nullptr);
+    EXPECT_EQ(err_new, TOX_ERR_NEW_LOAD_BAD_FORMAT);
+
+    tox_options_set_savedata_data(options, savedata.data(), savedata.size());
+    Tox *tox2 = tox_new_testing(options, &err_new, &testing_opts, nullptr);
+    ASSERT_EQ(err_new, TOX_ERR_NEW_OK) << "Load failed";
+    EXPECT_EQ(tox_self_get_friend_list_size(tox2), friend_pks.size());
+    EXPECT_FALSE(tox_testonly_friend_has_connection(tox2, 0)) << "Connections were not deferred";
+
+    // Friends can be deleted before their connection exists.
+    Tox_Err_Friend_Delete err_delete;
+    tox_friend_delete(tox2, tox_friend_by_public_key(tox2, friend_pks.back().data(), nullptr), &err_delete);
+    EXPECT_EQ(err_delete, TOX_ERR_FRIEND_DELETE_OK);
+
+    for (int i = 0; i < 3; ++i) {
+        tox_iterate(tox2, nullptr);
+    }
+
+    EXPECT_EQ(tox_self_get_friend_list_size(tox2), friend_pks.size() - 1);
+
+    // Every deferred friend has its connection by now.
+    for (std::size_t i = 0; i + 1 < friend_pks.size(); ++i) {
+        Tox_Err_Friend_By_Public_Key err_by_pk;
+        const Tox_Friend_Number friend_number = tox_friend_by_public_key(tox2, friend_pks[i].data(), &err_by_pk);
+        EXPECT_EQ(err_by_pk, TOX_ERR_FRIEND_BY_PUBLIC_KEY_OK);
+        EXPECT_TRUE(tox_testonly_friend_has_connection(tox2, friend_number)) << i;
+    }
+
+    tox_options_free(options);
+    tox_kill(tox2);
+}
+
 }  // namespace
@@ -9,4 +9,8 @@
 #define TOX_ENC_SAVE_MAGIC_NUMBER ((const uint8_t *)"toxEsave")
 #define TOX_ENC_SAVE_MAGIC_LENGTH 8
 
+#define TOX_ENC_SAVE_CHUNKED_MAGIC_NUMBER ((const uint8_t *)"toxEsav2")
+/* Largest chunk length accepted when decrypting, to bound the memory a stream needs. */
+#define TOX_ENC_SAVE_CHUNK_LENGTH_MAX (1 << 24)
+
 #endif /* C_TOXCORE_TOXENCRYPTSAVE_DEFINES_H */
@@ -28,6 +28,13 @@ static_assert(TOX_PASS_KEY_LENGTH == CRYPTO_SHARED_KEY_SIZE,
 static_assert(TOX_PASS_ENCRYPTION_EXTRA_LENGTH == (crypto_box_MACBYTES + crypto_box_NONCEBYTES +
               crypto_pwhash_scryptsalsa208sha256_SALTBYTES + TOX_ENC_SAVE_MAGIC_LENGTH),
               "TOX_PASS_ENCRYPTION_EXTRA_LENGTH is assumed to be equal to (crypto_box_MACBYTES + crypto_box_NONCEBYTES + crypto_pwhash_scryptsalsa208sha256_SALTBYTES + TOX_ENC_SAVE_MAGIC_LENGTH)");
+static_assert(TOX_PASS_CHUNKED_HEADER_LENGTH == (TOX_ENC_SAVE_MAGIC_LENGTH + TOX_PASS_SALT_LENGTH + CRYPTO_NONCE_SIZE +
+              sizeof(uint32_t)),
+              "TOX_PASS_CHUNKED_HEADER_LENGTH is assumed to be equal to (TOX_ENC_SAVE_MAGIC_LENGTH + TOX_PASS_SALT_LENGTH + CRYPTO_NONCE_SIZE + sizeof(uint32_t))");
+static_assert(TOX_PASS_CHUNK_EXTRA_LENGTH == CRYPTO_MAC_SIZE,
+              "TOX_PASS_CHUNK_EXTRA_LENGTH is assumed to be equal to CRYPTO_MAC_SIZE");
+static_assert(TOX_PASS_CHUNK_LENGTH <= TOX_ENC_SAVE_CHUNK_LENGTH_MAX,
+              "TOX_PASS_CHUNK_LENGTH must be accepted by the decryption functions");
 
 #define SET_ERROR_PARAMETER(param, x) \
     do {                              \
@@ -48,6 +55,18 @@ uint32_t tox_pass_encryption_extra_length(void)
 {
     return TOX_PASS_ENCRYPTION_EXTRA_LENGTH;
 }
+uint32_t tox_pass_chunked_header_length(void)
+{
+    return TOX_PASS_CHUNKED_HEADER_LENGTH;
+}
+uint32_t tox_pass_chunk_length(void)
+{
+    return TOX_PASS_CHUNK_LENGTH;
+}
+uint32_t tox_pass_chunk_extra_length(void)
+{
+    return TOX_PASS_CHUNK_EXTRA_LENGTH;
+}
 
 struct Tox_Pass_Key {
     uint8_t salt[TOX_PASS_SALT_LENGTH];
@@ -100,7 +119,7 @@ bool tox_get_salt(
         return false;
     }
 
-    if (memcmp(ciphertext, TOX_ENC_SAVE_MAGIC_NUMBER, TOX_ENC_SAVE_MAGIC_LENGTH) != 0) {
+    if (!tox_is_data_encrypted(ciphertext)) {
         SET_ERROR_PARAMETER(error, TOX_ERR_GET_SALT_BAD_FORMAT);
         return false;
     }
@@ -399,8 +418,8 @@ bool tox_pass_decrypt(const uint8_t ciphertext[], size_t ciphertext_len, const u
 /**
  * Determines whether or not the given data is encrypted by this module.
  *
- * It does this check by verifying that the magic number is the one put in
- * place by the encryption functions.
+ * It does this check by verifying that the magic number is one of the ones
+ * put in place by the encryption functions, in either format.
  *
  * The data must be at least TOX_PASS_ENCRYPTION_EXTRA_LENGTH bytes in length.
  * If the passed byte array is smaller than required, the behaviour is
@@ -412,7 +431,402 @@ bool tox_pass_decrypt(const uint8_t ciphertext[], size_t ciphertext_len, const u
  */
 bool tox_is_data_encrypted(const uint8_t data[TOX_PASS_ENCRYPTION_EXTRA_LENGTH])
 {
-    return memcmp(data, TOX_ENC_SAVE_MAGIC_NUMBER, TOX_ENC_SAVE_MAGIC_LENGTH) == 0;
+    return memcmp(data, TOX_ENC_SAVE_MAGIC_NUMBER, TOX_ENC_SAVE_MAGIC_LENGTH) == 0
+           || memcmp(data, TOX_ENC_SAVE_CHUNKED_MAGIC_NUMBER, TOX_ENC_SAVE_MAGIC_LENGTH) == 0;
+}
+
+/* The chunked header consists of, in order:
+ * magic number, salt, nonce, chunk length (big endian)
+ * Chunk i is encrypted with the nonce incremented by i, and with the header,
+ * i and whether it is the last chunk as associated data.
+ */
+#define CHUNK_NONCE_OFFSET (TOX_ENC_SAVE_MAGIC_LENGTH + TOX_PASS_SALT_LENGTH)
+#define CHUNK_LENGTH_OFFSET (CHUNK_NONCE_OFFSET + CRYPTO_NONCE_SIZE)
+#define CHUNK_AD_LENGTH (TOX_PASS_CHUNKED_HEADER_LENGTH + sizeof(uint32_t) + 1)
+
+static void pack_u32_be(uint8_t *_Nonnull bytes, uint32_t v)
+{
+    bytes[0] = (uint8_t)(v >> 24);
+    bytes[1] = (uint8_t)(v >> 16);
+    bytes[2] = (uint8_t)(v >> 8);
+    bytes[3] = (uint8_t)v;
+}
+
+static uint32_t unpack_u32_be(const uint8_t *_Nonnull bytes)
+{
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+/** @brief Read the chunk length from a chunked header, or 0 if the header is malformed. */
+static uint32_t chunked_header_chunk_length(const uint8_t header[_Nonnull TOX_PASS_CHUNKED_HEADER_LENGTH])
+{
+    if (memcmp(header, TOX_ENC_SAVE_CHUNKED_MAGIC_NUMBER, TOX_ENC_SAVE_MAGIC_LENGTH) != 0) {
+        return 0;
+    }
+
+    const uint32_t chunk_length = unpack_u32_be(header + CHUNK_LENGTH_OFFSET);
+
+    if (chunk_length > TOX_ENC_SAVE_CHUNK_LENGTH_MAX) {
+        return 0;
+    }
+
+    return chunk_length;
+}
+
+static void chunked_header_write(const Tox_Pass_Key *_Nonnull key, const Random *_Nonnull rng,
+                                 uint8_t header[_Nonnull TOX_PASS_CHUNKED_HEADER_LENGTH])
+{
+    memcpy(header, TOX_ENC_SAVE_CHUNKED_MAGIC_NUMBER, TOX_ENC_SAVE_MAGIC_LENGTH);
+    memcpy(header + TOX_ENC_SAVE_MAGIC_LENGTH, key->salt, TOX_PASS_SALT_LENGTH);
+    random_nonce(rng, header + CHUNK_NONCE_OFFSET);
+    pack_u32_be(header + CHUNK_LENGTH_OFFSET, TOX_PASS_CHUNK_LENGTH);
+}
+
+static void chunk_nonce_and_ad(const uint8_t header[_Nonnull TOX_PASS_CHUNKED_HEADER_LENGTH], uint32_t index, bool last,
+                               uint8_t nonce[_Nonnull CRYPTO_NONCE_SIZE], uint8_t ad[_Nonnull CHUNK_AD_LENGTH])
+{
+    memcpy(nonce, header + CHUNK_NONCE_OFFSET, CRYPTO_NONCE_SIZE);
+    increment_nonce_number(nonce, index);
+
+    memcpy(ad, header, TOX_PASS_CHUNKED_HEADER_LENGTH);
+    pack_u32_be(ad + TOX_PASS_CHUNKED_HEADER_LENGTH, index);
+    ad[CHUNK_AD_LENGTH - 1] = last ? 1 : 0;
+}
+
+static bool encrypt_chunk(const uint8_t key[_Nonnull TOX_PASS_KEY_LENGTH],
+                          const uint8_t header[_Nonnull TOX_PASS_CHUNKED_HEADER_LENGTH], uint32_t index, bool last,
+                          const uint8_t *_Nonnull plaintext, size_t plaintext_len, uint8_t *_Nonnull ciphertext)
+{
+    uint8_t nonce[CRYPTO_NONCE_SIZE];
+    uint8_t ad[CHUNK_AD_LENGTH];
+    chunk_nonce_and_ad(header, index, last, nonce, ad);
+
+    const int32_t encrypted_len = encrypt_data_symmetric_xaead(key, nonce, plaintext, plaintext_len, ciphertext,
+                                  ad, sizeof(ad));
+    return encrypted_len >= 0 && (size_t)encrypted_len == plaintext_len + TOX_PASS_CHUNK_EXTRA_LENGTH;
+}
+
+static bool decrypt_chunk(const uint8_t key[_Nonnull TOX_PASS_KEY_LENGTH],
+                          const uint8_t header[_Nonnull TOX_PASS_CHUNKED_HEADER_LENGTH], uint32_t index, bool last,
+                          const uint8_t *_Nonnull ciphertext, size_t ciphertext_len, uint8_t *_Nonnull plaintext)
+{
+    uint8_t nonce[CRYPTO_NONCE_SIZE];
+    uint8_t ad[CHUNK_AD_LENGTH];
+    chunk_nonce_and_ad(header, index, last, nonce, ad);
+
+    const int32_t decrypted_len = decrypt_data_symmetric_xaead(key, nonce, ciphertext, ciphertext_len, plaintext,
+                                  ad, sizeof(ad));
+    return decrypted_len >= 0 && (size_t)decrypted_len == ciphertext_len - TOX_PASS_CHUNK_EXTRA_LENGTH;
+}
+
+size_t tox_pass_chunked_length(size_t plaintext_len)
+{
+    const size_t num_chunks = (plaintext_len + TOX_PASS_CHUNK_LENGTH - 1) / TOX_PASS_CHUNK_LENGTH;
+    return TOX_PASS_CHUNKED_HEADER_LENGTH + plaintext_len + num_chunks * TOX_PASS_CHUNK_EXTRA_LENGTH;
+}
+
+/** @brief Split chunked encrypted data into chunks.
+ *
+ * @return the number of chunks, or 0 if the data is malformed.
+ */
+static uint32_t chunked_layout(const uint8_t *_Nullable ciphertext, size_t ciphertext_len,
+                               uint32_t *_Nonnull chunk_length, size_t *_Nonnull plaintext_len)
+{
+    if (ciphertext == nullptr || ciphertext_len <= TOX_PASS_CHUNKED_HEADER_LENGTH + TOX_PASS_CHUNK_EXTRA_LENGTH) {
+        return 0;
+    }
+
+    *chunk_length = chunked_header_chunk_length(ciphertext);
+
+    if (*chunk_length == 0) {
+        return 0;
+    }
+
+    const size_t body_len = ciphertext_len - TOX_PASS_CHUNKED_HEADER_LENGTH;
+    const size_t encrypted_chunk_length = (size_t) * chunk_length + TOX_PASS_CHUNK_EXTRA_LENGTH;
+    const size_t num_chunks = (body_len + encrypted_chunk_length - 1) / encrypted_chunk_length;
+    const size_t last_len = body_len - (num_chunks - 1) * encrypted_chunk_length;
+
+    if (num_chunks > UINT32_MAX || last_len <= TOX_PASS_CHUNK_EXTRA_LENGTH) {
+        return 0;
+    }
+
+    *plaintext_len = body_len - num_chunks * TOX_PASS_CHUNK_EXTRA_LENGTH;
+    return (uint32_t)num_chunks;
+}
+
+size_t tox_pass_chunked_plaintext_length(const uint8_t ciphertext[], size_t ciphertext_len)
+{
+    uint32_t chunk_length;
+    size_t plaintext_len;
+
+    if (chunked_layout(ciphertext, ciphertext_len, &chunk_length, &plaintext_len) == 0) {
+        return 0;
+    }
+
+    return plaintext_len;
+}
+
+uint32_t tox_pass_chunked_count(const uint8_t ciphertext[], size_t ciphertext_len)
+{
+    uint32_t chunk_length;
+    size_t plaintext_len;
+    return chunked_layout(ciphertext, ciphertext_len, &chunk_length, &plaintext_len);
+}
+
+bool tox_pass_key_encrypt_chunked(const Tox_Pass_Key *_Nonnull key, const uint8_t plaintext[], size_t plaintext_len,
+                                  uint8_t ciphertext[], Tox_Err_Encryption *_Nullable error)
+{
+    const Random *rng = os_random();
+
+    if (rng == nullptr) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_FAILED);
+        return false;
+    }
+
+    if (plaintext_len == 0 || plaintext == nullptr || key == nullptr || ciphertext == nullptr) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_NULL);
+        return false;
+    }
+
+    if ((plaintext_len - 1) / TOX_PASS_CHUNK_LENGTH >= UINT32_MAX) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_FAILED);
+        return false;
+    }
+
+    const uint8_t *header = ciphertext;
+    chunked_header_write(key, rng, ciphertext);
+    ciphertext += TOX_PASS_CHUNKED_HEADER_LENGTH;
+
+    for (uint32_t i = 0; plaintext_len > 0; ++i) {
+        const size_t chunk_len = plaintext_len < TOX_PASS_CHUNK_LENGTH ? plaintext_len : TOX_PASS_CHUNK_LENGTH;
+        const bool last = chunk_len == plaintext_len;
+
+        if (!encrypt_chunk(key->key, header, i, last, plaintext, chunk_len, ciphertext)) {
+            SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_FAILED);
+            return false;
+        }
+
+        plaintext += chunk_len;
+        plaintext_len -= chunk_len;
+        ciphertext += chunk_len + TOX_PASS_CHUNK_EXTRA_LENGTH;
+    }
+
+    SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_OK);
+    return true;
+}
+
+bool tox_pass_key_decrypt_chunks(const Tox_Pass_Key *_Nonnull key, const uint8_t ciphertext[], size_t ciphertext_len,
+                                 uint32_t first_chunk, uint32_t num_chunks, uint8_t plaintext[],
+                                 Tox_Err_Decryption *_Nullable error)
+{
+    if (ciphertext == nullptr || key == nullptr || plaintext == nullptr) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_NULL);
+        return false;
+    }
+
+    if (ciphertext_len < TOX_PASS_CHUNKED_HEADER_LENGTH) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_INVALID_LENGTH);
+        return false;
+    }
+
+    if (chunked_header_chunk_length(ciphertext) == 0) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_BAD_FORMAT);
+        return false;
+    }
+
+    uint32_t chunk_length;
+    size_t plaintext_len;
+    const uint32_t total_chunks = chunked_layout(ciphertext, ciphertext_len, &chunk_length, &plaintext_len);
+
+    if (total_chunks == 0 || first_chunk > total_chunks || num_chunks > total_chunks - first_chunk) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_INVALID_LENGTH);
+        return false;
+    }
+
+    const size_t encrypted_chunk_length = (size_t)chunk_length + TOX_PASS_CHUNK_EXTRA_LENGTH;
+
+    for (uint32_t i = first_chunk; i < first_chunk + num_chunks; ++i) {
+        const bool last = i == total_chunks - 1;
+        const size_t offset = (size_t)i * chunk_length;
+        const size_t chunk_len = last ? plaintext_len - offset : chunk_length;
+
+        if (!decrypt_chunk(key->key, ciphertext, i, last,
+                           ciphertext + TOX_PASS_CHUNKED_HEADER_LENGTH + (size_t)i * encrypted_chunk_length,
+                           chunk_len + TOX_PASS_CHUNK_EXTRA_LENGTH, plaintext + offset)) {
+            SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_FAILED);
+            return false;
+        }
+    }
+
+    SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_OK);
+    return true;
+}
+
+bool tox_pass_key_decrypt_chunked(const Tox_Pass_Key *_Nonnull key, const uint8_t ciphertext[], size_t ciphertext_len,
+                                  uint8_t plaintext[], Tox_Err_Decryption *_Nullable error)
+{
+    return tox_pass_key_decrypt_chunks(key, ciphertext, ciphertext_len, 0,
+                                       tox_pass_chunked_count(ciphertext, ciphertext_len), plaintext, error);
+}
+
+struct Tox_Pass_Encryptor {
+    uint8_t key[TOX_PASS_KEY_LENGTH];
+    uint8_t header[TOX_PASS_CHUNKED_HEADER_LENGTH];
+    uint32_t next_chunk;
+    bool finished;
+};
+
+Tox_Pass_Encryptor *tox_pass_encryptor_new(const Tox_Pass_Key *_Nonnull key,
+        uint8_t header[TOX_PASS_CHUNKED_HEADER_LENGTH], Tox_Err_Encryption *_Nullable error)
+{
+    const Random *rng = os_random();
+
+    if (rng == nullptr) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_FAILED);
+        return nullptr;
+    }
+
+    if (key == nullptr || header == nullptr) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_NULL);
+        return nullptr;
+    }
+
+    Tox_Pass_Encryptor *encryptor = (Tox_Pass_Encryptor *)calloc(1, sizeof(Tox_Pass_Encryptor));
+
+    if (encryptor == nullptr) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_FAILED);
+        return nullptr;
+    }
+
+    memcpy(encryptor->key, key->key, TOX_PASS_KEY_LENGTH);
+    chunked_header_write(key, rng, encryptor->header);
+    memcpy(header, encryptor->header, TOX_PASS_CHUNKED_HEADER_LENGTH);
+
+    SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_OK);
+    return encryptor;
+}
+
+bool tox_pass_encryptor_write(Tox_Pass_Encryptor *_Nonnull encryptor, const uint8_t plaintext[], size_t plaintext_len,
+                              bool last, uint8_t ciphertext[], Tox_Err_Encryption *_Nullable error)
+{
+    if (encryptor == nullptr || plaintext == nullptr || ciphertext == nullptr) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_NULL);
+        return false;
+    }
+
+    const bool valid_length = last
+                              ? plaintext_len > 0 && plaintext_len <= TOX_PASS_CHUNK_LENGTH
+                              : plaintext_len == TOX_PASS_CHUNK_LENGTH;
+
+    if (encryptor->finished || !valid_length || encryptor->next_chunk == UINT32_MAX) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_FAILED);
+        return false;
+    }
+
+    if (!encrypt_chunk(encryptor->key, encryptor->header, encryptor->next_chunk, last,
+                       plaintext, plaintext_len, ciphertext)) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_FAILED);
+        return false;
+    }
+
+    ++encryptor->next_chunk;
+    encryptor->finished = last;
+    SET_ERROR_PARAMETER(error, TOX_ERR_ENCRYPTION_OK);
+    return true;
+}
+
+void tox_pass_encryptor_free(Tox_Pass_Encryptor *_Nullable encryptor)
+{
+    if (encryptor == nullptr) {
+        return;
+    }
+
+    crypto_memzero(encryptor->key, TOX_PASS_KEY_LENGTH);
+    free(encryptor);
+}
+
+struct Tox_Pass_Decryptor {
+    uint8_t key[TOX_PASS_KEY_LENGTH];
+    uint8_t header[TOX_PASS_CHUNKED_HEADER_LENGTH];
+    uint32_t chunk_length;
+    uint32_t next_chunk;
+    bool finished;
+};
+
+Tox_Pass_Decryptor *tox_pass_decryptor_new(const Tox_Pass_Key *_Nonnull key,
+        const uint8_t header[TOX_PASS_CHUNKED_HEADER_LENGTH], Tox_Err_Decryption *_Nullable error)
+{
+    if (key == nullptr || header == nullptr) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_NULL);
+        return nullptr;
+    }
+
+    const uint32_t chunk_length = chunked_header_chunk_length(header);
+
+    if (chunk_length == 0) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_BAD_FORMAT);
+        return nullptr;
+    }
+
+    Tox_Pass_Decryptor *decryptor = (Tox_Pass_Decryptor *)calloc(1, sizeof(Tox_Pass_Decryptor));
+
+    if (decryptor == nullptr) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_FAILED);
+        return nullptr;
+    }
+
+    memcpy(decryptor->key, key->key, TOX_PASS_KEY_LENGTH);
+    memcpy(decryptor->header, header, TOX_PASS_CHUNKED_HEADER_LENGTH);
+    decryptor->chunk_length = chunk_length;
+
+    SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_OK);
+    return decryptor;
+}
+
+uint32_t tox_pass_decryptor_chunk_length(const Tox_Pass_Decryptor *_Nonnull decryptor)
+{
+    return decryptor->chunk_length + TOX_PASS_CHUNK_EXTRA_LENGTH;
+}
+
+bool tox_pass_decryptor_read(Tox_Pass_Decryptor *_Nonnull decryptor, const uint8_t ciphertext[], size_t ciphertext_len,
+                             bool last, uint8_t plaintext[], Tox_Err_Decryption *_Nullable error)
+{
+    if (decryptor == nullptr || ciphertext == nullptr || plaintext == nullptr) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_NULL);
+        return false;
+    }
+
+    const uint32_t encrypted_chunk_length = tox_pass_decryptor_chunk_length(decryptor);
+    const bool valid_length = last
+                              ? ciphertext_len > TOX_PASS_CHUNK_EXTRA_LENGTH && ciphertext_len <= encrypted_chunk_length
+                              : ciphertext_len == encrypted_chunk_length;
+
+    if (decryptor->finished || !valid_length || decryptor->next_chunk == UINT32_MAX) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_INVALID_LENGTH);
+        return false;
+    }
+
+    if (!decrypt_chunk(decryptor->key, decryptor->header, decryptor->next_chunk, last,
+                       ciphertext, ciphertext_len, plaintext)) {
+        SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_FAILED);
+        return false;
+    }
+
+    ++decryptor->next_chunk;
+    decryptor->finished = last;
+    SET_ERROR_PARAMETER(error, TOX_ERR_DECRYPTION_OK);
+    return true;
+}
+
+void tox_pass_decryptor_free(Tox_Pass_Decryptor *_Nullable decryptor)
+{
+    if (decryptor == nullptr) {
+        return;
+    }
+
+    crypto_memzero(decryptor->key, TOX_PASS_KEY_LENGTH);
+    free(decryptor);
 }
 
 const char *_Nonnull tox_err_key_derivation_to_string(Tox_Err_Key_Derivation error)
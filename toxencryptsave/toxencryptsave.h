@@ -39,6 +39,9 @@ extern "C" {
  * checking (no guarantees are made of course). Any data to be decrypted must
  * start with the magic number.
  *
+ * Part 3 is a second format for large data, which is encrypted in fixed-size
+ * chunks so it can be streamed with bounded memory and decrypted in parallel.
+ *
  * Clients should consider alerting their users that, unlike plain data, if
  * even one bit becomes corrupted, the data will be entirely unrecoverable.
  * Ditto if they forget their password, there is no way to recover the data.
@@ -345,8 +348,8 @@ bool tox_get_salt(
 /**
  * Determines whether or not the given data is encrypted by this module.
  *
- * It does this check by verifying that the magic number is the one put in
- * place by the encryption functions.
+ * It does this check by verifying that the magic number is one of the ones
+ * put in place by the encryption functions, in either format.
  *
  * The data must be at least TOX_PASS_ENCRYPTION_EXTRA_LENGTH bytes in length.
  * If the passed byte array is smaller than required, the behaviour is
@@ -358,6 +361,196 @@ bool tox_get_salt(
  */
 bool tox_is_data_encrypted(const uint8_t data[TOX_PASS_ENCRYPTION_EXTRA_LENGTH]);
 
+/*******************************************************************************
+ *
+ *                                BEGIN PART 3
+ *
+ * The chunked format. The plain text is split into chunks of
+ * TOX_PASS_CHUNK_LENGTH bytes (the last one may be shorter), and each chunk is
+ * encrypted and authenticated on its own with the pass-key. The chunks are
+ * bound to their position and to the header, so chunks can't be reordered,
+ * dropped or truncated without decryption failing.
+ *
+ * The encrypted data consists of a TOX_PASS_CHUNKED_HEADER_LENGTH byte header
+ * followed by the encrypted chunks, each TOX_PASS_CHUNK_EXTRA_LENGTH bytes
+ * longer than its plain text. The header starts with a magic number different
+ * from the one of the format above, and contains the salt at the same offset,
+ * so `tox_get_salt` and `tox_is_data_encrypted` work on both formats.
+ *
+ ******************************************************************************/
+
+/**
+ * The size of the header of chunked encrypted data.
+ */
+#define TOX_PASS_CHUNKED_HEADER_LENGTH 68
+
+uint32_t tox_pass_chunked_header_length(void);
+
+/**
+ * The number of plain text bytes in a chunk. Only the last chunk may be
+ * shorter.
+ */
+#define TOX_PASS_CHUNK_LENGTH 65536
+
+uint32_t tox_pass_chunk_length(void);
+
+/**
+ * The amount of additional data required to store each encrypted chunk.
+ */
+#define TOX_PASS_CHUNK_EXTRA_LENGTH 16
+
+uint32_t tox_pass_chunk_extra_length(void);
+
+/**
+ * @brief The length of the chunked encryption of `plaintext_len` bytes.
+ */
+size_t tox_pass_chunked_length(size_t plaintext_len);
+
+/**
+ * @brief The length of the plain text of chunked encrypted data.
+ *
+ * @param ciphertext At least TOX_PASS_CHUNKED_HEADER_LENGTH bytes of chunked
+ *   encrypted data.
+ * @param ciphertext_len The length of the whole encrypted data.
+ *
+ * @return 0 if the data is not in the chunked format or its length doesn't fit
+ *   a whole number of chunks.
+ */
+size_t tox_pass_chunked_plaintext_length(const uint8_t ciphertext[], size_t ciphertext_len);
+
+/**
+ * @brief The number of chunks in chunked encrypted data, or 0 if the data is
+ *   malformed. See `tox_pass_chunked_plaintext_length`.
+ */
+uint32_t tox_pass_chunked_count(const uint8_t ciphertext[], size_t ciphertext_len);
+
+/**
+ * @brief Encrypt a plain text in the chunked format with a key produced by
+ *   tox_pass_key_derive or tox_pass_key_derive_with_salt.
+ *
+ * @param plaintext A byte array of length `plaintext_len`.
+ * @param plaintext_len The length of the plain text array. Bigger than 0.
+ * @param ciphertext The cipher text array to write the encrypted data to. It
+ *   must be at least `tox_pass_chunked_length(plaintext_len)` bytes long.
+ *
+ * @return true on success.
+ */
+bool tox_pass_key_encrypt_chunked(const Tox_Pass_Key *key, const uint8_t plaintext[], size_t plaintext_len,
+                                  uint8_t ciphertext[], Tox_Err_Encryption *error);
+
+/**
+ * @brief Decrypt data encrypted in the chunked format.
+ *
+ * @param ciphertext A byte array of length `ciphertext_len`.
+ * @param ciphertext_len The length of the cipher text array.
+ * @param plaintext The plain text array to write the decrypted data to. It
+ *   must be at least `tox_pass_chunked_plaintext_length` bytes long.
+ *
+ * @return true on success.
+ */
+bool tox_pass_key_decrypt_chunked(const Tox_Pass_Key *key, const uint8_t ciphertext[], size_t ciphertext_len,
+                                  uint8_t plaintext[], Tox_Err_Decryption *error);
+
+/**
+ * @brief Decrypt some of the chunks of data encrypted in the chunked format.
+ *
+ * Chunk `i` is written at offset `i * TOX_PASS_CHUNK_LENGTH` of `plaintext`,
+ * so `plaintext` is the same buffer `tox_pass_key_decrypt_chunked` would
+ * write to. This function may be called from several threads at once for
+ * disjoint chunk ranges of the same data, to decrypt it on several cores.
+ *
+ * @param ciphertext The whole encrypted data.
+ * @param ciphertext_len The length of the whole encrypted data.
+ * @param first_chunk The index of the first chunk to decrypt.
+ * @param num_chunks The number of chunks to decrypt.
+ * @param plaintext The plain text array of the whole data.
+ *
+ * @return true on success.
+ */
+bool tox_pass_key_decrypt_chunks(const Tox_Pass_Key *key, const uint8_t ciphertext[], size_t ciphertext_len,
+                                 uint32_t first_chunk, uint32_t num_chunks, uint8_t plaintext[],
+                                 Tox_Err_Decryption *error);
+
+/**
+ * @brief State for encrypting a stream in the chunked format.
+ *
+ * The encryptor holds a copy of the key, so the pass-key may be freed once the
+ * encryptor is created.
+ */
+typedef struct Tox_Pass_Encryptor Tox_Pass_Encryptor;
+
+/**
+ * @brief Start encrypting a stream.
+ *
+ * @param header The array to write the TOX_PASS_CHUNKED_HEADER_LENGTH byte
+ *   header to. It goes first in the encrypted data.
+ *
+ * @return new encryptor on success, NULL on failure.
+ */
+Tox_Pass_Encryptor *tox_pass_encryptor_new(const Tox_Pass_Key *key, uint8_t header[TOX_PASS_CHUNKED_HEADER_LENGTH],
+        Tox_Err_Encryption *error);
+
+/**
+ * @brief Encrypt the next chunk of the stream.
+ *
+ * @param plaintext The chunk: TOX_PASS_CHUNK_LENGTH bytes, or between 1 and
+ *   TOX_PASS_CHUNK_LENGTH bytes for the last chunk.
+ * @param last Whether this is the last chunk of the stream. No chunks can be
+ *   written after it.
+ * @param ciphertext The array to write the `plaintext_len +
+ *   TOX_PASS_CHUNK_EXTRA_LENGTH` byte encrypted chunk to.
+ *
+ * @return true on success.
+ */
+bool tox_pass_encryptor_write(Tox_Pass_Encryptor *encryptor, const uint8_t plaintext[], size_t plaintext_len, bool last,
+                              uint8_t ciphertext[], Tox_Err_Encryption *error);
+
+/**
+ * Deallocate a Tox_Pass_Encryptor. NULL is an acceptable argument value.
+ */
+void tox_pass_encryptor_free(Tox_Pass_Encryptor *encryptor);
+
+/**
+ * @brief State for decrypting a stream in the chunked format.
+ */
+typedef struct Tox_Pass_Decryptor Tox_Pass_Decryptor;
+
+/**
+ * @brief Start decrypting a stream.
+ *
+ * @param header The first TOX_PASS_CHUNKED_HEADER_LENGTH bytes of the stream.
+ *
+ * @return new decryptor on success, NULL on failure.
+ */
+Tox_Pass_Decryptor *tox_pass_decryptor_new(const Tox_Pass_Key *key, const uint8_t header[TOX_PASS_CHUNKED_HEADER_LENGTH],
+        Tox_Err_Decryption *error);
+
+/**
+ * @brief The length of the encrypted chunks of the stream, except for the
+ *   last one which may be shorter.
+ */
+uint32_t tox_pass_decryptor_chunk_length(const Tox_Pass_Decryptor *decryptor);
+
+/**
+ * @brief Decrypt the next chunk of the stream.
+ *
+ * @param ciphertext The encrypted chunk: `tox_pass_decryptor_chunk_length`
+ *   bytes, or fewer for the last chunk.
+ * @param last Whether this is the last chunk of the stream. Decryption fails
+ *   if it isn't, so a truncated stream is detected.
+ * @param plaintext The array to write the `ciphertext_len -
+ *   TOX_PASS_CHUNK_EXTRA_LENGTH` byte chunk to.
+ *
+ * @return true on success.
+ */
+bool tox_pass_decryptor_read(Tox_Pass_Decryptor *decryptor, const uint8_t ciphertext[], size_t ciphertext_len, bool last,
+                             uint8_t plaintext[], Tox_Err_Decryption *error);
+
+/**
+ * Deallocate a Tox_Pass_Decryptor. NULL is an acceptable argument value.
+ */
+void tox_pass_decryptor_free(Tox_Pass_Decryptor *decryptor);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif